@@ -108,6 +108,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <setjmp.h>
+#include <pthread.h>
+#include <unistd.h>
 
 
 /* general API header which will be public to the customer side */
@@ -118,6 +120,29 @@
  * immediately be converted into EC_KEYs*/
 #define DO_CONVERT true
 #define DEBUG_TBD
+/** The maximum number of threads converting the keys of a bulk registration.
+ * @since 0.3.0.6 */
+#define MAX_CONVERT_THREADS  8
+/** The minimum number of keys converted by each thread. @since 0.3.0.6 */
+#define MIN_KEYS_PER_THREAD 64
+
+/**
+ * The part of a bulk registration converted by one thread.
+ * 
+ * @since 0.3.0.6
+ */
+typedef struct {
+  /** The keys of the bulk. */
+  BGPSecKey**   keys;
+  /** The converted EC_KEYs, same index as the keys. */
+  EC_KEY**      ecKeys;
+  /** The status of each key, same index as the keys. */
+  sca_status_t* keyStatus;
+  /** The index of the first key of this part. */
+  int           first;
+  /** The number of keys of this part. */
+  int           count;
+} BOSSL_ConvertJob;
 
 /** indicates if the library is initialized */
 static bool BOSSL_initialized = false;
@@ -1086,6 +1111,159 @@ u_int8_t registerPublicKey(BGPSecKey* key, sca_key_source_t source,
   return _registerKey(key, source, status, false);
 }
 
+/**
+ * Convert the DER keys of the given part of a bulk registration. 
+ * 
+ * @param job The BOSSL_ConvertJob.
+ * 
+ * @return NULL
+ * 
+ * @since 0.3.0.6
+ */
+static void* _convertKeys(void* job)
+{
+  BOSSL_ConvertJob* cJob = (BOSSL_ConvertJob*)job;
+  int idx;
+
+  for (idx = cJob->first; idx < cJob->first + cJob->count; idx++)
+  {
+    cJob->ecKeys[idx] = ks_decodeKey(cJob->keys[idx], false, 
+                                     &cJob->keyStatus[idx]);
+  }
+
+  return NULL;
+}
+
+/**
+ * Register a bulk of public keys. The DER keys are converted into EC_KEYs by 
+ * up to MAX_CONVERT_THREADS threads, afterwards the keys are stored in the 
+ * given order. This way the conversion, which is the expensive part of the
+ * registration, does not happen one key at a time.
+ * NOTE: The key information MUST be copied within the API.
+ *
+ * The following errors can be reported:
+ *   API_STATUS_ERR_NO_DATA: Some of the required data is missing.
+ *   API_STATUS_ERR_INSUF_KEYSTORAGE: Not enough memory for the bulk.
+ *   See key_storage.ks_storeKey()
+ *
+ * @param count The number of keys.
+ * @param keys The keys - each MUST contain the DER encoded key.
+ * @param source The source of the keys.
+ * @param keyStatus (out) Will contain the status of each key, can be NULL.
+ * @param status Will contain the combined status information of this call.
+ *
+ * @return API_SUCCESS if all keys are registered or API_FAILURE (check 
+ *         status and keyStatus)
+ * 
+ * @since 0.3.0.6
+ */
+u_int8_t registerPublicKeys(int count, BGPSecKey** keys, 
+                            sca_key_source_t source, sca_status_t* keyStatus,
+                            sca_status_t* status)
+{
+  sca_status_t     myStatus = API_STATUS_OK;
+  sca_status_t*    kStatus  = keyStatus;
+  EC_KEY**         ecKeys   = NULL;
+  BOSSL_ConvertJob jobs[MAX_CONVERT_THREADS];
+  pthread_t        threads[MAX_CONVERT_THREADS];
+  bool             started[MAX_CONVERT_THREADS];
+  long             noThreads;
+  int              idx;
+  int              first;
+
+  if ((keys == NULL) && (count > 0))
+  {
+    myStatus = API_STATUS_ERR_NO_DATA;
+    count    = 0;
+  }
+  if (count > 0)
+  {
+    ecKeys = calloc(count, sizeof(EC_KEY*));
+    if (kStatus == NULL)
+    {
+      kStatus = calloc(count, sizeof(sca_status_t));
+    }
+    if ((ecKeys == NULL) || (kStatus == NULL))
+    {
+      myStatus = API_STATUS_ERR_INSUF_KEYSTORAGE;
+      count    = 0;
+    }
+  }
+
+  if (count > 0)
+  {
+    // Split the bulk, the calling thread converts the first part itself.
+    noThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (noThreads > count / MIN_KEYS_PER_THREAD)
+    {
+      noThreads = count / MIN_KEYS_PER_THREAD;
+    }
+    if (noThreads > MAX_CONVERT_THREADS)
+    {
+      noThreads = MAX_CONVERT_THREADS;
+    }
+    if (noThreads < 1)
+    {
+      noThreads = 1;
+    }
+    first = 0;
+    for (idx = 0; idx < noThreads; idx++)
+    {
+      jobs[idx].keys      = keys;
+      jobs[idx].ecKeys    = ecKeys;
+      jobs[idx].keyStatus = kStatus;
+      jobs[idx].first     = first;
+      jobs[idx].count     = count / noThreads 
+                            + (idx < count % noThreads ? 1 : 0);
+      first += jobs[idx].count;
+      started[idx] = (idx != 0) 
+                     && (pthread_create(&threads[idx], NULL, _convertKeys, 
+                                        &jobs[idx]) == 0);
+    }
+    for (idx = 0; idx < noThreads; idx++)
+    {
+      if (!started[idx])
+      {
+        // The own part or a thread could not be started.
+        _convertKeys(&jobs[idx]);
+      }
+    }
+    for (idx = 1; idx < noThreads; idx++)
+    {
+      if (started[idx])
+      {
+        pthread_join(threads[idx], NULL);
+      }
+    }
+
+    // Now store the converted keys, the storage is not thread safe.
+    for (idx = 0; idx < count; idx++)
+    {
+      if (ecKeys[idx] != NULL)
+      {
+        ks_storeDecodedKey(BOSSL_pubKeys, keys[idx], ecKeys[idx], source, 
+                           &kStatus[idx]);
+      }
+      myStatus |= kStatus[idx];
+    }
+    sca_debugLog(LOG_DEBUG, "Registered a bulk of %i keys using %li "
+                            "threads.\n", count, noThreads);
+  }
+
+  if (kStatus != keyStatus)
+  {
+    free(kStatus);
+  }
+  free(ecKeys);
+  if (status != NULL)
+  {
+    *status = myStatus;
+  }
+
+  return ((myStatus & API_STATUS_ERROR_MASK) == 0) ? API_SUCCESS 
+                                                   : API_FAILURE;
+}
+
 /**
  * Remove the registered key with the same ski and asn. (Optional)
  * This method allows to remove a particular key that is registered for the
@@ -1202,6 +1380,7 @@ bool isAlgorithmSupported(u_int8_t algoID)
   compAPI.isAlgorithmSupported = isAlgorithmSupported;
 
   compAPI.registerPublicKey    = registerPublicKey;
+  compAPI.registerPublicKeys   = registerPublicKeys;
   compAPI.unregisterPublicKey  = unregisterPublicKey;
 
   compAPI.registerPrivateKey   = registerPrivateKey;
@@ -170,6 +170,41 @@ static EC_KEY* _ks_convertKey(u_int8_t* keyData, u_int16_t keyLength,
   return ec_key;
 }
 
+/**
+ * Convert the DER encoded key into the EC_KEY without storing it. The 
+ * function does not access any storage and can be called by multiple threads
+ * at the same time.
+ * 
+ * @param key The key containing the DER encoded key.
+ * @param isPrivate indicate if the key is private
+ * @param status an OUT value that provides more information.
+ * 
+ * @return The key or NULL. In the later case check status.
+ * 
+ * @since 0.3.0.6
+ */
+EC_KEY* ks_decodeKey(BGPSecKey* key, bool isPrivate, sca_status_t* status)
+{
+  sca_status_t myStatus = API_STATUS_OK;
+  EC_KEY*      ec_key   = NULL;
+
+  if ((key != NULL) && (key->keyData != NULL) && (key->keyLength != 0))
+  {
+    ec_key = _ks_convertKey(key->keyData, key->keyLength, isPrivate, 
+                            &myStatus);
+  }
+  else
+  {
+    myStatus = API_STATUS_ERR_NO_DATA;
+  }
+  if (status != NULL)
+  {
+    *status = myStatus;
+  }
+
+  return ec_key;
+}
+
 /**
  * Retrieve the EC_KEY associated to the given ski and asn. Here the source is
  * ignored.
@@ -300,13 +335,18 @@ static void _ks_freeKey(BGPSecKey* key)
  * Generate a KeyStorage element. All internal memory is allocated using malloc!
  * 
  * @param key The key to be added. Here a copy of the Key will be stored!
+ * @param convert if true then convert the DER key into the EC_KEY
+ * @param isPrivate indicate if the key is private
+ * @param ecKey The already converted EC_KEY or NULL. The element takes over 
+ *              the EC_KEY, it is freed if the element can not be created.
  * @param status The status of the generation.
  *              API_STATUS_ERR_NO_DATA if the conversion would not be performed.
  * 
  * @return a new key storage element or NULL if an error occurred - see status.
  */
 static KS_Key_Element* _ks_createKS_Element(BGPSecKey* key, bool convert,
-                                            bool isPrivate, sca_status_t* status)
+                                            bool isPrivate, EC_KEY* ecKey,
+                                            sca_status_t* status)
 {  
   KS_Key_Element* elem = malloc(sizeof(KS_Key_Element));
   sca_status_t myStatus = API_STATUS_OK;
@@ -334,7 +374,12 @@ static KS_Key_Element* _ks_createKS_Element(BGPSecKey* key, bool convert,
         memset(elem->ec_key, 0, sizeof(EC_KEY*) * elem->noKeys);
         if (elem->ec_key != NULL)
         {
-          if (convert)
+          if (ecKey != NULL)
+          {
+            // The key is converted already.
+            elem->ec_key[0] = ecKey;
+          }
+          else if (convert)
           {
             // Check if the der Key is already loaded and if not, load it!.
             if (elem->derKey[0]->keyData == NULL)
@@ -402,6 +447,11 @@ static KS_Key_Element* _ks_createKS_Element(BGPSecKey* key, bool convert,
     myStatus |= API_STATUS_ERR_INSUF_KEYSTORAGE;
   }
   
+  if ((elem == NULL) && (ecKey != NULL))
+  {
+    EC_KEY_free(ecKey);
+  }
+  
   if (status != NULL)
   {
     *status = myStatus;
@@ -705,11 +755,15 @@ void ks_empty(KeyStorage* storage)
  * @param source The source where the ley came from.
  * @param status an OUT value that provides more information.
  * @param convert if true then convert the DER key into the EC_KEY
+ * @param ecKey The already converted EC_KEY or NULL, see ks_storeDecodedKey.
  * 
  * @return API_SUCESS if it could be stored, otherwise API_FAILED. 
+ * 
+ * @since 0.3.0.6
  */
-int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source, 
-                sca_status_t* status, bool convert)
+static int _ks_storeKey(KeyStorage* storage, BGPSecKey* key, 
+                        sca_key_source_t source, sca_status_t* status, 
+                        bool convert, EC_KEY* ecKey)
 {
   sca_status_t myStatus = API_STATUS_OK;
   int  retVal   = API_SUCCESS;
@@ -750,7 +804,7 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
         // add as last element          
         storage->size++;
         elem->next = _ks_createKS_Element(key, convert, storage->isPrivate, 
-                                          &myStatus);
+                                          ecKey, &myStatus);
         elem->next->prev = elem;
         break;
       }
@@ -759,7 +813,7 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
       {
         // insert before the element
         KS_Key_Element* newElem = _ks_createKS_Element(key, convert, 
-                                                 storage->isPrivate, &myStatus);
+                                          storage->isPrivate, ecKey, &myStatus);
         storage->size++;
         newElem->next = elem;
         newElem->prev = elem->prev;
@@ -795,6 +849,10 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
               // duplicate key
               inserted = true; // stop the for loop
               myStatus |= API_STATUS_INFO_USER1;
+              if (ecKey != NULL)
+              {
+                EC_KEY_free(ecKey);
+              }
             }
           }
         }
@@ -814,14 +872,20 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
             elem->derKey = dk;
             elem->ec_key = ek;
             elem->derKey[elem->noKeys-1] = _ks_clone(key);
-            elem->ec_key[elem->noKeys-1] = _ks_convertKey(key->keyData, 
-                                 key->keyLength, storage->isPrivate, &myStatus);
+            elem->ec_key[elem->noKeys-1] = ecKey != NULL 
+                               ? ecKey
+                               : _ks_convertKey(key->keyData, key->keyLength, 
+                                                storage->isPrivate, &myStatus);
             inserted = true;
           }
           else
           {
             // not enough memory for the ec_key, shrink the key back
             myStatus |= API_STATUS_ERR_INSUF_KEYSTORAGE;
+            if (ecKey != NULL)
+            {
+              EC_KEY_free(ecKey);
+            }
             elem->noKeys--;
             if (dk != NULL)
             {
@@ -846,7 +910,7 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
         else
         {
           elem->next = _ks_createKS_Element(key, convert, storage->isPrivate, 
-                                            &myStatus);
+                                            ecKey, &myStatus);
           if (elem->next != NULL)
           {
             storage->size++;            
@@ -861,7 +925,7 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
   {
     // we have a new head
     storage->head[bucket] = _ks_createKS_Element(key, convert, 
-                                                 storage->isPrivate, &myStatus);
+                                          storage->isPrivate, ecKey, &myStatus);
     if (storage->head[bucket] != NULL)
     {
       storage->size++;      
@@ -878,6 +942,48 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
                                                             : API_SUCCESS;
 }
 
+/**
+ * Store the key in the given KeyStorage.
+ * 
+ * API_STATUS_INFO_USER1: Duplicate Key
+ * 
+ * @param storage The storage where the key is stored in
+ * @param key The BGPSecKey to be stored.
+ * @param source The source where the ley came from.
+ * @param status an OUT value that provides more information.
+ * @param convert if true then convert the DER key into the EC_KEY
+ * 
+ * @return API_SUCESS if it could be stored, otherwise API_FAILED. 
+ */
+int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source, 
+                sca_status_t* status, bool convert)
+{
+  return _ks_storeKey(storage, key, source, status, convert, NULL);
+}
+
+/**
+ * Store the key together with its already converted EC_KEY in the given 
+ * KeyStorage. The storage takes over the EC_KEY, it is freed if the key is 
+ * a duplicate or can not be stored.
+ * 
+ * API_STATUS_INFO_USER1: Duplicate Key
+ * 
+ * @param storage The storage where the key is stored in
+ * @param key The BGPSecKey to be stored.
+ * @param ecKey The EC_KEY of the key, see ks_decodeKey.
+ * @param source The source where the ley came from.
+ * @param status an OUT value that provides more information.
+ * 
+ * @return API_SUCESS if it could be stored, otherwise API_FAILED. 
+ * 
+ * @since 0.3.0.6
+ */
+int ks_storeDecodedKey(KeyStorage* storage, BGPSecKey* key, EC_KEY* ecKey,
+                       sca_key_source_t source, sca_status_t* status)
+{
+  return _ks_storeKey(storage, key, source, status, false, ecKey);
+}
+
 /** 
  * Remove all keys from the given source.
  * 
@@ -159,6 +159,41 @@ void** ks_getKey(KeyStorage* storage, u_int8_t* ski, u_int32_t asn,
 int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
                 sca_status_t* status, bool convert);
 
+/**
+ * Store the key together with its already converted EC_KEY in the given 
+ * KeyStorage. The storage takes over the EC_KEY, it is freed if the key is 
+ * a duplicate or can not be stored.
+ * 
+ * API_STATUS_INFO_USER1: Duplicate Key
+ * 
+ * @param storage The storage where the key is stored in
+ * @param key The BGPSecKey to be stored.
+ * @param ecKey The EC_KEY of the key, see ks_decodeKey.
+ * @param source The source of the key.
+ * @param status an OUT value that provides more information.
+ * 
+ * @return API_SUCESS if it could be stored, otherwise API_FAILED. 
+ * 
+ * @since 0.3.0.6
+ */
+int ks_storeDecodedKey(KeyStorage* storage, BGPSecKey* key, EC_KEY* ecKey,
+                       sca_key_source_t source, sca_status_t* status);
+
+/**
+ * Convert the DER encoded key into the EC_KEY without storing it. The 
+ * function does not access any storage and can be called by multiple threads
+ * at the same time.
+ * 
+ * @param key The key containing the DER encoded key.
+ * @param isPrivate indicate if the key is private
+ * @param status an OUT value that provides more information.
+ * 
+ * @return The key or NULL. In the later case check status.
+ * 
+ * @since 0.3.0.6
+ */
+EC_KEY* ks_decodeKey(BGPSecKey* key, bool isPrivate, sca_status_t* status);
+
 /**
  * Delete the key from the given KeyStorage.
  * 
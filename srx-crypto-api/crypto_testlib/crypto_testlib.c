@@ -352,6 +352,40 @@ u_int8_t registerPublicKey(BGPSecKey* key, sca_key_source_t source,
   return API_FAILURE;  
 }
 
+/**
+ * Register a bulk of public keys. (Optional)
+ * 
+ * @param count The number of keys.
+ * @param keys The keys.
+ * @param source The source of the keys
+ * @param keyStatus The status of each key, can be NULL
+ * @param status The status of the registration
+ * 
+ * @return API_FAILURE for failure (API_STATUS_ERR_USER1)
+ * 
+ * @since 0.3.0.6
+ */
+u_int8_t registerPublicKeys(int count, BGPSecKey** keys, 
+                            sca_key_source_t source, sca_status_t* keyStatus,
+                            sca_status_t* status)
+{
+  int idx;
+
+  // Return an error for missing implementation.
+  sca_debugLog (LOG_DEBUG, "CryptoTestLib: Called 'registerPublicKeys'\n");
+  
+  for (idx = 0; (keyStatus != NULL) && (idx < count); idx++)
+  {
+    keyStatus[idx] = API_STATUS_ERR_USER1;
+  }
+  if (status != NULL)
+  {
+    *status = API_STATUS_ERR_USER1;
+  }
+  
+  return API_FAILURE;  
+}
+
 /**
  * Remove the registered key with the same ski and asn. (Optional)
  * This method allows to remove a particular key that is registered for the 
@@ -630,6 +664,7 @@ __attribute__((unused)) static void comptest()
   compAPI.isAlgorithmSupported = isAlgorithmSupported;
 
   compAPI.registerPublicKey    = registerPublicKey;
+  compAPI.registerPublicKeys   = registerPublicKeys;
   compAPI.unregisterPublicKey  = unregisterPublicKey;
 
   compAPI.registerPrivateKey   = registerPrivateKey;
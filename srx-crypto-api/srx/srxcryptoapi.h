@@ -684,6 +684,27 @@ typedef struct
   u_int8_t (*registerPublicKey)(BGPSecKey* key, sca_key_source_t source,
                                 sca_status_t* status);
 
+  /**
+   * Register a bulk of public keys, e.g. all keys received from a validation
+   * cache until its End of Data. Each key is registered as it would be with
+   * registerPublicKey. The plugin can use this to prepare the keys for the
+   * validation in parallel instead of one by one.
+   *
+   * @param count The number of keys.
+   * @param keys The keys - each MUST contain the DER encoded key.
+   * @param source The source of the keys.
+   * @param keyStatus (out) Will contain the status of each key, can be NULL.
+   * @param status Will contain the combined status information of this call.
+   *
+   * @return API_SUCCESS if all keys are registered or API_FAILURE (check 
+   *         status and keyStatus)
+   *
+   * @since 0.3.0.6
+   */
+  u_int8_t (*registerPublicKeys)(int count, BGPSecKey** keys, 
+                                 sca_key_source_t source, 
+                                 sca_status_t* keyStatus, sca_status_t* status);
+
   /**
    * Remove the registered key with the same ski and asn. (Optional)
    * This method allows to remove a particular key that is registered for the
@@ -157,6 +157,7 @@
 #define SCA_UNREGISTER_PRIVATE_KEY "method_unregisterPrivateKey"
 
 #define SCA_REGISTER_PUBLIC_KEY    "method_registerPublicKey"
+#define SCA_REGISTER_PUBLIC_KEYS   "method_registerPublicKeys"
 #define SCA_UNREGISTER_PUBLIC_KEY  "method_unregisterPublicKey"
 
 #define SCA_CLEAN_KEYS             "method_cleanKeys"
@@ -182,6 +183,7 @@
 #define SCA_DEF_UNREGISTER_PRIVATE_KEY "unregisterPrivateKey"
 
 #define SCA_DEF_REGISTER_PUBLIC_KEY    "registerPublicKey"
+#define SCA_DEF_REGISTER_PUBLIC_KEYS   "registerPublicKeys"
 #define SCA_DEF_UNREGISTER_PUBLIC_KEY  "unregisterPublicKey"
 
 #define SCA_DEF_CLEAN_KEYS             "cleanKeys"
@@ -216,6 +218,7 @@ typedef struct {
   const char* str_method_unregisterPrivateKey;
   
   const char* str_method_registerPublicKey;
+  const char* str_method_registerPublicKeys;
   const char* str_method_unregisterPublicKey;
   
   const char* str_method_cleanKeys;
@@ -516,6 +519,64 @@ u_int8_t wrap_registerPublicKey(BGPSecKey* key, sca_key_source_t source,
   return API_FAILURE;
 }
 
+/** The registration used by wrap_registerPublicKeys for each key. 
+ * @since 0.3.0.6 */
+static u_int8_t (*_registerPublicKey)(BGPSecKey* key, sca_key_source_t source,
+                                      sca_status_t* status) 
+                = wrap_registerPublicKey;
+
+/**
+ * Register the public keys one by one using the registerPublicKey method of
+ * the plugin. This wrapper is used if the plugin does not provide a bulk
+ * registration.
+ *
+ * @param count The number of keys.
+ * @param keys The keys to be stored.
+ * @param source The source of the keys.
+ * @param keyStatus (out) Will contain the status of each key, can be NULL.
+ * @param status Will contain the combined status information of this call.
+ *
+ * @return API_SUCCESS if all keys are registered or API_FAILURE (check status)
+ *
+ * @since 0.3.0.6
+ */
+u_int8_t wrap_registerPublicKeys(int count, BGPSecKey** keys, 
+                                 sca_key_source_t source, 
+                                 sca_status_t* keyStatus, sca_status_t* status)
+{
+  sca_status_t myStatus  = API_STATUS_OK;
+  sca_status_t oneStatus;
+  u_int8_t     retVal    = API_SUCCESS;
+  int          idx;
+
+  sca_debugLog (LOG_DEBUG, "Called local test wrapper 'registerPublicKeys'\n");
+  if ((keys == NULL) && (count > 0))
+  {
+    myStatus = API_STATUS_ERR_NO_DATA;
+    retVal   = API_FAILURE;
+    count    = 0;
+  }
+  for (idx = 0; idx < count; idx++)
+  {
+    oneStatus = API_STATUS_OK;
+    if (_registerPublicKey(keys[idx], source, &oneStatus) != API_SUCCESS)
+    {
+      retVal = API_FAILURE;
+    }
+    myStatus |= oneStatus;
+    if (keyStatus != NULL)
+    {
+      keyStatus[idx] = oneStatus;
+    }
+  }
+  if (status != NULL)
+  {
+    *status = myStatus;
+  }
+
+  return retVal;
+}
+
 /**
  * Unregister the Private key. This method actually does not unregister
  * the private key. The return value is API_FAILURE.
@@ -788,6 +849,8 @@ static void _loadMapping(config_setting_t *set, SCA_Mappings* mappings)
 
   __readMapping(set, SCA_REGISTER_PUBLIC_KEY,
                      &mappings->str_method_registerPublicKey);
+  __readMapping(set, SCA_REGISTER_PUBLIC_KEYS,
+                     &mappings->str_method_registerPublicKeys);
   __readMapping(set, SCA_UNREGISTER_PUBLIC_KEY,
                      &mappings->str_method_unregisterPublicKey);
   
@@ -929,6 +992,11 @@ static int _mapAPI(SCA_Mappings* mappings, SRxCryptoAPI* api)
     __doMapFunction(api->libHandle, (void**)&api->registerPublicKey,
                     mappings->str_method_registerPublicKey,
                     SCA_DEF_REGISTER_PUBLIC_KEY);
+    __doMapFunction(api->libHandle, (void**)&api->registerPublicKeys,
+                    mappings->str_method_registerPublicKeys,
+                    SCA_DEF_REGISTER_PUBLIC_KEYS);
+    // The wrapper of registerPublicKeys uses the mapped single registration.
+    _registerPublicKey = api->registerPublicKey;
     __doMapFunction(api->libHandle, (void**)&api->unregisterPublicKey,
                     mappings->str_method_unregisterPublicKey,
                     SCA_DEF_UNREGISTER_PUBLIC_KEY);
@@ -1022,7 +1090,9 @@ int srxCryptoInit(SRxCryptoAPI* api, sca_status_t* status)
   api->validate             = wrap_validate;
 
   api->registerPublicKey    = wrap_registerPublicKey;
+  api->registerPublicKeys   = wrap_registerPublicKeys;
   api->unregisterPublicKey  = wrap_unregisterPublicKey;
+  _registerPublicKey        = wrap_registerPublicKey;
 
   api->registerPrivateKey   = wrap_registerPrivateKey;
   api->unregisterPrivateKey = wrap_unregisterPrivateKey;
@@ -1189,6 +1259,7 @@ int srxCryptoUnbind(SRxCryptoAPI* api, sca_status_t* status)
 
     // NULL the complete API
     memset (api, 0, sizeof(SRxCryptoAPI));
+    _registerPublicKey = wrap_registerPublicKey;
   }
   else
   {
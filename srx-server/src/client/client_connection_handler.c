@@ -65,10 +65,14 @@
  * -----------------------------------------------------------------------------
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <signal.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <netinet/tcp.h>
+#include <sys/socket.h>
 #include "client/client_connection_handler.h"
 #include "shared/srx_packets.h"
 #include "util/client_socket.h"
@@ -76,8 +80,13 @@
 #include "util/mutex.h"
 #include "util/socket.h"
 
-/** Seconds between reconnect attempts */
-#define RECONNECT_DELAY 2
+/** Milliseconds to wait after all servers failed the first time. The wait
+ * doubles each time up to RECONNECT_MAX_DELAY_MS */
+#define RECONNECT_MIN_DELAY_MS 500
+/** Maximum milliseconds to wait between reconnect attempts */
+#define RECONNECT_MAX_DELAY_MS 30000
+/** Milliseconds a non blocking connect may take */
+#define CONNECT_TIMEOUT_MS     5000
 
 /** THis value is used to prevent a deadlock during initialization and data
  * receiving. The data receiving waits in 1 seconds intervals until the client
@@ -86,7 +95,7 @@
  */
 #define DEADLOCK_INDICATOR 30
 
-/** Maximum attempts to connect to server during a connection request */
+/** Maximum times reconnectSRX tries all servers before it gives up */
 #define MAX_RECONNECT_ATTEMPT 2
 
 /** Max. entries in the send queue */
@@ -139,6 +148,22 @@ ClientConnectionHandler* createClientConnectionHandler(SRxProxy* proxy)
     self->clSock.oldFD = -1;
     self->clSock.reconnect = false;
     self->clSock.canBeClosed = true;
+    self->clSock.shm = NULL;
+    self->clSock.shmActive = false;
+    self->shmRingSize = 0;
+    self->serverSyncs = false;
+    self->flowWindow  = 0;
+    self->flowControl = false;
+    self->credits     = 0;
+
+    initSList(&self->servers);
+    self->serverIdx    = 0;
+    self->reconnecting = false;
+    self->reconnState  = SRX_RECONNECT_DONE;
+    self->reconnDelay  = RECONNECT_MIN_DELAY_MS;
+    self->reconnRounds = 0;
+    self->reconnTime   = 0;
+    self->reconnSeed   = (unsigned int)time(NULL) ^ (unsigned int)getpid();
     
     self->srxProxy = proxy;
   }
@@ -175,6 +200,8 @@ bool initializeClientConnectionHandler(ClientConnectionHandler* self,
   char* errPrefix = "[ClientConnectionHandler]";
   int iSemState =0;
   pthread_attr_t attr;
+  SRxServerAddr* server = NULL;
+  bool connected = false;
 
   pthread_attr_init(&attr);
   pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
@@ -186,11 +213,34 @@ bool initializeClientConnectionHandler(ClientConnectionHandler* self,
     return false;
   }
 
+  // The given server is the first one of the failover list.
+  server = insertIntoSList(&self->servers, 0, sizeof(SRxServerAddr));
+  if (server == NULL)
+  {
+    RAISE_ERROR("%s Not enough memory for the server list!", errPrefix);
+    return false;
+  }
+  snprintf(server->host, SRX_SERVER_HOST_LENGTH, "%s", host);
+  server->port = port;
+
   // Initialize the client socket - This also creates it. By default the socket
-  // can be closed.
-  if (!createClientSocket(&self->clSock, host, port, true,
-                          SRX_PROXY_CLIENT_SOCKET, true))
+  // can be closed. The servers are tried in order.
+  self->serverIdx = 0;
+  while (!connected && (self->serverIdx < sizeOfSList(&self->servers)))
+  {
+    server = getFromSList(&self->servers, self->serverIdx);
+    connected = createClientSocket(&self->clSock, server->host, server->port,
+                                   true, SRX_PROXY_CLIENT_SOCKET, true);
+    if (!connected)
+    {
+      self->serverIdx++;
+    }
+  }
+  if (!connected)
   {
+    server = getFromSList(&self->servers, 0);
+    deleteFromSList(&self->servers, server);
+    free(server);
     RAISE_ERROR("%s Could not create and initialize the client socket.!",
                 errPrefix);
     return false;
@@ -204,6 +254,7 @@ bool initializeClientConnectionHandler(ClientConnectionHandler* self,
   }
 
   initSList(&self->sendQueue);
+  initSList(&self->creditQueue);
 
   // Set misc. variables
   self->packetHandler     = packetHandler;
@@ -289,6 +340,7 @@ void releaseClientConnectionHandler(ClientConnectionHandler* self)
       // Deallocate the send queue and lock
       acquireWriteLock(&self->queueLock);
       releaseSList(&self->sendQueue);
+      releaseSList(&self->creditQueue);
       releaseRWLock(&self->queueLock);
 
       // Deallocate The packet receive monitor
@@ -413,15 +465,15 @@ inline bool connHandlerUnlock(ClientConnectionHandler* self)
 bool sendPacketToServer(ClientConnectionHandler* self, void* data,
                         uint32_t length)
 {
-  if (isConnectedToServer(&self->clSock))
+  if (isConnectedToServer(&self->clSock) && !self->reconnecting)
   {
     // This can contain more than one packet depending on the length and content
     // of the header.
     return sendData(&self->clSock, data, length);
     // Not online - store a copy and send later
   }
-  else if (self->established) // Application layer connected.
-  {
+  else if (self->established || self->reconnecting) // Application layer 
+  {                                                 // connected or reconnecting
     void* dataCopy;
 
     // Check if the queue is not already full
@@ -452,6 +504,113 @@ bool sendPacketToServer(ClientConnectionHandler* self, void* data,
   return true;
 }
 
+/**
+ * Send the verify requests held as long as credits are available. Without 
+ * flow control all held requests are sent. The queue lock MUST be held.
+ *
+ * @param self Instance that should be used
+ *
+ * @return the number of requests sent.
+ *
+ * @since 0.6.3.0
+ */
+static int _sendHeldRequests(ClientConnectionHandler* self)
+{
+  SListNode* node = NULL;
+  int        sent = 0;
+
+  while (   ((node = getRootNodeOfSList(&self->creditQueue)) != NULL)
+         && (!self->flowControl || (self->credits > 0))
+         && isConnectedToServer(&self->clSock) && !self->reconnecting)
+  {
+    if (!sendData(&self->clSock, node->data, (uint32_t)node->allocSize))
+    {
+      break;
+    }
+    if (self->flowControl)
+    {
+      self->credits--;
+    }
+    free(shiftFromSList(&self->creditQueue));
+    sent++;
+  }
+
+  return sent;
+}
+
+/**
+ * Sends a verify request to the server. If the server granted the flow
+ * control the request is only sent with a credit, otherwise it is held until
+ * the server returns credits. Without flow control this is sendPacketToServer.
+ *
+ * @param self Instance that should be used
+ * @param data The verify request PDU.
+ * @param length The length of the PDU.
+ *
+ * @return true = data sent or held, false = sending failed
+ *
+ * @since 0.6.3.0
+ */
+bool sendVerifyRequest(ClientConnectionHandler* self, void* data,
+                       uint32_t length)
+{
+  bool  retVal   = true;
+  void* dataCopy = NULL;
+
+  if (!self->flowControl || !(self->established || self->reconnecting))
+  {
+    return sendPacketToServer(self, data, length);
+  }
+
+  acquireWriteLock(&self->queueLock);
+  // Keep the order, requests held before go first.
+  if (   (self->credits > 0) && (sizeOfSList(&self->creditQueue) == 0)
+      && isConnectedToServer(&self->clSock) && !self->reconnecting)
+  {
+    retVal = sendData(&self->clSock, data, length);
+    if (retVal)
+    {
+      self->credits--;
+    }
+  }
+  else if (sizeOfSList(&self->creditQueue) < MAX_SEND_QUEUE)
+  {
+    dataCopy = appendToSList(&self->creditQueue, (size_t)length);
+    if (dataCopy != NULL)
+    {
+      memcpy(dataCopy, data, length);
+    }
+    retVal = dataCopy != NULL;
+  }
+  else
+  {
+    retVal = false;
+  }
+  unlockWriteLock(&self->queueLock);
+
+  return retVal;
+}
+
+/**
+ * Add the credits returned by the server and send the verify requests held 
+ * as long as credits are available.
+ *
+ * @param self Instance that should be used
+ * @param credits The credits returned by the server.
+ *
+ * @since 0.6.3.0
+ */
+void addCredits(ClientConnectionHandler* self, uint32_t credits)
+{
+  acquireWriteLock(&self->queueLock);
+  if (self->flowControl)
+  {
+    self->credits += credits;
+    _sendHeldRequests(self);
+  }
+  unlockWriteLock(&self->queueLock);
+}
+
 /**
  * Handler to catch the timeout alarm for handshake.
  * 
@@ -466,6 +625,60 @@ void _catch_handshakeTimeout(int sig)
   *_handshakeSocket = -1;
 }
 
+/**
+ * Create the shared memory channel to be offered to the server. The channel is
+ * only created if requested and the server runs on the same host.
+ *
+ * @param self The client connection handler
+ *
+ * @return true if the channel is created.
+ *
+ * @since 0.6.3.0
+ */
+static bool _createShmOffer(ClientConnectionHandler* self)
+{
+  struct sockaddr_in localAddr, peerAddr;
+  socklen_t addrLen = sizeof(struct sockaddr_in);
+  char name[SRX_SHM_NAME_LENGTH];
+  ShmChannel* shm = NULL;
+
+  // A channel of a previous handshake is not used anymore.
+  releaseClientSocketShm(&self->clSock);
+  if (self->shmRingSize == 0)
+  {
+    return false;
+  }
+
+  // The server only can map the channel if it runs on the same host.
+  if (   (getsockname(self->clSock.clientFD, (struct sockaddr*)&localAddr, 
+                      &addrLen) != 0)
+      || (getpeername(self->clSock.clientFD, (struct sockaddr*)&peerAddr, 
+                      &addrLen) != 0)
+      || (localAddr.sin_addr.s_addr != peerAddr.sin_addr.s_addr))
+  {
+    LOG(LEVEL_INFO, "SRx server is not on the same host, do not offer the "
+                    "shared memory transport.");
+    return false;
+  }
+
+  snprintf(name, SRX_SHM_NAME_LENGTH, "/srx-proxy-%u-%u", (uint32_t)getpid(),
+           self->srxProxy->proxyID);
+  shm = malloc(sizeof(ShmChannel));
+  if (shm != NULL)
+  {
+    if (createShmChannel(shm, name, self->shmRingSize))
+    {
+      self->clSock.shm = shm;
+    }
+    else
+    {
+      free(shm);
+    }
+  }
+
+  return self->clSock.shm != NULL;
+}
+
 /*
  * Create the connection of application layer between srx and proxy. This method
  * uses active waiting (1 sec. at a time) for max 30 seconds
@@ -477,9 +690,40 @@ void _catch_handshakeTimeout(int sig)
  */
 bool handshakeWithServer(ClientConnectionHandler* self, SRXPROXY_HELLO* pdu)
 {  
+  uint32_t length = ntohl(pdu->length);
+  // The hello packet followed by the shared memory offer if one is made.
+  uint8_t  offerPDU[length + sizeof(SRXPROXY_SHM_OFFER)];
+
+  // Request the flow control of the verify requests.
+  if (self->flowWindow > 0)
+  {
+    pdu->reserved8 |= SRX_PROXY_FLAG_CREDIT;
+    pdu->window     = htonl(self->flowWindow);
+  }
+  else
+  {
+    pdu->reserved8 &= ~SRX_PROXY_FLAG_CREDIT;
+    pdu->window     = 0;
+  }
+
+  if (_createShmOffer(self))
+  {
+    SRXPROXY_SHM_OFFER* offer = (SRXPROXY_SHM_OFFER*)(offerPDU + length);
+    memcpy(offerPDU, pdu, length);
+    memset(offer, 0, sizeof(SRXPROXY_SHM_OFFER));
+    offer->ringSize = htonl(self->clSock.shm->ringSize);
+    snprintf(offer->name, SRX_SHM_NAME_LENGTH, "%s", self->clSock.shm->name);
+    length += sizeof(SRXPROXY_SHM_OFFER);
+
+    pdu = (SRXPROXY_HELLO*)offerPDU;
+    pdu->reserved8 |= SRX_PROXY_FLAG_SHM;
+    pdu->length     = htonl(length);
+  }
+
   // Send 'HELLO' to the server
-  if (!sendData(&self->clSock, (void*)pdu, ntohl(pdu->length)))
+  if (!sendData(&self->clSock, (void*)pdu, length))
   {
+    releaseClientSocketShm(&self->clSock);
     return false;
   }
 
@@ -536,6 +780,18 @@ bool handshakeWithServer(ClientConnectionHandler* self, SRXPROXY_HELLO* pdu)
     _handshakeAlarm=0;
     _handshakeSocket=NULL;
   }
+
+  if (self->clSock.shm != NULL)
+  {
+    // The server mapped the channel already or it never will.
+    unlinkShmChannel(self->clSock.shm);
+    if (!self->clSock.shmActive)
+    {
+      LOG(LEVEL_INFO, "SRx server did not accept the shared memory transport,"
+                      " continue using TCP.");
+      releaseClientSocketShm(&self->clSock);
+    }
+  }
   
   if (!self->established)
   {
@@ -738,105 +994,413 @@ void ImpleGoStreamThread (SRxProxy* proxy, uint32_t proxyID)
 ////////////////////////////////////////////////////////////////////////////////
 
 /**
- * This method allows to re-establish a connection between proxy and srx-server
- * this method will close an existing connection to the srx server on the
- * application layer sending a GoodBye message and if the socket is not
- * maintained externally it closes the socket. In case the socket is managed
- * outside the socket will not be closed but a new one will be installed.
- * The reconnect will result in a handshake. The new socket will have the
- * same features as the old one. A ClientConnectionHandler can only be restarted
- * if it was not stopped.
+ * Return the current time of the monotonic clock.
+ *
+ * @return the time in milliseconds.
+ *
+ * @since 0.6.3.0
+ */
+static uint64_t _getTimeMs()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Close the socket created during the reconnect. The reconnect creates its
+ * own sockets, therefore they are closed regardless of the external socket
+ * control.
  *
  * @param self The ClientConnection handler.
  *
- * @return true if the reconnect was successful, otherwise false.
+ * @since 0.6.3.0
  */
-bool reconnectSRX(ClientConnectionHandler* self)
+static void _closeReconnectSocket(ClientConnectionHandler* self)
 {
-  bool retVal = false;
-  SRxProxy* proxy = (SRxProxy*)self->srxProxy;
+  if (self->clSock.clientFD != -1)
+  {
+    close(self->clSock.clientFD);
+  }
+  self->clSock.clientFD = -1;
+  self->clSock.oldFD    = -1;
+  releaseClientSocketShm(&self->clSock);
+}
 
-  LOG (LEVEL_INFO, "([0x%08X]) > Client Connection Handler Thread started!",
-                     pthread_self());
-  
-  if (self->initialized && !self->stop)
+/**
+ * Build the hello packet and perform the handshake with the server the client
+ * socket is connected to.
+ *
+ * @param self The ClientConnection handler.
+ *
+ * @return true if the handshake was successful.
+ *
+ * @since 0.6.3.0
+ */
+static bool _sendHello(ClientConnectionHandler* self)
+{
+  SRxProxy* proxy     = (SRxProxy*)self->srxProxy;
+  uint32_t noPeers    = proxy->peerAS.size;
+  uint32_t length     = sizeof(SRXPROXY_HELLO) + (noPeers * 4);
+  uint8_t  pdu[length];
+  SRXPROXY_HELLO* hdr = (SRXPROXY_HELLO*)pdu;
+  uint32_t peerASN    = 0;
+  uint32_t* peerAS    = NULL;
+
+  memset(pdu, 0, length);
+
+  hdr->type            = PDU_SRXPROXY_HELLO;
+  hdr->version         = htons(SRX_PROTOCOL_VER);
+  hdr->length          = htonl(length);
+  hdr->proxyIdentifier = htonl(proxy->proxyID);
+  hdr->asn             = htonl(proxy->proxyAS);
+  hdr->noPeers         = htonl(noPeers);
+
+  peerAS = (uint32_t*)&hdr->peerAS;
+  SListNode* node = getRootNodeOfSList(&proxy->peerAS);
+
+  while (!(node == NULL))
   {
-    // Check if the client socket was miss used
-    if (self->clSock.oldFD != -1 && self->clSock.clientFD == -1)
-    {
-      self->clSock.clientFD = self->clSock.oldFD;
-    }
-    // Check if still connected
-    if (self->clSock.clientFD != -1)
+    peerASN = *((uint32_t*)node->data);
+    *peerAS = htonl(peerASN);
+    peerAS++;
+    node = node->next;
+  }
+
+  return handshakeWithServer(self, hdr);
+}
+
+/**
+ * Resynchronize the server after the reconnect. If the user installed a
+ * synchronization handler it is called unless the server requests the 
+ * synchronization itself. The synchronization sends all updates again,
+ * therefore the requests queued during the reconnect are dropped. Without
+ * synchronization handler the queued requests are sent.
+ *
+ * @param self The ClientConnection handler.
+ *
+ * @since 0.6.3.0
+ */
+static void _resynchronize(ClientConnectionHandler* self)
+{
+  SRxProxy*  proxy = (SRxProxy*)self->srxProxy;
+  bool       sync  = proxy->syncNotification != NULL;
+  SListNode* node;
+  int        sent  = 0;
+
+  acquireWriteLock(&self->queueLock);
+  self->reconnecting = false;
+  if (sync)
+  {
+    LOG(LEVEL_INFO, "Drop %d queued requests, the synchronization sends them "
+                    "again.", sizeOfSList(&self->sendQueue)
+                              + sizeOfSList(&self->creditQueue));
+    emptySList(&self->sendQueue);
+    emptySList(&self->creditQueue);
+  }
+  else
+  {
+    FOREACH_SLIST(&self->sendQueue, node)
     {
-      // Disconnect on application layer
-      sendGoodbye(self, self->keepWindow);
-      if (proxy->externalSocketControl)
+      if (!sendData(&self->clSock, node->data, (uint32_t)node->allocSize))
       {
-        self->clSock.clientFD = -1;
-        self->clSock.oldFD = -1;
+        break;
       }
+      sent++;
     }
-    // Try to reconnect - on TCP layer only
-    if (!reconnectToServer(&self->clSock, RECONNECT_DELAY,
-                                          MAX_RECONNECT_ATTEMPT))
+    LOG(LEVEL_INFO, "Sent %d of %d queued requests.", sent, 
+                    sizeOfSList(&self->sendQueue));
+    while (sent-- > 0)
     {
-      return false;
+      free(shiftFromSList(&self->sendQueue));
     }
+    // The requests held for credits follow within the new window.
+    _sendHeldRequests(self);
+  }
+  unlockWriteLock(&self->queueLock);
 
-    // Reconnect on application layer
-    LOG (LEVEL_INFO, " Transport-layer reconnect done, now initiate HELLO "
-                      "handshake", pthread_self());
-    //LOG(LEVEL_INFO, "Establish connection with proxy [%u]...", proxy->proxyID);
-    SRxProxy* proxy =        (SRxProxy*)self->srxProxy;
-    uint32_t noPeers    = proxy->peerAS.size;
-    uint32_t length     = 20 + (noPeers * 4);
-    uint8_t  pdu[length];
-    SRXPROXY_HELLO* hdr = (SRXPROXY_HELLO*)pdu;
-    uint32_t peerASN    = 0;
-    uint32_t* peerAS    = NULL;
-
-    memset(pdu, 0, length);
-
-    hdr->type            = PDU_SRXPROXY_HELLO;
-    hdr->version         = htons(SRX_PROTOCOL_VER);
-    hdr->length          = htonl(length);
-    hdr->proxyIdentifier = htonl(proxy->proxyID);
-    hdr->asn             = htonl(proxy->proxyAS);
-    hdr->noPeers         = htonl(noPeers);
-
-    peerAS = (uint32_t*)&hdr->peerAS;
-    SListNode* node = getRootNodeOfSList(&proxy->peerAS);
-
-    while (!(node == NULL))
-    {
-      peerASN = *((uint32_t*)node->data);
-      *peerAS = htonl(peerASN);
-      peerAS++;
-      node = node->next;
-    }
+  if (sync && !self->serverSyncs)
+  {
+    proxy->syncNotification(proxy->userPtr);
+  }
+}
 
-    if (handshakeWithServer(self, hdr))
+/**
+ * Perform the handshake on the connection established during the reconnect
+ * and resynchronize the server.
+ *
+ * @param self The ClientConnection handler.
+ *
+ * @return true if the proxy is connected again.
+ *
+ * @since 0.6.3.0
+ */
+static bool _completeReconnect(ClientConnectionHandler* self)
+{
+  SRxProxy*      proxy  = (SRxProxy*)self->srxProxy;
+  SRxServerAddr* server = getFromSList(&self->servers, self->serverIdx);
+  int            flags;
+
+  // Reconnect on application layer
+  LOG (LEVEL_INFO, "Transport-layer reconnect to %s:%u done, now initiate "
+                   "HELLO handshake", server->host, server->port);
+  self->serverSyncs = false;
+  if (!_sendHello(self))
+  {
+    // A handshake timeout closes the socket.
+    if (self->clSock.clientFD == -1)
     {
-      // established is set in srx_api.c::processHelloResponse 
-      LOG(LEVEL_INFO, "Connection with proxy [%u] established!",proxy->proxyID);
+      self->clSock.oldFD = -1;
     }
-    else
+    LOG(LEVEL_WARNING, "Handshake with server %s:%u failed!", server->host, 
+                       server->port);
+    return false;
+  }
+
+  if (proxy->externalSocketControl)
+  {
+    // The socket is non blocking and closed by the user again.
+    flags = fcntl(self->clSock.clientFD, F_GETFL, 0);
+    fcntl(self->clSock.clientFD, F_SETFL, flags | O_NONBLOCK);
+    self->clSock.canBeClosed = false;
+  }
+
+  _resynchronize(self);
+  self->reconnDelay  = RECONNECT_MIN_DELAY_MS;
+  self->reconnRounds = 0;
+  // established is set in srx_api.c::processHelloResponse 
+  LOG(LEVEL_INFO, "Connection with proxy [%u] established with %s:%u!",
+                  proxy->proxyID, server->host, server->port);
+
+  return true;
+}
+
+/**
+ * Try the servers of the failover list starting at serverIdx until a connect
+ * is in progress or the proxy is connected. Once all servers failed the next
+ * attempt is scheduled with a jittered exponential backoff.
+ *
+ * @param self The ClientConnection handler.
+ * @param now The current time in milliseconds.
+ *
+ * @return the state of the reconnect.
+ *
+ * @since 0.6.3.0
+ */
+static SRxReconnectState _connectServers(ClientConnectionHandler* self,
+                                         uint64_t now)
+{
+  SRxServerAddr* server;
+  uint32_t       wait;
+
+  while (self->serverIdx < sizeOfSList(&self->servers))
+  {
+    server = getFromSList(&self->servers, self->serverIdx);
+    LOG(LEVEL_DEBUG, HDR "Reconnect to SRx server %s:%u", pthread_self(), 
+                     server->host, server->port);
+    if (setClientSocketServer(&self->clSock, server->host, server->port))
     {
-      if (!self->stop) // No Goodbye received
+      switch (startConnectToServer(&self->clSock))
       {
-        RAISE_ERROR("Handshake with server failed but connection handler is "
-                    "not stopped!");
-        //releaseClientConnectionHandler(self);
-        //--> need to be something different, because it is really bad idea to pthread_cancel inside same thread.
+        case CLIENT_CONNECT_DONE:
+          if (_completeReconnect(self))
+          {
+            return SRX_RECONNECT_DONE;
+          }
+          if (self->stop) // Goodbye received
+          {
+            return SRX_RECONNECT_STOPPED;
+          }
+          break;
+        case CLIENT_CONNECT_PENDING:
+          self->reconnTime = now + CONNECT_TIMEOUT_MS;
+          return SRX_RECONNECT_CONNECTING;
+        default:
+          break;
       }
-      LOG(LEVEL_WARNING, "Handshake with server failed!");
-      return false;
     }
+    self->serverIdx++;
+  }
+
+  // All servers failed, wait between half and the full delay.
+  _closeReconnectSocket(self);
+  wait = self->reconnDelay / 2 
+         + rand_r(&self->reconnSeed) % (self->reconnDelay / 2 + 1);
+  self->reconnTime   = now + wait;
+  self->reconnDelay  = (self->reconnDelay < RECONNECT_MAX_DELAY_MS / 2)
+                       ? self->reconnDelay * 2 : RECONNECT_MAX_DELAY_MS;
+  self->reconnRounds++;
+  self->serverIdx    = 0;
+  LOG(LEVEL_INFO, "No SRx server reachable, next attempt in %u ms.", wait);
+
+  return SRX_RECONNECT_WAITING;
+}
 
-    return true;
+/**
+ * Drive the reconnect with the SRx servers without blocking. The first call
+ * starts the reconnect, the following ones continue it once the returned
+ * socket is writable or the timeout expired. Once connected on the transport
+ * layer the handshake is performed and the data resynchronized.
+ *
+ * @param self The ClientConnection handler.
+ * @param fd (out) The socket to wait for until it is writable or -1.
+ * @param timeout (out) The milliseconds until the next call or -1.
+ *
+ * @return the state of the reconnect.
+ *
+ * @since 0.6.3.0
+ */
+SRxReconnectState processReconnectSRX(ClientConnectionHandler* self, int* fd,
+                                      int* timeout)
+{
+  SRxProxy*         proxy = (SRxProxy*)self->srxProxy;
+  SRxReconnectState state = self->reconnState;
+  uint64_t          now   = _getTimeMs();
+
+  *fd      = -1;
+  *timeout = -1;
+  if (!self->initialized || self->stop)
+  {
+    self->reconnecting = false;
+    return SRX_RECONNECT_STOPPED;
   }
 
-  return retVal;
+  if (!self->reconnecting)
+  {
+    // Disconnect on application layer if still connected
+    if (self->clSock.clientFD != -1)
+    {
+      sendGoodbye(self, self->keepWindow);
+    }
+    // An externally controlled socket is closed by its owner.
+    if (proxy->externalSocketControl)
+    {
+      self->clSock.clientFD = -1;
+      self->clSock.oldFD    = -1;
+    }
+    self->clSock.canBeClosed = true;
+    self->clSock.reconnect   = true;
+    self->established  = false;
+    self->reconnecting = true;
+    self->reconnDelay  = RECONNECT_MIN_DELAY_MS;
+    self->reconnRounds = 0;
+    self->serverIdx    = 0;
+    state = _connectServers(self, now);
+  }
+  else if (state == SRX_RECONNECT_CONNECTING)
+  {
+    switch (finishConnectToServer(&self->clSock))
+    {
+      case CLIENT_CONNECT_DONE:
+        if (_completeReconnect(self))
+        {
+          state = SRX_RECONNECT_DONE;
+          break;
+        }
+        if (self->stop) // Goodbye received
+        {
+          state = SRX_RECONNECT_STOPPED;
+          break;
+        }
+        self->serverIdx++;
+        state = _connectServers(self, now);
+        break;
+      case CLIENT_CONNECT_PENDING:
+        if (now < self->reconnTime)
+        {
+          break;
+        }
+        LOG(LEVEL_INFO, "Connect to the SRx server timed out.");
+        _closeReconnectSocket(self);
+        self->serverIdx++;
+        state = _connectServers(self, now);
+        break;
+      default:
+        self->serverIdx++;
+        state = _connectServers(self, now);
+    }
+  }
+  else if ((state == SRX_RECONNECT_WAITING) && (now >= self->reconnTime))
+  {
+    state = _connectServers(self, now);
+  }
+
+  self->reconnState = state;
+  switch (state)
+  {
+    case SRX_RECONNECT_CONNECTING:
+      *fd = self->clSock.clientFD;
+      // fall through - the connect attempt is limited by the timeout as well
+    case SRX_RECONNECT_WAITING:
+      now = _getTimeMs();
+      *timeout = self->reconnTime > now ? (int)(self->reconnTime - now) : 0;
+      break;
+    default:
+      self->reconnecting = false;
+  }
+
+  return state;
 }
 
+/**
+ * This method allows to re-establish a connection between proxy and srx-server
+ * this method will close an existing connection to the srx server on the
+ * application layer sending a GoodBye message and if the socket is not
+ * maintained externally it closes the socket. In case the socket is managed
+ * outside the socket will not be closed but a new one will be installed.
+ * The reconnect will result in a handshake. The new socket will have the
+ * same features as the old one. A ClientConnectionHandler can only be restarted
+ * if it was not stopped. The servers of the failover list are tried 
+ * MAX_RECONNECT_ATTEMPT times.
+ *
+ * @param self The ClientConnection handler.
+ *
+ * @return true if the reconnect was successful, otherwise false.
+ */
+bool reconnectSRX(ClientConnectionHandler* self)
+{
+  SRxReconnectState state;
+  struct pollfd     pfd;
+  int               fd;
+  int               timeout;
+
+  if (!self->initialized || self->stop)
+  {
+    return false;
+  }
+
+  // Check if the client socket was miss used
+  if (self->clSock.oldFD != -1 && self->clSock.clientFD == -1)
+  {
+    self->clSock.clientFD = self->clSock.oldFD;
+  }
+
+  // A reconnect in progress starts over.
+  if (self->reconnecting)
+  {
+    _closeReconnectSocket(self);
+    self->reconnecting = false;
+  }
+
+  state = processReconnectSRX(self, &fd, &timeout);
+  while (   ((state == SRX_RECONNECT_CONNECTING) 
+             || (state == SRX_RECONNECT_WAITING))
+         && (self->reconnRounds < MAX_RECONNECT_ATTEMPT))
+  {
+    pfd.fd      = fd;
+    pfd.events  = POLLOUT;
+    pfd.revents = 0;
+    poll(&pfd, fd != -1 ? 1 : 0, timeout);
+    state = processReconnectSRX(self, &fd, &timeout);
+  }
+
+  if ((state == SRX_RECONNECT_CONNECTING) || (state == SRX_RECONNECT_WAITING))
+  {
+    _closeReconnectSocket(self);
+    self->reconnecting = false;
+    LOG(LEVEL_WARNING, "Could not reconnect to any SRx server!");
+  }
+
+  return state == SRX_RECONNECT_DONE;
+}
@@ -62,6 +62,17 @@
 //typedef void (*SRxPacketHandler)(SRxProxyPDUType pduType, void* dataHeader,
 //                                 void* srxProxy);
 
+/** The maximum length of a server host name including the '\0'. */
+#define SRX_SERVER_HOST_LENGTH 256
+
+/**
+ * An SRx server of the failover list.
+ */
+typedef struct {
+  char host[SRX_SERVER_HOST_LENGTH];
+  int  port;
+} SRxServerAddr;
+
 /**
  * A single Client Connection Handler.
  */
@@ -78,7 +89,8 @@ typedef struct {
   pthread_t        recvThread;    // Receiving thread
   bool             stop;          // Do not try to reconnect, receive
   SList            sendQueue;     // Buffers send requests if offline
-  RWLock           queueLock;     // Protects the \c sendQueue
+  RWLock           queueLock;     // Protects the \c sendQueue, the 
+                                  // \c creditQueue and the \c credits
   bool		   bRecvSet;
 
   // Used to allow handling of send and receive from two separate threads.
@@ -96,6 +108,33 @@ typedef struct {
 
   uint32_t         handshake_timeout; // The time in seconds allowed to wait
                                     // until a handshake timeout occurs.
+  uint32_t         shmRingSize;   // The ring size of the shared memory channel
+                                  // offered during the handshake. Zero keeps
+                                  // the communication on TCP.
+  bool             serverSyncs;   // The server sends a sync request after the
+                                  // handshake.
+
+  // Flow control
+  uint32_t         flowWindow;    // The window of outstanding verify requests
+                                  // requested during the handshake. Zero 
+                                  // does not request the flow control.
+  bool             flowControl;   // The server granted the flow control.
+  uint32_t         credits;       // The verify requests that can be sent.
+  SList            creditQueue;   // Verify requests held until credits are
+                                  // returned.
+
+  // Failover and reconnect
+  SList            servers;       // The SRx servers (SRxServerAddr) in the
+                                  // order they are tried.
+  int              serverIdx;     // The server tried or connected to.
+  bool             reconnecting;  // A reconnect is in progress.
+  SRxReconnectState reconnState;  // The state of the reconnect.
+  uint32_t         reconnDelay;   // The backoff in milliseconds.
+  uint32_t         reconnRounds;  // The times all servers failed in a row.
+  uint64_t         reconnTime;    // The time (milliseconds of the monotonic 
+                                  // clock) of the next attempt or connect
+                                  // timeout.
+  unsigned int     reconnSeed;    // The seed of the backoff jitter.
 
   // Pointer to the srx proxy
   uint32_t         keepWindow;    // a default keep window value.
@@ -204,6 +243,32 @@ bool connHandlerUnlock(ClientConnectionHandler* self);
 bool sendPacketToServer(ClientConnectionHandler* self, SRXPROXY_PDU* header,
                         uint32_t length);
 
+/**
+ * Sends a verify request to the server. If the server granted the flow
+ * control the request is only sent with a credit, otherwise it is held until
+ * the server returns credits. Without flow control this is sendPacketToServer.
+ *
+ * @param self Instance that should be used
+ * @param data The verify request PDU.
+ * @param length The length of the PDU.
+ *
+ * @return true = data sent or held, false = sending failed
+ *
+ * @since 0.6.3.0
+ */
+bool sendVerifyRequest(ClientConnectionHandler* self, void* data,
+                       uint32_t length);
+
+/**
+ * Add the credits returned by the server and send the verify requests held 
+ * as long as credits are available.
+ *
+ * @param self Instance that should be used
+ * @param credits The credits returned by the server.
+ *
+ * @since 0.6.3.0
+ */
+void addCredits(ClientConnectionHandler* self, uint32_t credits);
 
 /*
  * Create the connection of application layer between srx and proxy
@@ -247,5 +312,22 @@ bool sendGoodbye(ClientConnectionHandler* self, uint16_t keepWindow);
  * @return true if the reconnect was successful, otherwise false.
  */
 bool reconnectSRX(ClientConnectionHandler* self);
+
+/**
+ * Drive the reconnect with the SRx servers without blocking. The first call
+ * starts the reconnect, the following ones continue it once the returned
+ * socket is writable or the timeout expired. Once connected on the transport
+ * layer the handshake is performed and the data resynchronized.
+ *
+ * @param self The ClientConnection handler.
+ * @param fd (out) The socket to wait for until it is writable or -1.
+ * @param timeout (out) The milliseconds until the next call or -1.
+ *
+ * @return the state of the reconnect.
+ *
+ * @since 0.6.3.0
+ */
+SRxReconnectState processReconnectSRX(ClientConnectionHandler* self, int* fd,
+                                      int* timeout);
 #endif // !__CLIENT_CONNECTION_HANDLER__
 
@@ -220,6 +220,7 @@ void releaseSRxProxy(SRxProxy* proxy)
     LOG(LEVEL_DEBUG, "### [%s] ###  Reset process ... ", __FUNCTION__);
     disconnectFromSRx(proxy, SRX_DEFAULT_KEEP_WINDOW);
     releaseSList(&proxy->peerAS);
+    releaseSList(&((ClientConnectionHandler*)proxy->connHandler)->servers);
     free(proxy->connHandler);
     free(proxy);
   }
@@ -341,7 +342,7 @@ void deleteUpdate(SRxProxy* proxy, uint16_t keep_window, SRxUpdateID updateID)
                                    (ClientConnectionHandler*)proxy->connHandler;
 
   //if (connHandler->initialized && connHandler->established)
-  if (isConnected(proxy))
+  if (isConnected(proxy) || connHandler->reconnecting)
   {
     uint32_t length = sizeof(SRXPROXY_DELETE_UPDATE);
     SRXPROXY_DELETE_UPDATE* hdr = malloc(length);
@@ -359,7 +360,7 @@ void deleteUpdate(SRxProxy* proxy, uint16_t keep_window, SRxUpdateID updateID)
   int32_t result = ImpleProxyDeleteUpdate(verify_pdu, connHandler->grpcClientID);
   LOG(LEVEL_INFO, HDR "[deleteUpdate] Result: %02x\n", result);
 #else
-    sendData(&connHandler->clSock, hdr, length);
+    sendPacketToServer(connHandler, hdr, length);
 #endif
 
     free(hdr);
@@ -439,7 +440,7 @@ bool connectToSRx(SRxProxy* proxy, const char* host, int port,
 
   LOG(LEVEL_INFO, "Establish connection with proxy [%u]...", proxy->proxyID);
   uint32_t noPeers    = proxy->peerAS.size;
-  uint32_t length     = 20 + (noPeers * 4);
+  uint32_t length     = sizeof(SRXPROXY_HELLO) + (noPeers * 4);
   uint8_t  pdu[length];
   SRXPROXY_HELLO* hdr = (SRXPROXY_HELLO*)pdu;
   uint32_t peerASN    = 0;
@@ -506,6 +507,56 @@ bool connectToSRx(SRxProxy* proxy, const char* host, int port,
   return connHandler->established;
 }
 
+/**
+ * Offer a shared memory channel to the SRx server during the next handshake.
+ * The server only accepts the channel if it runs on the same host and is 
+ * configured to do so, otherwise the connection stays on TCP.
+ *
+ * @param proxy The proxy instance
+ * @param ringSize The size of each direction in bytes. Zero disables the
+ *                 offer.
+ *
+ * @return false if the proxy is not initialized.
+ *
+ * @since 0.6.3.0
+ */
+bool setSharedMemoryTransport(SRxProxy* proxy, uint32_t ringSize)
+{
+  if ((proxy == NULL) || (proxy->connHandler == NULL))
+  {
+    return false;
+  }
+
+  ((ClientConnectionHandler*)proxy->connHandler)->shmRingSize = ringSize;
+
+  return true;
+}
+
+/**
+ * Request the flow control of the verify requests during the next handshake.
+ * The proxy then has at most the window granted by the server outstanding, 
+ * further requests are held until the server returns credits.
+ *
+ * @param proxy The proxy instance
+ * @param window The requested window of outstanding verify requests. Zero
+ *               does not request the flow control.
+ *
+ * @return false if the proxy is not initialized.
+ *
+ * @since 0.6.3.0
+ */
+bool setFlowControlWindow(SRxProxy* proxy, uint32_t window)
+{
+  if ((proxy == NULL) || (proxy->connHandler == NULL))
+  {
+    return false;
+  }
+
+  ((ClientConnectionHandler*)proxy->connHandler)->flowWindow = window;
+
+  return true;
+}
+
 /**
  * Disconnects the proxy from the SRx Server instance on both, application and
  * transport layer.
@@ -610,6 +661,67 @@ bool reconnectWithSRx(SRxProxy* proxy)
   return reConnected;
 }
 
+/**
+ * Add a server to the failover list of the proxy. The server given to
+ * connectToSRx is always the first one, the added ones follow in the order
+ * they are added. The initial connect as well as each reconnect try the 
+ * servers in this order.
+ *
+ * @param proxy The proxy itself
+ * @param host Server host name
+ * @param port Server port address
+ *
+ * @return true if the server could be added.
+ *
+ * @since 0.6.3.0
+ */
+bool addSRxServer(SRxProxy* proxy, const char* host, int port)
+{
+  SRxServerAddr* server = NULL;
+
+  if ((proxy != NULL) && (proxy->connHandler != NULL) && (host != NULL))
+  {
+    ClientConnectionHandler* connHandler =
+                                   (ClientConnectionHandler*)proxy->connHandler;
+    server = appendToSList(&connHandler->servers, sizeof(SRxServerAddr));
+    if (server != NULL)
+    {
+      snprintf(server->host, SRX_SERVER_HOST_LENGTH, "%s", host);
+      server->port = port;
+    }
+  }
+
+  return server != NULL;
+}
+
+/**
+ * Start or continue the reconnect with the SRx servers without blocking. See
+ * srx_api.h for a detailed description.
+ *
+ * @param proxy The proxy itself
+ * @param fd (out) The socket to wait for until it is writable or -1.
+ * @param timeout (out) The milliseconds until the next call or -1.
+ *
+ * @return The state of the reconnect.
+ *
+ * @since 0.6.3.0
+ */
+SRxReconnectState processReconnectWithSRx(SRxProxy* proxy, int* fd,
+                                          int* timeout)
+{
+  SRxReconnectState state;
+  ClientConnectionHandler* connHandler =
+                                   (ClientConnectionHandler*)proxy->connHandler;
+
+  state = processReconnectSRX(connHandler, fd, timeout);
+  if (state == SRX_RECONNECT_DONE)
+  {
+    LOG(LEVEL_DEBUG, HDR " %s: success", __FUNCTION__);
+  }
+
+  return state;
+}
+
 /**
  * Return the internal socket descriptor. This method allows to manage the
  * socket from within the user of the API. For detailed information see the
@@ -806,7 +918,9 @@ void verifyUpdate(SRxProxy* proxy, uint32_t localID,
                   IPPrefix* prefix, uint32_t as32,
                   BGPSecData* bgpsec, SRxASPathList asPathList)
 {
-  if (!isConnected(proxy))
+  // Requests are queued during a reconnect.
+  if (   !isConnected(proxy)
+      && !((ClientConnectionHandler*)proxy->connHandler)->reconnecting)
   {
     RAISE_ERROR(HDR "Abort verify, not connected to SRx server!" ,
                 pthread_self());
@@ -854,7 +968,7 @@ void verifyUpdate(SRxProxy* proxy, uint32_t localID,
   do
   {
     attempt++;
-    if(sendPacketToServer(connHandler, (SRXPROXY_PDU*)pdu, length))
+    if(sendVerifyRequest(connHandler, (SRXPROXY_PDU*)pdu, length))
     {
       // Leave the loop
       if (   proxy->socketConfig.resetSendErrors
@@ -934,7 +1048,13 @@ void verifyUpdate(SRxProxy* proxy, uint32_t localID,
     // Store into send queue for re-transmit later
     // TODO: Send queue might not be used anymore.
     void* dataCopy;
+    acquireWriteLock(&connHandler->queueLock);
     dataCopy = appendToSList(&connHandler->sendQueue, (size_t)length);
+    if (dataCopy != NULL)
+    {
+      memcpy(dataCopy, pdu, length);
+    }
+    unlockWriteLock(&connHandler->queueLock);
     if (dataCopy == NULL)
     {
       RAISE_ERROR("ERROR, could not store update in send Queue for delayed "
@@ -1062,6 +1182,30 @@ void processHelloResponse(SRXPROXY_HELLO_RESPONSE* hdr, SRxProxy* proxy)
   if (ntohs(hdr->version) == SRX_PROTOCOL_VER)
   {
     connHandler->established = true;
+    // The server sends a synchronization request right after this packet.
+    connHandler->serverSyncs = (hdr->reserved8 & SRX_PROXY_FLAG_SYNC) != 0;
+    // The server switched to the offered channel right after this packet.
+    if (   ((hdr->reserved8 & SRX_PROXY_FLAG_SHM) != 0)
+        && (connHandler->clSock.shm != NULL))
+    {
+      connHandler->clSock.shmActive = true;
+      LOG(LEVEL_INFO, "Proxy [ID:%u] uses the shared memory transport.",
+                      proxy->proxyID);
+    }
+    // The server granted the flow control, the requests of a previous
+    // connection are not outstanding anymore.
+    acquireWriteLock(&connHandler->queueLock);
+    connHandler->flowControl =    (connHandler->flowWindow > 0)
+                               && ((hdr->reserved8 & SRX_PROXY_FLAG_CREDIT) 
+                                   != 0);
+    connHandler->credits     = connHandler->flowControl ? ntohl(hdr->window)
+                                                        : 0;
+    unlockWriteLock(&connHandler->queueLock);
+    if (connHandler->flowControl)
+    {
+      LOG(LEVEL_INFO, "Proxy [ID:%u] uses the flow control with a window of "
+                      "%u requests.", proxy->proxyID, connHandler->credits);
+    }
   }
   else
   {
@@ -1109,6 +1253,18 @@ static int ct = 0;
  */
 void processVerifyNotify(SRXPROXY_VERIFY_NOTIFICATION* hdr, SRxProxy* proxy)
 {
+  // Send the requests held for credits first.
+  if (hdr->credits != 0)
+  {
+    addCredits((ClientConnectionHandler*)proxy->connHandler, 
+               ntohs(hdr->credits));
+  }
+  // The notification only returns credits.
+  if ((hdr->resultType == 0) && (hdr->updateID == 0))
+  {
+    return;
+  }
+
   if (proxy->resCallback != NULL)
   {
     bool hasReceipt = (hdr->resultType & SRX_FLAG_REQUEST_RECEIPT)
@@ -1165,15 +1321,15 @@ void processVerifyNotify(SRXPROXY_VERIFY_NOTIFICATION* hdr, SRxProxy* proxy)
  */
 void processSignNotify(SRXPROXY_SIGNATURE_NOTIFICATION* hdr, SRxProxy* proxy)
 {
-  // @TODO: Finishe the implementation with the correct data.
   if (proxy->sigCallback != NULL)
   {
-    LOG(LEVEL_INFO, "processSignNotify: NOT IMPLEMENTED IN THIS PROTOTYPE!!!\n");
-    SRxUpdateID updId = hdr->updateIdentifier;
-    //TODO finish processSigNotify - especially the bgpsec data
+    SRxUpdateID updId = ntohl(hdr->updateIdentifier);
+    // The signature segment (SKI, length, signature) follows the header.
     BGPSecCallbackData bgpsecCallback;
-    bgpsecCallback.length = 0;
-    bgpsecCallback.data = NULL;
+    bgpsecCallback.length = ntohl(hdr->bgpsecLength);
+    bgpsecCallback.data   = bgpsecCallback.length > 0
+                  ? (uint8_t*)hdr + sizeof(SRXPROXY_SIGNATURE_NOTIFICATION)
+                  : NULL;
     proxy->sigCallback(updId, &bgpsecCallback, proxy->userPtr);
   }
   else
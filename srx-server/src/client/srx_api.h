@@ -120,6 +120,21 @@ typedef enum
 // Should be used as sub code for errors that do NOT provide a subcode.
 #define COM_PROXY_NO_SUBCODE 0
 
+/** The state of a reconnect driven by processReconnectWithSRx. */
+typedef enum
+{
+  /** The connection to an SRx server is established again. */
+  SRX_RECONNECT_DONE=0,
+  /** A transport connection is in progress. Call processReconnectWithSRx 
+   * once the socket is writable or the timeout expired. */
+  SRX_RECONNECT_CONNECTING=1,
+  /** All servers failed, wait for the next attempt. Call 
+   * processReconnectWithSRx once the timeout expired. */
+  SRX_RECONNECT_WAITING=2,
+  /** The proxy is not initialized or stopped, no reconnect is attempted. */
+  SRX_RECONNECT_STOPPED=3
+} SRxReconnectState;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Callback notification functions for proxy user
 ////////////////////////////////////////////////////////////////////////////////
@@ -387,6 +402,39 @@ void deleteUpdate(SRxProxy* proxy, uint16_t keep_window, SRxUpdateID updateID);
 bool connectToSRx(SRxProxy* proxy, const char* host, int port,
                   int handshakeTimeout, bool externalSocketControl);
 
+/**
+ * Offer a shared memory channel to the SRx server during the next handshake.
+ * The server only accepts the channel if it runs on the same host and is 
+ * configured to do so, otherwise the connection stays on TCP. The socket 
+ * remains the file descriptor to be watched, it becomes readable each time
+ * data is waiting in the channel.
+ *
+ * @param proxy The proxy instance
+ * @param ringSize The size of each direction in bytes. Zero disables the
+ *                 offer.
+ *
+ * @return false if the proxy is not initialized.
+ *
+ * @since 0.6.3.0
+ */
+bool setSharedMemoryTransport(SRxProxy* proxy, uint32_t ringSize);
+
+/**
+ * Request the flow control of the verify requests during the next handshake.
+ * The proxy then has at most the window granted by the server outstanding, 
+ * further requests are held until the server returns credits. This way the
+ * proxy does not block if the server falls behind.
+ *
+ * @param proxy The proxy instance
+ * @param window The requested window of outstanding verify requests. Zero
+ *               does not request the flow control.
+ *
+ * @return false if the proxy is not initialized.
+ *
+ * @since 0.6.3.0
+ */
+bool setFlowControlWindow(SRxProxy* proxy, uint32_t window);
+
 /**
  * Disconnects the proxy from the SRx Server instance on both, application and
  * transport layer.
@@ -420,6 +468,48 @@ bool isConnected(SRxProxy* proxy);
  */
 bool reconnectWithSRx(SRxProxy* proxy);
 
+/**
+ * Add an SRx server to the failover list of the proxy. The server given to
+ * connectToSRx is the first of the list, the others are tried in the order
+ * they are added.
+ *
+ * @param proxy The proxy instance
+ * @param host Server host name
+ * @param port Server port address
+ *
+ * @return false if the server could not be added.
+ *
+ * @since 0.6.3.0
+ */
+bool addSRxServer(SRxProxy* proxy, const char* host, int port);
+
+/**
+ * Drive the reconnect with the SRx servers without blocking the caller. The 
+ * first call after the connection was lost (COM_ERR_PROXY_CONNECTION_LOST or
+ * a failed processPackets) starts the reconnect, the caller calls it again
+ * once the returned socket is writable or the timeout expired. The servers of
+ * the failover list are tried in order, once all failed the proxy waits with
+ * a jittered exponential backoff before starting over.
+ *
+ * Requests made while reconnecting are queued. Once connected the proxy
+ * calls the syncNotification unless the server requests the synchronization
+ * itself. The queued requests are then dropped, the synchronization sends
+ * them again. Without syncNotification they are sent to the server.
+ *
+ * In case of external socket control the caller closes the lost socket and
+ * retrieves the new one using getInternalSocketFD after the reconnect.
+ *
+ * @param proxy The proxy itself
+ * @param fd (out) The socket to wait for until it is writable or -1.
+ * @param timeout (out) The milliseconds until the next call or -1.
+ *
+ * @return the state of the reconnect.
+ *
+ * @since 0.6.3.0
+ */
+SRxReconnectState processReconnectWithSRx(SRxProxy* proxy, int* fd,
+                                          int* timeout);
+
 /**
  * Verifies the given update data. All parameters except the result parameter
  * are IN parameters, result is an OUT parameter that will be filled within this
@@ -0,0 +1,289 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * This file contains the ASPA hop cache.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "server/aspa_hop_cache.h"
+#include "util/log.h"
+
+/** The bits of the generation stored in each slot. */
+#define HOP_GEN_MASK    0x00FFFFFF
+/** The largest afi and result value that fits into a slot. */
+#define HOP_NIBBLE_MASK 0xF
+/** Size of a cache line. */
+#define HOP_CACHE_LINE  64
+
+/**
+ * Generate the hash value of the given hop.
+ *
+ * @param customerAsn The customer ASN.
+ * @param providerAsn The provider ASN.
+ * @param afi The address family.
+ *
+ * @return the hash value.
+ */
+static uint32_t _hashHop(uint32_t customerAsn, uint32_t providerAsn,
+                         uint8_t afi)
+{
+  uint64_t key = ((uint64_t)customerAsn << 32) | providerAsn;
+
+  key ^= (uint64_t)afi << 61;
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  key *= 0xC4CEB9FE1A85EC53ULL;
+  key ^= key >> 33;
+
+  return (uint32_t)key;
+}
+
+/**
+ * Return the first slot of the bucket the given hop belongs to.
+ *
+ * @param self The hop cache.
+ * @param hash The hash value of the hop.
+ *
+ * @return the first slot of the bucket.
+ */
+static ASPA_HopCacheSlot* _getBucket(ASPA_HopCache* self, uint32_t hash)
+{
+  return &self->slots[(hash & self->bucketMask) * ASPA_HOP_BUCKET_SLOTS];
+}
+
+/**
+ * Initialize the hop cache.
+ *
+ * @param self The hop cache.
+ * @param slots The number of slots, rounded up to a power of two. Zero
+ *              disables the cache.
+ *
+ * @return false if the memory could not be allocated.
+ *
+ * @since 0.6.3.0
+ */
+bool createAspaHopCache(ASPA_HopCache* self, uint32_t slots)
+{
+  uint32_t buckets = 1;
+
+  self->slots      = NULL;
+  self->bucketMask = 0;
+  self->generation = 1;
+
+  if (slots == 0)
+  {
+    return true;
+  }
+
+  while (buckets * ASPA_HOP_BUCKET_SLOTS < slots)
+  {
+    buckets <<= 1;
+  }
+
+  size_t size = buckets * ASPA_HOP_BUCKET_SLOTS * sizeof(ASPA_HopCacheSlot);
+  void*  mem  = NULL;
+  if (posix_memalign(&mem, HOP_CACHE_LINE, size) != 0)
+  {
+    RAISE_ERROR("Unable to allocate memory for the ASPA hop cache");
+    return false;
+  }
+  memset(mem, 0, size);
+
+  self->slots      = (ASPA_HopCacheSlot*)mem;
+  self->bucketMask = buckets - 1;
+
+  return true;
+}
+
+/**
+ * Free the memory of the hop cache. This disables the cache.
+ *
+ * @param self The hop cache.
+ *
+ * @since 0.6.3.0
+ */
+void releaseAspaHopCache(ASPA_HopCache* self)
+{
+  if (self->slots != NULL)
+  {
+    free(self->slots);
+    self->slots      = NULL;
+    self->bucketMask = 0;
+  }
+}
+
+/**
+ * Invalidate all cached hops. This MUST be called each time the ASPA data
+ * changes, and while the changes are still protected from being read.
+ *
+ * @param self The hop cache.
+ *
+ * @since 0.6.3.0
+ */
+void invalidateAspaHopCache(ASPA_HopCache* self)
+{
+  uint32_t generation = self->generation + 1;
+
+  if ((generation & HOP_GEN_MASK) == 0)
+  {
+    // The slots only store 24 bits of the generation. Remove all entries
+    // before the tags repeat. Entries still stored by readers that started
+    // before carry an outdated tag.
+    if (self->slots != NULL)
+    {
+      uint32_t idx;
+      uint32_t numSlots = (self->bucketMask + 1) * ASPA_HOP_BUCKET_SLOTS;
+      for (idx = 0; idx < numSlots; idx++)
+      {
+        __atomic_store_n(&self->slots[idx].info, 0, __ATOMIC_RELAXED);
+      }
+    }
+    generation++;
+  }
+
+  __atomic_store_n(&self->generation, generation, __ATOMIC_RELEASE);
+}
+
+/**
+ * Lookup the result of the given hop. In case of a miss the current
+ * generation is returned. It MUST be read before the ASPA DB is searched and
+ * handed to storeAspaHopCache afterwards.
+ *
+ * @param self The hop cache.
+ * @param customerAsn The customer ASN.
+ * @param providerAsn The provider ASN.
+ * @param afi The address family.
+ * @param result (out) The cached result.
+ * @param generation (out) The generation of the ASPA DB.
+ *
+ * @return true if the hop was found.
+ *
+ * @since 0.6.3.0
+ */
+bool lookupAspaHopCache(ASPA_HopCache* self, uint32_t customerAsn,
+                        uint32_t providerAsn, uint8_t afi,
+                        ASPA_ValidationResult* result, uint32_t* generation)
+{
+  uint32_t gen = __atomic_load_n(&self->generation, __ATOMIC_ACQUIRE);
+  *generation = gen;
+
+  if (self->slots == NULL || afi > HOP_NIBBLE_MASK)
+  {
+    return false;
+  }
+
+  uint32_t tag = ((gen & HOP_GEN_MASK) << 8) | ((uint32_t)afi << 4);
+  ASPA_HopCacheSlot* bucket = _getBucket(self,
+                                      _hashHop(customerAsn, providerAsn, afi));
+  int idx;
+
+  for (idx = 0; idx < ASPA_HOP_BUCKET_SLOTS; idx++)
+  {
+    ASPA_HopCacheSlot* slot = &bucket[idx];
+    uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+    {
+      continue;
+    }
+
+    uint32_t info     = __atomic_load_n(&slot->info, __ATOMIC_RELAXED);
+    uint32_t customer = __atomic_load_n(&slot->customerAsn, __ATOMIC_RELAXED);
+    uint32_t provider = __atomic_load_n(&slot->providerAsn, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+    {
+      continue;
+    }
+
+    if ((info & ~HOP_NIBBLE_MASK) == tag
+        && customer == customerAsn && provider == providerAsn)
+    {
+      *result = (ASPA_ValidationResult)(info & HOP_NIBBLE_MASK);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Store the result of the given hop. The result is dropped in case the slot
+ * is being written by another thread.
+ *
+ * @param self The hop cache.
+ * @param generation The generation returned by lookupAspaHopCache.
+ * @param customerAsn The customer ASN.
+ * @param providerAsn The provider ASN.
+ * @param afi The address family.
+ * @param result The result of the ASPA DB lookup.
+ *
+ * @since 0.6.3.0
+ */
+void storeAspaHopCache(ASPA_HopCache* self, uint32_t generation,
+                       uint32_t customerAsn, uint32_t providerAsn,
+                       uint8_t afi, ASPA_ValidationResult result)
+{
+  if (self->slots == NULL || afi > HOP_NIBBLE_MASK
+      || (uint32_t)result > HOP_NIBBLE_MASK
+      || generation != __atomic_load_n(&self->generation, __ATOMIC_ACQUIRE))
+  {
+    // Disabled, not storable, or the ASPA data changed during the lookup.
+    return;
+  }
+
+  uint32_t hash   = _hashHop(customerAsn, providerAsn, afi);
+  uint32_t genTag = generation & HOP_GEN_MASK;
+  ASPA_HopCacheSlot* bucket = _getBucket(self, hash);
+  // Without an outdated slot the victim depends on the hash to keep the
+  // other slots of the bucket.
+  ASPA_HopCacheSlot* slot   = &bucket[(hash >> 30) % ASPA_HOP_BUCKET_SLOTS];
+  int idx;
+
+  for (idx = 0; idx < ASPA_HOP_BUCKET_SLOTS; idx++)
+  {
+    uint32_t info = __atomic_load_n(&bucket[idx].info, __ATOMIC_RELAXED);
+    if ((info >> 8) != genTag)
+    {
+      slot = &bucket[idx];
+      break;
+    }
+  }
+
+  uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+  if ((seq & 1)
+      || !__atomic_compare_exchange_n(&slot->seq, &seq, seq + 1, false,
+                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+  {
+    return;
+  }
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  __atomic_store_n(&slot->customerAsn, customerAsn, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->providerAsn, providerAsn, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->info, (genTag << 8) | ((uint32_t)afi << 4)
+                                | (uint32_t)result, __ATOMIC_RELAXED);
+
+  __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
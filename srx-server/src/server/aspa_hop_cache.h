@@ -0,0 +1,143 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * This file contains the ASPA hop cache. It memoizes the result of a single
+ * hop lookup (customer, provider, afi) in the ASPA DB. The same hops repeat
+ * across most AS paths which allows the ASPA validation to skip the DB.
+ *
+ * The cache is an open addressing table of buckets, each bucket fills one
+ * cache line. Readers do not lock, each slot is protected by a sequence
+ * counter. Writers that find a slot being written skip storing the result.
+ * Each slot is tagged with the generation of the ASPA DB it was computed
+ * with. Changes to the ASPA data increment the generation which invalidates
+ * all slots at once.
+ *
+ * @version 0.6.3.0
+ */
+#ifndef __ASPA_HOP_CACHE_H__
+#define __ASPA_HOP_CACHE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "shared/srx_defs.h"
+
+/** The default number of slots in the hop cache (16 bytes each). */
+#define ASPA_HOP_CACHE_SLOTS   (256 * 1024)
+/** The number of slots per bucket, one bucket fills one cache line. */
+#define ASPA_HOP_BUCKET_SLOTS  4
+
+/**
+ * A single slot of the hop cache.
+ */
+typedef struct {
+  /** Sequence counter, odd while the slot is written. */
+  volatile uint32_t seq;
+  /** The customer ASN of the hop. */
+  volatile uint32_t customerAsn;
+  /** The provider ASN of the hop. */
+  volatile uint32_t providerAsn;
+  /** generation (24 bit) | afi (4 bit) | result (4 bit) */
+  volatile uint32_t info;
+} ASPA_HopCacheSlot;
+
+/**
+ * The hop cache.
+ */
+typedef struct {
+  /** The slots, NULL if the cache is disabled. */
+  ASPA_HopCacheSlot* slots;
+  /** The number of buckets - 1 (power of two). */
+  uint32_t           bucketMask;
+  /** The generation of the ASPA DB, never zero. */
+  volatile uint32_t  generation;
+} ASPA_HopCache;
+
+/**
+ * Initialize the hop cache.
+ *
+ * @param self The hop cache.
+ * @param slots The number of slots, rounded up to a power of two. Zero
+ *              disables the cache.
+ *
+ * @return false if the memory could not be allocated.
+ *
+ * @since 0.6.3.0
+ */
+bool createAspaHopCache(ASPA_HopCache* self, uint32_t slots);
+
+/**
+ * Free the memory of the hop cache. This disables the cache.
+ *
+ * @param self The hop cache.
+ *
+ * @since 0.6.3.0
+ */
+void releaseAspaHopCache(ASPA_HopCache* self);
+
+/**
+ * Invalidate all cached hops. This MUST be called each time the ASPA data
+ * changes, and while the changes are still protected from being read.
+ *
+ * @param self The hop cache.
+ *
+ * @since 0.6.3.0
+ */
+void invalidateAspaHopCache(ASPA_HopCache* self);
+
+/**
+ * Lookup the result of the given hop. In case of a miss the current
+ * generation is returned. It MUST be read before the ASPA DB is searched and
+ * handed to storeAspaHopCache afterwards.
+ *
+ * @param self The hop cache.
+ * @param customerAsn The customer ASN.
+ * @param providerAsn The provider ASN.
+ * @param afi The address family.
+ * @param result (out) The cached result.
+ * @param generation (out) The generation of the ASPA DB.
+ *
+ * @return true if the hop was found.
+ *
+ * @since 0.6.3.0
+ */
+bool lookupAspaHopCache(ASPA_HopCache* self, uint32_t customerAsn,
+                        uint32_t providerAsn, uint8_t afi,
+                        ASPA_ValidationResult* result, uint32_t* generation);
+
+/**
+ * Store the result of the given hop. The result is dropped in case the slot
+ * is being written by another thread.
+ *
+ * @param self The hop cache.
+ * @param generation The generation returned by lookupAspaHopCache.
+ * @param customerAsn The customer ASN.
+ * @param providerAsn The provider ASN.
+ * @param afi The address family.
+ * @param result The result of the ASPA DB lookup.
+ *
+ * @since 0.6.3.0
+ */
+void storeAspaHopCache(ASPA_HopCache* self, uint32_t generation,
+                       uint32_t customerAsn, uint32_t providerAsn,
+                       uint8_t afi, ASPA_ValidationResult result);
+
+#endif // __ASPA_HOP_CACHE_H__
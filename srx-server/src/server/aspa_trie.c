@@ -57,11 +57,14 @@ static TrieNode* make_trienode(char data, char* userData, ASPA_Object* );
 static void free_trienode(TrieNode* node);
 static int search_trie(TrieNode* root, char* word);
 static void emptyAspaDB(ASPA_DBManager* self);
+static ASPA_ValidationResult _ASPA_DB_lookup(ASPA_DBManager* self, 
+                                             uint32_t customerAsn, 
+                                             uint32_t providerAsn, uint8_t afi);
 
 int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t pid, time_t ct);
 extern RPKI_QUEUE* getRPKIQueue();
-extern uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType, 
-                    AS_REL_DIR direction, uint8_t afi, ASPA_DBManager* aspaDBManager);
+extern uint8_t validateASPA (AS_PATH_LIST* aspl, uint8_t afi, 
+                             ASPA_DBManager* aspaDBManager);
 
 // API for initialization
 //
@@ -78,6 +81,12 @@ bool initializeAspaDBManager(ASPA_DBManager* aspaDBManager, Configuration* confi
      return false;
    }
 
+   if (!createAspaHopCache(&aspaDBManager->hopCache, ASPA_HOP_CACHE_SLOTS))
+   {
+     releaseRWLock(&aspaDBManager->tableLock);
+     return false;
+   }
+
   return true;
 }
 
@@ -89,6 +98,7 @@ static void emptyAspaDB(ASPA_DBManager* self)
   free_trienode(self->tableRoot);
   self->tableRoot = NULL;
   self->countAspaObj = 0;
+  invalidateAspaHopCache(&self->hopCache);
   unlockWriteLock(&self->tableLock);
 }
 
@@ -101,6 +111,7 @@ void releaseAspaDBManager(ASPA_DBManager* self)
   {
     releaseRWLock(&self->tableLock);
     emptyAspaDB(self);
+    releaseAspaHopCache(&self->hopCache);
   }
 }
 
@@ -250,14 +261,27 @@ bool delete_TrieNode_AspaObj (ASPA_DBManager* self, char* word, ASPA_Object* obj
     temp = temp->children[position];
   }
 
-  // info compare
+  // info compare, a withdrawal does not carry the object (NULL).
   if (temp && temp->is_leaf == 1 && temp->aspaObjects 
-      && compareAspaObject(temp->aspaObjects, obj))
+      && ((obj == NULL) || compareAspaObject(temp->aspaObjects, obj)))
   {
     deleteASPAObject(self, temp->aspaObjects);
-    free_trienode(temp);
+    temp->aspaObjects = NULL;
+    temp->userData    = NULL;
+    temp->is_leaf     = 0;
+    // The node might lead to the objects of longer ASNs.
+    idx = 0;
+    while ((idx < N) && (temp->children[idx] == NULL))
+    {
+      idx++;
+    }
+    if (idx == N)
+    {
+      free_trienode(temp);
+      parent->children[position] = NULL;
+    }
     temp = NULL;
-    parent->children[position] = NULL;
+    invalidateAspaHopCache(&self->hopCache);
     bRet = true;
   }
 
@@ -305,6 +329,7 @@ TrieNode* insertAspaObj (ASPA_DBManager* self, char* word, char* userData,
     temp->aspaObjects = obj;
     countTrieNode++;
     self->countAspaObj++;
+    invalidateAspaHopCache(&self->hopCache);
   }
 
   unlockWriteLock(&self->tableLock);
@@ -441,28 +466,52 @@ void print_search(TrieNode* root, char* word) {
 // 
 // external API for db loopkup
 //
-#define MAX_ASN_LENGTH 7
+#define MAX_ASN_LENGTH 11
 ASPA_ValidationResult ASPA_DB_lookup(ASPA_DBManager* self, uint32_t customerAsn, 
                                      uint32_t providerAsn, uint8_t afi )
+{
+  ASPA_ValidationResult result;
+  uint32_t generation;
+
+  // The same hops repeat across most AS paths, ask the hop cache first.
+  if (lookupAspaHopCache(&self->hopCache, customerAsn, providerAsn, afi, 
+                         &result, &generation))
+  {
+    return result;
+  }
+
+  result = _ASPA_DB_lookup(self, customerAsn, providerAsn, afi);
+  storeAspaHopCache(&self->hopCache, generation, customerAsn, providerAsn, 
+                    afi, result);
+
+  return result;
+}
+
+// 
+// Search the ASPA DB for the given hop
+//
+static ASPA_ValidationResult _ASPA_DB_lookup(ASPA_DBManager* self, 
+                                             uint32_t customerAsn, 
+                                             uint32_t providerAsn, uint8_t afi)
 {
   LOG(LEVEL_DEBUG, FILE_LINE_INFO " ASPA DB Lookup called");
 
   char strCusAsn[MAX_ASN_LENGTH] = {};
-  sprintf(strCusAsn, "%d", customerAsn);  
+  sprintf(strCusAsn, "%u", customerAsn);  
 
   ASPA_Object *obj = findAspaObject(self, strCusAsn);
 
   if (!obj) // if there is no object item
   {
-    LOG(LEVEL_INFO, "[db] No customer ASN exist -- Unknown");
+    LOG(LEVEL_DEBUG, "[db] No customer ASN exist -- Unknown");
     return ASPA_RESULT_UNKNOWN;
   }
   else // found object
   {
-    LOG(LEVEL_INFO, "[db] customer ASN: %d", obj->customerAsn);
-    LOG(LEVEL_INFO, "[db] providerAsCount : %d", obj->providerAsCount);
-    LOG(LEVEL_INFO, "[db] Address: provider asns : %p", obj->providerAsns);
-    LOG(LEVEL_INFO, "[db] afi: %d", obj->afi);
+    LOG(LEVEL_DEBUG, "[db] customer ASN: %d", obj->customerAsn);
+    LOG(LEVEL_DEBUG, "[db] providerAsCount : %d", obj->providerAsCount);
+    LOG(LEVEL_DEBUG, "[db] Address: provider asns : %p", obj->providerAsns);
+    LOG(LEVEL_DEBUG, "[db] afi: %d", obj->afi);
 
     if (obj->providerAsns)
     {
@@ -470,16 +519,16 @@ ASPA_ValidationResult ASPA_DB_lookup(ASPA_DBManager* self, uint32_t customerAsn,
       
       for (idx = 0; idx < obj->providerAsCount; idx++)
       {
-        LOG(LEVEL_INFO, "[db] providerAsns[%d]: %d", idx, 
+        LOG(LEVEL_DEBUG, "[db] providerAsns[%d]: %d", idx, 
                         obj->providerAsns[idx]);
         if (obj->providerAsns[idx] == providerAsn && obj->afi == afi)
         {
-          LOG(LEVEL_INFO, "[db] Matched -- Valid");
+          LOG(LEVEL_DEBUG, "[db] Matched -- Valid");
           return ASPA_RESULT_VALID;
         }
       }
   
-      LOG(LEVEL_INFO, "[db] No Matched -- Invalid");
+      LOG(LEVEL_DEBUG, "[db] No Matched -- Invalid");
       return ASPA_RESULT_INVALID;
     }
   }
@@ -499,13 +548,14 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid,
   uint32_t      pathId      = 0;
   RPKIHandler*  rpkiHandler = (RPKIHandler*)handler;
 
-  LOG(LEVEL_INFO, "=== main process_main_ASPA_EndOfData UpdateCache:%p rpkiHandler:%p ctime:%u", 
+  LOG(LEVEL_DEBUG, "=== main process_main_ASPA_EndOfData UpdateCache:%p rpkiHandler:%p ctime:%u", 
       (UpdateCache*)uCache, (RPKIHandler*)rpkiHandler, ct);
 
 
   if (!getUpdateResult(uCache, &updateID, 0, NULL, &srxRes, &defaultRes, &pathId))
   {
-    LOG(LEVEL_WARNING, "Update ID: 0x%08X not found ", updateID);
+    LOG_RATE_LIMITED(LEVEL_WARNING, 10, "Update ID: 0x%08X not found ",
+                     updateID);
     return 0;
   }
   else
@@ -513,43 +563,47 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid,
     ASPA_DBManager* aspaDBManager = rpkiHandler->aspaDBManager;
     TrieNode *root = aspaDBManager->tableRoot;
 
-    LOG(LEVEL_INFO, "Update ID: 0x%08X  Path ID: 0x%08X", updateID, pathId);
+    LOG(LEVEL_DEBUG, "Update ID: 0x%08X  Path ID: 0x%08X", updateID, pathId);
 
     uint8_t old_aspaResult = srxRes.aspaResult; // obtained from getUpdateResult above
-    AS_PATH_LIST *aspl = getAspathListFromAspathCache (rpkiHandler->aspathCache, pathId, &srxRes);
+    // The path is borrowed from the AS path cache, nothing is allocated. 
+    // srxRes receives the cached ASPA result.
+    uint32_t      epoch;
+    AS_PATH_LIST* aspl = borrowAspathList(rpkiHandler->aspathCache, pathId, 
+                                          &srxRes, &epoch);
 
-    if (aspl)
+    if (aspl != NULL)
     {
       uint8_t afi = aspl->afi;  
       if (aspl->afi == 0 || aspl->afi > 2) // if more than 2 (AFI_IP6)
-        afi = AFI_IP;                      // set default
+        afi = AFI_IP;                    // set default
 
+      uint8_t cachedResult = srxRes.aspaResult;
+      time_t  lastModified = __atomic_load_n(&aspl->lastModified, 
+                                             __ATOMIC_RELAXED);
 
-      LOG(LEVEL_INFO, "Comparison End of Data time(%u) : AS cache entry updated time (%u)",
-          lastEndOfDataTime, aspl->lastModified);
+      LOG(LEVEL_DEBUG, "Comparison End of Data time(%u) : AS cache entry updated time (%u)",
+          lastEndOfDataTime, lastModified);
       // timestamp comparison
       //
-      if (lastEndOfDataTime > aspl->lastModified)
+      if (lastEndOfDataTime > lastModified)
       {
         // call ASPA validation
         //
-        uint8_t valResult = validateASPA (aspl->asPathList, 
-            aspl->asPathLength, aspl->asType, aspl->asRelDir, afi, aspaDBManager);
+        uint8_t valResult = validateASPA (aspl, afi, aspaDBManager);
+        returnAspathList(rpkiHandler->aspathCache, epoch);
 
-        LOG(LEVEL_INFO, FILE_LINE_INFO "\033[92m"" Validation Result: %d "
+        LOG(LEVEL_DEBUG, FILE_LINE_INFO "\033[92m"" Validation Result: %d "
             "(0:v, 2:Iv, 3:Ud 4:DNU 5:Uk, 6:Uf)""\033[0m", valResult);
 
-        // update the last validation time regardless of changed or not
-        time_t cTime = time(NULL);
-        aspl->lastModified = cTime;
-
-        // modify Aspath Cache with the validation result
-        modifyAspaValidationResultToAspathCache (rpkiHandler->aspathCache, pathId, valResult, aspl);
+        // modify Aspath Cache with the validation result, this also updates
+        // the last validation time regardless of changed or not
+        modifyAspaValidationResultToAspathCache (rpkiHandler->aspathCache, 
+                                                 pathId, valResult, time(NULL));
 
         // modify UpdateCache data and enqueue as well
-        if (valResult != aspl->aspaValResult)
+        if (valResult != cachedResult)
         {
-          aspl->aspaValResult = valResult;
           srxRes.aspaResult = valResult;
 
           // UpdateCache change
@@ -558,7 +612,7 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid,
           // if different values, queuing
           RPKI_QUEUE*      rQueue = getRPKIQueue();
           rq_queue(rQueue, RQ_ASPA, &updateID);
-          LOG(LEVEL_INFO, "rpki queuing for aspa validation [uID:0x%08X]", updateID);
+          LOG(LEVEL_DEBUG, "rpki queuing for aspa validation [uID:0x%08X]", updateID);
         }
       }
       //
@@ -567,13 +621,14 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid,
       //
       else /* if else time comparison */
       {
+        returnAspathList(rpkiHandler->aspathCache, epoch);
         // update cache entry with the new value 
-        if (old_aspaResult != aspl->aspaValResult)
+        if (old_aspaResult != cachedResult)
         {
-          LOG(LEVEL_INFO, FILE_LINE_INFO " ASPA validation result already set and "
+          LOG(LEVEL_DEBUG, FILE_LINE_INFO " ASPA validation result already set and "
               " the existed validation result [%d] in UpdateCache is being updated with a new result[%d]", 
-              old_aspaResult, aspl->aspaValResult);
-          srxRes.aspaResult = aspl->aspaValResult;
+              old_aspaResult, cachedResult);
+          srxRes.aspaResult = cachedResult;
 
           // modify UpdateCache data as well
           modifyUpdateCacheResultWithAspaVal(uCache, &updateID, &srxRes);
@@ -581,22 +636,90 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid,
           // if different values, queuing
           RPKI_QUEUE*      rQueue = getRPKIQueue();
           rq_queue(rQueue, RQ_ASPA, &updateID);
-          LOG(LEVEL_INFO, "rpki queuing for aspa validation [uID:0x%08X]", updateID);
+          LOG(LEVEL_DEBUG, "rpki queuing for aspa validation [uID:0x%08X]", updateID);
         }
       }
 
     }
     else /* no aspath list */
     {
-      LOG(LEVEL_WARNING, "Update 0x%08X is registered for ASPA but the "
-          "AS Path List is not found!", updateID);
+      LOG_RATE_LIMITED(LEVEL_WARNING, 10, "Update 0x%08X is registered for "
+                       "ASPA but the AS Path List is not found!", updateID);
     } // end of if aspl
 
-    if (aspl)
-      free (aspl);
-
   }// end of else
 
 
   return 1;
 }
+
+/**
+ * Write the ASPA objects of the node and all its children into the snapshot.
+ *
+ * @param node The trie node.
+ * @param writer The snapshot writer.
+ * @param count (in/out) The number of written ASPA objects.
+ *
+ * @return false if the data could not be written.
+ *
+ * @since 0.6.3.0
+ */
+static bool _writeAspaNode(TrieNode* node, SnapshotWriter* writer, 
+                           uint32_t* count)
+{
+  SnapshotASPARecord record;
+  ASPA_Object*       obj    = node->aspaObjects;
+  bool               retVal = true;
+  int                childIdx;
+
+  // Leafs can have children as well, e.g. "6500" and "65001".
+  if (node->is_leaf && (obj != NULL))
+  {
+    memset(&record, 0, sizeof(SnapshotASPARecord));
+    record.customerAsn     = obj->customerAsn;
+    record.providerAsCount = obj->providerAsCount;
+    record.afi             = obj->afi;
+    retVal =    addSnapshotData(writer, &record, sizeof(SnapshotASPARecord))
+             && addSnapshotData(writer, obj->providerAsns, 
+                                obj->providerAsCount * sizeof(uint32_t));
+    (*count)++;
+  }
+
+  for (childIdx = 0; retVal && (childIdx < N); childIdx++)
+  {
+    if (node->children[childIdx] != NULL)
+    {
+      retVal = _writeAspaNode(node->children[childIdx], writer, count);
+    }
+  }
+
+  return retVal;
+}
+
+/**
+ * Write all ASPA objects into the SNAP_SEC_ASPA section of the snapshot.
+ *
+ * @param self The ASPA database.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool writeAspaDBSnapshot(ASPA_DBManager* self, SnapshotWriter* writer)
+{
+  uint32_t count  = 0;
+  bool     retVal = beginSnapshotSection(writer, SNAP_SEC_ASPA);
+
+  if (retVal)
+  {
+    acquireReadLock(&self->tableLock);
+    if (self->tableRoot != NULL)
+    {
+      retVal = _writeAspaNode(self->tableRoot, writer, &count);
+    }
+    unlockReadLock(&self->tableLock);
+  }
+
+  return retVal && endSnapshotSection(writer, count);
+}
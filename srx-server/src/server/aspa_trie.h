@@ -36,7 +36,9 @@
 
 #include <stdint.h>
 #include "shared/srx_defs.h"
+#include "server/aspa_hop_cache.h"
 #include "server/configuration.h"
+#include "server/snapshot.h"
 #include "util/mutex.h"
 #include "util/rwlock.h"
 
@@ -69,6 +71,8 @@ typedef struct {
   uint32_t          countAspaObj;
   Configuration*    config;  // The system configuration
   RWLock            tableLock;
+  /** Memoized results of ASPA_DB_lookup, invalidated with each change. */
+  ASPA_HopCache     hopCache;
   int (*cbProcessEndOfData)(void* uCache, void* rpkiHandler, 
                             uint32_t uid, uint32_t pid, time_t ct);
 } ASPA_DBManager;
@@ -85,6 +89,18 @@ ASPA_ValidationResult ASPA_DB_lookup(ASPA_DBManager* self, uint32_t customerAsn,
 TrieNode* printAllLeafNode(TrieNode *node);
 bool delete_TrieNode_AspaObj (ASPA_DBManager* self, char* word, ASPA_Object* obj);
 
+/**
+ * Write all ASPA objects into the SNAP_SEC_ASPA section of the snapshot.
+ *
+ * @param self The ASPA database.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool writeAspaDBSnapshot(ASPA_DBManager* self, SnapshotWriter* writer);
+
 
 
 
@@ -35,24 +35,164 @@
  */
 #include <uthash.h>
 #include <stdbool.h>
+#include <string.h>
 #include "server/aspath_cache.h"
 #include "shared/crc32.h"
 #include "util/log.h"
 
 #define HDR "([0x%08X] AspathCache): "
 
-typedef struct {
+typedef struct _PathListCacheTable {
 
   UT_hash_handle    hh;            // The hash table where this entry is stored
   uint32_t          pathId;
-  AC_PathListData   data;
-  uint8_t           aspaResult;
-  AS_TYPE           asType;
-  AS_REL_DIR        asRelDir;
-  uint16_t          afi;
-  time_t            lastModified;
+  AS_PATH_LIST      list;          // The cached path, lent to the readers
+  uint32_t          refCount;      // The number of updates using the path
+  uint32_t          retireEpoch;   // The epoch the entry was removed in
+  struct _PathListCacheTable* nextRetired;
 } PathListCacheTable;
 
+/**
+ * Enter the current epoch. Entries removed from the table after the reader
+ * entered are not freed before the reader left the epoch again.
+ *
+ * @param self The AS path cache.
+ *
+ * @return the epoch which MUST be handed to _leaveEpoch.
+ *
+ * @since 0.6.3.0
+ */
+static uint32_t _enterEpoch(AspathCache* self)
+{
+  uint32_t epoch;
+
+  while (true)
+  {
+    epoch = __atomic_load_n(&self->epoch, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&self->readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&self->epoch, __ATOMIC_SEQ_CST) == epoch)
+    {
+      break;
+    }
+    // The epoch advanced in between, the counter might be checked already.
+    __atomic_fetch_sub(&self->readers[epoch & 1], 1, __ATOMIC_RELEASE);
+  }
+
+  return epoch;
+}
+
+/**
+ * Leave the epoch entered with _enterEpoch.
+ *
+ * @param self The AS path cache.
+ * @param epoch The epoch returned by _enterEpoch.
+ *
+ * @since 0.6.3.0
+ */
+static void _leaveEpoch(AspathCache* self, uint32_t epoch)
+{
+  __atomic_fetch_sub(&self->readers[epoch & 1], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Free the memory of the cache entry.
+ *
+ * @param cacheTable The cache entry.
+ *
+ * @since 0.6.3.0
+ */
+static void _freeCacheEntry(PathListCacheTable* cacheTable)
+{
+  if (cacheTable->list.asPathList)
+  {
+    free(cacheTable->list.asPathList);
+  }
+  if (cacheTable->list.segments)
+  {
+    free(cacheTable->list.segments);
+  }
+  free(cacheTable);
+}
+
+/**
+ * Free the removed entries no reader can see anymore. Each call advances the
+ * epoch if no reader of the previous epoch is left. An entry removed in epoch
+ * E can be freed once the epoch reached E+2. The caller MUST hold the write 
+ * lock.
+ *
+ * @param self The AS path cache.
+ * @param force Free all removed entries, only if no reader exists anymore.
+ *
+ * @since 0.6.3.0
+ */
+static void _reclaimEntries(AspathCache* self, bool force)
+{
+  uint32_t epoch = __atomic_load_n(&self->epoch, __ATOMIC_SEQ_CST);
+  int      idx;
+
+  for (idx = 0; idx < 2; idx++)
+  {
+    // epoch+1 shares the counter with epoch-1
+    if (__atomic_load_n(&self->readers[(epoch + 1) & 1], __ATOMIC_SEQ_CST) 
+        != 0)
+    {
+      break;
+    }
+    epoch++;
+    __atomic_store_n(&self->epoch, epoch, __ATOMIC_SEQ_CST);
+  }
+
+  PathListCacheTable** pEntry = (PathListCacheTable**)&self->retired;
+  while (*pEntry != NULL)
+  {
+    PathListCacheTable* entry = *pEntry;
+    if (force || (epoch - entry->retireEpoch) >= 2)
+    {
+      *pEntry = entry->nextRetired;
+      _freeCacheEntry(entry);
+    }
+    else
+    {
+      pEntry = &entry->nextRetired;
+    }
+  }
+}
+
+/**
+ * Remove the entry from the hash table. The memory is freed once no reader
+ * can see the entry anymore. The caller MUST hold the write lock.
+ *
+ * @param self The AS path cache.
+ * @param cacheTable The entry to be removed.
+ *
+ * @since 0.6.3.0
+ */
+static void _retireEntry(AspathCache* self, PathListCacheTable* cacheTable)
+{
+  HASH_DEL (*((PathListCacheTable**)&self->aspathCacheTable), cacheTable);
+  cacheTable->retireEpoch = __atomic_load_n(&self->epoch, __ATOMIC_SEQ_CST);
+  cacheTable->nextRetired = (PathListCacheTable*)self->retired;
+  self->retired = cacheTable;
+}
+
+/**
+ * Find the entry of the given path. The caller MUST hold the table lock.
+ *
+ * @param self The AS path cache.
+ * @param pathId The path ID.
+ *
+ * @return the entry or NULL.
+ *
+ * @since 0.6.3.0
+ */
+static PathListCacheTable* _findAspathList(AspathCache* self, uint32_t pathId)
+{
+  PathListCacheTable* cacheTable = NULL;
+  HASH_FIND(hh, (PathListCacheTable*)self->aspathCacheTable, &pathId, 
+            sizeof(uint32_t), cacheTable);
+  return cacheTable;
+}
+
 
 //
 // To let main call this function to generate UT hash
@@ -69,6 +209,10 @@ bool createAspathCache(AspathCache* self, ASPA_DBManager* aspaDBManager)
   // element that will be added.
   self->aspathCacheTable = NULL;
   self->aspaDBManager = aspaDBManager;
+  self->epoch         = 0;
+  self->readers[0]    = 0;
+  self->readers[1]    = 0;
+  self->retired       = NULL;
  
   return true;
 }
@@ -79,51 +223,90 @@ void releaseAspathCache(AspathCache* self)
 
   if (self != NULL)
   {
-    releaseRWLock(&self->tableLock);
     emptyAspathCache(self);
+    // No reader is left at this point.
+    acquireWriteLock(&self->tableLock);
+    _reclaimEntries(self, true);
+    unlockWriteLock(&self->tableLock);
+    releaseRWLock(&self->tableLock);
   }
 
 }
 
 void emptyAspathCache(AspathCache* self)
 {
+  PathListCacheTable *cacheTable, *tmp;
+
   acquireWriteLock(&self->tableLock);
+  HASH_ITER(hh, (PathListCacheTable*)self->aspathCacheTable, cacheTable, tmp)
+  {
+    _retireEntry(self, cacheTable);
+  }
   self->aspathCacheTable = NULL;
+  _reclaimEntries(self, false);
   unlockWriteLock(&self->tableLock);
 
 }
 
-static void add_AspathList (AspathCache *self, PathListCacheTable *cacheTable)
-{
 
-  acquireWriteLock(&self->tableLock);
-  HASH_ADD (hh, *((PathListCacheTable**)&self->aspathCacheTable), pathId, sizeof(uint32_t), cacheTable);
-  unlockWriteLock(&self->tableLock);
-
-}
-
-static bool find_AspathList (AspathCache* self, uint32_t pathId, PathListCacheTable **p_cacheTable)
+AS_PATH_LIST* newAspathListEntry (uint32_t length, uint32_t* pathData, uint32_t pathId, AS_TYPE asType, 
+                                  AS_REL_DIR asRelDir, uint16_t afi, bool bBigEndian)
 {
-  acquireReadLock(&self->tableLock);
-  HASH_FIND(hh, (PathListCacheTable*)self->aspathCacheTable, &pathId, sizeof(uint32_t), (*p_cacheTable));
-  unlockReadLock(&self->tableLock);
+  // The router only sends the ASes of the AS_SEQUENCE segments, the type 
+  // tells if the path contained another segment type.
+  AS_PATH_SEGMENT segments[2];
+  uint8_t         numSegments = 0;
 
-  return (*p_cacheTable != NULL);
-}
+  if (!length || length > UINT16_MAX)
+  {
+    LOG(LEVEL_ERROR, "Error with no length");
+    return NULL;
+  }
 
+  if (asType != AS_SEQUENCE)
+  {
+    segments[numSegments].type   = asType;
+    segments[numSegments].length = 0;
+    numSegments++;
+  }
+  segments[numSegments].type   = AS_SEQUENCE;
+  segments[numSegments].length = length;
+  numSegments++;
 
-static void del_AspathList (AspathCache* self, PathListCacheTable *cacheTable)
-{
-  acquireWriteLock(&self->tableLock);
-  HASH_DEL (*((PathListCacheTable**)&self->aspathCacheTable), cacheTable);
-  unlockWriteLock(&self->tableLock);
+  return newAspathListEntryFromSegments(numSegments, segments, pathData, 
+                                        pathId, asRelDir, afi, bBigEndian);
 }
 
-
-AS_PATH_LIST* newAspathListEntry (uint32_t length, uint32_t* pathData, uint32_t pathId, AS_TYPE asType, 
-                                  AS_REL_DIR asRelDir, uint16_t afi, bool bBigEndian)
+/**
+ * Create a new AS path list entry out of the given segments. Consecutive 
+ * equal ASNs within AS_SEQUENCE segments and across adjacent AS_SEQUENCE 
+ * segments (prepends) are stored only once.
+ *
+ * @param numSegments The number of segments.
+ * @param segments The segments, their lengths refer to pathData.
+ * @param pathData The ASes of all segments.
+ * @param pathId The path ID.
+ * @param asRelDir The direction of the AS relationship.
+ * @param afi The address family.
+ * @param bBigEndian Indicates if pathData and afi are in network format.
+ *
+ * @return the new entry or NULL.
+ *
+ * @since 0.6.3.0
+ */
+AS_PATH_LIST* newAspathListEntryFromSegments (uint8_t numSegments, 
+                                  AS_PATH_SEGMENT* segments, uint32_t* pathData,
+                                  uint32_t pathId, AS_REL_DIR asRelDir, 
+                                  uint16_t afi, bool bBigEndian)
 {
-  if (!length)
+  uint32_t total = 0;
+  int      seg, idx;
+
+  for (seg = 0; seg < numSegments; seg++)
+  {
+    total += segments[seg].length;
+  }
+  if (total == 0 || total > UINT16_MAX)
   {
     LOG(LEVEL_ERROR, "Error with no length");
     return NULL;
@@ -132,26 +315,50 @@ AS_PATH_LIST* newAspathListEntry (uint32_t length, uint32_t* pathData, uint32_t
   AS_PATH_LIST* pAspathList; 
   pAspathList   = (AS_PATH_LIST*)calloc(1, sizeof(AS_PATH_LIST));
   pAspathList->pathID       = pathId;
-  pAspathList->asPathLength = length;
-  pAspathList->asPathList   = (uint32_t*)calloc(length, sizeof(uint32_t));
-  pAspathList->asType       = asType;
+  pAspathList->asPathList   = (uint32_t*)calloc(total, sizeof(uint32_t));
+  pAspathList->numSegments  = numSegments;
+  pAspathList->segments     = (AS_PATH_SEGMENT*)calloc(numSegments, 
+                                                      sizeof(AS_PATH_SEGMENT));
+  pAspathList->asType       = AS_SEQUENCE;
   pAspathList->asRelDir     = asRelDir;
   pAspathList->afi          = bBigEndian ? ntohs(afi): afi;
   pAspathList->lastModified = 0;
 
-  int idx;
-  
-  for (idx = 0; idx < length; idx++)
+  uint16_t length  = 0;
+  uint32_t dataIdx = 0;
+  // Indicates if the previous AS belongs to an AS_SEQUENCE segment
+  bool     prevSeq = false;
+
+  for (seg = 0; seg < numSegments; seg++)
   {
-    if(bBigEndian)
+    bool     isSeq  = segments[seg].type == AS_SEQUENCE;
+    uint16_t segLen = 0;
+
+    if (!isSeq && pAspathList->asType == AS_SEQUENCE)
     {
-      pAspathList->asPathList[idx] = ntohl(pathData[idx]);
+      pAspathList->asType = segments[seg].type;
     }
-    else
+
+    for (idx = 0; idx < segments[seg].length; idx++)
     {
-      pAspathList->asPathList[idx] = pathData[idx];
+      uint32_t asn = bBigEndian ? ntohl(pathData[dataIdx]) : pathData[dataIdx];
+      dataIdx++;
+
+      // Skip prepends, they do not add a hop.
+      if (isSeq && (segLen > 0 || prevSeq) 
+          && pAspathList->asPathList[length-1] == asn)
+      {
+        continue;
+      }
+      pAspathList->asPathList[length++] = asn;
+      segLen++;
     }
+
+    pAspathList->segments[seg].type   = segments[seg].type;
+    pAspathList->segments[seg].length = segLen;
+    prevSeq = isSeq ? (prevSeq || segLen > 0) : false;
   }
+  pAspathList->asPathLength = length;
 
   return pAspathList;
 }
@@ -176,6 +383,15 @@ void printAsPathList(AS_PATH_LIST* aspl)
         LOG(LEVEL_INFO, "\tPath List[%d]: %d "   , idx, aspl->asPathList[idx]);
       }
     }
+    if(aspl->segments)
+    {
+      int idx;
+      for (idx = 0; idx < aspl->numSegments; idx++)
+      {
+        LOG(LEVEL_INFO, "\tSegment[%d]: type %d length %d", idx, 
+            aspl->segments[idx].type, aspl->segments[idx].length);
+      }
+    }
   }
   else
   {
@@ -193,6 +409,10 @@ bool deleteAspathListEntry (AS_PATH_LIST* aspl)
   {
     free(aspl->asPathList);
   }
+  if (aspl->segments)
+  {
+    free(aspl->segments);
+  }
 
   free(aspl);
 
@@ -201,12 +421,15 @@ bool deleteAspathListEntry (AS_PATH_LIST* aspl)
 
 
 bool modifyAspaValidationResultToAspathCache(AspathCache *self, uint32_t pathId,
-                      uint8_t modAspaResult, AS_PATH_LIST* pathlistEntry)
+                      uint8_t modAspaResult, time_t lastModified)
 {
   bool retVal = true;
   PathListCacheTable *plCacheTable;
 
-  if (!find_AspathList (self, pathId, &plCacheTable))
+  // The read lock suffices, only the atomic values of the entry change.
+  acquireReadLock(&self->tableLock);
+  plCacheTable = _findAspathList(self, pathId);
+  if (plCacheTable == NULL)
   {
     RAISE_SYS_ERROR("Does not exist in aspath list cache, can not modify it!");
     retVal = false;
@@ -216,17 +439,20 @@ bool modifyAspaValidationResultToAspathCache(AspathCache *self, uint32_t pathId,
     if(modAspaResult != SRx_RESULT_DONOTUSE)
     {
       // access time updated
-      plCacheTable->lastModified = pathlistEntry->lastModified;
-      LOG(LEVEL_INFO, "AspathCache entry for path ID: 0x%08X - last modfied time update: %u", pathId, plCacheTable->lastModified);
+      __atomic_store_n(&plCacheTable->list.lastModified, lastModified, 
+                       __ATOMIC_RELAXED);
+      LOG(LEVEL_INFO, "AspathCache entry for path ID: 0x%08X - last modfied time update: %u", pathId, lastModified);
 
-      if(modAspaResult != plCacheTable->aspaResult)
+      if(__atomic_exchange_n(&plCacheTable->list.aspaValResult, modAspaResult,
+                             __ATOMIC_RELAXED) != modAspaResult)
       {
-        plCacheTable->aspaResult   = modAspaResult;
         LOG(LEVEL_INFO, FILE_LINE_INFO " AS path cache data modified [pathID]:0x%08X [Value]: %d [Time]: %u", 
-            pathId, modAspaResult, plCacheTable->lastModified);
+            pathId, modAspaResult, lastModified);
       }
     }
   }
+  unlockReadLock(&self->tableLock);
+
   return retVal;
 }
 
@@ -241,65 +467,87 @@ int storeAspathList (AspathCache* self, SRxDefaultResult* srxRes,
     return -1;
   }
 
+  // Prepare the entry outside of the lock
   PathListCacheTable *plCacheTable;
-  
-  if (find_AspathList (self, pathId, &plCacheTable))
+  plCacheTable = (PathListCacheTable*) calloc(1, sizeof(PathListCacheTable));
+  plCacheTable->pathId            = pathId;
+  plCacheTable->list.pathID       = pathId;
+  plCacheTable->list.asType       = asType;
+  plCacheTable->list.asRelDir     = pathlistEntry->asRelDir;
+  plCacheTable->list.afi          = pathlistEntry->afi;
+  plCacheTable->list.lastModified = pathlistEntry->lastModified;
+
+  uint16_t length = pathlistEntry->asPathLength;
+
+  // copy by value, NOT by reference.  Because path list Entry should be freed later
+  //
+  if ( length > 0 && pathlistEntry->asPathList)
   {
-    LOG(LEVEL_WARNING, "Attempt to store an update that already exists in as path cache!");
-    retVal = 0;
+    plCacheTable->list.asPathLength = length;
+    plCacheTable->list.asPathList = (PATH_LIST*) calloc(length, sizeof(PATH_LIST));
+    memcpy(plCacheTable->list.asPathList, pathlistEntry->asPathList, 
+           length * sizeof(PATH_LIST));
   }
-  else
+  if (pathlistEntry->numSegments > 0 && pathlistEntry->segments)
   {
-    plCacheTable = (PathListCacheTable*) calloc(1, sizeof(PathListCacheTable));
-    plCacheTable->pathId       = pathId;
-    plCacheTable->asType       = asType;
-    plCacheTable->asRelDir     = pathlistEntry->asRelDir;
-    plCacheTable->afi          = pathlistEntry->afi;
-    plCacheTable->lastModified = pathlistEntry->lastModified;
-
-    uint8_t length = pathlistEntry->asPathLength;
-    plCacheTable->data.hops = length;
+    plCacheTable->list.numSegments = pathlistEntry->numSegments;
+    plCacheTable->list.segments = (AS_PATH_SEGMENT*) calloc(
+                       pathlistEntry->numSegments, sizeof(AS_PATH_SEGMENT));
+    memcpy(plCacheTable->list.segments, pathlistEntry->segments, 
+           pathlistEntry->numSegments * sizeof(AS_PATH_SEGMENT));
+  }
 
-    // copy by value, NOT by reference.  Because path list Entry should be freed later
-    //
-    if ( length > 0 && pathlistEntry->asPathList)
-    {
-      int idx;
-      plCacheTable->data.asPathList = (PATH_LIST*) calloc(length, sizeof(PATH_LIST));
-      for (idx = 0; idx < length; idx++)
-      {
-        plCacheTable->data.asPathList[idx] = pathlistEntry->asPathList[idx];
-      }
-    }
+  if (srxRes != NULL)
+  {
+    plCacheTable->list.aspaValResult = srxRes->result.aspaResult;
+  }
 
-    if (srxRes != NULL)
-    {
-      plCacheTable->aspaResult = srxRes->result.aspaResult;
-    }
+  acquireWriteLock(&self->tableLock);
+  if (_findAspathList(self, pathId) != NULL)
+  {
+    retVal = 0;
+  }
+  else
+  {
+    HASH_ADD (hh, *((PathListCacheTable**)&self->aspathCacheTable), pathId, 
+              sizeof(uint32_t), plCacheTable);
+  }
+  _reclaimEntries(self, false);
+  unlockWriteLock(&self->tableLock);
 
-    add_AspathList(self, plCacheTable);
+  if (retVal == 0)
+  {
+    LOG(LEVEL_WARNING, "Attempt to store an update that already exists in as path cache!");
+    _freeCacheEntry(plCacheTable);
+  }
+  else
+  {
     LOG(LEVEL_INFO, FILE_LINE_INFO " performed to add PathList Entry into As Path Cache");
-
   }
 
   return retVal;
 }
 
 
-// delete function for calling del_AspathList to remove the cache data
+// delete function to remove the cache data regardless of its references
 //
 bool deleteAspathCache(AspathCache* self, uint32_t pathId, AS_PATH_LIST* pathlistEntry)
 {
   bool bRet= false;
   PathListCacheTable *plCacheTable;
   
-  if (find_AspathList (self, pathId, &plCacheTable))
+  acquireWriteLock(&self->tableLock);
+  plCacheTable = _findAspathList(self, pathId);
+  if (plCacheTable != NULL)
   {
     LOG(LEVEL_INFO, FILE_LINE_INFO " Deleting PathList Cache Entry");
-    del_AspathList(self, plCacheTable);
+    _retireEntry(self, plCacheTable);
+    _reclaimEntries(self, false);
     bRet = true;
   }
-  else
+  unlockWriteLock(&self->tableLock);
+
+  if (!bRet)
   {
     LOG(LEVEL_WARNING, " Attempted to find from AS path cache, But not found");
   }
@@ -307,55 +555,180 @@ bool deleteAspathCache(AspathCache* self, uint32_t pathId, AS_PATH_LIST* pathlis
 }
 
 
+/**
+ * Add a reference of an update to the path.
+ *
+ * @param self The AS path cache.
+ * @param pathId The path ID.
+ *
+ * @return true if the path was found.
+ *
+ * @since 0.6.3.0
+ */
+bool addAspathListReference(AspathCache* self, uint32_t pathId)
+{
+  PathListCacheTable* plCacheTable;
+
+  // Removals require the write lock, the counter can be incremented under
+  // the read lock.
+  acquireReadLock(&self->tableLock);
+  plCacheTable = _findAspathList(self, pathId);
+  if (plCacheTable != NULL)
+  {
+    __atomic_add_fetch(&plCacheTable->refCount, 1, __ATOMIC_RELAXED);
+  }
+  unlockReadLock(&self->tableLock);
+
+  return plCacheTable != NULL;
+}
+
+/**
+ * Remove the reference of an update from the path. The path is removed from
+ * the cache with its last reference.
+ *
+ * @param self The AS path cache.
+ * @param pathId The path ID.
+ *
+ * @return true if the path was found.
+ *
+ * @since 0.6.3.0
+ */
+bool removeAspathListReference(AspathCache* self, uint32_t pathId)
+{
+  PathListCacheTable* plCacheTable;
+
+  acquireWriteLock(&self->tableLock);
+  plCacheTable = _findAspathList(self, pathId);
+  if (plCacheTable != NULL && plCacheTable->refCount > 0)
+  {
+    plCacheTable->refCount--;
+    if (plCacheTable->refCount == 0)
+    {
+      LOG(LEVEL_DEBUG, HDR "Remove unused path [ID:0x%08X]", pthread_self(),
+          pathId);
+      _retireEntry(self, plCacheTable);
+      _reclaimEntries(self, false);
+    }
+  }
+  unlockWriteLock(&self->tableLock);
+
+  return plCacheTable != NULL;
+}
+
+
 // key : path id to find AS path cache record
 // return: a new AS PATH LIST structure
 //
 AS_PATH_LIST* getAspathListFromAspathCache (AspathCache* self, uint32_t pathId, SRxResult* srxRes)
 {
+  uint32_t      epoch;
+  AS_PATH_LIST* aspl   = NULL;
+  AS_PATH_LIST* cached = borrowAspathList(self, pathId, srxRes, &epoch);
+  
+  if (cached != NULL)
+  {
+    aspl = (AS_PATH_LIST*)calloc(1, sizeof(AS_PATH_LIST));
+    aspl->pathID        = cached->pathID;
+    aspl->asPathLength  = cached->asPathLength;
+    // srxRes is optional, borrowAspathList only fills it if provided.
+    aspl->aspaValResult = srxRes != NULL
+                          ? srxRes->aspaResult
+                          : __atomic_load_n(&cached->aspaValResult,
+                                            __ATOMIC_RELAXED);
+    aspl->asType        = cached->asType;
+    aspl->asRelDir      = cached->asRelDir;
+    aspl->afi           = cached->afi;
+    aspl->lastModified  = __atomic_load_n(&cached->lastModified, 
+                                          __ATOMIC_RELAXED);
+
+    uint16_t length    = cached->asPathLength;
+    aspl->asPathList   = (uint32_t*)calloc(length, sizeof(uint32_t));
+    if ( length > 0 && cached->asPathList)
+    {
+      memcpy(aspl->asPathList, cached->asPathList, length * sizeof(uint32_t));
+    }
+    if (cached->numSegments > 0 && cached->segments)
+    {
+      aspl->numSegments = cached->numSegments;
+      aspl->segments    = (AS_PATH_SEGMENT*)calloc(aspl->numSegments, 
+                                                  sizeof(AS_PATH_SEGMENT));
+      memcpy(aspl->segments, cached->segments, 
+             aspl->numSegments * sizeof(AS_PATH_SEGMENT));
+    }
+    returnAspathList(self, epoch);
+  }
+
+  return aspl;
+}
+
+
+/**
+ * Same as getAspathListFromAspathCache but without a copy. The returned AS 
+ * path list is the one stored in the cache, it stays valid until it is 
+ * returned with returnAspathList, even if it is removed from the cache in 
+ * between. The list MUST NOT be modified, its ASPA result and modification
+ * time change atomically with modifyAspaValidationResultToAspathCache.
+ *
+ * @param self The AS path cache.
+ * @param pathId The path ID.
+ * @param srxRes (out) The ASPA result is set as in 
+ *               getAspathListFromAspathCache. Can be NULL.
+ * @param epoch (out) The epoch to be handed to returnAspathList.
+ *
+ * @return the borrowed path or NULL if not found.
+ *
+ * @since 0.6.3.0
+ */
+AS_PATH_LIST* borrowAspathList(AspathCache* self, uint32_t pathId, 
+                               SRxResult* srxRes, uint32_t* epoch)
+{
+  PathListCacheTable *plCacheTable = NULL;
+
   if (!pathId)
   {
     LOG(LEVEL_ERROR, "Invalid path id");
     return NULL;
   }
 
-  AS_PATH_LIST *aspl = NULL;
-  PathListCacheTable *plCacheTable;
-  
-  if (find_AspathList (self, pathId, &plCacheTable))
+  // The epoch is entered before the entry can be seen.
+  *epoch = _enterEpoch(self);
+  acquireReadLock(&self->tableLock);
+  plCacheTable = _findAspathList(self, pathId);
+  unlockReadLock(&self->tableLock);
+
+  if (plCacheTable == NULL)
   {
-    aspl = (AS_PATH_LIST*)calloc(1, sizeof(AS_PATH_LIST));
-    aspl->pathID        = plCacheTable->pathId;
-    aspl->asPathLength  = plCacheTable->data.hops;
-    aspl->aspaValResult = plCacheTable->aspaResult;
-    aspl->asType        = plCacheTable->asType;
-    aspl->asRelDir      = plCacheTable->asRelDir;
-    aspl->afi           = plCacheTable->afi;
-    aspl->lastModified  = plCacheTable->lastModified;
-
-    uint8_t length     = plCacheTable->data.hops;
-    aspl->asPathList   = (uint32_t*)calloc(length, sizeof(uint32_t));
-    if ( length > 0 && plCacheTable->data.asPathList)
+    _leaveEpoch(self, *epoch);
+    if (srxRes != NULL)
     {
-      int idx;
-      for (idx = 0; idx < length; idx++)
-      {
-        aspl->asPathList[idx] = plCacheTable->data.asPathList[idx];
-      }
+      srxRes->aspaResult = SRx_RESULT_UNDEFINED;
     }
-
-    if (srxRes->aspaResult != aspl->aspaValResult)
-      srxRes->aspaResult  = aspl->aspaValResult;
+    return NULL;
   }
-  else
+
+  if (srxRes != NULL)
   {
-    srxRes->aspaResult = SRx_RESULT_UNDEFINED;
+    srxRes->aspaResult = __atomic_load_n(&plCacheTable->list.aspaValResult,
+                                         __ATOMIC_RELAXED);
   }
 
-  return aspl;
+  return &plCacheTable->list;
 }
 
+/**
+ * Return the path borrowed with borrowAspathList.
+ *
+ * @param self The AS path cache.
+ * @param epoch The epoch returned by borrowAspathList.
+ *
+ * @since 0.6.3.0
+ */
+void returnAspathList(AspathCache* self, uint32_t epoch)
+{
+  _leaveEpoch(self, epoch);
+}
 
-uint32_t makePathId (uint8_t asPathLength, PATH_LIST* asPathList, AS_TYPE asType, bool bBigEndian)
+uint32_t makePathId (uint16_t asPathLength, PATH_LIST* asPathList, AS_TYPE asType, bool bBigEndian)
 {
   uint32_t pathId=0;
   char* strBuf = NULL;
@@ -399,19 +772,22 @@ void printPathListCacheTableEntry(PathListCacheTable *cacheEntry)
 {
   if (cacheEntry)
   {
+    AS_PATH_LIST* aspl = &cacheEntry->list;
+
     printf( "\n");
     printf( " path ID           : 0x%08X\n" , cacheEntry->pathId);
-    printf( " length (hops)     : %d\n"  , cacheEntry->data.hops);
-    printf( " Validation Result : %d\n"  , cacheEntry->aspaResult);
+    printf( " length (hops)     : %d\n"  , aspl->asPathLength);
+    printf( " Validation Result : %d\n"  , aspl->aspaValResult);
     printf( " \t(0:valid, 2:Invalid, 3:Undefined 5:Unknown, 6:Unverifiable)\n");
-    printf( " AS Path Type      : %d\n"  , cacheEntry->asType);
+    printf( " AS Path Type      : %d\n"  , aspl->asType);
+    printf( " References        : %u\n"  , cacheEntry->refCount);
 
-    if (cacheEntry->data.asPathList)
+    if (aspl->asPathList)
     {
       int idx;
-      for(idx = 0; idx < cacheEntry->data.hops; idx++)
+      for(idx = 0; idx < aspl->asPathLength; idx++)
       {
-        printf( " - Path List[%d]: %d \n", idx, cacheEntry->data.asPathList[idx]);
+        printf( " - Path List[%d]: %d \n", idx, aspl->asPathList[idx]);
       }
       printf( "\n");
     }
@@ -419,6 +795,16 @@ void printPathListCacheTableEntry(PathListCacheTable *cacheEntry)
     {
       printf( " Path List: Doesn't exist \n");
     }
+
+    if (aspl->segments)
+    {
+      int idx;
+      for(idx = 0; idx < aspl->numSegments; idx++)
+      {
+        printf( " - Segment[%d]: type %d length %d\n", idx,
+                aspl->segments[idx].type, aspl->segments[idx].length);
+      }
+    }
   }
   else
   {
@@ -476,3 +862,114 @@ void printAllAsPathCache(AspathCache *self)
 
 
 
+
+/**
+ * Write all paths that are referenced by updates into the SNAP_SEC_ASPATH
+ * section of the snapshot.
+ *
+ * @param self The AS path cache.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool writeAspathCacheSnapshot(AspathCache* self, SnapshotWriter* writer)
+{
+  PathListCacheTable *currCacheTable, *tmp;
+  SnapshotAspathRecord record;
+  uint32_t count  = 0;
+  bool     retVal = beginSnapshotSection(writer, SNAP_SEC_ASPATH);
+
+  memset(&record, 0, sizeof(SnapshotAspathRecord));
+  acquireReadLock(&self->tableLock);
+  HASH_ITER(hh, (PathListCacheTable*)self->aspathCacheTable, currCacheTable, 
+            tmp)
+  {
+    if (!retVal)
+    {
+      break;
+    }
+    // Paths not used by any update are not restored.
+    if (__atomic_load_n(&currCacheTable->refCount, __ATOMIC_RELAXED) == 0)
+    {
+      continue;
+    }
+    record.pathId       = currCacheTable->pathId;
+    record.asPathLength = currCacheTable->list.asPathLength;
+    record.numSegments  = currCacheTable->list.numSegments;
+    record.asType       = currCacheTable->list.asType;
+    record.asRelDir     = currCacheTable->list.asRelDir;
+    record.afi          = currCacheTable->list.afi;
+    record.aspaResult   = __atomic_load_n(&currCacheTable->list.aspaValResult,
+                                          __ATOMIC_RELAXED);
+    record.lastModified = __atomic_load_n(&currCacheTable->list.lastModified,
+                                          __ATOMIC_RELAXED);
+    retVal =    addSnapshotData(writer, &record, sizeof(SnapshotAspathRecord))
+             && addSnapshotData(writer, currCacheTable->list.segments,
+                                record.numSegments * sizeof(AS_PATH_SEGMENT))
+             && addSnapshotData(writer, currCacheTable->list.asPathList,
+                                record.asPathLength * sizeof(PATH_LIST));
+    count++;
+  }
+  unlockReadLock(&self->tableLock);
+
+  return retVal && endSnapshotSection(writer, count);
+}
+
+/**
+ * Store the paths of the SNAP_SEC_ASPATH section of the snapshot including
+ * their ASPA results. The paths are not referenced until the updates are
+ * restored.
+ *
+ * @param self The AS path cache.
+ * @param reader The snapshot reader.
+ *
+ * @return the number of restored paths or -1 if the section is corrupted.
+ *
+ * @since 0.6.3.0
+ */
+int readAspathCacheSnapshot(AspathCache* self, SnapshotReader* reader)
+{
+  SnapshotCursor              cursor;
+  const SnapshotAspathRecord* record;
+  SRxDefaultResult            defRes;
+  AS_PATH_LIST                aspl;
+  uint32_t                    idx;
+
+  if (!findSnapshotSection(reader, SNAP_SEC_ASPATH, &cursor))
+  {
+    return 0;
+  }
+
+  memset(&defRes, 0, sizeof(SRxDefaultResult));
+  for (idx = 0; idx < cursor.count; idx++)
+  {
+    record = getSnapshotData(&cursor, sizeof(SnapshotAspathRecord));
+    if (record == NULL)
+    {
+      return -1;
+    }
+    memset(&aspl, 0, sizeof(AS_PATH_LIST));
+    aspl.pathID       = record->pathId;
+    aspl.asPathLength = record->asPathLength;
+    aspl.numSegments  = record->numSegments;
+    aspl.asType       = record->asType;
+    aspl.asRelDir     = record->asRelDir;
+    aspl.afi          = record->afi;
+    aspl.lastModified = record->lastModified;
+    // storeAspathList copies the data out of the snapshot.
+    aspl.segments     = (AS_PATH_SEGMENT*)getSnapshotData(&cursor,
+                               record->numSegments * sizeof(AS_PATH_SEGMENT));
+    aspl.asPathList   = (PATH_LIST*)getSnapshotData(&cursor,
+                               record->asPathLength * sizeof(PATH_LIST));
+    if ((aspl.segments == NULL) || (aspl.asPathList == NULL))
+    {
+      return -1;
+    }
+    defRes.result.aspaResult = record->aspaResult;
+    storeAspathList(self, &defRes, record->pathId, record->asType, &aspl);
+  }
+
+  return cursor.count;
+}
@@ -41,29 +41,39 @@
 #include "util/slist.h"
 #include "server/update_cache.h"
 #include "server/aspa_trie.h"
+#include "server/snapshot.h"
 
 typedef uint32_t as_t;
 typedef uint32_t PATH_LIST;
 
-// AS Path List structure
+/** The maximum number of segments of an AS path. */
+#define MAX_AS_PATH_SEGMENTS 255
+
+// A segment of the AS path
+typedef struct {
+  /** The segment type (AS_SEQUENCE, AS_SET, ...) */
+  uint8_t       type;
+  /** The number of ASes of the segment within the AS path list. */
+  uint16_t      length;
+} AS_PATH_SEGMENT;
+
+// AS Path List structure. The segments are in the same order as the ASes, the
+// sum of their lengths is asPathLength. Consecutive equal ASNs (prepends) are
+// stored only once.
 typedef struct {
-  uint32_t      pathID;
-  uint8_t       asPathLength;
-  PATH_LIST*    asPathList;
-  uint8_t       aspaValResult;
-  AS_TYPE       asType;
-  AS_REL_DIR    asRelDir;
-  uint16_t      afi;
-  time_t        lastModified;
+  uint32_t          pathID;
+  uint16_t          asPathLength;
+  PATH_LIST*        asPathList;
+  uint8_t           numSegments;
+  AS_PATH_SEGMENT*  segments;
+  uint8_t           aspaValResult;
+  AS_TYPE           asType;
+  AS_REL_DIR        asRelDir;
+  uint16_t          afi;
+  time_t            lastModified;
 } AS_PATH_LIST;
 
 
-
-typedef struct {
-  uint16_t              hops;
-  PATH_LIST*            asPathList;
-} AC_PathListData;
-
 // TODO: 
 
 
@@ -76,6 +86,12 @@ typedef struct {
   void              *aspathCacheTable;
   RWLock            tableLock;
   ASPA_DBManager    *aspaDBManager;
+  /** The reclamation epoch, see borrowAspathList. */
+  volatile uint32_t epoch;
+  /** The number of readers within an even and odd epoch. */
+  volatile uint32_t readers[2];
+  /** The removed entries, freed once no reader can see them anymore. */
+  void              *retired;
 } AspathCache;
 
 
@@ -84,16 +100,120 @@ void releaseAspathCache(AspathCache* self);
 void emptyAspathCache(AspathCache* self);
 AS_PATH_LIST* newAspathListEntry (uint32_t length, uint32_t* pathData, uint32_t pathId, 
                                   AS_TYPE asType, AS_REL_DIR asRelDir, uint16_t afi, bool bBigEndian);
+
+/**
+ * Create a new AS path list entry out of the given segments. Consecutive 
+ * equal ASNs within AS_SEQUENCE segments and across adjacent AS_SEQUENCE 
+ * segments (prepends) are stored only once.
+ *
+ * @param numSegments The number of segments.
+ * @param segments The segments, their lengths refer to pathData.
+ * @param pathData The ASes of all segments.
+ * @param pathId The path ID.
+ * @param asRelDir The direction of the AS relationship.
+ * @param afi The address family.
+ * @param bBigEndian Indicates if pathData and afi are in network format.
+ *
+ * @return the new entry or NULL.
+ *
+ * @since 0.6.3.0
+ */
+AS_PATH_LIST* newAspathListEntryFromSegments (uint8_t numSegments, 
+                                  AS_PATH_SEGMENT* segments, uint32_t* pathData,
+                                  uint32_t pathId, AS_REL_DIR asRelDir, 
+                                  uint16_t afi, bool bBigEndian);
 int storeAspathList (AspathCache* self, SRxDefaultResult* defRes, uint32_t pathId, AS_TYPE, AS_PATH_LIST* pathlistEntry);
 AS_PATH_LIST* getAspathListFromAspathCache (AspathCache* self, uint32_t pathId, SRxResult* srxRes);
+
+/**
+ * Same as getAspathListFromAspathCache but without a copy. The returned AS 
+ * path list is the one stored in the cache, it stays valid until it is 
+ * returned with returnAspathList, even if it is removed from the cache in 
+ * between. The list MUST NOT be modified, its ASPA result and modification
+ * time change atomically with modifyAspaValidationResultToAspathCache.
+ *
+ * @param self The AS path cache.
+ * @param pathId The path ID.
+ * @param srxRes (out) The ASPA result is set as in 
+ *               getAspathListFromAspathCache. Can be NULL.
+ * @param epoch (out) The epoch to be handed to returnAspathList.
+ *
+ * @return the borrowed path or NULL if not found.
+ *
+ * @since 0.6.3.0
+ */
+AS_PATH_LIST* borrowAspathList(AspathCache* self, uint32_t pathId, 
+                               SRxResult* srxRes, uint32_t* epoch);
+
+/**
+ * Return the path borrowed with borrowAspathList.
+ *
+ * @param self The AS path cache.
+ * @param epoch The epoch returned by borrowAspathList.
+ *
+ * @since 0.6.3.0
+ */
+void returnAspathList(AspathCache* self, uint32_t epoch);
+
+/**
+ * Add a reference of an update to the path.
+ *
+ * @param self The AS path cache.
+ * @param pathId The path ID.
+ *
+ * @return true if the path was found.
+ *
+ * @since 0.6.3.0
+ */
+bool addAspathListReference(AspathCache* self, uint32_t pathId);
+
+/**
+ * Remove the reference of an update from the path. The path is removed from
+ * the cache with its last reference.
+ *
+ * @param self The AS path cache.
+ * @param pathId The path ID.
+ *
+ * @return true if the path was found.
+ *
+ * @since 0.6.3.0
+ */
+bool removeAspathListReference(AspathCache* self, uint32_t pathId);
 void printAsPathList(AS_PATH_LIST* aspl);
-uint32_t makePathId (uint8_t asPathLength, PATH_LIST* asPathList, AS_TYPE asType, bool bBigEndian);
+uint32_t makePathId (uint16_t asPathLength, PATH_LIST* asPathList, AS_TYPE asType, bool bBigEndian);
 bool modifyAspaValidationResultToAspathCache(AspathCache *self, uint32_t pathId,
-                      uint8_t modAspaResult, AS_PATH_LIST* pathlistEntry);
+                      uint8_t modAspaResult, time_t lastModified);
 
 bool deleteAspathListEntry (AS_PATH_LIST* aspl);
 void printAllAsPathCache(AspathCache *self);
 
+/**
+ * Write all paths that are referenced by updates into the SNAP_SEC_ASPATH
+ * section of the snapshot.
+ *
+ * @param self The AS path cache.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool writeAspathCacheSnapshot(AspathCache* self, SnapshotWriter* writer);
+
+/**
+ * Store the paths of the SNAP_SEC_ASPATH section of the snapshot including
+ * their ASPA results. The paths are not referenced until the updates are
+ * restored.
+ *
+ * @param self The AS path cache.
+ * @param reader The snapshot reader.
+ *
+ * @return the number of restored paths or -1 if the section is corrupted.
+ *
+ * @since 0.6.3.0
+ */
+int readAspathCacheSnapshot(AspathCache* self, SnapshotReader* reader);
+
 
 
 
@@ -42,16 +42,61 @@
  *            * Code created.
  */
 
+#include <malloc.h>
+#include <string.h>
+#include <arpa/inet.h>
 #include "server/bgpsec_handler.h"
 #include "server/main.h"
 #include "util/log.h"
 
+/**
+ * Free the hash message the same way validateSignature does.
+ *
+ * @param self The BGPsec Handler itself
+ * @param hashMessage The hash message to be freed (can be NULL)
+ */
+static void _freeHashMessage(BGPSecHandler* self, SCA_HashMessage* hashMessage)
+{
+  if (hashMessage != NULL)
+  {
+    if (!self->srxCAPI->freeHashMessage(hashMessage))
+    {
+      free(hashMessage);
+    }
+  }
+}
+
+/**
+ * Return the private key registered for the given ASN and algorithm.
+ *
+ * @param self The BGPsec Handler itself
+ * @param asn The ASN in host format
+ * @param algoID The algorithm suite identifier
+ *
+ * @return The key or NULL if none is registered.
+ */
+static BGPSecSignKey* _getSignKey(BGPSecHandler* self, uint32_t asn, 
+                                  uint8_t algoID)
+{
+  int idx;
+  for (idx = 0; idx < self->numSignKeys; idx++)
+  {
+    if (   (self->signKeys[idx].asn == asn) 
+        && (self->signKeys[idx].algoID == algoID))
+    {
+      return &self->signKeys[idx];
+    }
+  }
+  return NULL;
+}
+
 bool createBGPSecHandler(BGPSecHandler* self, KeyCache* keyCache)
 {
   LOG(LEVEL_DEBUG, FILE_LINE_INFO
                  " createBGPSecHandler is not implemented yet - returns true!");
   self->keyCache = keyCache;
   self->srxCAPI = getSrxCAPI();
+  self->numSignKeys = 0;
   return true;
 }
 
@@ -61,11 +106,72 @@ void releaseBGPSecHandler(BGPSecHandler* self)
       FILE_LINE_INFO "releaseBGPSecHandler is not implemented yet!");
 }
 
-bool loadPrivateKey(BGPSecHandler* self, const char* filename)
+/**
+ * Loads a private key from the key vault of the SRxCryptoAPI and registers it
+ * with the API. At least one call is necessary before createSignature can be 
+ * used.
+ *
+ * @param self Instance
+ * @param asn The ASN the key belongs to (host format)
+ * @param algoID The algorithm suite identifier of the key
+ * @param ski The SKI of the key
+ * 
+ * @return true = key loaded, false = invalid key, or file does not exist
+ */
+bool loadPrivateKey(BGPSecHandler* self, uint32_t asn, uint8_t algoID, 
+                    uint8_t* ski)
 {
-  LOG(LEVEL_DEBUG,
-      FILE_LINE_INFO "loadPrivateKey is not implemented yet!");
-  return true;
+  BGPSecKey    key;
+  sca_status_t status = API_STATUS_OK;
+  bool         retVal = false;
+
+  if (self->numSignKeys >= BGPSEC_MAX_SIGN_KEYS)
+  {
+    RAISE_ERROR("Cannot load more than %u private keys!", 
+                BGPSEC_MAX_SIGN_KEYS);
+    return false;
+  }
+  if (_getSignKey(self, asn, algoID) != NULL)
+  {
+    RAISE_ERROR("A private key for AS %u and algorithm %u is already loaded!",
+                asn, algoID);
+    return false;
+  }
+
+  memset(&key, 0, sizeof(BGPSecKey));
+  key.algoID = algoID;
+  key.asn    = htonl(asn);
+  memcpy(key.ski, ski, SKI_LENGTH);
+
+  if (sca_loadKey(&key, true, &status) == API_SUCCESS)
+  {
+    if (self->srxCAPI->registerPrivateKey(&key, &status) == API_SUCCESS)
+    {
+      BGPSecSignKey* signKey = &self->signKeys[self->numSignKeys++];
+      signKey->asn    = asn;
+      signKey->algoID = algoID;
+      memcpy(signKey->ski, ski, SKI_LENGTH);
+      retVal = true;
+    }
+    else
+    {
+      RAISE_ERROR("Could not register the private key of AS %u (status "
+                  "0x%08X)!", asn, status);
+    }
+  }
+  else
+  {
+    RAISE_ERROR("Could not load the private key of AS %u from the key vault "
+                "(status 0x%08X)!", asn, status);
+  }
+
+  if (key.keyData != NULL)
+  {
+    memset(key.keyData, 0, key.keyLength);
+    free(key.keyData);
+  }
+
+  return retVal;
 }
 
 /**
@@ -116,10 +222,157 @@ uint8_t validateSignature(BGPSecHandler* self, UC_UpdateData* update)
   return retVal;
 }
 
-bool createSignature(BGPSecHandler* self)
+/**
+ * Creates the signatures for the given sign requests. All requests a private 
+ * key is registered for are handed to the SRxCryptoAPI in one call. Updates 
+ * without BGPsec_PATH attribute are signed as origination.
+ *
+ * @param self Instance
+ * @param count The number of requests
+ * @param requests The sign requests, each successful request contains the 
+ *                 signature segment once the call returns.
+ * 
+ * @return The number of signatures created.
+ */
+int createSignature(BGPSecHandler* self, int count, 
+                    BGPSecSignRequest* requests)
 {
-  LOG(LEVEL_DEBUG, FILE_LINE_INFO
-                   " createSignature is not implemented yet - returns false!");
-  return false;
+  int retVal = 0;
+  int idx    = 0;
+  int signCt = 0;
+
+  if (count <= 0)
+  {
+    return 0;
+  }
+
+  SCA_BGPSEC_SecurePathSegment* spSeg = malloc(count 
+                                        * sizeof(SCA_BGPSEC_SecurePathSegment));
+  SCA_BGPSecValidationData*     valData = malloc(count 
+                                        * sizeof(SCA_BGPSecValidationData));
+  SCA_BGPSecSignData*           signData = malloc(count 
+                                        * sizeof(SCA_BGPSecSignData));
+  SCA_BGPSecSignData**          signPtr = malloc(count 
+                                        * sizeof(SCA_BGPSecSignData*));
+  if (   (spSeg == NULL) || (valData == NULL) || (signData == NULL) 
+      || (signPtr == NULL))
+  {
+    RAISE_SYS_ERROR("Not enough memory to sign %d updates!", count);
+    free(spSeg);
+    free(valData);
+    free(signData);
+    free(signPtr);
+    return 0;
+  }
+  memset(valData,  0, count * sizeof(SCA_BGPSecValidationData));
+  memset(signData, 0, count * sizeof(SCA_BGPSecSignData));
+
+  // Prepare the sign data of all requests we have a key for.
+  for (idx = 0; idx < count; idx++)
+  {
+    BGPSecSignRequest* req = &requests[idx];
+    BGPSecSignKey*     key = _getSignKey(self, ntohl(req->update->myAS), 
+                                         req->algoID);
+    req->status  = API_STATUS_OK;
+    req->length  = 0;
+    req->segment = NULL;
+
+    if (key == NULL)
+    {
+      req->status = API_STATUS_ERR_INVLID_KEY;
+      continue;
+    }
+
+    spSeg[idx].pCount = req->pCount;
+    spSeg[idx].flags  = req->flags;
+    spSeg[idx].asn    = req->update->myAS;
+
+    if (req->update->bgpsec_path != NULL)
+    {
+      // Forwarding an update - the hash message is generated from the path.
+      valData[idx].myAS             = req->update->myAS;
+      valData[idx].status           = API_STATUS_OK;
+      valData[idx].bgpsec_path_attr = (uint8_t*)req->update->bgpsec_path;
+      valData[idx].nlri             = &req->update->nlri;
+      if (sca_generateHashMessage(&valData[idx], req->algoID, 
+                                  &valData[idx].status) == 0)
+      {
+        req->status = valData[idx].status | API_STATUS_ERR_NO_DATA;
+        _freeHashMessage(self, valData[idx].hashMessage[0]);
+        continue;
+      }
+    }
+
+    // The deprecated fields are still used by the API for originations.
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    signData[idx].peerAS      = htonl(req->peerAS);
+    signData[idx].myHost      = &spSeg[idx];
+    signData[idx].nlri        = &req->update->nlri;
+    #pragma GCC diagnostic pop
+    signData[idx].myASN       = req->update->myAS;
+    signData[idx].ski         = key->ski;
+    signData[idx].algorithmID = req->algoID;
+    signData[idx].status      = API_STATUS_OK;
+    signData[idx].hashMessage = valData[idx].hashMessage[0];
+    signData[idx].signature   = NULL;
+    signPtr[signCt++] = &signData[idx];
+  }
+
+  if (signCt > 0)
+  {
+    // The return value is not of interest, each status is checked separately.
+    self->srxCAPI->sign(signCt, signPtr);
+  }
+
+  // Collect the signatures and clean up.
+  for (idx = 0; idx < count; idx++)
+  {
+    BGPSecSignRequest* req = &requests[idx];
+    SCA_Signature*     sig = signData[idx].signature;
+
+    if (signData[idx].ski != NULL)
+    {
+      req->status = signData[idx].status;
+    }
+    if (   (sig != NULL) 
+        && ((req->status & API_STATUS_ERROR_MASK) == 0))
+    {
+      req->length  = sizeof(SCA_BGPSEC_SignatureSegment) + sig->sigLen;
+      req->segment = malloc(req->length);
+      if (req->segment != NULL)
+      {
+        SCA_BGPSEC_SignatureSegment* sigSeg = 
+                                 (SCA_BGPSEC_SignatureSegment*)req->segment;
+        memcpy(sigSeg->ski, sig->ski, SKI_LENGTH);
+        sigSeg->siglen = htons(sig->sigLen);
+        memcpy(req->segment + sizeof(SCA_BGPSEC_SignatureSegment), 
+               sig->sigBuff, sig->sigLen);
+        retVal++;
+      }
+      else
+      {
+        req->length = 0;
+        req->status = API_STATUS_ERR_INSUF_BUFFER;
+      }
+    }
+    if (sig != NULL)
+    {
+      if (!self->srxCAPI->freeSignature(sig))
+      {
+        free(sig->sigBuff);
+        free(sig);
+      }
+    }
+    // Originations get their hash message generated by the API.
+    _freeHashMessage(self, signData[idx].hashMessage);
+  }
+
+  free(spSeg);
+  free(valData);
+  free(signData);
+  free(signPtr);
+
+  return retVal;
 }
 
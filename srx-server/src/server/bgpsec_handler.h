@@ -43,12 +43,56 @@
 #include "server/update_cache.h"
 #include "shared/srx_defs.h"
 
+/** The maximum number of private keys the handler can sign with. */
+#define BGPSEC_MAX_SIGN_KEYS 8
+
+/**
+ * Identifies a private key registered with the SRxCryptoAPI.
+ */
+typedef struct {
+  /** The ASN of the key in host format. */
+  uint32_t asn;
+  /** The algorithm suite identifier. */
+  uint8_t  algoID;
+  /** The SKI of the key. */
+  uint8_t  ski[SKI_LENGTH];
+} BGPSecSignKey;
+
+/**
+ * A single sign request. The caller provides the input fields, the output 
+ * fields are filled by createSignature.
+ */
+typedef struct {
+  /** IN: The update to be signed. */
+  UC_UpdateData* update;
+  /** IN: The AS the update will be send to (host format). */
+  uint32_t       peerAS;
+  /** IN: The pCount value of the own secure path segment. */
+  uint8_t        pCount;
+  /** IN: The flags of the own secure path segment. */
+  uint8_t        flags;
+  /** IN: The algorithm suite identifier to be used. */
+  uint8_t        algoID;
+  /** OUT: The status of the sign operation. */
+  sca_status_t   status;
+  /** OUT: The length of the signature segment. */
+  uint16_t       length;
+  /** OUT: The signature segment (SKI, length, signature) as it is used on the
+   * wire. The memory is allocated by createSignature and must be freed by the
+   * caller. NULL if the signing failed. */
+  uint8_t*       segment;
+} BGPSecSignRequest;
+
 /**
  * A single BGPSec Handler.
  */
 typedef struct {
   KeyCache* keyCache;
   SRxCryptoAPI* srxCAPI;
+  /** The private keys registered with the SRxCryptoAPI. */
+  BGPSecSignKey signKeys[BGPSEC_MAX_SIGN_KEYS];
+  /** The number of private keys registered. */
+  uint8_t       numSignKeys;
 } BGPSecHandler;
 
 /**
@@ -68,16 +112,19 @@ bool createBGPSecHandler(BGPSecHandler* self, KeyCache* keyCache);
 void releaseBGPSecHandler(BGPSecHandler* self);
 
 /**
- * Loads a private key.
- * At least one call is necessary before createSignature can be used.
- *
- * @todo Adjust parameter if necessary
+ * Loads a private key from the key vault of the SRxCryptoAPI and registers it
+ * with the API. At least one call is necessary before createSignature can be 
+ * used.
  *
  * @param self Instance
- * @param filename Filename of the private key
+ * @param asn The ASN the key belongs to (host format)
+ * @param algoID The algorithm suite identifier of the key
+ * @param ski The SKI of the key
+ * 
  * @return \c true = key loaded, \c false = invalid key, or file does not exist
  */
-bool loadPrivateKey(BGPSecHandler* self, const char* filename);
+bool loadPrivateKey(BGPSecHandler* self, uint32_t asn, uint8_t algoID, 
+                    uint8_t* ski);
 
 /**
  * Validates the given bgpsec update data.
@@ -92,14 +139,19 @@ bool loadPrivateKey(BGPSecHandler* self, const char* filename);
 uint8_t validateSignature(BGPSecHandler* self, UC_UpdateData* update);
 
 /**
- * Creates a signature for a given Byte-stream.
- *
- * @todo Adjust parameters (e.g. AS to identify the private key, etc.)
+ * Creates the signatures for the given sign requests. All requests a private 
+ * key is registered for are handed to the SRxCryptoAPI in one call. Updates 
+ * without BGPsec_PATH attribute are signed as origination.
  *
  * @param self Instance
- * @return \c true = signatures created, \c false = unknown key/internal error
+ * @param count The number of requests
+ * @param requests The sign requests, each successful request contains the 
+ *                 signature segment once the call returns.
+ * 
+ * @return The number of signatures created.
  */
-bool createSignature(BGPSecHandler* self);
+int createSignature(BGPSecHandler* self, int count, 
+                    BGPSecSignRequest* requests);
 
 #endif // !__BGPSEC_HANDLER_H__
 
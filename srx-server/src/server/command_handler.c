@@ -76,6 +76,8 @@
 #include "shared/srx_packets.h"
 #include "server/srx_packet_sender.h"
 #include "server/rpki_queue.h"
+#include "server/metrics.h"
+#include "server/trace.h"
 #include "util/log.h"
 #include "util/math.h"
 #include "util/prefix.h"
@@ -87,6 +89,10 @@
 
 #define HDR "([0x%08X] Command Handler): "
 
+// Logging of the ASPA validation steps at debug level. Builds configured with
+// --disable-debug-log remove it (see LOG_COMPILE_LEVEL in util/log.h).
+#define ASPA_LOG(FMT, ...) LOG(LEVEL_DEBUG, FMT, ## __VA_ARGS__)
+
 // Forward declaration
 static void* handleCommands(void* arg);
 extern RPKI_QUEUE* getRPKIQueue();
@@ -118,6 +124,22 @@ bool initializeCommandHandler(CommandHandler* self, Configuration* cfg,
   // Queue can be changed every time 'start' is called
   self->queue = NULL;
 
+  // Zero worker threads keeps the BGPsec validation within the command handler
+  self->cryptoPool = NULL;
+  if (cfg->bgpsec_worker_threads > 0)
+  {
+    self->cryptoPool = createCryptoWorkerPool(bgpsecHandler, updCache,
+                                              cfg->bgpsec_worker_threads,
+                                              cfg->bgpsec_max_inflight);
+    if (self->cryptoPool == NULL)
+    {
+      RAISE_ERROR("Failed to create the crypto worker pool!");
+      return false;
+    }
+  }
+  // Allows to drop the sign jobs of closed connections.
+  svrConnHandler->cryptoPool = self->cryptoPool;
+
   // 'start' has not been called
   self->numThreads = 0;
 
@@ -153,8 +175,14 @@ void releaseCommandHandler(CommandHandler* self)
     }
   }
 
+  if (self->cryptoPool != NULL)
+  {
+    self->svrConnHandler->cryptoPool = NULL;
+    releaseCryptoWorkerPool(self->cryptoPool);
+    self->cryptoPool = NULL;
+  }
+
   LOG(LEVEL_DEBUG, HDR "Command Handler released!", pthread_self());
-  // Do nothing
 }
 
 bool startProcessingCommands(CommandHandler* self, CommandQueue* cmdQueue)
@@ -164,6 +192,18 @@ bool startProcessingCommands(CommandHandler* self, CommandQueue* cmdQueue)
   self->queue = cmdQueue;
   LOG(LEVEL_DEBUG, HDR "Start Processing Commands...", pthread_self());
 
+  if (self->cryptoPool != NULL)
+  {
+    if (!startCryptoWorkers(self->cryptoPool))
+    {
+      RAISE_ERROR("Failed to start the crypto workers - perform BGPsec "
+                  "validation within the command handler!");
+      self->svrConnHandler->cryptoPool = NULL;
+      releaseCryptoWorkerPool(self->cryptoPool);
+      self->cryptoPool = NULL;
+    }
+  }
+
   for (idx = 0; idx < NUM_COMMAND_HANDLER_THREADS; idx++)
   {
     LOG (LEVEL_DEBUG, HDR "Create command handler Thread No %u", pthread_self(),
@@ -227,6 +267,12 @@ void stopProcessingCommands(CommandHandler* self)
         handle_error_en(s, "pthread_join");
     }
   }
+
+  // No more jobs can be queued, now stop the crypto workers.
+  if (self->cryptoPool != NULL)
+  {
+    stopCryptoWorkers(self->cryptoPool);
+  }
 }
 
 /**
@@ -246,6 +292,8 @@ static bool _processHandshake(CommandHandler* cmdHandler,
   // LOG (LEVEL_INFO, "ALL HELLO DATA: %u", ntohl(hdr->noPeers));
   uint32_t proxyID     = 0;
   uint8_t  clientID    = 0;
+  // The granted window of outstanding validation requests.
+  uint32_t window      = 0;
   ClientThread* clientThread = (ClientThread*)item->client; // for easier access
 
   char ski_hex[SKI_LENGTH * 2 + 1]; // 20 bytes * 2 chars per byte + null terminator
@@ -349,7 +397,12 @@ static bool _processHandshake(CommandHandler* cmdHandler,
 
       clientThread->proxyID  = proxyID;
       clientThread->routerID = clientID;
-      if (sendHelloResponse(item->serverSocket, item->client, proxyID))
+      window = grantClientWindow(item->client, 
+                                 (hdr->reserved8 & SRX_PROXY_FLAG_CREDIT) != 0
+                                 ? ntohl(hdr->window) : 0);
+      if (sendHelloResponse(item->serverSocket, item->client, proxyID,
+                            cmdHandler->sysConfig->syncAfterConnEstablished,
+                            window))
       {
         clientThread->initialized = true;
         if (cmdHandler->sysConfig->syncAfterConnEstablished)
@@ -404,129 +457,54 @@ bool _isSet(uint32_t bitmask, uint32_t bits)
 }
 
 /**
- * This function reverses an array using recursion
- * 
- * @param arr The array to be reversed
- * @param i The array element to be reordered
- * @param n The length of the array
- * 
- * @since 0.6.0.0
- */
-void reverse(int arr[], int i, int n)
-{
-    // base case: end of array is reached or array index out-of-bounds
-    if (i >= n)
-        return;
- 
-    // store next element of the array
-    int value = arr[i];
- 
-    // reach end of the array using recursion
-    reverse(arr, i + 1, n);
- 
-    // put elements in the call stack back into the array
-    // in correct order
-    arr[n - i - 1] = value;
-}
-
-/**
- * This function performs the ASPA validation.
- * 
- * @param asPathList
- * @param length
- * @param asType
- * @param direction
- * @param afi
- * @param aspaDBManager
- * 
- * @return the ASPA validation result
+ * Validate a contiguous run of AS_SEQUENCE hops. The run is walked in place
+ * starting with the AS closest to the origin which is the last AS of the run.
+ *
+ * @param asPathList The first AS of the run (origin last)
+ * @param length The number of ASes in the run
+ * @param isUpStream Indicates if the upstream algorithm is used
+ * @param afi The address family
+ * @param aspaDBManager The ASPA DB
+ * @param result (in/out) The accumulated ASPA result flags
+ *
+ * @return false if the run is invalid.
+ *
+ * @since 0.6.3.0
  */
-uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType, 
-                      AS_REL_DIR direction, uint8_t afi, 
-                      ASPA_DBManager* aspaDBManager)
+static bool _validateAspaRun(PATH_LIST* asPathList, uint16_t length,
+                             bool isUpStream, uint8_t afi,
+                             ASPA_DBManager* aspaDBManager, uint16_t* result)
 {
-  LOG(LEVEL_INFO, FILE_LINE_INFO " ASPA Validation Starts");
-  uint16_t result = ASPA_RESULT_NIBBLE_ZERO; // for being distinguished with 0 (ASPA_RESULT_VALID)
-
-  uint32_t customerAS, providerAS, startId=0;
-  bool swapFlag = false;
-
-  // 
-  // Initial Check for direct neighbor
-  // Issue: how to figure out Router1 and Router2 are direct neighbor in SRx server side
-  //   
-  //    1. Direct neight decision should be taken place in a router 
-  //        This means if a router detects a first ASN in AS path doesn't belong to the list of peering routers,
-  //        do not proceed to do ASPA validation. 
-  //
-  //    2. Otherwise, SRx server needs router's peering information
-  //       It needs to have all peering router information and compare those info to the proxy client 
-  //
-  // 
-  //        Direct Neighbor Check will take place in a router. And if that case happens, 
-  //        the router sends a flag unset for ASPA validation.
-  
-
-  //
-  // AS Set check routine
-  //
-  ASPA_ValidationResult hopResult[length];  
-
-  // initialize
-  for(int idx =0; idx <length; idx++)
-  {
-    hopResult[idx] = 0;
-  }
-
-  LOG(LEVEL_INFO, "AS path type: %d AS length: %d AS Direction: %d (1:up, 2:down)", asType, length, direction);
-  if (asType == AS_SET || asType != AS_SEQUENCE)
-  {
-    hopResult[0] = ASPA_RESULT_UNVERIFIABLE; 
-    result |= hopResult[0];
-    LOG(LEVEL_INFO, "validation  - Unverifiable detected");
-  }
-
-  // revert asPathList to a new array variable
-  PATH_LIST list[length];
-  memcpy(list, asPathList, sizeof(PATH_LIST) * length);
-  reverse(list, 0, length);
-
+// The AS at the given position counted from the origin.
+#define ASPA_HOP(IDX) asPathList[length - 1 - (IDX)]
 
+  uint32_t customerAS, providerAS;
   ASPA_ValidationResult currentResult;
-  bool isUpStream;
-  
-  if (direction == ASPA_UNKNOWNSTREAM || direction == ASPA_UPSTREAM) 
-    isUpStream = true;
-  else if (direction == ASPA_DOWNSTREAM)
-    isUpStream = false;
 
   /*
    *    Up Stream Validation 
    */
   if (isUpStream)
   {
-    LOG(LEVEL_INFO, "Upstream Validation start");
-    LOG(LEVEL_INFO, "Lookup Result Index (0:valid, 1:Invalid, 2:Undefined 4:Unknown, 8:Unverifiable)");
+    ASPA_LOG("Upstream Validation start");
     for (int idx=0; idx < length-1; idx++)
     {
-      customerAS = list[idx];
-      providerAS = list[idx+1];
-      LOG(LEVEL_INFO, "customer AS: %d\t provider AS: %d", customerAS, 
-          providerAS);
+      customerAS = ASPA_HOP(idx);
+      providerAS = ASPA_HOP(idx+1);
 
-      currentResult = hopResult[idx+1] = 
-        ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi);
+      currentResult = ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi);
 
-      result |= currentResult;
-      LOG(LEVEL_INFO, "current lookup result: %x Accured Result: %x", 
-          currentResult, result);
+      *result |= currentResult;
+      ASPA_LOG("customer AS: %u\t provider AS: %u lookup result: %x "
+               "Accured Result: %x", customerAS, providerAS, currentResult, 
+               *result);
 
       if (currentResult == ASPA_RESULT_VALID || 
           currentResult == ASPA_RESULT_UNKNOWN)
         continue;
 
       if (currentResult == ASPA_RESULT_INVALID)
-        return SRx_RESULT_INVALID;
+        return false;
 
     }
   } // end of UpStream
@@ -536,31 +514,28 @@ uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType,
    */
   else 
   {
-    LOG(LEVEL_INFO, "Downstream Validation starting...");
-    uint8_t K_val, L_val, u_val=0, i_val, j_val, iMax=0, jMax=0;
+    ASPA_LOG("Downstream Validation starting...");
+    uint16_t K_val, L_val, u_val=0, i_val, j_val, iMax=0, jMax=0;
 
     if (length == 1)
     {
-      result |= ASPA_RESULT_VALID;
-      LOG(LEVEL_INFO, "Valid if AS path length is one");
-      goto Validation_Result;
+      *result |= ASPA_RESULT_VALID;
+      ASPA_LOG("Valid if AS path length is one");
+      return true;
     }
 
     //
     // finding K value
     //
-    LOG(LEVEL_INFO, "Downstream - Finding K value");
     for (i_val=1; i_val <= length-2; i_val++)
     {
-      customerAS = list[i_val-1];
-      providerAS = list[i_val];
+      customerAS = ASPA_HOP(i_val-1);
+      providerAS = ASPA_HOP(i_val);
     
-      LOG(LEVEL_INFO, "+ Testing ASPA_Eval(cust:%d, prov:%d)", customerAS, providerAS);
+      ASPA_LOG("+ K - Testing ASPA_Eval(cust:%u, prov:%u)", customerAS, providerAS);
         
-      ASPA_ValidationResult tempResult = 
-        ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi);
-
-      if (tempResult == ASPA_RESULT_VALID)
+      if (ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi) 
+          == ASPA_RESULT_VALID)
       {
         iMax = i_val;
         continue;
@@ -574,29 +549,23 @@ uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType,
 
     if (K_val == length -1)
     {
-      result |= ASPA_RESULT_VALID;
-      LOG(LEVEL_INFO, "Valid if AS path left one");
-      goto Validation_Result;
+      *result |= ASPA_RESULT_VALID;
+      ASPA_LOG("Valid if AS path left one");
+      return true;
     }
-    LOG(LEVEL_INFO, "K value found: %d - path list[%d] : %d ", 
-        K_val, K_val-1, list[K_val-1]);
-
 
     //
     // finding L value
     //
-    LOG(LEVEL_INFO, "Downstream - Finding L value");
     for (j_val=1; j_val <= length-K_val-1; j_val++)
     {
-      customerAS = list[length - j_val];
-      providerAS = list[length - (j_val+1)];
+      customerAS = ASPA_HOP(length - j_val);
+      providerAS = ASPA_HOP(length - (j_val+1));
 
-      LOG(LEVEL_INFO, "+ Testing ASPA_Eval(cust:%d, prov:%d)", customerAS, providerAS);
+      ASPA_LOG("+ L - Testing ASPA_Eval(cust:%u, prov:%u)", customerAS, providerAS);
 
-      ASPA_ValidationResult tempResult = 
-        ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi);
-
-      if (tempResult == ASPA_RESULT_VALID)
+      if (ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi) 
+          == ASPA_RESULT_VALID)
       {
         jMax = j_val;
         continue;
@@ -608,40 +577,33 @@ uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType,
     }
     L_val = length - jMax; 
 
-    LOG(LEVEL_INFO, "L value found: %d - path list[%d] : %d ", 
-        L_val,  L_val-1,  list[L_val-1]);
-
+    ASPA_LOG("K value: %u L value: %u", K_val, L_val);
 
     // Intrim ASes Evaluation
     if (L_val-K_val <= 1)
     {
-      LOG(LEVEL_INFO, "Downstream - Interim Evaluation in case L-K value <= 1");
-      result |= ASPA_RESULT_VALID;
+      *result |= ASPA_RESULT_VALID;
     }
     else if ( L_val-K_val >= 2)
     {
-      LOG(LEVEL_INFO, "Downstream - Interim Evaluation in case L-K value >= 2");
       // first check forward direction
-      for (int i_val=K_val; i_val <= L_val-2; i_val++)
+      for (i_val=K_val; i_val <= L_val-2; i_val++)
       {
-        customerAS = list[i_val-1];
-        providerAS = list[i_val];
+        customerAS = ASPA_HOP(i_val-1);
+        providerAS = ASPA_HOP(i_val);
       
-        LOG(LEVEL_INFO, "+ Testing i val=%d, ASPA_Eval(cust:%d, prov:%d) - forward",
-            i_val, customerAS, providerAS);
+        ASPA_LOG("+ Testing i val=%u, ASPA_Eval(cust:%u, prov:%u) - forward",
+                 i_val, customerAS, providerAS);
 
-        ASPA_ValidationResult tempResult = 
-          ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi);
-      
-        if (tempResult == ASPA_RESULT_INVALID)
+        if (ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi) 
+            == ASPA_RESULT_INVALID)
         {
           u_val = i_val;
-          LOG(LEVEL_INFO, "+ u value: =%d", u_val);
           break;
         }
         else
         {
-          result |= ASPA_RESULT_UNKNOWN;
+          *result |= ASPA_RESULT_UNKNOWN;
           continue;
         }
       }
@@ -649,24 +611,22 @@ uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType,
       // second check - reverse direction
       if (u_val != 0)
       {
-        for(int j_val= u_val+1; j_val <= L_val-1; j_val++)
+        for (j_val= u_val+1; j_val <= L_val-1; j_val++)
         {
-          customerAS = list[j_val];
-          providerAS = list[j_val-1];
-
-          LOG(LEVEL_INFO, "+ Testing j val=%d, ASPA_Eval(cust:%d, prov:%d) - reverse",
-              j_val, customerAS, providerAS);
+          customerAS = ASPA_HOP(j_val);
+          providerAS = ASPA_HOP(j_val-1);
 
-          ASPA_ValidationResult tempResult = 
-            ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi);
+          ASPA_LOG("+ Testing j val=%u, ASPA_Eval(cust:%u, prov:%u) - reverse",
+                   j_val, customerAS, providerAS);
 
-          if (tempResult == ASPA_RESULT_INVALID)
+          if (ASPA_DB_lookup(aspaDBManager, customerAS, providerAS, afi) 
+              == ASPA_RESULT_INVALID)
           {
-            return SRx_RESULT_INVALID;
+            return false;
           }
           else
           {
-            result |= ASPA_RESULT_UNKNOWN;
+            *result |= ASPA_RESULT_UNKNOWN;
             continue;
           }
         }
@@ -674,12 +634,100 @@ uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType,
 
     } // end - if (L-K >=2 )
   } // end of DownStream
+#undef ASPA_HOP
+
+  return true;
+}
+
+/**
+ * This function performs the ASPA validation. The segments are walked in 
+ * place starting with the origin which is the last AS in the list. Each 
+ * maximal run of AS_SEQUENCE segments is validated as a contiguous path, any
+ * other segment type renders the path unverifiable and splits the runs. No 
+ * copy of the path is made and no memory is allocated, this allows to 
+ * validate a path borrowed from the AS path cache.
+ * 
+ * @param aspl The AS path list, prepends are already collapsed
+ * @param afi The address family
+ * @param aspaDBManager The ASPA DB
+ * 
+ * @return the ASPA validation result
+ */
+uint8_t validateASPA (AS_PATH_LIST* aspl, uint8_t afi, 
+                      ASPA_DBManager* aspaDBManager)
+{
+  ASPA_LOG(FILE_LINE_INFO " ASPA Validation Starts");
+  uint16_t result = ASPA_RESULT_NIBBLE_ZERO; // for being distinguished with 0 (ASPA_RESULT_VALID)
 
+  // 
+  // Initial Check for direct neighbor
+  // Issue: how to figure out Router1 and Router2 are direct neighbor in SRx server side
+  //   
+  //    1. Direct neight decision should be taken place in a router 
+  //        This means if a router detects a first ASN in AS path doesn't belong to the list of peering routers,
+  //        do not proceed to do ASPA validation. 
+  //
+  //    2. Otherwise, SRx server needs router's peering information
+  //       It needs to have all peering router information and compare those info to the proxy client 
+  //
+  // 
+  //        Direct Neighbor Check will take place in a router. And if that case happens, 
+  //        the router sends a flag unset for ASPA validation.
+  
+  ASPA_LOG("AS path type: %d AS length: %u segments: %u AS Direction: %d "
+           "(1:up, 2:down)", aspl->asType, aspl->asPathLength, 
+           aspl->numSegments, aspl->asRelDir);
+
+  // Paths without segments consist of a single segment of the path type.
+  AS_PATH_SEGMENT  single   = { aspl->asType, aspl->asPathLength };
+  AS_PATH_SEGMENT* segments = aspl->segments;
+  int              numSeg   = aspl->numSegments;
+  if (segments == NULL || numSeg == 0)
+  {
+    segments = &single;
+    numSeg   = 1;
+  }
+
+  bool     isUpStream = (aspl->asRelDir != ASPA_DOWNSTREAM);
+  // The run of AS_SEQUENCE ASes ends before runEnd and starts at segStart.
+  uint16_t runEnd     = aspl->asPathLength;
+  uint16_t segStart   = aspl->asPathLength;
+  int      seg;
+
+  for (seg = numSeg - 1; seg >= 0; seg--)
+  {
+    segStart -= segments[seg].length;
+    if (segments[seg].type == AS_SEQUENCE)
+    {
+      continue;
+    }
+
+    //
+    // AS Set check routine
+    //
+    result |= ASPA_RESULT_UNVERIFIABLE;
+    ASPA_LOG("validation  - Unverifiable detected");
+
+    uint16_t segEnd = segStart + segments[seg].length;
+    if (runEnd > segEnd
+        && !_validateAspaRun(aspl->asPathList + segEnd, runEnd - segEnd, 
+                             isUpStream, afi, aspaDBManager, &result))
+    {
+      return SRx_RESULT_INVALID;
+    }
+    runEnd = segStart;
+  }
+
+  if (runEnd > 0
+      && !_validateAspaRun(aspl->asPathList, runEnd, isUpStream, afi, 
+                           aspaDBManager, &result))
+  {
+    return SRx_RESULT_INVALID;
+  }
 
   /* 
    * Final result return
    */
-Validation_Result:
   result = result & 0x0f; // filter out
   if (result == ASPA_RESULT_VALID)
     return SRx_RESULT_VALID;
@@ -738,6 +786,7 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
   bool aspaVal   = _isSet(bhdr->flags, SRX_PROXY_FLAGS_VERIFY_ASPA);
   
   SRxUpdateID updateID = (SRxUpdateID)item->dataID;
+  traceUpdate(updateID, TRC_POINT_DEQUEUED);
 
   if (!originVal && !pathVal && !aspaVal)
   {
@@ -768,9 +817,18 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
   srxRes_mod.roaResult    = SRx_RESULT_DONOTUSE; // Indicates this
   srxRes_mod.aspaResult   = SRx_RESULT_DONOTUSE; // Indicates this
 
+  // The BGPsec validation is handed to the crypto workers once the origin and
+  // ASPA results are stored, this way these results are not delayed by the
+  // path validation.
+  bool queueBGPsec = false;
     
   // Only do bgpdsec path validation if not already performed
-  if (pathVal && (srxRes.bgpsecResult == SRx_RESULT_UNDEFINED))
+  if (pathVal && (srxRes.bgpsecResult == SRx_RESULT_UNDEFINED) 
+      && (cmdHandler->cryptoPool != NULL))
+  {
+    queueBGPsec = true;
+  }
+  else if (pathVal && (srxRes.bgpsecResult == SRx_RESULT_UNDEFINED))
   {
     // Get the data needed for BGPsec validation
     UC_UpdateData* uData = getUpdateData(cmdHandler->updCache, &item->dataID);
@@ -781,8 +839,11 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
       return false;
     }
     
+    uint64_t start = metricsNow();
     srxRes_mod.bgpsecResult = validateSignature(cmdHandler->bgpsecHandler, 
                                                 uData);
+    recordMetric(MET_STAGE_BGPSEC, MET_NO_CLIENT, start);
+    traceUpdate(updateID, TRC_POINT_BGPSEC);
   }
 
   // Only do origin validation if not already performed
@@ -809,6 +870,7 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
       asn = ntohl(v6->originAS);
     }
 
+    uint64_t start = metricsNow();
     if (!requestUpdateValidation(cmdHandler->rpkiHandler->prefixCache,
                                  &updateID, prefix, asn))
     {
@@ -817,6 +879,8 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
                       pthread_self(), item->dataID);
       processed = false;
     }
+    recordMetric(MET_STAGE_ORIGIN, MET_NO_CLIENT, start);
+    traceUpdate(updateID, TRC_POINT_ORIGIN);
     free(prefix);
   }
   
@@ -843,61 +907,55 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
 
 
     // -------------------------------------------------------------------
-    // Retrieve data from aspath cache with crc Key, path ID, here
+    // Retrieve data from aspath cache with crc Key, path ID, here. The path
+    // is borrowed from the cache, it is not copied.
     //
-    LOG(LEVEL_INFO, "Path ID: 0x%X", pathId);
-    AS_PATH_LIST *aspl = getAspathListFromAspathCache (cmdHandler->aspathCache, pathId, &srxRes);
-    printAsPathList(aspl);
+    LOG(LEVEL_DEBUG, "Path ID: 0x%X", pathId);
+    uint32_t      epoch;
+    AS_PATH_LIST* aspl = borrowAspathList(cmdHandler->aspathCache, pathId, 
+                                          &srxRes, &epoch);
 
-    if (aspl)
+    if (aspl != NULL)
     {
       // call ASPA validation
       //
       uint8_t afi = aspl->afi;  
       if (aspl->afi == 0 || aspl->afi > 2) // if more than 2 (AFI_IP6)
-        afi = AFI_IP;                      // set default
+        afi = AFI_IP;                    // set default
 
-      uint8_t valResult = validateASPA (aspl->asPathList, 
-          aspl->asPathLength, aspl->asType, aspl->asRelDir, afi, aspaDBManager);
+      uint64_t start     = metricsNow();
+      uint8_t  valResult = validateASPA (aspl, afi, aspaDBManager);
+      recordMetric(MET_STAGE_ASPA, MET_NO_CLIENT, start);
+      traceUpdate(updateID, TRC_POINT_ASPA);
+      returnAspathList(cmdHandler->aspathCache, epoch);
 
-      LOG(LEVEL_INFO, FILE_LINE_INFO "\033[92m"" Validation Result: %d "
+      LOG(LEVEL_DEBUG, FILE_LINE_INFO "\033[92m"" Validation Result: %d "
           "(0:v, 2:Iv, 3:Ud 4:DNU 5:Uk, 6:Uf)""\033[0m", valResult);
 
-      // modify Aspath Cache with the validation result
+      // modify Aspath Cache with the validation result, srxRes contains the
+      // cached result.
       //
-      if (valResult != aspl->aspaValResult)
+      if (valResult != srxRes.aspaResult)
       {
-        time_t cTime = time(NULL);
-        aspl->lastModified = cTime;
         modifyAspaValidationResultToAspathCache (cmdHandler->aspathCache, pathId, 
-            valResult, aspl);
-
-        // modify aspl and srx Res
-        aspl->aspaValResult = valResult;
-        //if (srxRes.aspaResult != valResult)
-          //srxRes.aspaResult  = valResult;
+            valResult, time(NULL));
       }
 
       // modify Update Cache
-      srxRes_mod.aspaResult = aspl->aspaValResult;
+      srxRes_mod.aspaResult = valResult;
           
     }
-    else if (!aspl && pathId == 0 && (bhdr->asType == AS_SET))
+    else if (pathId == 0 && (bhdr->asType == AS_SET))
     {
-      LOG(LEVEL_INFO, "Unverifiable enabled for the aspath list which only includes AS_SET");
+      LOG(LEVEL_DEBUG, "Unverifiable enabled for the aspath list which only includes AS_SET");
       srxRes_mod.aspaResult = SRx_RESULT_UNVERIFIABLE;  
     }
     else
     {
-      LOG(LEVEL_WARNING, "Something went wrong... path list was not registered");
+      LOG_RATE_LIMITED(LEVEL_WARNING, 10, "Something went wrong... path list "
+                       "was not registered");
     }
 
-    // release memory
-    //if (aspl->asType == AS_SET)
-     // deleteAspathCache(cmdHandler->aspathCache, pathId, aspl);
-
-    if (aspl)
-      deleteAspathListEntry (aspl);
   }
 
   // Invalid case
@@ -905,7 +963,7 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
               && (defRes.result.aspaResult == SRx_RESULT_INVALID)
               && (defRes.resSourceASPA = SRxRS_ROUTER))
   {
-    LOG(LEVEL_INFO, "default result from a router is invalid, so sening it as well");
+    LOG(LEVEL_DEBUG, "default result from a router is invalid, so sening it as well");
     srxRes_mod.aspaResult = SRx_RESULT_INVALID;  
   }
 
@@ -917,7 +975,7 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
               && (defRes.result.aspaResult != SRx_RESULT_INVALID)
               && (bhdr->asType != AS_SET))
   {
-    LOG(LEVEL_INFO, "path id and srx result already exists in UpdateCache");
+    LOG(LEVEL_DEBUG, "path id and srx result already exists in UpdateCache");
     srxRes_mod.aspaResult = srxRes.aspaResult; // srx Res came from UpdateCache (cEntry)
   }
 
@@ -927,7 +985,7 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
               && (bhdr->asType == AS_SET)
               && pathId == 0)
   {
-    LOG(LEVEL_INFO, "Unverifiable enabled with only includes AS_SET and srx result is not undefined");
+    LOG(LEVEL_DEBUG, "Unverifiable enabled with only includes AS_SET and srx result is not undefined");
     srxRes_mod.aspaResult = SRx_RESULT_UNVERIFIABLE;  
   }
 
@@ -948,6 +1006,16 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
                       updateID);
     }    
   }
+
+  if (queueBGPsec)
+  {
+    if (!queueCryptoJob(cmdHandler->cryptoPool, CW_JOB_VALIDATE, &updateID))
+    {
+      LOG_RATE_LIMITED(LEVEL_WARNING, 10, HDR "Crypto workers are stopped, "
+                       "BGPsec validation of update [0x%08X] not performed!",
+                       pthread_self(), updateID);
+    }
+  }
   
   return processed;
 }
@@ -961,8 +1029,24 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
 static void _processUpdateSigning(CommandHandler* cmdHandler,
                                   CommandQueueItem* item)
 {
-  // TODO Sign the data
-  LOG(LEVEL_INFO, "Signing of updates is currently not supported!");
+  SRXPROXY_SIGN_REQUEST* hdr = (SRXPROXY_SIGN_REQUEST*)item->data;
+  SRxUpdateID updateID = (SRxUpdateID)item->dataID;
+
+  if (cmdHandler->cryptoPool == NULL)
+  {
+    LOG(LEVEL_INFO, "Signing of updates requires the crypto workers!");
+    sendError(SRXERR_ALGO_NOT_SUPPORTED, item->serverSocket, item->client,
+              false);
+  }
+  else if (!queueCryptoSignJob(cmdHandler->cryptoPool, item->serverSocket,
+                               item->client, &updateID, ntohl(hdr->peerAS),
+                               (uint8_t)ntohl(hdr->prependCounter),
+                               (uint8_t)ntohs(hdr->algorithm)))
+  {
+    LOG_RATE_LIMITED(LEVEL_WARNING, 10, HDR "Crypto workers are stopped, "
+                     "update [0x%08X] not signed!", pthread_self(), updateID);
+    sendError(SRXERR_INTERNAL_ERROR, item->serverSocket, item->client, false);
+  }
 }
 
 /**
@@ -997,6 +1081,53 @@ static void _processDeleteUpdate(CommandHandler* cmdHandler,
   }
 }
 
+/**
+ * Perform the BGPsec path validation of the update again after its keys
+ * changed. The RPKI handler queues this command if no crypto workers can take
+ * the revalidation. The update cache only notifies the clients if the result
+ * changed.
+ *
+ * @param cmdHandler The command handler.
+ * @param item The item containing the update ID.
+ *
+ * @since 0.6.3.0
+ */
+static void _processRevalidation(CommandHandler* cmdHandler,
+                                 CommandQueueItem* item)
+{
+  SRxUpdateID    updateID = (SRxUpdateID)item->dataID;
+  UC_UpdateData* uData    = getUpdateData(cmdHandler->updCache, &updateID);
+
+  if (uData == NULL)
+  {
+    LOG(LEVEL_DEBUG, HDR "Update [0x%08X] is not stored anymore, skip BGPsec "
+                     "revalidation!", pthread_self(), updateID);
+    return;
+  }
+  if (uData->bgpsec_path == NULL)
+  {
+    LOG(LEVEL_ERROR, "Update 0x%08X is registered for BGPsec but the "
+                     "BGPsec_PATH attribute is not stored!", updateID);
+    return;
+  }
+
+  SRxResult srxRes_mod;
+  srxRes_mod.roaResult        = SRx_RESULT_DONOTUSE;
+  srxRes_mod.aspaResult       = SRx_RESULT_DONOTUSE;
+  srxRes_mod.transitiveResult = SRx_RESULT_DONOTUSE;
+  uint64_t start              = metricsNow();
+  srxRes_mod.bgpsecResult     = validateSignature(cmdHandler->bgpsecHandler,
+                                                  uData);
+  recordMetric(MET_STAGE_BGPSEC, MET_NO_CLIENT, start);
+  traceUpdate(updateID, TRC_POINT_BGPSEC);
+
+  if (!modifyUpdateResult(cmdHandler->updCache, &updateID, &srxRes_mod, false))
+  {
+    RAISE_SYS_ERROR("A validation result for a non existing update [0x%08X]!",
+                    updateID);
+  }
+}
+
 /**
  * This method handles the peer change.
  *
@@ -1037,13 +1168,20 @@ static void* handleCommands(void* arg)
     LOG(LEVEL_DEBUG, HDR "recvLock request ...%s", pthread_self(),__FUNCTION__);
 
     item = fetchNextCommand(cmdHandler->queue);
-
-    LOG(LEVEL_INFO, HDR "+------------------------------+");
-    LOG(LEVEL_INFO, HDR "Command fetched [%u]!", pthread_self(), item->cmdType);
-    LOG(LEVEL_INFO, HDR "Command fetched [%u]!", pthread_self(), item->dataLength);
-    LOG(LEVEL_INFO, HDR "Command fetched [%u]!", pthread_self(), item->dataID);
-    LOG(LEVEL_INFO, HDR "Command fetched [%u]!", pthread_self(), item->data);
-    LOG(LEVEL_INFO, HDR "+------------------------------+");
+    recordMetric(MET_STAGE_QUEUE_WAIT, 
+                 item->client != NULL ? ((ClientThread*)item->client)->routerID
+                                      : MET_NO_CLIENT, 
+                 item->queued);
+    recordMetric(item->priority ? MET_STAGE_QUEUE_WAIT_PRIORITY 
+                                : MET_STAGE_QUEUE_WAIT_BULK,
+                 MET_NO_CLIENT, item->queued);
+
+    LOG(LEVEL_DEBUG, HDR "+------------------------------+", pthread_self());
+    LOG(LEVEL_DEBUG, HDR "Command fetched [%u]!", pthread_self(), item->cmdType);
+    LOG(LEVEL_DEBUG, HDR "Command fetched [%u]!", pthread_self(), item->dataLength);
+    LOG(LEVEL_DEBUG, HDR "Command fetched [%u]!", pthread_self(), item->dataID);
+    LOG(LEVEL_DEBUG, HDR "Command fetched [%u]!", pthread_self(), item->data);
+    LOG(LEVEL_DEBUG, HDR "+------------------------------+", pthread_self());
     switch (item->cmdType)
     {
       case COMMAND_TYPE_SHUTDOWN:
@@ -1051,6 +1189,9 @@ static void* handleCommands(void* arg)
         LOG(LEVEL_INFO, "SRx server shutdown...");
         keepGoing = false;
         break;
+      case COMMAND_TYPE_REVALIDATE:
+        _processRevalidation(cmdHandler, item);
+        break;
       case COMMAND_TYPE_SRX_PROXY:
         if ((item->dataLength == 0) && (item->data == NULL))
         {
@@ -1062,7 +1203,7 @@ static void* handleCommands(void* arg)
           SRXPROXY_BasicHeader* bhdr = (SRXPROXY_BasicHeader*)item->data;
           SRXPROXY_GOODBYE* gbhdr;
           // Logging
-          LOG(LEVEL_INFO, HDR "SRXPROXY PDU type [%u] (%s) fetched!",
+          LOG(LEVEL_DEBUG, HDR "SRXPROXY PDU type [%u] (%s) fetched!",
             pthread_self(), bhdr->type,
             packetTypeToStr(bhdr->type));
           // Depending on the type
@@ -1075,6 +1216,8 @@ static void* handleCommands(void* arg)
                 RAISE_ERROR("Handshake between SRx and proxy failed. Shutdown "
                             "TCP connection!");
 
+                releaseClientSendQueue(item->client);
+                dropClientCryptoJobs(cmdHandler->cryptoPool, item->client);
                 closeClientConnection(&cmdHandler->svrConnHandler->svrSock,
                                       item->client);
 		            deleteFromSList(&cmdHandler->svrConnHandler->clients,
@@ -1087,12 +1230,15 @@ static void* handleCommands(void* arg)
             case PDU_SRXPROXY_VERIFY_V4_REQUEST:
             case PDU_SRXPROXY_VERIFY_V6_REQUEST:
               _processUpdateValidation(cmdHandler, item);
+              returnClientCredit(item->client);
               break;
             case PDU_SRXPROXY_SIGN_REQUEST:
               _processUpdateSigning(cmdHandler, item);
               break;
             case PDU_SRXPROXY_GOODBYE:
               gbhdr = (SRXPROXY_GOODBYE*)item->data;
+              releaseClientSendQueue(item->client);
+              dropClientCryptoJobs(cmdHandler->cryptoPool, item->client);
               closeClientConnection(&cmdHandler->svrConnHandler->svrSock,
                                     item->client);
               clientID = ((ClientThread*)item->client)->routerID;
@@ -1131,6 +1277,8 @@ static void* handleCommands(void* arg)
               sendError(SRXERR_INVALID_PACKET, item->serverSocket,
                         item->client, false);
               sendGoodbye(item->serverSocket, item->client, false);
+              releaseClientSendQueue(item->client);
+              dropClientCryptoJobs(cmdHandler->cryptoPool, item->client);
               closeClientConnection(&cmdHandler->svrConnHandler->svrSock,
                                     item->client);
 
@@ -1152,14 +1300,6 @@ static void* handleCommands(void* arg)
       // Still keep going.
     }
 
-    if (cmdHandler->queue->nextItemNode != NULL)
-    {
-      LOG(LEVEL_DEBUG, HDR "recv Unlock request ...%s", pthread_self(),
-                       __FUNCTION__);
-      //unlockMutex(&cmdHandler->queue->recvMutex);
-      //signalCond(&cmdHandler->queue->recvCond);
-    }
-
     // Now remove the item from command handler. it is processed.
     deleteCommand(cmdHandler->queue, item);
 
@@ -1187,6 +1327,7 @@ bool broadcastResult(CommandHandler* self, SRxValidationResult* valResult)
   SRXPROXY_VERIFY_NOTIFICATION* pdu;
   uint32_t pduLength = sizeof(SRXPROXY_VERIFY_NOTIFICATION);
   bool retVal = true;
+  uint64_t start = metricsNow();
   // Prepare the array of clients.
   uint8_t clientSize = self->updCache->minNumberOfClients;
   uint8_t clients[clientSize];
@@ -1236,13 +1377,23 @@ bool broadcastResult(CommandHandler* self, SRxValidationResult* valResult)
 #endif // USE_GRPC
         client = self->svrConnHandler->proxyMap[clients[clientCt]].socket;
 
-        retVal |= sendPacketToClient(&self->svrConnHandler->svrSock,
-                                     client , pdu, pduLength);
+        // A slow client does not delay the other clients.
+        if (self->sysConfig->mode_no_sendqueue
+            ? sendPacketToClient(&self->svrConnHandler->svrSock,
+                                 client , pdu, pduLength)
+            : queuePacketToClient(&self->svrConnHandler->svrSock,
+                                  client , pdu, pduLength))
+        {
+          countClientResult(clients[clientCt]);
+          retVal = true;
+        }
       }
       // If the mapping is inactive the proxy might be in reboot.
     }
 
     free(pdu);
+    recordMetric(MET_STAGE_BROADCAST, MET_NO_CLIENT, start);
+    traceUpdate(valResult->updateID, TRC_POINT_SENT);
   }
 
   return retVal;
@@ -50,6 +50,7 @@
 #include "server/bgpsec_handler.h"
 #include "server/configuration.h"
 #include "server/command_queue.h"
+#include "server/crypto_worker.h"
 #include "server/rpki_handler.h"
 #include "server/server_connection_handler.h"
 #include "server/update_cache.h"
@@ -81,6 +82,10 @@ typedef struct {
   // Argument (start)
   CommandQueue*             queue;
 
+  // Performs the BGPsec validation outside of the command handler threads.
+  // NULL if the BGPsec validation is performed synchronously.
+  CryptoWorkerPool*         cryptoPool;
+
   // Internal
   pthread_t                 threads[NUM_COMMAND_HANDLER_THREADS];
   int                       numThreads;
@@ -148,21 +153,22 @@ bool _isSet(uint32_t bitmask, uint32_t bits);
 
 
 /**
- * This function performs the ASPA validation.
+ * This function performs the ASPA validation. The segments are walked in 
+ * place starting with the origin which is the last AS in the list. Each 
+ * maximal run of AS_SEQUENCE segments is validated as a contiguous path, any
+ * other segment type renders the path unverifiable and splits the runs. No 
+ * copy of the path is made and no memory is allocated, this allows to 
+ * validate a path borrowed from the AS path cache.
  * 
- * @param asPathList
- * @param length
- * @param asType
- * @param direction
- * @param afi
- * @param aspaDBManager
+ * @param aspl The AS path list, prepends are already collapsed
+ * @param afi The address family
+ * @param aspaDBManager The ASPA DB
  * 
  * @return the ASPA validation result
  * 
  * @since 0.6.0.0
  */
-uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType, 
-                      AS_REL_DIR direction, uint8_t afi, 
+uint8_t validateASPA (AS_PATH_LIST* aspl, uint8_t afi, 
                       ASPA_DBManager* aspaDBManager);
 #endif // !__COMMAND_HANDLER_H__
 
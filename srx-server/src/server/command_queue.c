@@ -34,7 +34,10 @@
  * -----------------------------------------------------------------------------
  */
 
+
+#include <time.h>
 #include "server/command_queue.h"
+#include "server/metrics.h"
 #include "shared/srx_defs.h"
 #include "shared/srx_packets.h"
 #include "util/log.h"
@@ -42,6 +45,188 @@
 
 #define HDR "([0x%08X] Command Queue): "
 
+/**
+ * Return the monotonic time in microseconds.
+ *
+ * @return the time in microseconds.
+ */
+static uint64_t _cq_nowUs()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+/**
+ * Return the lane of the given client. The caller MUST hold the queue mutex.
+ *
+ * @param self The command queue
+ * @param client The client
+ * @param create Add a lane if the client does not have one.
+ *
+ * @return the lane of the client or NULL.
+ */
+static CommandQueueClient* _cq_getClient(CommandQueue* self, 
+                                         ServerClient* client, bool create)
+{
+  CommandQueueClient* lane;
+  uint32_t            idx;
+  uint32_t            size;
+
+  for (idx = 0; idx < self->noClients; idx++)
+  {
+    if (self->clients[idx].client == client)
+    {
+      return &self->clients[idx];
+    }
+  }
+  if (!create)
+  {
+    return NULL;
+  }
+
+  if (self->noClients == self->sizeClients)
+  {
+    size = self->sizeClients == 0 ? 8 : self->sizeClients * 2;
+    lane = (CommandQueueClient*)realloc(self->clients, 
+                                        size * sizeof(CommandQueueClient));
+    if (lane == NULL)
+    {
+      return NULL;
+    }
+    self->clients     = lane;
+    self->sizeClients = size;
+  }
+  lane = &self->clients[self->noClients++];
+  memset(lane, 0, sizeof(CommandQueueClient));
+  lane->client = client;
+  initSList(&lane->commands);
+
+  return lane;
+}
+
+/**
+ * Remove the lane of a client that has no commands queued anymore. The caller 
+ * MUST hold the queue mutex.
+ *
+ * @param self The command queue
+ * @param lane The lane of the client.
+ */
+static void _cq_removeClient(CommandQueue* self, CommandQueueClient* lane)
+{
+  uint32_t idx = (uint32_t)(lane - self->clients);
+
+  self->noClients--;
+  memmove(lane, lane + 1, 
+          (self->noClients - idx) * sizeof(CommandQueueClient));
+  // Keep the round robin at the client that follows the removed one.
+  if (self->rrIndex > idx)
+  {
+    self->rrIndex--;
+  }
+  if (self->rrIndex >= self->noClients)
+  {
+    self->rrIndex = 0;
+  }
+}
+
+/**
+ * Return true if the bulk lane of the client can be served. The commands of a
+ * client are only fetched from the bulk lane once its commands of the priority
+ * lane are fetched.
+ *
+ * @param lane The lane of the client.
+ *
+ * @return true if the lane can be served.
+ */
+static bool _cq_canServe(CommandQueueClient* lane)
+{
+  return (lane->commands.size > 0) && (lane->prioItems == 0);
+}
+
+/**
+ * Remove the next command from the bulk lane using deficit round robin. Each
+ * time the round robin moves to a client, the client can be served with 
+ * CMD_QUEUE_QUANTUM more bytes. The caller MUST hold the queue mutex and at 
+ * least one client lane MUST be servable.
+ *
+ * @param self The command queue
+ *
+ * @return the command.
+ */
+static CommandQueueItem* _cq_fetchBulk(CommandQueue* self)
+{
+  CommandQueueClient* lane;
+  CommandQueueItem*   item;
+
+  while (true)
+  {
+    lane = &self->clients[self->rrIndex];
+    if (_cq_canServe(lane))
+    {
+      item = (CommandQueueItem*)getDataOfSListNode(
+                                        getRootNodeOfSList(&lane->commands));
+      if (lane->deficit >= item->dataLength)
+      {
+        shiftFromSList(&lane->commands);
+        lane->deficit -= item->dataLength;
+        self->bulkItems--;
+        if (lane->commands.size == 0)
+        {
+          // The client caught up, its next commands are live again.
+          _cq_removeClient(self, lane);
+        }
+        return item;
+      }
+    }
+    else if (lane->commands.size == 0)
+    {
+      lane->deficit = 0;
+    }
+
+    self->rrIndex = (self->rrIndex + 1) % self->noClients;
+    lane = &self->clients[self->rrIndex];
+    if (_cq_canServe(lane))
+    {
+      lane->deficit += CMD_QUEUE_QUANTUM;
+    }
+  }
+}
+
+/**
+ * Update the statistics of the lane the command is fetched from. The caller 
+ * MUST hold the queue mutex.
+ *
+ * @param self The command queue
+ * @param item The command fetched
+ */
+static void _cq_countFetch(CommandQueue* self, CommandQueueItem* item)
+{
+  uint64_t now    = _cq_nowUs();
+  uint64_t waitUs = now > item->arrival ? now - item->arrival : 0;
+
+  if (item->priority)
+  {
+    self->stats.prioFetched++;
+    self->sumPrioWaitUs += waitUs;
+    if (waitUs > self->stats.maxPrioWaitUs)
+    {
+      self->stats.maxPrioWaitUs = waitUs;
+    }
+  }
+  else
+  {
+    self->stats.bulkFetched++;
+    self->sumBulkWaitUs += waitUs;
+    if (waitUs > self->stats.maxBulkWaitUs)
+    {
+      self->stats.maxBulkWaitUs = waitUs;
+    }
+  }
+  setCommandQueueDepth(self->queue.size, self->bulkItems);
+}
+
 /** 
  * Initializes and setup the command queue.
  *
@@ -75,8 +260,16 @@ bool initializeCommandQueue(CommandQueue* self)
   self->unprocessedItems = 0;
   initSList(&self->queue);
 
-  // No item is available, i.e. block fetch
-  self->nextItemNode = NULL;
+  // No client has commands in the bulk lane
+  self->clients     = NULL;
+  self->noClients   = 0;
+  self->sizeClients = 0;
+  self->rrIndex     = 0;
+  self->prioBurst   = 0;
+  self->bulkItems   = 0;
+  memset(&self->stats, 0, sizeof(CommandQueueStats));
+  self->sumPrioWaitUs = 0;
+  self->sumBulkWaitUs = 0;
 
   self->alive = true;
   
@@ -107,13 +300,17 @@ void releaseCommandQueue(CommandQueue* self)
     LOG(LEVEL_DEBUG, HDR "Release internal list and Mutex", pthread_self());    
     // Release all items and the mutexes
     releaseSList(&self->queue); 
+    free(self->clients);
+    self->clients     = NULL;
+    self->sizeClients = 0;
     releaseMutex(&self->cmdQueueMutex);
   }
 }
 
 /**
  * Add a given command into the command queue. THe type of command is stored in 
- * the parameter cmdType.
+ * the parameter cmdType. The command is added to the priority lane unless the
+ * client is in the bulk lane or exceeds CMD_QUEUE_PRIORITY_LIMIT.
  *
  * @param self The command queue where the command has to be added to
  * @param cmdType The type of the command.
@@ -143,28 +340,57 @@ bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
   }
   
   LOG(LEVEL_DEBUG, HDR "queueComamnd type (%u)", pthread_self(), cmdType);
-  CommandQueueItem* newItem;    
+  CommandQueueItem*   newItem;    
+  CommandQueueClient* lane = NULL;
+  SList*              list = &self->queue;
+
+  //TODO: BZ197 This might be revisited - Dirty BUG test
+  if ((data != NULL) && (dataLength >= 1000000)) // increased by factor 10
+  {
+    // SEGV due to dataLength : 50529027 (0x03030303)
+    RAISE_SYS_ERROR("Given datalength too big due to transmission error "
+      "- Inform developers with reference code BZ197!");
+    return false;
+  }
 
   // Try to add a new item - make sure no one modifies the queue
   lockMutex(&self->cmdQueueMutex);  
-  newItem = (CommandQueueItem*)appendToSList(&self->queue, 
-                                             sizeof(CommandQueueItem));
-  newItem->consumed = false;
-  
-  // Set the new next node inside this mutex to make sure we -
-  // - get the new item
-  // - unlock only once
-  if (self->nextItemNode == NULL)
+
+  // The shutdown is not related to a client and always has priority.
+  if (cmdType != COMMAND_TYPE_SHUTDOWN)
   {
-    self->nextItemNode = getLastNodeOfSList(&self->queue);
+    lane = _cq_getClient(self, client, true);
+    if (lane == NULL)
+    {
+      unlockMutex(&self->cmdQueueMutex);
+      RAISE_SYS_ERROR("Not enough memory for the lane of the client");
+      return false;
+    }
+    if (!lane->bulk && (lane->prioItems >= CMD_QUEUE_PRIORITY_LIMIT))
+    {
+      LOG(LEVEL_DEBUG, HDR "Client [0x%08X] moves into the bulk lane", 
+                       pthread_self(), client);
+      lane->bulk = true;
+    }
+    if (lane->bulk)
+    {
+      list = &lane->commands;
+    }
   }
 
+  newItem = (CommandQueueItem*)appendToSList(list, sizeof(CommandQueueItem));
   // Failed to add an item
   if (newItem == NULL)
   {
+    if ((lane != NULL) && (lane->prioItems == 0) 
+        && (lane->commands.size == 0))
+    {
+      _cq_removeClient(self, lane);
+    }
     unlockMutex(&self->cmdQueueMutex);
     return false;
   }
+  newItem->consumed = false;
 
   // 'NULL' packet
   if (data == NULL)
@@ -178,24 +404,18 @@ bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
     if (newItem->data == NULL)
     {
       RAISE_SYS_ERROR("Not enough memory to copy the data into the queue");
-      deleteFromSList(&self->queue, newItem);
-      
-      return false;
-    }
-    //TODO: BZ197 This might be revisited - Dirty BUG test
-    if (dataLength < 1000000) // dirty bug test - increased by factor 10
-    {
-      memcpy(newItem->data, data, dataLength); 
-      // SEGV due to dataLength : 50529027 (0x03030303)
-    }
-    else
-    {
-      RAISE_SYS_ERROR("Given datalength too big due to transmission error "
-        "- Inform developers with reference code BZ197!");
-      deleteFromSList(&self->queue, newItem);
+      deleteFromSList(list, newItem);
+      free(newItem);
+      if ((lane != NULL) && (lane->prioItems == 0) 
+          && (lane->commands.size == 0))
+      {
+        _cq_removeClient(self, lane);
+      }
       unlockMutex(&self->cmdQueueMutex);
+      
       return false;
     }
+    memcpy(newItem->data, data, dataLength); 
   }
 
   // Set the other item members
@@ -204,6 +424,30 @@ bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
   newItem->cmdType      = cmdType;
   newItem->dataID       = dataID;
   newItem->dataLength   = dataLength;
+  newItem->queued       = metricsNow();
+  newItem->arrival      = _cq_nowUs();
+  newItem->priority     = list == &self->queue;
+
+  if (newItem->priority)
+  {
+    if (lane != NULL)
+    {
+      lane->prioItems++;
+    }
+    if (self->queue.size > self->stats.maxPrioDepth)
+    {
+      self->stats.maxPrioDepth = self->queue.size;
+    }
+  }
+  else
+  {
+    self->bulkItems++;
+    if (self->bulkItems > self->stats.maxBulkDepth)
+    {
+      self->stats.maxBulkDepth = self->bulkItems;
+    }
+  }
+  setCommandQueueDepth(self->queue.size, self->bulkItems);
     
   self->totalItems++;
   self->unprocessedItems++;
@@ -223,6 +467,10 @@ bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
  * Retrieves the next command. This method DOES NOT clear the memory. 
  * After a command is processed the method 'deleteCommand' will remove it from 
  * the queue and free up all associated memory.
+ *
+ * The priority lane is served first. After CMD_QUEUE_PRIORITY_BURST commands 
+ * of the priority lane one command of the bulk lane is fetched to not starve
+ * the clients that load their tables.
  * 
  * @param self The command queue
  * 
@@ -235,7 +483,10 @@ CommandQueueItem* fetchNextCommand(CommandQueue* self)
   // queue the wait mutesx will be unlocked and the command will be returned.
   // This method plays the loc/unlock mutex game with queuecommand
   
-  CommandQueueItem* item;
+  CommandQueueItem*   item;
+  CommandQueueClient* lane;
+  bool                serveBulk = false;
+  uint32_t            idx;
   
   LOG(LEVEL_DEBUG, HDR "Fetch next command from command queue...", 
                    pthread_self());
@@ -268,13 +519,45 @@ CommandQueueItem* fetchNextCommand(CommandQueue* self)
     unlockMutex(&self->cmdQueueMutex);
     return NULL;
   }
+
+  // Decide on the lane.
+  if ((self->queue.size == 0) || (self->prioBurst >= CMD_QUEUE_PRIORITY_BURST))
+  {
+    for (idx = 0; (idx < self->noClients) && !serveBulk; idx++)
+    {
+      serveBulk = _cq_canServe(&self->clients[idx]);
+    }
+  }
   
-  // Retrieve the item and set the fetcher to the next one.
-  item = (CommandQueueItem*)self->nextItemNode->data;
+  // Retrieve the item
+  if (serveBulk)
+  {
+    self->prioBurst = 0;
+    item = _cq_fetchBulk(self);
+  }
+  else
+  {
+    self->prioBurst = self->queue.size > 1 ? self->prioBurst + 1 : 0;
+    item = (CommandQueueItem*)shiftFromSList(&self->queue);
+    if ((item != NULL) && (item->cmdType != COMMAND_TYPE_SHUTDOWN))
+    {
+      lane = _cq_getClient(self, item->client, false);
+      if (lane != NULL)
+      {
+        lane->prioItems--;
+        if ((lane->prioItems == 0) && (lane->commands.size == 0))
+        {
+          _cq_removeClient(self, lane);
+        }
+      }
+    }
+  }
   self->unprocessedItems--;				// SEE also ./util/slist.c:106    
   if (item == NULL)
   {
     RAISE_ERROR("Fatal CommandQueue encountered an empty command.");
+    unlockMutex(&self->cmdQueueMutex);
+    return NULL;
   }
   if (item->consumed)
   {
@@ -282,10 +565,8 @@ CommandQueueItem* fetchNextCommand(CommandQueue* self)
   }
   // Indicate this item is consumed and can be deleted.
   item->consumed = true;
+  _cq_countFetch(self, item);
   
-  //move to next item.
-  self->nextItemNode = getNextNodeOfSListNode(self->nextItemNode);
-  // TODO: Check what happens to the memory allocated to store the command!!!
   // Unlock the write mutex
   unlockMutex(&self->cmdQueueMutex);  
 
@@ -293,8 +574,7 @@ CommandQueueItem* fetchNextCommand(CommandQueue* self)
 }
 
 /**
- * Remove the queue element that is already consumed from the list and frees 
- * up all allocated memory associated with this element.
+ * Frees up all allocated memory associated with the consumed queue element.
  * 
  * @param self The command queue
  * @param item The item. It also will be freed!
@@ -303,33 +583,28 @@ void deleteCommand(CommandQueue* self, CommandQueueItem* item)
 {
   LOG(LEVEL_DEBUG, HDR "Delete the given command queue item.", pthread_self());
   lockMutex (&self->cmdQueueMutex);
-  // Free The packet data within the item
+  self->totalItems--;
+  unlockMutex(&self->cmdQueueMutex);
+  // Free The packet data within the item and the item itself. The item was 
+  // already removed from its lane when it was fetched.
   if(item != NULL) 
   {
     free(item->data);
+    free(item);
   }
-  self->totalItems--;
-  // The delete from list also frees the item.
-  deleteFromSList(&self->queue, item);
-  unlockMutex(&self->cmdQueueMutex);
 }
 
 /**
- * Clears the complete queue.
- * 
- * @param self The command queue.
+ * Free the commands of the given lane.
+ *
+ * @param list The lane.
  */
-void removeAllCommands(CommandQueue* self)
+static void _cq_emptyLane(SList* list)
 {
-  LOG(LEVEL_DEBUG, HDR "Remove all commands from the command queue.",
-                   pthread_self());
   SListNode* currNode;
 
-  // No adding or single removing allowed
-  lockMutex(&self->cmdQueueMutex);
-
   // Release all packets stored in the items
-  FOREACH_SLIST(&self->queue, currNode)
+  FOREACH_SLIST(list, currNode)
   {
     void* p = ((CommandQueueItem*)getDataOfSListNode(currNode))->data;
     if (p)
@@ -338,16 +613,37 @@ void removeAllCommands(CommandQueue* self)
     }
   }
   // Now delete the items.
-  emptySList(&self->queue);
+  emptySList(list);
+}
 
-  if (self->nextItemNode != NULL)
+/**
+ * Clears the complete queue. Commands already fetched are not affected.
+ * 
+ * @param self The command queue.
+ */
+void removeAllCommands(CommandQueue* self)
+{
+  LOG(LEVEL_DEBUG, HDR "Remove all commands from the command queue.",
+                   pthread_self());
+  uint32_t idx;
+
+  // No adding or single removing allowed
+  lockMutex(&self->cmdQueueMutex);
+
+  _cq_emptyLane(&self->queue);
+  for (idx = 0; idx < self->noClients; idx++)
   {
-    RAISE_SYS_ERROR("Queue[0x%08X] Removing of all commands without success!", 
-                    self);
-  };
+    _cq_emptyLane(&self->clients[idx].commands);
+  }
+  self->noClients = 0;
+  self->rrIndex   = 0;
+  self->prioBurst = 0;
+  self->bulkItems = 0;
+  setCommandQueueDepth(0, 0);
   
-  self->totalItems       = self->queue.size;
-  self->unprocessedItems = self->nextItemNode == NULL ? 0 : self->totalItems;
+  // Only the fetched commands remain.
+  self->totalItems      -= self->unprocessedItems;
+  self->unprocessedItems = 0;
   
   // Grant write access again
   unlockMutex(&self->cmdQueueMutex); 
@@ -376,3 +672,41 @@ inline int getUnprocessedQueueSize(CommandQueue* self)
 {
   return self->unprocessedItems;
 }
+
+/**
+ * Fill the given statistics of the command queue lanes.
+ *
+ * @param self The command queue
+ * @param stats (out) The statistics.
+ *
+ * @since 0.6.3.0
+ */
+void getCommandQueueStats(CommandQueue* self, CommandQueueStats* stats)
+{
+  uint32_t idx;
+
+  lockMutex(&self->cmdQueueMutex);
+  *stats = self->stats;
+  stats->prioDepth = self->queue.size;
+  stats->bulkDepth = self->bulkItems;
+  for (idx = 0; idx < self->noClients; idx++)
+  {
+    if (self->clients[idx].commands.size > 0)
+    {
+      stats->bulkClients++;
+      if (self->clients[idx].commands.size > stats->maxClientDepth)
+      {
+        stats->maxClientDepth = self->clients[idx].commands.size;
+      }
+    }
+  }
+  if (self->stats.prioFetched > 0)
+  {
+    stats->avgPrioWaitUs = self->sumPrioWaitUs / self->stats.prioFetched;
+  }
+  if (self->stats.bulkFetched > 0)
+  {
+    stats->avgBulkWaitUs = self->sumBulkWaitUs / self->stats.bulkFetched;
+  }
+  unlockMutex(&self->cmdQueueMutex);
+}
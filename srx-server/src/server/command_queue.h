@@ -20,6 +20,14 @@
  * other licenses. Please refer to the licenses of all libraries required 
  * by this software.
  *
+ * The command queue has two lanes. The priority lane is served first and 
+ * keeps the control PDUs and the live updates of the clients. A client that 
+ * has more than CMD_QUEUE_PRIORITY_LIMIT commands in the priority lane, e.g. 
+ * during the initial table load or a resynchronization, is moved into the 
+ * bulk lane until its commands are processed. The bulk lane keeps the 
+ * commands per client and serves the clients by deficit round robin. The 
+ * commands of one client are fetched in the order they were queued.
+ *
  * @version 0.5.0.6
  *
  * Changelog:
@@ -46,10 +54,22 @@
 #include "util/server_socket.h"
 #include "util/slist.h"
 
+/** The number of commands a client can have in the priority lane before its 
+ * further commands are moved into the bulk lane. */
+#define CMD_QUEUE_PRIORITY_LIMIT 256
+/** The number of bytes a client lane can be served per round. */
+#define CMD_QUEUE_QUANTUM        4096
+/** The number of commands fetched in a row from the priority lane before one 
+ * command of the bulk lane is fetched. */
+#define CMD_QUEUE_PRIORITY_BURST 64
+
 // Specifies the types of commands the queue can handle.
 typedef enum {
   COMMAND_TYPE_SRX_PROXY = 0,
-  COMMAND_TYPE_SHUTDOWN  = 1
+  COMMAND_TYPE_SHUTDOWN  = 1,
+  // BGPsec revalidation of the update in dataID after a key change. Queued 
+  // by the RPKI handler if the crypto workers cannot take it.
+  COMMAND_TYPE_REVALIDATE = 2
 } CommandQueueType;
 /** 
  * A Command Queue Item.
@@ -58,20 +78,77 @@ typedef struct {
   ServerSocket*    serverSocket; // Server socket that received the packet
   ServerClient*    client;       // Client that sent the packet
   CommandQueueType cmdType;      // The type of the command
-  uint32_t         dataID;       // For the case of SRX_PROXY  it contains the 
-                                 // update id in host format.
+  uint32_t         dataID;       // For the case of SRX_PROXY and REVALIDATE
+                                 // it contains the update id in host format.
   bool             consumed;     // Indicated if this element is already fetched
   uint32_t         dataLength;   // Length in Bytes of \c packet
   uint8_t*         data;         // The actual packet (= data)
+  uint64_t         queued;       // The time the command was queued
+                                 // (metricsNow), 0 = not measured.
+  uint64_t         arrival;      // The time in microseconds the command was 
+                                 // queued, used for the lane statistics.
+  bool             priority;     // The command was queued in the priority 
+                                 // lane.
 } CommandQueueItem;
 
+/**
+ * The bulk lane of one client.
+ */
+typedef struct {
+  ServerClient* client;     // The client of the commands.
+  SList         commands;   // The commands of the client in the bulk lane.
+  uint32_t      prioItems;  // The commands of the client waiting in the 
+                            // priority lane.
+  int64_t       deficit;    // The bytes the lane can still be served with.
+  bool          bulk;       // New commands are added to the bulk lane.
+} CommandQueueClient;
+
+/**
+ * Snapshot of the command queue statistics.
+ */
+typedef struct {
+  /** Number of commands waiting in the priority lane. */
+  uint32_t prioDepth;
+  /** Highest priority lane depth seen so far. */
+  uint32_t maxPrioDepth;
+  /** Number of commands waiting in the bulk lane. */
+  uint32_t bulkDepth;
+  /** Highest bulk lane depth seen so far. */
+  uint32_t maxBulkDepth;
+  /** Number of clients with commands in the bulk lane. */
+  uint32_t bulkClients;
+  /** Number of commands of the client with the most commands in the bulk 
+   * lane. */
+  uint32_t maxClientDepth;
+  /** Number of commands fetched from the priority lane. */
+  uint64_t prioFetched;
+  /** Number of commands fetched from the bulk lane. */
+  uint64_t bulkFetched;
+  /** Average time in microseconds a command waited in the priority lane. */
+  uint64_t avgPrioWaitUs;
+  /** Maximum time in microseconds a command waited in the priority lane. */
+  uint64_t maxPrioWaitUs;
+  /** Average time in microseconds a command waited in the bulk lane. */
+  uint64_t avgBulkWaitUs;
+  /** Maximum time in microseconds a command waited in the bulk lane. */
+  uint64_t maxBulkWaitUs;
+} CommandQueueStats;
+
 /**
  * A single Command Queue.
  */
 typedef struct {
-  SList       queue;          // The list that actually represents the queue.
-  SListNode*  nextItemNode;   // The next node containing a CommandQueueItem to be 
-                              // fetched.
+  SList       queue;          // The priority lane.
+  CommandQueueClient* clients; // The clients with queued commands.
+  uint32_t    noClients;      // The number of clients.
+  uint32_t    sizeClients;    // The number of clients allocated.
+  uint32_t    rrIndex;        // The client lane served by the round robin.
+  uint32_t    prioBurst;      // Commands fetched in a row from the priority 
+                              // lane.
+  uint32_t    bulkItems;      // The number of commands in the bulk lane.
+  CommandQueueStats stats;    // The lane statistics.
+  uint64_t    sumPrioWaitUs;  // Sum of the priority lane waiting times.
+  uint64_t    sumBulkWaitUs;  // Sum of the bulk lane waiting times.
   Mutex       cmdQueueMutex; // Used to safely access the queue in read and
                               // write
   Cond        consumeCond;    // The condition for consuming elements from the 
@@ -101,7 +178,8 @@ void releaseCommandQueue(CommandQueue* self);
 
 /**
  * Add a given command into the command queue. THe type of command is stored in 
- * the parameter cmdType.
+ * the parameter cmdType. The command is added to the priority lane unless the
+ * client is in the bulk lane or exceeds CMD_QUEUE_PRIORITY_LIMIT.
  *
  * @param self The command queue where the command has to be added to
  * @param cmdType The type of the command.
@@ -119,8 +197,8 @@ bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
                   uint32_t dataLength, uint8_t* data);
 
 /** 
- * Returns the next item in the queue. The Item is NOT removed from the queue
- * until dequeueCommand is called. 
+ * Returns the next item in the queue. The Item is NOT freed until 
+ * deleteCommand is called. 
  *
  * @note Blocks until a command is available!
  *
@@ -161,5 +239,15 @@ int getTotalQueueSize(CommandQueue* self);
  * @return the number of unprocessed items in the queue.
  */
 int getUnprocessedQueueSize(CommandQueue* self);
+
+/**
+ * Fill the given statistics of the command queue lanes.
+ *
+ * @param self The command queue
+ * @param stats (out) The statistics.
+ *
+ * @since 0.6.3.0
+ */
+void getCommandQueueStats(CommandQueue* self, CommandQueueStats* stats);
 #endif // !__COMMAND_QUEUE_H__
 
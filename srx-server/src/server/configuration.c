@@ -87,6 +87,8 @@
 #include <libconfig.h>
 #include <pthread.h>
 #include "server/configuration.h"
+#include "server/crypto_worker.h"
+#include "server/srx_packet_sender.h"
 #include "server/srx_server.h"  // For server name and version number
 #include "server/update_cache.h"
 #include "shared/srx_defs.h"
@@ -118,6 +120,25 @@
 
 #define CFG_PARAM_MODE_NO_SEND_QUEUE 10
 #define CFG_PARAM_MODE_NO_RCV_QUEUE  11
+#define CFG_PARAM_MODE_SHM_TRANSPORT 14
+
+#define CFG_PARAM_BGPSEC_WORKERS      12
+#define CFG_PARAM_BGPSEC_MAX_INFLIGHT 13
+
+#define CFG_PARAM_SNAPSHOT_FILE     15
+#define CFG_PARAM_SNAPSHOT_INTERVAL 16
+
+#define CFG_PARAM_METRICS_PORT   17
+#define CFG_PARAM_METRICS_SOCKET 18
+
+#define CFG_PARAM_TRACE_SAMPLE_RATE 19
+#define CFG_PARAM_TRACE_FILE        20
+
+#define CFG_PARAM_EXPORT_FILE    21
+#define CFG_PARAM_EXPORT_FORMAT  22
+
+#define CFG_PARAM_FLOW_WINDOW     23
+#define CFG_PARAM_FLOW_SEND_QUEUE 24
 
 #define HDR "([0x%08X] Configuration): "
 
@@ -131,6 +152,7 @@
 
 // Forward declaration
 static char* _duplicateString(char* src, char** dest, const char* err);
+static bool _readSKI(const char* hexStr, uint8_t* ski);
 
 /** Supported short options */
 static const char* _SHORT_OPTIONS = "hf:v:::sl:CkpcP::::::";
@@ -169,9 +191,31 @@ static const struct option _LONG_OPTIONS[] = {
                                                 CFG_PARAM_RPKI_ROUTER_PROTOCOL},
 
   { "bgpsec.srxcryptoapi_cfg",  optional_argument, NULL, CFG_PARAM_SCA_CFG},
+  { "bgpsec.worker_threads", required_argument, NULL, 
+                                                CFG_PARAM_BGPSEC_WORKERS},
+  { "bgpsec.max_inflight",   required_argument, NULL, 
+                                                CFG_PARAM_BGPSEC_MAX_INFLIGHT},
+
+  { "snapshot.file",     required_argument, NULL, CFG_PARAM_SNAPSHOT_FILE},
+  { "snapshot.interval", required_argument, NULL, 
+                                                CFG_PARAM_SNAPSHOT_INTERVAL},
+
+  { "metrics.port",   required_argument, NULL, CFG_PARAM_METRICS_PORT},
+  { "metrics.socket", required_argument, NULL, CFG_PARAM_METRICS_SOCKET},
+
+  { "trace.sample_rate", required_argument, NULL, 
+                                                CFG_PARAM_TRACE_SAMPLE_RATE},
+  { "trace.file",        required_argument, NULL, CFG_PARAM_TRACE_FILE},
+
+  { "export.file",   required_argument, NULL, CFG_PARAM_EXPORT_FILE},
+  { "export.format", required_argument, NULL, CFG_PARAM_EXPORT_FORMAT},
+
+  { "flow.window",     required_argument, NULL, CFG_PARAM_FLOW_WINDOW},
+  { "flow.send_queue", required_argument, NULL, CFG_PARAM_FLOW_SEND_QUEUE},
 
   { "mode.no-sendqueue", no_argument, NULL, CFG_PARAM_MODE_NO_SEND_QUEUE},
   { "mode.no-receivequeue", no_argument, NULL, CFG_PARAM_MODE_NO_RCV_QUEUE},
+  { "mode.shm-transport", no_argument, NULL, CFG_PARAM_MODE_SHM_TRANSPORT},
 
   { NULL, 0, NULL, 0}
 };
@@ -204,13 +248,43 @@ static const char* _USAGE_TEXT =
   "      --rpki.router_protocol <0|1>\n"
   "                               RPKI  to Router protocol version number\n"
   "      --bgpsec.srxcryptoapi_cfg <configuration-file>\n"
-  "                               SRxCryptoAPI configuration file.\n\n"
+  "                               SRxCryptoAPI configuration file.\n"
+  "      --bgpsec.worker_threads <no>\n"
+  "                               Number of BGPsec validation threads. Zero\n"
+  "                               validates within the command handler.\n"
+  "      --bgpsec.max_inflight <no>\n"
+  "                               Maximum number of BGPsec validations in\n"
+  "                               the validation queue.\n"
+  "      --snapshot.file <file>   Restore the state from this snapshot at\n"
+  "                               startup and write it at shutdown.\n"
+  "      --snapshot.interval <sec>\n"
+  "                               Write the snapshot periodically. Zero\n"
+  "                               writes it only at shutdown.\n"
+  "      --metrics.port <no>      Serve the metrics in Prometheus format on\n"
+  "                               this port of the loopback interface.\n"
+  "      --metrics.socket <file>  Serve the metrics in Prometheus format on\n"
+  "                               this unix domain socket.\n"
+  "      --trace.sample_rate <no> Trace the stages of one out of <no>\n"
+  "                               updates. Zero disables the trace.\n"
+  "      --trace.file <file>      The file the trace is dumped into with\n"
+  "                               the console command dump-trace and at\n"
+  "                               shutdown.\n"
+  "      --export.file <file>     The file the update cache is exported\n"
+  "                               into when the server receives SIGUSR1.\n"
+  "      --export.format <fmt>    The format of the export, xml (default)\n"
+  "                               or json (JSON Lines).\n"
+  "      --flow.window <no>       Maximum number of validation requests a\n"
+  "                               proxy can have outstanding.\n"
+  "      --flow.send_queue <no>   Maximum number of packets queued for a\n"
+  "                               proxy before it is disconnected.\n\n"
   " Experimental Options:\n=====================\n"
   "      --mode.no-sendqueue      Disable send queue for immediate results.\n"
   "                               This is experimental.\n"
   "      --mode.no-receivequeue   Disable the receive queue. This queue allows"
   "\n                               to push the processing of packets into\n"
   "                                its own thread. This is experimental.\n"
+  "      --mode.shm-transport     Accept the shared memory transport offered\n"
+  "                               by proxies on the same host.\n"
 ;
 
 /**
@@ -248,14 +322,34 @@ void initConfiguration(Configuration* self)
   self->rpki_host = NULL;
   self->rpki_port = -1;
   self->rpki_router_protocol = RPKI_2_RTR_8210;
+  memset(self->rpki_caches, 0, sizeof(self->rpki_caches));
+  self->rpki_num_caches = 0;
 
   self->sca_configuration = NULL;
   self->sca_sync_logging  = true;
+  self->bgpsec_worker_threads = CW_DEF_WORKER_THREADS;
+  self->bgpsec_max_inflight   = CW_DEF_MAX_INFLIGHT;
+
+  self->snapshot_file     = NULL;
+  self->snapshot_interval = 0;
+
+  self->metrics_port   = 0;
+  self->metrics_socket = NULL;
+
+  self->trace_sample_rate = 0;
+  self->trace_file        = NULL;
+
+  self->export_file = NULL;
+  self->export_json = false;
+
+  self->flow_window     = SQ_DEF_WINDOW;
+  self->flow_send_queue = SQ_DEF_QUEUE_LIMIT;
   
   self->expectedProxies = DEFAULT_NUMBER_CLIENTS;
 
   self->mode_no_sendqueue = false;
   self->mode_no_receivequeue = false;
+  self->mode_shm_transport   = false;
 
 #ifdef USE_GRPC
 #define DEFAULT_GRPC_PORT 50051
@@ -287,14 +381,62 @@ void releaseConfiguration(Configuration* self)
     {
       free(self->rpki_host);
     }
+    while (self->rpki_num_caches > 0)
+    {
+      self->rpki_num_caches--;
+      free(self->rpki_caches[self->rpki_num_caches].host);
+    }
     if (self->sca_configuration!= NULL)
     {
       free(self->sca_configuration);
     }
+    if (self->snapshot_file != NULL)
+    {
+      free(self->snapshot_file);
+    }
+    if (self->metrics_socket != NULL)
+    {
+      free(self->metrics_socket);
+    }
+    if (self->trace_file != NULL)
+    {
+      free(self->trace_file);
+    }
+    if (self->export_file != NULL)
+    {
+      free(self->export_file);
+    }
   }
   LOG(LEVEL_DEBUG, HDR "Configuration objects released", pthread_self());
 }
 
+/**
+ * Convert the given hex string into a SKI.
+ *
+ * @param hexStr The SKI as hex string (40 characters)
+ * @param ski The byte array the SKI is written into (CFG_SKI_LENGTH bytes)
+ *
+ * @return true if the string contained a valid SKI.
+ */
+static bool _readSKI(const char* hexStr, uint8_t* ski)
+{
+  int idx;
+
+  if ((hexStr == NULL) || (strlen(hexStr) != CFG_SKI_LENGTH * 2))
+  {
+    return false;
+  }
+  for (idx = 0; idx < CFG_SKI_LENGTH; idx++)
+  {
+    if (sscanf(hexStr + (idx * 2), "%2hhx", &ski[idx]) != 1)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 /**
  * Create a duplicate of the given string. The duplicate is stored in memory
  * allocated for the string and MUST be freed later on.
@@ -399,9 +541,22 @@ int parseProgramArgs(Configuration* self, int argc, const char** argv,
         case CFG_PARAM_RPKI_HOST:
         case CFG_PARAM_RPKI_PORT:
         case CFG_PARAM_SCA_CFG:
+        case CFG_PARAM_BGPSEC_WORKERS:
+        case CFG_PARAM_BGPSEC_MAX_INFLIGHT:
+        case CFG_PARAM_SNAPSHOT_FILE:
+        case CFG_PARAM_SNAPSHOT_INTERVAL:
+        case CFG_PARAM_METRICS_PORT:
+        case CFG_PARAM_METRICS_SOCKET:
+        case CFG_PARAM_TRACE_SAMPLE_RATE:
+        case CFG_PARAM_TRACE_FILE:
+        case CFG_PARAM_EXPORT_FILE:
+        case CFG_PARAM_EXPORT_FORMAT:
+        case CFG_PARAM_FLOW_WINDOW:
+        case CFG_PARAM_FLOW_SEND_QUEUE:
         case CFG_PARAM_CREDITS:
         case CFG_PARAM_MODE_NO_SEND_QUEUE:
         case CFG_PARAM_MODE_NO_RCV_QUEUE:
+        case CFG_PARAM_MODE_SHM_TRANSPORT:
           optc = -1;
           break;
         default:
@@ -561,6 +716,143 @@ int parseProgramArgs(Configuration* self, int argc, const char** argv,
           return 0;
         }
         break;
+      case CFG_PARAM_BGPSEC_WORKERS:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Number of BGPsec worker threads missing!");
+          return 0;
+        }
+        self->bgpsec_worker_threads = strtol(optarg, NULL, 10);
+        break;
+      case CFG_PARAM_BGPSEC_MAX_INFLIGHT:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Maximum number of BGPsec validations missing!");
+          return 0;
+        }
+        self->bgpsec_max_inflight = strtol(optarg, NULL, 10);
+        if (self->bgpsec_max_inflight == 0)
+        {
+          RAISE_ERROR("Invalid maximum number of BGPsec validations ('%s')",
+                      optarg);
+          return 0;
+        }
+        break;
+      case CFG_PARAM_SNAPSHOT_FILE:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Snapshot file missing!");
+          return 0;
+        }
+        self->snapshot_file = _duplicateString(optarg, &self->snapshot_file,
+                                               "Snapshot file");
+        if (self->snapshot_file == NULL)
+        {
+          RAISE_ERROR("Could not set the snapshot file '%s'!", optarg);
+          return 0;
+        }
+        break;
+      case CFG_PARAM_SNAPSHOT_INTERVAL:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Snapshot interval missing!");
+          return 0;
+        }
+        self->snapshot_interval = strtol(optarg, NULL, 10);
+        break;
+      case CFG_PARAM_METRICS_PORT:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Metrics port missing!");
+          return 0;
+        }
+        self->metrics_port = strtol(optarg, NULL, 10);
+        break;
+      case CFG_PARAM_METRICS_SOCKET:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Metrics socket missing!");
+          return 0;
+        }
+        self->metrics_socket = _duplicateString(optarg, &self->metrics_socket,
+                                                "Metrics socket");
+        if (self->metrics_socket == NULL)
+        {
+          RAISE_ERROR("Could not set the metrics socket '%s'!", optarg);
+          return 0;
+        }
+        break;
+      case CFG_PARAM_TRACE_SAMPLE_RATE:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Trace sample rate missing!");
+          return 0;
+        }
+        self->trace_sample_rate = strtoul(optarg, NULL, 10);
+        break;
+      case CFG_PARAM_TRACE_FILE:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Trace file missing!");
+          return 0;
+        }
+        self->trace_file = _duplicateString(optarg, &self->trace_file,
+                                            "Trace file");
+        if (self->trace_file == NULL)
+        {
+          RAISE_ERROR("Could not set the trace file '%s'!", optarg);
+          return 0;
+        }
+        break;
+      case CFG_PARAM_EXPORT_FILE:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Export file missing!");
+          return 0;
+        }
+        self->export_file = _duplicateString(optarg, &self->export_file,
+                                             "Export file");
+        if (self->export_file == NULL)
+        {
+          RAISE_ERROR("Could not set the export file '%s'!", optarg);
+          return 0;
+        }
+        break;
+      case CFG_PARAM_EXPORT_FORMAT:
+        if ((optarg == NULL) || (   (strcmp(optarg, "xml") != 0)
+                                 && (strcmp(optarg, "json") != 0)))
+        {
+          RAISE_ERROR("Export format must be xml or json!");
+          return 0;
+        }
+        self->export_json = strcmp(optarg, "json") == 0;
+        break;
+      case CFG_PARAM_FLOW_WINDOW:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Flow control window missing!");
+          return 0;
+        }
+        self->flow_window = strtoul(optarg, NULL, 10);
+        if (self->flow_window == 0)
+        {
+          RAISE_ERROR("Invalid flow control window ('%s')", optarg);
+          return 0;
+        }
+        break;
+      case CFG_PARAM_FLOW_SEND_QUEUE:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Size of the send queue missing!");
+          return 0;
+        }
+        self->flow_send_queue = strtoul(optarg, NULL, 10);
+        if (self->flow_send_queue == 0)
+        {
+          RAISE_ERROR("Invalid size of the send queue ('%s')", optarg);
+          return 0;
+        }
+        break;
       case CFG_PARAM_CREDITS:
         printf ("%s\n", SRX_CREDITS);
         printf("%s Version %s\n", SRX_SERVER_NAME, SRX_SERVER_VERSION);
@@ -588,6 +880,9 @@ int parseProgramArgs(Configuration* self, int argc, const char** argv,
         self->mode_no_receivequeue = true;
         printf("Turn off receive queue!\n");
         break;
+      case CFG_PARAM_MODE_SHM_TRANSPORT:
+        self->mode_shm_transport = true;
+        break;
       default:
         RAISE_ERROR("Usage: %s %s", argv[0], _USAGE_TEXT);        
         return 0;
@@ -785,6 +1080,44 @@ bool readConfigFile(Configuration* self, const char* filename)
           goto free_config;
       }
     }
+
+    // optional additional validation caches
+    config_setting_t* caches = config_lookup(&cfg, "rpki.caches");
+    if (caches != NULL)
+    {
+      int numCaches = config_setting_length(caches);
+      int cacheIdx;
+      if (numCaches > MAX_RPKI_CACHES - 1)
+      {
+        LOG(LEVEL_ERROR, "Only %u validation caches are supported!", 
+                         MAX_RPKI_CACHES);
+        goto free_config;
+      }
+      for (cacheIdx = 0; cacheIdx < numCaches; cacheIdx++)
+      {
+        config_setting_t* cache = config_setting_get_elem(caches, cacheIdx);
+        int idx = self->rpki_num_caches;
+        if (   (config_setting_lookup_string(cache, "host", &strtmp) 
+                != CONFIG_TRUE)
+            || (config_setting_lookup_int(cache, "port", &intVal) 
+                != CONFIG_TRUE)
+            || (intVal <= 0))
+        {
+          LOG(LEVEL_ERROR, "rpki.caches[%d]: host or port is missing!", 
+                           cacheIdx);
+          goto free_config;
+        }
+        self->rpki_caches[idx].host = _duplicateString((char*)strtmp, 
+                                        &self->rpki_caches[idx].host,
+                                        "RPKI Validation Cache host name");
+        if (self->rpki_caches[idx].host == NULL)
+        {
+          goto free_config;
+        }
+        self->rpki_caches[idx].port = (int)intVal;
+        self->rpki_num_caches++;
+      }
+    }
   }
   else
   {
@@ -807,6 +1140,50 @@ bool readConfigFile(Configuration* self, const char* filename)
     if (config_setting_lookup_bool(sett, "sync_logging", 
                                    (int*)&boolVal) == CONFIG_TRUE )
     { self->sca_sync_logging = (bool)boolVal; }
+
+    if ( config_setting_lookup_int(sett, "worker_threads", &intVal) 
+         == CONFIG_TRUE )
+    { self->bgpsec_worker_threads = (uint32_t)intVal; }
+
+    if ( config_setting_lookup_int(sett, "max_inflight", &intVal) 
+         == CONFIG_TRUE )
+    { self->bgpsec_max_inflight = (uint32_t)intVal; }
+
+    // optional private keys used for signing
+    config_setting_t* keys = config_lookup(&cfg, "bgpsec.signing_keys");
+    if (keys != NULL)
+    {
+      int numKeys = config_setting_length(keys);
+      int keyIdx;
+      if (numKeys > MAX_SIGN_KEYS)
+      {
+        LOG(LEVEL_ERROR, "Only %u signing keys are supported!", MAX_SIGN_KEYS);
+        goto free_config;
+      }
+      self->bgpsec_num_sign_keys = 0;
+      for (keyIdx = 0; keyIdx < numKeys; keyIdx++)
+      {
+        config_setting_t* key = config_setting_get_elem(keys, keyIdx);
+        int idx = self->bgpsec_num_sign_keys;
+        if (config_setting_lookup_int(key, "asn", &intVal) != CONFIG_TRUE)
+        {
+          LOG(LEVEL_ERROR, "bgpsec.signing_keys[%d]: asn is missing!", keyIdx);
+          goto free_config;
+        }
+        self->bgpsec_sign_keys[idx].asn = (uint32_t)intVal;
+        if (   (config_setting_lookup_string(key, "ski", &strtmp) != CONFIG_TRUE)
+            || !_readSKI(strtmp, self->bgpsec_sign_keys[idx].ski))
+        {
+          LOG(LEVEL_ERROR, "bgpsec.signing_keys[%d]: ski is missing or not a "
+                           "%u byte hex string!", keyIdx, CFG_SKI_LENGTH);
+          goto free_config;
+        }
+        self->bgpsec_sign_keys[idx].algoID = 1;
+        if (config_setting_lookup_int(key, "algo_id", &intVal) == CONFIG_TRUE)
+        { self->bgpsec_sign_keys[idx].algoID = (uint8_t)intVal; }
+        self->bgpsec_num_sign_keys++;
+      }
+    }
   }
   else
   {
@@ -814,6 +1191,99 @@ bool readConfigFile(Configuration* self, const char* filename)
     goto free_config;
   }
 
+  // optional snapshot
+  sett = config_lookup(&cfg, "snapshot");
+  if (sett != NULL)
+  {
+    if (config_setting_lookup_string(sett, "file", &strtmp))
+    {
+      self->snapshot_file = _duplicateString((char*)strtmp, 
+                                             &self->snapshot_file,
+                                             "Snapshot file");
+      if (self->snapshot_file == NULL)
+      {
+        goto free_config;
+      }
+    }
+    if ( config_setting_lookup_int(sett, "interval", &intVal) == CONFIG_TRUE )
+    { self->snapshot_interval = (uint32_t)intVal; }
+  }
+
+  // optional metrics
+  sett = config_lookup(&cfg, "metrics");
+  if (sett != NULL)
+  {
+    if ( config_setting_lookup_int(sett, "port", &intVal) == CONFIG_TRUE )
+    { self->metrics_port = (int)intVal; }
+
+    if (config_setting_lookup_string(sett, "socket", &strtmp))
+    {
+      self->metrics_socket = _duplicateString((char*)strtmp, 
+                                              &self->metrics_socket,
+                                              "Metrics socket");
+      if (self->metrics_socket == NULL)
+      {
+        goto free_config;
+      }
+    }
+  }
+
+  // optional trace
+  sett = config_lookup(&cfg, "trace");
+  if (sett != NULL)
+  {
+    if ( config_setting_lookup_int(sett, "sample_rate", &intVal) 
+         == CONFIG_TRUE )
+    { self->trace_sample_rate = (uint32_t)intVal; }
+
+    if (config_setting_lookup_string(sett, "file", &strtmp))
+    {
+      self->trace_file = _duplicateString((char*)strtmp, &self->trace_file,
+                                          "Trace file");
+      if (self->trace_file == NULL)
+      {
+        goto free_config;
+      }
+    }
+  }
+
+  // optional update cache export
+  sett = config_lookup(&cfg, "export");
+  if (sett != NULL)
+  {
+    if (config_setting_lookup_string(sett, "file", &strtmp))
+    {
+      self->export_file = _duplicateString((char*)strtmp, &self->export_file,
+                                           "Export file");
+      if (self->export_file == NULL)
+      {
+        goto free_config;
+      }
+    }
+
+    if (config_setting_lookup_string(sett, "format", &strtmp))
+    {
+      if ((strcmp(strtmp, "xml") != 0) && (strcmp(strtmp, "json") != 0))
+      {
+        RAISE_ERROR("Export format must be xml or json!");
+        goto free_config;
+      }
+      self->export_json = strcmp(strtmp, "json") == 0;
+    }
+  }
+
+  // optional flow control
+  sett = config_lookup(&cfg, "flow");
+  if (sett != NULL)
+  {
+    if ( config_setting_lookup_int(sett, "window", &intVal) == CONFIG_TRUE )
+    { self->flow_window = (uint32_t)intVal; }
+
+    if ( config_setting_lookup_int(sett, "send_queue", &intVal) 
+         == CONFIG_TRUE )
+    { self->flow_send_queue = (uint32_t)intVal; }
+  }
+
 #ifdef USE_GRPC 
   // grpc
   sett = config_lookup(&cfg, "grpc");
@@ -836,6 +1306,10 @@ bool readConfigFile(Configuration* self, const char* filename)
     if ( config_setting_lookup_bool(sett, "no-receivequeue", (int*)&boolVal) 
          == CONFIG_TRUE )
     { self->mode_no_receivequeue = (bool)boolVal; }
+
+    if ( config_setting_lookup_bool(sett, "shm-transport", (int*)&boolVal) 
+         == CONFIG_TRUE )
+    { self->mode_shm_transport = (bool)boolVal; }
   }
 
   // optional mapping configuration
@@ -895,6 +1369,13 @@ bool isCompleteConfiguration(Configuration* self)
                "Host name of validation cache is not set!");
   STOP_IF_TRUE(self->rpki_port <= 0,
                "Port number of validation cache is not set or invalid!");
+  ERROR_IF_TRUE(self->bgpsec_worker_threads > CW_MAX_WORKER_THREADS,
+                "Too many BGPsec worker threads '%u' (max. %u)!",
+                self->bgpsec_worker_threads, CW_MAX_WORKER_THREADS);
+  ERROR_IF_TRUE(self->flow_window == 0,
+                "The flow control window must be at least 1!");
+  ERROR_IF_TRUE(self->flow_send_queue == 0,
+                "The send queue must hold at least 1 packet!");
   ERROR_IF_TRUE(self->defaultKeepWindow <= 0,
                 "The keep-window time can not be negative!");
   ERROR_IF_TRUE(self->defaultKeepWindow > 0xFFFF,
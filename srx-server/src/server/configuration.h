@@ -62,6 +62,12 @@
 #define SRX_DEF_CONSOLE_PORT     17901
 
 #define MAX_PROXY_MAPPINGS 256
+/** The maximum number of private keys that can be configured for signing. */
+#define MAX_SIGN_KEYS      8
+/** The length of a SKI in bytes. */
+#define CFG_SKI_LENGTH     20
+/** The maximum number of validation caches srx-server is connected to. */
+#define MAX_RPKI_CACHES    8
 
 // CONFIG_INT will be set to int for 64 bit platform during configure. See
 // configuration.ac - used for libconfig
@@ -117,6 +123,14 @@ typedef struct {
   int                   rpki_port;
   /* rpki router server protocol version number */
   int                   rpki_router_protocol;
+  /** Additional validation caches, their data is merged with the data of
+   * rpki_host. */
+  struct {
+    char*               host;
+    int                 port;
+  }                     rpki_caches[MAX_RPKI_CACHES - 1];
+  /** Number of additional validation caches. */
+  uint8_t               rpki_num_caches;
 
   // BGPSec path validation
   /** Host name of the BGPSec protocol server */
@@ -124,6 +138,19 @@ typedef struct {
   /** Allow to synchronize the SCA log level with the one from srx-server.
    * REquires SCA to provide the capability to do so*/
   bool                  sca_sync_logging;
+  /** Number of crypto worker threads that perform the BGPsec validation. 
+   * Zero performs the validation within the command handler. */
+  uint32_t              bgpsec_worker_threads;
+  /** Maximum number of BGPsec validations queued or processed at once. */
+  uint32_t              bgpsec_max_inflight;
+  /** The private keys used for signing (ASN in host format). */
+  struct {
+    uint32_t            asn;
+    uint8_t             algoID;
+    uint8_t             ski[CFG_SKI_LENGTH];
+  }                     bgpsec_sign_keys[MAX_SIGN_KEYS];
+  /** Number of private keys configured for signing. */
+  uint8_t               bgpsec_num_sign_keys;
   
   char*                 as_relationship_data; // for aspa direction
   
@@ -134,6 +161,36 @@ typedef struct {
   bool                  mode_no_sendqueue;
   /** If set true, disable the receiver queue. */
   bool                  mode_no_receivequeue;
+  /** If set true, accept the shared memory transport offered by proxies. */
+  bool                  mode_shm_transport;
+
+  /** The snapshot used for a warm restart. NULL = deactivate. */
+  char*                 snapshot_file;
+  /** The interval in seconds the snapshot is written. Zero = only at 
+   * shutdown. */
+  uint32_t              snapshot_interval;
+
+  /** The local TCP port the metrics are served on. Zero = deactivate. */
+  int                   metrics_port;
+  /** The unix domain socket the metrics are served on. NULL = deactivate. */
+  char*                 metrics_socket;
+
+  /** One out of trace_sample_rate updates is traced. Zero = deactivate. */
+  uint32_t              trace_sample_rate;
+  /** The dump file the trace is drained into. */
+  char*                 trace_file;
+
+  /** The file the update cache is exported into on SIGUSR1. NULL = 
+   * deactivate. */
+  char*                 export_file;
+  /** Export as JSON Lines instead of XML. */
+  bool                  export_json;
+
+  /** The maximum number of validation requests a proxy can have 
+   * outstanding. */
+  uint32_t              flow_window;
+  /** The maximum number of packets queued for a proxy. */
+  uint32_t              flow_send_queue;
 
   /** The configured default keep window. Zero = deactivate.*/
   int                   defaultKeepWindow;
@@ -78,13 +78,17 @@
 #include <stdint.h>
 #include <string.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "server/command_queue.h"
 #include "server/configuration.h"
 #include "server/console.h"
+#include "server/main.h"
 #include "server/prefix_cache.h"
 #include "server/srx_server.h"
 #include "server/srx_packet_sender.h"
+#include "server/trace.h"
 #include "server/update_cache.h"
 #include "shared/srx_defs.h"
 
@@ -149,6 +153,7 @@ static void doNumProxies(SRXConsole* self, char* cmd, char* param);
 static void doCommandQueue(SRXConsole* self, char* cmd, char* param);
 static void doDumpPCache(SRXConsole* self, char* cmd, char* param);
 static void doDumpUCache(SRXConsole* self, char* cmd, char* param);
+static void doDumpTrace(SRXConsole* self, char* cmd, char* param);
 
 static uint32_t hexToInt(char[]);
 
@@ -217,18 +222,26 @@ char* CON_HELP_RESP= "\r\nAvailable commands are:\r\n"
                  " num-proxies           Display the number of proxies "
                                              "attached\r\n"
                  " command-queue         Displays the content of the "
-                                             "command queue.\r\n"
+                                             "command queue and\r\n"
+                 "                       the crypto worker statistics.\r\n"
 #ifdef SRX_ALL
                  " dump-pcache <file>    Dump the prefix cache into a file with"
                  "\r\n                       the given name.\r\n"
-                 " dump-ucache <file>    Dump the update cache into a file with"
-                 "\r\n                       the given name.\r\n"
 #else
                  " dump-pcache           Dump the prefix cache to command line"
                  "\r\n                       of SRx!\r\n"
-                 " dump-ucache           Dump the update cache to command line"
-                 "\r\n                       of SRx!\r\n"
 #endif
+                 " dump-ucache [-|<file>] [json] [<filter> ...]\r\n"
+                 "                       Dump the update cache to the command"
+                 "\r\n                       line of SRx (-) or into a file as"
+                 "\r\n                       XML or JSON Lines.\r\n"
+                 "      filter:= client=<id> | prefix=<prefix/len> |"
+                                " origin=<asn> |\r\n"
+                 "               (roa|bgpsec|aspa)=(valid|invalid|notfound|\r\n"
+                 "               undefined|unknown|unverifiable)\r\n"
+                 " dump-trace [file]     Append the sampled update trace to the"
+                 "\r\n                       given file or the configured "
+                                         "trace.file.\r\n"
                  " !! [<parameter>]      Repeat last command with optional new"
                  "\r\n                       parameter if specified, otherwise"
                  "\r\n                       old parameter!\r\n"
@@ -269,6 +282,7 @@ char* CON_NOPROXY_CMD  = "num-proxies";
 char* CON_COMMAND_QUEUE   = "command-queue";
 char* CON_DUMP_PCACHE_CMD = "dump-pcache";
 char* CON_DUMP_UCACHE_CMD = "dump-ucache";
+char* CON_DUMP_TRACE_CMD  = "dump-trace";
 
 char* CON_SHASPATH_CMD = "show-aspath";
 char* CON_SHASPA_OBJ_CMD = "show-aspa";
@@ -833,6 +847,12 @@ static bool doProcessCommand(SRXConsole* self)
   {
     doDumpUCache(self, cmd, param);
   }
+  // drain the update trace
+  else if (    (cmdLen == strlen(CON_DUMP_TRACE_CMD))
+            && (strncmp(CON_DUMP_TRACE_CMD, cmd, cmdLen)==0))
+  {
+    doDumpTrace(self, cmd, param);
+  }
 
   // show AS path cache 
   else if (    (cmdLen == strlen(CON_SHASPATH_CMD))
@@ -1050,7 +1070,7 @@ static void doChangeLogLevel(SRXConsole* self, char* cmd, char* param)
 }
 
 /**
- * Send a reset query to the validation cache.
+ * Send a reset query to all validation caches.
  *
  * @param self The console
  * @param cmd the rpki-clear command
@@ -1060,17 +1080,23 @@ static void doValCacheReset(SRXConsole* self, char* cmd, char* param)
 {
   LOG(LEVEL_DEBUG, CP1 CP2 "%s %s", self->clientSockFd, cmd, param);
   char* message = NULL;
+  bool  sent    = true;
+  int   idx;
   if (strlen(param) > 0)
   {
     message = "Error: \'rpki-reset\' does not take parameters\r\n";
   }
-  else if (sendResetQuery(&self->rpkiHandler->rrclInstance))
-  {
-    message = "Reset query successfully send to RPKI validation cache!\r\n";
-  }
   else
   {
-    message = "ERROR: Could not send reset query to RPKI validation cache!\r\n";
+    for (idx = 0; idx < self->rpkiHandler->noSessions; idx++)
+    {
+      sent = sendResetQuery(&self->rpkiHandler->sessions[idx].rrclInstance)
+             && sent;
+    }
+    message = sent
+              ? "Reset query successfully send to RPKI validation cache!\r\n"
+              : "ERROR: Could not send reset query to RPKI validation "
+                "cache!\r\n";
   }
   sendToConsoleClient(self, message, true);
 }
@@ -1682,10 +1708,10 @@ static void doShowSRX(SRXConsole* self, char* cmd, char* param)
 
   Configuration* cfg = self->commandHandler->sysConfig;
 
-  char  str[1024];
+  char  str[2048];
   char* strPtr = str;
   // produce a \0 terminated string
-  memset(str,'\0',1024);
+  memset(str,'\0',2048);
 
   strPtr += sprintf(strPtr, "\r\nConfiguration:\r\n==============\r\n");
   strPtr += sprintf(strPtr, "port.....................: %u\r\n", 
@@ -1699,6 +1725,10 @@ static void doShowSRX(SRXConsole* self, char* cmd, char* param)
                             cfg->rpki_port);
   strPtr += sprintf(strPtr, "bgpsec.srxcryptoapi_cfg..: %s\r\n", 
                             cfg->sca_configuration);
+  strPtr += sprintf(strPtr, "bgpsec.worker_threads....: %u\r\n", 
+                            cfg->bgpsec_worker_threads);
+  strPtr += sprintf(strPtr, "bgpsec.max_inflight......: %u\r\n", 
+                            cfg->bgpsec_max_inflight);
   strPtr += sprintf(strPtr, "console.port.............: %u\r\n",
                             cfg->console_port);
   strPtr += sprintf(strPtr, "mode.no-sendque..........: %s\r\n",
@@ -1707,6 +1737,12 @@ static void doShowSRX(SRXConsole* self, char* cmd, char* param)
   strPtr += sprintf(strPtr, "mode.no-receivequeue.....: %s\r\n",
                  cfg->mode_no_receivequeue ? "true  (receive queue turned off)"
                                            : "false (receive queue turned on)");
+  strPtr += sprintf(strPtr, "mode.shm-transport.......: %s\r\n",
+                            cfg->mode_shm_transport ? "true" : "false");
+  strPtr += sprintf(strPtr, "flow.window..............: %u\r\n",
+                            cfg->flow_window);
+  strPtr += sprintf(strPtr, "flow.send_queue..........: %u\r\n",
+                            cfg->flow_send_queue);
   strPtr += sprintf(strPtr, "\r\n");
   sendToConsoleClient(self, str, true);
 }
@@ -1846,7 +1882,9 @@ static void doNumPrefixes(SRXConsole* self, char* cmd, char* param)
   // produce a \0 terminated string
   memset(str,'\0',256);
 
-  elements = self->rpkiHandler->prefixCache->prefixTree->num_active_node;
+  PrefixCache* prefixCache = self->rpkiHandler->prefixCache;
+  elements =   prefixCache->prefixTree[PC_TREE_V4]->num_active_node
+             + prefixCache->prefixTree[PC_TREE_V6]->num_active_node;
   sprintf(str, "Prefix Cache: %u entries.\r\n", elements);
   sendToConsoleClient(self, str, true);
 }
@@ -1882,19 +1920,91 @@ static void doNumProxies(SRXConsole* self, char* cmd, char* param)
 static void doCommandQueue(SRXConsole* self, char* cmd, char* param)
 {
   LOG(LEVEL_DEBUG, CP1 CP2 "%s %s", self->clientSockFd, cmd, param);
-  char str[256];
+  char str[3072];
+  char* strPtr = str;
   int total = getTotalQueueSize(self->commandHandler->queue);
   int unprocessed = getUnprocessedQueueSize(self->commandHandler->queue);
+  CommandQueueStats queueStats;
+  SendQueueStats    sendStats;
   // produce a \0 terminated string
-  memset(str,'\0',256);
+  memset(str,'\0',3072);
+  getCommandQueueStats(self->commandHandler->queue, &queueStats);
 
   // Get the number of elements from the command queue. Here is is for display
   // only, synchronizing is not necessary
-  sprintf(str, "Command handler:\r\n"
+  strPtr += sprintf(strPtr, "Command handler:\r\n"
                "====================================\r\n"
                "Total commands........: %06u\r\n"
                "Unprocessed commands..: %06u\r\n"
-               "====================================\r\n", total, unprocessed);
+               "Priority lane.........: %06u (max: %u)\r\n"
+               "Bulk lane.............: %06u (max: %u, clients: %u, "
+                                        "largest: %u)\r\n"
+               "Priority wait (us)....: avg %llu, max %llu\r\n"
+               "Bulk wait (us)........: avg %llu, max %llu\r\n"
+               "RPKI queue............: %06u\r\n"
+               "====================================\r\n", total, unprocessed,
+               queueStats.prioDepth, queueStats.maxPrioDepth, 
+               queueStats.bulkDepth, queueStats.maxBulkDepth,
+               queueStats.bulkClients, queueStats.maxClientDepth,
+               (unsigned long long)queueStats.avgPrioWaitUs,
+               (unsigned long long)queueStats.maxPrioWaitUs,
+               (unsigned long long)queueStats.avgBulkWaitUs,
+               (unsigned long long)queueStats.maxBulkWaitUs,
+               rq_size(getRPKIQueue()));
+
+  if (self->commandHandler->cryptoPool != NULL)
+  {
+    CryptoWorkerStats stats;
+    getCryptoWorkerStats(self->commandHandler->cryptoPool, &stats);
+    strPtr += sprintf(strPtr, "Crypto workers:\r\n"
+               "====================================\r\n"
+               "Worker threads........: %u\r\n"
+               "Queue depth...........: %06u (max: %u, limit: %u)\r\n"
+               "Key revalidations.....: %06u (max: %u, throttled: %llu)\r\n"
+               "In progress...........: %06u\r\n"
+               "Processed.............: %llu\r\n"
+               "Skipped...............: %llu\r\n"
+               "Throttled.............: %llu\r\n"
+               "Signed................: %llu (failed: %llu, batches: %llu)\r\n"
+               "Queue wait (us).......: avg %llu, max %llu\r\n"
+               "Latency (us)..........: avg %llu, max %llu\r\n"
+               "====================================\r\n",
+               stats.workers, stats.queueDepth, stats.maxQueueDepth, 
+               stats.maxInFlight, stats.prioDepth, stats.maxPrioDepth, 
+               (unsigned long long)stats.prioThrottled, stats.active,
+               (unsigned long long)stats.processed, 
+               (unsigned long long)stats.skipped,
+               (unsigned long long)stats.throttled,
+               (unsigned long long)stats.signatures,
+               (unsigned long long)stats.signFailed,
+               (unsigned long long)stats.signBatches,
+               (unsigned long long)stats.avgWaitUs, 
+               (unsigned long long)stats.maxWaitUs,
+               (unsigned long long)stats.avgTotalUs, 
+               (unsigned long long)stats.maxTotalUs);
+  }
+
+  if (!self->commandHandler->sysConfig->mode_no_sendqueue)
+  {
+    getSendQueueStats(&sendStats);
+    strPtr += sprintf(strPtr, "Send queues:\r\n"
+               "====================================\r\n"
+               "Clients...............: %u (flow control: %u)\r\n"
+               "Queued packets........: %06u (max: %u, limit: %u)\r\n"
+               "Outstanding requests..: %06u (window: %u)\r\n"
+               "Sent..................: %llu\r\n"
+               "Coalesced results.....: %llu\r\n"
+               "Credit waits..........: %llu\r\n"
+               "Overflow disconnects..: %llu\r\n"
+               "====================================\r\n",
+               sendStats.clients, sendStats.creditClients,
+               sendStats.queued, sendStats.maxDepth, sendStats.limit,
+               sendStats.outstanding, sendStats.window,
+               (unsigned long long)sendStats.sent,
+               (unsigned long long)sendStats.coalesced,
+               (unsigned long long)sendStats.creditWaits,
+               (unsigned long long)sendStats.overflows);
+  }
   sendToConsoleClient(self, str, true);
 }
 
@@ -1918,7 +2028,9 @@ static void doDumpPCache(SRXConsole* self, char* cmd, char* param)
   char* fileName = (ch == CON_STDOUT) ? "standard out" : param;
   // Get the number of elements from the command queue. Here is is for display
   // only, synchronizing is not necessary
-  elements = self->rpkiHandler->prefixCache->prefixTree->num_active_node;
+  PrefixCache* prefixCache = self->rpkiHandler->prefixCache;
+  elements =   prefixCache->prefixTree[PC_TREE_V4]->num_active_node
+             + prefixCache->prefixTree[PC_TREE_V6]->num_active_node;
   sprintf(str, "Prefix Cache has %u items. Start export into %s!\r\n",
           elements, fileName);
   sendToConsoleClient(self, str, true);
@@ -1934,7 +2046,9 @@ static void doDumpPCache(SRXConsole* self, char* cmd, char* param)
 
 /**
  * Dump the update cache into a file/console on the server side.
- * Use parameter '-' to dump it on the console of the server.
+ * Use parameter '-' to dump it on the console of the server. The parameters
+ * following the file name select the format (xml, json) and filter the
+ * updates (see parseUpdateExportFilter).
  *
  * @param self The console itself
  * @param cmd The dump command
@@ -1943,26 +2057,124 @@ static void doDumpPCache(SRXConsole* self, char* cmd, char* param)
 static void doDumpUCache(SRXConsole* self, char* cmd, char* param)
 {
   LOG(LEVEL_DEBUG, CP1 CP2 "%s %s", self->clientSockFd, cmd, param);
-  int elements = 0;
-  char str[256];
+  int             elements = 0;
+  char            str[MIN_CONSOLE_BUFFER];
+  char            params[MIN_CONSOLE_BUFFER];
+  char*           fileName = NULL;
+  char*           token;
+  char*           savePtr  = NULL;
+  UC_ExportFormat format   = UC_EXPORT_XML;
+  UC_ExportFilter filter;
+  uint32_t        noExported = 0;
+  int             fd;
+  bool            success;
   // produce a \0 terminated string
-  memset(str,'\0',256);
+  memset(str,'\0',MIN_CONSOLE_BUFFER);
+
+  initUpdateExportFilter(&filter);
+  snprintf(params, MIN_CONSOLE_BUFFER, "%s", param);
+  for (token = strtok_r(params, " \t", &savePtr); token != NULL;
+       token = strtok_r(NULL, " \t", &savePtr))
+  {
+    if (strcmp(token, "json") == 0)
+    {
+      format = UC_EXPORT_JSONL;
+    }
+    else if (strcmp(token, "xml") == 0)
+    {
+      format = UC_EXPORT_XML;
+    }
+    else if (strchr(token, '=') != NULL)
+    {
+      if (!parseUpdateExportFilter(&filter, token))
+      {
+        snprintf(str, MIN_CONSOLE_BUFFER, "Invalid filter '%s'!\r\n", token);
+        sendToConsoleClient(self, str, true);
+        return;
+      }
+    }
+    else if ((fileName == NULL) && (token[0] != CON_STDOUT))
+    {
+      fileName = token;
+    }
+  }
 
-  char ch = (strlen(param) == 0) ? CON_STDOUT : param[0];
-  char* fileName = (ch == CON_STDOUT) ? "standard out" : param;
   // Get the number of elements from the command queue. Here is is for display
   // only, synchronizing is not necessary
   elements = self->commandHandler->updCache->allItems.size;
-  sprintf(str, "Update Cache has %u items. Start export into %s!\r\n",
-          elements, fileName);
+  snprintf(str, MIN_CONSOLE_BUFFER, 
+           "Update Cache has %u items. Start export into %s!\r\n",
+           elements, fileName != NULL ? fileName : "standard out");
   sendToConsoleClient(self, str, true);
 
-  FILE* out = (ch == CON_STDOUT) ? stdout : NULL;
-  if (out != NULL)
+  if (fileName == NULL)
   {
-    outputUpdateCacheAsXML(self->commandHandler->updCache, stdout, -1);
+    fflush(stdout);
+    success = exportUpdateCache(self->commandHandler->updCache, STDOUT_FILENO,
+                                format, &filter, &noExported);
+  }
+  else
+  {
+    fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    success = (fd != -1)
+              && exportUpdateCache(self->commandHandler->updCache, fd, format,
+                                   &filter, &noExported);
+    if (fd != -1)
+    {
+      close(fd);
+    }
+  }
+
+  if (success)
+  {
+    snprintf(str, MIN_CONSOLE_BUFFER, 
+             "Export of %u updates into %s done.!\r\n", noExported,
+             fileName != NULL ? fileName : "standard out");
+  }
+  else
+  {
+    snprintf(str, MIN_CONSOLE_BUFFER, 
+             "Could not export the update cache into %s!\r\n", 
+             fileName != NULL ? fileName : "standard out");
+  }
+  sendToConsoleClient(self, str, true);
+}
+
+/**
+ * Drain the sampled update trace and append it to the given file or the
+ * configured trace file. The file is written on the server side.
+ *
+ * @param self The console itself
+ * @param cmd The dump command
+ * @param param The file name, optional
+ */
+static void doDumpTrace(SRXConsole* self, char* cmd, char* param)
+{
+  LOG(LEVEL_DEBUG, CP1 CP2 "%s %s", self->clientSockFd, cmd, param);
+  char     str[MIN_CONSOLE_BUFFER];
+  char*    fileName = (strlen(param) != 0) ? param 
+                                           : self->sysConfig->trace_file;
+  uint32_t noEvents = 0;
+
+  memset(str, '\0', MIN_CONSOLE_BUFFER);
+  if (self->sysConfig->trace_sample_rate == 0)
+  {
+    sprintf(str, "The trace is disabled, set trace.sample_rate!\r\n");
+  }
+  else if (fileName == NULL)
+  {
+    sprintf(str, "No trace file given and trace.file is not set!\r\n");
+  }
+  else if (dumpTrace(fileName, &noEvents))
+  {
+    snprintf(str, MIN_CONSOLE_BUFFER, "%u trace events appended to %s.\r\n",
+             noEvents, fileName);
+  }
+  else
+  {
+    snprintf(str, MIN_CONSOLE_BUFFER, "Could not write the trace into %s!\r\n",
+             fileName);
   }
-  sprintf(str, "Export of prefix cache into %s done.!\r\n", param);
   sendToConsoleClient(self, str, true);
 }
 
@@ -0,0 +1,806 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The crypto worker pool processes BGPsec jobs outside of the command handler
+ * thread.
+ *
+ * @version 0.6.3.0
+ */
+#include <malloc.h>
+#include <string.h>
+#include "server/crypto_worker.h"
+#include "server/metrics.h"
+#include "server/trace.h"
+#include "server/srx_packet_sender.h"
+#include "util/log.h"
+
+#define HDR "([0x%08X] Crypto Worker): "
+
+/** A batch of sign jobs processed by a worker. */
+typedef struct {
+  /** The sign jobs. */
+  CryptoJob* jobs;
+  /** The number of sign jobs. */
+  uint32_t   numJobs;
+} CW_SignBatch;
+
+/**
+ * Determine if the given sign batch contains a job of the given client.
+ *
+ * @param batch The sign batch.
+ * @param client The client.
+ *
+ * @return true if the batch contains a job of the client.
+ */
+static bool _cw_batchHasClient(CW_SignBatch* batch, ServerClient* client)
+{
+  uint32_t idx;
+
+  for (idx = 0; idx < batch->numJobs; idx++)
+  {
+    if (batch->jobs[idx].client == client)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Return the time in microseconds between the two given time stamps.
+ *
+ * @param start The start time
+ * @param end The end time
+ *
+ * @return the difference in microseconds.
+ */
+static uint64_t _cw_elapsedUs(struct timespec* start, struct timespec* end)
+{
+  int64_t usec = (int64_t)(end->tv_sec - start->tv_sec) * 1000000
+                 + (end->tv_nsec - start->tv_nsec) / 1000;
+  return usec > 0 ? (uint64_t)usec : 0;
+}
+
+/**
+ * Perform the BGPsec path validation of the given update and store the result
+ * in the update cache. Storing the result triggers the notification of all
+ * clients registered for this update.
+ *
+ * @param self The worker pool.
+ * @param updateID The update to be validated.
+ *
+ * @return true if the validation was performed, false if it was skipped.
+ */
+static bool _cw_validate(CryptoWorkerPool* self, SRxUpdateID* updateID)
+{
+  SRxResult        srxRes;
+  SRxDefaultResult defRes;
+  uint32_t         pathId = 0;
+
+  // The update might be deleted or validated already by an earlier job.
+  if (!getUpdateResult(self->updCache, updateID, 0, NULL, &srxRes, &defRes,
+                       &pathId))
+  {
+    LOG(LEVEL_DEBUG, HDR "Update [0x%08X] is not stored anymore, skip BGPsec "
+                     "validation!", pthread_self(), *updateID);
+    return false;
+  }
+  if (srxRes.bgpsecResult != SRx_RESULT_UNDEFINED)
+  {
+    return false;
+  }
+
+  UC_UpdateData* uData = getUpdateData(self->updCache, updateID);
+  if (uData == NULL)
+  {
+    RAISE_ERROR("Update Information for update [0x%08X] are not properly "
+                "stored in update cache!", *updateID);
+    return false;
+  }
+
+  SRxResult srxRes_mod;
+  srxRes_mod.roaResult        = SRx_RESULT_DONOTUSE;
+  srxRes_mod.aspaResult       = SRx_RESULT_DONOTUSE;
+  srxRes_mod.transitiveResult = SRx_RESULT_DONOTUSE;
+  uint64_t start              = metricsNow();
+  srxRes_mod.bgpsecResult     = validateSignature(self->bgpsecHandler, uData);
+  recordMetric(MET_STAGE_BGPSEC, MET_NO_CLIENT, start);
+  traceUpdate(*updateID, TRC_POINT_BGPSEC);
+
+  if (!modifyUpdateResult(self->updCache, updateID, &srxRes_mod, false))
+  {
+    RAISE_SYS_ERROR("A validation result for a non existing update [0x%08X]!",
+                    *updateID);
+  }
+
+  return true;
+}
+
+/**
+ * Perform the BGPsec path validation of the given update again, regardless of
+ * its current result. This is used once the keys of the update changed. The
+ * update cache only notifies the clients if the result changed.
+ *
+ * @param self The worker pool.
+ * @param updateID The update to be validated.
+ *
+ * @return true if the validation was performed, false if it was skipped.
+ */
+static bool _cw_revalidate(CryptoWorkerPool* self, SRxUpdateID* updateID)
+{
+  UC_UpdateData* uData = getUpdateData(self->updCache, updateID);
+  if (uData == NULL)
+  {
+    LOG(LEVEL_DEBUG, HDR "Update [0x%08X] is not stored anymore, skip BGPsec "
+                     "revalidation!", pthread_self(), *updateID);
+    return false;
+  }
+  if (uData->bgpsec_path == NULL)
+  {
+    LOG(LEVEL_ERROR, "Update 0x%08X is registered for BGPsec but the "
+                     "BGPsec_PATH attribute is not stored!", *updateID);
+    return false;
+  }
+
+  SRxResult srxRes_mod;
+  srxRes_mod.roaResult        = SRx_RESULT_DONOTUSE;
+  srxRes_mod.aspaResult       = SRx_RESULT_DONOTUSE;
+  srxRes_mod.transitiveResult = SRx_RESULT_DONOTUSE;
+  uint64_t start              = metricsNow();
+  srxRes_mod.bgpsecResult     = validateSignature(self->bgpsecHandler, uData);
+  recordMetric(MET_STAGE_BGPSEC, MET_NO_CLIENT, start);
+  traceUpdate(*updateID, TRC_POINT_BGPSEC);
+
+  if (!modifyUpdateResult(self->updCache, updateID, &srxRes_mod, false))
+  {
+    RAISE_SYS_ERROR("A validation result for a non existing update [0x%08X]!",
+                    *updateID);
+  }
+
+  return true;
+}
+
+/**
+ * Sign the updates of the given sign jobs with one call into the SRxCryptoAPI
+ * and send the signatures to the requesting clients. Clients whose request 
+ * could not be served receive an error. Jobs of dropped clients are skipped.
+ *
+ * @param self The worker pool.
+ * @param jobs The sign jobs.
+ * @param numJobs The number of sign jobs (max CW_SIGN_BATCH_SIZE).
+ *
+ * @return The number of signatures send.
+ */
+static int _cw_sign(CryptoWorkerPool* self, CryptoJob* jobs, int numJobs)
+{
+  BGPSecSignRequest requests[CW_SIGN_BATCH_SIZE];
+  CryptoJob*        reqJobs[CW_SIGN_BATCH_SIZE];
+  int               numReq = 0;
+  int               retVal = 0;
+  int               idx;
+
+  for (idx = 0; idx < numJobs; idx++)
+  {
+    if (jobs[idx].client == NULL)
+    {
+      LOG(LEVEL_DEBUG, HDR "Client of update [0x%08X] is gone, drop the sign "
+                       "request!", pthread_self(), jobs[idx].updateID);
+      continue;
+    }
+    UC_UpdateData* uData = getUpdateData(self->updCache, &jobs[idx].updateID);
+    if (uData == NULL)
+    {
+      LOG(LEVEL_INFO, HDR "Update [0x%08X] not found! Can not sign it!", 
+                      pthread_self(), jobs[idx].updateID);
+      sendError(SRXERR_UPDATE_NOT_FOUND, jobs[idx].svrSock, jobs[idx].client,
+                false);
+      continue;
+    }
+    memset(&requests[numReq], 0, sizeof(BGPSecSignRequest));
+    requests[numReq].update = uData;
+    requests[numReq].peerAS = jobs[idx].peerAS;
+    requests[numReq].pCount = jobs[idx].pCount;
+    requests[numReq].flags  = 0;
+    requests[numReq].algoID = jobs[idx].algoID;
+    reqJobs[numReq++] = &jobs[idx];
+  }
+
+  if (numReq > 0)
+  {
+    createSignature(self->bgpsecHandler, numReq, requests);
+  }
+
+  for (idx = 0; idx < numReq; idx++)
+  {
+    CryptoJob* job = reqJobs[idx];
+    if (requests[idx].segment != NULL)
+    {
+      if (sendSignatureNotification(job->svrSock, job->client, job->updateID,
+                                    requests[idx].length, 
+                                    requests[idx].segment, false))
+      {
+        retVal++;
+      }
+      free(requests[idx].segment);
+    }
+    else
+    {
+      LOG(LEVEL_NOTICE, HDR "Could not sign update [0x%08X] (status 0x%08X)!",
+                        pthread_self(), job->updateID, requests[idx].status);
+      sendError((requests[idx].status & API_STATUS_ERR_INVLID_KEY) != 0
+                ? SRXERR_ALGO_NOT_SUPPORTED : SRXERR_INTERNAL_ERROR,
+                job->svrSock, job->client, false);
+    }
+  }
+
+  lockMutex(&self->mutex);
+  if (numReq > 0)
+  {
+    self->signBatches++;
+  }
+  self->signatures += retVal;
+  self->signFailed += numJobs - retVal;
+  unlockMutex(&self->mutex);
+
+  return retVal;
+}
+
+/**
+ * Store a copy of the given job in the ring buffer. In case the maximum number
+ * of jobs in flight is reached the call blocks until a worker frees a slot.
+ *
+ * @param self The worker pool.
+ * @param tmpl The job to be queued, the queue time is set by this function.
+ *
+ * @return false if the pool is not running.
+ */
+static bool _cw_queueJob(CryptoWorkerPool* self, CryptoJob* tmpl)
+{
+  bool retVal = false;
+
+  lockMutex(&self->mutex);
+  if (self->running && (self->count + self->active) >= self->maxInFlight)
+  {
+    self->throttled++;
+    while (self->running && (self->count + self->active) >= self->maxInFlight)
+    {
+      waitCond(&self->slotCond, &self->mutex, 0);
+    }
+  }
+
+  if (self->running)
+  {
+    CryptoJob* job = &self->jobs[(self->head + self->count)
+                                 % self->maxInFlight];
+    memcpy(job, tmpl, sizeof(CryptoJob));
+    clock_gettime(CLOCK_MONOTONIC, &job->queued);
+
+    self->count++;
+    if (self->count > self->maxQueueDepth)
+    {
+      self->maxQueueDepth = self->count;
+    }
+    signalCond(&self->jobCond);
+    retVal = true;
+  }
+  unlockMutex(&self->mutex);
+
+  return retVal;
+}
+
+/**
+ * The worker thread loop. Waits for jobs and processes them until the pool
+ * is stopped.
+ *
+ * @param thisPool The worker pool.
+ *
+ * @return NULL
+ */
+static void* _cw_workerLoop(void* thisPool)
+{
+  CryptoWorkerPool* self = (CryptoWorkerPool*)thisPool;
+  CryptoJob        jobs[CW_SIGN_BATCH_SIZE];
+  CryptoJob*       prioJob;
+  CW_SignBatch     batch;
+  struct timespec  start;
+  struct timespec  end;
+  bool             performed;
+  bool             fromRing;
+  uint32_t         numJobs;
+  uint32_t         idx;
+
+  LOG(LEVEL_DEBUG, HDR "Crypto worker started", pthread_self());
+
+  lockMutex(&self->mutex);
+  while (self->running)
+  {
+    if (sizeOfSList(&self->prioJobs) > 0)
+    {
+      // Jobs of the priority lane go first
+      prioJob = (CryptoJob*)shiftFromSList(&self->prioJobs);
+      memcpy(&jobs[0], prioJob, sizeof(CryptoJob));
+      free(prioJob);
+      signalCond(&self->prioCond);
+      numJobs  = 1;
+      fromRing = false;
+    }
+    else if (self->count > 0)
+    {
+      // Take the next job out of the ring buffer, sign jobs are taken together
+      // with the sign jobs following them.
+      numJobs = 0;
+      do
+      {
+        memcpy(&jobs[numJobs++], &self->jobs[self->head], sizeof(CryptoJob));
+        self->head = (self->head + 1) % self->maxInFlight;
+        self->count--;
+      } while (   (jobs[0].type == CW_JOB_SIGN) && (self->count > 0)
+               && (numJobs < CW_SIGN_BATCH_SIZE)
+               && (self->jobs[self->head].type == CW_JOB_SIGN));
+      self->active += numJobs;
+      fromRing = true;
+      if (jobs[0].type == CW_JOB_SIGN)
+      {
+        // Clients of this batch are not closed until the batch is processed.
+        batch.jobs    = jobs;
+        batch.numJobs = numJobs;
+        appendDataToSList(&self->signInWork, &batch);
+      }
+    }
+    else
+    {
+      waitCond(&self->jobCond, &self->mutex, 0);
+      continue;
+    }
+    unlockMutex(&self->mutex);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    switch (jobs[0].type)
+    {
+      case CW_JOB_VALIDATE:
+        performed = _cw_validate(self, &jobs[0].updateID);
+        break;
+      case CW_JOB_REVALIDATE:
+        performed = _cw_revalidate(self, &jobs[0].updateID);
+        break;
+      case CW_JOB_SIGN:
+        // Each sign job is answered, either with a signature or an error.
+        _cw_sign(self, jobs, numJobs);
+        performed = true;
+        break;
+      default:
+        RAISE_ERROR("Unknown crypto job type [%u]!", jobs[0].type);
+        performed = false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    lockMutex(&self->mutex);
+    if (fromRing)
+    {
+      if (jobs[0].type == CW_JOB_SIGN)
+      {
+        deleteFromSList(&self->signInWork, &batch);
+        pthread_cond_broadcast(&self->signCond);
+      }
+      self->active -= numJobs;
+      // Slots became available.
+      pthread_cond_broadcast(&self->slotCond);
+    }
+    for (idx = 0; idx < numJobs; idx++)
+    {
+      if (performed)
+      {
+        uint64_t waitUs  = _cw_elapsedUs(&jobs[idx].queued, &start);
+        uint64_t totalUs = _cw_elapsedUs(&jobs[idx].queued, &end);
+        self->processed++;
+        self->sumWaitUs  += waitUs;
+        self->sumTotalUs += totalUs;
+        if (waitUs > self->maxWaitUs)
+        {
+          self->maxWaitUs = waitUs;
+        }
+        if (totalUs > self->maxTotalUs)
+        {
+          self->maxTotalUs = totalUs;
+        }
+      }
+      else
+      {
+        self->skipped++;
+      }
+    }
+  }
+  unlockMutex(&self->mutex);
+
+  LOG(LEVEL_DEBUG, HDR "Crypto worker stopped", pthread_self());
+  return NULL;
+}
+
+/**
+ * Create the crypto worker pool. The threads are not started yet.
+ *
+ * @param bgpsecHandler The BGPsec handler used for the crypto operations.
+ * @param updCache The update cache the results are stored in.
+ * @param numThreads The number of worker threads (1..CW_MAX_WORKER_THREADS)
+ * @param maxInFlight The maximum number of jobs that are queued or processed
+ *                    at the same time. Zero selects CW_DEF_MAX_INFLIGHT.
+ *
+ * @return The worker pool or NULL if it could not be created.
+ *
+ * @since 0.6.3.0
+ */
+CryptoWorkerPool* createCryptoWorkerPool(BGPSecHandler* bgpsecHandler,
+                                         UpdateCache* updCache,
+                                         uint32_t numThreads,
+                                         uint32_t maxInFlight)
+{
+  if (numThreads == 0 || numThreads > CW_MAX_WORKER_THREADS)
+  {
+    RAISE_ERROR("Invalid number of crypto worker threads [%u], allowed are "
+                "1..%u!", numThreads, CW_MAX_WORKER_THREADS);
+    return NULL;
+  }
+
+  CryptoWorkerPool* self = malloc(sizeof(CryptoWorkerPool));
+  if (self == NULL)
+  {
+    RAISE_SYS_ERROR("Not enough memory to create the crypto worker pool!");
+    return NULL;
+  }
+  memset(self, 0, sizeof(CryptoWorkerPool));
+
+  self->bgpsecHandler = bgpsecHandler;
+  self->updCache      = updCache;
+  self->numThreads    = numThreads;
+  self->maxInFlight   = maxInFlight > 0 ? maxInFlight : CW_DEF_MAX_INFLIGHT;
+  self->jobs          = malloc(sizeof(CryptoJob) * self->maxInFlight);
+
+  if (self->jobs == NULL)
+  {
+    RAISE_SYS_ERROR("Not enough memory to create the crypto job queue!");
+    free(self);
+    return NULL;
+  }
+
+  if (!initMutex(&self->mutex))
+  {
+    free(self->jobs);
+    free(self);
+    return NULL;
+  }
+  initCond(&self->jobCond);
+  initCond(&self->slotCond);
+  initCond(&self->prioCond);
+  initCond(&self->signCond);
+  initSList(&self->prioJobs);
+  initSList(&self->signInWork);
+
+  return self;
+}
+
+/**
+ * Stop the workers if still running and free all memory of the pool.
+ *
+ * @param self The worker pool.
+ *
+ * @since 0.6.3.0
+ */
+void releaseCryptoWorkerPool(CryptoWorkerPool* self)
+{
+  if (self != NULL)
+  {
+    stopCryptoWorkers(self);
+    destroyCond(&self->jobCond);
+    destroyCond(&self->slotCond);
+    destroyCond(&self->prioCond);
+    destroyCond(&self->signCond);
+    releaseSList(&self->prioJobs);
+    releaseSList(&self->signInWork);
+    releaseMutex(&self->mutex);
+    free(self->jobs);
+    free(self);
+  }
+}
+
+/**
+ * Start the worker threads.
+ *
+ * @param self The worker pool.
+ *
+ * @return true if at least one worker thread is running.
+ *
+ * @since 0.6.3.0
+ */
+bool startCryptoWorkers(CryptoWorkerPool* self)
+{
+  uint32_t idx;
+
+  lockMutex(&self->mutex);
+  if (self->running)
+  {
+    unlockMutex(&self->mutex);
+    return true;
+  }
+  self->running = true;
+  unlockMutex(&self->mutex);
+
+  for (idx = 0; idx < self->numThreads; idx++)
+  {
+    if (pthread_create(&self->threads[idx], NULL, _cw_workerLoop, self) != 0)
+    {
+      RAISE_ERROR("Failed to create crypto worker thread No %u - continuing "
+                  "with %u threads", idx, self->runningThreads);
+      break;
+    }
+    self->runningThreads++;
+  }
+
+  if (self->runningThreads == 0)
+  {
+    self->running = false;
+    return false;
+  }
+
+  LOG(LEVEL_INFO, "- %u crypto worker(s) started (max in flight: %u)",
+                  self->runningThreads, self->maxInFlight);
+  return true;
+}
+
+/**
+ * Stop all worker threads. Jobs still waiting in the queue are dropped.
+ *
+ * @param self The worker pool.
+ *
+ * @since 0.6.3.0
+ */
+void stopCryptoWorkers(CryptoWorkerPool* self)
+{
+  uint32_t idx;
+
+  lockMutex(&self->mutex);
+  if (!self->running)
+  {
+    unlockMutex(&self->mutex);
+    return;
+  }
+  self->running = false;
+  self->count   = 0;
+  emptySList(&self->prioJobs);
+  pthread_cond_broadcast(&self->jobCond);
+  pthread_cond_broadcast(&self->slotCond);
+  pthread_cond_broadcast(&self->prioCond);
+  unlockMutex(&self->mutex);
+
+  for (idx = 0; idx < self->runningThreads; idx++)
+  {
+    pthread_join(self->threads[idx], NULL);
+  }
+  self->runningThreads = 0;
+}
+
+/**
+ * Queue a job for the crypto workers. In case the maximum number of jobs in
+ * flight is reached the call blocks until a worker frees a slot.
+ *
+ * @param self The worker pool.
+ * @param type The type of job.
+ * @param updateID The update the job is for.
+ *
+ * @return false if the pool is not running.
+ *
+ * @since 0.6.3.0
+ */
+bool queueCryptoJob(CryptoWorkerPool* self, CryptoJobType type,
+                    SRxUpdateID* updateID)
+{
+  CryptoJob job;
+
+  memset(&job, 0, sizeof(CryptoJob));
+  job.type     = type;
+  job.updateID = *updateID;
+
+  return _cw_queueJob(self, &job);
+}
+
+/**
+ * Queue a sign job for the crypto workers. In case the maximum number of jobs
+ * in flight is reached the call blocks until a worker frees a slot. The 
+ * signature or an error is send to the client once the job is processed.
+ *
+ * @param self The worker pool.
+ * @param svrSock The server socket the signature is send over.
+ * @param client The client that requested the signature.
+ * @param updateID The update to be signed.
+ * @param peerAS The AS the update will be send to (host format).
+ * @param pCount The prepend counter of the own AS.
+ * @param algoID The algorithm suite identifier.
+ *
+ * @return false if the pool is not running.
+ *
+ * @since 0.6.3.0
+ */
+bool queueCryptoSignJob(CryptoWorkerPool* self, ServerSocket* svrSock,
+                        ServerClient* client, SRxUpdateID* updateID,
+                        uint32_t peerAS, uint8_t pCount, uint8_t algoID)
+{
+  CryptoJob job;
+
+  memset(&job, 0, sizeof(CryptoJob));
+  job.type     = CW_JOB_SIGN;
+  job.updateID = *updateID;
+  job.svrSock  = svrSock;
+  job.client   = client;
+  job.peerAS   = peerAS;
+  job.pCount   = pCount;
+  job.algoID   = algoID;
+
+  return _cw_queueJob(self, &job);
+}
+
+/**
+ * Drop all sign jobs of the given client. Queued sign jobs are not answered
+ * anymore, in case a worker currently signs updates for this client the call 
+ * blocks until the signatures are send. This function MUST be called before
+ * the client connection is closed.
+ *
+ * @param self The worker pool.
+ * @param client The client that is about to be closed.
+ *
+ * @since 0.6.3.0
+ */
+void dropClientCryptoJobs(CryptoWorkerPool* self, ServerClient* client)
+{
+  SListNode*    node;
+  CW_SignBatch* batch;
+  bool          inWork;
+  uint32_t      idx;
+
+  if ((self == NULL) || (client == NULL))
+  {
+    return;
+  }
+
+  lockMutex(&self->mutex);
+  for (idx = 0; idx < self->count; idx++)
+  {
+    CryptoJob* job = &self->jobs[(self->head + idx) % self->maxInFlight];
+    if ((job->type == CW_JOB_SIGN) && (job->client == client))
+    {
+      job->svrSock = NULL;
+      job->client  = NULL;
+    }
+  }
+
+  do
+  {
+    inWork = false;
+    FOREACH_SLIST(&self->signInWork, node)
+    {
+      batch = (CW_SignBatch*)getDataOfSListNode(node);
+      if (_cw_batchHasClient(batch, client))
+      {
+        inWork = true;
+        break;
+      }
+    }
+    if (inWork)
+    {
+      waitCond(&self->signCond, &self->mutex, 0);
+    }
+  } while (inWork);
+  unlockMutex(&self->mutex);
+}
+
+/**
+ * Queue a job in the priority lane of the crypto workers. Jobs in this lane 
+ * are processed before all other jobs, e.g. the revalidations triggered by
+ * the RPKI handler. The lane holds up to maxInFlight jobs, if it is full the
+ * call blocks until a worker took a job out of the lane.
+ *
+ * @param self The worker pool.
+ * @param type The type of job.
+ * @param updateID The update the job is for.
+ *
+ * @return false if the pool is not running or the job could not be stored.
+ *
+ * @since 0.6.3.0
+ */
+bool queuePriorityCryptoJob(CryptoWorkerPool* self, CryptoJobType type,
+                            SRxUpdateID* updateID)
+{
+  bool retVal = false;
+
+  lockMutex(&self->mutex);
+  if (self->running && (uint32_t)sizeOfSList(&self->prioJobs) 
+                       >= self->maxInFlight)
+  {
+    self->prioThrottled++;
+    while (self->running && (uint32_t)sizeOfSList(&self->prioJobs) 
+                            >= self->maxInFlight)
+    {
+      waitCond(&self->prioCond, &self->mutex, 0);
+    }
+  }
+
+  if (self->running)
+  {
+    CryptoJob* job = (CryptoJob*)appendToSList(&self->prioJobs, 
+                                               sizeof(CryptoJob));
+    if (job != NULL)
+    {
+      job->type     = type;
+      job->updateID = *updateID;
+      clock_gettime(CLOCK_MONOTONIC, &job->queued);
+
+      if ((uint32_t)sizeOfSList(&self->prioJobs) > self->maxPrioDepth)
+      {
+        self->maxPrioDepth = sizeOfSList(&self->prioJobs);
+      }
+      signalCond(&self->jobCond);
+      retVal = true;
+    }
+  }
+  unlockMutex(&self->mutex);
+
+  return retVal;
+}
+
+/**
+ * Fill the given statistics structure with the current values of the pool.
+ *
+ * @param self The worker pool.
+ * @param stats The statistics structure to be filled.
+ *
+ * @since 0.6.3.0
+ */
+void getCryptoWorkerStats(CryptoWorkerPool* self, CryptoWorkerStats* stats)
+{
+  memset(stats, 0, sizeof(CryptoWorkerStats));
+  if (self == NULL)
+  {
+    return;
+  }
+
+  lockMutex(&self->mutex);
+  stats->workers       = self->runningThreads;
+  stats->maxInFlight   = self->maxInFlight;
+  stats->queueDepth    = self->count;
+  stats->maxQueueDepth = self->maxQueueDepth;
+  stats->prioDepth     = sizeOfSList(&self->prioJobs);
+  stats->maxPrioDepth  = self->maxPrioDepth;
+  stats->prioThrottled = self->prioThrottled;
+  stats->active        = self->active;
+  stats->processed     = self->processed;
+  stats->skipped       = self->skipped;
+  stats->throttled     = self->throttled;
+  stats->signatures    = self->signatures;
+  stats->signFailed    = self->signFailed;
+  stats->signBatches   = self->signBatches;
+  stats->maxWaitUs     = self->maxWaitUs;
+  stats->maxTotalUs    = self->maxTotalUs;
+  if (self->processed > 0)
+  {
+    stats->avgWaitUs  = self->sumWaitUs  / self->processed;
+    stats->avgTotalUs = self->sumTotalUs / self->processed;
+  }
+  unlockMutex(&self->mutex);
+}
@@ -0,0 +1,318 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The crypto worker pool moves the expensive BGPsec path validation out of
+ * the command handler thread. The command handler stores and broadcasts the
+ * origin and ASPA results right away and hands the BGPsec part of the update
+ * to this pool. Once a worker finished the validation the result is stored in
+ * the update cache which triggers the follow up notification to all clients.
+ *
+ * Revalidations triggered by RPKI router key changes are queued in a separate
+ * priority lane which is processed first. This keeps the cryptography out of
+ * the RPKI receive thread. The lane holds up to maxInFlight jobs, if it is
+ * full the caller waits until a worker took a job out of the lane.
+ *
+ * Sign requests of the routers are queued in the ring buffer as well. A worker
+ * that picks up a sign job takes all sign jobs following it (up to
+ * CW_SIGN_BATCH_SIZE) and hands them to the SRxCryptoAPI in one call. The 
+ * signatures are send back to the routers by the worker.
+ *
+ * @version 0.6.3.0
+ */
+#ifndef __CRYPTO_WORKER_H__
+#define __CRYPTO_WORKER_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "server/bgpsec_handler.h"
+#include "server/update_cache.h"
+#include "shared/srx_defs.h"
+#include "util/mutex.h"
+#include "util/server_socket.h"
+#include "util/slist.h"
+
+/** The maximum number of worker threads the pool accepts. */
+#define CW_MAX_WORKER_THREADS   64
+/** The default number of worker threads. */
+#define CW_DEF_WORKER_THREADS   2
+/** The default number of jobs that can be queued or processed at once. */
+#define CW_DEF_MAX_INFLIGHT     4096
+/** The maximum number of sign jobs handed to the SRxCryptoAPI at once. */
+#define CW_SIGN_BATCH_SIZE      16
+
+/** The type of jobs processed by the crypto workers. */
+typedef enum {
+  /** Perform BGPsec path validation of an update stored in the update cache */
+  CW_JOB_VALIDATE = 0,
+  /** Perform BGPsec path validation again, i.e. due to a key change. */
+  CW_JOB_REVALIDATE = 1,
+  /** Sign an update stored in the update cache and send the signature. */
+  CW_JOB_SIGN = 2
+} CryptoJobType;
+
+/** A single job in the crypto worker queue. */
+typedef struct {
+  /** The type of the job. */
+  CryptoJobType   type;
+  /** The update the job is performed for. */
+  SRxUpdateID     updateID;
+  /** The time the job was queued (CLOCK_MONOTONIC). */
+  struct timespec queued;
+  /** CW_JOB_SIGN: The server socket the signature is send over. */
+  ServerSocket*   svrSock;
+  /** CW_JOB_SIGN: The client that requested the signature, NULL in case the
+   * client was dropped while the job was queued. */
+  ServerClient*   client;
+  /** CW_JOB_SIGN: The AS the update will be send to (host format). */
+  uint32_t        peerAS;
+  /** CW_JOB_SIGN: The prepend counter of the own AS. */
+  uint8_t         pCount;
+  /** CW_JOB_SIGN: The algorithm suite identifier. */
+  uint8_t         algoID;
+} CryptoJob;
+
+/** Snapshot of the crypto worker statistics. */
+typedef struct {
+  /** Number of worker threads running. */
+  uint32_t workers;
+  /** The configured maximum number of jobs in flight. */
+  uint32_t maxInFlight;
+  /** Number of jobs waiting in the queue. */
+  uint32_t queueDepth;
+  /** Highest queue depth seen so far. */
+  uint32_t maxQueueDepth;
+  /** Number of jobs waiting in the priority lane. */
+  uint32_t prioDepth;
+  /** Highest priority lane depth seen so far. */
+  uint32_t maxPrioDepth;
+  /** Number of times the producer had to wait for the priority lane. */
+  uint64_t prioThrottled;
+  /** Number of jobs currently processed by the workers. */
+  uint32_t active;
+  /** Total number of jobs processed. */
+  uint64_t processed;
+  /** Number of jobs that were skipped because the result was already known
+   * or the update was removed in the meantime. */
+  uint64_t skipped;
+  /** Number of times the producer had to wait for a free slot. */
+  uint64_t throttled;
+  /** Number of signatures created and send. */
+  uint64_t signatures;
+  /** Number of sign requests that could not be served. */
+  uint64_t signFailed;
+  /** Number of calls to the SRxCryptoAPI sign function. */
+  uint64_t signBatches;
+  /** Average time in microseconds a job waited in the queue. */
+  uint64_t avgWaitUs;
+  /** Maximum time in microseconds a job waited in the queue. */
+  uint64_t maxWaitUs;
+  /** Average time in microseconds from queuing until the result was stored. */
+  uint64_t avgTotalUs;
+  /** Maximum time in microseconds from queuing until the result was stored. */
+  uint64_t maxTotalUs;
+} CryptoWorkerStats;
+
+/** The crypto worker pool. */
+typedef struct {
+  /** The BGPsec handler used for the crypto operations. */
+  BGPSecHandler*  bgpsecHandler;
+  /** The update cache the results are written into. */
+  UpdateCache*    updCache;
+
+  /** Ring buffer of maxInFlight jobs. */
+  CryptoJob*      jobs;
+  /** Position of the next job to be processed. */
+  uint32_t        head;
+  /** Number of jobs waiting in the ring buffer. */
+  uint32_t        count;
+  /** Number of jobs currently processed. */
+  uint32_t        active;
+  /** Maximum number of queued and active jobs. */
+  uint32_t        maxInFlight;
+  /** Priority lane, processed before the ring buffer. Holds up to 
+   * maxInFlight jobs. */
+  SList           prioJobs;
+
+  /** Protects the queue and the statistics. */
+  Mutex           mutex;
+  /** Signals the workers that jobs are available. */
+  Cond            jobCond;
+  /** Signals the producer that a slot became available. */
+  Cond            slotCond;
+  /** Signals the producer that a job left the priority lane. */
+  Cond            prioCond;
+  /** The sign batches currently processed by the workers. */
+  SList           signInWork;
+  /** Signals that a sign batch was processed. */
+  Cond            signCond;
+
+  /** The worker threads. */
+  pthread_t       threads[CW_MAX_WORKER_THREADS];
+  /** Number of worker threads requested. */
+  uint32_t        numThreads;
+  /** Number of worker threads started. */
+  uint32_t        runningThreads;
+  /** Indicates if the workers keep running. */
+  bool            running;
+
+  // Statistics
+  uint32_t        maxQueueDepth;
+  uint32_t        maxPrioDepth;
+  uint64_t        prioThrottled;
+  uint64_t        processed;
+  uint64_t        skipped;
+  uint64_t        throttled;
+  uint64_t        signatures;
+  uint64_t        signFailed;
+  uint64_t        signBatches;
+  uint64_t        sumWaitUs;
+  uint64_t        maxWaitUs;
+  uint64_t        sumTotalUs;
+  uint64_t        maxTotalUs;
+} CryptoWorkerPool;
+
+/**
+ * Create the crypto worker pool. The threads are not started yet.
+ *
+ * @param bgpsecHandler The BGPsec handler used for the crypto operations.
+ * @param updCache The update cache the results are stored in.
+ * @param numThreads The number of worker threads (1..CW_MAX_WORKER_THREADS)
+ * @param maxInFlight The maximum number of jobs that are queued or processed
+ *                    at the same time. Zero selects CW_DEF_MAX_INFLIGHT.
+ *
+ * @return The worker pool or NULL if it could not be created.
+ *
+ * @since 0.6.3.0
+ */
+CryptoWorkerPool* createCryptoWorkerPool(BGPSecHandler* bgpsecHandler,
+                                         UpdateCache* updCache,
+                                         uint32_t numThreads,
+                                         uint32_t maxInFlight);
+
+/**
+ * Stop the workers if still running and free all memory of the pool.
+ *
+ * @param self The worker pool.
+ *
+ * @since 0.6.3.0
+ */
+void releaseCryptoWorkerPool(CryptoWorkerPool* self);
+
+/**
+ * Start the worker threads.
+ *
+ * @param self The worker pool.
+ *
+ * @return true if at least one worker thread is running.
+ *
+ * @since 0.6.3.0
+ */
+bool startCryptoWorkers(CryptoWorkerPool* self);
+
+/**
+ * Stop all worker threads. Jobs still waiting in the queue are dropped.
+ *
+ * @param self The worker pool.
+ *
+ * @since 0.6.3.0
+ */
+void stopCryptoWorkers(CryptoWorkerPool* self);
+
+/**
+ * Queue a job for the crypto workers. In case the maximum number of jobs in
+ * flight is reached the call blocks until a worker frees a slot.
+ *
+ * @param self The worker pool.
+ * @param type The type of job.
+ * @param updateID The update the job is for.
+ *
+ * @return false if the pool is not running.
+ *
+ * @since 0.6.3.0
+ */
+bool queueCryptoJob(CryptoWorkerPool* self, CryptoJobType type,
+                    SRxUpdateID* updateID);
+
+/**
+ * Queue a sign job for the crypto workers. In case the maximum number of jobs
+ * in flight is reached the call blocks until a worker frees a slot. The 
+ * signature or an error is send to the client once the job is processed.
+ *
+ * @param self The worker pool.
+ * @param svrSock The server socket the signature is send over.
+ * @param client The client that requested the signature.
+ * @param updateID The update to be signed.
+ * @param peerAS The AS the update will be send to (host format).
+ * @param pCount The prepend counter of the own AS.
+ * @param algoID The algorithm suite identifier.
+ *
+ * @return false if the pool is not running.
+ *
+ * @since 0.6.3.0
+ */
+bool queueCryptoSignJob(CryptoWorkerPool* self, ServerSocket* svrSock,
+                        ServerClient* client, SRxUpdateID* updateID,
+                        uint32_t peerAS, uint8_t pCount, uint8_t algoID);
+
+/**
+ * Drop all sign jobs of the given client. Queued sign jobs are not answered
+ * anymore, in case a worker currently signs updates for this client the call 
+ * blocks until the signatures are send. This function MUST be called before
+ * the client connection is closed.
+ *
+ * @param self The worker pool.
+ * @param client The client that is about to be closed.
+ *
+ * @since 0.6.3.0
+ */
+void dropClientCryptoJobs(CryptoWorkerPool* self, ServerClient* client);
+
+/**
+ * Queue a job in the priority lane of the crypto workers. Jobs in this lane 
+ * are processed before all other jobs, e.g. the revalidations triggered by
+ * the RPKI handler. The lane holds up to maxInFlight jobs, if it is full the
+ * call blocks until a worker took a job out of the lane.
+ *
+ * @param self The worker pool.
+ * @param type The type of job.
+ * @param updateID The update the job is for.
+ *
+ * @return false if the pool is not running or the job could not be stored.
+ *
+ * @since 0.6.3.0
+ */
+bool queuePriorityCryptoJob(CryptoWorkerPool* self, CryptoJobType type,
+                            SRxUpdateID* updateID);
+
+/**
+ * Fill the given statistics structure with the current values of the pool.
+ *
+ * @param self The worker pool.
+ * @param stats The statistics structure to be filled.
+ *
+ * @since 0.6.3.0
+ */
+void getCryptoWorkerStats(CryptoWorkerPool* self, CryptoWorkerStats* stats);
+
+#endif // !__CRYPTO_WORKER_H__
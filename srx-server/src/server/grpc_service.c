@@ -708,6 +708,7 @@ RET_DATA responseGRPC (int size, unsigned char* data, unsigned int grpcClientID)
         cthread = (ClientThread*)grpcServiceHandler.svrConnHandler->proxyMap[clientID].socket;
         // in order to skip over terminating a client pthread which was not generated if grpc enabled
         cthread->active  = false;
+        dropClientCryptoJobs(grpcServiceHandler.cmdHandler->cryptoPool, cthread);
         closeClientConnection(&grpcServiceHandler.cmdHandler->svrConnHandler->svrSock, cthread);
 
         //clientID = ((ClientThread*)item->client)->routerID;
@@ -743,6 +744,7 @@ RET_DATA responseGRPC (int size, unsigned char* data, unsigned int grpcClientID)
           grpcClientID,  clientID, grpcServiceHandler.svrConnHandler->proxyMap[clientID].socket);
         cthread = (ClientThread*)grpcServiceHandler.svrConnHandler->proxyMap[clientID].socket;
         cthread->active  = false;
+        dropClientCryptoJobs(grpcServiceHandler.cmdHandler->cryptoPool, cthread);
         closeClientConnection(&grpcServiceHandler.cmdHandler->svrConnHandler->svrSock, cthread);
         deactivateConnectionMapping(grpcServiceHandler.svrConnHandler, clientID, false, 0);
         deleteFromSList(&grpcServiceHandler.cmdHandler->svrConnHandler->clients, cthread);
@@ -88,6 +88,10 @@
  */
 #include <stdio.h>
 #include <signal.h>
+#include <semaphore.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
 #include "server/bgpsec_handler.h"
 #include "server/command_handler.h"
 #include "server/command_queue.h"
@@ -105,6 +109,9 @@
 #include "server/update_cache.h"
 #include "server/aspath_cache.h"
 #include "server/aspa_trie.h"
+#include "server/snapshot.h"
+#include "server/metrics.h"
+#include "server/trace.h"
 #include "util/directory.h"
 #include "util/log.h"
 #ifdef USE_GRPC
@@ -180,6 +187,26 @@ static ServerConnectionHandler  svrConnHandler;
 
 static bool cleanupRequired = false;
 
+/** The snapshot the state is restored from. It stays mapped until the server
+ * shuts down.
+ * @since 0.6.3.0 */
+static SnapshotReader snapshot;
+/** The thread that writes the snapshot periodically.
+ * @since 0.6.3.0 */
+static pthread_t      snapshotThread;
+static bool           snapshotThreadStarted = false;
+static volatile bool  snapshotThreadStop    = false;
+/** The thread that exports the update cache on SIGUSR1. The signal handler
+ * only posts the semaphore.
+ * @since 0.6.3.0 */
+static pthread_t      exportThread;
+static bool           exportThreadStarted = false;
+static volatile bool  exportThreadStop    = false;
+static sem_t          exportRequest;
+/** The time the server was started.
+ * @since 0.6.3.0 */
+static struct timespec startTime;
+
 
 // To allow to use it already ;-)
 static void doCleanupHandlers(int handler);
@@ -347,10 +374,26 @@ static bool setupHandlers()
 {
   uint8_t handlers = 0;
   bool retVal = true;
+  int  idx;
+
+  SnapshotReader* restore = NULL;
+
+  memset(&snapshot, 0, sizeof(SnapshotReader));
+  if (config.snapshot_file != NULL)
+  {
+    if (openSnapshotReader(&snapshot, config.snapshot_file))
+    {
+      restore = &snapshot;
+    }
+    else
+    {
+      LOG(LEVEL_NOTICE, "No snapshot restored from '%s', perform a cold "
+                        "start!", config.snapshot_file);
+    }
+  }
 
   if (!createRPKIHandler (&rpkiHandler, &prefixCache, &aspathCache, &aspaDBManager,
-                          config.rpki_host, config.rpki_port, 
-                          config.rpki_router_protocol))
+                          &config, restore))
   {
     RAISE_ERROR("Failed to create RPKI Handler.");
   }
@@ -364,6 +407,16 @@ static bool setupHandlers()
     else
     {
       handlers |= SETUP_BGPSEC_HANDLER;
+      for (idx = 0; idx < config.bgpsec_num_sign_keys; idx++)
+      {
+        if (!loadPrivateKey(&bgpsecHandler, config.bgpsec_sign_keys[idx].asn,
+                            config.bgpsec_sign_keys[idx].algoID,
+                            config.bgpsec_sign_keys[idx].ski))
+        {
+          LOG(LEVEL_WARNING, "Signing for AS %u is not available!",
+                             config.bgpsec_sign_keys[idx].asn);
+        }
+      }
       if (!createServerConnectionHandler (&svrConnHandler, &updCache, &aspathCache, &config, &skiCache))
       {
         RAISE_ERROR("Failed to create Server Connection Handler.");
@@ -391,6 +444,7 @@ static bool setupHandlers()
   else
   {
     doCleanupHandlers(handlers);
+    closeSnapshotReader(&snapshot);
     retVal = false;
   }
 
@@ -409,7 +463,7 @@ static bool setupQueues()
   if (!config.mode_no_sendqueue)
   {
     cont = false;
-    if (createSendQueue())
+    if (createSendQueue(config.flow_send_queue, config.flow_window))
     {
       if (startSendQueue())
       {
@@ -456,6 +510,12 @@ static void signalReceived(int _sig)
   // result back
   stopProcessingCommands(&cmdHandler);
 
+  // Stop sending before the clients are disconnected.
+  if (!config.mode_no_sendqueue)
+  {
+    stopSendQueue();
+  }
+
   // Disconnect all clients
   stopProcessingRequests(&svrConnHandler);
 
@@ -465,6 +525,139 @@ static void signalReceived(int _sig)
   releaseSendQueue();
 }
 
+/**
+ * Write the state of the server into the configured snapshot.
+ *
+ * @return true if the snapshot was written.
+ *
+ * @since 0.6.3.0
+ */
+static bool writeSnapshot()
+{
+  SnapshotWriter writer;
+  bool retVal = false;
+
+  if (openSnapshotWriter(&writer, config.snapshot_file))
+  {
+    retVal = closeSnapshotWriter(&writer, 
+                                 writeRPKIHandlerSnapshot(&rpkiHandler, 
+                                                          &writer));
+  }
+  if (!retVal)
+  {
+    LOG(LEVEL_WARNING, "Could not write the snapshot '%s'!", 
+                       config.snapshot_file);
+  }
+
+  return retVal;
+}
+
+/**
+ * The thread that writes the snapshot every snapshot_interval seconds.
+ *
+ * @param arg not used.
+ *
+ * @return NULL
+ *
+ * @since 0.6.3.0
+ */
+static void* snapshotLoop(void* arg)
+{
+  uint32_t elapsed = 0;
+
+  LOG(LEVEL_DEBUG, HDR "Snapshot thread started", pthread_self());
+  while (!snapshotThreadStop)
+  {
+    sleep(1);
+    if (++elapsed >= config.snapshot_interval && !snapshotThreadStop)
+    {
+      writeSnapshot();
+      elapsed = 0;
+    }
+  }
+  LOG(LEVEL_DEBUG, HDR "Snapshot thread stopped", pthread_self());
+
+  pthread_exit(0);
+}
+
+/**
+ * Request the export of the update cache (SIGUSR1).
+ *
+ * @param _sig The signal received.
+ *
+ * @since 0.6.3.0
+ */
+static void exportSignalReceived(int _sig)
+{
+  sem_post(&exportRequest);
+}
+
+/**
+ * Export the update cache into the configured export file. The export is 
+ * written into a temporary file which replaces the export file once it is
+ * complete.
+ *
+ * @return true if the export was written.
+ *
+ * @since 0.6.3.0
+ */
+static bool writeUpdateExport()
+{
+  char     tmpFile[strlen(config.export_file) + 5];
+  uint32_t noExported = 0;
+  bool     retVal     = false;
+  int      fd;
+
+  sprintf(tmpFile, "%s.tmp", config.export_file);
+  fd = open(tmpFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd != -1)
+  {
+    retVal = exportUpdateCache(&updCache, fd, config.export_json 
+                                              ? UC_EXPORT_JSONL 
+                                              : UC_EXPORT_XML,
+                               NULL, &noExported);
+    retVal = (close(fd) == 0) && retVal
+             && (rename(tmpFile, config.export_file) == 0);
+  }
+  if (retVal)
+  {
+    LOG(LEVEL_INFO, "%u updates exported into %s", noExported,
+                    config.export_file);
+  }
+  else
+  {
+    LOG(LEVEL_WARNING, "Could not export the update cache into '%s'!",
+                       config.export_file);
+    unlink(tmpFile);
+  }
+
+  return retVal;
+}
+
+/**
+ * The thread that exports the update cache each time SIGUSR1 is received.
+ *
+ * @param arg not used.
+ *
+ * @return NULL
+ *
+ * @since 0.6.3.0
+ */
+static void* exportLoop(void* arg)
+{
+  LOG(LEVEL_DEBUG, HDR "Export thread started", pthread_self());
+  while (!exportThreadStop)
+  {
+    if ((sem_wait(&exportRequest) == 0) && !exportThreadStop)
+    {
+      writeUpdateExport();
+    }
+  }
+  LOG(LEVEL_DEBUG, HDR "Export thread stopped", pthread_self());
+
+  pthread_exit(0);
+}
+
 /**
  * The main server thread loop.
  * @see startProcessingCommands, startProcessingRequests
@@ -552,6 +745,9 @@ static void doCleanupCaches(int cache)
  */
 static void doCleanup()
 {
+  // Stop serving the metrics.
+  releaseMetrics();
+
   // First disconnects the server console.
   // BZ1006: disconnects the server console - Only if this is not the console 
   //         itself.
@@ -564,8 +760,44 @@ static void doCleanup()
   releaseCommandQueue(&cmdQueue);
   releaseSendQueue();
 
+  // Snapshot - Written before the handlers are released.
+  if (snapshotThreadStarted)
+  {
+    snapshotThreadStop = true;
+    pthread_join(snapshotThread, NULL);
+    snapshotThreadStarted = false;
+  }
+  if (config.snapshot_file != NULL)
+  {
+    writeSnapshot();
+  }
+
+  // Export - Stopped before the update cache is released.
+  if (exportThreadStarted)
+  {
+    signal(SIGUSR1, SIG_IGN);
+    exportThreadStop = true;
+    sem_post(&exportRequest);
+    pthread_join(exportThread, NULL);
+    sem_destroy(&exportRequest);
+    exportThreadStarted = false;
+  }
+
   // Handlers
   doCleanupHandlers(SETUP_ALL_HANDLERS);
+  closeSnapshotReader(&snapshot);
+
+  // Trace - Drained once the handlers do not write events anymore.
+  if ((config.trace_file != NULL) && (config.trace_sample_rate != 0))
+  {
+    uint32_t noEvents = 0;
+    if (dumpTrace(config.trace_file, &noEvents))
+    {
+      LOG(LEVEL_INFO, "%u trace events appended to %s", noEvents, 
+                      config.trace_file);
+    }
+  }
+  releaseTrace();
 
   // Caches
   doCleanupCaches(SETUP_ALL_CACHES);
@@ -599,6 +831,12 @@ void shutDown()
   // result back
   stopProcessingCommands(&cmdHandler);
 
+  // Stop sending before the clients are disconnected.
+  if (!config.mode_no_sendqueue)
+  {
+    stopSendQueue();
+  }
+
   // Disconnect all clients
   stopProcessingRequests(&svrConnHandler);
 
@@ -659,6 +897,48 @@ BGPSecHandler* getBGPsecHandler()
   return &bgpsecHandler;
 }
 
+/**
+ * Return the crypto worker pool of the command handler.
+ * 
+ * @return the crypto worker pool or NULL if BGPsec validation is performed 
+ *         synchronously.
+ * 
+ * @since 0.6.3.0
+ */
+CryptoWorkerPool* getCryptoWorkerPool()
+{
+  return cmdHandler.cryptoPool;
+}
+
+/**
+ * Queue the BGPsec revalidation of the given update in the command queue. 
+ * This is used if the crypto workers cannot take the revalidation, the
+ * validation is never performed by the calling thread.
+ * 
+ * @param updateID The update to be validated again.
+ * 
+ * @return false if the command queue does not accept commands anymore.
+ * 
+ * @since 0.6.3.0
+ */
+bool queueBGPsecRevalidation(SRxUpdateID* updateID)
+{
+  return queueCommand(&cmdQueue, COMMAND_TYPE_REVALIDATE, NULL, NULL, 
+                      *updateID, 0, NULL);
+}
+
+/**
+ * Return the AS path cache.
+ * 
+ * @return the AS path cache
+ * 
+ * @since 0.6.3.0
+ */
+AspathCache* getAspathCache()
+{
+  return &aspathCache;
+}
+
 /**
  * The main program entry point. This function starts the server program.
  *
@@ -676,6 +956,8 @@ int main(int argc, const char* argv[])
   FILE* fp=NULL;
   sca_status_t sca_status = API_STATUS_OK;
 
+  clock_gettime(CLOCK_MONOTONIC, &startTime);
+
   // By default all messages go to standard error
   setLogMethodToFile(stderr);
   setLogLevel(LEVEL_ERROR);
@@ -717,6 +999,16 @@ int main(int argc, const char* argv[])
       LOG(LEVEL_DEBUG, "([0x%08X]) > Start Main SRx server thread.", 
                        pthread_self());
 
+      // Record the metrics from the start to include the initial RPKI sync.
+      if ((config.metrics_port != 0) || (config.metrics_socket != NULL))
+      {
+        initMetrics();
+      }
+      if (!initTrace(config.trace_sample_rate))
+      {
+        LOG(LEVEL_WARNING, "Updates are not traced!");
+      }
+
       // srxcryptoapi INIT
       g_capi = malloc(sizeof(SRxCryptoAPI));
       if (g_capi != NULL)
@@ -770,6 +1062,7 @@ int main(int argc, const char* argv[])
         LOG(LEVEL_ERROR, "Failure setting up queues, exit program (4)");
         // So far Handlers, Caches and the Configuration are created .
         doCleanupHandlers(SETUP_ALL_HANDLERS);
+        closeSnapshotReader(&snapshot);
         doCleanupCaches(SETUP_ALL_CACHES);
         releaseConfiguration(&config);
         exitCode = 4;
@@ -781,6 +1074,7 @@ int main(int argc, const char* argv[])
         // So far Handlers, Caches and the Configuration are created .
         releaseCommandQueue(&cmdQueue);
         doCleanupHandlers(SETUP_ALL_HANDLERS);
+        closeSnapshotReader(&snapshot);
         doCleanupCaches(SETUP_ALL_CACHES);
         releaseConfiguration(&config);
         exitCode = 5;
@@ -791,7 +1085,42 @@ int main(int argc, const char* argv[])
         createGRPCService();
         LOG(LEVEL_INFO, HDR "[server] created GRPC Service thread\n");
 #endif
+        if ((config.snapshot_file != NULL) && (config.snapshot_interval > 0))
+        {
+          snapshotThreadStarted = pthread_create(&snapshotThread, NULL, 
+                                                 snapshotLoop, NULL) == 0;
+          if (!snapshotThreadStarted)
+          {
+            LOG(LEVEL_WARNING, "Could not start the snapshot thread!");
+          }
+        }
+        if (   (config.export_file != NULL) 
+            && (sem_init(&exportRequest, 0, 0) == 0))
+        {
+          exportThreadStarted = pthread_create(&exportThread, NULL, 
+                                               exportLoop, NULL) == 0;
+          if (exportThreadStarted)
+          {
+            signal(SIGUSR1, &exportSignalReceived);
+          }
+          else
+          {
+            sem_destroy(&exportRequest);
+            LOG(LEVEL_WARNING, "Could not start the export thread!");
+          }
+        }
+        if (   ((config.metrics_port != 0) || (config.metrics_socket != NULL))
+            && !startMetricsListener(config.metrics_port, 
+                                     config.metrics_socket))
+        {
+          LOG(LEVEL_WARNING, "Metrics are not served!");
+        }
         // Ready for requests
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        LOG(LEVEL_NOTICE, "SRX server ready after %ld ms", 
+            (long)((now.tv_sec - startTime.tv_sec) * 1000 
+                   + (now.tv_nsec - startTime.tv_nsec) / 1000000));
         cleanupRequired = true;
         run();
       }
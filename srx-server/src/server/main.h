@@ -45,6 +45,8 @@
 #include <srx/srxcryptoapi.h>
 #include "server/ski_cache.h"
 #include "server/bgpsec_handler.h"
+#include "server/crypto_worker.h"
+#include "server/aspath_cache.h"
 
 /**
  * Return the pointer to CAPI
@@ -82,5 +84,37 @@ RPKI_QUEUE* getRPKIQueue();
  */
 BGPSecHandler* getBGPsecHandler();
 
+/**
+ * Return the crypto worker pool of the command handler.
+ * 
+ * @return the crypto worker pool or NULL if BGPsec validation is performed 
+ *         synchronously.
+ * 
+ * @since 0.6.3.0
+ */
+CryptoWorkerPool* getCryptoWorkerPool();
+
+/**
+ * Queue the BGPsec revalidation of the given update in the command queue. 
+ * This is used if the crypto workers cannot take the revalidation, the
+ * validation is never performed by the calling thread.
+ * 
+ * @param updateID The update to be validated again.
+ * 
+ * @return false if the command queue does not accept commands anymore.
+ * 
+ * @since 0.6.3.0
+ */
+bool queueBGPsecRevalidation(SRxUpdateID* updateID);
+
+/**
+ * Return the AS path cache.
+ * 
+ * @return the AS path cache
+ * 
+ * @since 0.6.3.0
+ */
+AspathCache* getAspathCache();
+
 #endif /* MAIN_H */
 
@@ -0,0 +1,898 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The metrics of srx-server and the listener serving them.
+ *
+ * @version 0.6.3.0
+ */
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server/metrics.h"
+#include "util/log.h"
+
+#define HDR "([0x%08X] Metrics): "
+
+/** The number of proxy clients (client IDs are 8 bit). */
+#define MET_MAX_CLIENTS      256
+/** The time in ms the listener waits for a connection before it checks if it
+ * has to stop. */
+#define MET_POLL_TIMEOUT_MS  500
+/** The maximum size of a request. */
+#define MET_MAX_REQUEST      2048
+/** The time in seconds a scraper has to send its request. */
+#define MET_REQUEST_TIMEOUT  2
+/** The smallest bucket exported is 2^MET_MIN_EXPORT_EXPONENT ns (~1 us). */
+#define MET_MIN_EXPORT_EXPONENT 10
+
+/** The names of the stages as used in the label "stage". */
+static const char* _STAGE_NAMES[MET_NUM_STAGES] = {
+  "receive", "queue_wait", "origin", "aspa", "bgpsec", "broadcast", "rtr_pdu",
+  "key_register", "key_first_validation", "queue_wait_priority",
+  "queue_wait_bulk"
+};
+
+/** The names of the RTR PDU types as used in the label "type". */
+static const char* _RTR_PDU_NAMES[MET_MAX_RTR_PDU_TYPE] = {
+  "serial_notify", "serial_query", "reset_query", "cache_response",
+  "ipv4_prefix", NULL, "ipv6_prefix", "end_of_data", "cache_reset",
+  "router_key", "error_report", "aspa", NULL, NULL, NULL, NULL
+};
+
+/** Indicates if the metrics are recorded. */
+static bool            _enabled = false;
+/** The histogram of each stage. */
+static MetricHistogram _stages[MET_NUM_STAGES];
+/** The start of MET_STAGE_KEY_FIRST_VALIDATION or 0 if not measured. */
+static uint64_t        _keyRegistration = 0;
+/** The metrics of the proxy clients, allocated with the first packet. */
+static MetricClient*   _clients[MET_MAX_CLIENTS];
+/** The commands waiting in the priority and the bulk lane. */
+static uint32_t        _queueDepth[2];
+/** The RTR PDUs received per type, the last one counts unknown types. */
+static uint64_t        _rtrPdus[MET_MAX_RTR_PDU_TYPE + 1];
+
+/** The listener thread. */
+static pthread_t       _listener;
+/** Indicates the listener thread runs. */
+static bool            _listening = false;
+/** Tells the listener thread to stop. */
+static volatile bool   _stopListener = false;
+/** The TCP and unix domain socket, -1 if not used. */
+static int             _tcpSocket  = -1;
+static int             _unixSocket = -1;
+/** The path of the unix domain socket. */
+static char*           _socketPath = NULL;
+
+/** A growing text buffer. */
+typedef struct {
+  char*  data;
+  size_t length;
+  size_t size;
+  bool   failed;
+} MetricText;
+
+/**
+ * Return the histogram bucket of the given value.
+ *
+ * @param value The value in nanoseconds.
+ *
+ * @return the index of the bucket.
+ */
+static int _bucketIndex(uint64_t value)
+{
+  int msb;
+
+  if (value < MET_SUB_BUCKETS)
+  {
+    return (int)value;
+  }
+  msb = 63 - __builtin_clzll(value);
+  if (msb > MET_MAX_EXPONENT)
+  {
+    return MET_NUM_BUCKETS - 1;
+  }
+  return (msb - MET_SUB_BUCKET_BITS + 1) * MET_SUB_BUCKETS
+         + (int)((value >> (msb - MET_SUB_BUCKET_BITS))
+                 & (MET_SUB_BUCKETS - 1));
+}
+
+/**
+ * Add a value to the histogram.
+ *
+ * @param histogram The histogram.
+ * @param value The value in nanoseconds.
+ */
+static void _addValue(MetricHistogram* histogram, uint64_t value)
+{
+  uint64_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+
+  __atomic_fetch_add(&histogram->buckets[_bucketIndex(value)], 1,
+                     __ATOMIC_RELAXED);
+  __atomic_fetch_add(&histogram->sum, value, __ATOMIC_RELAXED);
+  while (   (value > max)
+         && !__atomic_compare_exchange_n(&histogram->max, &max, value, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {}
+}
+
+/**
+ * Return the metrics of the given client, they are allocated if needed.
+ *
+ * @param clientID The client ID.
+ *
+ * @return the metrics of the client or NULL if not enough memory is
+ *         available.
+ */
+static MetricClient* _getClient(uint8_t clientID)
+{
+  MetricClient* client = __atomic_load_n(&_clients[clientID],
+                                         __ATOMIC_ACQUIRE);
+  MetricClient* expected = NULL;
+
+  if (client == NULL)
+  {
+    client = calloc(1, sizeof(MetricClient));
+    if (client == NULL)
+    {
+      return NULL;
+    }
+    // Another thread might have been faster.
+    if (!__atomic_compare_exchange_n(&_clients[clientID], &expected, client,
+                                     false, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE))
+    {
+      free(client);
+      client = expected;
+    }
+  }
+
+  return client;
+}
+
+/**
+ * Append the formatted string to the text.
+ *
+ * @param text The text.
+ * @param format The format as used by printf.
+ */
+static void _append(MetricText* text, const char* format, ...)
+{
+  va_list args;
+  int     length;
+  char*   data;
+
+  while (!text->failed)
+  {
+    va_start(args, format);
+    length = vsnprintf(text->data + text->length, text->size - text->length,
+                       format, args);
+    va_end(args);
+    if (length < 0)
+    {
+      text->failed = true;
+    }
+    else if (text->length + length < text->size)
+    {
+      text->length += length;
+      break;
+    }
+    else
+    {
+      data = realloc(text->data, text->size * 2 + length);
+      if (data == NULL)
+      {
+        text->failed = true;
+      }
+      else
+      {
+        text->data  = data;
+        text->size  = text->size * 2 + length;
+      }
+    }
+  }
+}
+
+/**
+ * Append the HELP and TYPE lines of a metric.
+ *
+ * @param text The text.
+ * @param name The name of the metric.
+ * @param type The type of the metric.
+ * @param help The description of the metric.
+ */
+static void _appendHeader(MetricText* text, const char* name,
+                          const char* type, const char* help)
+{
+  _append(text, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * Append the histogram in the Prometheus format. The buckets are exported
+ * once per power of two starting at about one microsecond. The count is the
+ * number of values in all buckets which keeps the histogram consistent while
+ * values are recorded.
+ *
+ * @param text The text.
+ * @param name The name of the metric.
+ * @param labels The labels of the histogram without braces.
+ * @param histogram The histogram.
+ */
+static void _appendHistogram(MetricText* text, const char* name,
+                             const char* labels, MetricHistogram* histogram)
+{
+  uint64_t count = 0;
+  int      idx;
+
+  for (idx = 0; idx < MET_NUM_BUCKETS; idx++)
+  {
+    count += __atomic_load_n(&histogram->buckets[idx], __ATOMIC_RELAXED);
+    // The last bucket of each power of two ends at the next power of two.
+    if (   ((idx % MET_SUB_BUCKETS) == MET_SUB_BUCKETS - 1)
+        && (idx < MET_NUM_BUCKETS - 1))
+    {
+      int exponent = idx / MET_SUB_BUCKETS + MET_SUB_BUCKET_BITS;
+      if (exponent >= MET_MIN_EXPORT_EXPONENT)
+      {
+        _append(text, "%s_bucket{%s,le=\"%.9g\"} %llu\n", name, labels,
+                (double)(1ULL << exponent) / 1e9, (unsigned long long)count);
+      }
+    }
+  }
+  _append(text, "%s_bucket{%s,le=\"+Inf\"} %llu\n", name, labels,
+          (unsigned long long)count);
+  _append(text, "%s_sum{%s} %.9f\n", name, labels,
+          (double)__atomic_load_n(&histogram->sum, __ATOMIC_RELAXED) / 1e9);
+  _append(text, "%s_count{%s} %llu\n", name, labels,
+          (unsigned long long)count);
+}
+
+/**
+ * Append a counter of each client that received packets.
+ *
+ * @param text The text.
+ * @param name The name of the metric.
+ * @param help The description of the metric.
+ * @param offset The offset of the counter within MetricClient.
+ */
+static void _appendClientCounter(MetricText* text, const char* name,
+                                 const char* help, size_t offset)
+{
+  MetricClient* client;
+  int           idx;
+
+  _appendHeader(text, name, "counter", help);
+  for (idx = 0; idx < MET_MAX_CLIENTS; idx++)
+  {
+    client = __atomic_load_n(&_clients[idx], __ATOMIC_ACQUIRE);
+    if (client != NULL)
+    {
+      _append(text, "%s{client=\"%u\"} %llu\n", name, idx,
+              (unsigned long long)__atomic_load_n(
+                               (uint64_t*)((uint8_t*)client + offset),
+                               __ATOMIC_RELAXED));
+    }
+  }
+}
+
+/**
+ * Enable the recording of metrics. The listener is started separately.
+ *
+ * @since 0.6.3.0
+ */
+void initMetrics()
+{
+  memset(_stages, 0, sizeof(_stages));
+  memset(_clients, 0, sizeof(_clients));
+  memset(_rtrPdus, 0, sizeof(_rtrPdus));
+  memset(_queueDepth, 0, sizeof(_queueDepth));
+  _keyRegistration = 0;
+  __atomic_store_n(&_enabled, true, __ATOMIC_RELEASE);
+  LOG(LEVEL_DEBUG, HDR "Metrics enabled", pthread_self());
+}
+
+/**
+ * Stop the listener, disable the recording and release all memory.
+ *
+ * @since 0.6.3.0
+ */
+void releaseMetrics()
+{
+  int idx;
+
+  stopMetricsListener();
+  __atomic_store_n(&_enabled, false, __ATOMIC_RELEASE);
+  for (idx = 0; idx < MET_MAX_CLIENTS; idx++)
+  {
+    free(_clients[idx]);
+    _clients[idx] = NULL;
+  }
+}
+
+/**
+ * Answer the request of a scraper and close the connection.
+ *
+ * @param fd The socket of the scraper.
+ */
+static void _serveRequest(int fd)
+{
+  char           request[MET_MAX_REQUEST + 1];
+  size_t         received = 0;
+  ssize_t        bytes;
+  struct timeval timeout = { MET_REQUEST_TIMEOUT, 0 };
+  char           header[160];
+  char*          body     = NULL;
+  size_t         length   = 0;
+  const char*    status   = "200 OK";
+
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  // Read the request line and the headers, the content is not used.
+  request[0] = '\0';
+  while ((received < MET_MAX_REQUEST)
+         && (strstr(request, "\r\n\r\n") == NULL)
+         && (strstr(request, "\n\n") == NULL))
+  {
+    bytes = recv(fd, request + received, MET_MAX_REQUEST - received, 0);
+    if (bytes <= 0)
+    {
+      break;
+    }
+    received += bytes;
+    request[received] = '\0';
+  }
+
+  if (strncmp(request, "GET ", 4) != 0)
+  {
+    status = "405 Method Not Allowed";
+  }
+  else if (   (strncmp(request + 4, "/metrics", 8) != 0)
+           && (strncmp(request + 4, "/ ", 2) != 0))
+  {
+    status = "404 Not Found";
+  }
+  else
+  {
+    body = renderMetrics(&length);
+    if (body == NULL)
+    {
+      status = "500 Internal Server Error";
+    }
+  }
+
+  snprintf(header, sizeof(header), "HTTP/1.0 %s\r\n"
+           "Content-Type: text/plain; version=0.0.4\r\n"
+           "Content-Length: %zu\r\n"
+           "Connection: close\r\n\r\n", status, length);
+  if (send(fd, header, strlen(header), MSG_NOSIGNAL) > 0)
+  {
+    size_t sent = 0;
+    while (sent < length)
+    {
+      bytes = send(fd, body + sent, length - sent, MSG_NOSIGNAL);
+      if (bytes <= 0)
+      {
+        LOG(LEVEL_DEBUG, HDR "Scraper closed the connection", pthread_self());
+        break;
+      }
+      sent += bytes;
+    }
+  }
+  free(body);
+  close(fd);
+}
+
+/**
+ * The listener thread, it serves one scraper at a time.
+ *
+ * @param arg not used.
+ *
+ * @return NULL
+ */
+static void* _listenerLoop(void* arg)
+{
+  struct pollfd fds[2];
+  int           numFds = 0;
+  int           idx;
+  int           fd;
+
+  LOG(LEVEL_DEBUG, HDR "Metrics listener started", pthread_self());
+  if (_tcpSocket != -1)
+  {
+    fds[numFds].fd       = _tcpSocket;
+    fds[numFds++].events = POLLIN;
+  }
+  if (_unixSocket != -1)
+  {
+    fds[numFds].fd       = _unixSocket;
+    fds[numFds++].events = POLLIN;
+  }
+
+  while (!_stopListener)
+  {
+    if (poll(fds, numFds, MET_POLL_TIMEOUT_MS) <= 0)
+    {
+      continue;
+    }
+    for (idx = 0; idx < numFds; idx++)
+    {
+      if ((fds[idx].revents & POLLIN) != 0)
+      {
+        fd = accept(fds[idx].fd, NULL, NULL);
+        if (fd != -1)
+        {
+          _serveRequest(fd);
+        }
+      }
+    }
+  }
+  LOG(LEVEL_DEBUG, HDR "Metrics listener stopped", pthread_self());
+
+  pthread_exit(0);
+}
+
+/**
+ * Close the listening sockets.
+ */
+static void _closeListeners()
+{
+  if (_tcpSocket != -1)
+  {
+    close(_tcpSocket);
+    _tcpSocket = -1;
+  }
+  if (_unixSocket != -1)
+  {
+    close(_unixSocket);
+    _unixSocket = -1;
+    unlink(_socketPath);
+  }
+  free(_socketPath);
+  _socketPath = NULL;
+}
+
+/**
+ * Start the thread that serves the metrics. At least one of the listeners
+ * must be given.
+ *
+ * @param port The TCP port on the loopback interface, 0 = none.
+ * @param socketPath The path of the unix domain socket, NULL = none. An
+ *                   existing file is replaced.
+ *
+ * @return false if a listener could not be opened.
+ *
+ * @since 0.6.3.0
+ */
+bool startMetricsListener(int port, const char* socketPath)
+{
+  int on = 1;
+
+  if (_listening || ((port == 0) && (socketPath == NULL)))
+  {
+    RAISE_ERROR("Metrics listener is already running or not configured!");
+    return false;
+  }
+
+  if (port != 0)
+  {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(struct sockaddr_in));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    _tcpSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (   (_tcpSocket == -1)
+        || (setsockopt(_tcpSocket, SOL_SOCKET, SO_REUSEADDR, &on,
+                       sizeof(on)) != 0)
+        || (bind(_tcpSocket, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+        || (listen(_tcpSocket, SOMAXCONN) != 0))
+    {
+      RAISE_SYS_ERROR("Could not listen for metrics scrapers on port %u",
+                      port);
+      _closeListeners();
+      return false;
+    }
+  }
+
+  if (socketPath != NULL)
+  {
+    struct sockaddr_un addr;
+    if (strlen(socketPath) >= sizeof(addr.sun_path))
+    {
+      RAISE_ERROR("The metrics socket path '%s' is too long!", socketPath);
+      _closeListeners();
+      return false;
+    }
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    unlink(socketPath);
+
+    _unixSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (   (_unixSocket == -1)
+        || (bind(_unixSocket, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+        || (listen(_unixSocket, SOMAXCONN) != 0))
+    {
+      RAISE_SYS_ERROR("Could not listen for metrics scrapers on '%s'",
+                      socketPath);
+      if (_unixSocket != -1)
+      {
+        close(_unixSocket);
+        _unixSocket = -1;
+      }
+      _closeListeners();
+      return false;
+    }
+    _socketPath = strdup(socketPath);
+  }
+
+  _stopListener = false;
+  if (pthread_create(&_listener, NULL, _listenerLoop, NULL) != 0)
+  {
+    RAISE_SYS_ERROR("Could not start the metrics listener");
+    _closeListeners();
+    return false;
+  }
+  _listening = true;
+  LOG(LEVEL_INFO, "Metrics served on port %u, socket '%s'", port,
+      socketPath != NULL ? socketPath : "-");
+
+  return true;
+}
+
+/**
+ * Stop the thread that serves the metrics and close the listeners.
+ *
+ * @since 0.6.3.0
+ */
+void stopMetricsListener()
+{
+  if (_listening)
+  {
+    _stopListener = true;
+    pthread_join(_listener, NULL);
+    _listening = false;
+    _closeListeners();
+  }
+}
+
+/**
+ * Return the current time used as the start of a measurement.
+ *
+ * @return the monotonic time in nanoseconds or 0 if the metrics are disabled.
+ *
+ * @since 0.6.3.0
+ */
+uint64_t metricsNow()
+{
+  struct timespec now;
+
+  if (!__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    return 0;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Record the time elapsed since start for the given stage. Nothing is
+ * recorded if start is 0.
+ *
+ * @param stage The stage.
+ * @param clientID The client the stage was performed for or MET_NO_CLIENT.
+ * @param start The start time returned by metricsNow.
+ *
+ * @since 0.6.3.0
+ */
+void recordMetric(MetricStage stage, int clientID, uint64_t start)
+{
+  uint64_t      now;
+  uint64_t      elapsed;
+  MetricClient* client;
+
+  if ((start == 0) || (stage >= MET_NUM_STAGES))
+  {
+    return;
+  }
+  now     = metricsNow();
+  elapsed = now > start ? now - start : 0;
+  _addValue(&_stages[stage], elapsed);
+
+  if (   (stage == MET_STAGE_BGPSEC) 
+      && (__atomic_load_n(&_keyRegistration, __ATOMIC_RELAXED) != 0))
+  {
+    // Only the first validation after the registration ends the measurement.
+    start = __atomic_exchange_n(&_keyRegistration, 0, __ATOMIC_RELAXED);
+    if (start != 0)
+    {
+      _addValue(&_stages[MET_STAGE_KEY_FIRST_VALIDATION], 
+                now > start ? now - start : 0);
+    }
+  }
+
+  if (   (clientID >= 0) && (clientID < MET_MAX_CLIENTS)
+      && (stage < MET_NUM_CLIENT_STAGES))
+  {
+    client = _getClient((uint8_t)clientID);
+    if (client != NULL)
+    {
+      _addValue(&client->stages[stage], elapsed);
+    }
+  }
+}
+
+/**
+ * Start the measurement of MET_STAGE_KEY_FIRST_VALIDATION, it ends with the
+ * next MET_STAGE_BGPSEC recorded.
+ *
+ * @since 0.6.3.0
+ */
+void markKeyRegistration()
+{
+  __atomic_store_n(&_keyRegistration, metricsNow(), __ATOMIC_RELAXED);
+}
+
+/**
+ * Set the number of commands waiting in the lanes of the command queue.
+ *
+ * @param prioDepth The commands in the priority lane.
+ * @param bulkDepth The commands in the bulk lane.
+ *
+ * @since 0.6.3.0
+ */
+void setCommandQueueDepth(uint32_t prioDepth, uint32_t bulkDepth)
+{
+  if (__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    __atomic_store_n(&_queueDepth[0], prioDepth, __ATOMIC_RELAXED);
+    __atomic_store_n(&_queueDepth[1], bulkDepth, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+ * Count a packet received from a proxy client.
+ *
+ * @param clientID The client ID.
+ * @param length The length of the packet.
+ * @param request true if the packet is a validation request.
+ *
+ * @since 0.6.3.0
+ */
+void countClientPacket(uint8_t clientID, uint32_t length, bool request)
+{
+  MetricClient* client;
+
+  if (__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    client = _getClient(clientID);
+    if (client != NULL)
+    {
+      __atomic_fetch_add(&client->packets, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&client->bytes, length, __ATOMIC_RELAXED);
+      if (request)
+      {
+        __atomic_fetch_add(&client->requests, 1, __ATOMIC_RELAXED);
+      }
+    }
+  }
+}
+
+/**
+ * Count a validation result send to a proxy client.
+ *
+ * @param clientID The client ID.
+ *
+ * @since 0.6.3.0
+ */
+void countClientResult(uint8_t clientID)
+{
+  MetricClient* client;
+
+  if (__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    client = _getClient(clientID);
+    if (client != NULL)
+    {
+      __atomic_fetch_add(&client->results, 1, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/**
+ * Count a flow control event of a proxy client.
+ *
+ * @param clientID The client ID.
+ * @param event The event.
+ *
+ * @since 0.6.3.0
+ */
+void countClientFlow(uint8_t clientID, MetricFlowEvent event)
+{
+  MetricClient* client;
+
+  if (__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    client = _getClient(clientID);
+    if (client != NULL)
+    {
+      switch (event)
+      {
+        case MET_FLOW_CREDIT_WAIT:
+          __atomic_fetch_add(&client->creditWaits, 1, __ATOMIC_RELAXED);
+          break;
+        case MET_FLOW_COALESCED:
+          __atomic_fetch_add(&client->coalesced, 1, __ATOMIC_RELAXED);
+          break;
+        case MET_FLOW_OVERFLOW:
+          __atomic_fetch_add(&client->overflows, 1, __ATOMIC_RELAXED);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+}
+
+/**
+ * Count a PDU received from the RPKI validation cache.
+ *
+ * @param type The PDU type.
+ *
+ * @since 0.6.3.0
+ */
+void countRTRPdu(uint8_t type)
+{
+  if (__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    if ((type >= MET_MAX_RTR_PDU_TYPE) || (_RTR_PDU_NAMES[type] == NULL))
+    {
+      type = MET_MAX_RTR_PDU_TYPE;
+    }
+    __atomic_fetch_add(&_rtrPdus[type], 1, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+ * Write all metrics in the Prometheus text exposition format into a newly
+ * allocated string.
+ *
+ * @param length (out) The length of the text.
+ *
+ * @return the text which MUST be freed by the caller or NULL if not enough
+ *         memory is available.
+ *
+ * @since 0.6.3.0
+ */
+char* renderMetrics(size_t* length)
+{
+  MetricText    text;
+  MetricClient* client;
+  char          labels[64];
+  int           idx, stage;
+
+  memset(&text, 0, sizeof(MetricText));
+  text.size = 16384;
+  text.data = malloc(text.size);
+  if (text.data == NULL)
+  {
+    return NULL;
+  }
+  text.data[0] = '\0';
+
+  _appendHeader(&text, "srx_stage_latency_seconds", "histogram",
+                "Time spent in a processing stage.");
+  for (stage = 0; stage < MET_NUM_STAGES; stage++)
+  {
+    snprintf(labels, sizeof(labels), "stage=\"%s\"", _STAGE_NAMES[stage]);
+    _appendHistogram(&text, "srx_stage_latency_seconds", labels,
+                     &_stages[stage]);
+  }
+  _appendHeader(&text, "srx_stage_latency_max_seconds", "gauge",
+                "Longest time spent in a processing stage.");
+  for (stage = 0; stage < MET_NUM_STAGES; stage++)
+  {
+    _append(&text, "srx_stage_latency_max_seconds{stage=\"%s\"} %.9f\n",
+            _STAGE_NAMES[stage],
+            (double)__atomic_load_n(&_stages[stage].max, __ATOMIC_RELAXED)
+            / 1e9);
+  }
+
+  _appendHeader(&text, "srx_command_queue_depth", "gauge",
+                "Commands waiting in a lane of the command queue.");
+  _append(&text, "srx_command_queue_depth{lane=\"priority\"} %u\n",
+          __atomic_load_n(&_queueDepth[0], __ATOMIC_RELAXED));
+  _append(&text, "srx_command_queue_depth{lane=\"bulk\"} %u\n",
+          __atomic_load_n(&_queueDepth[1], __ATOMIC_RELAXED));
+
+  _appendHeader(&text, "srx_client_stage_latency_seconds", "histogram",
+                "Time spent in a processing stage per proxy client.");
+  for (idx = 0; idx < MET_MAX_CLIENTS; idx++)
+  {
+    client = __atomic_load_n(&_clients[idx], __ATOMIC_ACQUIRE);
+    if (client != NULL)
+    {
+      for (stage = 0; stage < MET_NUM_CLIENT_STAGES; stage++)
+      {
+        snprintf(labels, sizeof(labels), "client=\"%u\",stage=\"%s\"", idx,
+                 _STAGE_NAMES[stage]);
+        _appendHistogram(&text, "srx_client_stage_latency_seconds", labels,
+                         &client->stages[stage]);
+      }
+    }
+  }
+  _appendClientCounter(&text, "srx_client_packets_received_total",
+                       "Packets received from a proxy client.",
+                       offsetof(MetricClient, packets));
+  _appendClientCounter(&text, "srx_client_bytes_received_total",
+                       "Bytes received from a proxy client.",
+                       offsetof(MetricClient, bytes));
+  _appendClientCounter(&text, "srx_client_requests_total",
+                       "Validation requests received from a proxy client.",
+                       offsetof(MetricClient, requests));
+  _appendClientCounter(&text, "srx_client_results_sent_total",
+                       "Validation results send to a proxy client.",
+                       offsetof(MetricClient, results));
+  _appendClientCounter(&text, "srx_client_credit_waits_total",
+                       "Times the receiver waited for credits of a proxy "
+                       "client.", offsetof(MetricClient, creditWaits));
+  _appendClientCounter(&text, "srx_client_coalesced_results_total",
+                       "Validation results merged into queued ones of a "
+                       "proxy client.", offsetof(MetricClient, coalesced));
+  _appendClientCounter(&text, "srx_client_queue_overflows_total",
+                       "Disconnects of a proxy client because of a full "
+                       "send queue.", offsetof(MetricClient, overflows));
+
+  _appendHeader(&text, "srx_rtr_pdus_received_total", "counter",
+                "PDUs received from the RPKI validation cache.");
+  for (idx = 0; idx <= MET_MAX_RTR_PDU_TYPE; idx++)
+  {
+    if ((idx == MET_MAX_RTR_PDU_TYPE) || (_RTR_PDU_NAMES[idx] != NULL))
+    {
+      _append(&text, "srx_rtr_pdus_received_total{type=\"%s\"} %llu\n",
+              idx < MET_MAX_RTR_PDU_TYPE ? _RTR_PDU_NAMES[idx] : "unknown",
+              (unsigned long long)__atomic_load_n(&_rtrPdus[idx],
+                                                  __ATOMIC_RELAXED));
+    }
+  }
+
+  if (text.failed)
+  {
+    free(text.data);
+    return NULL;
+  }
+  *length = text.length;
+
+  return text.data;
+}
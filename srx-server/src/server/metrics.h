@@ -0,0 +1,260 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The metrics count the packets and measure the time spent in each stage of
+ * srx-server. All counters are updated with atomic operations, no lock is
+ * taken while recording. The latencies are kept in log-linear histograms
+ * (MET_SUB_BUCKETS buckets per power of two nanoseconds) which keep the
+ * relative error below 25% over the whole range.
+ *
+ * The metrics are served in the Prometheus text exposition format by a
+ * listener thread on a local TCP port and/or a unix domain socket. Any HTTP
+ * GET request is answered with the current values.
+ *
+ * As long as the metrics are not enabled, recording is reduced to one check
+ * of a flag.
+ *
+ * @version 0.6.3.0
+ */
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/** The stages srx-server measures. */
+typedef enum {
+  /** Pre-processing of a packet received from a proxy until it is queued. */
+  MET_STAGE_RECEIVE    = 0,
+  /** Time a command waited in the command queue. */
+  MET_STAGE_QUEUE_WAIT = 1,
+  /** Origin validation of an update. */
+  MET_STAGE_ORIGIN     = 2,
+  /** ASPA validation of an update. */
+  MET_STAGE_ASPA       = 3,
+  /** BGPsec path validation of an update. */
+  MET_STAGE_BGPSEC     = 4,
+  /** Sending a validation result to the clients of an update. */
+  MET_STAGE_BROADCAST  = 5,
+  /** Processing of a PDU received from the RPKI validation cache. */
+  MET_STAGE_RTR_PDU    = 6,
+  /** Bulk registration of the router keys received until an End of Data. */
+  MET_STAGE_KEY_REGISTER = 7,
+  /** Time from a bulk registration of router keys until the first BGPsec 
+   * validation finished. */
+  MET_STAGE_KEY_FIRST_VALIDATION = 8,
+  /** Time a command waited in the priority lane of the command queue. */
+  MET_STAGE_QUEUE_WAIT_PRIORITY = 9,
+  /** Time a command waited in the bulk lane of the command queue. */
+  MET_STAGE_QUEUE_WAIT_BULK = 10
+} MetricStage;
+
+/** The flow control events of a proxy client. */
+typedef enum {
+  /** The receiver waited for credits of the client. */
+  MET_FLOW_CREDIT_WAIT = 0,
+  /** A verify notification was merged into a queued one. */
+  MET_FLOW_COALESCED   = 1,
+  /** The client was disconnected because its send queue was full. */
+  MET_FLOW_OVERFLOW    = 2
+} MetricFlowEvent;
+
+/** The number of stages. */
+#define MET_NUM_STAGES      11
+/** The stages that are measured per client as well (MET_STAGE_RECEIVE and
+ * MET_STAGE_QUEUE_WAIT). */
+#define MET_NUM_CLIENT_STAGES 2
+/** Used for stages not related to a client. */
+#define MET_NO_CLIENT       -1
+
+/** log2 of the number of buckets per power of two. */
+#define MET_SUB_BUCKET_BITS 2
+/** The number of buckets per power of two. */
+#define MET_SUB_BUCKETS     (1 << MET_SUB_BUCKET_BITS)
+/** The highest power of two measured (2^36 ns = 68.7 s), larger values are
+ * counted in the last bucket. */
+#define MET_MAX_EXPONENT    36
+/** The number of buckets of a histogram. */
+#define MET_NUM_BUCKETS     ((MET_MAX_EXPONENT - MET_SUB_BUCKET_BITS + 2) \
+                             * MET_SUB_BUCKETS)
+
+/** The maximum number of RTR PDU types counted. */
+#define MET_MAX_RTR_PDU_TYPE 16
+
+/** A latency histogram. */
+typedef struct {
+  /** The number of values per bucket. */
+  uint64_t buckets[MET_NUM_BUCKETS];
+  /** The sum of all values in nanoseconds. */
+  uint64_t sum;
+  /** The largest value in nanoseconds. */
+  uint64_t max;
+} MetricHistogram;
+
+/** The metrics of one proxy client. */
+typedef struct {
+  /** The packets received from the client. */
+  uint64_t        packets;
+  /** The bytes received from the client. */
+  uint64_t        bytes;
+  /** The validation requests received from the client. */
+  uint64_t        requests;
+  /** The validation results send to the client. */
+  uint64_t        results;
+  /** The times the receiver waited for credits of the client. */
+  uint64_t        creditWaits;
+  /** The verify notifications merged into queued ones. */
+  uint64_t        coalesced;
+  /** The disconnects because of a full send queue. */
+  uint64_t        overflows;
+  /** MET_STAGE_RECEIVE and MET_STAGE_QUEUE_WAIT of this client. */
+  MetricHistogram stages[MET_NUM_CLIENT_STAGES];
+} MetricClient;
+
+/**
+ * Enable the recording of metrics. The listener is started separately.
+ *
+ * @since 0.6.3.0
+ */
+void initMetrics();
+
+/**
+ * Stop the listener, disable the recording and release all memory.
+ *
+ * @since 0.6.3.0
+ */
+void releaseMetrics();
+
+/**
+ * Start the thread that serves the metrics. At least one of the listeners
+ * must be given.
+ *
+ * @param port The TCP port on the loopback interface, 0 = none.
+ * @param socketPath The path of the unix domain socket, NULL = none. An
+ *                   existing file is replaced.
+ *
+ * @return false if a listener could not be opened.
+ *
+ * @since 0.6.3.0
+ */
+bool startMetricsListener(int port, const char* socketPath);
+
+/**
+ * Stop the thread that serves the metrics and close the listeners.
+ *
+ * @since 0.6.3.0
+ */
+void stopMetricsListener();
+
+/**
+ * Return the current time used as the start of a measurement.
+ *
+ * @return the monotonic time in nanoseconds or 0 if the metrics are disabled.
+ *
+ * @since 0.6.3.0
+ */
+uint64_t metricsNow();
+
+/**
+ * Record the time elapsed since start for the given stage. Nothing is
+ * recorded if start is 0.
+ *
+ * @param stage The stage.
+ * @param clientID The client the stage was performed for or MET_NO_CLIENT.
+ * @param start The start time returned by metricsNow.
+ *
+ * @since 0.6.3.0
+ */
+void recordMetric(MetricStage stage, int clientID, uint64_t start);
+
+/**
+ * Start the measurement of MET_STAGE_KEY_FIRST_VALIDATION, it ends with the
+ * next MET_STAGE_BGPSEC recorded.
+ *
+ * @since 0.6.3.0
+ */
+void markKeyRegistration();
+
+/**
+ * Set the number of commands waiting in the lanes of the command queue.
+ *
+ * @param prioDepth The commands in the priority lane.
+ * @param bulkDepth The commands in the bulk lane.
+ *
+ * @since 0.6.3.0
+ */
+void setCommandQueueDepth(uint32_t prioDepth, uint32_t bulkDepth);
+
+/**
+ * Count a packet received from a proxy client.
+ *
+ * @param clientID The client ID.
+ * @param length The length of the packet.
+ * @param request true if the packet is a validation request.
+ *
+ * @since 0.6.3.0
+ */
+void countClientPacket(uint8_t clientID, uint32_t length, bool request);
+
+/**
+ * Count a validation result send to a proxy client.
+ *
+ * @param clientID The client ID.
+ *
+ * @since 0.6.3.0
+ */
+void countClientResult(uint8_t clientID);
+
+/**
+ * Count a flow control event of a proxy client.
+ *
+ * @param clientID The client ID.
+ * @param event The event.
+ *
+ * @since 0.6.3.0
+ */
+void countClientFlow(uint8_t clientID, MetricFlowEvent event);
+
+/**
+ * Count a PDU received from the RPKI validation cache.
+ *
+ * @param type The PDU type.
+ *
+ * @since 0.6.3.0
+ */
+void countRTRPdu(uint8_t type);
+
+/**
+ * Write all metrics in the Prometheus text exposition format into a newly
+ * allocated string.
+ *
+ * @param length (out) The length of the text.
+ *
+ * @return the text which MUST be freed by the caller or NULL if not enough
+ *         memory is available.
+ *
+ * @since 0.6.3.0
+ */
+char* renderMetrics(size_t* length);
+
+#endif // __METRICS_H__
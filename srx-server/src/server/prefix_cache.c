@@ -79,6 +79,19 @@
 
 #define HDR "[PrefixCache [0x%08X]]: "
 
+/**
+ * A ROA white-list entry to be removed by cleanAllROAwl.
+ *
+ * @since 0.6.3.0
+ */
+typedef struct {
+  IPPrefix prefix;
+  uint32_t as;
+  uint8_t  maxLen;
+  /** The number of identical entries to be removed. */
+  uint16_t count;
+} PC_StaleROA;
+
 /*-----------------------------
  * R/W lock and mutex debugging
  */
@@ -165,6 +178,39 @@
   #define UNLOCK_MUTEX(VAR)
 #endif
 
+/**
+ * Destroy the prefix trees of the prefix cache. The data of the tree nodes 
+ * must be released before.
+ *
+ * @param self The prefix cache.
+ */
+static void _destroyPrefixTrees(PrefixCache* self)
+{
+  int idx;
+
+  for (idx = 0; idx < PC_NO_TREES; idx++)
+  {
+    if (self->prefixTree[idx] != NULL)
+    {
+      Destroy_Patricia(self->prefixTree[idx], NULL);
+      self->prefixTree[idx] = NULL;
+    }
+  }
+}
+
+/**
+ * Return the prefix tree of the address family of the given prefix.
+ *
+ * @param self The prefix cache.
+ * @param prefix The prefix.
+ *
+ * @return The IPv4 or the IPv6 prefix tree.
+ */
+static patricia_tree_t* _getPrefixTree(PrefixCache* self, IPPrefix* prefix)
+{
+  return self->prefixTree[prefix->ip.version == 4 ? PC_TREE_V4 : PC_TREE_V6];
+}
+
 /**
  * Initializes an empty cache and creates a link to an existing Update Cache.
  *
@@ -175,11 +221,14 @@
  */
 bool initializePrefixCache(PrefixCache* self, UpdateCache* updateCache)
 {
-  // Create the patricia prefix tree
-  self->prefixTree = New_Patricia(PATRICIA_MAXBITS); // 128 = IPv6
-  if (self->prefixTree == NULL)
+  // Create the patricia prefix trees
+  self->prefixTree[PC_TREE_V4] = New_Patricia(32);
+  self->prefixTree[PC_TREE_V6] = New_Patricia(PATRICIA_MAXBITS); // 128 = IPv6
+  if (   (self->prefixTree[PC_TREE_V4] == NULL) 
+      || (self->prefixTree[PC_TREE_V6] == NULL))
   {
     RAISE_ERROR("Failed to initialize the prefix tree");
+    _destroyPrefixTrees(self);
     return false;
   }
 
@@ -187,7 +236,14 @@ bool initializePrefixCache(PrefixCache* self, UpdateCache* updateCache)
   if (!initMutex(&self->updatesMutex))
   {
     RAISE_ERROR("Failed to initialize the updates mutex");
-    Destroy_Patricia(self->prefixTree, NULL);
+    _destroyPrefixTrees(self);
+    return false;
+  }
+  if (!initMutex(&self->matchesMutex))
+  {
+    RAISE_ERROR("Failed to initialize the matches mutex");
+    releaseMutex(&self->updatesMutex);
+    _destroyPrefixTrees(self);
     return false;
   }
   int step = 0;
@@ -215,7 +271,9 @@ bool initializePrefixCache(PrefixCache* self, UpdateCache* updateCache)
       case 3:  releaseRWLock(&self->validLock);
       case 2:  releaseRWLock(&self->asLock);
       case 1:  releaseRWLock(&self->treeLock);
-      default: Destroy_Patricia(self->prefixTree, NULL);
+      default: releaseMutex(&self->matchesMutex);
+               releaseMutex(&self->updatesMutex);
+               _destroyPrefixTrees(self);
                return false;
     }
   }
@@ -223,6 +281,8 @@ bool initializePrefixCache(PrefixCache* self, UpdateCache* updateCache)
   // Misc.
   self->updateCache = updateCache;
   initSList(&self->updates);
+  initializeROAIndex(&self->roaIndex);
+  self->matches = 0;
   return true;
 }
 
@@ -259,6 +319,7 @@ static void releasePrefix(PC_Prefix* prefix)
         }
       }
       releaseSList(&asNumber->roas);
+      releaseSList(&asNumber->matches);
       free(asNumber);
       asNumber = NULL;
     }
@@ -278,24 +339,34 @@ void releasePrefixCache(PrefixCache* self)
     SListNode*        listNode;
     PC_Prefix*        prefix;
     PC_Update*        pc_update;
+    int               idx;
 
     // Free all prefixes and node-data
     WRITE_LOCK(&self->asLock);
     WRITE_LOCK(&self->validLock);
     WRITE_LOCK(&self->otherLock);
 
-    PATRICIA_WALK(self->prefixTree->head, treeNode)
+    for (idx = 0; idx < PC_NO_TREES; idx++)
     {
-      prefix = PATRICIA_DATA_GET(treeNode, PC_Prefix);
-      releasePrefix(prefix);
-    } PATRICIA_WALK_END;
+      PATRICIA_WALK(self->prefixTree[idx]->head, treeNode)
+      {
+        prefix = PATRICIA_DATA_GET(treeNode, PC_Prefix);
+        if (prefix != NULL)
+        {
+          releasePrefix(prefix);
+        }
+      } PATRICIA_WALK_END;
+    }
     RAISE_ERROR("Check if the treeNode has to be released independent or if it gets released with the Destroy_Patricia!");
-    Destroy_Patricia(self->prefixTree, NULL);
+    _destroyPrefixTrees(self);
     // test if the DestroyPatricia deleted everything!
     free(treeNode);        //           <<<<<<<------ Hopefully this causes a sigdev
     // end of test. If it was freed before this should cause a SIGDEV!!!! (I HOPE SO)
 
 
+    releaseROAIndex(&self->roaIndex);
+    releaseMutex(&self->matchesMutex);
+
     releaseRWLock(&self->otherLock);
     releaseRWLock(&self->validLock);
     releaseRWLock(&self->asLock);
@@ -333,22 +404,30 @@ void emptyCache(PrefixCache* self)
     PC_AS*            pc_as;
     PC_ROA*           pc_roa;
     PC_Update*        pc_update;
+    int               idx;
 
     // Free all prefixes and node-data
     WRITE_LOCK(&self->asLock);
     WRITE_LOCK(&self->validLock);
     WRITE_LOCK(&self->otherLock);
 
-    PATRICIA_WALK(self->prefixTree->head, treeNode)
+    for (idx = 0; idx < PC_NO_TREES; idx++)
     {
-      prefix = (PC_Prefix*)treeNode->data;
-      if (prefix != NULL)
+      PATRICIA_WALK(self->prefixTree[idx]->head, treeNode)
       {
-        releasePrefix(prefix);
-      }
-      treeNode->data = NULL;
-    } PATRICIA_WALK_END;
-    Clear_Patricia(self->prefixTree, NULL);
+        prefix = (PC_Prefix*)treeNode->data;
+        if (prefix != NULL)
+        {
+          releasePrefix(prefix);
+        }
+        treeNode->data = NULL;
+      } PATRICIA_WALK_END;
+      Clear_Patricia(self->prefixTree[idx], NULL);
+    }
+    lockMutex(&self->matchesMutex);
+    releaseROAIndex(&self->roaIndex);
+    self->matches = 0;
+    unlockMutex(&self->matchesMutex);
 
     // Free all updates
     LOCK_MUTEX(&self->updatesMutex);
@@ -446,6 +525,8 @@ static PC_AS* getASFromPrefix(PC_Prefix* pcPrefix, uint32_t as)
       pcAS->asn          = as;
       pcAS->update_count = 0;
       initSList(&pcAS->roas);
+      initSList(&pcAS->matches);
+      pcAS->matchesValid = false;
     }
     else
     {
@@ -458,6 +539,47 @@ static PC_AS* getASFromPrefix(PC_Prefix* pcPrefix, uint32_t as)
   return pcAS;
 }
 
+/**
+ * Clear the remembered ROA matches of all prefixes of the given subtree. This
+ * is needed each time a ROA of the subtree root is created or removed, the
+ * prefixes outside of the subtree are not covered by it. The caller MUST hold
+ * the matchesMutex.
+ *
+ * @param self The prefix cache.
+ * @param treeNode The root of the subtree.
+ */
+static void _clearMatches(PrefixCache* self, patricia_node_t* treeNode)
+{
+  patricia_node_t* node;
+  PC_Prefix*       pcPrefix;
+  PC_AS*           pcAS;
+  SListNode*       asListNode;
+
+  if (self->matches == 0)
+  {
+    // Nothing remembered, i.e. while the ROAs are loaded.
+    return;
+  }
+
+  PATRICIA_WALK(treeNode, node)
+  {
+    pcPrefix = PATRICIA_DATA_GET(node, PC_Prefix);
+    if (pcPrefix != NULL)
+    {
+      FOREACH_SLIST(&pcPrefix->asn, asListNode)
+      {
+        pcAS = (PC_AS*)getDataOfSListNode(asListNode);
+        if (pcAS->matchesValid)
+        {
+          emptySList(&pcAS->matches);
+          pcAS->matchesValid = false;
+          self->matches--;
+        }
+      }
+    }
+  } PATRICIA_WALK_END;
+}
+
 /**
  * Return all direct children in the trie one level down that contain a
  * PC_Prefix. The children are NOT the prefix tree nodes. The children are the
@@ -512,9 +634,11 @@ static bool getChildren(SList* children, patricia_node_t* node)
 ////////////////////////////////////////////////////////////////////////////////
 
 static bool _performUpdateValidationNewPrefix(PrefixCache* self,
-                                              PC_Update* update, uint32_t as);
+                                              PC_Update* update,
+                                              IPPrefix* prefix, uint32_t as);
 static bool _performUpdateValidationKnownPrefix(PrefixCache* self,
-                                                PC_Update* update, uint32_t as,
+                                                PC_Update* update,
+                                                IPPrefix* prefix, uint32_t as,
                                                 bool isNew);
 
 /**
@@ -568,7 +692,7 @@ bool requestUpdateValidation(PrefixCache* self, SRxUpdateID* updateID,
   // insert the requested prefix in the tree if it doesn't exist already.
   // Therefore the result value equals NULL can be interpreted as an internal
   // ERROR.
-  treeNode = patricia_lookup(self->prefixTree, lookupPrefix);
+  treeNode = patricia_lookup(_getPrefixTree(self, prefix), lookupPrefix);
   if (treeNode == NULL)
   {
     RAISE_ERROR("Failed to append a prefix to the prefix tree");
@@ -591,7 +715,7 @@ bool requestUpdateValidation(PrefixCache* self, SRxUpdateID* updateID,
   if (lookupPrefix->ref_count > 0) // If the prefix would have been existed
   {                     // already this instance would not have been referenced.
     // (Does P exist ? NO)
-    retVal = _performUpdateValidationNewPrefix(self, pcUpdate, as);
+    retVal = _performUpdateValidationNewPrefix(self, pcUpdate, prefix, as);
     UNLOCK_READ_LOCK(&self->treeLock);
 
     // printXML(self, "requestUpdateValidation");
@@ -609,7 +733,8 @@ bool requestUpdateValidation(PrefixCache* self, SRxUpdateID* updateID,
     if (pcPrefix->roa_coverage > 0)
     {
       // (P::ROA_Count == 0 ? No)                           //false = ! NEW P
-      retVal = _performUpdateValidationKnownPrefix(self, pcUpdate, as, false);
+      retVal = _performUpdateValidationKnownPrefix(self, pcUpdate, prefix, as,
+                                                   false);
 
       UNLOCK_READ_LOCK(&self->treeLock);
       return retVal;
@@ -664,12 +789,14 @@ bool requestUpdateValidation(PrefixCache* self, SRxUpdateID* updateID,
  *
  * @param self The prefix cache
  * @param pcUpdate The prefix cache update
+ * @param prefix The prefix of the update.
  * @param as The origin as number of the update.
  *
  * @return false in case of an internal error, otherwise true;
  */
 static bool _performUpdateValidationNewPrefix(PrefixCache* self,
-                                              PC_Update* pcUpdate, uint32_t as)
+                                              PC_Update* pcUpdate,
+                                              IPPrefix* prefix, uint32_t as)
 {
   if (pcUpdate->treeNode->data != NULL)
   {
@@ -697,7 +824,7 @@ static bool _performUpdateValidationNewPrefix(PrefixCache* self,
     pcPrefix->state_of_other = SRx_RESULT_NOTFOUND;
   }
 
-  return _performUpdateValidationKnownPrefix(self, pcUpdate, as, true);
+  return _performUpdateValidationKnownPrefix(self, pcUpdate, prefix, as, true);
 }
 
 /*
@@ -750,60 +877,49 @@ static bool _performUpdateValidation_PrefixNotCovered(PrefixCache* self,
   return retVal;
 }
 
+/** The state of a lookup of the ROAs covering the prefix of an update. */
+typedef struct {
+  /** The original prefix cache prefix (Po) */
+  PC_Prefix* pcPrefix_Po;
+  /** The update to be validated */
+  PC_Update* pcUpdate;
+  /** The AS of Po that remembers the matching ROAs. */
+  PC_AS*     pcAS;
+  /** The AS number of the update. */
+  uint32_t   as;
+  /** Indicates if the prefix of the update was newly installed in the prefix
+   * cache tree. */
+  bool       isNew;
+} PC_CoverageLookup;
+
 /**
- * This is a subroutine of performUpdateValidation used determine which ROAs
- * might cover the update.
- *
- * @param pcPrefix_Po The original prefix cache prefix (Po)
- * @param pcPrefix The current prefix to be checked
- * @param pcUpdate The update to be validated
- * @param as The AS number of the update.
- * @param isNew Indicates if the prefix of this update was newly installed in
- *              the prefix cache tree.
+ * This is a subroutine of performUpdateValidation, it is called by the ROA
+ * index for each ROA whose prefix covers the prefix of the update.
  *
- * @return false in case an internal error occurred.
+ * @param entry The ROA index entry, the data is the PC_ROA.
+ * @param user The PC_CoverageLookup.
  */
 static void _performUpdateValidation_PrefixIsCovereByAROA (
-                                   PC_Prefix* pcPrefix_Po, PC_Prefix* pcPrefix,
-                                   PC_Update* pcUpdate, uint32_t as, bool isNew)
+                                               ROAIndexEntry* entry, void* user)
 {
-  SListNode* asListNode;
-  SListNode* roaListNode;
+  PC_CoverageLookup* lookup = (PC_CoverageLookup*)user;
+  PC_ROA*            pcROA  = (PC_ROA*)entry->data;
 
-  PC_AS*  pcAS;
-  PC_ROA* pcROA;
-
-  FOREACH_SLIST(&pcPrefix->asn, asListNode)
+  // Does ROA cover PO
+  if (lookup->pcPrefix_Po->treeNode->prefix->bitlen <= entry->maxLen)
   {
-    pcAS = (PC_AS*)asListNode->data;
-
-    // Could be added for optimization, leave it out at this point.
-    // if (!isNew && pcAS->asn != as)
-    // {
-    //   continue;
-    // }
-
-    // AS number matches, does prefix also cover this one?
-    FOREACH_SLIST(&pcAS->roas, roaListNode)
+    // prefix covers update
+    if (lookup->isNew)
     {
-      pcROA = (PC_ROA*)roaListNode->data;
-
-      // Does ROA cover PO
-      if (pcPrefix_Po->treeNode->prefix->bitlen <= pcROA->max_len)
-      {
-        // prefix covers update
-        if (isNew)
-        {
-          // NEW prefix, increase the Po coverage. Otherwise it is increased
-          // by ROA management itself.
-          pcPrefix_Po->roa_coverage++;
-        }
-        if (pcAS->asn == as)
-        {
-          pcROA->update_count++;
-          pcUpdate->roa_match += pcROA->roa_count;
-        }
-      }
+      // NEW prefix, increase the Po coverage. Otherwise it is increased
+      // by ROA management itself.
+      lookup->pcPrefix_Po->roa_coverage++;
+    }
+    if (entry->asn == lookup->as)
+    {
+      pcROA->update_count++;
+      lookup->pcUpdate->roa_match += pcROA->roa_count;
+      appendDataToSList(&lookup->pcAS->matches, pcROA);
     }
   }
 }
@@ -814,6 +930,7 @@ static void _performUpdateValidation_PrefixIsCovereByAROA (
  *
  * @param self The instance of the prefix cache
  * @param pcUpdate The prefix cache update
+ * @param prefix The prefix of the update
  * @param as The as number of the update
  * @param isNew Indicates if the prefix was added to the prefix tree during this
  *        validation request.
@@ -821,29 +938,52 @@ static void _performUpdateValidation_PrefixIsCovereByAROA (
  */
 static bool _performUpdateValidationKnownPrefix(PrefixCache* self,
                                                 PC_Update* pcUpdate,
+                                                IPPrefix* prefix,
                                                 uint32_t as, bool isNew)
 {
   PC_Prefix* pcPrefix = (PC_Prefix*)pcUpdate->treeNode->data;
   PC_Prefix* pcPrefix_Po = pcPrefix;
   PC_AS*     pcAS = getASFromPrefix(pcPrefix, as);
+  PC_ROA*    pcROA;
+  SListNode* roaListNode;
+  PC_CoverageLookup lookup;
   pcAS->update_count++;
 
-  // P might be covered by a ROA (we don't know if NEW prefix).
-  while (   ( isNew && (pcPrefix->state_of_other == SRx_RESULT_INVALID))
-         || (!isNew && (pcPrefix->roa_coverage > 0)))
+  // P might be covered by a ROA (we don't know if NEW prefix). The ROA index
+  // returns the ROAs of P and all less specific P' at once.
+  if (   ( isNew && (pcPrefix->state_of_other == SRx_RESULT_INVALID))
+      || (!isNew && (pcPrefix->roa_coverage > 0)))
   {
-    _performUpdateValidation_PrefixIsCovereByAROA(pcPrefix_Po, pcPrefix,
-                                                  pcUpdate, as, isNew);
-
-    // (Exist less specific P' ?) => yes
-    // P := P'
-    pcPrefix = getParent(pcPrefix->treeNode);
-
-    if (pcPrefix == NULL)
+    // The RPKI handler clears the matches and changes the ROA index.
+    lockMutex(&self->matchesMutex);
+    if (!isNew && pcAS->matchesValid)
     {
-      // (Exist less specific P' ?) => No
-      break;
+      // Another update with this prefix and origin was validated before and
+      // the ROAs did not change since.
+      FOREACH_SLIST(&pcAS->matches, roaListNode)
+      {
+        pcROA = (PC_ROA*)roaListNode->data;
+        pcROA->update_count++;
+        pcUpdate->roa_match += pcROA->roa_count;
+      }
+    }
+    else
+    {
+      emptySList(&pcAS->matches);
+      lookup.pcPrefix_Po = pcPrefix_Po;
+      lookup.pcUpdate    = pcUpdate;
+      lookup.pcAS        = pcAS;
+      lookup.as          = as;
+      lookup.isNew       = isNew;
+      lookupROAIndex(&self->roaIndex, prefix,
+                     _performUpdateValidation_PrefixIsCovereByAROA, &lookup);
+      if (!pcAS->matchesValid)
+      {
+        pcAS->matchesValid = true;
+        self->matches++;
+      }
     }
+    unlockMutex(&self->matchesMutex);
   }
   return _performUpdateValidation_PrefixNotCovered(self, pcPrefix_Po,
                                                   pcUpdate);
@@ -956,7 +1096,7 @@ bool addROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
   // insert the requested prefix in the tree if it doesn't exist already.
   // Therefore the result value equals NULL can be interpreted as an internal
   // ERROR.
-  treeNode = patricia_lookup(self->prefixTree, lookupPrefix);
+  treeNode = patricia_lookup(_getPrefixTree(self, prefix), lookupPrefix);
   if (treeNode == NULL)
   {
     RAISE_ERROR("Failed to append a prefix to the prefix tree");
@@ -1037,6 +1177,8 @@ bool addROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
     pcAS->asn = originAS;
     pcAS->update_count = 0;
     initSList(&pcAS->roas);
+    initSList(&pcAS->matches);
+    pcAS->matchesValid = false;
     appendDataToSList(&pcPrefix->asn, pcAS);
   }
 
@@ -1069,6 +1211,22 @@ bool addROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
     pcROA->roa_count = 1;
     pcROA->update_count = 0;
     appendDataToSList(&pcAS->roas, pcROA);
+    lockMutex(&self->matchesMutex);
+    if (!addROAIndexEntry(&self->roaIndex, prefix, originAS, maxLen, pcROA))
+    {
+      RAISE_SYS_ERROR(HDR "Could not add the ROA white-list entry to the ROA "
+                          "index!", pthread_self());
+    }
+    _clearMatches(self, treeNode);
+    unlockMutex(&self->matchesMutex);
+  }
+  else if (pcROA->deferred_count > 0)
+  {
+    // The validation cache announced the entry again after a reset, nothing
+    // changes for the updates.
+    pcROA->deferred_count--;
+    UNLOCK_WRITE_LOCK(&self->treeLock);
+    return true;
   }
   else
   {
@@ -1383,7 +1541,7 @@ bool delROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
   // insert the requested prefix in the tree if it doesn't exist already.
   // Therefore the result value equals NULL can be interpreted as an internal
   // ERROR.
-  treeNode = patricia_lookup(self->prefixTree, lookupPrefix);
+  treeNode = patricia_lookup(_getPrefixTree(self, prefix), lookupPrefix);
   if (treeNode == NULL)
   {
     RAISE_ERROR("Failed to access the prefix tree");
@@ -1507,11 +1665,20 @@ bool delROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
   {
     RAISE_SYS_ERROR("BUG in code, ROA Count should not go below 0!");
   }
+  if (pcROA->deferred_count > pcROA->roa_count)
+  {
+    pcROA->deferred_count = pcROA->roa_count;
+  }
 
   if (pcROA->roa_count == 0)
   {
     LOG(LEVEL_DEBUG, HDR "Remove ROA entry!", pthread_self());
     deleteFromSList(&pcAS->roas, pcROA);
+    // No validation may use a match of the ROA once it is freed.
+    lockMutex(&self->matchesMutex);
+    delROAIndexEntry(&self->roaIndex, prefix, pcROA);
+    _clearMatches(self, treeNode);
+    unlockMutex(&self->matchesMutex);
     free(pcROA);
 
     if (pcAS->roas.size == 0)
@@ -1520,6 +1687,7 @@ bool delROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
       {
         LOG(LEVEL_DEBUG, HDR "Remove AS from prefix!", pthread_self());
         deleteFromSList(&pcPrefix->asn, pcAS);
+        releaseSList(&pcAS->matches);
         free(pcAS);
 
         if (pcPrefix->asn.size == 0)
@@ -1699,45 +1867,180 @@ static void _delROAwl_moveToOther(UpdateCache* updateCache, PC_Prefix* pcPrefix,
 }
 
 /**
- * Remove all ROA whitelist entries from the given validation cache with the
- * given session id value. Used for giving up a cache, executing a cache reset
- * or session id change.
+ * Copy the prefix of the patricia tree into the IPPrefix.
  *
- * NOT IMPLEMENTED PRIOR VERSION 0.3
+ * @param from The prefix of the patricia tree.
+ * @param to The IPPrefix to be filled.
  *
+ * @since 0.6.3.0
+ */
+static void _prefix_tToIPPrefix(prefix_t* from, IPPrefix* to)
+{
+  memset(to, 0, sizeof(IPPrefix));
+  to->length = from->bitlen;
+  if (from->family == AF_INET)
+  {
+    to->ip.version         = 4;
+    to->ip.addr.v4.in_addr = from->add.sin;
+  }
+  else
+  {
+    to->ip.version = 6;
+    memcpy(&to->ip.addr.v6.in_addr, &from->add.sin6, sizeof(IPv6Address));
+  }
+}
+
+/**
+ * Remove all ROA white-list entries from the given validation cache. Used for 
+ * giving up a cache or to complete a cache reset or session id change. In the
+ * later case only the entries flagged by flagAllROAwl and not announced again
+ * are removed. Entries of other validation caches are not touched, updates
+ * covered by them keep their validation state.
+ * 
  * @param self The prefix cache instance
- * @param session_id the session_id of this session
+ * @param session_id the session id of this session
  * @param valCacheID the validation cache ID
  * @param deferredOnly clean only the deferred ROA's
- *
- * @return the number of ROA whitelist entries to be removed.
+ * @param suppressNotification Allows to suppress the update modification
+ *                             callback, the changes are added to the RPKI 
+ *                             queue instead.
+ * 
+ * @return the number of ROA white-list entries removed.
  */
 int cleanAllROAwl(PrefixCache* self, uint32_t session_id, uint32_t valCacheID,
-                  bool deferredOnly)
+                  bool deferredOnly, bool suppressNotification)
 {
-  RAISE_ERROR("NOT IMPLEMENTED PRIOR VERSION 0.3");
-  // Go top down and remove all existing ROA.s
-  return true;
+  patricia_node_t* treeNode;
+  PC_Prefix*       pcPrefix;
+  PC_AS*           pcAS;
+  PC_ROA*          pcROA;
+  SListNode*       asListNode;
+  SListNode*       roaListNode;
+  SListNode*       staleListNode;
+  PC_StaleROA*     stale;
+  SList            staleList;
+  uint16_t         count;
+  int              removed = 0;
+  int              idx;
+
+  // delROAwl modifies the tree, collect the entries first.
+  initSList(&staleList);
+  WRITE_LOCK(&self->treeLock);
+  for (idx = 0; idx < PC_NO_TREES; idx++)
+  {
+    PATRICIA_WALK(self->prefixTree[idx]->head, treeNode)
+    {
+      pcPrefix = PATRICIA_DATA_GET(treeNode, PC_Prefix);
+      if (pcPrefix != NULL)
+      {
+        FOREACH_SLIST(&pcPrefix->asn, asListNode)
+        {
+          pcAS = (PC_AS*)getDataOfSListNode(asListNode);
+          FOREACH_SLIST(&pcAS->roas, roaListNode)
+          {
+            pcROA = (PC_ROA*)getDataOfSListNode(roaListNode);
+            if (pcROA->valCacheID != valCacheID)
+            {
+              continue;
+            }
+            count = deferredOnly ? pcROA->deferred_count : pcROA->roa_count;
+            pcROA->deferred_count = 0;
+            if (count > 0)
+            {
+              stale = appendToSList(&staleList, sizeof(PC_StaleROA));
+              if (stale == NULL)
+              {
+                RAISE_ERROR("Not enough memory to remove the ROA white-list "
+                            "entries of validation cache %u!", valCacheID);
+                continue;
+              }
+              _prefix_tToIPPrefix(treeNode->prefix, &stale->prefix);
+              stale->as     = pcROA->as;
+              stale->maxLen = pcROA->max_len;
+              stale->count  = count;
+            }
+          }
+        }
+      }
+    } PATRICIA_WALK_END;
+  }
+  UNLOCK_WRITE_LOCK(&self->treeLock);
+
+  FOREACH_SLIST(&staleList, staleListNode)
+  {
+    stale = (PC_StaleROA*)getDataOfSListNode(staleListNode);
+    for (; stale->count > 0; stale->count--)
+    {
+      if (delROAwl(self, stale->as, &stale->prefix, stale->maxLen, session_id,
+                   valCacheID, suppressNotification))
+      {
+        removed++;
+      }
+    }
+  }
+  releaseSList(&staleList);
+
+  LOG(LEVEL_DEBUG, HDR "Removed %d ROA white-list entries of validation cache "
+                   "%u", pthread_self(), removed, valCacheID);
+
+  return removed;
 }
 
 /**
- * Flag all ROA whitelist entries of the given validation cache with the given
- * session id value. This is used in case a session id value switch occurred and
- * the state of ROA white-list entries gets rebuild.
- *
- * NOT IMPLEMENTED PRIOR VERSION 0.4
+ * Flag all ROA white-list entries of the given validation cache as deferred.
+ * This is used in case the validation cache resets the session and the state 
+ * of the ROA white-list entries gets rebuild. An announcement of a deferred
+ * entry confirms it without any change of the validation state. Once the 
+ * validation cache is synchronized again, cleanAllROAwl removes the entries 
+ * that were not confirmed.
  *
  * @param self The validation cache
  * @param sessionID the session id whose values have to be flagged.
  * @param valCacheID The validation cache ID.
- *
- * @return The number of ROA white-list entries to be flagged.
+ * 
+ * @return The number of ROA white-list entries flagged.
  */
 int flagAllROAwl(PrefixCache* self, uint32_t sessionID, uint32_t valCacheID)
 {
-  RAISE_ERROR("NOT IMPLEMENTED PRIOR VERSION 0.4");
-  // Flag it by setting the defferedCount to ROA-count.
-  return true;
+  patricia_node_t* treeNode;
+  PC_Prefix*       pcPrefix;
+  PC_AS*           pcAS;
+  PC_ROA*          pcROA;
+  SListNode*       asListNode;
+  SListNode*       roaListNode;
+  int              flagged = 0;
+  int              idx;
+
+  WRITE_LOCK(&self->treeLock);
+  for (idx = 0; idx < PC_NO_TREES; idx++)
+  {
+    PATRICIA_WALK(self->prefixTree[idx]->head, treeNode)
+    {
+      pcPrefix = PATRICIA_DATA_GET(treeNode, PC_Prefix);
+      if (pcPrefix != NULL)
+      {
+        FOREACH_SLIST(&pcPrefix->asn, asListNode)
+        {
+          pcAS = (PC_AS*)getDataOfSListNode(asListNode);
+          FOREACH_SLIST(&pcAS->roas, roaListNode)
+          {
+            pcROA = (PC_ROA*)getDataOfSListNode(roaListNode);
+            if (pcROA->valCacheID == valCacheID)
+            {
+              pcROA->deferred_count = pcROA->roa_count;
+              flagged += pcROA->roa_count;
+            }
+          }
+        }
+      }
+    } PATRICIA_WALK_END;
+  }
+  UNLOCK_WRITE_LOCK(&self->treeLock);
+
+  LOG(LEVEL_DEBUG, HDR "Flagged %d ROA white-list entries of validation cache "
+                   "%u", pthread_self(), flagged, valCacheID);
+
+  return flagged;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1934,14 +2237,18 @@ void outputPrefixCacheAsXML(PrefixCache* self, FILE* stream)
   XMLOut      out;
   SListNode*  updateListNode;
   PC_Update*  pcUpdate;
+  int         idx;
 
   initXMLOut(&out, stream);
   openTag(&out, "prefix-cache");
 
-  // Tree
-  if (self->prefixTree->head != NULL)
+  // Trees
+  for (idx = 0; idx < PC_NO_TREES; idx++)
   {
-    outputPrefix(&out, self->prefixTree->head);
+    if (self->prefixTree[idx]->head != NULL)
+    {
+      outputPrefix(&out, self->prefixTree[idx]->head);
+    }
   }
 
   // Updates
@@ -2036,3 +2343,76 @@ static void notifyUpdateCacheForROAChange(UpdateCache* updCache,
   }
 }
 
+/**
+ * Write the ROA white-list into the SNAP_SEC_ROA section of the snapshot. 
+ * Identical ROA white-list entries are written once with their count.
+ *
+ * @param self The prefix cache.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool writePrefixCacheSnapshot(PrefixCache* self, SnapshotWriter* writer)
+{
+  patricia_node_t*  treeNode;
+  PC_Prefix*        pcPrefix;
+  PC_AS*            pcAS;
+  PC_ROA*           pcROA;
+  SListNode*        asListNode;
+  SListNode*        roaListNode;
+  SnapshotROARecord record;
+  uint32_t          count  = 0;
+  int               idx;
+  bool              retVal = beginSnapshotSection(writer, SNAP_SEC_ROA);
+
+  memset(&record, 0, sizeof(SnapshotROARecord));
+  READ_LOCK(&self->treeLock);
+  for (idx = 0; retVal && (idx < PC_NO_TREES); idx++)
+  {
+    PATRICIA_WALK(self->prefixTree[idx]->head, treeNode)
+    {
+      pcPrefix = PATRICIA_DATA_GET(treeNode, PC_Prefix);
+      // Internal trie nodes do not carry data, PATRICIA_WALK does not allow
+      // to continue.
+      if (pcPrefix != NULL)
+      {
+        record.prefix.ipVersion = treeNode->prefix->family == AF_INET ? 4 : 6;
+        record.prefix.length    = treeNode->prefix->bitlen;
+        if (treeNode->prefix->family == AF_INET)
+        {
+          memcpy(record.prefix.addr, &treeNode->prefix->add.sin, 
+                 sizeof(struct in_addr));
+        }
+        else
+        {
+          memcpy(record.prefix.addr, &treeNode->prefix->add.sin6, 
+                 sizeof(struct in6_addr));
+        }
+
+        FOREACH_SLIST(&pcPrefix->asn, asListNode)
+        {
+          pcAS = (PC_AS*)getDataOfSListNode(asListNode);
+          FOREACH_SLIST(&pcAS->roas, roaListNode)
+          {
+            pcROA = (PC_ROA*)getDataOfSListNode(roaListNode);
+            if (retVal && (pcROA->roa_count > 0))
+            {
+              record.valCacheID = pcROA->valCacheID;
+              record.originAS   = pcROA->as;
+              record.count      = pcROA->roa_count;
+              record.maxLen     = pcROA->max_len;
+              retVal = addSnapshotData(writer, &record, 
+                                       sizeof(SnapshotROARecord));
+              count++;
+            }
+          }
+        }
+      }
+    } PATRICIA_WALK_END;
+  }
+  UNLOCK_READ_LOCK(&self->treeLock);
+
+  return retVal && endSnapshotSection(writer, count);
+}
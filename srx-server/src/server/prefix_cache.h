@@ -60,6 +60,8 @@
 #define HAVE_IPV6
 #include <patricia.h>
  
+#include "server/roa_index.h"
+#include "server/snapshot.h"
 #include "server/update_cache.h"
 #include "shared/srx_defs.h"
 #include "util/mutex.h"
@@ -67,6 +69,13 @@
 #include "util/rwlock.h"
 #include "util/slist.h"
 
+/** The index of the IPv4 prefix tree */
+#define PC_TREE_V4       0
+/** The index of the IPv6 prefix tree */
+#define PC_TREE_V6       1
+/** The number of prefix trees */
+#define PC_NO_TREES      2
+
 /** Do call the update change callback */
 #define PC_DONT_SUPPRESS false
 /** Do not call the update change callback */
@@ -77,12 +86,25 @@
  */
 typedef struct {
   UpdateCache*      updateCache;
-  patricia_tree_t*  prefixTree;
+  /** The prefix trees, PC_TREE_V4 and PC_TREE_V6. The families are kept in 
+   * separate trees, the patricia tree does not distinguish an IPv4 prefix from
+   * an IPv6 prefix with the same bits. */
+  patricia_tree_t*  prefixTree[PC_NO_TREES];
+  /** All ROA white-list entries of the prefix tree for the lookup of the ROAs
+   * covering a prefix. Protected by the treeLock. */
+  ROAIndex          roaIndex;
+  /** The number of PC_AS instances with valid remembered ROA matches. 
+   * Protected by the matchesMutex. */
+  uint32_t          matches;
   // This list is not really needed!
   SList             updates;
  
   // Access control variables
   Mutex             updatesMutex;
+  /** Serializes the remembered ROA matches (PC_AS::matches) and the ROA index
+   * between the validation of updates and the ROA changes of the RPKI 
+   * handler. Other than the locks below this mutex is always used. */
+  Mutex             matchesMutex;
   RWLock            treeLock;
   RWLock            otherLock;
   RWLock            validLock;
@@ -137,6 +159,12 @@ typedef struct {
   /** The number of updates announced by to this as. (only for the prefix this 
    * instance is attached to/ */
   uint32_t update_count;
+  /** The ROAs of this AS that cover the prefix, remembered by the validation
+   * of the first update with this prefix and origin. It is only used if
+   * matchesValid is set and cleared if a ROA of the prefix or a less specific
+   * prefix is created or removed. Protected by PrefixCache::matchesMutex.*/
+  SList    matches;
+  bool     matchesValid;
 } PC_AS;
 
 typedef struct {
@@ -247,34 +275,38 @@ bool delROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
               bool suppressNotification);
 
 /**
- * Remove all ROA whitelist entries from the given validation cache with the 
- * given session id value. Used for giving up a cache, executing a cache reset
- * or session id change.
- * 
- * NOT IMPLEMENTED PRIOR VERSION 0.4
+ * Remove all ROA white-list entries from the given validation cache. Used for 
+ * giving up a cache or to complete a cache reset or session id change. In the
+ * later case only the entries flagged by flagAllROAwl and not announced again
+ * are removed. Entries of other validation caches are not touched, updates
+ * covered by them keep their validation state.
  * 
  * @param self The prefix cache instance
  * @param session_id the session id of this session
  * @param valCacheID the validation cache ID
  * @param deferredOnly clean only the deferred ROA's
+ * @param suppressNotification Allows to suppress the update modification
+ *                             callback, the changes are added to the RPKI 
+ *                             queue instead.
  * 
- * @return the number of ROA white-list entries to be removed.
+ * @return the number of ROA white-list entries removed.
  */
 int cleanAllROAwl(PrefixCache* self, uint32_t session_id, uint32_t valCacheID,
-                  bool deferredOnly);
+                  bool deferredOnly, bool suppressNotification);
 
 /**
- * Flag all ROA white-list entries of the given validation cache with the given 
- * session id value. This is used in case a session id value switch occurred and
- * the state of ROA white-list entries gets rebuild.
+ * Flag all ROA white-list entries of the given validation cache as deferred.
+ * This is used in case the validation cache resets the session and the state 
+ * of the ROA white-list entries gets rebuild. An announcement of a deferred
+ * entry confirms it without any change of the validation state. Once the 
+ * validation cache is synchronized again, cleanAllROAwl removes the entries 
+ * that were not confirmed.
  *
- * NOT IMPLEMENTED PRIOR VERSION 0.4.0
- * 
  * @param self The validation cache
  * @param sessionID the session id whose values have to be flagged.
  * @param valCacheID The validation cache ID.
  * 
- * @return The number of ROA white-list entries to be flagged.
+ * @return The number of ROA white-list entries flagged.
  */
 int flagAllROAwl(PrefixCache* self, uint32_t sessionID, uint32_t valCacheID);
 
@@ -321,6 +353,19 @@ const char* ipOfPrefix_tToStr(prefix_t* prefix);
  */
 void outputPrefixCacheAsXML(PrefixCache* self, FILE* stream);
 
+/**
+ * Write the ROA white-list into the SNAP_SEC_ROA section of the snapshot. 
+ * Identical ROA white-list entries are written once with their count.
+ *
+ * @param self The prefix cache.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool writePrefixCacheSnapshot(PrefixCache* self, SnapshotWriter* writer);
+
 
 
 
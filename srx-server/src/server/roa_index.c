@@ -0,0 +1,452 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * This file contains the ROA index.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "server/roa_index.h"
+#include "util/log.h"
+
+/** The largest number of nodes from the root to an IPv6 /128. */
+#define ROA_INDEX_MAX_DEPTH ((128 / ROA_INDEX_STRIDE) + 1)
+
+/**
+ * Return the root of the address family of the given prefix.
+ *
+ * @param self The index.
+ * @param prefix The prefix.
+ *
+ * @return the root node.
+ */
+static ROAIndexNode* _getRoot(ROAIndex* self, IPPrefix* prefix)
+{
+  return prefix->ip.version == 4 ? &self->v4 : &self->v6;
+}
+
+/**
+ * Return the address bytes of the given prefix in network order.
+ *
+ * @param prefix The prefix.
+ *
+ * @return the address bytes.
+ */
+static uint8_t* _getAddress(IPPrefix* prefix)
+{
+  return prefix->ip.version == 4 ? prefix->ip.addr.v4.u8
+                                 : prefix->ip.addr.v6.u8;
+}
+
+/**
+ * Return the nibble of the address at the given node depth.
+ *
+ * @param addr The address bytes.
+ * @param depth The depth of the node.
+ *
+ * @return the nibble.
+ */
+static uint8_t _getNibble(uint8_t* addr, int depth)
+{
+  return (depth & 1) ? addr[depth >> 1] & 0xF : addr[depth >> 1] >> 4;
+}
+
+/**
+ * Return the nibble of the prefix at the given node depth. Prefixes that end
+ * at the start of the node have the nibble 0, this also prevents reading
+ * beyond the address of a full length prefix.
+ *
+ * @param addr The address bytes.
+ * @param prefix The prefix.
+ * @param depth The depth of the node.
+ *
+ * @return the nibble.
+ */
+static uint8_t _getNodeNibble(uint8_t* addr, IPPrefix* prefix, int depth)
+{
+  return prefix->length > depth * ROA_INDEX_STRIDE ? _getNibble(addr, depth)
+                                                   : 0;
+}
+
+/**
+ * Return the position of a prefix that ends the given number of bits into a
+ * node.
+ *
+ * @param nibble The nibble of the prefix at the node.
+ * @param bits The number of bits of the prefix within the node (0..3).
+ *
+ * @return the position (0..14).
+ */
+static uint8_t _getPosition(uint8_t nibble, int bits)
+{
+  return ((1 << bits) - 1) + (nibble >> (ROA_INDEX_STRIDE - bits));
+}
+
+/**
+ * Return the index of the first entry of the node at the given position or
+ * behind it.
+ *
+ * @param node The node.
+ * @param pos The position.
+ *
+ * @return the index of the entry, entryCount if no such entry exists.
+ */
+static uint32_t _findPosition(ROAIndexNode* node, uint8_t pos)
+{
+  uint32_t low  = 0;
+  uint32_t high = node->entryCount;
+  uint32_t mid;
+
+  while (low < high)
+  {
+    mid = (low + high) / 2;
+    if (node->entries[mid].pos < pos)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/**
+ * Return the index of the child with the given nibble within the children.
+ *
+ * @param node The node.
+ * @param nibble The nibble of the child.
+ *
+ * @return the index of the child.
+ */
+static int _getChildIndex(ROAIndexNode* node, uint8_t nibble)
+{
+  return __builtin_popcount(node->childMap & ((1 << nibble) - 1));
+}
+
+/**
+ * Return the child with the given nibble. The child is created if it does not
+ * exist.
+ *
+ * @param self The index.
+ * @param node The node.
+ * @param nibble The nibble of the child.
+ *
+ * @return the child or NULL if not enough memory is available.
+ */
+static ROAIndexNode* _getOrAddChild(ROAIndex* self, ROAIndexNode* node,
+                                    uint8_t nibble)
+{
+  int idx = _getChildIndex(node, nibble);
+
+  if ((node->childMap & (1 << nibble)) == 0)
+  {
+    int count = __builtin_popcount(node->childMap);
+    ROAIndexNode* children = realloc(node->children,
+                                     (count + 1) * sizeof(ROAIndexNode));
+    if (children == NULL)
+    {
+      return NULL;
+    }
+    memmove(&children[idx + 1], &children[idx],
+            (count - idx) * sizeof(ROAIndexNode));
+    memset(&children[idx], 0, sizeof(ROAIndexNode));
+    node->children  = children;
+    node->childMap |= (1 << nibble);
+    self->nodes++;
+  }
+
+  return &node->children[idx];
+}
+
+/**
+ * Remove the child with the given nibble. The child must not have entries or
+ * children.
+ *
+ * @param self The index.
+ * @param node The node.
+ * @param nibble The nibble of the child.
+ */
+static void _removeChild(ROAIndex* self, ROAIndexNode* node, uint8_t nibble)
+{
+  int idx   = _getChildIndex(node, nibble);
+  int count = __builtin_popcount(node->childMap);
+
+  memmove(&node->children[idx], &node->children[idx + 1],
+          (count - idx - 1) * sizeof(ROAIndexNode));
+  node->childMap &= ~(1 << nibble);
+  if (node->childMap == 0)
+  {
+    free(node->children);
+    node->children = NULL;
+  }
+  self->nodes--;
+}
+
+/**
+ * Free the children and entries of the given node.
+ *
+ * @param node The node.
+ */
+static void _releaseNode(ROAIndexNode* node)
+{
+  int count = __builtin_popcount(node->childMap);
+  int idx;
+
+  for (idx = 0; idx < count; idx++)
+  {
+    _releaseNode(&node->children[idx]);
+  }
+  free(node->children);
+  free(node->entries);
+  memset(node, 0, sizeof(ROAIndexNode));
+}
+
+/**
+ * Initialize an empty index.
+ *
+ * @param self The index.
+ *
+ * @since 0.6.3.0
+ */
+void initializeROAIndex(ROAIndex* self)
+{
+  memset(self, 0, sizeof(ROAIndex));
+}
+
+/**
+ * Free all memory of the index. Afterwards the index is empty and can be
+ * used again.
+ *
+ * @param self The index.
+ *
+ * @since 0.6.3.0
+ */
+void releaseROAIndex(ROAIndex* self)
+{
+  _releaseNode(&self->v4);
+  _releaseNode(&self->v6);
+  self->entries = 0;
+  self->nodes   = 0;
+}
+
+/**
+ * Add the given ROA white-list entry.
+ *
+ * @param self The index.
+ * @param prefix The prefix of the ROA.
+ * @param asn The origin AS of the ROA.
+ * @param maxLen The max length of the ROA.
+ * @param data The data of the entry, used to remove it again.
+ *
+ * @return false if not enough memory is available.
+ *
+ * @since 0.6.3.0
+ */
+bool addROAIndexEntry(ROAIndex* self, IPPrefix* prefix, uint32_t asn,
+                      uint8_t maxLen, void* data)
+{
+  ROAIndexNode*  node = _getRoot(self, prefix);
+  uint8_t*       addr = _getAddress(prefix);
+  ROAIndexEntry* entries;
+  uint8_t        pos;
+  int depth = 0;
+  int idx;
+
+  while (prefix->length - (depth * ROA_INDEX_STRIDE) >= ROA_INDEX_STRIDE)
+  {
+    node = _getOrAddChild(self, node, _getNibble(addr, depth));
+    if (node == NULL)
+    {
+      RAISE_SYS_ERROR("Not enough memory to add a node to the ROA index!");
+      return false;
+    }
+    depth++;
+  }
+
+  entries = realloc(node->entries,
+                    (node->entryCount + 1) * sizeof(ROAIndexEntry));
+  if (entries == NULL)
+  {
+    RAISE_SYS_ERROR("Not enough memory to add an entry to the ROA index!");
+    return false;
+  }
+  node->entries = entries;
+
+  pos = _getPosition(_getNodeNibble(addr, prefix, depth),
+                     prefix->length - (depth * ROA_INDEX_STRIDE));
+  // Keep the entries ordered by their position.
+  for (idx = node->entryCount; idx > 0 && entries[idx - 1].pos > pos; idx--)
+  {
+    entries[idx] = entries[idx - 1];
+  }
+  entries[idx].asn      = asn;
+  entries[idx].length   = prefix->length;
+  entries[idx].maxLen   = maxLen;
+  entries[idx].pos      = pos;
+  entries[idx].reserved = 0;
+  entries[idx].data     = data;
+  node->entryCount++;
+  node->prefixMap |= (1 << pos);
+  self->entries++;
+
+  return true;
+}
+
+/**
+ * Remove the entry with the given prefix and data.
+ *
+ * @param self The index.
+ * @param prefix The prefix of the ROA.
+ * @param data The data the entry was added with.
+ *
+ * @return false if the entry does not exist.
+ *
+ * @since 0.6.3.0
+ */
+bool delROAIndexEntry(ROAIndex* self, IPPrefix* prefix, void* data)
+{
+  ROAIndexNode* path[ROA_INDEX_MAX_DEPTH];
+  ROAIndexNode* node = _getRoot(self, prefix);
+  uint8_t*      addr = _getAddress(prefix);
+  uint8_t       nibble, pos;
+  bool          samePos = false;
+  int depth = 0;
+  int idx, found;
+
+  while (prefix->length - (depth * ROA_INDEX_STRIDE) >= ROA_INDEX_STRIDE)
+  {
+    nibble = _getNibble(addr, depth);
+    if ((node->childMap & (1 << nibble)) == 0)
+    {
+      return false;
+    }
+    path[depth++] = node;
+    node = &node->children[_getChildIndex(node, nibble)];
+  }
+
+  pos   = _getPosition(_getNodeNibble(addr, prefix, depth),
+                       prefix->length - (depth * ROA_INDEX_STRIDE));
+  found = -1;
+  for (idx = _findPosition(node, pos);
+       idx < node->entryCount && node->entries[idx].pos == pos; idx++)
+  {
+    if (node->entries[idx].data == data)
+    {
+      found = idx;
+    }
+    else
+    {
+      samePos = true;
+    }
+  }
+  if (found < 0)
+  {
+    return false;
+  }
+
+  node->entryCount--;
+  memmove(&node->entries[found], &node->entries[found + 1],
+          (node->entryCount - found) * sizeof(ROAIndexEntry));
+  if (!samePos)
+  {
+    node->prefixMap &= ~(1 << pos);
+  }
+  if (node->entryCount == 0)
+  {
+    free(node->entries);
+    node->entries = NULL;
+  }
+  self->entries--;
+
+  // Remove the nodes that became empty, the roots stay.
+  while (depth > 0 && node->entryCount == 0 && node->childMap == 0)
+  {
+    depth--;
+    _removeChild(self, path[depth], _getNibble(addr, depth));
+    node = path[depth];
+  }
+
+  return true;
+}
+
+/**
+ * Call the given function for each entry whose prefix covers the given
+ * prefix. The entries are reported from the least to the most specific. The
+ * max length is not considered.
+ *
+ * @param self The index.
+ * @param prefix The prefix to look up.
+ * @param match The function called for each covering entry, can be NULL.
+ * @param user The user data handed to the function.
+ *
+ * @return the number of covering entries.
+ *
+ * @since 0.6.3.0
+ */
+uint32_t lookupROAIndex(ROAIndex* self, IPPrefix* prefix, ROAIndexMatch match,
+                        void* user)
+{
+  ROAIndexNode* node  = _getRoot(self, prefix);
+  uint8_t*      addr  = _getAddress(prefix);
+  uint32_t      count = 0;
+  uint8_t       nibble, pos;
+  uint32_t      idx;
+  int depth = 0;
+  int remaining, bits;
+
+  while (true)
+  {
+    remaining = prefix->length - (depth * ROA_INDEX_STRIDE);
+    nibble    = _getNodeNibble(addr, prefix, depth);
+
+    // The positions of the prefixes within this node that cover the prefix,
+    // the less specific prefixes have the lower positions.
+    for (bits = 0; bits < ROA_INDEX_STRIDE && bits <= remaining; bits++)
+    {
+      pos = _getPosition(nibble, bits);
+      if ((node->prefixMap & (1 << pos)) != 0)
+      {
+        for (idx = _findPosition(node, pos);
+             idx < node->entryCount && node->entries[idx].pos == pos; idx++)
+        {
+          count++;
+          if (match != NULL)
+          {
+            match(&node->entries[idx], user);
+          }
+        }
+      }
+    }
+
+    if (remaining < ROA_INDEX_STRIDE || (node->childMap & (1 << nibble)) == 0)
+    {
+      break;
+    }
+    node = &node->children[_getChildIndex(node, nibble)];
+    depth++;
+  }
+
+  return count;
+}
@@ -0,0 +1,170 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * This file contains the ROA index. It answers which ROA white-list entries
+ * cover a given prefix. The prefix cache keeps its patricia tree for the
+ * updates and the maintenance of the ROA white-list, the index is the read
+ * side of the origin validation.
+ *
+ * The index is a multibit trie with a stride of 4 bits per node, one for IPv4
+ * and one for IPv6. Each node keeps a bitmap of the prefixes that end within
+ * its 4 bits and a bitmap of its children. The children of a node are stored
+ * in one array ordered by their nibble, the entries of a node in one array
+ * ordered by their position. A lookup of an IPv4 /24 visits at most 7 nodes
+ * and reads the entries only of nodes whose bitmap matches.
+ *
+ * The index does not lock, the caller protects it.
+ *
+ * @version 0.6.3.0
+ */
+#ifndef __ROA_INDEX_H__
+#define __ROA_INDEX_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "util/prefix.h"
+
+/** The number of prefix bits of each node. */
+#define ROA_INDEX_STRIDE 4
+
+/**
+ * A ROA white-list entry within the index.
+ */
+typedef struct {
+  /** The origin AS. */
+  uint32_t asn;
+  /** The length of the ROA prefix. */
+  uint8_t  length;
+  /** The max length of the ROA. */
+  uint8_t  maxLen;
+  /** The position of the prefix within the node (see prefixMap). */
+  uint8_t  pos;
+  uint8_t  reserved;
+  /** The data of the entry, must be unique per prefix. */
+  void*    data;
+} ROAIndexEntry;
+
+/**
+ * A node of the index. It covers ROA_INDEX_STRIDE bits of the prefix.
+ */
+typedef struct _ROAIndexNode {
+  /** Bit ((1 << l) - 1 + b) is set if entries exist that end l bits into
+   * this node with the bits b. */
+  uint16_t              prefixMap;
+  /** Bit n is set if a child for the nibble n exists. */
+  uint16_t              childMap;
+  /** The number of entries of this node. */
+  uint32_t              entryCount;
+  /** The children ordered by their nibble. */
+  struct _ROAIndexNode* children;
+  /** The entries ordered by their position. */
+  ROAIndexEntry*        entries;
+} ROAIndexNode;
+
+/**
+ * The ROA index.
+ */
+typedef struct {
+  /** The root of the IPv4 prefixes. */
+  ROAIndexNode v4;
+  /** The root of the IPv6 prefixes. */
+  ROAIndexNode v6;
+  /** The number of entries. */
+  uint32_t     entries;
+  /** The number of nodes without the roots. */
+  uint32_t     nodes;
+} ROAIndex;
+
+/**
+ * Called for each entry that covers the prefix of a lookup.
+ *
+ * @param entry The covering entry.
+ * @param user The user data handed to the lookup.
+ */
+typedef void (*ROAIndexMatch)(ROAIndexEntry* entry, void* user);
+
+/**
+ * Initialize an empty index.
+ *
+ * @param self The index.
+ *
+ * @since 0.6.3.0
+ */
+void initializeROAIndex(ROAIndex* self);
+
+/**
+ * Free all memory of the index. Afterwards the index is empty and can be
+ * used again.
+ *
+ * @param self The index.
+ *
+ * @since 0.6.3.0
+ */
+void releaseROAIndex(ROAIndex* self);
+
+/**
+ * Add the given ROA white-list entry.
+ *
+ * @param self The index.
+ * @param prefix The prefix of the ROA.
+ * @param asn The origin AS of the ROA.
+ * @param maxLen The max length of the ROA.
+ * @param data The data of the entry, used to remove it again.
+ *
+ * @return false if not enough memory is available.
+ *
+ * @since 0.6.3.0
+ */
+bool addROAIndexEntry(ROAIndex* self, IPPrefix* prefix, uint32_t asn,
+                      uint8_t maxLen, void* data);
+
+/**
+ * Remove the entry with the given prefix and data.
+ *
+ * @param self The index.
+ * @param prefix The prefix of the ROA.
+ * @param data The data the entry was added with.
+ *
+ * @return false if the entry does not exist.
+ *
+ * @since 0.6.3.0
+ */
+bool delROAIndexEntry(ROAIndex* self, IPPrefix* prefix, void* data);
+
+/**
+ * Call the given function for each entry whose prefix covers the given
+ * prefix. The entries are reported from the least to the most specific. The
+ * max length is not considered.
+ *
+ * @param self The index.
+ * @param prefix The prefix to look up.
+ * @param match The function called for each covering entry, can be NULL.
+ * @param user The user data handed to the function.
+ *
+ * @return the number of covering entries.
+ *
+ * @since 0.6.3.0
+ */
+uint32_t lookupROAIndex(ROAIndex* self, IPPrefix* prefix, ROAIndexMatch match,
+                        void* user);
+
+#endif // __ROA_INDEX_H__
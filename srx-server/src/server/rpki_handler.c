@@ -82,6 +82,7 @@
  * -----------------------------------------------------------------------------
  */
 
+#include <time.h>
 #include <srx/srxcryptoapi.h>
 #include "server/main.h"
 #include "server/rpki_handler.h"
@@ -91,6 +92,7 @@
 #include "shared/rpki_router.h"
 #include "util/log.h"
 #include "server/aspa_trie.h"
+#include "server/metrics.h"
 
 ///////////////////
 // Constants
@@ -110,6 +112,9 @@
  * This might be removed in the future. */
 #define NO_AFI 0
 
+/** The size of the error message send to the validation cache. */
+#define ERR_MSG_SIZE 256
+
 ////////////////////////////////////////////////////////////////////////////////
 // forward declaration
 ////////////////////////////////////////////////////////////////////////////////
@@ -129,50 +134,711 @@ static void handleAspaPdu (uint32_t valCacheID, uint16_t session_id,
                            bool isAnn, uint32_t customerAsn, 
                            uint16_t providerAsCount, uint32_t* providerAsns, 
                            void* rpkiHandler);
+static void _processRouterKey(RPKIHandler* handler, uint32_t valCacheID, 
+                              bool isAnn, uint32_t asn, const char* ski,
+                              const char* keyInfo);
+static void _registerPendingKeys(RPKIHandler* handler, uint32_t valCacheID);
+static void _processAspa(RPKIHandler* handler, uint32_t valCacheID, 
+                         bool isAnn, uint32_t customerAsn, 
+                         uint16_t providerAsCount, uint32_t* providerAsns,
+                         char* errMsg);
+
+/**
+ * Return the session of the given validation cache.
+ *
+ * @param handler The RPKI handler.
+ * @param valCacheID The ID of the validation cache.
+ *
+ * @return the session or NULL if the ID is unknown.
+ *
+ * @since 0.6.3.0
+ */
+static RPKICacheSession* _getSession(RPKIHandler* handler, uint32_t valCacheID)
+{
+  if ((valCacheID == 0) || (valCacheID > handler->noSessions))
+  {
+    return NULL;
+  }
+  return &handler->sessions[valCacheID - 1];
+}
+
+/**
+ * Return the ASPA object reference of the validation cache.
+ *
+ * @param handler The RPKI handler.
+ * @param valCacheID The ID of the validation cache or 0 for any cache.
+ * @param customerAsn The customer AS of the ASPA object.
+ *
+ * @return the reference or NULL.
+ *
+ * @since 0.6.3.0
+ */
+static RPKIASPARef* _findASPARef(RPKIHandler* handler, uint32_t valCacheID,
+                                 uint32_t customerAsn)
+{
+  RPKIASPARef* ref;
+  SListNode*   listNode;
+
+  FOREACH_SLIST(&handler->aspaRefs, listNode)
+  {
+    ref = (RPKIASPARef*)getDataOfSListNode(listNode);
+    if (   (ref->customerAsn == customerAsn)
+        && ((valCacheID == 0) || (ref->valCacheID == valCacheID)))
+    {
+      return ref;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Store the providers the validation cache announced with the ASPA object.
+ *
+ * @param ref The ASPA object reference of the validation cache.
+ * @param providerAsCount Number of providers in the providersAsns list.
+ * @param providerAsns The list of provider ASNs
+ *
+ * @return false if not enough memory was available.
+ *
+ * @since 0.6.3.0
+ */
+static bool _setASPARefProviders(RPKIASPARef* ref, uint16_t providerAsCount, 
+                                 const uint32_t* providerAsns)
+{
+  uint32_t* providers = malloc(providerAsCount * sizeof(uint32_t));
+
+  if (providers == NULL)
+  {
+    return false;
+  }
+  memcpy(providers, providerAsns, providerAsCount * sizeof(uint32_t));
+  free(ref->providerAsns);
+  ref->providerAsns    = providers;
+  ref->providerAsCount = providerAsCount;
+
+  return true;
+}
 
 /**
- * Configure the RPKI Handler and create an RPKIRouter client.
+ * Remove the ASPA object reference of the validation cache and free it.
+ *
+ * @param handler The RPKI handler.
+ * @param ref The ASPA object reference.
+ *
+ * @since 0.6.3.0
+ */
+static void _deleteASPARef(RPKIHandler* handler, RPKIASPARef* ref)
+{
+  deleteFromSList(&handler->aspaRefs, ref);
+  free(ref->providerAsns);
+  free(ref);
+}
+
+/**
+ * Store the ASPA object of the customer AS in the ASPA database. The object
+ * carries the providers of all validation caches that announce it, this way 
+ * the object only contains providers that are still announced once a cache 
+ * withdraws its object. The object is removed if no cache announces it 
+ * anymore. The caller MUST hold the snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param customerAsn The ASN of the customer
+ *
+ * @return false if the object could not be stored or removed.
+ *
+ * @since 0.6.3.0
+ */
+static bool _installAspa(RPKIHandler* handler, uint32_t customerAsn)
+{
+  RPKIASPARef* ref;
+  SListNode*   listNode;
+  ASPA_Object* aspaObj;
+  uint32_t*    providers;
+  uint32_t     noProviders = 0;
+  uint32_t     maxProviders = 0;
+  uint32_t     idx;
+  uint32_t     pIdx;
+  bool         found = false;
+  char         strWord[12];
+
+  sprintf(strWord, "%u", customerAsn);
+  FOREACH_SLIST(&handler->aspaRefs, listNode)
+  {
+    ref = (RPKIASPARef*)getDataOfSListNode(listNode);
+    if (ref->customerAsn == customerAsn)
+    {
+      maxProviders += ref->providerAsCount;
+      found = true;
+    }
+  }
+  if (!found)
+  {
+    return delete_TrieNode_AspaObj(handler->aspaDBManager, strWord, NULL);
+  }
+
+  providers = malloc(maxProviders * sizeof(uint32_t));
+  if (providers == NULL)
+  {
+    RAISE_SYS_ERROR("Not enough memory to merge the ASPA object of AS %u!", 
+                    customerAsn);
+    return false;
+  }
+  FOREACH_SLIST(&handler->aspaRefs, listNode)
+  {
+    ref = (RPKIASPARef*)getDataOfSListNode(listNode);
+    if (ref->customerAsn != customerAsn)
+    {
+      continue;
+    }
+    for (idx = 0; idx < ref->providerAsCount; idx++)
+    {
+      for (pIdx = 0; (pIdx < noProviders) 
+                     && (providers[pIdx] != ref->providerAsns[idx]); pIdx++) {}
+      if (pIdx == noProviders)
+      {
+        providers[noProviders++] = ref->providerAsns[idx];
+      }
+    }
+  }
+
+  aspaObj = newASPAObject(customerAsn, noProviders, providers, NO_AFI);
+  insertAspaObj(handler->aspaDBManager, strWord, strWord, aspaObj);
+  free(providers);
+
+  return true;
+}
+
+/**
+ * Flag the ROAs, ASPA objects, and router keys of the validation cache as 
+ * stale. The data announced again by the cache is confirmed without any 
+ * change of the validation results, the remaining data is removed by 
+ * _sweepSessionData. The caller MUST hold the snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param valCacheID The ID of the validation cache.
+ *
+ * @since 0.6.3.0
+ */
+static void _flagSessionData(RPKIHandler* handler, uint32_t valCacheID)
+{
+  RPKICacheSession* session = _getSession(handler, valCacheID);
+  RPKIRouterKey*    key;
+  RPKIASPARef*      ref;
+  SListNode*        listNode;
+  int               noROAs;
+
+  noROAs = flagAllROAwl(handler->prefixCache, 0, valCacheID);
+  FOREACH_SLIST(&handler->routerKeys, listNode)
+  {
+    key = (RPKIRouterKey*)getDataOfSListNode(listNode);
+    if (key->valCacheID == valCacheID)
+    {
+      key->stale = true;
+    }
+  }
+  FOREACH_SLIST(&handler->aspaRefs, listNode)
+  {
+    ref = (RPKIASPARef*)getDataOfSListNode(listNode);
+    if (ref->valCacheID == valCacheID)
+    {
+      ref->stale = true;
+    }
+  }
+  session->resetPending = true;
+
+  LOG(LEVEL_INFO, HDR "Keep %d ROAs of validation cache %u until it is "
+                  "synchronized again", pthread_self(), noROAs, valCacheID);
+}
+
+/**
+ * Remove the ROAs, ASPA objects, and router keys of the validation cache 
+ * that were flagged by _flagSessionData and not announced again. The caller 
+ * MUST hold the snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param valCacheID The ID of the validation cache.
+ * @param sessionID The session ID of the validation cache (network format).
+ *
+ * @since 0.6.3.0
+ */
+static void _sweepSessionData(RPKIHandler* handler, uint32_t valCacheID,
+                              uint16_t sessionID)
+{
+  RPKICacheSession* session = _getSession(handler, valCacheID);
+  RPKIRouterKey*    key;
+  RPKIRouterKey     staleKey;
+  RPKIASPARef*      ref;
+  SListNode*        listNode;
+  SListNode*        nextNode;
+  int               noROAs;
+  int               noKeys = 0;
+  int               noASPA = 0;
+  char              errMsg[ERR_MSG_SIZE];
+
+  noROAs = cleanAllROAwl(handler->prefixCache, sessionID, valCacheID, true, 
+                         PC_DO_SUPPRESS);
+
+  // The withdrawal removes the node from the list.
+  for (listNode = handler->routerKeys.root; listNode != NULL; 
+       listNode = nextNode)
+  {
+    nextNode = listNode->next;
+    key = (RPKIRouterKey*)getDataOfSListNode(listNode);
+    if ((key->valCacheID == valCacheID) && key->stale)
+    {
+      staleKey = *key;
+      _processRouterKey(handler, valCacheID, false, staleKey.asn, 
+                        (const char*)staleKey.ski, (const char*)staleKey.key);
+      noKeys++;
+    }
+  }
+  for (listNode = handler->aspaRefs.root; listNode != NULL; 
+       listNode = nextNode)
+  {
+    nextNode = listNode->next;
+    ref = (RPKIASPARef*)getDataOfSListNode(listNode);
+    if ((ref->valCacheID == valCacheID) && ref->stale)
+    {
+      errMsg[0] = '\0';
+      _processAspa(handler, valCacheID, false, ref->customerAsn, 0, NULL, 
+                   errMsg);
+      noASPA++;
+    }
+  }
+  session->resetPending = false;
+
+  LOG(LEVEL_INFO, HDR "Validation cache %u is synchronized, removed %d ROAs, "
+                  "%d ASPA objects, and %d router keys it did not announce "
+                  "again", pthread_self(), valCacheID, noROAs, noASPA, noKeys);
+}
+
+/**
+ * Announce the ROAs, ASPA objects, and router keys of the snapshot as if they
+ * were received from the validation caches.
+ *
+ * @param handler The RPKI handler.
+ * @param snapshot The snapshot.
+ * @param dryRun Only verify the records, do not process them.
+ *
+ * @return false if a record is corrupted or belongs to a validation cache 
+ *         that is not configured.
+ *
+ * @since 0.6.3.0
+ */
+static bool _replaySnapshot(RPKIHandler* handler, SnapshotReader* snapshot,
+                            bool dryRun)
+{
+  SnapshotCursor               cursor;
+  const SnapshotRTRRecord*     rtr;
+  const SnapshotROARecord*     roa;
+  const SnapshotASPARecord*    aspa;
+  const SnapshotASPARefRecord* aspaRef;
+  const SnapshotKeyRecord*     key;
+  const uint32_t*              providers;
+  const uint8_t*               keyData;
+  RPKIASPARef*                 ref;
+  ASPA_Object*                 aspaObj;
+  IPPrefix                     prefix;
+  uint16_t                     sessionIDs[MAX_RPKI_CACHES];
+  uint32_t                     idx;
+  uint32_t                     cnt;
+  char                         strWord[12];
+
+  // The callbacks receive the session ID in network format.
+  memset(sessionIDs, 0, sizeof(sessionIDs));
+  if (findSnapshotSection(snapshot, SNAP_SEC_RTR, &cursor))
+  {
+    for (idx = 0; idx < cursor.count; idx++)
+    {
+      rtr = getSnapshotData(&cursor, sizeof(SnapshotRTRRecord));
+      if ((rtr == NULL) || (_getSession(handler, rtr->valCacheID) == NULL))
+      {
+        return false;
+      }
+      sessionIDs[rtr->valCacheID - 1] = htons(rtr->sessionID);
+    }
+  }
+
+  if (findSnapshotSection(snapshot, SNAP_SEC_ROA, &cursor))
+  {
+    for (idx = 0; idx < cursor.count; idx++)
+    {
+      roa = getSnapshotData(&cursor, sizeof(SnapshotROARecord));
+      if (   (roa == NULL) || !snapshotToPrefix(&roa->prefix, &prefix)
+          || (_getSession(handler, roa->valCacheID) == NULL))
+      {
+        return false;
+      }
+      for (cnt = 0; !dryRun && (cnt < roa->count); cnt++)
+      {
+        handlePrefix(roa->valCacheID, sessionIDs[roa->valCacheID - 1], true, 
+                     &prefix, roa->maxLen, roa->originAS, handler);
+      }
+    }
+  }
+
+  if (findSnapshotSection(snapshot, SNAP_SEC_ASPA, &cursor))
+  {
+    for (idx = 0; idx < cursor.count; idx++)
+    {
+      aspa = getSnapshotData(&cursor, sizeof(SnapshotASPARecord));
+      if (aspa == NULL)
+      {
+        return false;
+      }
+      providers = getSnapshotData(&cursor, 
+                                  aspa->providerAsCount * sizeof(uint32_t));
+      if (providers == NULL)
+      {
+        return false;
+      }
+      if (!dryRun)
+      {
+        // The validation caches of the object are restored below.
+        sprintf(strWord, "%u", aspa->customerAsn);
+        aspaObj = newASPAObject(aspa->customerAsn, aspa->providerAsCount,
+                                (uint32_t*)providers, NO_AFI);
+        insertAspaObj(handler->aspaDBManager, strWord, strWord, aspaObj);
+      }
+    }
+  }
+
+  if (findSnapshotSection(snapshot, SNAP_SEC_ASPA_REF, &cursor))
+  {
+    for (idx = 0; idx < cursor.count; idx++)
+    {
+      aspaRef = getSnapshotData(&cursor, sizeof(SnapshotASPARefRecord));
+      if (   (aspaRef == NULL) 
+          || (_getSession(handler, aspaRef->valCacheID) == NULL))
+      {
+        return false;
+      }
+      providers = getSnapshotData(&cursor, 
+                                  aspaRef->providerAsCount * sizeof(uint32_t));
+      if (providers == NULL)
+      {
+        return false;
+      }
+      if (!dryRun)
+      {
+        ref = (RPKIASPARef*)appendToSList(&handler->aspaRefs, 
+                                          sizeof(RPKIASPARef));
+        if (ref != NULL)
+        {
+          ref->valCacheID   = aspaRef->valCacheID;
+          ref->customerAsn  = aspaRef->customerAsn;
+          ref->providerAsns = NULL;
+          ref->stale        = false;
+          if (!_setASPARefProviders(ref, aspaRef->providerAsCount, providers))
+          {
+            ref->providerAsCount = 0;
+          }
+        }
+      }
+    }
+  }
+
+  if (findSnapshotSection(snapshot, SNAP_SEC_KEY, &cursor))
+  {
+    for (idx = 0; idx < cursor.count; idx++)
+    {
+      key = getSnapshotData(&cursor, sizeof(SnapshotKeyRecord));
+      if (   (key == NULL) || (key->keyLength != ECDSA_PUB_KEY_DER_LENGTH)
+          || (_getSession(handler, key->valCacheID) == NULL))
+      {
+        return false;
+      }
+      keyData = getSnapshotData(&cursor, key->keyLength);
+      if (keyData == NULL)
+      {
+        return false;
+      }
+      if (!dryRun)
+      {
+        handleRouterKey(key->valCacheID, sessionIDs[key->valCacheID - 1], true,
+                        key->asn, (const char*)key->ski, (const char*)keyData,
+                        handler);
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Restore the RPKI data, the AS path cache, and the update cache from the 
+ * snapshot and configure the clients to resume the sessions of the snapshot.
+ * The data of a validation cache that was not in sync when the snapshot was
+ * written is replaced once the cache is synchronized.
+ *
+ * @param handler The RPKI handler, the client parameters are set already.
+ * @param snapshot The snapshot.
+ *
+ * @return false if the snapshot could not be used.
+ *
+ * @since 0.6.3.0
+ */
+static bool _restoreSnapshot(RPKIHandler* handler, SnapshotReader* snapshot)
+{
+  SnapshotCursor           cursor;
+  const SnapshotRTRRecord* rtr;
+  const SnapshotRTRRecord* sessionRTR[MAX_RPKI_CACHES];
+  RPKICacheSession*        session;
+  uint32_t                 idx;
+  int                      noPaths;
+  int                      noUpdates = -1;
+  bool                     valid;
+
+  memset(sessionRTR, 0, sizeof(sessionRTR));
+  valid =    findSnapshotSection(snapshot, SNAP_SEC_RTR, &cursor) 
+          && (cursor.count > 0);
+  for (idx = 0; valid && (idx < cursor.count); idx++)
+  {
+    rtr     = getSnapshotData(&cursor, sizeof(SnapshotRTRRecord));
+    session = rtr != NULL ? _getSession(handler, rtr->valCacheID) : NULL;
+    valid   =    (session != NULL) 
+              && (rtr->version == session->rrclParams.version)
+              && (sessionRTR[rtr->valCacheID - 1] == NULL);
+    if (valid)
+    {
+      sessionRTR[rtr->valCacheID - 1] = rtr;
+    }
+  }
+  if (!valid || !_replaySnapshot(handler, snapshot, true))
+  {
+    LOG(LEVEL_WARNING, HDR "The snapshot does not match the configuration, "
+                       "start from scratch!", pthread_self());
+    return false;
+  }
+
+  // The keys are registered before the updates, this way the restored updates
+  // are not queued for BGPsec validation again.
+  _replaySnapshot(handler, snapshot, false);
+  lockMutex(&handler->snapMutex);
+  for (idx = 0; idx < handler->noSessions; idx++)
+  {
+    _registerPendingKeys(handler, idx + 1);
+  }
+  unlockMutex(&handler->snapMutex);
+  noPaths = readAspathCacheSnapshot(handler->aspathCache, snapshot);
+  if (noPaths >= 0)
+  {
+    noUpdates = readUpdateCacheSnapshot(handler->prefixCache->updateCache, 
+                                        snapshot);
+  }
+  if (noUpdates < 0)
+  {
+    LOG(LEVEL_WARNING, HDR "The snapshot contains corrupted paths or updates, "
+                       "they will be validated again!", pthread_self());
+  }
+
+  lockMutex(&handler->snapMutex);
+  for (idx = 0; idx < handler->noSessions; idx++)
+  {
+    session = &handler->sessions[idx];
+    rtr     = sessionRTR[idx];
+    if (rtr != NULL)
+    {
+      session->consistent = true;
+      session->rrclParams.resumeSession   = true;
+      session->rrclParams.resumeSessionID = rtr->sessionID;
+      session->rrclParams.resumeSerial    = rtr->serial;
+      LOG(LEVEL_INFO, HDR "Restored session 0x%04X with serial %u of "
+                      "validation cache %u", pthread_self(), rtr->sessionID, 
+                      rtr->serial, rtr->valCacheID);
+    }
+    else
+    {
+      // The data of this cache was not in sync, it is replaced by the data of
+      // the reset query.
+      _flagSessionData(handler, idx + 1);
+    }
+  }
+  unlockMutex(&handler->snapMutex);
+
+  LOG(LEVEL_INFO, HDR "Restored %d paths and %d updates", pthread_self(), 
+                  noPaths, noUpdates);
+
+  return true;
+}
+
+/**
+ * Write the router keys into the SNAP_SEC_KEY section of the snapshot. The
+ * caller MUST hold the snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+static bool _writeRouterKeys(RPKIHandler* handler, SnapshotWriter* writer)
+{
+  SnapshotKeyRecord record;
+  RPKIRouterKey*    key;
+  SListNode*        listNode;
+  uint32_t          count  = 0;
+  bool              retVal = beginSnapshotSection(writer, SNAP_SEC_KEY);
+
+  memset(&record, 0, sizeof(SnapshotKeyRecord));
+  FOREACH_SLIST(&handler->routerKeys, listNode)
+  {
+    if (!retVal)
+    {
+      break;
+    }
+    key = (RPKIRouterKey*)getDataOfSListNode(listNode);
+    record.valCacheID = key->valCacheID;
+    record.asn        = key->asn;
+    record.keyLength  = ECDSA_PUB_KEY_DER_LENGTH;
+    memcpy(record.ski, key->ski, SKI_LENGTH);
+    retVal =    addSnapshotData(writer, &record, sizeof(SnapshotKeyRecord))
+             && addSnapshotData(writer, key->key, ECDSA_PUB_KEY_DER_LENGTH);
+    count++;
+  }
+
+  return retVal && endSnapshotSection(writer, count);
+}
+
+/**
+ * Write the validation caches of the ASPA objects into the SNAP_SEC_ASPA_REF
+ * section of the snapshot. The caller MUST hold the snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+static bool _writeASPARefs(RPKIHandler* handler, SnapshotWriter* writer)
+{
+  SnapshotASPARefRecord record;
+  RPKIASPARef*          ref;
+  SListNode*            listNode;
+  uint32_t              count  = 0;
+  bool                  retVal = beginSnapshotSection(writer, 
+                                                      SNAP_SEC_ASPA_REF);
+
+  FOREACH_SLIST(&handler->aspaRefs, listNode)
+  {
+    if (!retVal)
+    {
+      break;
+    }
+    ref = (RPKIASPARef*)getDataOfSListNode(listNode);
+    memset(&record, 0, sizeof(SnapshotASPARefRecord));
+    record.valCacheID      = ref->valCacheID;
+    record.customerAsn     = ref->customerAsn;
+    record.providerAsCount = ref->providerAsCount;
+    retVal =    addSnapshotData(writer, &record, sizeof(SnapshotASPARefRecord))
+             && addSnapshotData(writer, ref->providerAsns, 
+                                ref->providerAsCount * sizeof(uint32_t));
+    count++;
+  }
+
+  return retVal && endSnapshotSection(writer, count);
+}
+
+/**
+ * Configure the RPKI Handler and create one RPKIRouter client per validation
+ * cache. The valCacheID of the first cache (rpki.host) is 1, the additional
+ * caches (rpki.caches) follow in the configured order.
  *
  * @param handler The RPKIHandler instance.
  * @param prefixCache The instance of the prefix cache
+ * @param aspathCache The AS path cache.
  * @param aspaDBManager The ASPA cache
- * @param serverHost The RPKI/Router server (RPKI Validation Cache)
- * @param serverPort The port of the server to be connected to.
- * @param rpki_version The version of the RPKI server protocol.
+ * @param config The configuration with the validation caches.
+ * @param snapshot The snapshot to be restored or NULL.
  * 
  * @return true if the RPKIClientHandler could be created.
  */
 
 bool createRPKIHandler (RPKIHandler* handler, PrefixCache* prefixCache,
                         AspathCache* aspathCache, ASPA_DBManager* aspaDBManager,
-                       const char* serverHost, int serverPort, int rpki_version)
+                        Configuration* config, SnapshotReader* snapshot)
 {
+  RPKICacheSession* session;
+  int               idx;
+
   // Attach the prefix cache
   handler->prefixCache = prefixCache;
   handler->aspaDBManager = aspaDBManager;
   handler->aspathCache   = aspathCache;
 
-  // Create the RPKI/Router protocol client instance
-  handler->rrclParams.prefixCallback     = handlePrefix;
-  handler->rrclParams.resetCallback      = handleReset;
-  handler->rrclParams.errorCallback      = handleError;
-  handler->rrclParams.routerKeyCallback  = handleRouterKey;
-  handler->rrclParams.connectionCallback = handleConnection;
-  handler->rrclParams.aspaCallback       = handleAspaPdu;
-  handler->rrclParams.endOfDataCallback  = handleEndOfData;
+  initSList(&handler->routerKeys);
+  initSList(&handler->aspaRefs);
+  if (!initMutex(&handler->snapMutex))
+  {
+    RAISE_ERROR("Unable to setup the snapshot mutex");
+    return false;
+  }
+  if (!initMutex(&handler->eodMutex))
+  {
+    RAISE_ERROR("Unable to setup the end of data mutex");
+    releaseMutex(&handler->snapMutex);
+    return false;
+  }
 
-  handler->rrclParams.serverHost         = serverHost;
-  handler->rrclParams.serverPort         = serverPort;
-  handler->rrclParams.version            = rpki_version;
+  handler->noSessions = 1 + config->rpki_num_caches;
+  for (idx = 0; idx < handler->noSessions; idx++)
+  {
+    session = &handler->sessions[idx];
+    memset(session, 0, sizeof(RPKICacheSession));
+    initSList(&session->pendingKeys);
+    // No connection yet, the snapshot can not send error reports.
+    session->rrclInstance.clSock.clientFD = -1;
+
+    // Create the RPKI/Router protocol client instance
+    session->rrclParams.prefixCallback     = handlePrefix;
+    session->rrclParams.resetCallback      = handleReset;
+    session->rrclParams.errorCallback      = handleError;
+    session->rrclParams.routerKeyCallback  = handleRouterKey;
+    session->rrclParams.connectionCallback = handleConnection;
+    session->rrclParams.aspaCallback       = handleAspaPdu;
+    session->rrclParams.endOfDataCallback  = handleEndOfData;
 
-  handler->rrclParams.refreshInterval    = 0;
-  handler->rrclParams.retryInterval      = 0;
-  handler->rrclParams.expireInterval     = 0;
+    session->rrclParams.serverHost = idx == 0 
+                                     ? config->rpki_host
+                                     : config->rpki_caches[idx - 1].host;
+    session->rrclParams.serverPort = idx == 0 
+                                     ? config->rpki_port
+                                     : config->rpki_caches[idx - 1].port;
+    session->rrclParams.version    = config->rpki_router_protocol;
+    session->rrclParams.valCacheID = idx + 1;
 
-  if (!createRPKIRouterClient(&handler->rrclInstance, &handler->rrclParams,
-                               handler))
+    session->rrclParams.refreshInterval    = 0;
+    session->rrclParams.retryInterval      = 0;
+    session->rrclParams.expireInterval     = 0;
+
+    session->rrclParams.resumeSession      = false;
+  }
+
+  // Restore the data before the clients receive any changes.
+  if (snapshot != NULL)
   {
-    return false;
+    _restoreSnapshot(handler, snapshot);
+  }
+
+  for (idx = 0; idx < handler->noSessions; idx++)
+  {
+    session = &handler->sessions[idx];
+    if (!createRPKIRouterClient(&session->rrclInstance, &session->rrclParams,
+                                handler))
+    {
+      while (idx > 0)
+      {
+        idx--;
+        releaseRPKIRouterClient(&handler->sessions[idx].rrclInstance);
+      }
+      return false;
+    }
+    LOG(LEVEL_INFO, HDR "Validation cache %u: %s:%d", pthread_self(), idx + 1,
+                    session->rrclParams.serverHost, 
+                    session->rrclParams.serverPort);
   }
 
   return true;
@@ -185,12 +851,91 @@ bool createRPKIHandler (RPKIHandler* handler, PrefixCache* prefixCache,
  */
 void releaseRPKIHandler(RPKIHandler* handler)
 {
+  int idx;
+
   if (handler != NULL)
   {
-    releaseRPKIRouterClient(&handler->rrclInstance);
+    for (idx = 0; idx < handler->noSessions; idx++)
+    {
+      releaseRPKIRouterClient(&handler->sessions[idx].rrclInstance);
+      releaseSList(&handler->sessions[idx].pendingKeys);
+    }
+    releaseSList(&handler->routerKeys);
+    while (handler->aspaRefs.root != NULL)
+    {
+      _deleteASPARef(handler, 
+                     (RPKIASPARef*)getDataOfSListNode(handler->aspaRefs.root));
+    }
+    releaseSList(&handler->aspaRefs);
+    releaseMutex(&handler->snapMutex);
+    releaseMutex(&handler->eodMutex);
   }
 }
 
+/**
+ * Write the RTR sessions, the RPKI data, the AS path cache, and the update 
+ * cache into the snapshot. Changes of the RPKI data are blocked while writing.
+ * Only the sessions of the validation caches in sync are written, the data 
+ * of the other caches is replaced after the restart.
+ *
+ * @param handler The handler.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the snapshot could not be written or the RPKI data of no
+ *         validation cache is in sync with an End of Data.
+ *
+ * @since 0.6.3.0
+ */
+bool writeRPKIHandlerSnapshot(RPKIHandler* handler, SnapshotWriter* writer)
+{
+  SnapshotRTRRecord rtr;
+  RPKICacheSession* session;
+  uint32_t          count  = 0;
+  bool              retVal = false;
+  int               idx;
+
+  lockMutex(&handler->snapMutex);
+  for (idx = 0; idx < handler->noSessions; idx++)
+  {
+    count += handler->sessions[idx].consistent ? 1 : 0;
+  }
+  if (count > 0)
+  {
+    memset(&rtr, 0, sizeof(SnapshotRTRRecord));
+    retVal = beginSnapshotSection(writer, SNAP_SEC_RTR);
+    for (idx = 0; retVal && (idx < handler->noSessions); idx++)
+    {
+      session = &handler->sessions[idx];
+      if (session->consistent)
+      {
+        rtr.valCacheID = session->rrclInstance.routerClientID;
+        rtr.sessionID  = ntohs((uint16_t)session->rrclInstance.sessionID);
+        rtr.serial     = ntohl(session->rrclInstance.serial);
+        rtr.version    = session->rrclInstance.version;
+        retVal = addSnapshotData(writer, &rtr, sizeof(SnapshotRTRRecord));
+      }
+    }
+
+    retVal =    retVal
+             && endSnapshotSection(writer, count)
+             && writePrefixCacheSnapshot(handler->prefixCache, writer)
+             && writeAspaDBSnapshot(handler->aspaDBManager, writer)
+             && _writeASPARefs(handler, writer)
+             && _writeRouterKeys(handler, writer)
+             && writeAspathCacheSnapshot(handler->aspathCache, writer)
+             && writeUpdateCacheSnapshot(handler->prefixCache->updateCache, 
+                                         writer);
+  }
+  else
+  {
+    LOG(LEVEL_INFO, HDR "The RPKI data is not in sync with any validation "
+                    "cache, skip the snapshot.", pthread_self());
+  }
+  unlockMutex(&handler->snapMutex);
+
+  return retVal;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // RPKI/Router client callback
 ////////////////////////////////////////////////////////////////////////////////
@@ -214,10 +959,12 @@ static void handlePrefix (uint32_t valCacheID, uint16_t session_id,
                           bool isAnn, IPPrefix* prefix, uint16_t maxLen,
                           uint32_t oas, void* rpkiHandler)
 {
-  if (rpkiHandler != NULL)
-  {
-    RPKIHandler* handler = (RPKIHandler*)rpkiHandler;
+  RPKIHandler*      handler = (RPKIHandler*)rpkiHandler;
+  RPKICacheSession* session = handler != NULL 
+                              ? _getSession(handler, valCacheID) : NULL;
 
+  if (session != NULL)
+  {
     char prefixBuf[MAX_PREFIX_STR_LEN_V6];
 
     LOG(LEVEL_DEBUG, HDR "ROA-wl: %s [originAS: %u, prefix: %s, max-len: %u, "
@@ -227,6 +974,8 @@ static void handlePrefix (uint32_t valCacheID, uint16_t session_id,
         valCacheID, session_id);
 
     // This method takes care of the received white list prefix/origin entry.
+    lockMutex(&handler->snapMutex);
+    session->consistent = false;
     if (isAnn)
     {
       addROAwl(handler->prefixCache, oas, prefix, maxLen, session_id, 
@@ -237,6 +986,7 @@ static void handlePrefix (uint32_t valCacheID, uint16_t session_id,
       delROAwl(handler->prefixCache, oas, prefix, maxLen, session_id, 
                valCacheID, PC_DO_SUPPRESS);
     }
+    unlockMutex(&handler->snapMutex);
   }
   else
   {
@@ -245,19 +995,34 @@ static void handlePrefix (uint32_t valCacheID, uint16_t session_id,
 }
 
 /**
- * Handle the reset for the prefix cache.
+ * Handle the reset of a validation cache. The data of the cache is kept until
+ * the cache is synchronized again, this way the validation results do not 
+ * change for the data announced again and the data of the other caches is
+ * not touched at all.
  *
  * @param valCacheID The ID of the validation cache.
  * @param rpkiHandler The RPKIHandler that contains the cache to be reseted.
  */
 static void handleReset (uint32_t valCacheID, void* rpkiHandler)
 {
-  LOG(LEVEL_DEBUG, HDR "RPKI: Reset", pthread_self());
-  RAISE_ERROR("Handle Reset not implemented yet! - doDo: remove or flag all "
-              "ROAS, Keys, And ASPA Objects from the given validation Cache");
-  if (rpkiHandler == NULL)
+  RPKIHandler*      handler = (RPKIHandler*)rpkiHandler;
+  RPKICacheSession* session = handler != NULL 
+                              ? _getSession(handler, valCacheID) : NULL;
+
+  LOG(LEVEL_DEBUG, HDR "RPKI: Reset of validation cache %u", pthread_self(),
+                   valCacheID);
+  if (session == NULL)
   {
-    LOG(LEVEL_ERROR, "Called handlePrefix with missing rpkiHandler!");
+    LOG(LEVEL_ERROR, "Called handleReset with missing rpkiHandler!");
+  }
+  else
+  {
+    lockMutex(&handler->snapMutex);
+    session->consistent = false;
+    // The keys not registered yet are announced again.
+    emptySList(&session->pendingKeys);
+    _flagSessionData(handler, valCacheID);
+    unlockMutex(&handler->snapMutex);
   }
 }
 
@@ -274,10 +1039,12 @@ static void handleReset (uint32_t valCacheID, void* rpkiHandler)
 static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
                              void* rpkiHandler)
 {
-  if (rpkiHandler != NULL)
-  {
-    RPKIHandler* handler = (RPKIHandler*)rpkiHandler;
+  RPKIHandler*      handler = (RPKIHandler*)rpkiHandler;
+  RPKICacheSession* session = handler != NULL 
+                              ? _getSession(handler, valCacheID) : NULL;
 
+  if (session != NULL)
+  {
     RPKI_QUEUE*      rQueue = getRPKIQueue();
     RPKI_QUEUE_ELEM  queueElem;
     SRxResult        srxRes;
@@ -287,14 +1054,29 @@ static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
 
     UpdateCache*     uCache = handler->prefixCache->updateCache;
     SRxUpdateID*     uID = NULL;
+    CryptoWorkerPool* cryptoPool = getCryptoWorkerPool();
+    bool             deferred = false;
       
-    LOG(LEVEL_INFO, "Received an end of data, process RPKI Queue:\n");
+    LOG(LEVEL_INFO, "Received an end of data from validation cache %u, "
+                    "process RPKI Queue:\n", valCacheID);
 
-    if (handler->rrclInstance.version > 1)
+    // The sessions share the RPKI queue.
+    lockMutex(&handler->eodMutex);
+    lockMutex(&handler->snapMutex);
+    // The keys are registered first, this way a key replaced during a reset
+    // is available before the old one is swept.
+    _registerPendingKeys(handler, valCacheID);
+    if (session->resetPending)
+    {
+      _sweepSessionData(handler, valCacheID, session_id);
+    }
+    unlockMutex(&handler->snapMutex);
+
+    if (session->rrclInstance.version > 1)
     {
     // @TODO: Use the refresh, retry, and expire intervals as specified.
     // This also might be done by the PDU packet handler. Regardless, the 
-    // timing data is stored in handler->rrclParams
+    // timing data is stored in session->rrclParams
       process_ASPA_EndOfData(uCache, handler->aspaDBManager->cbProcessEndOfData, 
                              rpkiHandler);
     }
@@ -307,6 +1089,7 @@ static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
       valRes.valResult.roaResult    = SRx_RESULT_DONOTUSE;
       valRes.valResult.bgpsecResult = SRx_RESULT_DONOTUSE;
       valRes.valResult.aspaResult   = SRx_RESULT_DONOTUSE;
+      deferred = false;
       
       if ((queueElem.reason & RQ_ROA) == RQ_ROA)
       {
@@ -321,29 +1104,19 @@ static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
                             "QUEUE!", queueElem.updateID);
         }
       }
-      // Now check for BGPSEC path Validation
+      // Now check for BGPSEC path Validation. The cryptography is never 
+      // performed in this thread, the crypto workers take it over (waiting 
+      // if their priority lane is full), without them the command handler 
+      // does. Either one stores the result and notifies the clients.
       if ((queueElem.reason & RQ_KEY) == RQ_KEY)
       {
-        UC_UpdateData* updateData = getUpdateData(uCache, uID);
-        SCA_BGP_PathAttribute* bgpsec_path = updateData->bgpsec_path;
-        if (bgpsec_path != NULL)
+        deferred = true;
+        if (   !(   (cryptoPool != NULL)
+                 && queuePriorityCryptoJob(cryptoPool, CW_JOB_REVALIDATE, uID))
+            && !queueBGPsecRevalidation(uID))
         {
-          BGPSecHandler* bgpsecHandler = getBGPsecHandler();
-          if (bgpsecHandler != NULL)
-          {
-            valRes.valType |= VRT_BGPSEC;
-            valRes.valResult.bgpsecResult = validateSignature(bgpsecHandler, 
-                                                              updateData);
-          }
-          else
-          {
-            RAISE_ERROR("BGPSecHAndler could not be retrieved!!");
-          }
-        }
-        else
-        {
-          LOG(LEVEL_ERROR, "Update 0x%08X is registered for BGPsec but the "
-                          "BGPsec_PATH attribute is not stored!", *uID);
+          LOG(LEVEL_WARNING, "BGPsec revalidation of update 0x%08X could not "
+                             "be queued!", *uID);
         }
       }
       
@@ -364,6 +1137,12 @@ static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
         }
       }
       
+      if (deferred && (valRes.valType == VRT_NONE))
+      {
+        // Nothing left to report, the crypto worker takes care of it.
+        continue;
+      }
+      
       if (uCache->resChangedCallback != NULL)
       {
         // Notify of the change of validation result. (call handleUpdateResultChange)
@@ -378,6 +1157,12 @@ static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
         break;
       }
     }
+
+    // The data is in sync with the serial of this End of Data.
+    lockMutex(&handler->snapMutex);
+    session->consistent = true;
+    unlockMutex(&handler->snapMutex);
+    unlockMutex(&handler->eodMutex);
   }
   else
   {
@@ -385,6 +1170,7 @@ static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
   }
 }
 
+
 /** This function returns true if the error is a fatal one. See RFC 8210 
  * for more informtion.
  * 
@@ -457,6 +1243,272 @@ static uint8_t getAlgoID(const char* keyInfo)
   return SCA_ECDSA_ALGORITHM;
 }
 
+/**
+ * Add or remove the router key to / from the list of keys written into the
+ * snapshot. The caller MUST hold the snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param valCacheID The ID of the validation cache.
+ * @param isAnn Add or remove the key.
+ * @param asn The AS number in host format.
+ * @param ski The SKI of the key.
+ * @param keyInfo The key in DER format.
+ *
+ * @since 0.6.3.0
+ */
+static void _storeRouterKey(RPKIHandler* handler, uint32_t valCacheID, 
+                            bool isAnn, uint32_t asn, const char* ski, 
+                            const char* keyInfo)
+{
+  RPKIRouterKey* key;
+  SListNode*     listNode;
+
+  if (isAnn)
+  {
+    key = (RPKIRouterKey*)appendToSList(&handler->routerKeys, 
+                                        sizeof(RPKIRouterKey));
+    if (key != NULL)
+    {
+      key->valCacheID = valCacheID;
+      key->asn        = asn;
+      memcpy(key->ski, ski, SKI_LENGTH);
+      memcpy(key->key, keyInfo, ECDSA_PUB_KEY_DER_LENGTH);
+      key->stale      = false;
+    }
+  }
+  else
+  {
+    FOREACH_SLIST(&handler->routerKeys, listNode)
+    {
+      key = (RPKIRouterKey*)getDataOfSListNode(listNode);
+      if ((key->valCacheID == valCacheID) && (key->asn == asn)
+          && (memcmp(key->ski, ski, SKI_LENGTH) == 0))
+      {
+        deleteFromSList(&handler->routerKeys, key);
+        free(key);
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * Register or unregister the router key of the validation cache. The key 
+ * announced again by the validation cache after a reset is only confirmed.
+ * New keys are kept until the End of Data and registered as one bulk by 
+ * _registerPendingKeys. The caller MUST hold the snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param valCacheID The ID of the validation cache.
+ * @param isAnn Indicates if this in an announcement or not.
+ * @param asn The as number in host format
+ * @param ski The SKI of the key.
+ * @param keyInfo The key in DER format.
+ *
+ * @since 0.6.3.0
+ */
+static void _processRouterKey(RPKIHandler* handler, uint32_t valCacheID, 
+                              bool isAnn, uint32_t asn, const char* ski,
+                              const char* keyInfo)
+{
+  SRxCryptoAPI*     srxCAPI = getSrxCAPI();
+  SKI_CACHE*        sCache  = getSKICache();
+  RPKICacheSession* session = _getSession(handler, valCacheID);
+  sca_status_t      status  = API_STATUS_OK;
+  RPKIRouterKey*    key;
+  SListNode*        listNode;
+  uint8_t           res;
+  BGPSecKey         bsKey;
+
+  if (isAnn)
+  {
+    FOREACH_SLIST(&handler->routerKeys, listNode)
+    {
+      key = (RPKIRouterKey*)getDataOfSListNode(listNode);
+      if (   key->stale && (key->valCacheID == valCacheID) 
+          && (key->asn == asn) && (memcmp(key->ski, ski, SKI_LENGTH) == 0)
+          && (memcmp(key->key, keyInfo, ECDSA_PUB_KEY_DER_LENGTH) == 0))
+      {
+        key->stale = false;
+        return;
+      }
+    }
+  }
+  else
+  {
+    // A key withdrawn before the End of Data was never registered.
+    FOREACH_SLIST(&session->pendingKeys, listNode)
+    {
+      key = (RPKIRouterKey*)getDataOfSListNode(listNode);
+      if (   (key->asn == asn) && (memcmp(key->ski, ski, SKI_LENGTH) == 0)
+          && (memcmp(key->key, keyInfo, ECDSA_PUB_KEY_DER_LENGTH) == 0))
+      {
+        deleteFromSList(&session->pendingKeys, key);
+        free(key);
+        return;
+      }
+    }
+  }
+    
+  memset(&bsKey, 0, sizeof(BGPSecKey));
+  // Determine the algorithm ID
+  bsKey.algoID = getAlgoID(keyInfo);
+      
+  // At this point only ECDSA algorithm is supported.
+  if (bsKey.algoID == SCA_ECDSA_ALGORITHM)
+  {
+    if (isAnn)
+    {
+      // A new key is announced, it is registered with the End of Data.
+      key = (RPKIRouterKey*)appendToSList(&session->pendingKeys, 
+                                          sizeof(RPKIRouterKey));
+      if (key != NULL)
+      {
+        key->valCacheID = valCacheID;
+        key->asn        = asn;
+        memcpy(key->ski, ski, SKI_LENGTH);
+        memcpy(key->key, keyInfo, ECDSA_PUB_KEY_DER_LENGTH);
+        key->stale      = false;
+      }
+      else
+      {
+        RAISE_SYS_ERROR("Not enough memory to keep the RPKI/Router Key");
+      }
+    }
+    else
+    {
+      // Is handed over in network format.
+      bsKey.asn = htonl(asn);
+      memcpy(bsKey.ski, ski, SKI_LENGTH);
+      bsKey.keyLength = ECDSA_PUB_KEY_DER_LENGTH;
+      bsKey.keyData   = (uint8_t*)keyInfo;
+
+      // A key is withdrawn
+      res = srxCAPI->unregisterPublicKey(&bsKey, (sca_key_source_t)valCacheID, 
+                                        &status);
+      ski_unregisterKey(sCache, asn, (uint8_t*)ski, bsKey.algoID);
+      _storeRouterKey(handler, valCacheID, false, asn, ski, keyInfo);
+
+      if (res == API_SUCCESS)
+      {
+        LOG(LEVEL_INFO, "A key was removed from SCA.");
+      }
+      else
+      {
+        LOG(LEVEL_WARNING, "Failed to remove RPKI/Router Key from srxcryptoapi "
+                          "with status:%i [0x%04X]", status, status);
+      }
+    }
+  }
+  else
+  {
+    LOG(LEVEL_WARNING, "Key format specified buy algorithm if %u is not "
+                      "supported!", bsKey.algoID);
+  }
+}
+
+/**
+ * Register the router keys the validation cache announced since its last End
+ * of Data as one bulk with the SrxCryptoAPI. This allows the plugin to convert
+ * the keys in parallel ahead of the first validation instead of the RPKI 
+ * thread registering one key at a time. The time of the registration is 
+ * logged and recorded in MET_STAGE_KEY_REGISTER. The caller MUST hold the 
+ * snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param valCacheID The ID of the validation cache.
+ *
+ * @since 0.6.3.0
+ */
+static void _registerPendingKeys(RPKIHandler* handler, uint32_t valCacheID)
+{
+  RPKICacheSession* session  = _getSession(handler, valCacheID);
+  SRxCryptoAPI*     srxCAPI  = getSrxCAPI();
+  SKI_CACHE*        sCache   = getSKICache();
+  sca_status_t      status   = API_STATUS_OK;
+  int               count    = sizeOfSList(&session->pendingKeys);
+  int               noStored = 0;
+  int               idx;
+  BGPSecKey*        bsKeys;
+  BGPSecKey**       keyList;
+  sca_status_t*     keyStatus;
+  RPKIRouterKey*    key;
+  SListNode*        listNode;
+  struct timespec   begin;
+  struct timespec   end;
+  uint64_t          start;
+
+  if (count == 0)
+  {
+    return;
+  }
+
+  bsKeys    = calloc(count, sizeof(BGPSecKey));
+  keyList   = calloc(count, sizeof(BGPSecKey*));
+  keyStatus = calloc(count, sizeof(sca_status_t));
+  if ((bsKeys == NULL) || (keyList == NULL) || (keyStatus == NULL))
+  {
+    // The keys stay pending until the next End of Data.
+    RAISE_SYS_ERROR("Not enough memory to register %d RPKI/Router Keys", 
+                    count);
+    free(bsKeys);
+    free(keyList);
+    free(keyStatus);
+    return;
+  }
+
+  start = metricsNow();
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  idx = 0;
+  FOREACH_SLIST(&session->pendingKeys, listNode)
+  {
+    key = (RPKIRouterKey*)getDataOfSListNode(listNode);
+    // Is handed over in network format.
+    bsKeys[idx].algoID    = SCA_ECDSA_ALGORITHM;
+    bsKeys[idx].asn       = htonl(key->asn);
+    memcpy(bsKeys[idx].ski, key->ski, SKI_LENGTH);
+    bsKeys[idx].keyLength = ECDSA_PUB_KEY_DER_LENGTH;
+    bsKeys[idx].keyData   = key->key;
+    keyList[idx] = &bsKeys[idx];
+    idx++;
+  }
+  srxCAPI->registerPublicKeys(count, keyList, (sca_key_source_t)valCacheID, 
+                              keyStatus, &status);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  recordMetric(MET_STAGE_KEY_REGISTER, MET_NO_CLIENT, start);
+  markKeyRegistration();
+
+  idx = 0;
+  FOREACH_SLIST(&session->pendingKeys, listNode)
+  {
+    key = (RPKIRouterKey*)getDataOfSListNode(listNode);
+    if ((keyStatus[idx] & API_STATUS_ERROR_MASK) == 0)
+    {
+      // Now register the key with the SKI_CACHE
+      ski_registerKey(sCache, key->asn, key->ski, SCA_ECDSA_ALGORITHM);
+      _storeRouterKey(handler, valCacheID, true, key->asn, 
+                      (const char*)key->ski, (const char*)key->key);
+      noStored++;
+    }
+    else
+    {
+      LOG(LEVEL_WARNING, "Failed to store RPKI/Router Key in srxcryptoapi "
+                         "with status:%i [0x%04X]", keyStatus[idx], 
+                         keyStatus[idx]);
+    }
+    idx++;
+  }
+  emptySList(&session->pendingKeys);
+  free(bsKeys);
+  free(keyList);
+  free(keyStatus);
+
+  LOG(LEVEL_INFO, HDR "Registered %d of %d RPKI/Router Keys of validation "
+                  "cache %u in %.3f ms", pthread_self(), noStored, count,
+                  valCacheID, (end.tv_sec - begin.tv_sec) * 1000.0 
+                              + (end.tv_nsec - begin.tv_nsec) / 1000000.0);
+}
+
 /**
  * This function is called for each prefix announcement / withdrawal received
  * from the RPKI validation cache.
@@ -479,76 +1531,120 @@ static void handleRouterKey (uint32_t valCacheID, uint16_t session_id,
                              bool isAnn, uint32_t asn, const char* ski,
                              const char* keyInfo, void* rpkiHandler)
 {
-  if (rpkiHandler != NULL)
-  {
-    RPKIHandler* handler=(RPKIHandler*)rpkiHandler;
-    SRxCryptoAPI* srxCAPI  = getSrxCAPI();
-    SKI_CACHE* sCache      = getSKICache();
-    sca_status_t status = API_STATUS_OK;
-    uint8_t res;
-    BGPSecKey bsKey;
-    
-    memset(&bsKey, 0, sizeof(BGPSecKey));
-    // Determine the algorithm ID
-    bsKey.algoID = getAlgoID(keyInfo);
-      
-    // At this point only ECDSA algorithm is supported.
-    if (bsKey.algoID == SCA_ECDSA_ALGORITHM)
-    {
-      // Is handed over in network format.
-      bsKey.asn = htonl(asn);
-      memcpy(bsKey.ski, ski, SKI_LENGTH);
-      bsKey.keyLength = ECDSA_PUB_KEY_DER_LENGTH;
-      bsKey.keyData = (uint8_t*)calloc(1, ECDSA_PUB_KEY_DER_LENGTH);
-      memcpy(bsKey.keyData, keyInfo, ECDSA_PUB_KEY_DER_LENGTH);
+  RPKIHandler*      handler = (RPKIHandler*)rpkiHandler;
+  RPKICacheSession* session = handler != NULL 
+                              ? _getSession(handler, valCacheID) : NULL;
 
-      if (isAnn)
-      {
-        // A new key is announced
-        res = srxCAPI->registerPublicKey(&bsKey, (sca_key_source_t)valCacheID, 
-                                        &status);
+  if (session != NULL)
+  {
+    lockMutex(&handler->snapMutex);
+    session->consistent = false;
+    _processRouterKey(handler, valCacheID, isAnn, asn, ski, keyInfo);
+    unlockMutex(&handler->snapMutex);
+  }
+  else
+  {
+    LOG(LEVEL_ERROR, "Called handleRouterKey with missing rpkiHandler!");
+  }
+}
 
-        if (res == API_SUCCESS)
-        {
-          LOG(LEVEL_INFO, "RPKI/Router Key Stored in srxcryptoapi ");
-          // Now register the key with the SKI_CACHE
-          ski_registerKey(sCache, asn, (uint8_t*)ski, bsKey.algoID);
-        }
-        else
+/**
+ * Store or remove the ASPA object of the validation cache. The ASPA database 
+ * holds one object per customer AS with the providers announced by all caches
+ * (see _installAspa). The caller MUST hold the snapshot mutex.
+ *
+ * @param handler The RPKI handler.
+ * @param valCacheID The ID of the validation cache.
+ * @param isAnn Indicates if this in an announcement or not.
+ * @param customerAsn The ASN of the customer
+ * @param providerAsCount Number of providers in the providersAsns list.
+ * @param providerAsns The list of provider ASNs
+ * @param errMsg (out) The error message of ERR_MSG_SIZE bytes, not modified
+ *               if no error occurred.
+ *
+ * @since 0.6.3.0
+ */
+static void _processAspa(RPKIHandler* handler, uint32_t valCacheID, 
+                         bool isAnn, uint32_t customerAsn, 
+                         uint16_t providerAsCount, uint32_t* providerAsns,
+                         char* errMsg)
+{
+  RPKIASPARef*    ref;
+  bool            removed;
+  char            strWord[12];
+
+  memset(strWord, '\0', 12);
+  sprintf(strWord, "%u", customerAsn);
+
+  if (providerAsCount != 0 )
+  {
+    if (!isAnn)
+    {
+      // Withdrawal must not have providers.
+      snprintf(errMsg, ERR_MSG_SIZE, "%s [ASPA] Announcement with 0 "
+               "Providers - ERROR [0] = Malformed PDU!", FILE_LINE_INFO);
+    } 
+    else
+    {
+      // Announce
+      LOG(LEVEL_INFO, "[Announce] ASPA object, search key in DB: %s", strWord);
+      ref = _findASPARef(handler, valCacheID, customerAsn);
+      if (ref == NULL)
+      {
+        ref = (RPKIASPARef*)appendToSList(&handler->aspaRefs, 
+                                          sizeof(RPKIASPARef));
+        if (ref != NULL)
         {
-          LOG(LEVEL_WARNING, "Failed to store RPKI/Router Key in srxcryptoapi "
-                            "with status:%i [0x%04X]", status, status);
+          ref->valCacheID      = valCacheID;
+          ref->customerAsn     = customerAsn;
+          ref->providerAsCount = 0;
+          ref->providerAsns    = NULL;
         }
       }
-      else
+      if (   (ref == NULL) 
+          || !_setASPARefProviders(ref, providerAsCount, providerAsns))
       {
-        // A key is withdrawn
-        res = srxCAPI->unregisterPublicKey(&bsKey, (sca_key_source_t)valCacheID, 
-                                          &status);
-        ski_unregisterKey(sCache, asn, (uint8_t*)ski, bsKey.algoID);
-
-        if (res == API_SUCCESS)
-        {
-          LOG(LEVEL_INFO, "A key was removed from SCA.");
-          // Now register the key with the SKI_CACHE
-        }
-        else
-        {
-          LOG(LEVEL_WARNING, "Failed to remove RPKI/Router Key from srxcryptoapi "
-                            "with status:%i [0x%04X]", status, status);
-        }
+        RAISE_SYS_ERROR("Not enough memory to store the ASPA object of AS %u!",
+                        customerAsn);
+        return;
       }
+      ref->stale = false;
+      // The providers of the other caches are kept in the object.
+      _installAspa(handler, customerAsn);
+    }
+  }
+  else 
+  {
+    if (isAnn)
+    {
+      // Error implicit withdraw a withdrwal should not reflect an announcement 
+      snprintf(errMsg, ERR_MSG_SIZE, "%s [ASPA] Withdrawal contains Announce "
+               "flag to be set - ERROR [0] = Malformed PDU!", FILE_LINE_INFO);
     }
     else
     {
-      LOG(LEVEL_WARNING, "Key format specified buy algorithm if %u is not "
-                        "supported!", bsKey.algoID);
+      // Withdraw
+      LOG(LEVEL_INFO, "[Withdraw] ASPA object, search key in DB: %s", strWord);
+      ref     = _findASPARef(handler, valCacheID, customerAsn);
+      removed = false;
+      if (ref != NULL)
+      {
+        _deleteASPARef(handler, ref);
+        // Keep the object with the providers of the other caches, if any.
+        removed = _installAspa(handler, customerAsn);
+      }
+      if (removed)
+      {
+        LOG(LEVEL_INFO, "[Withdraw] Withdraw executed successfully");
+      }
+      else
+      {
+        snprintf(errMsg, ERR_MSG_SIZE, "%s [Withdraw] Withdraw Failed due to "
+                 "not found or mismatch - ERROR [6] =  Withdrawal of Unknown "
+                 "Record!", FILE_LINE_INFO);
+      }
     }
   }
-  else
-  {
-    LOG(LEVEL_ERROR, "Called handleRouterKey with missing rpkiHandler!");
-  }
 }
 
 /**
@@ -579,84 +1675,27 @@ static void handleAspaPdu (uint32_t valCacheID, uint16_t session_id,
 // work1. parsing ASPA objects into AS number in forms of string
 // work2. call DB to store
 //  
-  if (rpkiHandler != NULL)
-  {
-    RPKIHandler* handler = (RPKIHandler*)rpkiHandler;
+  RPKIHandler*      handler = (RPKIHandler*)rpkiHandler;
+  RPKICacheSession* session = handler != NULL 
+                              ? _getSession(handler, valCacheID) : NULL;
 
+  if (session != NULL)
+  {
     LOG(LEVEL_DEBUG, FILE_LINE_INFO " ASPA handler called for registering "
                                     "ASPA object(s) into DB");
-    ASPA_DBManager* aspaDBManager = handler->aspaDBManager;
-    
-    TrieNode *node = NULL;
-    ASPA_Object *aspaObj = NULL;
-
-    char strWord[12];
-    memset(strWord, '\0', 12);
-    sprintf(strWord, "%d", customerAsn);
-
-    char errMsg[128];
+    char errMsg[ERR_MSG_SIZE];
     errMsg[0] = '\0';
 
-    if (providerAsCount != 0 )
-    {
-      if (!isAnn)
-      {
-        // Withdrawal must not have providers.
-        sprintf(errMsg, "%s [ASPA] Announcement with 0 Providers - "
-                          "ERROR [0] = Malformed PDU!", FILE_LINE_INFO);
-      } 
-      else
-      {
-        // Announce
-        LOG(LEVEL_INFO, "[Announce] ASPA object, search key in DB: %s", strWord);
-        // Only create the ASPA Object if it is an anouncement (with providers)
-        aspaObj = newASPAObject(customerAsn, providerAsCount, providerAsns, 
-                                NO_AFI);
-        // Here check if an existing record gets updated or not.
-        node = insertAspaObj(aspaDBManager, strWord, strWord, aspaObj);
-      }
-    }
-    else 
-    {
-      if (isAnn)
-      {
-        // Error implicit withdraw a withdrwal should not reflect an announcement 
-        sprintf(errMsg, "%s [ASPA] Withdrawal contains Announce flag to be set - "
-                        "ERROR [0] = Malformed PDU!", FILE_LINE_INFO);
-      }
-      else
-      {
-        // Withdraw
-        LOG(LEVEL_INFO, "[Withdraw] ASPA object, search key in DB: %s", strWord);
-        bool resWithdraw = delete_TrieNode_AspaObj (aspaDBManager, strWord, 
-                                                    aspaObj);
-        if (resWithdraw)
-        {
-          LOG(LEVEL_INFO, "[Withdraw] Withdraw executed successfully");
-        }
-        else
-        {
-          sprintf(errMsg, "%s [Withdraw] Withdraw Failed due to not found or"
-                          "mismatch - ERROR [6] =  Withdrawal of Unknown "
-                          "Record!", FILE_LINE_INFO);
-        }
-
-        if (aspaObj) // release memory unless used for inserting db
-        {
-          if (aspaObj->providerAsns)
-          {
-            free(aspaObj->providerAsns);
-          }
-          free (aspaObj);
-          aspaObj = NULL;
-        }
-      }
-    }
+    lockMutex(&handler->snapMutex);
+    session->consistent = false;
+    _processAspa(handler, valCacheID, isAnn, customerAsn, providerAsCount,
+                 providerAsns, errMsg);
+    unlockMutex(&handler->snapMutex);
 
     if (strlen(errMsg) != 0)
     {
       LOG(LEVEL_WARNING, "%s\n", errMsg);
-      sendErrorReport(&(handler->rrclInstance), RPKI_EC_CORRUPT_DATA, NULL, 0, 
+      sendErrorReport(&session->rrclInstance, RPKI_EC_CORRUPT_DATA, NULL, 0, 
                       errMsg, strlen(errMsg));
     }
   }
@@ -665,14 +1704,3 @@ static void handleAspaPdu (uint32_t valCacheID, uint16_t session_id,
     LOG(LEVEL_ERROR, "Called handleRouterKey with missing rpkiHandler!");
   }
 }
-
-
-
-
-
-
-
-
-
-
-
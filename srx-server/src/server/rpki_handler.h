@@ -50,36 +50,127 @@
 
 #include <pthread.h>
 #include <srx/srxcryptoapi.h>
+#include "server/configuration.h"
 #include "server/prefix_cache.h"
 #include "server/rpki_router_client.h"
 #include "server/aspath_cache.h"
+#include "server/snapshot.h"
+#include "util/mutex.h"
 #include "util/prefix.h"
+#include "util/slist.h"
 #include "server/aspa_trie.h"
 
 /**
- * A single RPKI/Router Handler.
+ * A router key received from the validation cache. The SrxCryptoAPI does not
+ * allow to read the registered keys, the handler keeps them for the snapshot.
+ *
+ * @since 0.6.3.0
+ */
+typedef struct {
+  uint32_t valCacheID;
+  /** The AS number in host format. */
+  uint32_t asn;
+  uint8_t  ski[SKI_LENGTH];
+  /** The key in DER format. */
+  uint8_t  key[ECDSA_PUB_KEY_DER_LENGTH];
+  /** The validation cache reset the session and did not announce the key 
+   * again yet. @since 0.6.3.0 */
+  bool     stale;
+} RPKIRouterKey;
+
+/**
+ * An ASPA object announced by a validation cache. The ASPA database keeps one
+ * object per customer AS with the providers of all caches that announce it, 
+ * it is removed once no validation cache announces it anymore.
+ *
+ * @since 0.6.3.0
+ */
+typedef struct {
+  uint32_t  valCacheID;
+  uint32_t  customerAsn;
+  /** The number of providers announced by this validation cache. */
+  uint16_t  providerAsCount;
+  /** The providers announced by this validation cache. */
+  uint32_t* providerAsns;
+  /** The validation cache reset the session and did not announce the object
+   * again yet. */
+  bool      stale;
+} RPKIASPARef;
+
+/**
+ * The session to one validation cache. Each session runs in the thread of its
+ * RPKI/Router client.
+ *
+ * @since 0.6.3.0
  */
 typedef struct {
-  PrefixCache*            prefixCache;
   RPKIRouterClientParams  rrclParams;
   RPKIRouterClient        rrclInstance;
+  /** The RPKI data of this cache matches the serial of its last End of 
+   * Data. */
+  bool                    consistent;
+  /** The cache resets the session, the data that is not announced again is 
+   * removed with the next End of Data. */
+  bool                    resetPending;
+  /** The router keys announced since the last End of Data (RPKIRouterKey), 
+   * they are registered as one bulk with the End of Data. */
+  SList                   pendingKeys;
+} RPKICacheSession;
+
+/**
+ * A single RPKI/Router Handler.
+ */
+typedef struct {
+  PrefixCache*            prefixCache;
   ASPA_DBManager*         aspaDBManager;
   AspathCache*            aspathCache;
+  /** The sessions to the validation caches, the valCacheID of a session is 
+   * its index + 1. @since 0.6.3.0 */
+  RPKICacheSession        sessions[MAX_RPKI_CACHES];
+  /** The number of sessions. @since 0.6.3.0 */
+  uint8_t                 noSessions;
+  /** The announced router keys (RPKIRouterKey). @since 0.6.3.0 */
+  SList                   routerKeys;
+  /** The announced ASPA objects (RPKIASPARef). @since 0.6.3.0 */
+  SList                   aspaRefs;
+  /** Serializes the RPKI data changes and the snapshot. @since 0.6.3.0 */
+  Mutex                   snapMutex;
+  /** Serializes the End of Data of the sessions, they share the RPKI queue.
+   * @since 0.6.3.0 */
+  Mutex                   eodMutex;
 } RPKIHandler;
 
 /**
  * Initializes the instance, registers an existing Prefix Cache and creates
- * a RPKI/Router Client instance.
+ * one RPKI/Router Client instance per configured validation cache.
  *
  * @param self Variable that should be initialized
  * @param prefixCache Existing cache that should be registered
- * @param serverHost RPKI/Router protocol server host name
- * @param serverPort RPKI/Router protocol server port number
+ * @param aspathCache The AS path cache.
+ * @param aspaDBManager The ASPA database.
+ * @param config The configuration with the validation caches.
+ * @param snapshot The snapshot to restore the RPKI data, the AS path cache,
+ *                 and the update cache from. The sessions are resumed with a
+ *                 serial query. NULL starts from scratch.
  * @return \c true = all went through, \c false = an error occurred
  */
 bool createRPKIHandler(RPKIHandler* self, PrefixCache* prefixCache,
                        AspathCache* aspathCache, ASPA_DBManager* aspaDBManager,
-                       const char* serverHost, int serverPort, int version);
+                       Configuration* config, SnapshotReader* snapshot);
+
+/**
+ * Write the RTR session, the RPKI data, the AS path cache, and the update 
+ * cache into the snapshot. Changes of the RPKI data are blocked while writing.
+ *
+ * @param self The handler.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the snapshot could not be written or the RPKI data of no
+ *         validation cache is in sync with an End of Data.
+ *
+ * @since 0.6.3.0
+ */
+bool writeRPKIHandlerSnapshot(RPKIHandler* self, SnapshotWriter* writer);
 
 /**
  * Frees all resources.
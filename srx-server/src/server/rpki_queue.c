@@ -48,6 +48,9 @@
 #include "shared/srx_identifier.h"
 #include "util/log.h"
 
+/** Initial number of slots of the update id index (power of 2) */
+#define _RQ_INDEX_INIT_SLOTS 256
+
 /** The Queue element */
 typedef struct _rpki_queue_list_elem {
   /** Pointer to the next element */
@@ -61,8 +64,14 @@ typedef struct _rpki_queue_list_elem {
 typedef struct {
   /** The queues head element */
   _RPKI_QUEUE_LIST_ELEM* head;
+  /** The queues tail element */
+  _RPKI_QUEUE_LIST_ELEM* tail;
   /** Count the number of elements in the queue. */
   uint32_t size;
+  /** Index of the queued elements by update id (open addressing) */
+  _RPKI_QUEUE_LIST_ELEM** index;
+  /** Number of slots in the index (power of 2) */
+  uint32_t indexSlots;
   /** For thread safety */
   sem_t semaphore;
 } _RPKI_QUEUE;
@@ -137,6 +146,113 @@ static _RPKI_QUEUE_LIST_ELEM* __rq_createQueueElem(e_RPKI_QUEUE_REASON reason,
   return listElem;
 }
 
+/**
+ * Return the index slot of the given update id. If the update id is not 
+ * queued the returned slot is the empty slot where it would be placed. 
+ * 
+ * @param rQueue The _RPKI queue, its index must exist.
+ * @param updateID The SRx Update ID
+ * 
+ * @return The index slot position.
+ * 
+ * @since 0.6.3.0
+ */
+static uint32_t __rq_indexPos(_RPKI_QUEUE* rQueue, SRxUpdateID* updateID)
+{
+  uint32_t mask = rQueue->indexSlots - 1;
+  uint32_t hash = *updateID * 0x9E3779B1u;
+  uint32_t pos  = (hash ^ (hash >> 16)) & mask;
+  
+  while (   (rQueue->index[pos] != NULL)
+         && (compareSrxUpdateID(&rQueue->index[pos]->elem.updateID, updateID, 
+                                SRX_UID_BOTH) != 0))
+  {
+    pos = (pos + 1) & mask;
+  }
+  
+  return pos;
+}
+
+/**
+ * Make sure the index has room for one more element. The index is kept at 
+ * most half filled.
+ * 
+ * @param rQueue The _RPKI queue.
+ * 
+ * @return false if the index is full and could not be resized.
+ * 
+ * @since 0.6.3.0
+ */
+static bool __rq_indexReserve(_RPKI_QUEUE* rQueue)
+{
+  bool retVal = true;
+  
+  if (((rQueue->size + 1) * 2) > rQueue->indexSlots)
+  {
+    _RPKI_QUEUE_LIST_ELEM** oldIndex = rQueue->index;
+    uint32_t oldSlots = rQueue->indexSlots;
+    uint32_t slots    = (oldSlots == 0) ? _RQ_INDEX_INIT_SLOTS : oldSlots * 2;
+    _RPKI_QUEUE_LIST_ELEM** index = calloc(slots, 
+                                           sizeof(_RPKI_QUEUE_LIST_ELEM*));
+    uint32_t idx = 0;
+    
+    if (index != NULL)
+    {
+      rQueue->index      = index;
+      rQueue->indexSlots = slots;
+      for (idx = 0; idx < oldSlots; idx++)
+      {
+        if (oldIndex[idx] != NULL)
+        {
+          index[__rq_indexPos(rQueue, &oldIndex[idx]->elem.updateID)] 
+            = oldIndex[idx];
+        }
+      }
+      free(oldIndex);
+    }
+    else
+    {
+      retVal = rQueue->size < rQueue->indexSlots;
+    }
+  }
+  
+  return retVal;
+}
+
+/**
+ * Remove the given list element from the index. The following elements of 
+ * the probe sequence are shifted back.
+ * 
+ * @param rQueue The _RPKI queue.
+ * @param listElem The list element to be removed.
+ * 
+ * @since 0.6.3.0
+ */
+static void __rq_indexDel(_RPKI_QUEUE* rQueue, _RPKI_QUEUE_LIST_ELEM* listElem)
+{
+  uint32_t mask = rQueue->indexSlots - 1;
+  uint32_t pos  = __rq_indexPos(rQueue, &listElem->elem.updateID);
+  uint32_t next = (pos + 1) & mask;
+  uint32_t hash = 0;
+  uint32_t home = 0;
+
+  rQueue->index[pos] = NULL;
+  while (rQueue->index[next] != NULL)
+  {
+    hash = rQueue->index[next]->elem.updateID * 0x9E3779B1u;
+    home = (hash ^ (hash >> 16)) & mask;
+    // Move the element into the hole if its home slot is not located between
+    // the hole and its current position.
+    if (((next - home) & mask) >= ((next - pos) & mask))
+    {
+      rQueue->index[pos]  = rQueue->index[next];
+      rQueue->index[next] = NULL;
+      pos = next;
+    }
+    next = (next + 1) & mask;
+  }
+}
+
 /**
  * Fills the given data with the next element of the queue and removed the queue
  * element and returns 'true'. 
@@ -165,6 +281,11 @@ static bool _rq_dequeue(_RPKI_QUEUE* rQueue, RPKI_QUEUE_ELEM* elem)
     // remove the list element from the top of the queue
     _RPKI_QUEUE_LIST_ELEM* listElem = rQueue->head;
     rQueue->head = listElem->next;
+    if (rQueue->head == NULL)
+    {
+      rQueue->tail = NULL;
+    }
+    __rq_indexDel(rQueue, listElem);
     rQueue->size--;
 
     // copy the queue element into the return value
@@ -220,6 +341,7 @@ void rq_releaseQueue(RPKI_QUEUE* queue)
     _RPKI_QUEUE* rQueue = (_RPKI_QUEUE*)queue;
     rq_empty(rQueue);
     sem_destroy(&rQueue->semaphore);
+    free(rQueue->index);
     memset(rQueue, 0, sizeof(_RPKI_QUEUE));
     free(rQueue);    
   }
@@ -239,55 +361,45 @@ void rq_queue(RPKI_QUEUE* queue,
               e_RPKI_QUEUE_REASON reason, SRxUpdateID* updateID)
 {
   // Each update id is listed only once. New elements will be added to the end 
-  // of the list. While walking through the list to the end, each element will 
-  // be compared to the new element and possibly updated. 
-  // this means if none is found the end will be reached and the update will be 
-  // added.
+  // of the list. The index allows to find an already queued element without
+  // walking the list, in this case only its reason will be updated.
   if (queue != NULL)
   {
     _RPKI_QUEUE* rQueue = (RPKI_QUEUE*)queue;
     
     if (_rq_lock(rQueue))
     {
-      _RPKI_QUEUE_LIST_ELEM* listElem = rQueue->head;
-      bool added = false;
+      _RPKI_QUEUE_LIST_ELEM* listElem = NULL;
+      uint32_t pos = 0;
 
-      if (listElem != NULL)
-      {    
-        while (!added)
+      if (__rq_indexReserve(rQueue))
+      {
+        pos = __rq_indexPos(rQueue, updateID);
+        listElem = rQueue->index[pos];
+        if (listElem != NULL)
+        {
+          // already added, combine the reasons.
+          listElem->elem.reason |= reason;
+        }
+        else
         {
-          if (compareSrxUpdateID(&listElem->elem.updateID, updateID, SRX_UID_BOTH) 
-              != 0)
+          listElem = __rq_createQueueElem(reason, updateID);
+          rQueue->index[pos] = listElem;
+          if (rQueue->tail != NULL)
           {
-            // Not the same, move on
-            if (listElem->next != NULL)
-            {
-              listElem = listElem->next;
-            }
-            else
-            {
-              listElem->next = __rq_createQueueElem(reason, updateID);
-              added = true;
-              rQueue->size++;
-            }
+            rQueue->tail->next = listElem;
           }
           else
           {
-            // already added, maybe the reason myst be updated
-            added = true;
-            if (listElem->elem.reason != reason)
-            {
-              // Set it to both if the reason is different. If in the future more
-              // reasons are added then this needs to be modified.
-              listElem->elem.reason = RQ_ALL;
-            }
+            rQueue->head = listElem;
           }
+          rQueue->tail = listElem;
+          rQueue->size++;
         }
       }
       else
       {
-        rQueue->head = __rq_createQueueElem(reason, updateID);
-        rQueue->size++;
+        LOG(LEVEL_ERROR, "Could not resize the RPKI QUEUE index");
       }
 
       _rq_unlock(rQueue);
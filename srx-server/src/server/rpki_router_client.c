@@ -121,6 +121,7 @@
 #include <string.h>
 #include <arpa/inet.h>
 #include <signal.h>
+#include "server/metrics.h"
 #include "server/rpki_queue.h"
 #include "server/rpki_router_client.h"
 #include "server/rpki_packet_printer.h"
@@ -142,8 +143,8 @@
 // Maximum errors during PDU processing
 #define RRC_MAX_ERRCT  10
 
-/** The file descriptor for the rpki_router_client. */
-int g_rpki_single_thread_client_fd;
+/** The file descriptor of the rpki_router_client of this thread. */
+__thread int g_rpki_single_thread_client_fd = -1;
 
 /**
  * Handle received IPv4 Prefixes.
@@ -628,6 +629,8 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
       continue;
     }
     hdr = (RPKICommonHeader*)byteBuffer;
+    uint64_t start = metricsNow();
+    countRTRPdu(hdr->type);
     
     LOG(LEVEL_DEBUG, HDR "Received RPKI-RTR PDU[%u] length=%u\n",
                      pthread_self(), hdr->type, ntohl(hdr->length));
@@ -714,17 +717,37 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
         {
           client->sessionIDChanged = true;
           // Mark the clients cache DB as stale.
-          client->params->sessionIDChangedCallback(client->routerClientID, 
-                                                   sessionID);
-          // @TODO: Fix Session ID. 
-          // Only in case the previous message was a "Request Query" the session
+          if (client->params->sessionIDChangedCallback != NULL)
+          {
+            client->params->sessionIDChangedCallback(client->routerClientID, 
+                                                     sessionID);
+          }
+          // Only in case the previous message was a "Reset Query" the session
           // ID is allowed to change. RFC8210 5.5 2nd paragraph
-          if (client->lastSent != PDU_TYPE_CACHE_RESET)
+          if (client->lastSent != PDU_TYPE_RESET_QUERY)
           {
             keepGoing = false;
             *errCode = RPKI_EC_CORRUPT_DATA;
           }
+          else
+          {
+            // The data of the old session is replaced below.
+            client->sessionID        = sessionID;
+            client->sessionIDChanged = false;
+          }
         }
+        if (keepGoing && (client->lastSent == PDU_TYPE_RESET_QUERY))
+        {
+          // The cache sends the complete data, the data received so far is 
+          // replaced. The handler keeps it until the End of Data. 
+          if (client->hasData)
+          {
+            client->params->resetCallback(client->routerClientID, 
+                                          client->rpkiHandler);
+          }
+          client->synchronized = false;
+        }
+        client->hasData = true;
         break;
       case PDU_TYPE_IP_V4_PREFIX :
         handleIPv4Prefix(client, (RPKIIPv4PrefixHeader*)byteBuffer);
@@ -738,6 +761,7 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
         {
           // store not byte-swapped
           client->serial = ((RPKIEndOfDataHeader*)byteBuffer)->serial;
+          client->synchronized = true;
           // Now process the RPKI_QUEUE
           handleEndOfData(client, (RPKIEndOfDataHeader*)byteBuffer);
           // Stop the client is only one data poll is to be done.
@@ -763,6 +787,7 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
         break;
       case PDU_TYPE_CACHE_RESET:
         // Reset our cache
+        client->synchronized = false;
         client->params->resetCallback(client->routerClientID, 
                                       client->rpkiHandler);
         // Respond with a cache reset
@@ -801,6 +826,7 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
     }
     // Set the last received PDU
     client->lastRecv = hdr->type;
+    recordMetric(MET_STAGE_RTR_PDU, MET_NO_CLIENT, start);
   }
   
   // Now do error handling but only if not in handshake mode.
@@ -931,7 +957,6 @@ static void* manageConnection (void* clientPtr)
   sigaction(SIGPIPE, &act, NULL);
   pthread_sigmask(SIG_UNBLOCK, &errmask, NULL);
   pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-  g_rpki_single_thread_client_fd = client->clSock.clientFD;
 
 
   LOG (LEVEL_DEBUG, "([0x%08X]) > RPKI Router Client Thread started!",
@@ -939,14 +964,44 @@ static void* manageConnection (void* clientPtr)
     
   while (!client->stop)
   {
-    // Start off every new connection with a reset
-    if (sendResetQuery(client))
+    g_rpki_single_thread_client_fd = client->clSock.clientFD;
+    // Start off every new connection with a reset, a session restored from a
+    // snapshot or a session whose connection was lost continues with a serial
+    // query.
+    client->lastRecv = PDU_TYPE_RESERVED;
+    if (client->resume ? sendSerialQuery(client) : sendResetQuery(client))
     {
       // Receive and process all PDUs - This is a loop until the connection
       // is either lost, closed, or the end of data is received (single request)
       // Modified call with 0.5.0.0 to use variable as second parameter rather
       // than false
       receivePDUs(client, client->stopAfterEndOfData, &errCode, true);      
+      if (client->resume)
+      {
+        client->resume = false;
+        if (client->lastRecv == PDU_TYPE_CACHE_RESET)
+        {
+          // The cache can not provide the changes. receivePDUs called the 
+          // resetCallback and sent the reset query already, the new session
+          // ID is accepted.
+          LOG(LEVEL_INFO, HDR "Session can not be resumed, reset the data!",
+              pthread_self());
+          client->startup = true;
+          receivePDUs(client, client->stopAfterEndOfData, &errCode, true);
+        }
+        else if (client->lastRecv == PDU_TYPE_RESERVED)
+        {
+          // The connection is down, keep the data and try again.
+          client->resume = true;
+        }
+        else if (client->lastRecv != PDU_TYPE_CACHE_RESPONSE)
+        {
+          // Drop the restored data, the next attempt starts from scratch.
+          client->params->resetCallback(client->routerClientID, 
+                                        client->rpkiHandler);
+          client->startup = true;
+        }
+      }
       // Check the expected response, 
       switch (client->lastRecv)
       {
@@ -981,6 +1036,9 @@ static void* manageConnection (void* clientPtr)
               }
           }
           break;
+        case PDU_TYPE_RESERVED:
+          // Nothing received, the connection is lost again.
+          break;
         default:
           RAISE_ERROR("Unexpected protocol behavior, type=%u!", 
                       client->lastRecv);
@@ -1019,6 +1077,10 @@ static void* manageConnection (void* clientPtr)
     client->clSock.reconnect = !client->stop;
     reconnectToServer(&client->clSock, sec, MAX_RECONNECTION_ATTEMPTS);
 
+    // The cache only needs to send the changes since the last End of Data,
+    // the data received so far stays valid.
+    client->resume = client->synchronized && !client->startup;
+
     // See if the session_id changed!
     if (client->sessionIDChanged)
     {
@@ -1133,8 +1195,21 @@ bool createRPKIRouterClient (RPKIRouterClient* self,
   self->sessionIDChanged = false;
   self->startup          = true;
 
-  self->routerClientID   = createRouterClientID(self);
+  self->routerClientID   = params->valCacheID != 0 
+                           ? params->valCacheID : createRouterClientID(self);
   self->version          = params->version;
+  // The data of a restored session was received already.
+  self->hasData          = params->resumeSession;
+  self->synchronized     = params->resumeSession;
+
+  // Continue the session of the snapshot. The session ID is fixed already.
+  self->resume = params->resumeSession;
+  if (self->resume)
+  {
+    self->sessionID = htons(params->resumeSessionID);
+    self->serial    = htonl(params->resumeSerial);
+    self->startup   = false;
+  }
 
   ret = pthread_create (&self->thread, NULL, manageConnection, self);
   if (ret)
@@ -358,6 +358,22 @@ typedef struct {
    * (def: 7200 sec -> 2 hours)
    * @since 0.6.2.1 */
   uint32_t expireInterval;
+  /** Continue the session given by resumeSessionID and resumeSerial with a 
+   * serial query instead of starting with a reset query. In case the cache
+   * answers with a cache reset or an error, the resetCallback is called and 
+   * the session starts from scratch.
+   * @since 0.6.3.0 */
+  bool     resumeSession;
+  /** The session ID to be resumed (host format).
+   * @since 0.6.3.0 */
+  uint16_t resumeSessionID;
+  /** The serial of the last End of Data of the resumed session (host format).
+   * @since 0.6.3.0 */
+  uint32_t resumeSerial;
+  /** The ID of the validation cache handed to the callbacks. It MUST be unique
+   * if multiple clients share the callbacks. 0 uses createRouterClientID.
+   * @since 0.6.3.0 */
+  uint32_t valCacheID;
 } RPKIRouterClientParams;
 
 /**
@@ -409,6 +425,17 @@ typedef struct {
   bool                    stopAfterEndOfData;
   /** RTR-to-Cache protocol version info */
   int8_t                  version;
+  /** The first query is a serial query for the resumed session.
+   * @since 0.6.3.0 */
+  bool                    resume;
+  /** Data was received from the cache. A later reset query replaces it, the
+   * resetCallback is called once the cache responds.
+   * @since 0.6.3.0 */
+  bool                    hasData;
+  /** The data is in sync with the serial of an End of Data. After a
+   * connection loss the session is resumed with a serial query.
+   * @since 0.6.3.0 */
+  bool                    synchronized;
 } RPKIRouterClient;
 
 /**
@@ -480,7 +507,7 @@ bool sendErrorReport(RPKIRouterClient* client, uint16_t errCode,
 // @TODO: fix this not so nice work around
 // In ROCKY this throws a linker error. The solution is to declare it extern here and then
 // make the proper declaration in rpki_routewr_client.c
-extern int g_rpki_single_thread_client_fd;
+extern __thread int g_rpki_single_thread_client_fd;
 
 void generalSignalProcess(void);
 
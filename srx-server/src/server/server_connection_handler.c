@@ -80,6 +80,8 @@
  #include "server/server_connection_handler.h"
  #include "server/srx_packet_sender.h"
  #include "server/aspath_cache.h"
+ #include "server/metrics.h"
+ #include "server/trace.h"
  #include "shared/srx_identifier.h"
  #include "server/ski_cache.h"
  #include "shared/srx_packets.h"
@@ -496,6 +498,8 @@ bool createServerConnectionHandler(ServerConnectionHandler* self,
       self->aspathCache = aspathCache;
       self->skiCache = skiCache;
       self->sysConfig = sysConfig;
+      // Set by the command handler
+      self->cryptoPool = NULL;
 
       if (!sysConfig->mode_no_receivequeue)
       {
@@ -569,6 +573,10 @@ bool processValidationRequest(ServerConnectionHandler* self,
   LOG(LEVEL_DEBUG, HDR "Enter processValidationRequest", pthread_self());
 
   bool retVal = true;
+  // The credit of the request is returned by the command handler if queued.
+  bool queued = false;
+  // The update ID is not known yet, take the time and decide on it later.
+  uint64_t received = traceTime();
 
   // Determine if a receipt is requested and a result packet must be send
   bool     receipt =    (hdr->flags & SRX_FLAG_REQUEST_RECEIPT)
@@ -676,6 +684,10 @@ bool processValidationRequest(ServerConnectionHandler* self,
       " could have been [0x%08X] but was changed to a collision free ID "
       "[0x%08X]!", collisionID, updateID);
   }
+  if (isUpdateTraced(updateID))
+  {
+    traceUpdateAt(updateID, TRC_POINT_RECEIVE, received);
+  }
 
   //  3. Try to find the update, if it does not exist yet, store it.
   SRxResult        srxRes;
@@ -691,8 +703,8 @@ bool processValidationRequest(ServerConnectionHandler* self,
                                     clientID, clientMapping,
                                     &srxRes, &defResInfo, &pathId);
   
-  LOG(LEVEL_INFO, FILE_LINE_INFO "\033[1;33m ------- Received ASpath info ------- \033[0m");
-  LOG(LEVEL_INFO, "     updateId: [0x%08X] pathID: [0x%08X] "
+  LOG(LEVEL_DEBUG, FILE_LINE_INFO "\033[1;33m ------- Received ASpath info ------- \033[0m");
+  LOG(LEVEL_DEBUG, "     updateId: [0x%08X] pathID: [0x%08X] "
       " AS Type: %s  AS Relationship: %s", 
       updateID, pathId, 
       asType==2 ? "AS_SEQUENCE": (asType==1 ? "AS_SET": "ETC"),
@@ -721,7 +733,7 @@ bool processValidationRequest(ServerConnectionHandler* self,
   if (pathId == 0)  // if not found in  cEntry
   {
     pathId = makePathId(bgpData.numberHops, bgpData.asPath, asType, true);
-    LOG(LEVEL_INFO, FILE_LINE_INFO " generated Path ID : %08X ", pathId);
+    LOG(LEVEL_DEBUG, FILE_LINE_INFO " generated Path ID : %08X ", pathId);
 
     // to see if there is already exist or not in AS path Cache with path id
     aspl = getAspathListFromAspathCache (self->aspathCache, pathId, &srxRes_aspa);
@@ -733,7 +745,7 @@ bool processValidationRequest(ServerConnectionHandler* self,
       //  this value is some value not undefined
       if (srxRes_aspa.aspaResult == SRx_RESULT_UNDEFINED)
       {
-        LOG(LEVEL_INFO, FILE_LINE_INFO " Already registered with the previous pdu");
+        LOG(LEVEL_DEBUG, FILE_LINE_INFO " Already registered with the previous pdu");
       }
       else
       {
@@ -742,7 +754,7 @@ bool processValidationRequest(ServerConnectionHandler* self,
         // makes not found in updatecahe. So this case makes not found pathId, but aspath cache 
         // stores srx result value in db with the matched path id. So srxRes_aspa.aspaResult is
         // not undefined
-        LOG(LEVEL_INFO, FILE_LINE_INFO " ASPA validation Result[%d] is already exist", srxRes_aspa.aspaResult);
+        LOG(LEVEL_DEBUG, FILE_LINE_INFO " ASPA validation Result[%d] is already exist", srxRes_aspa.aspaResult);
 
         // Modify UpdateCache's srx Res -> aspaResult with srxRes_aspa.aspaResult
         // But UpdateCache's cEntry here dosen't exist yet
@@ -811,6 +823,7 @@ bool processValidationRequest(ServerConnectionHandler* self,
       // Maybe check for ID conflict, if not then get result again - or just
       // quit here!
       free(prefix);
+      returnClientCredit(client);
       return false;
     }
 
@@ -885,6 +898,16 @@ bool processValidationRequest(ServerConnectionHandler* self,
       RAISE_ERROR("Could not add validation request to command queue!");
       retVal = false;
     }
+    else
+    {
+      traceUpdate(updateID, TRC_POINT_QUEUED);
+      queued = true;
+    }
+  }
+
+  if (!queued)
+  {
+    returnClientCredit(client);
   }
 
   LOG(LEVEL_DEBUG, HDR "Exit processValidationRequest", pthread_self());
@@ -1656,6 +1679,59 @@ static bool processSignatureRequest(ServerConnectionHandler* self,
   return retVal;
 }
 
+/**
+ * Attach the shared memory channel offered within the hello packet if the
+ * configuration allows it. Once attached all further packets of the proxy are
+ * received through the channel. The hello response tells the proxy.
+ *
+ * @param self The server connection handler
+ * @param client The client thread the hello packet was received on
+ * @param hdr The hello packet
+ * @param length The length of the hello packet
+ *
+ * @note MUST be called within the receiver thread of the client.
+ *
+ * @since 0.6.3.0
+ */
+static void _attachSharedMemory(ServerConnectionHandler* self,
+                                ServerClient* client, SRXPROXY_HELLO* hdr,
+                                PacketLength length)
+{
+  uint32_t noPeers  = ntohl(hdr->noPeers);
+  uint32_t offerPos = 0;
+  SRXPROXY_SHM_OFFER* offer = NULL;
+  char name[SRX_SHM_NAME_LENGTH];
+
+  if (   ((hdr->reserved8 & SRX_PROXY_FLAG_SHM) == 0)
+      || !self->sysConfig->mode_shm_transport)
+  {
+    return;
+  }
+  offerPos = (noPeers <= length / 4) ? sizeof(SRXPROXY_HELLO) + (noPeers * 4)
+                                      : length;
+  if (length < offerPos + sizeof(SRXPROXY_SHM_OFFER))
+  {
+    LOG(LEVEL_WARNING, HDR "Hello packet with invalid shared memory offer!",
+                       pthread_self());
+    return;
+  }
+
+  offer = (SRXPROXY_SHM_OFFER*)((uint8_t*)hdr + offerPos);
+  snprintf(name, SRX_SHM_NAME_LENGTH, "%s", offer->name);
+  if (attachClientShm(client, name))
+  {
+    LOG(LEVEL_INFO, "Proxy [0x%08X] uses the shared memory transport (%s, %u "
+                    "bytes)", ntohl(hdr->proxyIdentifier), name, 
+                    ntohl(offer->ringSize));
+  }
+  else
+  {
+    LOG(LEVEL_INFO, "Shared memory transport offered by proxy [0x%08X] could "
+                    "not be attached, continue using TCP.", 
+                    ntohl(hdr->proxyIdentifier));
+  }
+}
+
 /**
  * SRx receives a packet from one of the proxy clients. This method is called
  * before the command handler will see the request. This will be decided in this
@@ -1680,6 +1756,7 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
                          void* srvConHandler)
 {
   LOG(LEVEL_DEBUG, HDR "Enter handlePacket", pthread_self());
+  uint64_t start = metricsNow();
   // print raw packet data for debugging
   hexDump(packet, length);
   // Check if the packet is valid and has the minimum required length
@@ -1701,6 +1778,13 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
 
   bool addToQueue = false;
 
+  countClientPacket(clientThread->routerID, length,
+                       (length >= sizeof(SRXPROXY_BasicHeader))
+                    && (   (((SRXPROXY_BasicHeader*)packet)->type 
+                            == PDU_SRXPROXY_VERIFY_V4_REQUEST)
+                        || (((SRXPROXY_BasicHeader*)packet)->type 
+                            == PDU_SRXPROXY_VERIFY_V6_REQUEST)));
+
   // No data?
   if (length < sizeof(SRXPROXY_BasicHeader))
   {
@@ -1721,6 +1805,7 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
           // initialized!!!
           RAISE_SYS_ERROR("Connection not initialized yet - "
                           "Handshake missing!!!");
+          returnClientCredit(client);
           sendError(SRXERR_INTERNAL_ERROR, svrSock, client, false);
           sendGoodbye(svrSock, client, false);
           //TODO: Also close the socket and remove the thread
@@ -1767,7 +1852,7 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
         }
       break;
       case PDU_SRXPROXY_SIGTRA_VALIDATION_REQUEST:
-        LOG(LEVEL_INFO,  "Received PDU_SRXPROXY_SIGTRA__VALIDATION_REQUEST");
+        LOG(LEVEL_DEBUG, "Received PDU_SRXPROXY_SIGTRA__VALIDATION_REQUEST");
         SRXPROXY_SIGTRA_VALIDATION_REQUEST* valReq = (SRXPROXY_SIGTRA_VALIDATION_REQUEST*)packet;
         bool val_result = processSigtraValidationRequest(self, svrSock, client, valReq);
         printf("Validation result: %d\n", val_result);
@@ -1778,7 +1863,7 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
         }
         break;
       case PDU_SRXPROXY_SIGTRA_GENERATION_REQUEST:
-        LOG(LEVEL_INFO,  "Received PDU_SRXPROXY_SIGTRA_GENERATION_REQUEST");
+        LOG(LEVEL_DEBUG, "Received PDU_SRXPROXY_SIGTRA_GENERATION_REQUEST");
         SRXPROXY_SIGTRA_GENERATION_REQUEST* genReq = (SRXPROXY_SIGTRA_GENERATION_REQUEST*)packet;
         bool gen_result = processSigtraGenerationRequest(self, svrSock, client, genReq);
         break;  
@@ -1887,6 +1972,7 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
                    dataID, length, (uint8_t*)packet);
     }
   }
+  recordMetric(MET_STAGE_RECEIVE, clientThread->routerID, start);
   LOG(LEVEL_DEBUG, HDR "Exit handlePacket", pthread_self());
 }
 
@@ -1916,6 +2002,29 @@ void handlePacket(ServerSocket* svrSock, ServerClient* client,
   ServerConnectionHandler* handler = (ServerConnectionHandler*)srvConHandler;
   SCH_ReceiverQueue* queue = (SCH_ReceiverQueue*)handler->receiverQueue;
   LOG(LEVEL_DEBUG, HDR "Enter regular handle packet");
+  // Switch the receiver before the next packet of the proxy is read.
+  if (   (length >= sizeof(SRXPROXY_HELLO))
+      && (((SRXPROXY_BasicHeader*)packet)->type == PDU_SRXPROXY_HELLO)
+      && ((ClientThread*)client)->active
+      && !((ClientThread*)client)->initialized)
+  {
+    _attachSharedMemory(handler, client, (SRXPROXY_HELLO*)packet, length);
+  }
+  // Stop reading from a proxy that has its window of validation requests 
+  // outstanding. The credit is returned once the request is processed.
+  if (   (length >= sizeof(SRXPROXY_BasicHeader))
+      && (   (((SRXPROXY_BasicHeader*)packet)->type 
+              == PDU_SRXPROXY_VERIFY_V4_REQUEST)
+          || (((SRXPROXY_BasicHeader*)packet)->type 
+              == PDU_SRXPROXY_VERIFY_V6_REQUEST)))
+  {
+    if (!acquireClientCredit(client))
+    {
+      LOG(LEVEL_DEBUG, HDR "Drop validation request of a disconnected proxy",
+                       pthread_self());
+      return;
+    }
+  }
   if (queue == NULL)
   {
     LOG(LEVEL_DEBUG, HDR "Enter regular handle packet -> if ");
@@ -1962,6 +2071,11 @@ static bool handleStatusChange(ServerSocket* svrSock, ServerClient* client,
       RAISE_SYS_ERROR("Not enough memory to handle the new connection!");
       retVal = false;
     }
+    else if (!createClientSendQueue(svrSock, client))
+    {
+      LOG(LEVEL_WARNING, "Could not create the send queue of the new "
+                         "connection, send the packets directly!");
+    }
   }
   else
   {
@@ -1972,6 +2086,8 @@ static bool handleStatusChange(ServerSocket* svrSock, ServerClient* client,
     }
 
     deleteFromSList(&self->clients, client);
+    releaseClientSendQueue(client);
+    dropClientCryptoJobs(self->cryptoPool, client);
 
     bool crashed = !(self->inShutdown || clientThread->goodByeReceived);
     deactivateConnectionMapping(self, clientThread->routerID, crashed,
@@ -59,6 +59,7 @@
 
 #include "server/configuration.h"
 #include "server/command_queue.h"
+#include "server/crypto_worker.h"
 #include "server/update_cache.h"
  #include "server/ski_cache.h"
 #include "server/aspath_cache.h"
@@ -138,6 +139,10 @@ typedef struct {
   AspathCache*      aspathCache;
 
   SKI_CACHE*       skiCache;
+
+  // The crypto worker pool of the command handler, NULL if BGPsec is 
+  // processed within the command handler. since 0.6.3.0
+  CryptoWorkerPool* cryptoPool;
 } ServerConnectionHandler;
 
 /**
@@ -71,9 +71,16 @@
  * -------------------------------------------------------------------------
  * SKI;ASN;ALgoID | list   | _SKI_CACHE_DATA, _ski_cache_data (next)
  * -------------------------------------------------------------------------
- * UID            | list   | _SKI_CACHE_UPDATEID, _ski_cache_updateid (next)
+ * UID            | set    | _SKI_CACHE_UPDATEID [uidSlots] hashed by the ID
  * -------------------------------------------------------------------------
  * 
+ * In addition to the tree, each SKI;ASN;AlgoID element is stored in a hash 
+ * index (_SKI_CACHE::index) keyed by the <asn, ski, algoID> triplet. All 
+ * lookups use the index, the tree is only walked when a new element is 
+ * created or the cache is cleaned / examined. The UID set of each data 
+ * element is a small open addressing hash table, this allows to register and
+ * unregister an update in constant time.
+ * 
  * 
  * +---+
  * |   |       Array (element)
@@ -120,17 +127,19 @@
 #define _SKI_MAX_ALGOIDS 2
 /** The size of the SRxUpdateID*/
 #define _SRX_UPDATE_ID_SIZE 4
+/** Initial number of slots of an update id set (power of 2) */
+#define _SKI_UID_INIT_SLOTS 4
+/** Initial number of slots of the data index (power of 2) */
+#define _SKI_INDEX_INIT_SLOTS 1024
 
 #define _SKI_ERR_CACHE_NULL "RPKI Cache is not initialized (NULL)"
 #define _SKI_ERR_NO_LOCK    "Could not aquire cache lock!"
 #define _SKI_ERR_BGPSEC     "Error during parsing the BGPsec_PATH attribute!"
 
-/** This structure is a single linked list of update id's */
-typedef struct _ski_cache_updateid
+/** This structure is a single slot in the update id set of a data element */
+typedef struct
 {
-  /** Pointer to the next update id. */
-  struct _ski_cache_updateid* next;
-  /** The update id. */
+  /** The update id, zero marks an empty slot. */
   SRxUpdateID updateID;  
   /** A counter allowing multiple registrations. */
   uint16_t    counter;
@@ -151,8 +160,16 @@ typedef struct _ski_cache_data
   uint8_t     ski[SKI_LENGTH];
   /** The algorithm ID */
   uint8_t     algoID;
-  /** List of updates assigned to this data element */
+  /** Set of updates assigned to this data element (NULL if empty) */
   _SKI_CACHE_UPDATEID* cacheUID;  
+  /** Number of slots in the update set (power of 2) */
+  uint32_t    uidSlots;
+  /** Number of updates stored in the update set */
+  uint32_t    uidCount;
+  /** The hash value of the <asn, ski, algoID> triplet */
+  uint32_t    hash;
+  /** The algorithm ID element this data element is listed in */
+  struct _ski_cache_algo_id* cAlgoID;
 } _SKI_CACHE_DATA ;
 
 /** This struct is a simple linked list for algorithm ID*/
@@ -221,6 +238,12 @@ typedef struct {
   RPKI_QUEUE*        rpki_queue;
   /** The SKI cache root node. */
   _SKI_CACHE_NODE*   cacheNode;
+  /** Hash index of all data elements, open addressing (linear probing) */
+  _SKI_CACHE_DATA**  index;
+  /** Number of slots in the index (power of 2) */
+  uint32_t           indexSlots;
+  /** Number of data elements stored in the index */
+  uint32_t           indexCount;
   /** The tmpHelper is ONLY be used during walking the data structure. 
    * It is mainly needed to allow a cleanup of data and MUST be NULL during 
    * all times outside of the semaphore lock. */
@@ -236,61 +259,314 @@ typedef struct {
 ////////////////////////////////////////////////////////////////////////////////
 // Data Structure creation and Release
 ////////////////////////////////////////////////////////////////////////////////
-static _SKI_CACHE_DATA* ___ski_freeCacheData(_SKI_CACHE_DATA* cData);
+static _SKI_CACHE_DATA* ___ski_freeCacheData(_SKI_CACHE* sCache, 
+                                             _SKI_CACHE_DATA* cData);
 
 /**
- * Frees all memory allocated during creation of this element. It also will 
- * free the memory of uid if not shared!
+ * Return the hash value of the given <asn, ski, algoID> triplet (FNV-1a with
+ * a final avalanche step to spread the bits over the lower end).
+ * 
+ * @param asn The ASN in host format
+ * @param ski The SKI
+ * @param algoID The algorithm identifier
  * 
- * @param cUID The cache Update data.
+ * @return The hash value
  * 
- * @return Value of the internal next pointer
+ * @since 0.6.3.0
  */
-static _SKI_CACHE_UPDATEID* ___ski_freeCacheUID(_SKI_CACHE_UPDATEID* cUID)
+static uint32_t ___ski_hashData(uint32_t asn, uint8_t* ski, uint8_t algoID)
 {
-  _SKI_CACHE_UPDATEID* next = NULL;
-  if (cUID != NULL)
+  uint32_t hash = 2166136261u;
+  int idx = 0;
+  
+  for (idx = 0; idx < 4; idx++)
   {
-    next = cUID->next;
-    memset(cUID, 0, sizeof(_SKI_CACHE_UPDATEID));
-    free (cUID);
-  }  
+    hash = (hash ^ ((asn >> (idx * 8)) & 0xFF)) * 16777619u;
+  }
+  for (idx = 0; idx < SKI_LENGTH; idx++)
+  {
+    hash = (hash ^ ski[idx]) * 16777619u;
+  }
+  hash = (hash ^ algoID) * 16777619u;
+  hash ^= hash >> 16;
   
-  return next;          
+  return hash;
 }
 
 /**
- * Create a new Update Data list element only if upateID is not NULL and the 
- * value is not zero
+ * Return the hash value of the given update id.
  * 
- * @param updateID The SRx update id to be stored.
+ * @param updateID The update id
  * 
- * @return The ski cache update id or NULL if updateID is NULL or zero
+ * @return The hash value
+ * 
+ * @since 0.6.3.0
  */
-static _SKI_CACHE_UPDATEID* ___ski_createCacheUID(SRxUpdateID* updateID)
+static uint32_t ___ski_hashUID(SRxUpdateID updateID)
 {
-  _SKI_CACHE_UPDATEID* cUID = NULL;
-  if ((updateID != NULL) && (*updateID != 0))
+  uint32_t hash = updateID * 0x9E3779B1u;
+  
+  return hash ^ (hash >> 16);
+}
+
+/**
+ * Insert the data element into the given index array. The caller assures that
+ * at least one slot is free.
+ * 
+ * @param index The index array
+ * @param slots The number of slots in the array (power of 2)
+ * @param cData The data element to be added.
+ * 
+ * @since 0.6.3.0
+ */
+static void ___ski_indexInsert(_SKI_CACHE_DATA** index, uint32_t slots, 
+                               _SKI_CACHE_DATA* cData)
+{
+  uint32_t mask = slots - 1;
+  uint32_t pos  = cData->hash & mask;
+  
+  while (index[pos] != NULL)
+  {
+    pos = (pos + 1) & mask;
+  }
+  index[pos] = cData;
+}
+
+/**
+ * Add the data element to the hash index of the cache. The index grows once 
+ * it is half filled.
+ * 
+ * @param sCache The SKI cache
+ * @param cData The data element with its hash value already set.
+ * 
+ * @return false if the index could not be resized.
+ * 
+ * @since 0.6.3.0
+ */
+static bool __ski_indexAdd(_SKI_CACHE* sCache, _SKI_CACHE_DATA* cData)
+{
+  bool retVal = true;
+  
+  if (((sCache->indexCount + 1) * 2) > sCache->indexSlots)
+  {
+    uint32_t slots = (sCache->indexSlots == 0) ? _SKI_INDEX_INIT_SLOTS 
+                                               : sCache->indexSlots * 2;
+    _SKI_CACHE_DATA** index = calloc(slots, sizeof(_SKI_CACHE_DATA*));
+    if (index != NULL)
+    {
+      uint32_t idx = 0;
+      for (idx = 0; idx < sCache->indexSlots; idx++)
+      {
+        if (sCache->index[idx] != NULL)
+        {
+          ___ski_indexInsert(index, slots, sCache->index[idx]);
+        }
+      }
+      free(sCache->index);
+      sCache->index      = index;
+      sCache->indexSlots = slots;
+    }
+    else if (sCache->indexCount == sCache->indexSlots)
+    {
+      retVal = false;
+    }
+  }
+  
+  if (retVal)
+  {
+    ___ski_indexInsert(sCache->index, sCache->indexSlots, cData);
+    sCache->indexCount++;
+  }
+  else
+  {
+    LOG(LEVEL_ERROR, "Could not resize the SKI cache index!");
+  }
+  
+  return retVal;
+}
+
+/**
+ * Find the data element of the <asn, ski, algoID> triplet in the hash index.
+ * 
+ * @param sCache The SKI cache
+ * @param asn The ASN in host format
+ * @param ski The SKI
+ * @param algoID The algorithm identifier
+ * @param hash The hash value of the triplet.
+ * 
+ * @return The data element or NULL if not found.
+ * 
+ * @since 0.6.3.0
+ */
+static _SKI_CACHE_DATA* __ski_indexFind(_SKI_CACHE* sCache, uint32_t asn, 
+                                        uint8_t* ski, uint8_t algoID, 
+                                        uint32_t hash)
+{
+  _SKI_CACHE_DATA* cData = NULL;
+  
+  if (sCache->index != NULL)
+  {
+    uint32_t mask = sCache->indexSlots - 1;
+    uint32_t pos  = hash & mask;
+    while (sCache->index[pos] != NULL)
+    {
+      cData = sCache->index[pos];
+      if (   (cData->hash == hash) && (cData->asn == asn) 
+          && (cData->algoID == algoID)
+          && (memcmp(cData->ski, ski, SKI_LENGTH) == 0))
+      {
+        break;
+      }
+      cData = NULL;
+      pos = (pos + 1) & mask;
+    }
+  }
+  
+  return cData;
+}
+
+/**
+ * Remove the data element from the hash index. The following elements of the
+ * probe sequence are shifted back which makes tombstones unnecessary.
+ * 
+ * @param sCache The SKI cache
+ * @param cData The data element to be removed.
+ * 
+ * @since 0.6.3.0
+ */
+static void __ski_indexDel(_SKI_CACHE* sCache, _SKI_CACHE_DATA* cData)
+{
+  if (sCache->index != NULL)
+  {
+    uint32_t mask = sCache->indexSlots - 1;
+    uint32_t pos  = cData->hash & mask;
+    uint32_t next = 0;
+    uint32_t home = 0;
+    
+    while ((sCache->index[pos] != NULL) && (sCache->index[pos] != cData))
+    {
+      pos = (pos + 1) & mask;
+    }
+    
+    if (sCache->index[pos] == cData)
+    {
+      sCache->index[pos] = NULL;
+      sCache->indexCount--;
+      next = (pos + 1) & mask;
+      while (sCache->index[next] != NULL)
+      {
+        home = sCache->index[next]->hash & mask;
+        // Move the element into the hole if its home slot is not located 
+        // between the hole and its current position.
+        if (((next - home) & mask) >= ((next - pos) & mask))
+        {
+          sCache->index[pos]  = sCache->index[next];
+          sCache->index[next] = NULL;
+          pos = next;
+        }
+        next = (next + 1) & mask;
+      }
+    }
+  }
+}
+
+/**
+ * Frees the update id set of the given data element.
+ * 
+ * @param cData The cache data element.
+ * 
+ * @since 0.6.3.0
+ */
+static void ___ski_freeCacheUID(_SKI_CACHE_DATA* cData)
+{
+  if (cData->cacheUID != NULL)
+  {
+    memset(cData->cacheUID, 0, cData->uidSlots * sizeof(_SKI_CACHE_UPDATEID));
+    free (cData->cacheUID);
+  }
+  cData->cacheUID = NULL;
+  cData->uidSlots = 0;
+  cData->uidCount = 0;
+}
+
+/**
+ * Return the slot of the given update id within the update id set. If the 
+ * update id is not stored, the returned slot is the empty slot where it would
+ * be placed. The caller assures that the set exists.
+ * 
+ * @param cData The cache data element
+ * @param updateID The update id (not zero).
+ * 
+ * @return The update id slot.
+ * 
+ * @since 0.6.3.0
+ */
+static _SKI_CACHE_UPDATEID* ___ski_getCacheUIDSlot(_SKI_CACHE_DATA* cData, 
+                                                   SRxUpdateID updateID)
+{
+  uint32_t mask = cData->uidSlots - 1;
+  uint32_t pos  = ___ski_hashUID(updateID) & mask;
+  
+  while (   (cData->cacheUID[pos].updateID != 0)
+         && (cData->cacheUID[pos].updateID != updateID))
+  {
+    pos = (pos + 1) & mask;
+  }
+  
+  return &cData->cacheUID[pos];
+}
+
+/**
+ * Grow the update id set of the given data element, or create it if it does
+ * not exist yet.
+ * 
+ * @param cData The cache data element
+ * 
+ * @return false if not enough memory was available.
+ * 
+ * @since 0.6.3.0
+ */
+static bool ___ski_growCacheUID(_SKI_CACHE_DATA* cData)
+{
+  _SKI_CACHE_UPDATEID* oldSet   = cData->cacheUID;
+  uint32_t             oldSlots = cData->uidSlots;
+  uint32_t             slots    = (oldSlots == 0) ? _SKI_UID_INIT_SLOTS 
+                                                  : oldSlots * 2;
+  _SKI_CACHE_UPDATEID* newSet   = calloc(slots, sizeof(_SKI_CACHE_UPDATEID));
+  uint32_t idx = 0;
+  
+  if (newSet != NULL)
   {
-    cUID = malloc(sizeof(_SKI_CACHE_UPDATEID));
-    cUID->next = NULL;
-    // Set to the initial value. (BZ 1166)
-    cUID->counter = 1;
-    memcpy(&(cUID->updateID), updateID, LEN_SRxUpdateID);
+    cData->cacheUID = newSet;
+    cData->uidSlots = slots;
+    for (idx = 0; idx < oldSlots; idx++)
+    {
+      if (oldSet[idx].updateID != 0)
+      {
+        *___ski_getCacheUIDSlot(cData, oldSet[idx].updateID) = oldSet[idx];
+      }
+    }
+    free(oldSet);
+  }
+  else
+  {
+    LOG(LEVEL_ERROR, "Could not resize the update id set of the SKI cache!");
   }
   
-  return cUID;          
+  return newSet != NULL;
 }
 
 /**
  * Free all memory allocated with the algorithmID. This includes the complete
  * data tree. This function returns the next algorithmID is it exists.
  * 
+ * @param sCache The SKI cache whose index contains the data elements.
  * @param cAlgoID The algorithm ID tree to be removed.
  * 
  * @return The value of the next pointer
  */
-static _SKI_CACHE_ALGO_ID* ___ski_freeCacheAlgoID(_SKI_CACHE_ALGO_ID* cAlgoID)
+static _SKI_CACHE_ALGO_ID* ___ski_freeCacheAlgoID(_SKI_CACHE* sCache,
+                                                  _SKI_CACHE_ALGO_ID* cAlgoID)
 {
   _SKI_CACHE_ALGO_ID* next = NULL;
   if (cAlgoID != NULL)
@@ -298,7 +574,7 @@ static _SKI_CACHE_ALGO_ID* ___ski_freeCacheAlgoID(_SKI_CACHE_ALGO_ID* cAlgoID)
     next = cAlgoID->next;
     while (cAlgoID->cacheData != NULL)
     {
-      cAlgoID->cacheData = ___ski_freeCacheData(cAlgoID->cacheData);
+      cAlgoID->cacheData = ___ski_freeCacheData(sCache, cAlgoID->cacheData);
     }
     
     memset (cAlgoID, 0, sizeof(_SKI_CACHE_ALGO_ID));
@@ -325,13 +601,16 @@ static _SKI_CACHE_ALGO_ID* ___ski_createCacheAlgoID(uint8_t algoID)
 }
 
 /**
- * Free this given cache data object including all assigned update id's
+ * Free this given cache data object including all assigned update id's. The
+ * data object is also removed from the hash index.
  * 
+ * @param sCache The SKI cache whose index contains the data element.
  * @param data The cache data to be removed
  * 
  * @return The value of the next pointer.
  */
-static _SKI_CACHE_DATA* ___ski_freeCacheData(_SKI_CACHE_DATA* cData)
+static _SKI_CACHE_DATA* ___ski_freeCacheData(_SKI_CACHE* sCache, 
+                                             _SKI_CACHE_DATA* cData)
 {
   _SKI_CACHE_DATA* next = NULL;
   
@@ -339,11 +618,9 @@ static _SKI_CACHE_DATA* ___ski_freeCacheData(_SKI_CACHE_DATA* cData)
   {
     // Store the next pointer
     next = cData->next;
+    __ski_indexDel(sCache, cData);
     // Remove all update ids.
-    while (cData->cacheUID != NULL)
-    {
-      cData->cacheUID = ___ski_freeCacheUID(cData->cacheUID);
-    }
+    ___ski_freeCacheUID(cData);
     memset (cData, 0, sizeof(_SKI_CACHE_DATA));
     free (cData);
   }
@@ -357,24 +634,21 @@ static _SKI_CACHE_DATA* ___ski_freeCacheData(_SKI_CACHE_DATA* cData)
  * @param asn the ASN of the data node
  * @param ski the ski of the data node
  * @param algoID the algorithm identifier of the data node
- * @param updateID The update identifier (can be NULL)
+ * @param hash the hash value of the <asn, ski, algoID> triplet
  *
  * @return the SKI cache data
  */
 static _SKI_CACHE_DATA* ___ski_createCacheData(uint32_t asn, 
                                                uint8_t* ski, uint8_t algoID, 
-                                               SRxUpdateID* updateID)
+                                               uint32_t hash)
 {
   _SKI_CACHE_DATA* cData = malloc(sizeof(_SKI_CACHE_DATA));
   memset (cData, 0, sizeof(_SKI_CACHE_DATA));
   
   cData->asn    = asn;
   cData->algoID = algoID;
+  cData->hash   = hash;
   memcpy(cData->ski, ski, SKI_LENGTH);
-  if (updateID != NULL)
-  {
-    cData->cacheUID = ___ski_createCacheUID(updateID);
-  }
    
   return cData;
 }
@@ -384,11 +658,13 @@ static _SKI_CACHE_DATA* ___ski_createCacheData(uint32_t asn,
  * structure. This function returns the value of the next pointer.
  * This function is very expensive.
  * 
+ * @param sCache The SKI cache whose index contains the data elements.
  * @param cNode The cache node to be removed/
  * 
  * @return the next pointer
  */
-static _SKI_CACHE_NODE* ___ski_freeCacheNode(_SKI_CACHE_NODE* cNode)
+static _SKI_CACHE_NODE* ___ski_freeCacheNode(_SKI_CACHE* sCache, 
+                                             _SKI_CACHE_NODE* cNode)
 {
   _SKI_CACHE_NODE* next = NULL;
   
@@ -400,7 +676,7 @@ static _SKI_CACHE_NODE* ___ski_freeCacheNode(_SKI_CACHE_NODE* cNode)
     {
       while (cNode->as2[idx] != NULL)
       {
-        cNode->as2[idx] = ___ski_freeCacheAlgoID(cNode->as2[idx]);
+        cNode->as2[idx] = ___ski_freeCacheAlgoID(sCache, cNode->as2[idx]);
       }
     }
   }
@@ -448,19 +724,14 @@ bool ___ski_clean_cData(_SKI_CACHE_DATA* cData, e_SKI_clean type)
     {
       case SKI_CLEAN_ALL:
         cData->counter = 0;
-        while (cData->cacheUID != NULL)
-        {
-          cData->cacheUID = ___ski_freeCacheUID(cData->cacheUID);
-        }
+        ___ski_freeCacheUID(cData);
         break;
       case SKI_CLEAN_KEYS:
         cData->counter = 0;
         break;
       case SKI_CLEAN_UPDATES:
-        while (cData->cacheUID != NULL)
-        {
-          cData->cacheUID = ___ski_freeCacheUID(cData->cacheUID);
-        }
+        ___ski_freeCacheUID(cData);
+        break;
       default:
         LOG(LEVEL_ERROR, "Unknown Cleaning Type [%i]", type);
         break;
@@ -475,13 +746,15 @@ bool ___ski_clean_cData(_SKI_CACHE_DATA* cData, e_SKI_clean type)
 /**
  * Clean all elements connected to this algorithm ID if possible.
  * 
+ * @param sCache The SKI cache whose index contains the data elements.
  * @param cAlgoID the algorithm ID object to be cleaned.
  * @param type The type of cleaning.
  * 
  * @return true if this element can be freed and false if still some data is 
  *         attached.
  */
-bool ___ski_clean_cAlgoID(_SKI_CACHE_ALGO_ID* cAlgoID, e_SKI_clean type)
+bool ___ski_clean_cAlgoID(_SKI_CACHE* sCache, _SKI_CACHE_ALGO_ID* cAlgoID, 
+                          e_SKI_clean type)
 {
   bool canFree = false;
 
@@ -499,7 +772,7 @@ bool ___ski_clean_cAlgoID(_SKI_CACHE_ALGO_ID* cAlgoID, e_SKI_clean type)
     else
     {
       // can be freed.
-      cData = ___ski_freeCacheData(cData);
+      cData = ___ski_freeCacheData(sCache, cData);
       if (prev != NULL)
       {
         prev->next = cData;
@@ -522,12 +795,14 @@ bool ___ski_clean_cAlgoID(_SKI_CACHE_ALGO_ID* cAlgoID, e_SKI_clean type)
 /**
  * Clean all elements connected to this Data Node if possible.
  * 
+ * @param sCache The SKI cache whose index contains the data elements.
  * @param cNode The Cache node to be examined.
  * @param type The cleaning type
  * 
  * @return true if no other data is stored and this element can be freed
  */
-bool ___ski_clean_cNode(_SKI_CACHE_NODE* cNode, e_SKI_clean type)
+bool ___ski_clean_cNode(_SKI_CACHE* sCache, _SKI_CACHE_NODE* cNode, 
+                        e_SKI_clean type)
 {
   bool canFree = true;
   
@@ -541,9 +816,9 @@ bool ___ski_clean_cNode(_SKI_CACHE_NODE* cNode, e_SKI_clean type)
     cAlgoID = cNode->as2[idx];
     while (cAlgoID != NULL)
     {
-      if (___ski_clean_cAlgoID(cAlgoID, type))
+      if (___ski_clean_cAlgoID(sCache, cAlgoID, type))
       {
-        cAlgoID = ___ski_freeCacheAlgoID(cAlgoID);
+        cAlgoID = ___ski_freeCacheAlgoID(sCache, cAlgoID);
         if (prev == NULL)
         {
           // This is the head
@@ -657,70 +932,126 @@ static _SKI_CACHE_NODE* __ski_getCacheNode(_SKI_CACHE* sCache, uint16_t upper,
 }
 
 /**
- * Add the given update udentifier to the cache data object
+ * Add the given update udentifier to the cache data object. If the update is 
+ * already registered its registration counter is increased.
  * 
  * @param cacheData The cache data object
- * @param updateID the update identifier
- * @param shared specifies if this identifier is shared.
+ * @param updateID the update identifier (zero is ignored)
  */
 static void __ski_addUpdateCacheUID(_SKI_CACHE_DATA* cacheData, 
                                     SRxUpdateID* updateID)
 {
   _SKI_CACHE_UPDATEID* cUID = NULL;
-  _SKI_CACHE_UPDATEID* prev = NULL;
-  bool added = false;
-  int cmp = 0;
+  bool canAdd = (cacheData != NULL) && (updateID != NULL) && (*updateID != 0);
 
-  if (cacheData != NULL)
+  if (canAdd)
   {
-    if (cacheData->cacheUID == NULL)
+    // Keep the load factor below 75%
+    if (((cacheData->uidCount + 1) * 4) > (cacheData->uidSlots * 3))
     {
-      cacheData->cacheUID = ___ski_createCacheUID(updateID);
-      added = true;
-    }    
-    cUID = cacheData->cacheUID;
-    // Compare only the path validation section.
-    while (!added)
+      canAdd = ___ski_growCacheUID(cacheData) 
+               || (cacheData->uidCount < cacheData->uidSlots);
+    }
+  }
+  
+  if (canAdd)
+  {
+    cUID = ___ski_getCacheUIDSlot(cacheData, *updateID);
+    if (cUID->updateID != 0)
+    {
+      // already added
+      cUID->counter++; // BZ1166
+    }
+    else
+    {
+      cUID->updateID = *updateID;
+      // Set to the initial value. (BZ 1166)
+      cUID->counter  = 1;
+      cacheData->uidCount++;
+    }
+  }
+}
+
+/**
+ * Remove one registration of the given update identifier from the cache data
+ * object. Once the registration counter reaches zero the update identifier is
+ * removed from the set. The set itself is freed once it is empty.
+ * 
+ * @param cacheData The cache data object
+ * @param updateID the update identifier
+ * 
+ * @return true if the update identifier was found.
+ * 
+ * @since 0.6.3.0
+ */
+static bool __ski_removeUpdateCacheUID(_SKI_CACHE_DATA* cacheData, 
+                                       SRxUpdateID* updateID)
+{
+  _SKI_CACHE_UPDATEID* cUID = NULL;
+  bool found = false;
+  
+  if ((cacheData->cacheUID != NULL) && (*updateID != 0))
+  {
+    cUID  = ___ski_getCacheUIDSlot(cacheData, *updateID);
+    found = cUID->updateID != 0;
+  }
+  
+  if (found)
+  {
+    // Update found - unregister the instance. BZ1166 (counter)
+    cUID->counter--;
+    if (cUID->counter == 0)
     {
-      cmp = compareSrxUpdateID(updateID, &cUID->updateID, SRX_UID_PV);
-      if (cmp != 0)
+      uint32_t mask = cacheData->uidSlots - 1;
+      uint32_t pos  = cUID - cacheData->cacheUID;
+      uint32_t next = (pos + 1) & mask;
+      uint32_t home = 0;
+      
+      cUID->updateID = 0;
+      cacheData->uidCount--;
+      // Shift the following elements of the probe sequence back.
+      while (cacheData->cacheUID[next].updateID != 0)
       {
-        if (cmp < 0)
-        {
-          // we need to insert the update ID
-          cUID = ___ski_createCacheUID(updateID);
-          if (prev != NULL)
-          {
-            // Insert before this one
-            cUID->next = prev->next;
-            prev->next = cUID;
-          }
-          else
-          {
-            cUID->next = cacheData->cacheUID;
-            cacheData->cacheUID = cUID;
-          }
-          added = true;
-        }
-        else
+        home = ___ski_hashUID(cacheData->cacheUID[next].updateID) & mask;
+        if (((next - home) & mask) >= ((next - pos) & mask))
         {
-          if (cUID->next == NULL)
-          {
-            cUID->next = ___ski_createCacheUID(updateID);
-            added = true;                    
-          }
-          prev = cUID;
-          cUID = cUID->next;                    
+          cacheData->cacheUID[pos] = cacheData->cacheUID[next];
+          cacheData->cacheUID[next].updateID = 0;
+          cacheData->cacheUID[next].counter  = 0;
+          pos = next;
         }
+        next = (next + 1) & mask;
       }
-      else
+      
+      if (cacheData->uidCount == 0)
       {
-        // already added
-        cUID->counter++; // BZ1166
-        added = true;  
+        ___ski_freeCacheUID(cacheData);
       }
     }
   }
+  
+  return found;
+}
+
+/**
+ * Add all updates registered with the cache data object to the RPKI queue.
+ * 
+ * @param sCache The SKI cache
+ * @param cacheData The cache data object
+ * 
+ * @since 0.6.3.0
+ */
+static void __ski_queueCacheUID(_SKI_CACHE* sCache, _SKI_CACHE_DATA* cacheData)
+{
+  uint32_t idx = 0;
+  
+  for (idx = 0; idx < cacheData->uidSlots; idx++)
+  {
+    if (cacheData->cacheUID[idx].updateID != 0)
+    {
+      rq_queue(sCache->rpki_queue, RQ_KEY, &cacheData->cacheUID[idx].updateID);
+    }
+  }
 }
 
 /**
@@ -869,7 +1200,8 @@ static bool _ski_unlock(_SKI_CACHE* sCache)
  * element if not existing and the parameter 'create' is set to true.
  * 
  * In addition this function sets the temporary helper attribute within the 
- * for later usage.
+ * for later usage. Existing elements are found using the hash index, in this
+ * case only cAlgoID and cData of the helper are set.
  * 
  * @param cache The cache where to look in.
  * @param asn The ASN of the cache object in host format.
@@ -899,19 +1231,29 @@ static _SKI_CACHE_DATA* _ski_getCacheData(_SKI_CACHE* sCache, uint32_t asn,
   _SKI_CACHE_DATA*    prev  = NULL;
   bool found = false;
   int  cmp   = 0;
+  uint32_t hash = ___ski_hashData(asn, ski, algoID);
   
-  // Retrieve the correct CacheNode from the cache. If the node does not exist
-  // yet and create is false, the cacheNODE will be NULL
-  tHlp->cNode = __ski_getCacheNode(sCache, upper, create);
+  tHlp->cData = __ski_indexFind(sCache, asn, ski, algoID, hash);
+  if (tHlp->cData != NULL)
+  {
+    tHlp->cAlgoID = tHlp->cData->cAlgoID;
+    found         = true;
+  }
+  else if (create)
+  {
+    // Retrieve the correct CacheNode from the cache. If the node does not 
+    // exist yet it will be generated.
+    tHlp->cNode = __ski_getCacheNode(sCache, upper, create);
+  }
 
-  if (tHlp->cNode != NULL)
+  if (!found && (tHlp->cNode != NULL))
   {
     // Retrieve the correct algoID list head from the cache. If the node does 
     // not exist yet and create is false, the cacheAlgoID will be NULL      
     tHlp->cAlgoID = __ski_getCacheAlgoID(tHlp->cNode, as2, algoID, create);
   }    
   
-  if (tHlp->cAlgoID != NULL)
+  if (!found && (tHlp->cAlgoID != NULL))
   {
     // Now where we have the entrance point, find the data
     if (tHlp->cAlgoID->cacheData != NULL)
@@ -922,7 +1264,7 @@ static _SKI_CACHE_DATA* _ski_getCacheData(_SKI_CACHE* sCache, uint32_t asn,
     {
       if (create)
       {
-        tHlp->cData = ___ski_createCacheData(asn, ski, algoID, NULL);
+        tHlp->cData = ___ski_createCacheData(asn, ski, algoID, hash);
         tHlp->cAlgoID->cacheData = tHlp->cData;
         found = true;
       }
@@ -936,7 +1278,7 @@ static _SKI_CACHE_DATA* _ski_getCacheData(_SKI_CACHE* sCache, uint32_t asn,
         // We need to insert
         if (create)
         {
-          tHlp->cData = ___ski_createCacheData(asn, ski, algoID, NULL);
+          tHlp->cData = ___ski_createCacheData(asn, ski, algoID, hash);
           if (prev != NULL)
           {
             tHlp->cData->next = prev->next;
@@ -966,12 +1308,19 @@ static _SKI_CACHE_DATA* _ski_getCacheData(_SKI_CACHE* sCache, uint32_t asn,
       {
         if (create)
         {
-          tHlp->cData = ___ski_createCacheData(asn, ski, algoID, NULL);
+          tHlp->cData = ___ski_createCacheData(asn, ski, algoID, hash);
           prev->next  = tHlp->cData;
           found = true;
         }
       }
     }
+    
+    // A newly created element must be added to the index
+    if (found && (tHlp->cData->cAlgoID == NULL))
+    {
+      tHlp->cData->cAlgoID = tHlp->cAlgoID;
+      __ski_indexAdd(sCache, tHlp->cData);
+    }
   }
 
   if (!found)
@@ -1239,6 +1588,7 @@ bool ski_releaseCache(SKI_CACHE* cache)
     {
       _SKI_CACHE* sCache = (_SKI_CACHE*)cache;    
       sem_destroy(&sCache->semaphore);
+      free(sCache->index);
       memset(sCache, 0, sizeof(_SKI_CACHE));
       free (sCache);
     }
@@ -1417,45 +1767,11 @@ bool ski_unregisterUpdate(SKI_CACHE* cache, SRxUpdateID* updateID,
               // than once with the same input data.
               if (cData != NULL)
               {
-                _SKI_CACHE_UPDATEID* cUID = cData->cacheUID;
-                _SKI_CACHE_UPDATEID* prev = NULL;
-                while (cUID != NULL)
+                if (!__ski_removeUpdateCacheUID(cData, updateID))
                 {
-                  int cmp = compareSrxUpdateID(updateID, &cUID->updateID, 
-                                               SRX_UID_PV);
-                  if (cmp != 0)
-                  {                  
-                    if (cmp > 0)
-                    {
-                      prev = cUID;
-                      cUID = cUID->next;                 
-                    }
-                    else
-                    {
-                      // Update not registered!
-                      cUID = NULL;
-                      LOG(LEVEL_WARNING, "Could not find any update registration "
-                          "%u for the particular cache data element", *updateID);
-                    }
-                  }
-                  else
-                  {
-                    // Update found - unregister the instance. BZ1166 (counter)
-                    cUID->counter--;
-                    if (cUID->counter == 0)
-                    {
-                      if (prev != NULL)
-                      {
-                        prev->next = ___ski_freeCacheUID(cUID);;                    
-                      }
-                      else
-                      {
-                        cData->cacheUID = ___ski_freeCacheUID(cUID);;
-                      }
-                    }
-                    // Set it to NULL to stop the loop.
-                    cUID = NULL;
-                  }
+                  // Update not registered!
+                  LOG(LEVEL_WARNING, "Could not find any update registration "
+                      "%u for the particular cache data element", *updateID);
                 }
 
                 // Now check if cData can be removed as well
@@ -1467,7 +1783,7 @@ bool ski_unregisterUpdate(SKI_CACHE* cache, SRxUpdateID* updateID,
                   {
                     // remove the head
                     sCache->tmpHelper.cAlgoID->cacheData = 
-                                                      ___ski_freeCacheData(cData);
+                                              ___ski_freeCacheData(sCache, cData);
                   }
                   else
                   {                  
@@ -1480,7 +1796,7 @@ bool ski_unregisterUpdate(SKI_CACHE* cache, SRxUpdateID* updateID,
                       prev_cData = prev_cData->next;
                     }
                     // Now take it out
-                    prev_cData->next = ___ski_freeCacheData(cData);
+                    prev_cData->next = ___ski_freeCacheData(sCache, cData);
                     cData = NULL;
                   }
                   sCache->tmpHelper.cData = NULL;
@@ -1554,12 +1870,7 @@ bool ski_registerKey(SKI_CACHE* cache, uint32_t asn,
       {
         // Yeah a new key was registered and we had already updates asking for it.
         // Now notify these updates
-        _SKI_CACHE_UPDATEID* cUID = cData->cacheUID;
-        while (cUID != NULL)
-        {      
-          rq_queue(sCache->rpki_queue, RQ_KEY, &cUID->updateID);
-          cUID = cUID->next;
-        }
+        __ski_queueCacheUID(sCache, cData);
       }
       _ski_unlock(sCache);
     }
@@ -1624,12 +1935,7 @@ bool ski_unregisterKey(SKI_CACHE* cache, uint32_t asn,
         if (cData->cacheUID != NULL)
         {
           // Notify the attached updates
-          _SKI_CACHE_UPDATEID* cUID = cData->cacheUID;
-          while (cUID != NULL)
-          {
-            rq_queue(sCache->rpki_queue, RQ_KEY, &cUID->updateID);
-            cUID = cUID->next;
-          }
+          __ski_queueCacheUID(sCache, cData);
         }
         else
         {
@@ -1655,7 +1961,7 @@ bool ski_unregisterKey(SKI_CACHE* cache, uint32_t asn,
             prev->next = cData->next;
           }
           // Now remove the element.
-          ___ski_freeCacheData(cData);
+          ___ski_freeCacheData(sCache, cData);
           cData = NULL;            
         }
       }
@@ -1755,7 +2061,7 @@ bool ski_clean(SKI_CACHE* cache, e_SKI_clean type)
         while (sCache->cacheNode != NULL)
         {
           // Simple and easy delete all.
-          sCache->cacheNode = ___ski_freeCacheNode(sCache->cacheNode);
+          sCache->cacheNode = ___ski_freeCacheNode(sCache, sCache->cacheNode);
         }        
       }
       else
@@ -1765,10 +2071,10 @@ bool ski_clean(SKI_CACHE* cache, e_SKI_clean type)
         // Don't clean all but selectively.
         while (cNode != NULL)
         {
-          if (___ski_clean_cNode(cNode, type))
+          if (___ski_clean_cNode(sCache, cNode, type))
           {
             // We can clean this node
-            cNode = ___ski_freeCacheNode(cNode);            
+            cNode = ___ski_freeCacheNode(sCache, cNode);            
             if (prev == NULL) // head
             {
               sCache->cacheNode = cNode;
@@ -1835,6 +2141,7 @@ void ski_examineCache(SKI_CACHE * cache, SKI_CACHE_INFO* info, bool verbose)
   _SKI_CACHE_UPDATEID* cUID    = NULL;
   int as2    = 0;
   int skiIdx = 0;
+  uint32_t uidIdx = 0;
   
   if (sCache != NULL)
   {
@@ -1875,14 +2182,16 @@ void ski_examineCache(SKI_CACHE * cache, SKI_CACHE_INFO* info, bool verbose)
                   _ski_printf ("%02X", cData->ski[skiIdx]);
                 }
                 _ski_printf ("</SKI>\n");
-                cUID = cData->cacheUID;
-                while (cUID != NULL)
+                for (uidIdx = 0; uidIdx < cData->uidSlots; uidIdx++)
                 {
-                  info->count_cUID++;
-                  info->count_updates += cUID->counter;
-                  _ski_printf ("          <UID id=0x%X counter=%u/>\n", 
-                               cUID->updateID, cUID->counter);
-                  cUID = cUID->next;
+                  cUID = &cData->cacheUID[uidIdx];
+                  if (cUID->updateID != 0)
+                  {
+                    info->count_cUID++;
+                    info->count_updates += cUID->counter;
+                    _ski_printf ("          <UID id=0x%X counter=%u/>\n", 
+                                 cUID->updateID, cUID->counter);
+                  }
                 }
                 
                 _ski_printf ("        </CACHE_DATA>\n");
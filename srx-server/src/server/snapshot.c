@@ -0,0 +1,512 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * This file contains the reader and writer of the snapshot file.
+ *
+ * @version 0.6.3.0
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "server/snapshot.h"
+#include "shared/crc32.h"
+#include "util/log.h"
+
+#define HDR "([0x%08X] Snapshot): "
+
+/** The data chunks are padded to this alignment. */
+#define SNAPSHOT_ALIGN         4
+/** The sections are padded to this alignment. */
+#define SNAPSHOT_SECTION_ALIGN 8
+
+/** Zeros used for padding. */
+static const uint8_t _PADDING[SNAPSHOT_SECTION_ALIGN] = { 0 };
+
+/**
+ * Return the length of the data including the padding.
+ *
+ * @param length The length of the data.
+ * @param align The alignment.
+ *
+ * @return the padded length.
+ */
+static uint64_t _padded(uint64_t length, uint64_t align)
+{
+  return (length + align - 1) & ~(align - 1);
+}
+
+/**
+ * Write the data into the file and add it to the CRC of the section.
+ *
+ * @param self The writer.
+ * @param data The data.
+ * @param length The length of the data.
+ *
+ * @return false if the data could not be written.
+ */
+static bool _write(SnapshotWriter* self, const void* data, uint32_t length)
+{
+  if (!self->failed && (length > 0))
+  {
+    if (fwrite(data, 1, length, self->file) != length)
+    {
+      RAISE_SYS_ERROR("Could not write the snapshot '%s'!", self->tmpName);
+      self->failed = true;
+    }
+    else
+    {
+      self->section.crc = crc32Update(self->section.crc, (uint8_t*)data,
+                                      length);
+      self->section.length += length;
+    }
+  }
+
+  return !self->failed;
+}
+
+/**
+ * Open a new snapshot. The data is written into "<fileName>.tmp" which
+ * replaces the snapshot with closeSnapshotWriter.
+ *
+ * @param self The writer.
+ * @param fileName The name of the snapshot.
+ *
+ * @return false if the temporary file could not be created.
+ *
+ * @since 0.6.3.0
+ */
+bool openSnapshotWriter(SnapshotWriter* self, const char* fileName)
+{
+  memset(self, 0, sizeof(SnapshotWriter));
+  self->fileName = strdup(fileName);
+  self->tmpName  = malloc(strlen(fileName) + 5);
+  if ((self->fileName == NULL) || (self->tmpName == NULL))
+  {
+    RAISE_SYS_ERROR("Not enough memory for the snapshot!");
+    closeSnapshotWriter(self, false);
+    return false;
+  }
+  sprintf(self->tmpName, "%s.tmp", fileName);
+
+  self->file = fopen(self->tmpName, "wb");
+  if (self->file == NULL)
+  {
+    RAISE_SYS_ERROR("Could not create the snapshot '%s'!", self->tmpName);
+    closeSnapshotWriter(self, false);
+    return false;
+  }
+
+  self->header.magic   = SNAPSHOT_MAGIC;
+  self->header.version = SNAPSHOT_VERSION;
+  self->header.created = (uint64_t)time(NULL);
+  self->header.length  = sizeof(SnapshotHeader);
+  // The header is written again once the snapshot is complete.
+  if (fwrite(&self->header, sizeof(SnapshotHeader), 1, self->file) != 1)
+  {
+    RAISE_SYS_ERROR("Could not write the snapshot '%s'!", self->tmpName);
+    self->failed = true;
+  }
+
+  return !self->failed;
+}
+
+/**
+ * Start a new section. The section ends with the next call to
+ * endSnapshotSection.
+ *
+ * @param self The writer.
+ * @param type The section type (SNAP_SEC_...).
+ *
+ * @return false if the section could not be started.
+ *
+ * @since 0.6.3.0
+ */
+bool beginSnapshotSection(SnapshotWriter* self, uint16_t type)
+{
+  if (self->header.noSections >= SNAPSHOT_MAX_SECTIONS)
+  {
+    RAISE_ERROR("Too many sections in snapshot '%s'!", self->tmpName);
+    self->failed = true;
+  }
+  if (self->failed)
+  {
+    return false;
+  }
+
+  memset(&self->section, 0, sizeof(SnapshotSection));
+  self->section.type = type;
+  self->sectionPos   = ftell(self->file);
+  // Reserve the space for the section header.
+  if (fwrite(&self->section, sizeof(SnapshotSection), 1, self->file) != 1)
+  {
+    RAISE_SYS_ERROR("Could not write the snapshot '%s'!", self->tmpName);
+    self->failed = true;
+  }
+
+  return !self->failed;
+}
+
+/**
+ * Add data to the current section. The data is padded to 4 bytes.
+ *
+ * @param self The writer.
+ * @param data The data.
+ * @param length The length of the data.
+ *
+ * @return false if the data could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool addSnapshotData(SnapshotWriter* self, const void* data, uint32_t length)
+{
+  uint32_t padding = _padded(length, SNAPSHOT_ALIGN) - length;
+
+  return _write(self, data, length) && _write(self, _PADDING, padding);
+}
+
+/**
+ * End the current section.
+ *
+ * @param self The writer.
+ * @param count The number of records written into the section.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool endSnapshotSection(SnapshotWriter* self, uint32_t count)
+{
+  uint32_t padding = _padded(self->section.length, SNAPSHOT_SECTION_ALIGN)
+                     - self->section.length;
+
+  if (!_write(self, _PADDING, padding))
+  {
+    return false;
+  }
+  self->section.count = count;
+
+  // Fill in the section header and go back to the end.
+  if (   (fseek(self->file, self->sectionPos, SEEK_SET) != 0)
+      || (fwrite(&self->section, sizeof(SnapshotSection), 1, self->file) != 1)
+      || (fseek(self->file, 0, SEEK_END) != 0))
+  {
+    RAISE_SYS_ERROR("Could not write the snapshot '%s'!", self->tmpName);
+    self->failed = true;
+    return false;
+  }
+  self->header.noSections++;
+  self->header.length += sizeof(SnapshotSection) + self->section.length;
+
+  return true;
+}
+
+/**
+ * Close the writer. If commit is set and all data was written, the snapshot
+ * is replaced by the new one, otherwise the new one is removed.
+ *
+ * @param self The writer.
+ * @param commit Replace the snapshot.
+ *
+ * @return true if the snapshot was replaced.
+ *
+ * @since 0.6.3.0
+ */
+bool closeSnapshotWriter(SnapshotWriter* self, bool commit)
+{
+  bool retVal = false;
+
+  if (self->file != NULL)
+  {
+    if (commit && !self->failed)
+    {
+      // The header is written last, a snapshot without it is not valid.
+      if (   (fseek(self->file, 0, SEEK_SET) != 0)
+          || (fwrite(&self->header, sizeof(SnapshotHeader), 1, self->file)
+              != 1)
+          || (fflush(self->file) != 0)
+          || (fsync(fileno(self->file)) != 0))
+      {
+        RAISE_SYS_ERROR("Could not write the snapshot '%s'!", self->tmpName);
+        self->failed = true;
+      }
+    }
+    if (fclose(self->file) != 0)
+    {
+      self->failed = true;
+    }
+    self->file = NULL;
+
+    if (commit && !self->failed)
+    {
+      if (rename(self->tmpName, self->fileName) == 0)
+      {
+        LOG(LEVEL_INFO, HDR "Snapshot '%s' written (%u sections, %llu bytes)",
+            pthread_self(), self->fileName, self->header.noSections,
+            (unsigned long long)self->header.length);
+        retVal = true;
+      }
+      else
+      {
+        RAISE_SYS_ERROR("Could not replace the snapshot '%s'!",
+                        self->fileName);
+      }
+    }
+    if (!retVal)
+    {
+      unlink(self->tmpName);
+    }
+  }
+
+  if (self->fileName != NULL)
+  {
+    free(self->fileName);
+    self->fileName = NULL;
+  }
+  if (self->tmpName != NULL)
+  {
+    free(self->tmpName);
+    self->tmpName = NULL;
+  }
+
+  return retVal;
+}
+
+/**
+ * Map the snapshot into memory and verify it.
+ *
+ * @param self The reader.
+ * @param fileName The name of the snapshot.
+ *
+ * @return false if the file does not exist or is not a valid snapshot of
+ *         this version.
+ *
+ * @since 0.6.3.0
+ */
+bool openSnapshotReader(SnapshotReader* self, const char* fileName)
+{
+  struct stat fileStat;
+  uint64_t    pos;
+  int         fd;
+  int         idx;
+
+  memset(self, 0, sizeof(SnapshotReader));
+
+  fd = open(fileName, O_RDONLY);
+  if (fd == -1)
+  {
+    if (errno != ENOENT)
+    {
+      RAISE_SYS_ERROR("Could not open the snapshot '%s'!", fileName);
+    }
+    return false;
+  }
+  if ((fstat(fd, &fileStat) != 0)
+      || (fileStat.st_size < sizeof(SnapshotHeader)))
+  {
+    LOG(LEVEL_WARNING, "Snapshot '%s' is too short!", fileName);
+    close(fd);
+    return false;
+  }
+
+  self->length = fileStat.st_size;
+  self->data   = mmap(NULL, self->length, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (self->data == MAP_FAILED)
+  {
+    RAISE_SYS_ERROR("Could not map the snapshot '%s'!", fileName);
+    self->data = NULL;
+    return false;
+  }
+
+  memcpy(&self->header, self->data, sizeof(SnapshotHeader));
+  if (   (self->header.magic != SNAPSHOT_MAGIC)
+      || (self->header.version != SNAPSHOT_VERSION)
+      || (self->header.length != self->length)
+      || (self->header.noSections > SNAPSHOT_MAX_SECTIONS))
+  {
+    LOG(LEVEL_WARNING, "Snapshot '%s' is incomplete or of a different version "
+                       "[magic: 0x%08X, version: %u]!", fileName,
+                       self->header.magic, self->header.version);
+    closeSnapshotReader(self);
+    return false;
+  }
+
+  // Verify all sections before any data is used.
+  pos = sizeof(SnapshotHeader);
+  for (idx = 0; idx < self->header.noSections; idx++)
+  {
+    SnapshotSection* section = (SnapshotSection*)(self->data + pos);
+    if (   (pos + sizeof(SnapshotSection) > self->length)
+        || (section->length > self->length - pos - sizeof(SnapshotSection))
+        || (crc32Update(0, (uint8_t*)(section + 1), section->length)
+            != section->crc))
+    {
+      LOG(LEVEL_WARNING, "Snapshot '%s' is corrupted in section %u!",
+          fileName, idx);
+      closeSnapshotReader(self);
+      return false;
+    }
+    self->sections[idx] = section;
+    pos += sizeof(SnapshotSection) + section->length;
+  }
+
+  LOG(LEVEL_INFO, HDR "Snapshot '%s' of %s", pthread_self(), fileName,
+      ctime((time_t*)&self->header.created));
+
+  return true;
+}
+
+/**
+ * Position the cursor at the first record of the section with the given
+ * type.
+ *
+ * @param self The reader.
+ * @param type The section type (SNAP_SEC_...).
+ * @param cursor The cursor.
+ *
+ * @return false if the snapshot does not contain the section.
+ *
+ * @since 0.6.3.0
+ */
+bool findSnapshotSection(SnapshotReader* self, uint16_t type,
+                         SnapshotCursor* cursor)
+{
+  int idx;
+
+  memset(cursor, 0, sizeof(SnapshotCursor));
+  if (self->data == NULL)
+  {
+    return false;
+  }
+
+  for (idx = 0; idx < self->header.noSections; idx++)
+  {
+    if (self->sections[idx]->type == type)
+    {
+      cursor->pos   = (const uint8_t*)(self->sections[idx] + 1);
+      cursor->end   = cursor->pos + self->sections[idx]->length;
+      cursor->count = self->sections[idx]->count;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Return the next chunk of data of the section and move the cursor behind it.
+ * The returned data points into the mapped snapshot and is 4 byte aligned.
+ *
+ * @param cursor The cursor.
+ * @param length The length of the chunk as it was written.
+ *
+ * @return the data or NULL if the section does not contain enough data.
+ *
+ * @since 0.6.3.0
+ */
+const void* getSnapshotData(SnapshotCursor* cursor, uint32_t length)
+{
+  const void* data   = cursor->pos;
+  uint64_t    padded = _padded(length, SNAPSHOT_ALIGN);
+
+  if ((cursor->pos == NULL) || (padded > (uint64_t)(cursor->end - cursor->pos)))
+  {
+    return NULL;
+  }
+  cursor->pos += padded;
+
+  return data;
+}
+
+/**
+ * Unmap the snapshot.
+ *
+ * @param self The reader.
+ *
+ * @since 0.6.3.0
+ */
+void closeSnapshotReader(SnapshotReader* self)
+{
+  if (self->data != NULL)
+  {
+    munmap(self->data, self->length);
+  }
+  memset(self, 0, sizeof(SnapshotReader));
+}
+
+/**
+ * Copy the prefix into the snapshot record format.
+ *
+ * @param prefix The prefix.
+ * @param snapPrefix The prefix within the record.
+ *
+ * @since 0.6.3.0
+ */
+void prefixToSnapshot(IPPrefix* prefix, SnapshotPrefix* snapPrefix)
+{
+  memset(snapPrefix, 0, sizeof(SnapshotPrefix));
+  snapPrefix->ipVersion = prefix->ip.version;
+  snapPrefix->length    = prefix->length;
+  if (prefix->ip.version == 4)
+  {
+    memcpy(snapPrefix->addr, &prefix->ip.addr.v4, sizeof(IPv4Address));
+  }
+  else
+  {
+    memcpy(snapPrefix->addr, &prefix->ip.addr.v6, sizeof(IPv6Address));
+  }
+}
+
+/**
+ * Copy the prefix of a record.
+ *
+ * @param snapPrefix The prefix within the record.
+ * @param prefix The prefix.
+ *
+ * @return false if the record does not contain a valid prefix.
+ *
+ * @since 0.6.3.0
+ */
+bool snapshotToPrefix(const SnapshotPrefix* snapPrefix, IPPrefix* prefix)
+{
+  memset(prefix, 0, sizeof(IPPrefix));
+  prefix->ip.version = snapPrefix->ipVersion;
+  prefix->length     = snapPrefix->length;
+  switch (snapPrefix->ipVersion)
+  {
+    case 4:
+      memcpy(&prefix->ip.addr.v4, snapPrefix->addr, sizeof(IPv4Address));
+      return prefix->length <= 32;
+    case 6:
+      memcpy(&prefix->ip.addr.v6, snapPrefix->addr, sizeof(IPv6Address));
+      return prefix->length <= 128;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,400 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The snapshot stores the state of srx-server in a binary file which allows a
+ * warm restart. The file starts with a header followed by sections, each
+ * section holds the records of one type. All values are in host format, the
+ * magic number detects snapshots written on hosts with a different byte
+ * order. Each chunk of data is padded to 4 bytes which keeps the AS numbers
+ * aligned within the memory mapped file, each section is padded to 8 bytes.
+ *
+ *   SnapshotHeader
+ *   SnapshotSection | record | record | ...
+ *   SnapshotSection | record | record | ...
+ *
+ * The version MUST be incremented each time the layout of a record changes.
+ * Snapshots of other versions are not restored.
+ *
+ * @version 0.6.3.0
+ */
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "shared/srx_defs.h"
+#include "shared/srx_packets.h"
+#include "util/prefix.h"
+
+/** "SRXS" - The magic number of the snapshot file. */
+#define SNAPSHOT_MAGIC    0x53525853
+/** The version of the snapshot layout. */
+#define SNAPSHOT_VERSION  2
+
+/** The RTR sessions and serials, one SnapshotRTRRecord per validation cache
+ * that is in sync. */
+#define SNAP_SEC_RTR      1
+/** The ROA white-list, SnapshotROARecord. */
+#define SNAP_SEC_ROA      2
+/** The ASPA objects, SnapshotASPARecord followed by the providers. */
+#define SNAP_SEC_ASPA     3
+/** The router keys, SnapshotKeyRecord followed by the key. */
+#define SNAP_SEC_KEY      4
+/** The AS path cache, SnapshotAspathRecord followed by the segments and the
+ * path. */
+#define SNAP_SEC_ASPATH   5
+/** The update cache, SnapshotUpdateRecord followed by the AS path and the
+ * BGPsec_PATH attribute. */
+#define SNAP_SEC_UPDATE   6
+/** The validation caches of the ASPA objects, SnapshotASPARefRecord followed
+ * by the providers of the cache. */
+#define SNAP_SEC_ASPA_REF 7
+
+/** The maximum number of sections within one snapshot. */
+#define SNAPSHOT_MAX_SECTIONS 16
+
+/**
+ * The header of the snapshot file.
+ */
+typedef struct {
+  /** SNAPSHOT_MAGIC */
+  uint32_t magic;
+  /** SNAPSHOT_VERSION */
+  uint16_t version;
+  /** The number of sections following the header. */
+  uint16_t noSections;
+  /** The time the snapshot was written. */
+  uint64_t created;
+  /** The length of the file including the header. */
+  uint64_t length;
+} SnapshotHeader;
+
+/**
+ * The header of a section.
+ */
+typedef struct {
+  /** The section type SNAP_SEC_... */
+  uint16_t type;
+  uint16_t reserved;
+  /** The number of records. */
+  uint32_t count;
+  /** The length of the section data (without this header). */
+  uint64_t length;
+  /** The CRC of the section data. */
+  uint32_t crc;
+  uint32_t reserved2;
+} SnapshotSection;
+
+/**
+ * A prefix within a record.
+ */
+typedef struct {
+  /** The IP version (4 or 6). */
+  uint8_t ipVersion;
+  /** The prefix length. */
+  uint8_t length;
+  uint16_t reserved;
+  /** The address, IPv4 uses the first 4 bytes. */
+  uint8_t addr[16];
+} SnapshotPrefix;
+
+/**
+ * The RTR session the snapshot is in sync with.
+ */
+typedef struct {
+  /** The ID of the validation cache. */
+  uint32_t valCacheID;
+  /** The serial of the last End of Data. */
+  uint32_t serial;
+  /** The session ID of the validation cache. */
+  uint16_t sessionID;
+  /** The RPKI router protocol version. */
+  uint8_t  version;
+  uint8_t  reserved;
+} SnapshotRTRRecord;
+
+/**
+ * A ROA white-list entry.
+ */
+typedef struct {
+  uint32_t       valCacheID;
+  uint32_t       originAS;
+  /** The number of identical entries. */
+  uint16_t       count;
+  uint8_t        maxLen;
+  uint8_t        reserved;
+  SnapshotPrefix prefix;
+} SnapshotROARecord;
+
+/**
+ * An ASPA object, followed by providerAsCount provider ASNs.
+ */
+typedef struct {
+  uint32_t customerAsn;
+  uint16_t providerAsCount;
+  uint16_t afi;
+} SnapshotASPARecord;
+
+/**
+ * An ASPA object announced by a validation cache, followed by the 
+ * providerAsCount provider ASNs announced by this cache.
+ */
+typedef struct {
+  uint32_t valCacheID;
+  uint32_t customerAsn;
+  uint16_t providerAsCount;
+  uint16_t reserved;
+} SnapshotASPARefRecord;
+
+/**
+ * A router key, followed by keyLength bytes of the key in DER format.
+ */
+typedef struct {
+  uint32_t valCacheID;
+  uint32_t asn;
+  uint8_t  ski[SKI_LENGTH];
+  uint16_t keyLength;
+  uint16_t reserved;
+} SnapshotKeyRecord;
+
+/**
+ * An AS path, followed by numSegments AS_PATH_SEGMENTs and asPathLength ASNs.
+ */
+typedef struct {
+  uint32_t pathId;
+  uint16_t asPathLength;
+  uint8_t  numSegments;
+  uint8_t  asType;
+  uint8_t  asRelDir;
+  uint8_t  aspaResult;
+  uint16_t afi;
+  uint32_t reserved;
+  int64_t  lastModified;
+} SnapshotAspathRecord;
+
+/**
+ * An update, followed by hops ASNs and bgpsecLength bytes of the BGPsec_PATH
+ * attribute.
+ */
+typedef struct {
+  uint32_t       updateID;
+  uint32_t       asn;
+  uint32_t       pathId;
+  /** The own AS (network format) */
+  uint32_t       myAS;
+  SRxResult      srxResult;
+  SRxResult      defaultResult;
+  uint8_t        resSourceROA;
+  uint8_t        resSourceBGPSEC;
+  uint8_t        resSourceASPA;
+  uint8_t        resSourceTransitive;
+  /** The afi of the NLRI (network format) */
+  uint16_t       afi;
+  uint8_t        safi;
+  uint8_t        reserved;
+  uint16_t       hops;
+  uint16_t       bgpsecLength;
+  SnapshotPrefix prefix;
+} SnapshotUpdateRecord;
+
+/**
+ * Writes the snapshot into a temporary file which replaces the snapshot once
+ * it is complete.
+ */
+typedef struct {
+  /** The name of the snapshot. */
+  char*           fileName;
+  /** The name of the temporary file. */
+  char*           tmpName;
+  /** The temporary file. */
+  FILE*           file;
+  SnapshotHeader  header;
+  /** The section currently written and its position within the file. */
+  SnapshotSection section;
+  long            sectionPos;
+  /** Indicates an I/O error, the snapshot is discarded. */
+  bool            failed;
+} SnapshotWriter;
+
+/**
+ * A memory mapped snapshot.
+ */
+typedef struct {
+  /** The mapped file, NULL if no snapshot is open. */
+  uint8_t*         data;
+  /** The length of the mapped file. */
+  uint64_t         length;
+  SnapshotHeader   header;
+  /** The sections in the order of the file. */
+  SnapshotSection* sections[SNAPSHOT_MAX_SECTIONS];
+} SnapshotReader;
+
+/**
+ * Reads the records of one section.
+ */
+typedef struct {
+  /** The next byte to be read. */
+  const uint8_t* pos;
+  /** The end of the section. */
+  const uint8_t* end;
+  /** The number of records within the section. */
+  uint32_t       count;
+} SnapshotCursor;
+
+/**
+ * Open a new snapshot. The data is written into "<fileName>.tmp" which
+ * replaces the snapshot with closeSnapshotWriter.
+ *
+ * @param self The writer.
+ * @param fileName The name of the snapshot.
+ *
+ * @return false if the temporary file could not be created.
+ *
+ * @since 0.6.3.0
+ */
+bool openSnapshotWriter(SnapshotWriter* self, const char* fileName);
+
+/**
+ * Start a new section. The section ends with the next call to
+ * endSnapshotSection.
+ *
+ * @param self The writer.
+ * @param type The section type (SNAP_SEC_...).
+ *
+ * @return false if the section could not be started.
+ *
+ * @since 0.6.3.0
+ */
+bool beginSnapshotSection(SnapshotWriter* self, uint16_t type);
+
+/**
+ * Add data to the current section. The data is padded to 4 bytes.
+ *
+ * @param self The writer.
+ * @param data The data.
+ * @param length The length of the data.
+ *
+ * @return false if the data could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool addSnapshotData(SnapshotWriter* self, const void* data, uint32_t length);
+
+/**
+ * End the current section.
+ *
+ * @param self The writer.
+ * @param count The number of records written into the section.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool endSnapshotSection(SnapshotWriter* self, uint32_t count);
+
+/**
+ * Close the writer. If commit is set and all data was written, the snapshot
+ * is replaced by the new one, otherwise the new one is removed.
+ *
+ * @param self The writer.
+ * @param commit Replace the snapshot.
+ *
+ * @return true if the snapshot was replaced.
+ *
+ * @since 0.6.3.0
+ */
+bool closeSnapshotWriter(SnapshotWriter* self, bool commit);
+
+/**
+ * Map the snapshot into memory and verify it.
+ *
+ * @param self The reader.
+ * @param fileName The name of the snapshot.
+ *
+ * @return false if the file does not exist or is not a valid snapshot of
+ *         this version.
+ *
+ * @since 0.6.3.0
+ */
+bool openSnapshotReader(SnapshotReader* self, const char* fileName);
+
+/**
+ * Position the cursor at the first record of the section with the given
+ * type.
+ *
+ * @param self The reader.
+ * @param type The section type (SNAP_SEC_...).
+ * @param cursor The cursor.
+ *
+ * @return false if the snapshot does not contain the section.
+ *
+ * @since 0.6.3.0
+ */
+bool findSnapshotSection(SnapshotReader* self, uint16_t type,
+                         SnapshotCursor* cursor);
+
+/**
+ * Return the next chunk of data of the section and move the cursor behind it.
+ * The returned data points into the mapped snapshot and is 4 byte aligned.
+ *
+ * @param cursor The cursor.
+ * @param length The length of the chunk as it was written.
+ *
+ * @return the data or NULL if the section does not contain enough data.
+ *
+ * @since 0.6.3.0
+ */
+const void* getSnapshotData(SnapshotCursor* cursor, uint32_t length);
+
+/**
+ * Unmap the snapshot.
+ *
+ * @param self The reader.
+ *
+ * @since 0.6.3.0
+ */
+void closeSnapshotReader(SnapshotReader* self);
+
+/**
+ * Copy the prefix into the snapshot record format.
+ *
+ * @param prefix The prefix.
+ * @param snapPrefix The prefix within the record.
+ *
+ * @since 0.6.3.0
+ */
+void prefixToSnapshot(IPPrefix* prefix, SnapshotPrefix* snapPrefix);
+
+/**
+ * Copy the prefix of a record.
+ *
+ * @param snapPrefix The prefix within the record.
+ * @param prefix The prefix.
+ *
+ * @return false if the record does not contain a valid prefix.
+ *
+ * @since 0.6.3.0
+ */
+bool snapshotToPrefix(const SnapshotPrefix* snapPrefix, IPPrefix* prefix);
+
+#endif // __SNAPSHOT_H__
@@ -41,40 +41,92 @@
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "server/metrics.h"
 #include "server/srx_packet_sender.h"
 #include "shared/srx_packets.h"
 #include "util/log.h"
 #include "util/mutex.h"
 #include "util/server_socket.h"
+#include "util/slist.h"
 
 typedef struct {
-  // The pdu to be send
-  uint8_t*      pdu;    
-  // The size of the pdu
-  size_t        size;
-  // The server socket to send from
-  ServerSocket* srcSock;
-  // The client to send to
-  ServerClient* client;
   // The next packet in the queue
   void*         next; 
+  // The size of the pdu
+  size_t        size;
+  // Indicates that the pdu is a verify notification that only returns 
+  // credits.
+  bool          creditOnly;
+  // The pdu to be send, it follows this structure.
+  uint8_t*      pdu;    
 } SendPacket;
 
+/**
+ * The output queue of one client. The packets are send by its own thread, a
+ * slow client therefore does not delay the packets of other clients.
+ */
 typedef struct {
   // the head element of the queue
-  SendPacket* head;
+  SendPacket*   head;
   // the tail element of the queue
-  SendPacket* tail;
+  SendPacket*   tail;
   // the size of the queue
-  int        size;
+  uint32_t      size;
+  // the verify notifications within the queue
+  uint32_t      notifications;
+  // the largest size the queue had
+  uint32_t      maxSize;
   // the queue handler itself
-  pthread_t handler;
+  pthread_t     handler;
   // indicates if the queue is running.
-  bool        running;
+  bool          running;
+  // indicates that the queue handler is sending a packet
+  bool          sending;
+  // indicates that the client is disconnected because the queue is full
+  bool          overflow;
   // Mutex and Condition for thread handling
+  Mutex         mutex;
+  Cond          condition;
+  // Signals the receiver of the client that credits are returned
+  Cond          creditCond;
+  // The number of threads waiting for credits
+  uint32_t      waiting;
+
+  // The server socket to send from
+  ServerSocket* srvSock;
+  // The client to send to
+  ServerClient* client;
+
+  // The verify requests the client may have outstanding
+  uint32_t      window;
+  // The verify requests received but not processed yet
+  uint32_t      outstanding;
+  // The credits to be returned to the client
+  uint32_t      credits;
+  // Indicates that the client negotiated the flow control
+  bool          useCredits;
+} ClientSendQueue;
+
+typedef struct {
+  // the output queues of the clients (ClientSendQueue)
+  SList       clients;
+  // indicates if the queue is running, only then client queues are created.
+  bool        running;
+  // The maximum number of packets per client queue
+  uint32_t    limit;
+  // The window of outstanding verify requests per client
+  uint32_t    window;
+  // Statistics, updated atomically
+  uint64_t    sent;
+  uint64_t    coalesced;
+  uint64_t    creditWaits;
+  uint64_t    overflows;
+  // Protects the list of clients and the sendQueue attribute of the clients.
   Mutex       mutex;
-  Cond        condition;
-  
 } SendPacketQueue;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -87,36 +139,30 @@ typedef struct {
 // The send queue 
 static SendPacketQueue* SEND_QUEUE = NULL;
 
-// Forward declaration
-SendPacket* fetchSendPacket();
-
 /**
- * Create the sender queue including the thread that manages the queue.
+ * Create the sender queue. The output queues of the clients are created once
+ * the client connects.
  * 
+ * @param queueLimit The maximum number of packets queued per client.
+ * @param window The maximum number of verify requests a client can have 
+ *               outstanding.
+ *
  * @return true if the queue cold be created otherwise false. 
  * 
  * @since 0.3.0
  */
-bool createSendQueue()
+bool createSendQueue(uint32_t queueLimit, uint32_t window)
 {
   SendPacketQueue* queue = malloc(sizeof(SendPacketQueue));
   if (queue != NULL)
   {
-    queue->head    = NULL;
-    queue->tail    = NULL;
-    queue->size    = 0;
+    memset(queue, 0, sizeof(SendPacketQueue));
+    initSList(&queue->clients);
     queue->running = false;
+    queue->limit   = queueLimit > 0 ? queueLimit : SQ_DEF_QUEUE_LIMIT;
+    queue->window  = window > 0 ? window : SQ_DEF_WINDOW;
     
-    if (initMutex(&queue->mutex))
-    {
-      if (!initCond(&queue->condition))
-      {
-        releaseMutex(&queue->mutex);
-        free(queue);
-        queue = NULL;
-      }
-    }
-    else
+    if (!initMutex(&queue->mutex))
     {
       free(queue);
       queue = NULL;
@@ -139,17 +185,10 @@ void releaseSendQueue()
   {
     LOG(LEVEL_INFO, "Enter release send queue...");
 
-    if (SEND_QUEUE->running)
-    {
-      // Stops and cleans the queue
-      stopSendQueue(SEND_QUEUE);
-    }
-    if (SEND_QUEUE->head != NULL)
-    {
-      RAISE_SYS_ERROR("Queue should be already empty!");
-    }
+    // Stops and releases the queues of the clients
+    stopSendQueue();
     releaseMutex(&SEND_QUEUE->mutex);
-    destroyCond(&SEND_QUEUE->condition);
+    releaseSList(&SEND_QUEUE->clients);
     free (SEND_QUEUE);
     SEND_QUEUE = NULL;
     
@@ -157,43 +196,98 @@ void releaseSendQueue()
   }  
 }
 
-/** 
- * The thread loop of the queue. To stop the queue call stopSendQueue()
- * 
- * @param notused - Not Used
+/**
+ * Retrieve the next packet from the queue as long as the queue is running. 
+ * in case the queue is not running this method returns NULL. The credits 
+ * to be returned are added to verify notifications.
  * 
- * @return NULL
+ * @param queue The output queue of the client.
+ *
+ * @return  the next packet of NULL if the queue is stopped.
  * 
  * @since 0.3.0
  */
-void* sendQueueThreadLoop(void* notused)
+static SendPacket* _fetchSendPacket(ClientSendQueue* queue) 
 {
-  SendPacketQueue* queue = SEND_QUEUE;
-  if (queue == NULL)
-  {
-    RAISE_SYS_ERROR("Send queue is not initialized!");
-  }
-  else
+  SendPacket* packet = NULL;
+  SRXPROXY_VERIFY_NOTIFICATION* pdu;
+  uint16_t credits;
+  
+  lockMutex(&queue->mutex);
+  queue->sending = false;
+  while (packet == NULL && queue->running)
   {
-    SendPacket* packet = NULL;
-    LOG(LEVEL_DEBUG, "Enter sendqueue loop.");
-    while (queue->running)
+    if (queue->head == NULL)
+    {
+      // wait until notify is called or after a timeout.      
+      waitCond(&queue->condition, &queue->mutex, SEND_QUEUE_WAIT_MS);
+      continue;
+    }
+
+    packet = queue->head;
+    queue->size--;
+    queue->head = (SendPacket*)packet->next;
+    if (queue->head == NULL)
+    {
+      queue->tail = NULL;
+    }
+    packet->next = NULL;   
+
+    pdu = (SRXPROXY_VERIFY_NOTIFICATION*)packet->pdu;
+    if (pdu->type == PDU_SRXPROXY_VERI_NOTIFICATION)
     {
-      packet = fetchSendPacket(queue);
-      if (packet != NULL)
+      queue->notifications--;
+      if (queue->useCredits)
+      {
+        credits = queue->credits > 0xFFFF ? 0xFFFF : queue->credits;
+        queue->credits -= credits;
+        pdu->credits    = htons(credits);
+      }
+      // The credits went out with an earlier notification.
+      if (packet->creditOnly && (pdu->credits == 0))
       {
-        if (!sendPacketToClient(packet->srcSock, packet->client, packet->pdu, 
-                                packet->size))
-        {
-          SRXPROXY_BasicHeader* bhdr = (SRXPROXY_BasicHeader*)packet->pdu;
-          RAISE_ERROR("Could not send packet of type [%u]!", bhdr->type);
-        }
-        free(packet->pdu);
         free(packet);
+        packet = NULL;
       }
     }
-    LOG(LEVEL_DEBUG, "Exit send queue loop!");
   }
+  queue->sending = packet != NULL;
+  unlockMutex(&queue->mutex);
+
+  return packet;
+}
+
+/** 
+ * The thread loop of the output queue of one client. It ends once the queue 
+ * is stopped.
+ * 
+ * @param clientQueue The output queue of the client (ClientSendQueue).
+ * 
+ * @return NULL
+ * 
+ * @since 0.3.0
+ */
+static void* _sendQueueThreadLoop(void* clientQueue)
+{
+  ClientSendQueue* queue = (ClientSendQueue*)clientQueue;
+  SendPacket* packet = NULL;
+
+  LOG(LEVEL_DEBUG, "Enter sendqueue loop.");
+  while ((packet = _fetchSendPacket(queue)) != NULL)
+  {
+    if (!sendPacketToClient(queue->srvSock, queue->client, packet->pdu, 
+                            packet->size))
+    {
+      SRXPROXY_BasicHeader* bhdr = (SRXPROXY_BasicHeader*)packet->pdu;
+      RAISE_ERROR("Could not send packet of type [%u]!", bhdr->type);
+    }
+    else
+    {
+      __atomic_fetch_add(&SEND_QUEUE->sent, 1, __ATOMIC_RELAXED);
+    }
+    free(packet);
+  }
+  LOG(LEVEL_DEBUG, "Exit send queue loop!");
   
   return NULL;
 }
@@ -218,17 +312,7 @@ bool startSendQueue()
   else
   {
     lockMutex(&queue->mutex);
-    if (!queue->running)
-    {
-      queue->running = true;    
-      if (pthread_create(&queue->handler, NULL, sendQueueThreadLoop, NULL) 
-                         != 0)
-      {
-        queue->running = false;
-        RAISE_SYS_ERROR("Could not start the send queue handler!");
-      }
-    }
-
+    queue->running = true;    
     retVal = queue->running;
     unlockMutex(&queue->mutex);
   }
@@ -236,13 +320,63 @@ bool startSendQueue()
 }
 
 /**
- * Stop the queue but does not destroy the thread itself.
+ * Stop the queue of the given client and free all memory associated with it.
+ * The queue MUST be removed from the client and the list of clients already.
+ * Packets not send yet are dropped.
+ *
+ * @param queue The output queue of the client.
+ *
+ * @since 0.6.3.0
+ */
+static void _releaseClientQueue(ClientSendQueue* queue)
+{
+  SendPacket* packet = NULL;
+
+  lockMutex(&queue->mutex);
+  queue->running = false;
+  signalCond(&queue->condition);
+  signalCond(&queue->creditCond);
+  if (queue->sending)
+  {
+    // The client might not read anymore, unblock the sender.
+    shutdown(((ClientThread*)queue->client)->clientFD, SHUT_RDWR);
+  }
+  unlockMutex(&queue->mutex);
+  pthread_join(queue->handler, NULL);
+
+  lockMutex(&queue->mutex);
+  // Let the receiver leave the wait for credits.
+  while (queue->waiting > 0)
+  {
+    signalCond(&queue->creditCond);
+    unlockMutex(&queue->mutex);
+    usleep(1000);
+    lockMutex(&queue->mutex);
+  }
+  while (queue->head != NULL)
+  {
+    packet = queue->head;
+    queue->head = (SendPacket*)packet->next;
+    free(packet);
+  }
+  unlockMutex(&queue->mutex);
+
+  releaseMutex(&queue->mutex);
+  destroyCond(&queue->condition);
+  destroyCond(&queue->creditCond);
+  free(queue);
+}
+
+/**
+ * Stop the queue and all output queues of the clients. Packets not send yet
+ * are dropped.
  * 
  * @since 0.3.0
  */
 void stopSendQueue()
 {
   SendPacketQueue* queue = SEND_QUEUE;
+  ClientSendQueue* clientQueue = NULL;
   
   if (queue == NULL)
   {
@@ -251,143 +385,500 @@ void stopSendQueue()
   else
   {
     lockMutex(&queue->mutex);
-    if (queue->running)
+    queue->running = false;
+    LOG(LEVEL_INFO, "StopSendQueue: stop the queues of %u clients...",
+                    sizeOfSList(&queue->clients));
+    while ((clientQueue = shiftFromSList(&queue->clients)) != NULL)
     {
-      queue->running = false;
-      // Stop the queue by waking it up
-      LOG(LEVEL_INFO, "StopSendQueue: send notification...");
-      signalCond(&queue->condition);
+      ((ClientThread*)clientQueue->client)->sendQueue = NULL;
+      unlockMutex(&queue->mutex);
+      _releaseClientQueue(clientQueue);
+      lockMutex(&queue->mutex);
     }
     unlockMutex(&queue->mutex);
-    // Give the queue thread a chance to process the notify or run into a
-    // wait timeout.   
-    LOG(LEVEL_INFO, "StopSendQueue: sleep for %u ms", SEND_QUEUE_WAIT_MS * 2);
-    usleep(SEND_QUEUE_WAIT_MS * 2);
-    
-    lockMutex(&queue->mutex);
-    // Free the remainder of the queue.
-    LOG(LEVEL_INFO, "StopSendQueue: wait for queue thread to join...");
-    pthread_join(queue->handler, NULL);
-    LOG(LEVEL_INFO, "SendQueueThrealLoop STOPPED. Empty remainder of queue!");
-    SendPacket* packet = NULL;
-    while (queue->head != NULL)
+    LOG(LEVEL_INFO, "SendQueueThreadLoops STOPPED.");
+  }
+}
+
+/**
+ * Create the output queue of the client including its sending thread. In 
+ * case the send queue is not running no queue is created, the packets are
+ * send directly then.
+ *
+ * @param srvSock The server socket to send from.
+ * @param client The client.
+ *
+ * @return false if the queue could not be created.
+ *
+ * @since 0.6.3.0
+ */
+bool createClientSendQueue(ServerSocket* srvSock, ServerClient* client)
+{
+  ClientSendQueue* queue = NULL;
+  bool retVal = true;
+
+  if ((SEND_QUEUE == NULL) || !SEND_QUEUE->running)
+  {
+    return true;
+  }
+
+  queue = malloc(sizeof(ClientSendQueue));
+  if (queue == NULL)
+  {
+    RAISE_SYS_ERROR("Not enough memory to create the send queue of a client!");
+    return false;
+  }
+  memset(queue, 0, sizeof(ClientSendQueue));
+  queue->srvSock = srvSock;
+  queue->client  = client;
+  queue->window  = SEND_QUEUE->window;
+  queue->running = true;
+  if (!initMutex(&queue->mutex))
+  {
+    free(queue);
+    return false;
+  }
+  initCond(&queue->condition);
+  initCond(&queue->creditCond);
+
+  lockMutex(&SEND_QUEUE->mutex);
+  retVal = SEND_QUEUE->running;
+  if (retVal)
+  {
+    if (pthread_create(&queue->handler, NULL, _sendQueueThreadLoop, queue) 
+        != 0)
     {
-      packet = queue->head;
-      queue->head = (SendPacket*)packet->next;
-      // Free the allocated memory
-      free(packet->pdu);
-      free(packet);
-      queue->size--;
+      RAISE_SYS_ERROR("Could not start the send queue handler of a client!");
+      retVal = false;
+    }
+    else if (!appendDataToSList(&SEND_QUEUE->clients, queue))
+    {
+      RAISE_SYS_ERROR("Not enough memory to register the send queue!");
+      queue->running = false;
+      unlockMutex(&SEND_QUEUE->mutex);
+      _releaseClientQueue(queue);
+      return false;
+    }
+    else
+    {
+      ((ClientThread*)client)->sendQueue = queue;
     }
-    queue->tail = NULL;
-    unlockMutex(&queue->mutex);
   }
+  unlockMutex(&SEND_QUEUE->mutex);
+
+  if (!retVal)
+  {
+    releaseMutex(&queue->mutex);
+    destroyCond(&queue->condition);
+    destroyCond(&queue->creditCond);
+    free(queue);
+  }
+
+  return retVal;
 }
 
 /**
- * Retrieve the next packet from the queue as long as the queue is running. 
- * in case the queue is not running this method returns NULL.
- * 
- * @return  the next packet of NULL if the queue is empty.
- * 
- * @since 0.3.0
+ * Stop the output queue of the client and free all memory associated with 
+ * it. Packets not send yet are dropped.
+ *
+ * @param client The client.
+ *
+ * @since 0.6.3.0
  */
-SendPacket* fetchSendPacket() 
+void releaseClientSendQueue(ServerClient* client)
+{
+  ClientSendQueue* queue = NULL;
+
+  if (SEND_QUEUE != NULL)
+  {
+    lockMutex(&SEND_QUEUE->mutex);
+    queue = ((ClientThread*)client)->sendQueue;
+    if (queue != NULL)
+    {
+      ((ClientThread*)client)->sendQueue = NULL;
+      deleteFromSList(&SEND_QUEUE->clients, queue);
+    }
+    unlockMutex(&SEND_QUEUE->mutex);
+
+    if (queue != NULL)
+    {
+      _releaseClientQueue(queue);
+    }
+  }
+}
+
+/**
+ * Return the locked output queue of the client. 
+ *
+ * @param client The client.
+ *
+ * @return The locked queue or NULL if the client does not have a queue.
+ *
+ * @since 0.6.3.0
+ */
+static ClientSendQueue* _lockClientQueue(ServerClient* client)
+{
+  ClientSendQueue* queue = NULL;
+
+  if ((SEND_QUEUE != NULL) && (client != NULL))
+  {
+    lockMutex(&SEND_QUEUE->mutex);
+    queue = ((ClientThread*)client)->sendQueue;
+    if (queue != NULL)
+    {
+      lockMutex(&queue->mutex);
+    }
+    unlockMutex(&SEND_QUEUE->mutex);
+  }
+
+  return queue;
+}
+
+/**
+ * Merge the verify notification into a notification for the same update that
+ * still waits in the queue. Notifications with a receipt are not merged.
+ *
+ * @param queue The locked output queue of the client.
+ * @param pdu The verify notification.
+ *
+ * @return true if the notification was merged.
+ *
+ * @since 0.6.3.0
+ */
+static bool _coalesceNotification(ClientSendQueue* queue,
+                                  SRXPROXY_VERIFY_NOTIFICATION* pdu)
 {
-  SendPacketQueue* queue = SEND_QUEUE;
   SendPacket* packet = NULL;
-  
-  if (queue != NULL)
+  SRXPROXY_VERIFY_NOTIFICATION* queued = NULL;
+
+  if ((pdu->resultType & SRX_FLAG_REQUEST_RECEIPT) != 0)
   {
-    lockMutex(&queue->mutex);
-    while (queue->size == 0 && queue->running)
+    return false;
+  }
+
+  for (packet = queue->head; packet != NULL; packet = packet->next)
+  {
+    queued = (SRXPROXY_VERIFY_NOTIFICATION*)packet->pdu;
+    if (   (queued->type == PDU_SRXPROXY_VERI_NOTIFICATION)
+        && !packet->creditOnly
+        && (queued->updateID == pdu->updateID)
+        && ((queued->resultType & SRX_FLAG_REQUEST_RECEIPT) == 0))
     {
-      // wait until notify is called or after a timeout.      
-      waitCond(&queue->condition, &queue->mutex, SEND_QUEUE_WAIT_MS);
-      if(!queue->running)
+      // The later result replaces the earlier one.
+      if ((pdu->resultType & SRX_FLAG_ROA) != 0)
       {
-        LOG(LEVEL_INFO, "Sending queue received shutdown!");
+        queued->roaResult = pdu->roaResult;
       }
+      if ((pdu->resultType & SRX_FLAG_BGPSEC) != 0)
+      {
+        queued->bgpsecResult = pdu->bgpsecResult;
+      }
+      if ((pdu->resultType & SRX_FLAG_ASPA) != 0)
+      {
+        queued->aspaResult = pdu->aspaResult;
+      }
+      queued->resultType |= pdu->resultType;
+      return true;
     }
+  }
+
+  return false;
+}
+
+/**
+ * Queue a copy of the packet. If the queue is full verify notifications are
+ * merged into queued ones. If this is not possible the client does not read
+ * fast enough and is disconnected.
+ *
+ * @param queue The locked output queue of the client.
+ * @param pdu The PDU to be added to the queue.
+ * @param size The size of the PDU.
+ * @param creditOnly The PDU is a verify notification that only returns
+ *                   credits.
+ *
+ * @return true if the packet was queued, otherwise false.
+ * 
+ * @since 0.3.0
+ */
+static bool _addToSendQueue(ClientSendQueue* queue, void* pdu, size_t size,
+                            bool creditOnly)
+{
+  ClientThread* client = (ClientThread*)queue->client;
+  bool notification = ((SRXPROXY_BasicHeader*)pdu)->type 
+                      == PDU_SRXPROXY_VERI_NOTIFICATION;
+  SendPacket* packet = NULL;
 
-    // If queue is still running and a packet is available take it
-    if (queue->running && queue->head != NULL)
+  if (!queue->running || queue->overflow)
+  {
+    return false;
+  }
+
+  if (queue->size >= SEND_QUEUE->limit)
+  {
+    if (notification && !creditOnly 
+        && _coalesceNotification(queue, (SRXPROXY_VERIFY_NOTIFICATION*)pdu))
     {
-      packet = queue->head;
-      queue->size--;
-      queue->head = (SendPacket*)packet->next;
-      packet->next = NULL;   
+      __atomic_fetch_add(&SEND_QUEUE->coalesced, 1, __ATOMIC_RELAXED);
+      countClientFlow(client->routerID, MET_FLOW_COALESCED);
+      return true;
     }
-    unlockMutex(&queue->mutex);
+    // The client does not keep up, disconnect it rather than growing the 
+    // queue. The receiver of the client releases the queue.
+    LOG(LEVEL_WARNING, "The send queue of proxy [0x%08X] is full (%u packets),"
+                       " disconnect the proxy!", client->proxyID, queue->size);
+    queue->overflow = true;
+    shutdown(client->clientFD, SHUT_RDWR);
+    signalCond(&queue->creditCond);
+    __atomic_fetch_add(&SEND_QUEUE->overflows, 1, __ATOMIC_RELAXED);
+    countClientFlow(client->routerID, MET_FLOW_OVERFLOW);
+    return false;
   }
-  return packet;
+
+  // The PDU is stored right behind the packet.
+  packet = malloc(sizeof(SendPacket) + size);
+  if (packet == NULL)
+  {
+    RAISE_SYS_ERROR("Not enough memory to queue packets in send queue!");
+    return false;
+  }
+  packet->next       = NULL;
+  packet->size       = size;
+  packet->creditOnly = creditOnly;
+  packet->pdu        = (uint8_t*)(packet + 1);
+  memcpy(packet->pdu, pdu, size);
+
+  if (queue->tail == NULL)
+  {
+    queue->head = packet;
+  }
+  else
+  {
+    queue->tail->next = packet;
+  }
+  queue->tail = packet;
+  queue->size++;
+  if (notification)
+  {
+    queue->notifications++;
+  }
+  if (queue->size > queue->maxSize)
+  {
+    queue->maxSize = queue->size;
+  }
+  // Signal a new packet is in the queue
+  signalCond(&queue->condition);
+
+  return true;
 }
 
 /**
- * Queue a copy of the the packet and return the size of the queue. The copy of 
- * the packet will be free'd by the queue handler thread itself.
+ * Queue a copy of the packet in the output queue of the client. If the 
+ * client does not have a queue the packet is send directly.
  * 
- * @param pdu The PDU to be added to the queue.
  * @param srvSoc The server socket to be used for sending
  * @param client The client to send to
+ * @param pdu The PDU to be send.
+ * @param size The size of the PDU.
  * 
- * @return true if the packet was queued, otherwise false.
+ * @return true if the packet was queued or send, otherwise false.
  * 
- * @since 0.3.0
+ * @since 0.6.3.0
  */
-bool addToSendQueue(uint8_t* pdu, ServerSocket* srvSoc, ServerClient* client, 
-                    size_t size)
+bool queuePacketToClient(ServerSocket* srvSoc, ServerClient* client, 
+                         void* pdu, size_t size)
 {
-
-  printf("Were in addToSendQueue\n");
-  SendPacketQueue* queue = SEND_QUEUE;
-  
-  SendPacket* packet = malloc(sizeof(SendPacket));
+  ClientSendQueue* queue = _lockClientQueue(client);
   bool retVal = false;
-  
-  lockMutex(&queue->mutex);
-  if (packet != NULL)
+
+  if (queue == NULL)
   {
-    memset(packet, 0, sizeof(SendPacket));
-    packet->pdu = malloc(size);
-    if (packet->pdu == NULL)
+    if (SEND_QUEUE == NULL)
     {
-      printf("Packet->pdu is NULL\n");
-      free(packet);
+      LOG_RATE_LIMITED(LEVEL_WARNING, 10, "The sender queue is not "
+                       "initialized, send PDU directly without queue!");
     }
-    else
+    retVal = sendPacketToClient(srvSoc, client, pdu, size);
+  }
+  else
+  {
+    retVal = _addToSendQueue(queue, pdu, size, false);
+    unlockMutex(&queue->mutex);
+  }
+
+  return retVal;
+}
+
+/**
+ * Set the window of outstanding verify requests of the client. This is 
+ * called during the handshake.
+ *
+ * @param client The client.
+ * @param window The window requested by the client, zero if the client does
+ *               not support the flow control.
+ *
+ * @return The granted window or zero if the client does not use the flow
+ *         control.
+ *
+ * @since 0.6.3.0
+ */
+uint32_t grantClientWindow(ServerClient* client, uint32_t window)
+{
+  ClientSendQueue* queue = _lockClientQueue(client);
+  uint32_t granted = 0;
+
+  if (queue != NULL)
+  {
+    queue->useCredits = window > 0;
+    queue->window     = SEND_QUEUE->window;
+    if (queue->useCredits)
     {
-      printf("Packet->pdu is NOT NULL\n");
-      retVal = true;
-      packet->srcSock  = srvSoc;
-      packet->client   = client;
-      packet->next     = NULL;
-      packet->size     = size;
-      memcpy(packet->pdu, pdu, size);  
-      if (queue->size == 0)
+      if (window < queue->window)
       {
-        queue->head = packet;
-        queue->tail = packet;
+        queue->window = window;
       }
-      else
+      granted = queue->window;
+    }
+    unlockMutex(&queue->mutex);
+  }
+
+  return granted;
+}
+
+/**
+ * Take one credit for a verify request of the client. If the client has all
+ * of its window outstanding this call blocks until a credit is returned. 
+ * This is called by the receiver of the client, it stops reading until the
+ * client is within its window again. Clients that did not negotiate the
+ * flow control never return credits, their requests are only counted.
+ *
+ * @param client The client.
+ *
+ * @return false if the client is disconnected.
+ *
+ * @since 0.6.3.0
+ */
+bool acquireClientCredit(ServerClient* client)
+{
+  ClientSendQueue* queue = _lockClientQueue(client);
+  bool retVal = true;
+  int  cancelState;
+
+  if (queue != NULL)
+  {
+    if (   queue->useCredits && (queue->outstanding >= queue->window) 
+        && queue->running && !queue->overflow)
+    {
+      __atomic_fetch_add(&SEND_QUEUE->creditWaits, 1, __ATOMIC_RELAXED);
+      countClientFlow(((ClientThread*)client)->routerID, 
+                      MET_FLOW_CREDIT_WAIT);
+      // The queue is released only after the wait is left.
+      pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancelState);
+      queue->waiting++;
+      while (   (queue->outstanding >= queue->window) 
+             && queue->running && !queue->overflow)
       {
-        queue->tail->next = packet;
-        queue->tail = packet;
+        waitCond(&queue->creditCond, &queue->mutex, SEND_QUEUE_WAIT_MS);
       }
-      queue->size++;
-      // Signal a new packet is in the queue
-      printf("Signaling condition\n");
-      signalCond(&queue->condition);
+      queue->waiting--;
+      pthread_setcancelstate(cancelState, NULL);
     }
+    retVal = queue->running && !queue->overflow;
+    if (retVal)
+    {
+      queue->outstanding++;
+    }
+    unlockMutex(&queue->mutex);
   }
-  unlockMutex(&queue->mutex);
-  
-  if (!retVal)
+
+  return retVal;
+}
+
+/**
+ * Return the credit of a processed verify request of the client. The credit
+ * is handed to the client with the next verify notification. If none is 
+ * queued and enough credits are collected a notification that only carries
+ * the credits is queued.
+ *
+ * @param client The client.
+ *
+ * @since 0.6.3.0
+ */
+void returnClientCredit(ServerClient* client)
+{
+  ClientSendQueue* queue = _lockClientQueue(client);
+  SRXPROXY_VERIFY_NOTIFICATION pdu;
+
+  if (queue != NULL)
   {
-    RAISE_SYS_ERROR("Not enough memory to queue packets in send queue!");
+    if (queue->outstanding > 0)
+    {
+      queue->outstanding--;
+      if (queue->waiting > 0)
+      {
+        signalCond(&queue->creditCond);
+      }
+      if (queue->useCredits)
+      {
+        queue->credits++;
+        if (   (queue->notifications == 0) 
+            && (queue->credits >= SQ_CREDIT_BATCH(queue->window)))
+        {
+          memset(&pdu, 0, sizeof(SRXPROXY_VERIFY_NOTIFICATION));
+          pdu.type   = PDU_SRXPROXY_VERI_NOTIFICATION;
+          pdu.length = htonl(sizeof(SRXPROXY_VERIFY_NOTIFICATION));
+          _addToSendQueue(queue, &pdu, sizeof(SRXPROXY_VERIFY_NOTIFICATION), 
+                          true);
+        }
+      }
+    }
+    unlockMutex(&queue->mutex);
+  }
+}
+
+/**
+ * Fill the statistics of the output queues of all clients.
+ *
+ * @param stats The statistics to be filled.
+ *
+ * @since 0.6.3.0
+ */
+void getSendQueueStats(SendQueueStats* stats)
+{
+  ClientSendQueue* queue = NULL;
+  SListNode*       node  = NULL;
+
+  memset(stats, 0, sizeof(SendQueueStats));
+  if (SEND_QUEUE != NULL)
+  {
+    lockMutex(&SEND_QUEUE->mutex);
+    FOREACH_SLIST(&SEND_QUEUE->clients, node)
+    {
+      queue = (ClientSendQueue*)getDataOfSListNode(node);
+      lockMutex(&queue->mutex);
+      stats->clients++;
+      stats->queued      += queue->size;
+      stats->outstanding += queue->outstanding;
+      if (queue->maxSize > stats->maxDepth)
+      {
+        stats->maxDepth = queue->maxSize;
+      }
+      if (queue->useCredits)
+      {
+        stats->creditClients++;
+      }
+      unlockMutex(&queue->mutex);
+    }
+    stats->limit  = SEND_QUEUE->limit;
+    stats->window = SEND_QUEUE->window;
+    unlockMutex(&SEND_QUEUE->mutex);
+    stats->sent        = __atomic_load_n(&SEND_QUEUE->sent, __ATOMIC_RELAXED);
+    stats->coalesced   = __atomic_load_n(&SEND_QUEUE->coalesced, 
+                                         __ATOMIC_RELAXED);
+    stats->creditWaits = __atomic_load_n(&SEND_QUEUE->creditWaits, 
+                                         __ATOMIC_RELAXED);
+    stats->overflows   = __atomic_load_n(&SEND_QUEUE->overflows, 
+                                         __ATOMIC_RELAXED);
   }
-  
-  return retVal;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -409,25 +900,16 @@ bool __sendPacketToClient(ServerSocket* srvSoc, ServerClient* client,
                           void* pdu, size_t size, bool useQueue)
 {
   bool retVal = false;
-  printf("Sending packet with PDU type: %u\n", ((SRXPROXY_BasicHeader*)pdu)->type);
+  LOG(LEVEL_DEBUG, "Send PDU type %u %s the send queue",
+      ((SRXPROXY_BasicHeader*)pdu)->type, useQueue ? "using" : "without");
   
   if (!useQueue)
   {
-    printf("We are not using the queue\n");
-    printf("PDU type: %u\n", ((SRXPROXY_BasicHeader*)pdu)->type);
     retVal = sendPacketToClient(srvSoc, client, pdu, size);
   }
   else 
   {
-    if (SEND_QUEUE==NULL)
-    {
-      LOG(LEVEL_WARNING, "The sender queue is not initialized, send PDU directly "
-                         "without queue!");
-    }
-    else
-    {
-      retVal = addToSendQueue(pdu, srvSoc, client, size);
-    }
+    retVal = queuePacketToClient(srvSoc, client, pdu, size);
   }
   
   return retVal;
@@ -439,11 +921,14 @@ bool __sendPacketToClient(ServerSocket* srvSoc, ServerClient* client,
  * @param proxyID The id of the proxy
  * @param srvSoc The server socket
  * @param client The client who received the original message
+ * @param syncRequest Indicates that a synchronization request follows.
+ * @param window The granted window of outstanding verify requests or zero if
+ *               the client does not use the flow control.
  *
  * @return true if the packet could be send, otherwise false.
  */
 bool sendHelloResponse(ServerSocket* srvSoc, ServerClient* client,
-                       uint32_t proxyID)
+                       uint32_t proxyID, bool syncRequest, uint32_t window)
 {
   bool retVal = true;
   uint32_t length = sizeof(SRXPROXY_HELLO_RESPONSE);
@@ -454,12 +939,30 @@ bool sendHelloResponse(ServerSocket* srvSoc, ServerClient* client,
   pdu->version = htons(SRX_PROTOCOL_VER);
   pdu->length  = htonl(length);
   pdu->proxyIdentifier = htonl(proxyID);
+  if (((ClientThread*)client)->shm != NULL)
+  {
+    pdu->reserved8 = SRX_PROXY_FLAG_SHM;
+  }
+  if (syncRequest)
+  {
+    pdu->reserved8 |= SRX_PROXY_FLAG_SYNC;
+  }
+  if (window > 0)
+  {
+    pdu->reserved8 |= SRX_PROXY_FLAG_CREDIT;
+    pdu->window     = htonl(window);
+  }
   
   if (!sendPacketToClient(srvSoc, client, pdu, length))
   {
     RAISE_ERROR("Could not send Goodbye message!");
     retVal = false;
   }
+  else
+  {
+    // The response is the last packet send over TCP.
+    enableClientShm(client);
+  }
 
   free(pdu);
   return retVal;
@@ -478,7 +981,7 @@ bool sendHelloResponse(ServerSocket* srvSoc, ServerClient* client,
  */
 bool sendTransitiveSignature(ServerSocket* srvSoc, ServerClient* client)
 {
-  printf("Trying to send stuff"); 
+  LOG(LEVEL_DEBUG, "Send the transitive signature");
   bool retVal = true;/*
 
 
@@ -732,7 +1235,7 @@ extern void cb_proxyCallbackHandler_Service(int p0, void* p1);
  */
 bool sendSigtraResult(ServerSocket* srvSoc, ServerClient* client,bool result, bool useQueue,
                       uint32_t signature_identifier){
-  printf("Sending Sigtra Result\n");
+  LOG(LEVEL_DEBUG, "Send the SigTra result");
   bool retVal = true;
   uint32_t length = sizeof(SRXPROXY_SIGTRA_VALIDATION_RESPONSE);
   SRXPROXY_SIGTRA_VALIDATION_RESPONSE* pdu = malloc(length);
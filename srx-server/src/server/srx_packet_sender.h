@@ -41,14 +41,54 @@
 #include <stdbool.h>
 #include "util/server_socket.h"
 
+/** The default number of packets queued per client. */
+#define SQ_DEF_QUEUE_LIMIT 65536
+/** The default window of outstanding verify requests per client. */
+#define SQ_DEF_WINDOW      4096
+/** The credits collected before they are returned without a notification. */
+#define SQ_CREDIT_BATCH(window) ((window) >= 8 ? (window) / 8 : 1)
+
+/**
+ * The statistics of the output queues.
+ */
+typedef struct {
+  /** The clients with an output queue. */
+  uint32_t clients;
+  /** The clients that negotiated the flow control. */
+  uint32_t creditClients;
+  /** The packets in all queues. */
+  uint32_t queued;
+  /** The largest size of a queue. */
+  uint32_t maxDepth;
+  /** The verify requests of all clients not processed yet. */
+  uint32_t outstanding;
+  /** The configured limit of a queue. */
+  uint32_t limit;
+  /** The configured window. */
+  uint32_t window;
+  /** The packets send by the queues. */
+  uint64_t sent;
+  /** The verify notifications merged into queued ones. */
+  uint64_t coalesced;
+  /** The times a receiver waited for credits. */
+  uint64_t creditWaits;
+  /** The clients disconnected because of a full queue. */
+  uint64_t overflows;
+} SendQueueStats;
+
 /**
- * Create the sender queue including the thread that manages the queue.
+ * Create the sender queue. The output queues of the clients including their
+ * sending threads are created once the clients connect.
+ * 
+ * @param queueLimit The maximum number of packets queued per client.
+ * @param window The maximum number of verify requests a client can have 
+ *               outstanding.
  * 
  * @return true if the queue cold be created otherwise false. 
  * 
  * @since 0.3.0
  */
-bool createSendQueue();
+bool createSendQueue(uint32_t queueLimit, uint32_t window);
 
 /**
  * Start the send queue. In case the queue is already started this method does 
@@ -61,7 +101,8 @@ bool createSendQueue();
 bool startSendQueue();
 
 /**
- * Stop the queue but does not destroy the thread itself.
+ * Stop the queue and all output queues of the clients. Packets not send yet
+ * are dropped.
  * 
  * @since 0.3.0
  */
@@ -75,17 +116,106 @@ void stopSendQueue();
  */
 void releaseSendQueue();
 
+/**
+ * Create the output queue of the client including its sending thread. In 
+ * case the send queue is not running no queue is created, the packets are
+ * send directly then.
+ *
+ * @param srvSock The server socket to send from.
+ * @param client The client.
+ *
+ * @return false if the queue could not be created.
+ *
+ * @since 0.6.3.0
+ */
+bool createClientSendQueue(ServerSocket* srvSock, ServerClient* client);
+
+/**
+ * Stop the output queue of the client and free all memory associated with 
+ * it. Packets not send yet are dropped.
+ *
+ * @param client The client.
+ *
+ * @since 0.6.3.0
+ */
+void releaseClientSendQueue(ServerClient* client);
+
+/**
+ * Set the window of outstanding verify requests of the client. This is 
+ * called during the handshake.
+ *
+ * @param client The client.
+ * @param window The window requested by the client, zero if the client does
+ *               not support the flow control.
+ *
+ * @return The granted window or zero if the client does not use the flow
+ *         control.
+ *
+ * @since 0.6.3.0
+ */
+uint32_t grantClientWindow(ServerClient* client, uint32_t window);
+
+/**
+ * Take one credit for a verify request of the client. If the client has all
+ * of its window outstanding this call blocks until a credit is returned.
+ * The window is only enforced if the client negotiated the flow control.
+ *
+ * @param client The client.
+ *
+ * @return false if the client is disconnected.
+ *
+ * @since 0.6.3.0
+ */
+bool acquireClientCredit(ServerClient* client);
+
+/**
+ * Return the credit of a processed verify request of the client.
+ *
+ * @param client The client.
+ *
+ * @since 0.6.3.0
+ */
+void returnClientCredit(ServerClient* client);
+
+/**
+ * Queue a copy of the packet in the output queue of the client. If the 
+ * client does not have a queue the packet is send directly.
+ * 
+ * @param srvSoc The server socket to be used for sending
+ * @param client The client to send to
+ * @param pdu The PDU to be send.
+ * @param size The size of the PDU.
+ * 
+ * @return true if the packet was queued or send, otherwise false.
+ * 
+ * @since 0.6.3.0
+ */
+bool queuePacketToClient(ServerSocket* srvSoc, ServerClient* client, 
+                         void* pdu, size_t size);
+
+/**
+ * Fill the statistics of the output queues of all clients.
+ *
+ * @param stats The statistics to be filled.
+ *
+ * @since 0.6.3.0
+ */
+void getSendQueueStats(SendQueueStats* stats);
+
 /**
  * Send a hello response to the client. This method does not use the send queue
  *
  * @param proxyID The id of the proxy
  * @param srcSock The server socket
  * @param client The client who received the original message
+ * @param syncRequest Indicates that a synchronization request follows.
+ * @param window The granted window of outstanding verify requests or zero if
+ *               the client does not use the flow control.
  *
  * @return true if the packet could be send, otherwise false.
  */
 bool sendHelloResponse(ServerSocket* srcSock, ServerClient* client,
-                       uint32_t proxyID);
+                       uint32_t proxyID, bool syncRequest, uint32_t window);
 
 /**
  * Send a goodbye packet to the proxy. The proxy does not use the keepWindow,
@@ -0,0 +1,458 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The sampled trace of the updates and its dump file.
+ *
+ * @version 0.6.3.0
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "server/trace.h"
+#include "util/log.h"
+
+#define HDR "([0x%08X] Trace): "
+
+/** The ring of one thread. Only the owner moves the head, only the drain
+ * moves the tail. */
+typedef struct _TraceRing {
+  /** The events, TRACE_RING_SIZE is a power of two. */
+  TraceEvent         events[TRACE_RING_SIZE];
+  /** The position the next event is written to. */
+  uint32_t           head;
+  /** The position the next event is drained from. */
+  uint32_t           tail;
+  /** The events dropped because the ring was full. */
+  uint64_t           dropped;
+  /** Indicates the ring is owned by a running thread. */
+  bool               inUse;
+  /** The number of the ring, written into each event. */
+  uint16_t           thread;
+  /** The next ring. */
+  struct _TraceRing* next;
+} TraceRing;
+
+/** The names of the stages ending at each point. */
+static const char* _STAGE_NAMES[TRC_NUM_POINTS] = {
+  "start", "receive", "queue_wait", "bgpsec", "origin", "aspa", "send"
+};
+
+/** Indicates if updates are traced. */
+static bool            _enabled    = false;
+/** One out of _sampleRate updates is traced. */
+static uint32_t        _sampleRate = 0;
+/** Gives each thread its ring, the ring is handed back once it exits. */
+static pthread_key_t   _ringKey;
+/** All rings. Rings are only added, never removed until released. */
+static TraceRing*      _rings      = NULL;
+/** The number of rings. */
+static uint16_t        _noRings    = 0;
+/** Only one drain at a time. */
+static pthread_mutex_t _drainMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Hand the ring of an exiting thread back for reuse by the next thread.
+ *
+ * @param ring The ring of the thread.
+ */
+static void _returnRing(void* ring)
+{
+  __atomic_store_n(&((TraceRing*)ring)->inUse, false, __ATOMIC_RELEASE);
+}
+
+/**
+ * Return the ring of the calling thread. A thread gets the ring of a finished
+ * thread or a new one with its first event.
+ *
+ * @return the ring or NULL if not enough memory is available.
+ */
+static TraceRing* _getRing()
+{
+  TraceRing* ring = (TraceRing*)pthread_getspecific(_ringKey);
+  bool       expected;
+
+  if (ring != NULL)
+  {
+    return ring;
+  }
+
+  for (ring = __atomic_load_n(&_rings, __ATOMIC_ACQUIRE); ring != NULL;
+       ring = ring->next)
+  {
+    expected = false;
+    if (__atomic_compare_exchange_n(&ring->inUse, &expected, true, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+      break;
+    }
+  }
+
+  if (ring == NULL)
+  {
+    ring = calloc(1, sizeof(TraceRing));
+    if (ring == NULL)
+    {
+      return NULL;
+    }
+    ring->inUse  = true;
+    ring->thread = __atomic_fetch_add(&_noRings, 1, __ATOMIC_RELAXED);
+    ring->next   = __atomic_load_n(&_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&_rings, &ring->next, ring, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    LOG(LEVEL_DEBUG, HDR "Trace ring %u created", pthread_self(),
+                     ring->thread);
+  }
+  pthread_setspecific(_ringKey, ring);
+
+  return ring;
+}
+
+/**
+ * Enable the trace.
+ *
+ * @param sampleRate Trace one out of sampleRate updates, 0 disables the trace.
+ *
+ * @return false if the rings could not be prepared.
+ *
+ * @since 0.6.3.0
+ */
+bool initTrace(uint32_t sampleRate)
+{
+  if ((sampleRate == 0) || _enabled)
+  {
+    return true;
+  }
+  if (pthread_key_create(&_ringKey, _returnRing) != 0)
+  {
+    RAISE_SYS_ERROR("Could not create the key of the trace rings!");
+    return false;
+  }
+  _sampleRate = sampleRate;
+  __atomic_store_n(&_enabled, true, __ATOMIC_RELEASE);
+  LOG(LEVEL_INFO, "Trace one out of %u updates", sampleRate);
+
+  return true;
+}
+
+/**
+ * Disable the trace and release all rings. Events not drained are lost.
+ * No other thread may write trace events anymore.
+ *
+ * @since 0.6.3.0
+ */
+void releaseTrace()
+{
+  TraceRing* ring;
+
+  if (!_enabled)
+  {
+    return;
+  }
+  __atomic_store_n(&_enabled, false, __ATOMIC_RELEASE);
+  pthread_mutex_lock(&_drainMutex);
+  pthread_key_delete(_ringKey);
+  while (_rings != NULL)
+  {
+    ring   = _rings;
+    _rings = ring->next;
+    free(ring);
+  }
+  _noRings = 0;
+  pthread_mutex_unlock(&_drainMutex);
+}
+
+/**
+ * Determine if the given update is traced. The ID is mixed first, the IDs of
+ * updates with a collision only differ in the lowest bits.
+ *
+ * @param updateID The update.
+ *
+ * @return true if the trace is enabled and the update is part of the sample.
+ *
+ * @since 0.6.3.0
+ */
+bool isUpdateTraced(SRxUpdateID updateID)
+{
+  uint32_t hash = updateID;
+
+  if (!__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    return false;
+  }
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6B;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35;
+  hash ^= hash >> 16;
+
+  return (hash % _sampleRate) == 0;
+}
+
+/**
+ * Return the current time if the trace is enabled. This is used if the
+ * update ID is not known yet.
+ *
+ * @return the monotonic time in nanoseconds or 0 if the trace is disabled.
+ *
+ * @since 0.6.3.0
+ */
+uint64_t traceTime()
+{
+  struct timespec now;
+
+  if (!__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    return 0;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Return the current time if the given update is traced.
+ *
+ * @param updateID The update.
+ *
+ * @return the monotonic time in nanoseconds or 0 if the update is not traced.
+ *
+ * @since 0.6.3.0
+ */
+uint64_t traceNow(SRxUpdateID updateID)
+{
+  return isUpdateTraced(updateID) ? traceTime() : 0;
+}
+
+/**
+ * Record that the update passed the given point now. Nothing is recorded if
+ * the update is not traced.
+ *
+ * @param updateID The update.
+ * @param point The point passed.
+ *
+ * @since 0.6.3.0
+ */
+void traceUpdate(SRxUpdateID updateID, TracePoint point)
+{
+  traceUpdateAt(updateID, point, traceNow(updateID));
+}
+
+/**
+ * Record that the update passed the given point at the given time. Nothing is
+ * recorded if the time is 0.
+ *
+ * @param updateID The update.
+ * @param point The point passed.
+ * @param time The time returned by traceNow.
+ *
+ * @since 0.6.3.0
+ */
+void traceUpdateAt(SRxUpdateID updateID, TracePoint point, uint64_t time)
+{
+  TraceRing*  ring;
+  TraceEvent* event;
+  uint32_t    head;
+
+  if ((time == 0) || !__atomic_load_n(&_enabled, __ATOMIC_RELAXED))
+  {
+    return;
+  }
+  ring = _getRing();
+  if (ring == NULL)
+  {
+    return;
+  }
+
+  head = ring->head;
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= TRACE_RING_SIZE)
+  {
+    __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  event = &ring->events[head & (TRACE_RING_SIZE - 1)];
+  event->time     = time;
+  event->updateID = updateID;
+  event->thread   = ring->thread;
+  event->point    = (uint8_t)point;
+  event->reserved = 0;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Drain the events of all rings and append them as one block to the given
+ * dump file.
+ *
+ * @param fileName The name of the dump file.
+ * @param noEvents (out) The number of events written.
+ *
+ * @return false if the trace is disabled or the file could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool dumpTrace(const char* fileName, uint32_t* noEvents)
+{
+  TraceBlockHeader header;
+  TraceRing*       ring;
+  FILE*            file;
+  long             headerPos;
+  uint32_t         head;
+  uint32_t         tail;
+  uint32_t         count;
+  bool             retVal = true;
+
+  *noEvents = 0;
+  if (!_enabled)
+  {
+    return false;
+  }
+  // Not opened for appending, the header is written again after the events.
+  file = fopen(fileName, "r+b");
+  if (file == NULL)
+  {
+    file = fopen(fileName, "w+b");
+  }
+  if ((file == NULL) || (fseek(file, 0, SEEK_END) != 0))
+  {
+    RAISE_ERROR("Could not open the trace dump '%s'!", fileName);
+    if (file != NULL)
+    {
+      fclose(file);
+    }
+    return false;
+  }
+
+  memset(&header, 0, sizeof(TraceBlockHeader));
+  header.magic      = TRACE_MAGIC;
+  header.version    = TRACE_VERSION;
+  header.sampleRate = _sampleRate;
+
+  pthread_mutex_lock(&_drainMutex);
+  headerPos = ftell(file);
+  retVal = fwrite(&header, sizeof(TraceBlockHeader), 1, file) == 1;
+  for (ring = __atomic_load_n(&_rings, __ATOMIC_ACQUIRE);
+       retVal && (ring != NULL); ring = ring->next)
+  {
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    tail = ring->tail;
+    while (retVal && (tail != head))
+    {
+      // Write up to the end of the array, the rest in the next turn.
+      count = TRACE_RING_SIZE - (tail & (TRACE_RING_SIZE - 1));
+      if (count > head - tail)
+      {
+        count = head - tail;
+      }
+      retVal = fwrite(&ring->events[tail & (TRACE_RING_SIZE - 1)],
+                      sizeof(TraceEvent), count, file) == count;
+      tail            += count;
+      header.noEvents += count;
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    header.dropped += __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+  }
+  if (retVal)
+  {
+    retVal =    (fseek(file, headerPos, SEEK_SET) == 0)
+             && (fwrite(&header, sizeof(TraceBlockHeader), 1, file) == 1);
+  }
+  pthread_mutex_unlock(&_drainMutex);
+
+  if (fclose(file) != 0)
+  {
+    retVal = false;
+  }
+  if (!retVal)
+  {
+    RAISE_ERROR("Could not write the trace dump '%s'!", fileName);
+    return false;
+  }
+  if (header.dropped > 0)
+  {
+    LOG(LEVEL_NOTICE, "%llu trace events dropped, the trace rings were full!",
+                      (unsigned long long)header.dropped);
+  }
+  *noEvents = header.noEvents;
+
+  return true;
+}
+
+/**
+ * Read the next block of a dump file.
+ *
+ * @param file The dump file.
+ * @param header (out) The header of the block.
+ * @param events (out) The events of the block which MUST be freed by the
+ *               caller or NULL if the end of the file is reached. An empty
+ *               block returns an allocated array as well.
+ *
+ * @return false if the block is damaged or not enough memory is available.
+ *
+ * @since 0.6.3.0
+ */
+bool readTraceBlock(FILE* file, TraceBlockHeader* header, TraceEvent** events)
+{
+  size_t bytes = fread(header, 1, sizeof(TraceBlockHeader), file);
+
+  *events = NULL;
+  if (bytes == 0)
+  {
+    return !ferror(file);
+  }
+  if (   (bytes != sizeof(TraceBlockHeader)) || (header->magic != TRACE_MAGIC)
+      || (header->version != TRACE_VERSION))
+  {
+    RAISE_ERROR("Invalid trace block!");
+    return false;
+  }
+  // Allocate at least one event, an empty block is not the end of the file.
+  *events = malloc(sizeof(TraceEvent) * (header->noEvents + 1));
+  if (*events == NULL)
+  {
+    RAISE_ERROR("Not enough memory to read %u trace events!",
+                header->noEvents);
+    return false;
+  }
+  if (fread(*events, sizeof(TraceEvent), header->noEvents, file)
+      != header->noEvents)
+  {
+    RAISE_ERROR("The trace block is truncated!");
+    free(*events);
+    *events = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Return the name of the stage that ends at the given point.
+ *
+ * @param point The trace point.
+ *
+ * @return the name or "unknown".
+ *
+ * @since 0.6.3.0
+ */
+const char* traceStageName(uint8_t point)
+{
+  return point < TRC_NUM_POINTS ? _STAGE_NAMES[point] : "unknown";
+}
@@ -0,0 +1,216 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The trace stamps the monotonic time at each point an update passes on its
+ * way through srx-server. Only a sample of the updates is traced (1 in N),
+ * the decision is made on the update ID, this way all threads agree on it
+ * without passing any state along.
+ *
+ * Each thread writes its events into its own ring which is drained into a
+ * binary dump file. Writing into the ring does not take any lock, if the ring
+ * is full the event is dropped and counted. The dump is read by the tool
+ * srx_trace which prints the latency percentiles per stage.
+ *
+ * @version 0.6.3.0
+ */
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "shared/srx_defs.h"
+
+/** The points an update passes. The stage of a point is the time since the
+ * previous point of the same update. */
+typedef enum {
+  /** The validation request was received from a proxy. */
+  TRC_POINT_RECEIVE  = 0,
+  /** The validation request was added to the command queue. */
+  TRC_POINT_QUEUED   = 1,
+  /** The command handler fetched the validation request. */
+  TRC_POINT_DEQUEUED = 2,
+  /** The BGPsec path validation finished. */
+  TRC_POINT_BGPSEC   = 3,
+  /** The origin validation finished. */
+  TRC_POINT_ORIGIN   = 4,
+  /** The ASPA validation finished. */
+  TRC_POINT_ASPA     = 5,
+  /** The result was send to the clients of the update. */
+  TRC_POINT_SENT     = 6
+} TracePoint;
+
+/** The number of trace points. */
+#define TRC_NUM_POINTS    7
+
+/** The number of events each thread can hold until the ring is drained. */
+#define TRACE_RING_SIZE   4096
+
+/** Identifies a block of the dump file ("SRXT"). */
+#define TRACE_MAGIC       0x54585253
+/** The version of the dump file. */
+#define TRACE_VERSION     1
+
+/** One trace event. */
+typedef struct {
+  /** The monotonic time in nanoseconds. */
+  uint64_t    time;
+  /** The update the event is for. */
+  SRxUpdateID updateID;
+  /** The number of the ring the event was written to. A ring is owned by
+   * one thread at a time. */
+  uint16_t    thread;
+  /** The TracePoint. */
+  uint8_t     point;
+  uint8_t     reserved;
+} TraceEvent;
+
+/** Each drain appends a block to the dump file, the header is followed by
+ * noEvents TraceEvent. */
+typedef struct {
+  /** TRACE_MAGIC */
+  uint32_t magic;
+  /** TRACE_VERSION */
+  uint16_t version;
+  uint16_t reserved;
+  /** One out of sampleRate updates is traced. */
+  uint32_t sampleRate;
+  /** The number of events that follow. */
+  uint32_t noEvents;
+  /** The events dropped since the previous block because a ring was full. */
+  uint64_t dropped;
+} TraceBlockHeader;
+
+/**
+ * Enable the trace.
+ *
+ * @param sampleRate Trace one out of sampleRate updates, 0 disables the trace.
+ *
+ * @return false if the rings could not be prepared.
+ *
+ * @since 0.6.3.0
+ */
+bool initTrace(uint32_t sampleRate);
+
+/**
+ * Disable the trace and release all rings. Events not drained are lost.
+ * No other thread may write trace events anymore.
+ *
+ * @since 0.6.3.0
+ */
+void releaseTrace();
+
+/**
+ * Determine if the given update is traced.
+ *
+ * @param updateID The update.
+ *
+ * @return true if the trace is enabled and the update is part of the sample.
+ *
+ * @since 0.6.3.0
+ */
+bool isUpdateTraced(SRxUpdateID updateID);
+
+/**
+ * Return the current time if the trace is enabled. This is used if the
+ * update ID is not known yet.
+ *
+ * @return the monotonic time in nanoseconds or 0 if the trace is disabled.
+ *
+ * @since 0.6.3.0
+ */
+uint64_t traceTime();
+
+/**
+ * Return the current time if the given update is traced.
+ *
+ * @param updateID The update.
+ *
+ * @return the monotonic time in nanoseconds or 0 if the update is not traced.
+ *
+ * @since 0.6.3.0
+ */
+uint64_t traceNow(SRxUpdateID updateID);
+
+/**
+ * Record that the update passed the given point now. Nothing is recorded if
+ * the update is not traced.
+ *
+ * @param updateID The update.
+ * @param point The point passed.
+ *
+ * @since 0.6.3.0
+ */
+void traceUpdate(SRxUpdateID updateID, TracePoint point);
+
+/**
+ * Record that the update passed the given point at the given time. Nothing is
+ * recorded if the time is 0.
+ *
+ * @param updateID The update.
+ * @param point The point passed.
+ * @param time The time returned by traceNow.
+ *
+ * @since 0.6.3.0
+ */
+void traceUpdateAt(SRxUpdateID updateID, TracePoint point, uint64_t time);
+
+/**
+ * Drain the events of all rings and append them as one block to the given
+ * dump file.
+ *
+ * @param fileName The name of the dump file.
+ * @param noEvents (out) The number of events written.
+ *
+ * @return false if the trace is disabled or the file could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool dumpTrace(const char* fileName, uint32_t* noEvents);
+
+/**
+ * Read the next block of a dump file.
+ *
+ * @param file The dump file.
+ * @param header (out) The header of the block.
+ * @param events (out) The events of the block which MUST be freed by the
+ *               caller or NULL if the end of the file is reached. An empty
+ *               block returns an allocated array as well.
+ *
+ * @return false if the block is damaged or not enough memory is available.
+ *
+ * @since 0.6.3.0
+ */
+bool readTraceBlock(FILE* file, TraceBlockHeader* header, TraceEvent** events);
+
+/**
+ * Return the name of the stage that ends at the given point.
+ *
+ * @param point The trace point.
+ *
+ * @return the name or "unknown".
+ *
+ * @since 0.6.3.0
+ */
+const char* traceStageName(uint8_t point);
+
+#endif // __TRACE_H__
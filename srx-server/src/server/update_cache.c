@@ -80,6 +80,7 @@
 #include <stdint.h>
 #include <malloc.h>
 #include <time.h>
+#include <unistd.h>
 #include <srx/srxcryptoapi.h>
 #include "server/update_cache.h"
 #include "server/server_connection_handler.h"
@@ -277,6 +278,11 @@ static void tableAdd(UpdateCache* self, CacheEntry* cEntry)
 static void tableDel(UpdateCache* self, CacheEntry* cEntry)
 {
   acquireWriteLock(&self->tableLock);
+  // A running export continues with the next update.
+  if (self->exportCursor == cEntry)
+  {
+    self->exportCursor = cEntry->hh.next;
+  }
   HASH_DEL(*((CacheEntry**)&self->table), cEntry);
   unlockWriteLock(&self->tableLock);
 }
@@ -310,6 +316,14 @@ bool createUpdateCache(UpdateCache* self, UpdateResultChanged chCallback,
     releaseMutex(&self->itemMutex);
     return false;
   }
+  if (!initMutex(&self->exportMutex))
+  {
+    RAISE_ERROR("Unable to setup the export Mutex");
+    releaseRWLock(&self->tableLock);
+    releaseMutex(&self->itemMutex);
+    return false;
+  }
+  self->exportCursor = NULL;
 
   self->resChangedCallback = chCallback;
   // By default keep the hashtable null, it will be initialized with the first
@@ -335,6 +349,7 @@ void releaseUpdateCache(UpdateCache* self)
   {
     releaseRWLock(&self->tableLock);
     releaseMutex(&self->itemMutex);
+    releaseMutex(&self->exportMutex);
 
     // Empty cache first
     emptyUpdateCache(self);
@@ -572,8 +587,8 @@ int storeUpdate(UpdateCache* self, uint8_t clientID, void* clientMapping,
   // Existing entry then only update the result values.
   if (tableFind(self, updID, &cEntry))
   {
-    LOG(LEVEL_WARNING, "Attempt to store an update that already exists in "
-                       "update cache!");
+    LOG_RATE_LIMITED(LEVEL_WARNING, 10, "Attempt to store an update that "
+                     "already exists in update cache!");
     retVal = 0;
   }
   else
@@ -698,6 +713,14 @@ int storeUpdate(UpdateCache* self, uint8_t clientID, void* clientMapping,
       cEntry->gcFlag = getGCTime(keepWindow);
     }
 
+    // The path stays in the AS path cache as long as the update exists.
+    if (pathId != 0 && !addAspathListReference(getAspathCache(), pathId))
+    {
+      LOG_RATE_LIMITED(LEVEL_WARNING, 10, HDR "Path [ID:0x%08X] of update "
+                       "[ID:0x%08X] not found in the AS path cache!",
+                       pthread_self(), pathId, updID);
+    }
+
     // Finally add the entry to cache.
     tableAdd(self, cEntry);
 
@@ -842,7 +865,7 @@ bool modifyUpdateCacheResultWithAspaVal(UpdateCache* self, SRxUpdateID* updateID
       if (srxResult_aspa->aspaResult != cEntry->srxResult.aspaResult)
       {
         cEntry->srxResult.aspaResult = srxResult_aspa->aspaResult;
-        LOG(LEVEL_INFO, "\033[92m""cEntry(UpdateCache) updated with uID: %08X, ASPA result:%d ""\033[0m", 
+        LOG(LEVEL_DEBUG, "\033[92m""cEntry(UpdateCache) updated with uID: %08X, ASPA result:%d ""\033[0m", 
             *updateID, srxResult_aspa->aspaResult);
         retVal = true;
       }
@@ -869,16 +892,24 @@ bool modifyUpdateCacheResultWithAspaVal(UpdateCache* self, SRxUpdateID* updateID
 bool gcTestAndDeleteUpdate(UpdateCache* self, CacheEntry* cEntry,
                            void* pCache, bool force)
 {
-  //TODO: Test one last time if the update can be deleted. If so then delete it.
   // This method MUST be called by the garbage collector.
-  LOG(LEVEL_INFO,"IMPLEMENTATION CAN BE EXPECTED WITH VERSION 0.4");
-  bool delete = !force;
+  bool delete = force;
+  int  idx;
 
   if (!force)
   {
-    // 1. CHECK IF GC TIME IS READY
-
-    // 2. CHECK ONE MORE TIME IF NO REFERENCE EXISTS
+    // 1. CHECK IF GC TIME IS READY - A flag of zero means the update is
+    //    referenced, the 16 bit time stamp might have wrapped around.
+    delete =    (cEntry->gcFlag != 0)
+             && ((int16_t)((uint16_t)time(NULL) - cEntry->gcFlag) >= 0);
+
+    // 2. CHECK ONE MORE TIME IF NO REFERENCE EXISTS - Updates stored without
+    //    client, i.e. restored from the snapshot, are kept until their keep
+    //    window passed unless a router requested them in the meantime.
+    for (idx = 0; delete && (idx < cEntry->noPossibleClients); idx++)
+    {
+      delete = cEntry->clients[idx] == 0;
+    }
   }
 
   if (delete)
@@ -897,6 +928,12 @@ bool gcTestAndDeleteUpdate(UpdateCache* self, CacheEntry* cEntry,
     // Now remove it from the allItems list of the cache
     deleteFromSList(&self->allItems, cEntry);
 
+    // Release the path of the update
+    if (cEntry->aspathCacheID != 0)
+    {
+      removeAspathListReference(getAspathCache(), cEntry->aspathCacheID);
+    }
+
     // Free the memory of the bgpsec blob;
     _cleanCachPathData(cEntry);
     // Free the cache entry.
@@ -1089,7 +1126,8 @@ bool deleteUpdateFromCache(UpdateCache* self, uint8_t clientID,
 
 /**
  * This function returns the update signature if already existent. It will NOT
- * start the signing. If no signature exists the return value is NULL
+ * start the signing. If no signature exists the signature block is NULL. 
+ * Signatures are currently not cached, the caller has to queue the signing.
  *
  * @param self The instance of the update cache
  * @param result The result of the function call.
@@ -1113,15 +1151,11 @@ UpdSigResult* getUpdateSignature(UpdateCache* self, UpdSigResult* result,
   // but store it as value only. See documentation for SRxUpdateID for more info
   SRxUpdateID updID = *updateID;
 
-
-  // Currently we do NOT support any algorithm!
-  RAISE_ERROR("UPDATE SIGNATURES ARE CURRENTLY NOT SUPPORTED!");
-
-  // Currently we by default throw an algorithm not supported error.
-  // This can be overwritten by update not found. Once signing is supported
-  // this will be changed.
-  result->containsError   = true;
-  result->errorCode       = SRXERR_ALGO_NOT_SUPPORTED;
+  // Signatures are not stored in the cache. They depend on the peer and are
+  // generated by the crypto workers on request. Therefore only check if the
+  // update exists.
+  result->containsError   = false;
+  result->errorCode       = SRXERR_UPDATE_NOT_FOUND;
   result->signatureLength = 0;
   result->signatureBlock  = NULL;
 
@@ -1129,7 +1163,7 @@ UpdSigResult* getUpdateSignature(UpdateCache* self, UpdSigResult* result,
   if (!tableFind(self, updID, &cEntry))
   {
     LOG(LEVEL_INFO, "Update [0x%08X] not found! Can not sign it!", updID);
-    result->errorCode = SRXERR_UPDATE_NOT_FOUND;
+    result->containsError = true;
   }
 
   return result;
@@ -1219,14 +1253,25 @@ void emptyUpdateCache(UpdateCache* self)
   ////////////////////////////////////////////////////////////////////////////// TOUCHED(X); OK ( ); NOT YET ( ); Tested ( )
   acquireWriteLock(&self->tableLock);
   lockMutex(&self->itemMutex);
+  // Release the paths of all updates
+  CacheEntry *cEntry, *tmp;
+  HASH_ITER(hh, (CacheEntry*)self->table, cEntry, tmp)
+  {
+    if (cEntry->aspathCacheID != 0)
+    {
+      removeAspathListReference(getAspathCache(), cEntry->aspathCacheID);
+    }
+  }
   emptySList(&self->allItems);
   SKI_CACHE* sCache = getSKICache();
   // clean all updates from the update cache.
   ski_clean(sCache, SKI_CLEAN_UPDATES);
   unlockMutex(&self->itemMutex);
 
-  self->table     = NULL;
-  self->itemsUsed = NUM_PREALLOC;
+  self->table        = NULL;
+  self->itemsUsed    = NUM_PREALLOC;
+  // A running export ends here.
+  self->exportCursor = NULL;
 
   unlockWriteLock(&self->tableLock);
 }
@@ -1478,6 +1523,12 @@ bool printXMLValResult(XMLOut* out, const char* attrName,
     case SRx_RESULT_INVALID :
               addStrAttrib(out, attrName, "INVALID!");
               break;
+    case SRx_RESULT_UNKNOWN :
+              addStrAttrib(out, attrName, "UNKNOWN!");
+              break;
+    case SRx_RESULT_UNVERIFIABLE :
+              addStrAttrib(out, attrName, "UNVERIFIABLE!");
+              break;
     case SRx_RESULT_NOTFOUND :
               if (hasNotFound)
               {
@@ -1493,6 +1544,355 @@ bool printXMLValResult(XMLOut* out, const char* attrName,
   return retVal;
 }
 
+/** The names of the validation results in the JSON export and the filter. */
+static const char* UC_RESULT_NAMES[] = {
+  "valid",        // 0:SRx_RESULT_VALID
+  "notfound",     // 1:SRx_RESULT_NOTFOUND
+  "invalid",      // 2:SRx_RESULT_INVALID
+  "undefined",    // 3:SRx_RESULT_UNDEFINED
+  "donotuse",     // 4:SRx_RESULT_DONOTUSE
+  "unknown",      // 5:SRx_RESULT_UNKNOWN
+  "unverifiable"  // 6:SRx_RESULT_UNVERIFIABLE
+};
+#define UC_NO_RESULT_NAMES  7
+
+/** The data of an update copied for the export. */
+typedef struct {
+  SRxUpdateID updateID;
+  uint32_t    asn;
+  IPPrefix    prefix;
+  SRxResult   srxResult;
+  SRxResult   defaultResult;
+  uint32_t    roaRefCount;
+  uint16_t    gcFlag;
+  uint16_t    hops;
+  int         bgpsecLength;
+  /** One bit per client ID. */
+  uint32_t    clients[8];
+} UC_ExportRecord;
+
+/**
+ * Return the name of the validation result.
+ *
+ * @param result The validation result.
+ *
+ * @return the name.
+ *
+ * @since 0.6.3.0
+ */
+static const char* _resultName(uint8_t result)
+{
+  return result < UC_NO_RESULT_NAMES ? UC_RESULT_NAMES[result] : "?";
+}
+
+/**
+ * Copy the exported data of the cache entry.
+ *
+ * @param cEntry The cache entry.
+ * @param record (out) The copy.
+ *
+ * @since 0.6.3.0
+ */
+static void _copyExportRecord(CacheEntry* cEntry, UC_ExportRecord* record)
+{
+  uint8_t clIdx;
+
+  memset(record, 0, sizeof(UC_ExportRecord));
+  record->updateID      = cEntry->updateID;
+  record->asn           = cEntry->asn;
+  record->prefix        = cEntry->prefix;
+  record->srxResult     = cEntry->srxResult;
+  record->defaultResult = cEntry->defaultResult.result;
+  record->roaRefCount   = cEntry->roaRefCount;
+  record->gcFlag        = cEntry->gcFlag;
+  record->hops          = cEntry->pathData.hops;
+  record->bgpsecLength  = cEntry->pathData.length;
+  for (clIdx = 0; clIdx < cEntry->noPossibleClients; clIdx++)
+  {
+    if (cEntry->clients[clIdx] != 0)
+    {
+      record->clients[cEntry->clients[clIdx] / 32] 
+        |= 1 << (cEntry->clients[clIdx] % 32);
+    }
+  }
+}
+
+/**
+ * Determine if the inner prefix is equal to or more specific than the outer
+ * prefix.
+ *
+ * @param outer The covering prefix.
+ * @param inner The prefix to test.
+ *
+ * @return true if the inner prefix lies within the outer prefix.
+ *
+ * @since 0.6.3.0
+ */
+static bool _prefixWithin(IPPrefix* outer, IPPrefix* inner)
+{
+  // The IPv4 address is stored at the beginning of the union as well.
+  uint8_t* outAddr = outer->ip.addr.v6.u8;
+  uint8_t* inAddr  = inner->ip.addr.v6.u8;
+  uint8_t  bytes   = outer->length / 8;
+  uint8_t  bits    = outer->length % 8;
+  uint8_t  mask    = (uint8_t)(0xFF << (8 - bits));
+
+  if (   (outer->ip.version != inner->ip.version)
+      || (inner->length < outer->length)
+      || (memcmp(outAddr, inAddr, bytes) != 0))
+  {
+    return false;
+  }
+
+  return (bits == 0) || ((outAddr[bytes] & mask) == (inAddr[bytes] & mask));
+}
+
+/**
+ * Determine if the update is selected by the filter.
+ *
+ * @param record The update.
+ * @param filter The filter, NULL selects all updates.
+ *
+ * @return true if the update is selected.
+ *
+ * @since 0.6.3.0
+ */
+static bool _matchesExportFilter(UC_ExportRecord* record, 
+                                 UC_ExportFilter* filter)
+{
+  if (filter == NULL)
+  {
+    return true;
+  }
+
+  return    (   (filter->clientID == 0)
+             || ((record->clients[filter->clientID / 32] 
+                  & (1 << (filter->clientID % 32))) != 0))
+         && (   (filter->prefix.length == 0)
+             || _prefixWithin(&filter->prefix, &record->prefix))
+         && (!filter->useOriginAS || (filter->originAS == record->asn))
+         && (   (filter->roaResult == SRx_RESULT_DONOTUSE)
+             || (filter->roaResult == record->srxResult.roaResult))
+         && (   (filter->bgpsecResult == SRx_RESULT_DONOTUSE)
+             || (filter->bgpsecResult == record->srxResult.bgpsecResult))
+         && (   (filter->aspaResult == SRx_RESULT_DONOTUSE)
+             || (filter->aspaResult == record->srxResult.aspaResult));
+}
+
+/**
+ * Write the update as XML tag.
+ *
+ * @param out The XML stream.
+ * @param record The update.
+ *
+ * @since 0.6.3.0
+ */
+static void _printExportXML(XMLOut* out, UC_ExportRecord* record)
+{
+  char     clientString[256 * 4];
+  char     prefixString[MAX_IP_V6_STR_LEN + 4];
+  char*    strPtr    = clientString;
+  uint32_t noClients = 0;
+  int      clientID;
+
+  for (clientID = 1; clientID < 256; clientID++)
+  {
+    if ((record->clients[clientID / 32] & (1 << (clientID % 32))) != 0)
+    {
+      strPtr += sprintf(strPtr, noClients++ == 0 ? "%u" : ",%u", clientID);
+    }
+  }
+
+  openTag(out, "update");
+    addH32Attrib(out, "update-id", record->updateID);
+    addU32Attrib(out, "no-clients", noClients);
+    if (noClients > 0)
+    {
+      addStrAttrib(out, "client-list", clientString);
+    }
+    addU32Attrib(out, "gc", record->gcFlag);
+    addU32Attrib(out, "origin-as", record->asn);
+    addStrAttrib(out, "prefix", ipPrefixToStr(&record->prefix, prefixString,
+                                              sizeof(prefixString)));
+    addIntAttrib(out, "roa-count", record->roaRefCount);
+    if (!printXMLValResult(out, "origin-val", record->srxResult.roaResult,
+                           true))
+    {
+      RAISE_ERROR("Update[0%x08X] with invalid origin validation state %d",
+                  record->updateID, record->srxResult.roaResult);
+    }
+    if (!printXMLValResult(out, "path-val", record->srxResult.bgpsecResult,
+                           false))
+    {
+      RAISE_ERROR("Update[0%x08X] with invalid path validation state %d",
+                  record->updateID, record->srxResult.bgpsecResult);
+    }
+    addStrAttrib(out, "aspa-val", 
+                 _resultName(record->srxResult.aspaResult));
+    if (!printXMLValResult(out, "def-origin-val",
+                           record->defaultResult.roaResult, true))
+    {
+      RAISE_ERROR("Update[0%x08X] with invalid default origin validation "
+                  "state %d", record->updateID, 
+                  record->defaultResult.roaResult);
+    }
+    if (!printXMLValResult(out, "def-path-val",
+                           record->defaultResult.bgpsecResult, true))
+    {
+      RAISE_ERROR("Update[0%x08X] with invalid default path validation "
+                  "state %d", record->updateID,
+                  record->defaultResult.bgpsecResult);
+    }
+    addIntAttrib(out, "hops", record->hops);
+    addIntAttrib(out, "bgpsec-len", record->bgpsecLength);
+  closeTag(out);
+}
+
+/**
+ * Write the update as one line of JSON.
+ *
+ * @param stream The output stream.
+ * @param record The update.
+ *
+ * @since 0.6.3.0
+ */
+static void _printExportJSON(FILE* stream, UC_ExportRecord* record)
+{
+  char prefixString[MAX_IP_V6_STR_LEN + 4];
+  bool first = true;
+  int  clientID;
+
+  fprintf(stream, "{\"update_id\":\"0x%08X\",\"prefix\":\"%s\","
+                  "\"origin_as\":%u,\"clients\":[", record->updateID,
+          ipPrefixToStr(&record->prefix, prefixString, sizeof(prefixString)),
+          record->asn);
+  for (clientID = 1; clientID < 256; clientID++)
+  {
+    if ((record->clients[clientID / 32] & (1 << (clientID % 32))) != 0)
+    {
+      fprintf(stream, first ? "%u" : ",%u", clientID);
+      first = false;
+    }
+  }
+  fprintf(stream, "],\"gc\":%u,\"roa_count\":%u,\"origin\":\"%s\","
+                  "\"path\":\"%s\",\"aspa\":\"%s\",\"default\":{"
+                  "\"origin\":\"%s\",\"path\":\"%s\",\"aspa\":\"%s\"},"
+                  "\"hops\":%u,\"bgpsec_len\":%d}\n", 
+          record->gcFlag, record->roaRefCount,
+          _resultName(record->srxResult.roaResult),
+          _resultName(record->srxResult.bgpsecResult),
+          _resultName(record->srxResult.aspaResult),
+          _resultName(record->defaultResult.roaResult),
+          _resultName(record->defaultResult.bgpsecResult),
+          _resultName(record->defaultResult.aspaResult),
+          record->hops, record->bgpsecLength);
+}
+
+/**
+ * Write the updates selected by the filter to the stream. The updates are
+ * copied in batches while holding the read lock and written without it.
+ *
+ * @param self The update cache.
+ * @param stream The output stream.
+ * @param format The output format.
+ * @param filter The filter, NULL for all updates.
+ * @param noExported (out) The number of updates written. Can be NULL.
+ *
+ * @return false if the output could not be written.
+ *
+ * @since 0.6.3.0
+ */
+static bool _exportUpdates(UpdateCache* self, FILE* stream, 
+                           UC_ExportFormat format, UC_ExportFilter* filter,
+                           uint32_t* noExported)
+{
+  UC_ExportRecord* batch = malloc(sizeof(UC_ExportRecord) 
+                                  * UC_EXPORT_BATCH_SIZE);
+  CacheEntry*      cEntry;
+  XMLOut           out;
+  bool             updatesOpen = false;
+  uint32_t         count       = 0;
+  uint32_t         batchSize;
+  uint32_t         idx;
+
+  if (batch == NULL)
+  {
+    RAISE_ERROR("Not enough memory to export the update cache!");
+    return false;
+  }
+
+  if (format == UC_EXPORT_XML)
+  {
+    initXMLOut(&out, stream);
+    openTag(&out, "update-cache");
+    // Add the current gc time
+    addU32Attrib(&out, "current-gc-time", getGCTime(0));
+  }
+
+  // Only one export moves the cursor at a time.
+  lockMutex(&self->exportMutex);
+  acquireReadLock(&self->tableLock);
+  self->exportCursor = self->table;
+  unlockReadLock(&self->tableLock);
+  do
+  {
+    batchSize = 0;
+    acquireReadLock(&self->tableLock);
+    for (cEntry = (CacheEntry*)self->exportCursor; 
+         (cEntry != NULL) && (batchSize < UC_EXPORT_BATCH_SIZE);
+         cEntry = (CacheEntry*)cEntry->hh.next)
+    {
+      _copyExportRecord(cEntry, &batch[batchSize++]);
+    }
+    self->exportCursor = cEntry;
+    unlockReadLock(&self->tableLock);
+
+    for (idx = 0; idx < batchSize; idx++)
+    {
+      if (!_matchesExportFilter(&batch[idx], filter))
+      {
+        continue;
+      }
+      if (format == UC_EXPORT_JSONL)
+      {
+        _printExportJSON(stream, &batch[idx]);
+      }
+      else
+      {
+        if (!updatesOpen)
+        {
+          openTag(&out, "updates");
+          updatesOpen = true;
+        }
+        _printExportXML(&out, &batch[idx]);
+      }
+      count++;
+    }
+  } while ((cEntry != NULL) && !ferror(stream));
+  acquireReadLock(&self->tableLock);
+  self->exportCursor = NULL;
+  unlockReadLock(&self->tableLock);
+  unlockMutex(&self->exportMutex);
+
+  if (format == UC_EXPORT_XML)
+  {
+    if (updatesOpen)
+    {
+      closeTag(&out);
+    }
+    closeTag(&out);
+    releaseXMLOut(&out);
+  }
+  free(batch);
+
+  if (noExported != NULL)
+  {
+    *noExported = count;
+  }
+
+  return (fflush(stream) == 0) && !ferror(stream);
+}
+
 /**
  * Print the content of the update cache to the given file.
  *
@@ -1506,100 +1906,146 @@ bool printXMLValResult(XMLOut* out, const char* attrName,
  */
 void outputUpdateCacheAsXML(UpdateCache* self, FILE* stream, int maxBlob)
 {
-#define CLIENT_LIST_STRING_LEN 1024
-  XMLOut      out;
-  SListNode*  updateListNode;
-  CacheEntry* update;
-  uint8_t     clIdx;
-  uint8_t     noClients;
-  char        clientString[CLIENT_LIST_STRING_LEN];
-  memset(clientString, '\0', CLIENT_LIST_STRING_LEN);
-  char*       strPtr = NULL;
-  initXMLOut(&out, stream);
-  openTag(&out, "update-cache");
-
-  // Add the current gc time
-  addU32Attrib(&out, "current-gc-time", getGCTime(0));
-
-  // Updates
-  if (sizeOfSList(&self->allItems))
+  _exportUpdates(self, stream, UC_EXPORT_XML, NULL, NULL);
+}
+
+/**
+ * Initialize the filter to select all updates.
+ *
+ * @param filter The filter.
+ *
+ * @since 0.6.3.0
+ */
+void initUpdateExportFilter(UC_ExportFilter* filter)
+{
+  memset(filter, 0, sizeof(UC_ExportFilter));
+  filter->roaResult    = SRx_RESULT_DONOTUSE;
+  filter->bgpsecResult = SRx_RESULT_DONOTUSE;
+  filter->aspaResult   = SRx_RESULT_DONOTUSE;
+}
+
+/**
+ * Add the condition given as "<name>=<value>" to the filter. The names are
+ * client (client ID), prefix (the updates within), origin (origin AS), and 
+ * roa, bgpsec, aspa (validation result valid, invalid, notfound, undefined,
+ * unknown, unverifiable).
+ *
+ * @param filter The filter.
+ * @param condition The condition.
+ *
+ * @return false if the condition is not valid.
+ *
+ * @since 0.6.3.0
+ */
+bool parseUpdateExportFilter(UC_ExportFilter* filter, const char* condition)
+{
+  const char*   value = strchr(condition, '=');
+  char*         end   = NULL;
+  size_t        nameLen;
+  unsigned long number;
+  uint8_t*      result = NULL;
+  uint8_t       idx;
+
+  if ((value == NULL) || (*(value + 1) == '\0'))
+  {
+    return false;
+  }
+  nameLen = value - condition;
+  value++;
+
+  #define _IS_NAME(NAME) \
+    ((nameLen == strlen(NAME)) && (strncmp(condition, NAME, nameLen) == 0))
+  if (_IS_NAME("client"))
   {
-    openTag(&out, "updates");
-    FOREACH_SLIST(&self->allItems, updateListNode)
+    number = strtoul(value, &end, 10);
+    if ((*end != '\0') || (number == 0) || (number > 255))
     {
-      update = (CacheEntry*)getDataOfSListNode(updateListNode);
-      openTag(&out, "update");
-        addH32Attrib(&out, "update-id", update->updateID);
-        // noClients contains the number of clients used during the last run.
-        // the multiplicator "4" is used for the maximum space used for any
-        // client ID (3 char + comma)
-        memset(clientString, '\0', noClients*4);
-        noClients = 0;
-        strPtr = clientString;
-        for(clIdx = 0; clIdx < update->noPossibleClients; clIdx++)
-        {
-          if (update->clients[clIdx] != 0)
-          {
-            noClients++;
-            if (noClients == 1)
-            {
-              strPtr += sprintf(strPtr, "%u", update->clients[clIdx]);
-            }
-            else
-            {
-              strPtr += sprintf(strPtr, ",%u", update->clients[clIdx]);
-            }
-          }
-        }
-        addU32Attrib(&out, "no-clients", noClients);
-        if (noClients > 0)
-        {
-          addStrAttrib(&out, "client-list", clientString);
-        }
-        addU32Attrib(&out, "gc", update->gcFlag);
-        addU32Attrib(&out, "origin-as", update->asn);
-        addAttrib(&out, "prefix", "%s/%u",
-                  ipToStr(&update->prefix.ip),
-                  update->prefix.length);
-        addIntAttrib(&out, "roa-count", update->roaRefCount);
-        if (!printXMLValResult(&out, "origin-val",
-                               update->srxResult.roaResult, true))
-        {
-          RAISE_ERROR("Update[0%x08X] with invalid origin validation state %d",
-                      update->updateID, update->srxResult.roaResult);
-        }
-        if (!printXMLValResult(&out, "path-val", update->srxResult.bgpsecResult,
-                               false))
-        {
-          RAISE_ERROR("Update[0%x08X] with invalid path validation state %d",
-                      update->updateID, update->srxResult.bgpsecResult);
-        }
-        if (!printXMLValResult(&out, "def-origin-val",
-                               update->defaultResult.result.roaResult, true))
-        {
-          RAISE_ERROR("Update[0%x08X] with invalid default origin validation "
-                      "state %d", update->updateID,
-                      update->defaultResult.result.roaResult);
-        }
-        if (!printXMLValResult(&out, "def-path-val",
-                               update->defaultResult.result.bgpsecResult, true))
-        {
-          RAISE_ERROR("Update[0%x08X] with invalid default path validation "
-                      "state %d", update->updateID,
-                      update->defaultResult.result.bgpsecResult);
-        }
-        addIntAttrib(&out, "hops", update->pathData.hops);
-        addIntAttrib(&out, "bgpsec-len", update->pathData.length);
-      closeTag(&out);
+      return false;
     }
-    closeTag(&out);
+    filter->clientID = (uint8_t)number;
+  }
+  else if (_IS_NAME("prefix"))
+  {
+    return strToIPPrefix(value, &filter->prefix);
+  }
+  else if (_IS_NAME("origin"))
+  {
+    number = strtoul(value, &end, 10);
+    if ((*end != '\0') || (number > UINT32_MAX))
+    {
+      return false;
+    }
+    filter->useOriginAS = true;
+    filter->originAS    = (uint32_t)number;
+  }
+  else if (_IS_NAME("roa"))
+  {
+    result = &filter->roaResult;
+  }
+  else if (_IS_NAME("bgpsec"))
+  {
+    result = &filter->bgpsecResult;
+  }
+  else if (_IS_NAME("aspa"))
+  {
+    result = &filter->aspaResult;
   }
+  #undef _IS_NAME
 
-  closeTag(&out);
-  releaseXMLOut(&out);
+  if (result != NULL)
+  {
+    for (idx = 0; idx < UC_NO_RESULT_NAMES; idx++)
+    {
+      if (   (idx != SRx_RESULT_DONOTUSE) 
+          && (strcmp(value, UC_RESULT_NAMES[idx]) == 0))
+      {
+        *result = idx;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  return end != NULL;
 }
 
+/**
+ * Write the updates selected by the filter to the given file descriptor. The
+ * updates are copied in batches of UC_EXPORT_BATCH_SIZE, the read lock is
+ * held only while a batch is copied and never while writing. Updates stored
+ * during the export might be part of it, updates deleted during the export
+ * are skipped once they are deleted.
+ *
+ * @param self The update cache.
+ * @param fd The file descriptor, it stays open.
+ * @param format The output format.
+ * @param filter The filter, NULL for all updates.
+ * @param noExported (out) The number of updates written. Can be NULL.
+ *
+ * @return false if the output could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool exportUpdateCache(UpdateCache* self, int fd, UC_ExportFormat format,
+                       UC_ExportFilter* filter, uint32_t* noExported)
+{
+  int   dupFd  = dup(fd);
+  FILE* stream = (dupFd != -1) ? fdopen(dupFd, "w") : NULL;
+  bool  retVal;
+
+  if (stream == NULL)
+  {
+    RAISE_SYS_ERROR("Could not open the update cache export");
+    if (dupFd != -1)
+    {
+      close(dupFd);
+    }
+    return false;
+  }
+  retVal = _exportUpdates(self, stream, format, filter, noExported);
 
+  return (fclose(stream) == 0) && retVal;
+}
 
 void process_ASPA_EndOfData(UpdateCache* self, 
                             int (*cb)(void* uCache, void* hldr, uint32_t uid, uint32_t pid, time_t ct), 
@@ -1620,3 +2066,142 @@ void process_ASPA_EndOfData(UpdateCache* self,
   }
 
 }
+
+/**
+ * Write all updates into the SNAP_SEC_UPDATE section of the snapshot. The
+ * client references are not written, the routers register again once they 
+ * reconnect.
+ *
+ * @param self The update cache.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool writeUpdateCacheSnapshot(UpdateCache* self, SnapshotWriter* writer)
+{
+  CacheEntry *cEntry, *tmp;
+  SnapshotUpdateRecord record;
+  uint32_t count  = 0;
+  bool     retVal = beginSnapshotSection(writer, SNAP_SEC_UPDATE);
+
+  memset(&record, 0, sizeof(SnapshotUpdateRecord));
+  acquireReadLock(&self->tableLock);
+  HASH_ITER(hh, (CacheEntry*)self->table, cEntry, tmp)
+  {
+    if (!retVal)
+    {
+      break;
+    }
+    record.updateID            = cEntry->updateID;
+    record.asn                 = cEntry->asn;
+    record.pathId              = cEntry->aspathCacheID;
+    record.myAS                = cEntry->pathData.myAS;
+    record.srxResult           = cEntry->srxResult;
+    record.defaultResult       = cEntry->defaultResult.result;
+    record.resSourceROA        = cEntry->defaultResult.resSourceROA;
+    record.resSourceBGPSEC     = cEntry->defaultResult.resSourceBGPSEC;
+    record.resSourceASPA       = cEntry->defaultResult.resSourceASPA;
+    record.resSourceTransitive = cEntry->defaultResult.resSourceTransitive;
+    record.afi                 = cEntry->pathData.nlri.afi;
+    record.safi                = cEntry->pathData.nlri.safi;
+    record.hops                = cEntry->pathData.asn_path != NULL
+                                 ? cEntry->pathData.hops : 0;
+    record.bgpsecLength        = cEntry->pathData.bgpsec_path != NULL
+                                 ? cEntry->pathData.length : 0;
+    prefixToSnapshot(&cEntry->prefix, &record.prefix);
+
+    retVal =    addSnapshotData(writer, &record, sizeof(SnapshotUpdateRecord))
+             && addSnapshotData(writer, cEntry->pathData.asn_path,
+                                record.hops * sizeof(uint32_t))
+             && addSnapshotData(writer, cEntry->pathData.bgpsec_path,
+                                record.bgpsecLength);
+    count++;
+  }
+  unlockReadLock(&self->tableLock);
+
+  return retVal && endSnapshotSection(writer, count);
+}
+
+/**
+ * Store the updates of the SNAP_SEC_UPDATE section of the snapshot. The paths
+ * of the updates MUST be restored first. The BGPsec, ASPA, and transitive
+ * results are restored, the origin validation result remains undefined and is
+ * determined again with the next validation request. The updates are not
+ * referenced by any client, they are kept for the configured keep window from
+ * the time of the restore. Once a router requests an update again it is
+ * referenced by the router and not subject to the garbage collection anymore.
+ *
+ * @param self The update cache.
+ * @param reader The snapshot reader.
+ *
+ * @return the number of restored updates or -1 if the section is corrupted.
+ *
+ * @since 0.6.3.0
+ */
+int readUpdateCacheSnapshot(UpdateCache* self, SnapshotReader* reader)
+{
+  SnapshotCursor              cursor;
+  const SnapshotUpdateRecord* record;
+  SRxDefaultResult            defRes;
+  BGPSecData                  bgpData;
+  IPPrefix                    prefix;
+  SRxUpdateID                 updateID;
+  CacheEntry*                 cEntry;
+  uint32_t                    idx;
+
+  if (!findSnapshotSection(reader, SNAP_SEC_UPDATE, &cursor))
+  {
+    return 0;
+  }
+
+  for (idx = 0; idx < cursor.count; idx++)
+  {
+    record = getSnapshotData(&cursor, sizeof(SnapshotUpdateRecord));
+    if ((record == NULL) || !snapshotToPrefix(&record->prefix, &prefix))
+    {
+      return -1;
+    }
+
+    memset(&bgpData, 0, sizeof(BGPSecData));
+    bgpData.numberHops       = record->hops;
+    bgpData.attr_length      = record->bgpsecLength;
+    bgpData.afi              = record->afi;
+    bgpData.safi             = record->safi;
+    bgpData.local_as         = record->myAS;
+    bgpData.asPath           = (uint32_t*)getSnapshotData(&cursor, 
+                                           record->hops * sizeof(uint32_t));
+    bgpData.bgpsec_path_attr = (uint8_t*)getSnapshotData(&cursor, 
+                                           record->bgpsecLength);
+    if ((bgpData.asPath == NULL) || (bgpData.bgpsec_path_attr == NULL))
+    {
+      return -1;
+    }
+    if (record->bgpsecLength == 0)
+    {
+      bgpData.bgpsec_path_attr = NULL;
+    }
+
+    defRes.result              = record->defaultResult;
+    defRes.resSourceROA        = record->resSourceROA;
+    defRes.resSourceBGPSEC     = record->resSourceBGPSEC;
+    defRes.resSourceASPA       = record->resSourceASPA;
+    defRes.resSourceTransitive = record->resSourceTransitive;
+
+    updateID = record->updateID;
+    // Stores the data, adds the path reference and registers the SKIs.
+    if (storeUpdate(self, 0, NULL, &updateID, &prefix, record->asn, &defRes,
+                    &bgpData, record->pathId) == 1
+        && tableFind(self, updateID, &cEntry))
+    {
+      // The update is not known to the prefix cache yet, the origin 
+      // validation is performed with the next validation request.
+      cEntry->srxResult.bgpsecResult     = record->srxResult.bgpsecResult;
+      cEntry->srxResult.aspaResult       = record->srxResult.aspaResult;
+      cEntry->srxResult.transitiveResult = record->srxResult.transitiveResult;
+    }
+  }
+
+  return cursor.count;
+}
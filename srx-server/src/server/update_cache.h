@@ -66,6 +66,7 @@
 
 #include <stdio.h>
 #include "server/configuration.h"
+#include "server/snapshot.h"
 #include "shared/srx_defs.h"
 #include "shared/srx_packets.h"
 #include "util/mutex.h"
@@ -103,8 +104,40 @@ typedef struct {
   // cache works on cleaning updates from this client. During this phase no 
   // updates can be assigned to this client.
   uint32_t*           lockedClients;
+  // Serializes the exports of the cache.
+  Mutex               exportMutex;
+  // The next update exported, moved forward if this update is deleted. 
+  // Protected by the tableLock.
+  void*               exportCursor;
 } UpdateCache;
 
+/** The formats of exportUpdateCache. */
+typedef enum {
+  /** The XML tree of outputUpdateCacheAsXML. */
+  UC_EXPORT_XML   = 0,
+  /** One JSON object per update and line (JSON Lines). */
+  UC_EXPORT_JSONL = 1
+} UC_ExportFormat;
+
+/** The number of updates copied per read lock of the export. */
+#define UC_EXPORT_BATCH_SIZE 256
+
+/** Selects the updates of exportUpdateCache, all conditions must match. */
+typedef struct {
+  /** Only updates of this client, 0 for all. */
+  uint8_t  clientID;
+  /** Only updates within this prefix, prefix length 0 for all. */
+  IPPrefix prefix;
+  /** Only updates originated by originAS. */
+  bool     useOriginAS;
+  uint32_t originAS;
+  /** Only updates with these validation results, SRx_RESULT_DONOTUSE for 
+   * all. */
+  uint8_t  roaResult;
+  uint8_t  bgpsecResult;
+  uint8_t  aspaResult;
+} UC_ExportFilter;
+
 /** Return value for method getUpdateSignature the memory of this instance
  * is managed by the update cache.
  */
@@ -438,12 +471,88 @@ bool detectCollision(UpdateCache* self, SRxUpdateID* updateID, IPPrefix* prefix,
  */
 void outputUpdateCacheAsXML(UpdateCache* self, FILE* stream, int maxBlob);
 
+/**
+ * Initialize the filter to select all updates.
+ *
+ * @param filter The filter.
+ *
+ * @since 0.6.3.0
+ */
+void initUpdateExportFilter(UC_ExportFilter* filter);
+
+/**
+ * Add the condition given as "<name>=<value>" to the filter. The names are
+ * client (client ID), prefix (the updates within), origin (origin AS), and 
+ * roa, bgpsec, aspa (validation result valid, invalid, notfound, undefined,
+ * unknown, unverifiable).
+ *
+ * @param filter The filter.
+ * @param condition The condition.
+ *
+ * @return false if the condition is not valid.
+ *
+ * @since 0.6.3.0
+ */
+bool parseUpdateExportFilter(UC_ExportFilter* filter, const char* condition);
+
+/**
+ * Write the updates selected by the filter to the given file descriptor. The
+ * updates are copied in batches of UC_EXPORT_BATCH_SIZE, the read lock is
+ * held only while a batch is copied and never while writing. Updates stored
+ * during the export might be part of it, updates deleted during the export
+ * are skipped once they are deleted.
+ *
+ * @param self The update cache.
+ * @param fd The file descriptor, it stays open.
+ * @param format The output format.
+ * @param filter The filter, NULL for all updates.
+ * @param noExported (out) The number of updates written. Can be NULL.
+ *
+ * @return false if the output could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool exportUpdateCache(UpdateCache* self, int fd, UC_ExportFormat format,
+                       UC_ExportFilter* filter, uint32_t* noExported);
+
 bool modifyUpdateCacheResultWithAspaVal(UpdateCache* self, SRxUpdateID* updateID,
                         SRxResult* srxResult_aspa);
 
 void process_ASPA_EndOfData(UpdateCache* self, 
                             int (*cb)(void* uCache, void* hldr, uint32_t uid, uint32_t pid, time_t), 
                             void* rpkiHandler);
+
+/**
+ * Write all updates into the SNAP_SEC_UPDATE section of the snapshot. The
+ * client references are not written, the routers register again once they 
+ * reconnect.
+ *
+ * @param self The update cache.
+ * @param writer The snapshot writer.
+ *
+ * @return false if the section could not be written.
+ *
+ * @since 0.6.3.0
+ */
+bool writeUpdateCacheSnapshot(UpdateCache* self, SnapshotWriter* writer);
+
+/**
+ * Store the updates of the SNAP_SEC_UPDATE section of the snapshot. The paths
+ * of the updates MUST be restored first. The BGPsec, ASPA, and transitive
+ * results are restored, the origin validation result remains undefined and is
+ * determined again with the next validation request. The updates are not
+ * referenced by any client, they are kept for the configured keep window from
+ * the time of the restore. Once a router requests an update again it is
+ * referenced by the router and not subject to the garbage collection anymore.
+ *
+ * @param self The update cache.
+ * @param reader The snapshot reader.
+ *
+ * @return the number of restored updates or -1 if the section is corrupted.
+ *
+ * @since 0.6.3.0
+ */
+int readUpdateCacheSnapshot(UpdateCache* self, SnapshotReader* reader);
 #endif // !__UPDATE_CACHE_H__
 
 
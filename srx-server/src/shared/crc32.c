@@ -100,9 +100,26 @@ static uint32_t crc32tab[] = {
  * @return 
  */
 uint32_t crc32(uint8_t *pData, uint32_t uSize)
+{
+  return crc32Update(0, pData, uSize);
+}
+
+/**
+ * Continue the CRC of a data block with the next data block. The CRC of the
+ * first block is generated by handing zero as crc.
+ *
+ * @param crc The CRC of the previous data blocks
+ * @param pData The next data block
+ * @param uSize The size of the next data block
+ *
+ * @return The CRC of all data blocks
+ *
+ * @since 0.6.3.0
+ */
+uint32_t crc32Update(uint32_t crc, uint8_t *pData, uint32_t uSize)
 {
   uint32_t i = 0;
-  uint32_t pCrc32 = 0xFFFFFFFF;
+  uint32_t pCrc32 = ~crc;
 
   for(i = 0; i < uSize; i++)
   {
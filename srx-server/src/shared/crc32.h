@@ -40,6 +40,7 @@ extern "C" {
 #endif
 
 uint32_t crc32(uint8_t *pData, uint32_t uSize);
+uint32_t crc32Update(uint32_t crc, uint8_t *pData, uint32_t uSize);
 
 #ifdef	__cplusplus
 }
@@ -89,7 +89,10 @@ uint32_t generateIdentifier(uint32_t originAS, IPPrefix* prefix,
                      + blobLength  /* The length of the data blob */
                     ) * 2;         /* To generate a hex string. */
 
-  char dataText[length];
+  // Blob bytes are printed as signed char, bytes above 0x7F produce 8 instead
+  // of 2 characters. Only the first length characters are used for the ID but
+  // the text must fit including the string terminator.
+  char dataText[length + (blobLength * 6) + 1];
   memset(dataText, '\0', length);
   char* dataPtr = dataText;
   int i;
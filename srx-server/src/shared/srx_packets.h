@@ -156,7 +156,7 @@ typedef struct {
   uint8_t    type;              // 0
   uint16_t   version;
   uint8_t    reserved8;
-  uint32_t   zero32;
+  uint32_t   window;            // Requested window if SRX_PROXY_FLAG_CREDIT
   uint32_t   length;            // Variable 24(+) Bytes
   uint32_t   proxyIdentifier;
   uint32_t   asn;
@@ -191,11 +191,38 @@ typedef struct {
   uint8_t   type;              // 1
   uint16_t  version;
   uint8_t   reserved8;
-  uint32_t  zero32;
+  uint32_t  window;            // Granted window if SRX_PROXY_FLAG_CREDIT
   uint32_t  length;            
   uint32_t  proxyIdentifier;    // 16 Bytes
 } __attribute__((packed)) SRXPROXY_HELLO_RESPONSE;
 
+/** Set in reserved8 of the hello packet if a SRXPROXY_SHM_OFFER follows the
+ * peer list. Set in reserved8 of the hello response if the server switched to
+ * the offered shared memory channel. */
+#define SRX_PROXY_FLAG_SHM   0x01
+/** Set in reserved8 of the hello response if the server sends a sync request
+ * right after the handshake. */
+#define SRX_PROXY_FLAG_SYNC  0x02
+/** Set in reserved8 of the hello packet if the proxy requests the flow control
+ * with the window of outstanding verify requests given in window. Set in 
+ * reserved8 of the hello response if the server granted the flow control, 
+ * window then contains the granted window. Each verify request takes one 
+ * credit, the credits are returned in the verify notifications. A verify 
+ * notification with neither result type nor update ID only returns 
+ * credits. */
+#define SRX_PROXY_FLAG_CREDIT 0x04
+/** The maximum length of the shared memory name including the '\0'. */
+#define SRX_SHM_NAME_LENGTH  32
+
+/**
+ * Shared memory channel offered by a proxy running on the same host as the
+ * server. It follows the peer list of the hello packet.
+ */
+typedef struct {
+  uint32_t  ringSize;          // Size of each ring in bytes
+  char      name[SRX_SHM_NAME_LENGTH];
+} __attribute__((packed)) SRXPROXY_SHM_OFFER;
+
 /**
  * This struct specifies the goodbye packet
  */
@@ -292,7 +319,16 @@ typedef struct {
 
 
 /**
- * This struct specifies the verification notification packet
+ * This struct specifies the verification notification packet.
+ *
+ * Wire format (SRx-Proxy-Protocol version 3): 20 bytes with the length at
+ * byte 8, as in SRXPROXY_BasicHeader. Up to 0.6.2 the transitive result was
+ * inserted in front of the reserved byte which made the packet 21 bytes long
+ * and moved the length to byte 9. Receivers read the length from the basic
+ * header, therefore these packets could not be parsed. Since 0.6.3.0 the
+ * transitive result uses the former reserved byte and the former zero field
+ * carries the returned credits (zero if SRX_PROXY_FLAG_CREDIT is not used).
+ * Implementations that do not know these fields still read them as reserved.
  */
 typedef struct {
   uint8_t     type;            // 6
@@ -301,8 +337,7 @@ typedef struct {
   uint8_t     bgpsecResult;
   uint8_t     aspaResult;
   uint8_t     tranResult;
-  uint8_t     reserved8;
-  uint16_t    zero16;
+  uint16_t    credits;         // Returned credits if SRX_PROXY_FLAG_CREDIT
   uint32_t    length;          // 20 Bytes
   uint32_t    requestToken; // Added with protocol version 1.0
   SRxUpdateID updateID;
@@ -0,0 +1,1089 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * Microbenchmarks of the data structures on the hot path of the srx-server.
+ * All data is synthetic and generated from a fixed seed, no network and no
+ * configuration file is needed. The results are printed as CSV to stdout:
+ *
+ *   benchmark,ops,seconds,ns_per_op,ops_per_sec
+ *
+ * Call: bench_srx [-s <seed>] [<benchmark> ...]
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <srx/srxcryptoapi.h>
+#include "server/aspa_trie.h"
+#include "server/aspath_cache.h"
+#include "server/command_handler.h"
+#include "server/command_queue.h"
+#include "server/prefix_cache.h"
+#include "server/rpki_queue.h"
+#include "server/ski_cache.h"
+#include "server/update_cache.h"
+#include "shared/srx_identifier.h"
+#include "util/log.h"
+
+/** The number of ASes of the synthetic topology, ASN 1 to NO_AS. */
+#define NO_AS            60000
+/** The first NO_TIER1 ASes have no providers. */
+#define NO_TIER1         16
+#define MAX_PROVIDERS    3
+#define MAX_PATH_LEN     10
+#define NO_ROAS          500000
+#define NO_UPDATES       200000
+#define NO_COMMANDS      1000000
+/** The number of prefixes looked up in the ROA index and the prefix tree. */
+#define NO_LOOKUPS       1000000
+/** The number of IPv6 ROAs, added to the IPv4 ROAs for the lookups. */
+#define NO_ROAS_V6       100000
+/** The number of commands queued before they are fetched. */
+#define COMMAND_BATCH    64
+#define COMMAND_SIZE     64
+/** The number of passes over the updates for the cheap operations. */
+#define ROUNDS           5
+/** The length of the fake signature of each BGPsec signature segment. */
+#define SIGNATURE_LENGTH 72
+/** Update IDs of the repeated updates, received from another peer. */
+#define REPEAT_ID_MASK   0x5A5A5A5A
+/** The type code of the BGPsec_PATH attribute. */
+#define BGPSEC_PATH_TYPE 33
+
+/** The providers of an AS of the synthetic topology. */
+typedef struct {
+  uint16_t count;
+  uint32_t providers[MAX_PROVIDERS];
+} BenchAS;
+
+/** A synthetic update. */
+typedef struct {
+  SRxUpdateID updateID;
+  IPPrefix    prefix;
+  uint32_t    originAS;
+  uint16_t    numberHops;
+  /** The AS path in host format, the origin is the last AS. */
+  uint32_t    asPath[MAX_PATH_LEN];
+  /** The AS path in network format as it is received from the router. */
+  uint32_t    asPathN[MAX_PATH_LEN];
+} BenchUpdate;
+
+/** The prefixes looked up in the ROA index and the prefix tree. */
+typedef struct {
+  IPPrefix* prefix;
+  prefix_t* treePrefix;
+} BenchLookup;
+
+/** The ROAs covering a looked up prefix. */
+typedef struct {
+  uint8_t  length;
+  uint64_t covered;
+} BenchCoverage;
+
+/** The data shared by all benchmarks. */
+typedef struct {
+  BenchAS*     as;
+  IPPrefix*    roaPrefix;
+  uint32_t*    roaAS;
+  uint8_t*     roaMaxLen;
+  BenchUpdate* updates;
+} BenchData;
+
+/** State of the pseudo random generator, fixed to repeat the experiment. */
+static uint32_t     _seed = 2463534242u;
+/** The configuration used by the update cache. */
+static Configuration _config;
+static RPKI_QUEUE*  _rpkiQueue = NULL;
+static SKI_CACHE*   _skiCache  = NULL;
+/** The number of suppressed log messages. */
+static uint64_t     _logged    = 0;
+
+// The accessors of main.c. The benchmarks store updates without AS path ID,
+// the AS path cache is not needed.
+SKI_CACHE* getSKICache()
+{
+  return _skiCache;
+}
+RPKI_QUEUE* getRPKIQueue()
+{
+  return _rpkiQueue;
+}
+AspathCache* getAspathCache()
+{
+  return NULL;
+}
+// Part of rpki_router_client.c, only used by the command handler thread.
+void generalSignalProcess(void)
+{
+}
+
+/**
+ * Return the current time in seconds.
+ *
+ * @return the time of the monotonic clock
+ */
+static double _now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Return a pseudo random number between 0 and max - 1.
+ *
+ * @param max The upper bound
+ *
+ * @return the random number
+ */
+static uint32_t _random(uint32_t max)
+{
+  _seed ^= _seed << 13;
+  _seed ^= _seed >> 17;
+  _seed ^= _seed << 5;
+  return _seed % max;
+}
+
+/**
+ * Print the result of a benchmark as CSV line.
+ *
+ * @param name The name of the benchmark
+ * @param ops The number of operations performed
+ * @param seconds The time needed for all operations
+ */
+static void _report(const char* name, uint64_t ops, double seconds)
+{
+  printf ("%s,%llu,%.6f,%.1f,%.0f\n", name, (unsigned long long)ops, seconds,
+          ops > 0 ? seconds * 1e9 / ops : 0.0,
+          seconds > 0 ? ops / seconds : 0.0);
+  fflush(stdout);
+}
+
+/**
+ * Called by the update cache for each changed validation result. There are no
+ * clients to notify.
+ *
+ * @param result The changed result
+ */
+static void _resultChanged(SRxValidationResult* result)
+{
+}
+
+/**
+ * Count the log message instead of printing it during the measurement.
+ *
+ * @param level The log level
+ * @param fmt The format of the message
+ * @param args The arguments of the message
+ */
+static void _logMessage(LogLevel level, const char* fmt, va_list args)
+{
+  _logged++;
+}
+
+/**
+ * Fill the given IPv4 prefix.
+ *
+ * @param prefix The prefix
+ * @param addr The address in host format, bits beyond the length are cleared
+ * @param length The prefix length
+ */
+static void _setPrefix(IPPrefix* prefix, uint32_t addr, uint8_t length)
+{
+  uint32_t mask = length == 0 ? 0 : 0xFFFFFFFFu << (32 - length);
+
+  memset(prefix, 0, sizeof(IPPrefix));
+  prefix->ip.version     = 4;
+  prefix->ip.addr.v4.u32 = htonl(addr & mask);
+  prefix->length         = length;
+}
+
+/**
+ * Generate an upstream AS path starting at the given origin. Most hops follow
+ * the registered providers, some go to a random AS to produce invalid paths.
+ *
+ * @param data The benchmark data
+ * @param update The update to fill
+ * @param origin The origin AS
+ */
+static void _createPath(BenchData* data, BenchUpdate* update, uint32_t origin)
+{
+  uint32_t list[MAX_PATH_LEN];
+  uint16_t length = 0;
+  uint32_t current = origin;
+  uint16_t maxLength = 2 + _random(MAX_PATH_LEN - 1);
+  int idx;
+
+  list[length++] = current;
+  while (length < maxLength && current > NO_TIER1)
+  {
+    BenchAS* as = &data->as[current - 1];
+    if (as->count == 0 || _random(20) == 0)
+    {
+      current = 1 + _random(NO_AS);
+    }
+    else
+    {
+      current = as->providers[_random(as->count)];
+    }
+    list[length++] = current;
+  }
+
+  // The path is in BGP order, the origin is the last AS.
+  update->numberHops = length;
+  update->originAS   = origin;
+  for (idx = 0; idx < length; idx++)
+  {
+    update->asPath[length - 1 - idx]  = list[idx];
+    update->asPathN[length - 1 - idx] = htonl(list[idx]);
+  }
+}
+
+/**
+ * Generate the topology, the ROAs and the updates.
+ *
+ * @param data The benchmark data to fill
+ */
+static void _createData(BenchData* data)
+{
+  BGPSecData bgpData;
+  uint32_t   idx, prov, roa;
+  uint8_t    length;
+
+  data->as        = calloc(NO_AS, sizeof(BenchAS));
+  data->roaPrefix = calloc(NO_ROAS, sizeof(IPPrefix));
+  data->roaAS     = calloc(NO_ROAS, sizeof(uint32_t));
+  data->roaMaxLen = calloc(NO_ROAS, sizeof(uint8_t));
+  data->updates   = calloc(NO_UPDATES, sizeof(BenchUpdate));
+
+  // The providers of an AS are found among the lower ASNs, every 10th AS has
+  // no ASPA object.
+  for (idx = NO_TIER1; idx < NO_AS; idx++)
+  {
+    if (_random(10) != 0)
+    {
+      uint32_t range = idx / 8 > NO_TIER1 ? idx / 8 : NO_TIER1;
+      data->as[idx].count = 1 + _random(MAX_PROVIDERS);
+      for (prov = 0; prov < data->as[idx].count; prov++)
+      {
+        data->as[idx].providers[prov] = 1 + _random(range);
+      }
+    }
+  }
+
+  for (idx = 0; idx < NO_ROAS; idx++)
+  {
+    length = 8 + _random(17);
+    _setPrefix(&data->roaPrefix[idx], _seed, length);
+    data->roaMaxLen[idx] = length + _random(9);
+    if (data->roaMaxLen[idx] > 32)
+    {
+      data->roaMaxLen[idx] = 32;
+    }
+    data->roaAS[idx] = 1 + _random(NO_AS);
+  }
+
+  // Most updates are more specifics of a ROA prefix originated by the ROA AS,
+  // the others are random prefixes and origins.
+  for (idx = 0; idx < NO_UPDATES; idx++)
+  {
+    BenchUpdate* update = &data->updates[idx];
+    roa = _random(NO_ROAS);
+    if (_random(8) != 0)
+    {
+      length = data->roaPrefix[roa].length + _random(9);
+      _setPrefix(&update->prefix, ntohl(data->roaPrefix[roa].ip.addr.v4.u32)
+                                  | (_seed >> data->roaPrefix[roa].length),
+                 length > 32 ? 32 : length);
+      _createPath(data, update, _random(4) != 0 ? data->roaAS[roa]
+                                                : 1 + _random(NO_AS));
+    }
+    else
+    {
+      _setPrefix(&update->prefix, _seed, 8 + _random(25));
+      _createPath(data, update, 1 + _random(NO_AS));
+    }
+
+    memset(&bgpData, 0, sizeof(BGPSecData));
+    bgpData.numberHops = update->numberHops;
+    bgpData.asPath     = update->asPathN;
+    update->updateID = generateIdentifier(update->originAS, &update->prefix,
+                                          &bgpData);
+  }
+}
+
+/**
+ * Generate the update identifiers.
+ *
+ * @param data The benchmark data
+ */
+static void _benchIdentifier(BenchData* data)
+{
+  BGPSecData bgpData;
+  uint32_t   sum = 0;
+  int round, idx;
+
+  memset(&bgpData, 0, sizeof(BGPSecData));
+  double start = _now();
+  for (round = 0; round < ROUNDS; round++)
+  {
+    for (idx = 0; idx < NO_UPDATES; idx++)
+    {
+      BenchUpdate* update = &data->updates[idx];
+      bgpData.numberHops = update->numberHops;
+      bgpData.asPath     = update->asPathN;
+      sum += generateIdentifier(update->originAS, &update->prefix, &bgpData);
+    }
+  }
+  _report("generate_identifier", (uint64_t)ROUNDS * NO_UPDATES,
+          _now() - start);
+
+  start = _now();
+  for (round = 0; round < ROUNDS; round++)
+  {
+    for (idx = 0; idx < NO_UPDATES; idx++)
+    {
+      BenchUpdate* update = &data->updates[idx];
+      sum += makePathId(update->numberHops, update->asPathN, AS_SEQUENCE,
+                        true);
+    }
+  }
+  _report("make_path_id", (uint64_t)ROUNDS * NO_UPDATES, _now() - start);
+  // Keep the compiler from removing the loops.
+  if (sum == 1)
+  {
+    fprintf(stderr, "\n");
+  }
+}
+
+/**
+ * Store all updates and read their results, then validate them against the
+ * ROAs of the prefix cache.
+ *
+ * @param data The benchmark data
+ * @param store Run the update cache benchmarks
+ * @param validate Run the ROA benchmarks
+ */
+static void _benchUpdates(BenchData* data, bool store, bool validate)
+{
+  UpdateCache      updateCache;
+  PrefixCache      prefixCache;
+  SRxResult        srxRes;
+  SRxDefaultResult defRes;
+  BGPSecData       bgpData;
+  uint32_t         pathID;
+  double           start;
+  int round, idx;
+
+  memset(&_config, 0, sizeof(Configuration));
+  _config.defaultKeepWindow = 900;
+  if (!createUpdateCache(&updateCache, _resultChanged, 1, &_config))
+  {
+    fprintf(stderr, "Could not create the update cache!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // The AS path is stored as the server does for BGP-4 updates.
+  memset(&bgpData, 0, sizeof(BGPSecData));
+  bgpData.afi = htons(AFI_IP);
+  start = _now();
+  for (idx = 0; idx < NO_UPDATES; idx++)
+  {
+    BenchUpdate* update = &data->updates[idx];
+    bgpData.numberHops = update->numberHops;
+    bgpData.asPath     = update->asPathN;
+    storeUpdate(&updateCache, 0, NULL, &update->updateID, &update->prefix,
+                update->originAS, NULL, &bgpData, 0);
+  }
+  if (store)
+  {
+    _report("store_update", NO_UPDATES, _now() - start);
+
+    start = _now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+      for (idx = 0; idx < NO_UPDATES; idx++)
+      {
+        getUpdateResult(&updateCache,
+                        &data->updates[_random(NO_UPDATES)].updateID, 0, NULL,
+                        &srxRes, &defRes, &pathID);
+      }
+    }
+    _report("get_update_result", (uint64_t)ROUNDS * NO_UPDATES,
+            _now() - start);
+  }
+
+  if (validate)
+  {
+    if (!initializePrefixCache(&prefixCache, &updateCache))
+    {
+      fprintf(stderr, "Could not create the prefix cache!\n");
+      exit(EXIT_FAILURE);
+    }
+    start = _now();
+    for (idx = 0; idx < NO_ROAS; idx++)
+    {
+      addROAwl(&prefixCache, data->roaAS[idx], &data->roaPrefix[idx],
+               data->roaMaxLen[idx], 0, 1, true);
+    }
+    _report("add_roa", NO_ROAS, _now() - start);
+
+    start = _now();
+    for (idx = 0; idx < NO_UPDATES; idx++)
+    {
+      BenchUpdate* update = &data->updates[idx];
+      requestUpdateValidation(&prefixCache, &update->updateID,
+                              &update->prefix, update->originAS);
+    }
+    _report("request_update_validation", NO_UPDATES, _now() - start);
+
+    // The same prefix and origin received again with a different path.
+    for (idx = 0; idx < NO_UPDATES; idx++)
+    {
+      BenchUpdate* update = &data->updates[idx];
+      SRxUpdateID  updateID = update->updateID ^ REPEAT_ID_MASK;
+      bgpData.numberHops = update->numberHops;
+      bgpData.asPath     = update->asPathN;
+      storeUpdate(&updateCache, 0, NULL, &updateID, &update->prefix,
+                  update->originAS, NULL, &bgpData, 0);
+    }
+    start = _now();
+    for (idx = 0; idx < NO_UPDATES; idx++)
+    {
+      BenchUpdate* update = &data->updates[idx];
+      SRxUpdateID  updateID = update->updateID ^ REPEAT_ID_MASK;
+      requestUpdateValidation(&prefixCache, &updateID, &update->prefix,
+                              update->originAS);
+    }
+    _report("request_update_validation_repeat", NO_UPDATES, _now() - start);
+    releasePrefixCache(&prefixCache);
+  }
+
+  releaseUpdateCache(&updateCache);
+}
+
+/**
+ * Fill the given IPv6 prefix, the first 16 bits are 2001 and bits beyond the
+ * length are cleared.
+ *
+ * @param prefix The prefix
+ * @param length The prefix length
+ */
+static void _setPrefixV6(IPPrefix* prefix, uint8_t length)
+{
+  uint8_t* addr = prefix->ip.addr.v6.u8;
+  int idx;
+
+  memset(prefix, 0, sizeof(IPPrefix));
+  prefix->ip.version = 6;
+  prefix->length     = length;
+  addr[0] = 0x20;
+  addr[1] = 0x01;
+  for (idx = 2; idx < 16; idx++)
+  {
+    addr[idx] = _random(256);
+  }
+  for (idx = length; idx < 128; idx++)
+  {
+    addr[idx / 8] &= ~(0x80 >> (idx % 8));
+  }
+}
+
+/**
+ * Generate the prefixes of the ROA lookups. Most are more specifics of a ROA
+ * prefix, the others are random.
+ *
+ * @param data The benchmark data
+ * @param roaV6 The IPv6 ROA prefixes
+ * @param version 4 or 6
+ *
+ * @return The lookups, NO_LOOKUPS elements.
+ */
+static BenchLookup* _createLookups(BenchData* data, IPPrefix* roaV6,
+                                   uint8_t version)
+{
+  BenchLookup* lookups = calloc(NO_LOOKUPS, sizeof(BenchLookup));
+  IPPrefix*    roa;
+  uint8_t      length;
+  int idx, bit;
+
+  for (idx = 0; idx < NO_LOOKUPS; idx++)
+  {
+    lookups[idx].prefix     = malloc(sizeof(IPPrefix));
+    lookups[idx].treePrefix = calloc(1, sizeof(prefix_t));
+    if (version == 4)
+    {
+      roa = &data->roaPrefix[_random(NO_ROAS)];
+      if (_random(4) != 0)
+      {
+        length = roa->length + _random(9);
+        _setPrefix(lookups[idx].prefix, ntohl(roa->ip.addr.v4.u32)
+                                        | (_seed >> roa->length),
+                   length > 32 ? 32 : length);
+      }
+      else
+      {
+        _setPrefix(lookups[idx].prefix, _seed, 8 + _random(25));
+      }
+      lookups[idx].treePrefix->family = AF_INET;
+      lookups[idx].treePrefix->add.sin.s_addr =
+                                        lookups[idx].prefix->ip.addr.v4.u32;
+    }
+    else
+    {
+      roa = &roaV6[_random(NO_ROAS_V6)];
+      _setPrefixV6(lookups[idx].prefix, roa->length + _random(17));
+      if (_random(4) != 0)
+      {
+        for (bit = 0; bit < roa->length; bit++)
+        {
+          uint8_t mask = 0x80 >> (bit % 8);
+          lookups[idx].prefix->ip.addr.v6.u8[bit / 8] =
+                 (lookups[idx].prefix->ip.addr.v6.u8[bit / 8] & ~mask)
+               | (roa->ip.addr.v6.u8[bit / 8] & mask);
+        }
+      }
+      lookups[idx].treePrefix->family = AF_INET6;
+      memcpy(&lookups[idx].treePrefix->add.sin6,
+             lookups[idx].prefix->ip.addr.v6.u8, 16);
+    }
+    lookups[idx].treePrefix->bitlen = lookups[idx].prefix->length;
+  }
+
+  return lookups;
+}
+
+/**
+ * Count the ROAs covering the looked up prefix, called by the ROA index.
+ *
+ * @param entry The covering ROA index entry
+ * @param user The BenchCoverage
+ */
+static void _countCoverage(ROAIndexEntry* entry, void* user)
+{
+  BenchCoverage* coverage = (BenchCoverage*)user;
+
+  if (coverage->length <= entry->maxLen)
+  {
+    coverage->covered++;
+  }
+}
+
+/**
+ * Count the ROAs covering the looked up prefix by walking up the prefix tree
+ * the way the prefix cache did before the ROA index.
+ *
+ * @param tree The prefix tree
+ * @param prefix The looked up prefix
+ * @param coverage The coverage to update
+ */
+static void _countCoverageTree(patricia_tree_t* tree, prefix_t* prefix,
+                               BenchCoverage* coverage)
+{
+  patricia_node_t* node = patricia_search_best2(tree, prefix, 1);
+  PC_Prefix*       pcPrefix;
+  SListNode*       asListNode;
+  SListNode*       roaListNode;
+  PC_ROA*          pcROA;
+
+  if (node == NULL)
+  {
+    return;
+  }
+  pcPrefix = node->data != NULL ? (PC_Prefix*)node->data : getParent(node);
+  while (pcPrefix != NULL)
+  {
+    FOREACH_SLIST(&pcPrefix->asn, asListNode)
+    {
+      FOREACH_SLIST(&((PC_AS*)asListNode->data)->roas, roaListNode)
+      {
+        pcROA = (PC_ROA*)roaListNode->data;
+        if (coverage->length <= pcROA->max_len)
+        {
+          coverage->covered++;
+        }
+      }
+    }
+    pcPrefix = getParent(pcPrefix->treeNode);
+  }
+}
+
+/**
+ * Look up the ROAs covering random prefixes in the ROA index of the prefix
+ * cache and, as comparison, by walking up its prefix tree. The numbers found
+ * differ slightly, the prefix tree does not separate IPv4 and IPv6 prefixes
+ * with the same bits.
+ *
+ * @param data The benchmark data
+ * @param index Run the ROA index benchmarks
+ * @param tree Run the prefix tree benchmarks
+ */
+static void _benchROALookup(BenchData* data, bool index, bool tree)
+{
+  UpdateCache   updateCache;
+  PrefixCache   prefixCache;
+  IPPrefix*     roaV6 = calloc(NO_ROAS_V6, sizeof(IPPrefix));
+  BenchLookup*  lookups[2];
+  BenchCoverage coverage;
+  uint64_t      covered = 0;
+  double        start;
+  int idx, version;
+
+  memset(&_config, 0, sizeof(Configuration));
+  _config.defaultKeepWindow = 900;
+  if (   !createUpdateCache(&updateCache, _resultChanged, 1, &_config)
+      || !initializePrefixCache(&prefixCache, &updateCache))
+  {
+    fprintf(stderr, "Could not create the prefix cache!\n");
+    exit(EXIT_FAILURE);
+  }
+  for (idx = 0; idx < NO_ROAS; idx++)
+  {
+    addROAwl(&prefixCache, data->roaAS[idx], &data->roaPrefix[idx],
+             data->roaMaxLen[idx], 0, 1, true);
+  }
+  for (idx = 0; idx < NO_ROAS_V6; idx++)
+  {
+    _setPrefixV6(&roaV6[idx], 19 + _random(30));
+    addROAwl(&prefixCache, 1 + _random(NO_AS), &roaV6[idx],
+             roaV6[idx].length + _random(17), 0, 1, true);
+  }
+  lookups[0] = _createLookups(data, roaV6, 4);
+  lookups[1] = _createLookups(data, roaV6, 6);
+
+  for (version = 0; version < 2; version++)
+  {
+    if (index)
+    {
+      start = _now();
+      for (idx = 0; idx < NO_LOOKUPS; idx++)
+      {
+        coverage.length  = lookups[version][idx].prefix->length;
+        coverage.covered = 0;
+        lookupROAIndex(&prefixCache.roaIndex, lookups[version][idx].prefix,
+                       _countCoverage, &coverage);
+        covered += coverage.covered;
+      }
+      _report(version == 0 ? "roa_index_lookup" : "roa_index_lookup_v6",
+              NO_LOOKUPS, _now() - start);
+    }
+    if (tree)
+    {
+      start = _now();
+      for (idx = 0; idx < NO_LOOKUPS; idx++)
+      {
+        coverage.length  = lookups[version][idx].prefix->length;
+        coverage.covered = 0;
+        _countCoverageTree(prefixCache.prefixTree[version == 0 ? PC_TREE_V4
+                                                             : PC_TREE_V6],
+                           lookups[version][idx].treePrefix, &coverage);
+        covered += coverage.covered;
+      }
+      _report(version == 0 ? "prefix_tree_lookup" : "prefix_tree_lookup_v6",
+              NO_LOOKUPS, _now() - start);
+    }
+  }
+  // Keep the compiler from removing the loops.
+  if (covered == 1)
+  {
+    fprintf(stderr, "\n");
+  }
+
+  for (version = 0; version < 2; version++)
+  {
+    for (idx = 0; idx < NO_LOOKUPS; idx++)
+    {
+      free(lookups[version][idx].prefix);
+      free(lookups[version][idx].treePrefix);
+    }
+    free(lookups[version]);
+  }
+  free(roaV6);
+  releasePrefixCache(&prefixCache);
+  releaseUpdateCache(&updateCache);
+}
+
+/**
+ * Look up the hops of all paths in the ASPA DB and validate the paths.
+ *
+ * @param data The benchmark data
+ * @param lookup Run the ASPA_DB_lookup benchmark
+ * @param validate Run the validateASPA benchmark
+ */
+static void _benchAspa(BenchData* data, bool lookup, bool validate)
+{
+  ASPA_DBManager db;
+  AS_PATH_LIST** paths;
+  char     strWord[11];
+  uint64_t ops = 0;
+  uint32_t sum = 0;
+  double   start;
+  int round, idx, hop;
+
+  if (!initializeAspaDBManager(&db, NULL))
+  {
+    fprintf(stderr, "Could not create the ASPA DB!\n");
+    exit(EXIT_FAILURE);
+  }
+  for (idx = 0; idx < NO_AS; idx++)
+  {
+    if (data->as[idx].count > 0)
+    {
+      sprintf(strWord, "%u", idx + 1);
+      insertAspaObj(&db, strWord, strWord,
+                    newASPAObject(idx + 1, data->as[idx].count,
+                                  data->as[idx].providers, AFI_IP));
+    }
+  }
+
+  if (lookup)
+  {
+    start = _now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+      for (idx = 0; idx < NO_UPDATES; idx++)
+      {
+        BenchUpdate* update = &data->updates[idx];
+        // Upstream from the origin which is the last AS.
+        for (hop = update->numberHops - 1; hop > 0; hop--)
+        {
+          sum += ASPA_DB_lookup(&db, update->asPath[hop],
+                                update->asPath[hop - 1], AFI_IP);
+          ops++;
+        }
+      }
+    }
+    _report("aspa_db_lookup", ops, _now() - start);
+  }
+
+  if (validate)
+  {
+    paths = calloc(NO_UPDATES, sizeof(AS_PATH_LIST*));
+    for (idx = 0; idx < NO_UPDATES; idx++)
+    {
+      BenchUpdate* update = &data->updates[idx];
+      paths[idx] = newAspathListEntry(update->numberHops, update->asPath, 0,
+                                      AS_SEQUENCE, ASPA_UPSTREAM, AFI_IP,
+                                      false);
+    }
+    start = _now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+      for (idx = 0; idx < NO_UPDATES; idx++)
+      {
+        sum += validateASPA(paths[idx], AFI_IP, &db);
+      }
+    }
+    _report("validate_aspa", (uint64_t)ROUNDS * NO_UPDATES, _now() - start);
+    for (idx = 0; idx < NO_UPDATES; idx++)
+    {
+      deleteAspathListEntry(paths[idx]);
+    }
+    free(paths);
+  }
+
+  if (sum == 1)
+  {
+    fprintf(stderr, "\n");
+  }
+  releaseAspaHopCache(&db.hopCache);
+}
+
+/**
+ * Queue the given number of commands.
+ *
+ * @param queue The command queue
+ * @param count The number of commands
+ */
+static void _queueCommands(CommandQueue* queue, int count)
+{
+  uint8_t packet[COMMAND_SIZE];
+  int idx;
+
+  memset(packet, 0x5A, COMMAND_SIZE);
+  for (idx = 0; idx < count; idx++)
+  {
+    queueCommand(queue, COMMAND_TYPE_SRX_PROXY, NULL, NULL, idx, COMMAND_SIZE,
+                 packet);
+  }
+}
+
+/**
+ * The producer of the threaded command queue benchmark.
+ *
+ * @param queue The command queue
+ *
+ * @return NULL
+ */
+static void* _produceCommands(void* queue)
+{
+  _queueCommands((CommandQueue*)queue, NO_COMMANDS);
+  return NULL;
+}
+
+/**
+ * Pass commands through the command queue, first in batches by one thread,
+ * then from a producer thread to the consumer as the server does.
+ */
+static void _benchCommandQueue()
+{
+  CommandQueue queue;
+  pthread_t    producer;
+  double       start;
+  int idx, batch;
+
+  if (!initializeCommandQueue(&queue))
+  {
+    fprintf(stderr, "Could not create the command queue!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  start = _now();
+  for (idx = 0; idx < NO_COMMANDS; idx += COMMAND_BATCH)
+  {
+    _queueCommands(&queue, COMMAND_BATCH);
+    for (batch = 0; batch < COMMAND_BATCH; batch++)
+    {
+      deleteCommand(&queue, fetchNextCommand(&queue));
+    }
+  }
+  _report("command_queue", idx, _now() - start);
+
+  start = _now();
+  pthread_create(&producer, NULL, _produceCommands, &queue);
+  for (idx = 0; idx < NO_COMMANDS; idx++)
+  {
+    deleteCommand(&queue, fetchNextCommand(&queue));
+  }
+  pthread_join(producer, NULL);
+  _report("command_queue_threaded", NO_COMMANDS, _now() - start);
+
+  releaseCommandQueue(&queue);
+}
+
+/**
+ * Build the BGPsec_PATH attribute of the given update. The SKI of each router
+ * is derived from its ASN, the signatures are zero.
+ *
+ * @param update The update
+ *
+ * @return the attribute, must be freed by the caller
+ */
+static SCA_BGP_PathAttribute* _createBGPsecPath(BenchUpdate* update)
+{
+  uint16_t pathLength = 2 + update->numberHops * 6;
+  uint16_t sigLength  = 3 + update->numberHops
+                            * (SKI_LENGTH + 2 + SIGNATURE_LENGTH);
+  uint8_t* attr = calloc(1, 4 + pathLength + sigLength);
+  uint8_t* stream = attr;
+  int idx;
+
+  *stream++ = 0x90; // optional, extended length
+  *stream++ = BGPSEC_PATH_TYPE;
+  *(uint16_t*)stream = htons(pathLength + sigLength);
+  stream += 2;
+  *(uint16_t*)stream = htons(pathLength);
+  stream += 2;
+  for (idx = 0; idx < update->numberHops; idx++)
+  {
+    stream[0] = 1; // pCount
+    stream[1] = 0; // flags
+    memcpy(stream + 2, &update->asPathN[idx], 4);
+    stream += 6;
+  }
+  *(uint16_t*)stream = htons(sigLength);
+  stream[2] = 1; // algorithm ID
+  stream += 3;
+  for (idx = 0; idx < update->numberHops; idx++)
+  {
+    memset(stream, update->asPath[idx] & 0xFF, SKI_LENGTH);
+    memcpy(stream, &update->asPathN[idx], 4);
+    stream += SKI_LENGTH;
+    *(uint16_t*)stream = htons(SIGNATURE_LENGTH);
+    stream += 2 + SIGNATURE_LENGTH;
+  }
+
+  return (SCA_BGP_PathAttribute*)attr;
+}
+
+/**
+ * Register all updates with the SKI cache.
+ *
+ * @param data The benchmark data
+ */
+static void _benchSkiCache(BenchData* data)
+{
+  SCA_BGP_PathAttribute** attrs;
+  double start;
+  int idx;
+
+  _skiCache = ski_createCache(_rpkiQueue);
+  attrs = calloc(NO_UPDATES, sizeof(SCA_BGP_PathAttribute*));
+  for (idx = 0; idx < NO_UPDATES; idx++)
+  {
+    attrs[idx] = _createBGPsecPath(&data->updates[idx]);
+  }
+
+  start = _now();
+  for (idx = 0; idx < NO_UPDATES; idx++)
+  {
+    if (ski_registerUpdate(_skiCache, &data->updates[idx].updateID,
+                           attrs[idx]) == REGVAL_ERROR)
+    {
+      fprintf(stderr, "Could not register update %i!\n", idx);
+      exit(EXIT_FAILURE);
+    }
+  }
+  _report("ski_register_update", NO_UPDATES, _now() - start);
+
+  ski_releaseCache(_skiCache);
+  _skiCache = NULL;
+  for (idx = 0; idx < NO_UPDATES; idx++)
+  {
+    free(attrs[idx]);
+  }
+  free(attrs);
+}
+
+/**
+ * Return true if the benchmark is selected on the command line.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments, the selected benchmark names
+ * @param first The first benchmark name within argv
+ * @param name The name of the benchmark
+ *
+ * @return true if no benchmark is selected or the name is selected
+ */
+static bool _selected(int argc, char** argv, int first, const char* name)
+{
+  int idx;
+
+  if (first >= argc)
+  {
+    return true;
+  }
+  for (idx = first; idx < argc; idx++)
+  {
+    if (strcmp(argv[idx], name) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char** argv)
+{
+  BenchData data;
+  int first = 1;
+
+  if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "-?") == 0))
+  {
+    printf ("Usage: %s [-s <seed>] [<benchmark> ...]\n"
+            "  benchmarks: generate_identifier make_path_id store_update\n"
+            "              get_update_result add_roa "
+            "request_update_validation\n"
+            "              request_update_validation_repeat\n"
+            "              aspa_db_lookup validate_aspa command_queue\n"
+            "              ski_register_update roa_index_lookup\n"
+            "              roa_index_lookup_v6 prefix_tree_lookup\n"
+            "              prefix_tree_lookup_v6\n", argv[0]);
+    return (EXIT_SUCCESS);
+  }
+  if (argc > 2 && strcmp(argv[1], "-s") == 0)
+  {
+    _seed = strtoul(argv[2], NULL, 10);
+    first = 3;
+    if (_seed == 0)
+    {
+      printf ("The seed must not be zero!\n");
+      return (EXIT_FAILURE);
+    }
+  }
+
+  // The SKI cache reports each BGP-4 update stored in the update cache as error.
+  setLogLevel(LEVEL_ERROR);
+  setLogMethodToCallback(_logMessage);
+  _rpkiQueue = rq_createQueue();
+  _createData(&data);
+
+  printf ("benchmark,ops,seconds,ns_per_op,ops_per_sec\n");
+  if (_selected(argc, argv, first, "generate_identifier")
+      || _selected(argc, argv, first, "make_path_id"))
+  {
+    _benchIdentifier(&data);
+  }
+  if (_selected(argc, argv, first, "store_update")
+      || _selected(argc, argv, first, "get_update_result")
+      || _selected(argc, argv, first, "add_roa")
+      || _selected(argc, argv, first, "request_update_validation")
+      || _selected(argc, argv, first, "request_update_validation_repeat"))
+  {
+    _benchUpdates(&data,
+                  _selected(argc, argv, first, "store_update")
+                  || _selected(argc, argv, first, "get_update_result"),
+                  _selected(argc, argv, first, "add_roa")
+                  || _selected(argc, argv, first, "request_update_validation")
+                  || _selected(argc, argv, first,
+                               "request_update_validation_repeat"));
+  }
+  if (_selected(argc, argv, first, "roa_index_lookup")
+      || _selected(argc, argv, first, "roa_index_lookup_v6")
+      || _selected(argc, argv, first, "prefix_tree_lookup")
+      || _selected(argc, argv, first, "prefix_tree_lookup_v6"))
+  {
+    _benchROALookup(&data,
+                    _selected(argc, argv, first, "roa_index_lookup")
+                    || _selected(argc, argv, first, "roa_index_lookup_v6"),
+                    _selected(argc, argv, first, "prefix_tree_lookup")
+                    || _selected(argc, argv, first, "prefix_tree_lookup_v6"));
+  }
+  if (_selected(argc, argv, first, "aspa_db_lookup")
+      || _selected(argc, argv, first, "validate_aspa"))
+  {
+    _benchAspa(&data, _selected(argc, argv, first, "aspa_db_lookup"),
+               _selected(argc, argv, first, "validate_aspa"));
+  }
+  if (_selected(argc, argv, first, "command_queue"))
+  {
+    _benchCommandQueue();
+  }
+  if (_selected(argc, argv, first, "ski_register_update"))
+  {
+    _benchSkiCache(&data);
+  }
+
+  rq_releaseQueue(_rpkiQueue);
+  if (_logged > 0)
+  {
+    fprintf(stderr, "%llu log messages suppressed\n",
+            (unsigned long long)_logged);
+  }
+
+  return (EXIT_SUCCESS);
+}
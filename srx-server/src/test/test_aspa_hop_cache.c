@@ -0,0 +1,468 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the ASPA hop cache. The last test builds a
+ * synthetic AS topology with tier-1, transit and stub ASes and compares the
+ * time needed to look up all hops of a RouteViews like path set with and
+ * without the hop cache, and without the cache with DEBUG logging enabled.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "server/aspa_hop_cache.h"
+#include "server/aspa_trie.h"
+#include "server/aspath_cache.h"
+#include "server/rpki_queue.h"
+#include "server/update_cache.h"
+#include "util/log.h"
+
+#define NO_TIER1       16
+#define NO_TRANSIT     2000
+#define NO_STUBS       60000
+#define NO_PEERS       32
+#define NO_PATHS       300000
+#define MAX_PATH_LEN   10
+#define MAX_PROVIDERS  3
+
+/** The ASN of the first AS of each tier. Stubs use 4 byte ASNs. */
+#define ASN_TIER1      100
+#define ASN_TRANSIT    20000
+#define ASN_STUB       4200000000u
+
+/** A synthetic AS path, list[0] is the origin. */
+typedef struct {
+  uint8_t  length;
+  uint32_t list[MAX_PATH_LEN];
+} TestPath;
+
+/** The providers of each AS in the synthetic topology. */
+typedef struct {
+  uint32_t asn;
+  uint16_t count;
+  uint32_t providers[MAX_PROVIDERS];
+} TestAS;
+
+// The end of data processing of aspa_trie.c is not part of this test.
+uint8_t validateASPA (AS_PATH_LIST* aspl, uint8_t afi,
+                      ASPA_DBManager* aspaDBManager)
+{
+  return 0;
+}
+RPKI_QUEUE* getRPKIQueue()
+{
+  return NULL;
+}
+bool getUpdateResult(UpdateCache* self, SRxUpdateID* updateID,
+                     uint8_t clientID, void* clientMapping,
+                     SRxResult* srxRes, SRxDefaultResult* defaultRes,
+                     uint32_t *pathID)
+{
+  return false;
+}
+AS_PATH_LIST* borrowAspathList(AspathCache* self, uint32_t pathId,
+                               SRxResult* srxRes, uint32_t* epoch)
+{
+  return NULL;
+}
+void returnAspathList(AspathCache* self, uint32_t epoch)
+{
+}
+bool modifyAspaValidationResultToAspathCache(AspathCache *self,
+                      uint32_t pathId, uint8_t modAspaResult,
+                      time_t lastModified)
+{
+  return false;
+}
+bool modifyUpdateCacheResultWithAspaVal(UpdateCache* self,
+                                        SRxUpdateID* updateID,
+                                        SRxResult* srxResult_aspa)
+{
+  return false;
+}
+
+/** State of the pseudo random generator, fixed to repeat the experiment. */
+static uint32_t _seed = 2463534242u;
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Return the current time in seconds.
+ *
+ * @return the time of the monotonic clock
+ */
+static double _now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Return a pseudo random number between 0 and max - 1.
+ *
+ * @param max The upper bound
+ *
+ * @return the random number
+ */
+static uint32_t _random(uint32_t max)
+{
+  _seed ^= _seed << 13;
+  _seed ^= _seed >> 17;
+  _seed ^= _seed << 5;
+  return _seed % max;
+}
+
+/**
+ * Register the ASPA object for the given customer.
+ *
+ * @param db The ASPA DB
+ * @param customer The customer ASN
+ * @param count The number of providers
+ * @param providers The provider ASNs
+ */
+static void _insert(ASPA_DBManager* db, uint32_t customer, uint16_t count,
+                    uint32_t* providers)
+{
+  char strWord[11];
+  sprintf(strWord, "%u", customer);
+  insertAspaObj(db, strWord, strWord,
+                newASPAObject(customer, count, providers, AFI_IP));
+}
+
+/**
+ * Test the hop cache without the ASPA DB.
+ */
+static void _test1()
+{
+  ASPA_HopCache cache;
+  ASPA_ValidationResult result;
+  uint32_t generation;
+  uint32_t idx;
+
+  printf ("Test #1: Hop cache store, lookup and invalidation\n");
+  assert_int(createAspaHopCache(&cache, 1000), true, "Create the cache");
+  assert_int(cache.bucketMask + 1, 256, "Rounded number of buckets");
+
+  assert_int(lookupAspaHopCache(&cache, 65001, 65010, AFI_IP, &result,
+                                &generation), false, "Lookup on empty cache");
+  storeAspaHopCache(&cache, generation, 65001, 65010, AFI_IP,
+                    ASPA_RESULT_VALID);
+  storeAspaHopCache(&cache, generation, 65001, 65011, AFI_IP,
+                    ASPA_RESULT_INVALID);
+  assert_int(lookupAspaHopCache(&cache, 65001, 65010, AFI_IP, &result,
+                                &generation), true, "Lookup stored hop");
+  assert_int(result, ASPA_RESULT_VALID, "Result of the stored hop");
+  assert_int(lookupAspaHopCache(&cache, 65001, 65011, AFI_IP, &result,
+                                &generation), true, "Lookup second hop");
+  assert_int(result, ASPA_RESULT_INVALID, "Result of the second hop");
+  assert_int(lookupAspaHopCache(&cache, 65001, 65010, AFI_IP6, &result,
+                                &generation), false, "Lookup other afi");
+
+  // A result computed before the data changed must not be stored.
+  invalidateAspaHopCache(&cache);
+  assert_int(lookupAspaHopCache(&cache, 65001, 65010, AFI_IP, &result,
+                                &generation), false, "Lookup after change");
+  storeAspaHopCache(&cache, generation - 1, 65001, 65010, AFI_IP,
+                    ASPA_RESULT_VALID);
+  assert_int(lookupAspaHopCache(&cache, 65001, 65010, AFI_IP, &result,
+                                &generation), false, "Store outdated result");
+
+  // Fill far more hops than the cache holds, the last ones must be found.
+  for (idx = 0; idx < 100000; idx++)
+  {
+    if (!lookupAspaHopCache(&cache, idx, idx + 1, AFI_IP, &result,
+                            &generation))
+    {
+      storeAspaHopCache(&cache, generation, idx, idx + 1, AFI_IP,
+                        ASPA_RESULT_UNKNOWN);
+    }
+  }
+  assert_int(lookupAspaHopCache(&cache, idx - 1, idx, AFI_IP, &result,
+                                &generation), true, "Lookup after eviction");
+  assert_int(result, ASPA_RESULT_UNKNOWN, "Result after eviction");
+
+  // The slots only keep 24 bits of the generation.
+  cache.generation = 0x00FFFFFF;
+  storeAspaHopCache(&cache, cache.generation, 65001, 65010, AFI_IP,
+                    ASPA_RESULT_VALID);
+  invalidateAspaHopCache(&cache);
+  assert_int(cache.generation, 0x01000001, "Generation after wrap");
+  cache.generation = 0x01FFFFFF;
+  assert_int(lookupAspaHopCache(&cache, 65001, 65010, AFI_IP, &result,
+                                &generation), false, "Lookup after wrap");
+
+  releaseAspaHopCache(&cache);
+  assert_int(lookupAspaHopCache(&cache, 65001, 65010, AFI_IP, &result,
+                                &generation), false, "Lookup on released");
+  printf ("         passed.\n");
+}
+
+/**
+ * Test that ASPA_DB_lookup follows the changes of the ASPA DB.
+ */
+static void _test2()
+{
+  ASPA_DBManager db;
+  uint32_t providers[2] = { 65010, 65011 };
+  char     strWord[11];
+  int      round;
+
+  printf ("Test #2: ASPA DB lookup follows ASPA changes\n");
+  assert_int(initializeAspaDBManager(&db, NULL), true, "Initialize ASPA DB");
+
+  // Each lookup is done twice, the second one is answered by the cache.
+  for (round = 0; round < 2; round++)
+  {
+    assert_int(ASPA_DB_lookup(&db, 65001, 65010, AFI_IP), ASPA_RESULT_UNKNOWN,
+               "No ASPA object");
+  }
+
+  _insert(&db, 65001, 2, providers);
+  for (round = 0; round < 2; round++)
+  {
+    assert_int(ASPA_DB_lookup(&db, 65001, 65010, AFI_IP), ASPA_RESULT_VALID,
+               "Registered provider");
+    assert_int(ASPA_DB_lookup(&db, 65001, 65012, AFI_IP), ASPA_RESULT_INVALID,
+               "Not registered provider");
+  }
+
+  // Replace the providers.
+  providers[0] = 65012;
+  _insert(&db, 65001, 1, providers);
+  for (round = 0; round < 2; round++)
+  {
+    assert_int(ASPA_DB_lookup(&db, 65001, 65010, AFI_IP), ASPA_RESULT_INVALID,
+               "Removed provider");
+    assert_int(ASPA_DB_lookup(&db, 65001, 65012, AFI_IP), ASPA_RESULT_VALID,
+               "Added provider");
+  }
+
+  // Withdraw the object.
+  ASPA_Object* obj = newASPAObject(65001, 1, providers, AFI_IP);
+  sprintf(strWord, "%u", 65001);
+  assert_int(delete_TrieNode_AspaObj(&db, strWord, obj), true,
+             "Withdraw ASPA object");
+  deleteASPAObject(&db, obj);
+  for (round = 0; round < 2; round++)
+  {
+    assert_int(ASPA_DB_lookup(&db, 65001, 65012, AFI_IP), ASPA_RESULT_UNKNOWN,
+               "Withdrawn ASPA object");
+  }
+
+  releaseAspaHopCache(&db.hopCache);
+  printf ("         passed.\n");
+}
+
+/**
+ * Look up all hops of all paths in upstream direction as validateASPA does.
+ *
+ * @param db The ASPA DB
+ * @param paths The paths
+ * @param results (out) The accumulated result of each path
+ *
+ * @return the time needed in seconds
+ */
+static double _lookupPaths(ASPA_DBManager* db, TestPath* paths,
+                           uint16_t* results)
+{
+  double start = _now();
+  int idx, hop;
+
+  for (idx = 0; idx < NO_PATHS; idx++)
+  {
+    results[idx] = ASPA_RESULT_NIBBLE_ZERO;
+    for (hop = 0; hop < paths[idx].length - 1; hop++)
+    {
+      results[idx] |= ASPA_DB_lookup(db, paths[idx].list[hop],
+                                     paths[idx].list[hop + 1], AFI_IP);
+    }
+  }
+
+  return _now() - start;
+}
+
+/**
+ * Compare the lookup of a RouteViews like path set with and without cache.
+ */
+static void _test3()
+{
+  ASPA_DBManager db;
+  TestAS*   tier1   = calloc(NO_TIER1,   sizeof(TestAS));
+  TestAS*   transit = calloc(NO_TRANSIT, sizeof(TestAS));
+  TestAS*   stubs   = calloc(NO_STUBS,   sizeof(TestAS));
+  TestPath* paths   = calloc(NO_PATHS,   sizeof(TestPath));
+  uint16_t* before  = calloc(NO_PATHS,   sizeof(uint16_t));
+  uint16_t* after   = calloc(NO_PATHS,   sizeof(uint16_t));
+  uint32_t  peers[NO_PEERS];
+  uint64_t  hops = 0;
+  FILE*     devNull = fopen("/dev/null", "w");
+  int idx, prov;
+
+  printf ("Test #3: Validate a RouteViews like path set\n");
+  assert_int(initializeAspaDBManager(&db, NULL), true, "Initialize ASPA DB");
+
+  // Tier-1 ASes have no providers, transit ASes buy from tier-1 ASes and
+  // stubs from transit ASes. Half of the transit ASes and a third of the
+  // stubs registered ASPA objects.
+  for (idx = 0; idx < NO_TIER1; idx++)
+  {
+    tier1[idx].asn = ASN_TIER1 + idx;
+  }
+  for (idx = 0; idx < NO_TRANSIT; idx++)
+  {
+    transit[idx].asn   = ASN_TRANSIT + idx;
+    transit[idx].count = 1 + _random(MAX_PROVIDERS);
+    for (prov = 0; prov < transit[idx].count; prov++)
+    {
+      transit[idx].providers[prov] = tier1[_random(NO_TIER1)].asn;
+    }
+    if (_random(2) == 0)
+    {
+      _insert(&db, transit[idx].asn, transit[idx].count,
+              transit[idx].providers);
+    }
+  }
+  for (idx = 0; idx < NO_STUBS; idx++)
+  {
+    stubs[idx].asn   = ASN_STUB + idx;
+    stubs[idx].count = 1 + _random(2);
+    for (prov = 0; prov < stubs[idx].count; prov++)
+    {
+      stubs[idx].providers[prov] = transit[_random(NO_TRANSIT)].asn;
+    }
+    if (_random(3) == 0)
+    {
+      _insert(&db, stubs[idx].asn, stubs[idx].count, stubs[idx].providers);
+    }
+  }
+
+  // The collector peers with tier-1 and transit ASes.
+  for (idx = 0; idx < NO_PEERS; idx++)
+  {
+    peers[idx] = (idx < NO_TIER1 / 2) ? tier1[idx].asn
+                                      : transit[_random(NO_TRANSIT)].asn;
+  }
+
+  // Each path goes up from the origin to a tier-1 AS and down to the peer.
+  for (idx = 0; idx < NO_PATHS; idx++)
+  {
+    TestPath* path = &paths[idx];
+    TestAS*   as   = &stubs[_random(NO_STUBS)];
+    uint32_t  peer = peers[idx % NO_PEERS];
+
+    path->list[path->length++] = as->asn;
+    as = &transit[as->providers[_random(as->count)] - ASN_TRANSIT];
+    path->list[path->length++] = as->asn;
+    if (as->asn != peer)
+    {
+      uint32_t top = as->providers[_random(as->count)];
+      path->list[path->length++] = top;
+      if (_random(4) == 0)
+      {
+        // Route crossed between tier-1 ASes.
+        top = tier1[_random(NO_TIER1)].asn;
+        if (top != path->list[path->length - 1])
+        {
+          path->list[path->length++] = top;
+        }
+      }
+      if (top != peer)
+      {
+        path->list[path->length++] = peer;
+      }
+    }
+    hops += path->length - 1;
+  }
+
+  // Before: each hop searches the ASPA DB. The log level is the one used in
+  // operation, the DEBUG statements of the lookup are skipped.
+  setLogMethodToFile(devNull);
+  setLogLevel(LEVEL_NOTICE);
+  releaseAspaHopCache(&db.hopCache);
+  double uncached = _lookupPaths(&db, paths, before);
+  setLogLevel(LEVEL_DEBUG);
+  double debugLog = _lookupPaths(&db, paths, after);
+  setLogLevel(LEVEL_NOTICE);
+
+  // After: the hop cache answers most hops.
+  assert_int(createAspaHopCache(&db.hopCache, ASPA_HOP_CACHE_SLOTS), true,
+             "Create the hop cache");
+  double cold = _lookupPaths(&db, paths, after);
+  for (idx = 0; idx < NO_PATHS; idx++)
+  {
+    assert_int(after[idx], before[idx], "Result with cold cache");
+  }
+  double warm = _lookupPaths(&db, paths, after);
+  for (idx = 0; idx < NO_PATHS; idx++)
+  {
+    assert_int(after[idx], before[idx], "Result with warm cache");
+  }
+
+  printf ("         %u ASPA objects, %u paths, %llu hops\n", db.countAspaObj,
+          NO_PATHS, (unsigned long long)hops);
+  printf ("         without cache : %8.3f s  %7.1f ns/path\n", uncached,
+          uncached * 1e9 / NO_PATHS);
+  printf ("         debug logging : %8.3f s  %7.1f ns/path\n", debugLog,
+          debugLog * 1e9 / NO_PATHS);
+  printf ("         cold cache    : %8.3f s  %7.1f ns/path\n", cold,
+          cold * 1e9 / NO_PATHS);
+  printf ("         warm cache    : %8.3f s  %7.1f ns/path\n", warm,
+          warm * 1e9 / NO_PATHS);
+
+  releaseAspaHopCache(&db.hopCache);
+  setLogMethodToFile(NULL);
+  fclose(devNull);
+  free(tier1);
+  free(transit);
+  free(stubs);
+  free(paths);
+  free(before);
+  free(after);
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  _test1();
+  _test2();
+  _test3();
+
+  return (EXIT_SUCCESS);
+}
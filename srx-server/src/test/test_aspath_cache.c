@@ -0,0 +1,273 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the AS path cache. The last test borrows
+ * paths from multiple threads while the paths are added and removed.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include "server/aspath_cache.h"
+
+#define NO_READERS   3
+#define NO_PATHS     64
+#define MAX_PATH_LEN 20
+#define TEST_SECONDS 2
+
+/** The cache shared by the threads of test #2. */
+static AspathCache _cache;
+/** Indicates that the threads of test #2 must stop. */
+static volatile bool _stop = false;
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Store the test path of the given ID. The path has 1 to MAX_PATH_LEN hops,
+ * the hop at position idx is pathId * 100 + idx.
+ *
+ * @param cache The AS path cache
+ * @param pathId The path ID, not zero
+ */
+static void _storePath(AspathCache* cache, uint32_t pathId)
+{
+  uint32_t path[MAX_PATH_LEN];
+  uint16_t length = 1 + (pathId % MAX_PATH_LEN);
+  int      idx;
+
+  for (idx = 0; idx < length; idx++)
+  {
+    path[idx] = pathId * 100 + idx;
+  }
+  AS_PATH_LIST* aspl = newAspathListEntry(length, path, pathId, AS_SEQUENCE,
+                                          ASPA_UPSTREAM, AFI_IP, false);
+  storeAspathList(cache, NULL, pathId, AS_SEQUENCE, aspl);
+  deleteAspathListEntry(aspl);
+}
+
+/**
+ * Verify the borrowed test path.
+ *
+ * @param aspl The borrowed path
+ * @param pathId The path ID
+ *
+ * @return true if the path is intact.
+ */
+static bool _checkPath(AS_PATH_LIST* aspl, uint32_t pathId)
+{
+  int idx;
+
+  if (aspl->asPathLength != 1 + (pathId % MAX_PATH_LEN))
+  {
+    return false;
+  }
+  for (idx = 0; idx < aspl->asPathLength; idx++)
+  {
+    if (aspl->asPathList[idx] != pathId * 100 + idx)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Test borrowing, modifying and reference counting in a single thread.
+ */
+static void _test1()
+{
+  AspathCache   cache;
+  AS_PATH_LIST* aspl;
+  SRxResult     srxRes;
+  uint32_t      epoch, otherEpoch;
+  uint32_t      prepends[] = { 65001, 65001, 65001, 65002, 65003, 65003 };
+
+  printf ("Test #1: Borrow, modify and reference count paths\n");
+  assert_int(createAspathCache(&cache, NULL), true, "Create the cache");
+
+  // Prepends are stored once.
+  aspl = newAspathListEntry(6, prepends, 1, AS_SEQUENCE, ASPA_UPSTREAM,
+                            AFI_IP, false);
+  assert_int(aspl->asPathLength, 3, "Length without prepends");
+  assert_int(storeAspathList(&cache, NULL, 1, AS_SEQUENCE, aspl), 1,
+             "Store the path");
+  assert_int(storeAspathList(&cache, NULL, 1, AS_SEQUENCE, aspl), 0,
+             "Store the path again");
+  deleteAspathListEntry(aspl);
+
+  aspl = borrowAspathList(&cache, 1, &srxRes, &epoch);
+  assert_int(aspl != NULL, true, "Borrow the path");
+  assert_int(aspl->asPathList[2], 65003, "Origin of the borrowed path");
+  // The cache is not blocked by the borrowed path.
+  assert_int(modifyAspaValidationResultToAspathCache(&cache, 1,
+                                    SRx_RESULT_INVALID, 1234), true,
+             "Modify the borrowed path");
+  returnAspathList(&cache, epoch);
+
+  aspl = borrowAspathList(&cache, 1, &srxRes, &epoch);
+  assert_int(srxRes.aspaResult, SRx_RESULT_INVALID, "Modified result");
+  assert_int(aspl->lastModified, 1234, "Modified time");
+  returnAspathList(&cache, epoch);
+
+  // The copy does not require the result.
+  aspl = getAspathListFromAspathCache(&cache, 1, NULL);
+  assert_int(aspl != NULL, true, "Copy the path without result");
+  assert_int(aspl->aspaValResult, SRx_RESULT_INVALID, "Result of the copy");
+  deleteAspathListEntry(aspl);
+
+  // The path is removed with the last update, a borrowed path stays valid.
+  assert_int(addAspathListReference(&cache, 1), true, "First reference");
+  assert_int(addAspathListReference(&cache, 1), true, "Second reference");
+  assert_int(addAspathListReference(&cache, 2), false, "Unknown path");
+  assert_int(removeAspathListReference(&cache, 1), true, "Remove first");
+  aspl = borrowAspathList(&cache, 1, &srxRes, &epoch);
+  assert_int(aspl != NULL, true, "Borrow with one reference left");
+  assert_int(removeAspathListReference(&cache, 1), true, "Remove second");
+  assert_int(borrowAspathList(&cache, 1, &srxRes, &otherEpoch) == NULL, true,
+             "Borrow the removed path");
+  assert_int(srxRes.aspaResult, SRx_RESULT_UNDEFINED, "Result of removed");
+  _storePath(&cache, 3);
+  _storePath(&cache, 4);
+  assert_int(cache.retired != NULL, true, "Removed path kept for the reader");
+  assert_int(aspl->asPathList[0], 65001, "Neighbor of the removed path");
+  returnAspathList(&cache, epoch);
+
+  _storePath(&cache, 5);
+  _storePath(&cache, 6);
+  assert_int(cache.retired == NULL, true, "Removed path freed");
+
+  releaseAspathCache(&cache);
+  printf ("         passed.\n");
+}
+
+/**
+ * Borrow random paths and verify them until the test stops.
+ *
+ * @param arg The number of verified paths (out)
+ *
+ * @return NULL
+ */
+static void* _reader(void* arg)
+{
+  uint64_t* count = (uint64_t*)arg;
+  uint32_t  seed  = (uint32_t)(uintptr_t)arg;
+  uint32_t  epoch;
+
+  while (!_stop)
+  {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    uint32_t pathId = 1 + (seed % NO_PATHS);
+    AS_PATH_LIST* aspl = borrowAspathList(&_cache, pathId, NULL, &epoch);
+    if (aspl != NULL)
+    {
+      if (!_checkPath(aspl, pathId))
+      {
+        printf ("Error: Path 0x%08X changed while borrowed\n", pathId);
+        exit (EXIT_FAILURE);
+      }
+      returnAspathList(&_cache, epoch);
+      (*count)++;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Test borrowing paths while other paths are added and removed.
+ */
+static void _test2()
+{
+  pthread_t readers[NO_READERS];
+  uint64_t  counts[NO_READERS];
+  uint64_t  total   = 0;
+  uint64_t  changes = 0;
+  time_t    end     = time(NULL) + TEST_SECONDS;
+  uint32_t  pathId;
+  int       idx;
+
+  printf ("Test #2: Borrow paths while the paths change\n");
+  assert_int(createAspathCache(&_cache, NULL), true, "Create the cache");
+  for (idx = 0; idx < NO_READERS; idx++)
+  {
+    counts[idx] = 0;
+    pthread_create(&readers[idx], NULL, _reader, &counts[idx]);
+  }
+
+  // Each path is stored for one update and removed with it again.
+  while (time(NULL) < end)
+  {
+    for (pathId = 1; pathId <= NO_PATHS; pathId++)
+    {
+      _storePath(&_cache, pathId);
+      addAspathListReference(&_cache, pathId);
+    }
+    for (pathId = 1; pathId <= NO_PATHS; pathId++)
+    {
+      assert_int(removeAspathListReference(&_cache, pathId), true,
+                 "Remove the update");
+    }
+    changes++;
+  }
+
+  _stop = true;
+  for (idx = 0; idx < NO_READERS; idx++)
+  {
+    pthread_join(readers[idx], NULL);
+    total += counts[idx];
+  }
+  releaseAspathCache(&_cache);
+  assert_int(_cache.retired == NULL, true, "All paths freed");
+
+  printf ("         %llu paths borrowed during %llu rounds.\n",
+          (unsigned long long)total, (unsigned long long)changes);
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  _test1();
+  _test2();
+
+  return (EXIT_SUCCESS);
+}
@@ -0,0 +1,367 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the signing functions of the BGPsec handler.
+ * The SRxCryptoAPI is replaced by a mock that creates fake signatures and
+ * records the calls of its sign function.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <srx/srxcryptoapi.h>
+#include "server/bgpsec_handler.h"
+
+#define MY_ASN       65000
+#define PEER_ASN     65001
+#define ALGO_ID      1
+#define FAKE_SIG_LEN 72
+#define NO_REQUESTS  1024
+#define BATCH_SIZE   16
+#define NO_KEYS      BGPSEC_MAX_SIGN_KEYS
+
+/** The content of a fake signature, the rest is padding up to FAKE_SIG_LEN. */
+typedef struct {
+  /** The AS of the signer (network format). */
+  uint32_t myASN;
+  /** The call of the sign function that created the signature. */
+  uint32_t call;
+  /** The position of the sign data within the call. */
+  uint32_t position;
+} MockSignature;
+
+/** The mock of the SRxCryptoAPI */
+static SRxCryptoAPI _mockAPI;
+/** Number of calls into the sign function of the mock. */
+static int _signCalls = 0;
+/** Number of updates signed by the mock. */
+static int _signCount = 0;
+/** Number of updates handed to the sign function per call. */
+static int _callSize[NO_REQUESTS];
+
+/**
+ * Required by the BGPsec handler, returns the mock API.
+ *
+ * @return the mock API
+ */
+SRxCryptoAPI* getSrxCAPI()
+{
+  return &_mockAPI;
+}
+
+/**
+ * Sign function of the mock. The signature contains the AS of the signer, the
+ * number of the call, and the position within the call. This allows the test
+ * to verify the signature belongs to the request and the batch it was handed
+ * over with.
+ *
+ * @param count The number of sign data elements
+ * @param bgpsec_data The sign data elements
+ *
+ * @return API_SUCCESS
+ */
+static int _mock_sign(int count, SCA_BGPSecSignData** bgpsec_data)
+{
+  MockSignature mSig;
+  int idx;
+
+  if (_signCalls < NO_REQUESTS)
+  {
+    _callSize[_signCalls] = count;
+  }
+  _signCalls++;
+  for (idx = 0; idx < count; idx++)
+  {
+    SCA_BGPSecSignData* data = bgpsec_data[idx];
+    SCA_Signature* sig = malloc(sizeof(SCA_Signature));
+    sig->ownedByAPI = false;
+    sig->algoID     = data->algorithmID;
+    memcpy(sig->ski, data->ski, SKI_LENGTH);
+    sig->sigLen     = FAKE_SIG_LEN;
+    sig->sigBuff    = malloc(FAKE_SIG_LEN);
+    mSig.myASN      = data->myASN;
+    mSig.call       = _signCalls;
+    mSig.position   = idx;
+    memset(sig->sigBuff, 0xEE, FAKE_SIG_LEN);
+    memcpy(sig->sigBuff, &mSig, sizeof(MockSignature));
+    data->signature = sig;
+    data->status    = API_STATUS_OK;
+    _signCount++;
+  }
+  return API_SUCCESS;
+}
+
+/**
+ * The mock does not maintain the signature memory.
+ *
+ * @param signature The signature
+ *
+ * @return false
+ */
+static bool _mock_freeSignature(SCA_Signature* signature)
+{
+  return false;
+}
+
+/**
+ * The mock does not maintain the hash message memory.
+ *
+ * @param hashMessage The hash message
+ *
+ * @return false
+ */
+static bool _mock_freeHashMessage(SCA_HashMessage* hashMessage)
+{
+  return false;
+}
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Return the fake signature of the given signature segment.
+ *
+ * @param segment The signature segment created by the BGPsec handler.
+ *
+ * @return the fake signature.
+ */
+static MockSignature* _mockSignature(uint8_t* segment)
+{
+  return (MockSignature*)(segment + sizeof(SCA_BGPSEC_SignatureSegment));
+}
+
+/**
+ * Initialize the handler and register NO_KEYS keys for MY_ASN and the 
+ * following ASNs. The first byte of the SKI is the index of the key.
+ *
+ * @param handler The handler to be initialized.
+ */
+static void _initialize(BGPSecHandler* handler)
+{
+  int idx;
+
+  printf ("Initialize experiment\n");
+  memset(&_mockAPI, 0, sizeof(SRxCryptoAPI));
+  _mockAPI.sign            = _mock_sign;
+  _mockAPI.freeSignature   = _mock_freeSignature;
+  _mockAPI.freeHashMessage = _mock_freeHashMessage;
+
+  createBGPSecHandler(handler, NULL);
+  // The key vault is not available during the test, register the keys
+  // directly.
+  for (idx = 0; idx < NO_KEYS; idx++)
+  {
+    handler->signKeys[idx].asn    = MY_ASN + idx;
+    handler->signKeys[idx].algoID = ALGO_ID;
+    memset(handler->signKeys[idx].ski, 0xAB, SKI_LENGTH);
+    handler->signKeys[idx].ski[0] = idx;
+  }
+  handler->numSignKeys = NO_KEYS;
+  printf ("         passed.\n");
+}
+
+/**
+ * Initialize the given update as origination of 10.0.0.0/8 by asn.
+ *
+ * @param update The update
+ * @param asn The origin AS (host format)
+ */
+static void _initUpdate(UC_UpdateData* update, uint32_t asn)
+{
+  memset(update, 0, sizeof(UC_UpdateData));
+  update->myAS               = htonl(asn);
+  update->nlri.afi           = htons(1);
+  update->nlri.safi          = 1;
+  update->nlri.length        = 8;
+  update->nlri.addr.ipV4.s_addr = htonl(0x0A000000);
+  update->bgpsec_path        = NULL;
+}
+
+/**
+ * Sign an origination and verify the signature segment.
+ *
+ * @param handler The BGPsec handler
+ */
+static void _test1(BGPSecHandler* handler)
+{
+  printf ("Test #1: Sign an origination and verify the signature segment\n");
+  UC_UpdateData     update;
+  BGPSecSignRequest request;
+  _initUpdate(&update, MY_ASN);
+
+  memset(&request, 0, sizeof(BGPSecSignRequest));
+  request.update = &update;
+  request.peerAS = PEER_ASN;
+  request.pCount = 3;
+  request.algoID = ALGO_ID;
+
+  _signCalls = 0;
+  assert_int(createSignature(handler, 1, &request), 1, "Signatures created");
+  assert_int(_signCalls, 1, "Calls to sign");
+  assert_int(request.length, sizeof(SCA_BGPSEC_SignatureSegment)
+                             + FAKE_SIG_LEN, "Segment length");
+
+  SCA_BGPSEC_SignatureSegment* sigSeg =
+                               (SCA_BGPSEC_SignatureSegment*)request.segment;
+  MockSignature* sig = _mockSignature(request.segment);
+  assert_int(ntohs(sigSeg->siglen), FAKE_SIG_LEN, "Signature length");
+  assert_int(sigSeg->ski[0], 0, "SKI");
+  assert_int(sigSeg->ski[1], 0xAB, "SKI");
+  assert_int(ntohl(sig->myASN), MY_ASN, "Signer AS");
+  assert_int(sig->call, 1, "Signed in first call");
+  assert_int(request.segment[request.length-1], 0xEE, "Signature copied");
+
+  free(request.segment);
+  printf ("         passed.\n");
+}
+
+/**
+ * Sign two updates where no key exists for the second one.
+ *
+ * @param handler The BGPsec handler
+ */
+static void _test2(BGPSecHandler* handler)
+{
+  printf ("Test #2: Sign request without registered key\n");
+  UC_UpdateData     update[2];
+  BGPSecSignRequest request[2];
+  _initUpdate(&update[0], MY_ASN);
+  _initUpdate(&update[1], MY_ASN + 10);
+
+  memset(request, 0, sizeof(request));
+  request[0].update = &update[0];
+  request[0].peerAS = PEER_ASN;
+  request[0].algoID = ALGO_ID;
+  request[1].update = &update[1];
+  request[1].peerAS = PEER_ASN;
+  request[1].algoID = ALGO_ID;
+
+  _signCount = 0;
+  assert_int(createSignature(handler, 2, request), 1, "Signatures created");
+  assert_int(_signCount, 1, "Updates handed to sign");
+  assert_int(request[0].segment != NULL, 1, "Signature of first update");
+  assert_int(request[1].segment == NULL, 1, "Signature of second update");
+  assert_int((request[1].status & API_STATUS_ERR_INVLID_KEY) != 0, 1,
+             "Status of second update");
+
+  free(request[0].segment);
+  printf ("         passed.\n");
+}
+
+/**
+ * Sign NO_REQUESTS updates in batches of the given size. The updates are 
+ * originated by the NO_KEYS ASes in turn. Each update must receive its own
+ * signature, created by the call of the sign function its batch was handed 
+ * over with.
+ *
+ * @param handler The BGPsec handler
+ * @param batchSize The number of updates signed per call
+ */
+static void _test3(BGPSecHandler* handler, int batchSize)
+{
+  printf ("Test #3: Sign %i updates in batches of %i\n", NO_REQUESTS,
+          batchSize);
+  UC_UpdateData*     update  = malloc(NO_REQUESTS * sizeof(UC_UpdateData));
+  BGPSecSignRequest* request = malloc(NO_REQUESTS * sizeof(BGPSecSignRequest));
+  struct timespec    start, end;
+  int idx;
+  int created = 0;
+
+  memset(request, 0, NO_REQUESTS * sizeof(BGPSecSignRequest));
+  for (idx = 0; idx < NO_REQUESTS; idx++)
+  {
+    _initUpdate(&update[idx], MY_ASN + (idx % NO_KEYS));
+    request[idx].update = &update[idx];
+    request[idx].peerAS = PEER_ASN + idx;
+    request[idx].pCount = 1;
+    request[idx].algoID = ALGO_ID;
+  }
+
+  _signCalls = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (idx = 0; idx < NO_REQUESTS; idx += batchSize)
+  {
+    created += createSignature(handler, batchSize, &request[idx]);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  assert_int(created, NO_REQUESTS, "Signatures created");
+  assert_int(_signCalls, NO_REQUESTS / batchSize, "Calls to sign");
+  for (idx = 0; idx < _signCalls; idx++)
+  {
+    assert_int(_callSize[idx], batchSize, "Updates per call to sign");
+  }
+  for (idx = 0; idx < NO_REQUESTS; idx++)
+  {
+    SCA_BGPSEC_SignatureSegment* sigSeg =
+                             (SCA_BGPSEC_SignatureSegment*)request[idx].segment;
+    MockSignature* sig = _mockSignature(request[idx].segment);
+    assert_int(sigSeg->ski[0], idx % NO_KEYS, "SKI of the signer");
+    assert_int(ntohl(sig->myASN), MY_ASN + (idx % NO_KEYS), "Signer AS");
+    assert_int(sig->call, (idx / batchSize) + 1, "Signed with its batch");
+    assert_int(sig->position, idx % batchSize, "Position within the batch");
+    free(request[idx].segment);
+  }
+
+  double sec = (end.tv_sec - start.tv_sec)
+               + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf ("         %i calls, %.0f signatures/s\n", _signCalls,
+          sec > 0 ? NO_REQUESTS / sec : 0);
+
+  free(update);
+  free(request);
+  printf ("         passed.\n");
+}
+
+/*
+ * Test the BGPsec signing
+ */
+int main(int argc, char** argv)
+{
+  BGPSecHandler handler;
+  _initialize(&handler);
+  _test1(&handler);
+  _test2(&handler);
+  _test3(&handler, 1);
+  _test3(&handler, BATCH_SIZE);
+  releaseBGPSecHandler(&handler);
+
+  return (EXIT_SUCCESS);
+}
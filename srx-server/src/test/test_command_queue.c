@@ -0,0 +1,295 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ *
+ * This files is used for testing the lanes of the command queue.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "server/command_queue.h"
+
+/** The number of commands of a client loading its table. */
+#define NO_BULK_COMMANDS 10000
+/** The number of commands of a live client. */
+#define NO_LIVE_COMMANDS 10
+
+/** Used as the clients of the commands. */
+static int _clients[3];
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Queue a number of commands for the given client. The data ID of the 
+ * commands counts up from the given first ID.
+ *
+ * @param queue The command queue
+ * @param client The client
+ * @param firstID The data ID of the first command
+ * @param count The number of commands
+ * @param length The length of the data of each command
+ */
+static void _queue(CommandQueue* queue, int client, int firstID, int count,
+                   uint32_t length)
+{
+  uint8_t data[1024];
+  int idx;
+
+  memset(data, client, sizeof(data));
+  for (idx = 0; idx < count; idx++)
+  {
+    assert_int(queueCommand(queue, COMMAND_TYPE_SRX_PROXY, NULL, 
+                            &_clients[client], firstID + idx, length, data),
+               true, "Queue command");
+  }
+}
+
+/**
+ * Fetch the next command and return the client it belongs to. The data ID of
+ * the command must follow the one fetched before for this client.
+ *
+ * @param queue The command queue
+ * @param nextID The data ID expected next per client.
+ * @param length (out) The length of the command, can be NULL.
+ *
+ * @return the client.
+ */
+static int _fetch(CommandQueue* queue, int* nextID, uint32_t* length)
+{
+  CommandQueueItem* item = fetchNextCommand(queue);
+  int client = (int*)item->client - _clients;
+
+  assert_int(item->dataID, nextID[client]++, "Order of the client");
+  if (length != NULL)
+  {
+    *length = item->dataLength;
+  }
+  deleteCommand(queue, item);
+
+  return client;
+}
+
+/**
+ * Commands of live clients are fetched in the order they were queued.
+ */
+static void _test1()
+{
+  CommandQueue      queue;
+  CommandQueueStats stats;
+  int nextID[3] = { 0, 0, 0 };
+  int idx;
+
+  printf ("Test #1: Live clients are served in order\n");
+  memset(&queue, 0, sizeof(CommandQueue));
+  initializeCommandQueue(&queue);
+  for (idx = 0; idx < NO_LIVE_COMMANDS; idx++)
+  {
+    _queue(&queue, idx % 3, idx / 3, 1, 64);
+  }
+  for (idx = 0; idx < NO_LIVE_COMMANDS; idx++)
+  {
+    assert_int(_fetch(&queue, nextID, NULL), idx % 3, "Client of the command");
+  }
+  getCommandQueueStats(&queue, &stats);
+  assert_int(stats.prioFetched, NO_LIVE_COMMANDS, "Priority lane commands");
+  assert_int(stats.bulkFetched, 0, "Bulk lane commands");
+  assert_int(getTotalQueueSize(&queue), 0, "Queue is empty");
+  releaseCommandQueue(&queue);
+  printf ("         passed.\n");
+}
+
+/**
+ * A client that loads its table does not delay the commands of a live client.
+ */
+static void _test2()
+{
+  CommandQueue      queue;
+  CommandQueueStats stats;
+  int nextID[3] = { 0, 0, 0 };
+  int fetched = 0;
+  int live    = 0;
+
+  printf ("Test #2: A table load does not starve a live client\n");
+  memset(&queue, 0, sizeof(CommandQueue));
+  initializeCommandQueue(&queue);
+  _queue(&queue, 0, 0, NO_BULK_COMMANDS, 512);
+  _queue(&queue, 1, 0, NO_LIVE_COMMANDS, 64);
+
+  getCommandQueueStats(&queue, &stats);
+  assert_int(stats.prioDepth, CMD_QUEUE_PRIORITY_LIMIT + NO_LIVE_COMMANDS,
+             "Priority lane depth");
+  assert_int(stats.bulkDepth, NO_BULK_COMMANDS - CMD_QUEUE_PRIORITY_LIMIT,
+             "Bulk lane depth");
+  assert_int(stats.bulkClients, 1, "Clients in the bulk lane");
+
+  while (live < NO_LIVE_COMMANDS)
+  {
+    live += _fetch(&queue, nextID, NULL);
+    fetched++;
+  }
+  // Only the commands queued before the bulk lane was used are fetched 
+  // before, plus one of the bulk lane per priority burst.
+  assert_int(fetched <= CMD_QUEUE_PRIORITY_LIMIT + NO_LIVE_COMMANDS 
+                        + (CMD_QUEUE_PRIORITY_LIMIT + NO_LIVE_COMMANDS) 
+                          / CMD_QUEUE_PRIORITY_BURST, true,
+             "Commands fetched until the live client was served");
+
+  // New live commands are served before the remaining table load.
+  _queue(&queue, 1, NO_LIVE_COMMANDS, NO_LIVE_COMMANDS, 64);
+  for (live = 0; live < NO_LIVE_COMMANDS; live++)
+  {
+    assert_int(_fetch(&queue, nextID, NULL), 1, "Live client first");
+  }
+  while (getUnprocessedQueueSize(&queue) > 0)
+  {
+    assert_int(_fetch(&queue, nextID, NULL), 0, "Table load");
+  }
+  assert_int(nextID[0], NO_BULK_COMMANDS, "All commands of the table load");
+
+  // The client caught up, its commands are live again.
+  _queue(&queue, 0, NO_BULK_COMMANDS, 1, 512);
+  getCommandQueueStats(&queue, &stats);
+  assert_int(stats.prioDepth, 1, "Caught up client is live");
+  _fetch(&queue, nextID, NULL);
+  releaseCommandQueue(&queue);
+  printf ("         passed.\n");
+}
+
+/**
+ * Two clients loading their tables share the bulk lane by the bytes of their 
+ * commands, a live client gets a share while the priority lane is busy.
+ */
+static void _test3()
+{
+  CommandQueue queue;
+  int      nextID[3] = { 0, 0, 0 };
+  uint64_t bytes[3]  = { 0, 0, 0 };
+  int      count[3]  = { 0, 0, 0 };
+  uint32_t length;
+  int idx, client;
+
+  printf ("Test #3: Deficit round robin between table loads\n");
+  memset(&queue, 0, sizeof(CommandQueue));
+  initializeCommandQueue(&queue);
+  _queue(&queue, 0, 0, NO_BULK_COMMANDS, 1000);
+  _queue(&queue, 1, 0, NO_BULK_COMMANDS, 250);
+  // Fetch the commands of the priority lane
+  for (idx = 0; idx < 2 * CMD_QUEUE_PRIORITY_LIMIT; idx++)
+  {
+    _fetch(&queue, nextID, NULL);
+  }
+  for (idx = 0; idx < 2000; idx++)
+  {
+    client = _fetch(&queue, nextID, &length);
+    bytes[client] += length;
+    count[client]++;
+  }
+  assert_int(bytes[0] > bytes[1] * 9 / 10 && bytes[0] < bytes[1] * 11 / 10, 
+             true, "Bytes served per client");
+
+  // A live client that floods the priority lane keeps the bulk lane going.
+  memset(count, 0, sizeof(count));
+  _queue(&queue, 2, 0, CMD_QUEUE_PRIORITY_LIMIT, 64);
+  for (idx = 0; idx < CMD_QUEUE_PRIORITY_LIMIT; idx++)
+  {
+    count[_fetch(&queue, nextID, NULL)]++;
+  }
+  assert_int(count[0] + count[1] >= CMD_QUEUE_PRIORITY_LIMIT 
+                                     / (CMD_QUEUE_PRIORITY_BURST + 1), 
+             true, "Bulk lane is served");
+  assert_int(count[2] >= CMD_QUEUE_PRIORITY_LIMIT 
+                         - CMD_QUEUE_PRIORITY_LIMIT / CMD_QUEUE_PRIORITY_BURST,
+             true, "Priority lane is served first");
+  releaseCommandQueue(&queue);
+  printf ("         passed.\n");
+}
+
+/**
+ * Removing all commands empties both lanes.
+ */
+static void _test4()
+{
+  CommandQueue      queue;
+  CommandQueueStats stats;
+  CommandQueueItem* item;
+  int nextID[3] = { 0, 0, 0 };
+
+  printf ("Test #4: Remove all commands\n");
+  memset(&queue, 0, sizeof(CommandQueue));
+  initializeCommandQueue(&queue);
+  _queue(&queue, 0, 0, 1000, 100);
+  _queue(&queue, 1, 0, 10, 100);
+  item = fetchNextCommand(&queue);
+  removeAllCommands(&queue);
+  getCommandQueueStats(&queue, &stats);
+  assert_int(stats.prioDepth + stats.bulkDepth, 0, "Lanes are empty");
+  assert_int(getUnprocessedQueueSize(&queue), 0, "No unprocessed commands");
+  assert_int(getTotalQueueSize(&queue), 1, "The fetched command remains");
+  deleteCommand(&queue, item);
+
+  // The shutdown is queued without a client.
+  queueCommand(&queue, COMMAND_TYPE_SHUTDOWN, NULL, NULL, 0, 0, NULL);
+  _queue(&queue, 1, 0, 1, 100);
+  item = fetchNextCommand(&queue);
+  assert_int(item->cmdType, COMMAND_TYPE_SHUTDOWN, "Shutdown command");
+  deleteCommand(&queue, item);
+  _fetch(&queue, nextID, NULL);
+
+  // The revalidation of the RPKI handler is queued without a client as well.
+  assert_int(queueCommand(&queue, COMMAND_TYPE_REVALIDATE, NULL, NULL, 7, 0, 
+                          NULL), true, "Queue revalidation");
+  item = fetchNextCommand(&queue);
+  assert_int(item->cmdType, COMMAND_TYPE_REVALIDATE, "Revalidation command");
+  assert_int(item->dataID, 7, "Update of the revalidation");
+  assert_int(item->client == NULL, true, "Revalidation without client");
+  deleteCommand(&queue, item);
+  assert_int(getTotalQueueSize(&queue), 0, "Queue is empty");
+  releaseCommandQueue(&queue);
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  _test1();
+  _test2();
+  _test3();
+  _test4();
+
+  return (EXIT_SUCCESS);
+}
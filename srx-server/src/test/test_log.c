@@ -0,0 +1,271 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the LOG macros. The last test compares the
+ * cost of a log statement of a disabled level before and after the level is
+ * tested by the macro.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "util/log.h"
+
+#define NO_THREADS     4
+#define NO_MESSAGES    100000
+#define NO_STATEMENTS  10000000
+
+/** The log statement as it was expanded before the level was tested. */
+#define UNGUARDED_LOG(LEVEL, FMT, ...) \
+  writeLog(LEVEL, "[%s] " FMT, logTimeStamp(), ## __VA_ARGS__)
+
+/** The number of times _argument was called. */
+static int  _evaluated = 0;
+/** The messages written by _countMessage. */
+static int  _written   = 0;
+/** The last message written. */
+static char _lastMessage[256];
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(long long val, long long expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %lld but received %lld\n", error, expected,
+            val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Return the current time in seconds.
+ *
+ * @return the time of the monotonic clock
+ */
+static double _now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Count the evaluation of a log argument.
+ *
+ * @return the number of evaluations.
+ */
+static int _argument()
+{
+  return ++_evaluated;
+}
+
+/**
+ * Log callback that counts the messages and keeps the last one.
+ *
+ * @param level The log level
+ * @param fmt The format string
+ * @param args The arguments
+ */
+static void _countMessage(LogLevel level, const char* fmt, va_list args)
+{
+  __atomic_fetch_add(&_written, 1, __ATOMIC_RELAXED);
+  vsnprintf(_lastMessage, sizeof(_lastMessage), fmt, args);
+}
+
+/**
+ * Test that the arguments are only evaluated if the level is written.
+ */
+static void _test1()
+{
+  printf ("Test #1: Arguments of disabled levels\n");
+  LOG(LEVEL_ERROR, "No log method %d", _argument());
+  assert_int(_evaluated, 0, "Evaluated without log method");
+
+  setLogMethodToCallback(_countMessage);
+  setLogLevel(LEVEL_NOTICE);
+  assert_int(LOG_ENABLED(LEVEL_NOTICE), true, "NOTICE enabled");
+  assert_int(LOG_ENABLED(LEVEL_INFO), false, "INFO disabled");
+  LOG(LEVEL_INFO, "Disabled level %d", _argument());
+  assert_int(_evaluated, 0, "Evaluated for a disabled level");
+  assert_int(_written, 0, "Written for a disabled level");
+  LOG(LEVEL_WARNING, "Enabled level %d", _argument());
+  assert_int(_evaluated, 1, "Evaluated for an enabled level");
+  assert_int(_written, 1, "Written for an enabled level");
+  assert_int(strstr(_lastMessage, "Enabled level 1") != NULL, true,
+             "Message written");
+
+  // The statement needs no braces around it.
+  if (_evaluated == 0)
+    LOG(LEVEL_ERROR, "Not written");
+  else
+    LOG(LEVEL_ERROR, "Written");
+  assert_int(strstr(_lastMessage, "] Written") != NULL, true, "If else");
+
+  setLogLevel(LEVEL_DEBUG);
+  LOG(LEVEL_DEBUG, "Level raised %d", _argument());
+  assert_int(_evaluated, 2, "Evaluated after the level is raised");
+  setLogMethodToCallback(NULL);
+  assert_int(LOG_ENABLED(LEVEL_ERROR), false, "Log method removed");
+
+  printf ("         passed.\n");
+}
+
+/**
+ * Write a rate limited message for each packet.
+ *
+ * @param arg Not used.
+ *
+ * @return NULL
+ */
+static void* _logPackets(void* arg)
+{
+  int idx;
+
+  for (idx = 0; idx < NO_MESSAGES; idx++)
+  {
+    LOG_RATE_LIMITED(LEVEL_WARNING, 60, "Packet %d dropped", idx);
+  }
+
+  return NULL;
+}
+
+/**
+ * Write a burst of rate limited messages from the same statement.
+ *
+ * @param count The number of messages.
+ */
+static void _logBurst(int count)
+{
+  int idx;
+
+  for (idx = 0; idx < count; idx++)
+  {
+    LOG_RATE_LIMITED(LEVEL_WARNING, 1, "Burst message %d", idx);
+  }
+}
+
+/**
+ * Test the rate limit with multiple threads.
+ */
+static void _test2()
+{
+  pthread_t    threads[NO_THREADS];
+  LogRateLimit limit = { 0, 0 };
+  uint32_t     suppressed;
+  int          idx;
+
+  printf ("Test #2: Rate limit while %u threads log %u messages\n", NO_THREADS,
+          NO_MESSAGES);
+  assert_int(logRateLimit(&limit, 60, &suppressed), true, "First message");
+  assert_int(suppressed, 0, "Nothing suppressed before the first message");
+  assert_int(logRateLimit(&limit, 60, &suppressed), false, "Within interval");
+  assert_int(logRateLimit(&limit, 60, &suppressed), false, "Within interval");
+  // Start the next interval right away.
+  limit.nextTime = 0;
+  assert_int(logRateLimit(&limit, 60, &suppressed), true, "Next interval");
+  assert_int(suppressed, 2, "Messages suppressed");
+
+  _written = 0;
+  setLogMethodToCallback(_countMessage);
+  setLogLevel(LEVEL_WARNING);
+  for (idx = 0; idx < NO_THREADS; idx++)
+  {
+    pthread_create(&threads[idx], NULL, _logPackets, NULL);
+  }
+  for (idx = 0; idx < NO_THREADS; idx++)
+  {
+    pthread_join(threads[idx], NULL);
+  }
+  assert_int(_written, 1, "Messages written within the interval");
+  assert_int(strstr(_lastMessage, "similar messages") == NULL, true,
+             "First message has no suppressed count");
+
+  // The next message after the interval reports the suppressed ones.
+  _logBurst(5);
+  usleep(1100000);
+  _logBurst(1);
+  assert_int(_written, 3, "Messages written by the burst");
+  assert_int(strstr(_lastMessage, "Burst message 0 (4 similar messages "
+                                  "suppressed)") != NULL, true,
+             "Suppressed messages reported");
+  setLogMethodToCallback(NULL);
+
+  printf ("         passed.\n");
+}
+
+/**
+ * Compare the cost of log statements of a disabled level.
+ */
+static void _test3()
+{
+  double start;
+  double unguarded;
+  double guarded;
+  int    idx;
+
+  printf ("Test #3: %u log statements of a disabled level\n", NO_STATEMENTS);
+  setLogMethodToCallback(_countMessage);
+  setLogLevel(LEVEL_NOTICE);
+  _written = 0;
+
+  start = _now();
+  for (idx = 0; idx < NO_STATEMENTS; idx++)
+  {
+    UNGUARDED_LOG(LEVEL_DEBUG, "[db] providerAsns[%d]: %d", idx, idx);
+  }
+  unguarded = _now() - start;
+
+  start = _now();
+  for (idx = 0; idx < NO_STATEMENTS; idx++)
+  {
+    LOG(LEVEL_DEBUG, "[db] providerAsns[%d]: %d", idx, idx);
+  }
+  guarded = _now() - start;
+  assert_int(_written, 0, "Messages written");
+  setLogMethodToCallback(NULL);
+
+  printf ("         level not tested : %8.3f s  %7.1f ns/statement\n",
+          unguarded, unguarded * 1e9 / NO_STATEMENTS);
+  printf ("         level tested     : %8.3f s  %7.1f ns/statement\n",
+          guarded, guarded * 1e9 / NO_STATEMENTS);
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  _test1();
+  _test2();
+  _test3();
+
+  return (EXIT_SUCCESS);
+}
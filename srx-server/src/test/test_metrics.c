@@ -0,0 +1,354 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the metrics. The second test scrapes the
+ * metrics endpoint while multiple threads replay the packets of proxy
+ * clients and the PDUs of a validation cache.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server/metrics.h"
+
+#define NO_CLIENTS     4
+#define NO_PACKETS     50000
+#define MAX_RESPONSE   (1024 * 1024)
+
+/** The unix domain socket used by the tests. */
+static char _socketPath[64];
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(long long val, long long expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %lld but received %lld\n", error, expected,
+            val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Return the value of the given sample.
+ *
+ * @param text The metrics.
+ * @param sample The sample name including the labels.
+ *
+ * @return the value or -1 if the sample is not found.
+ */
+static long long _value(const char* text, const char* sample)
+{
+  const char* line = text;
+  size_t      len  = strlen(sample);
+
+  while (line != NULL)
+  {
+    if ((strncmp(line, sample, len) == 0) && (line[len] == ' '))
+    {
+      return strtoll(line + len + 1, NULL, 10);
+    }
+    line = strchr(line, '\n');
+    if (line != NULL)
+    {
+      line++;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * Send the request to the metrics socket and return the response.
+ *
+ * @param request The HTTP request.
+ *
+ * @return the response which must be freed.
+ */
+static char* _scrape(const char* request)
+{
+  struct sockaddr_un addr;
+  char*              response = malloc(MAX_RESPONSE + 1);
+  size_t             length   = 0;
+  ssize_t            bytes;
+  int                fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  memset(&addr, 0, sizeof(struct sockaddr_un));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, _socketPath);
+  assert_int(connect(fd, (struct sockaddr*)&addr, sizeof(addr)), 0,
+             "Connect to the metrics socket");
+  assert_int(send(fd, request, strlen(request), 0), strlen(request),
+             "Send the request");
+  while ((bytes = recv(fd, response + length, MAX_RESPONSE - length, 0)) > 0)
+  {
+    length += bytes;
+  }
+  response[length] = '\0';
+  close(fd);
+
+  return response;
+}
+
+/**
+ * Test the buckets of the histograms and the format of the metrics.
+ */
+static void _test1()
+{
+  size_t   length;
+  char*    text;
+  uint64_t start;
+
+  printf ("Test #1: Histogram buckets\n");
+  assert_int(metricsNow(), 0, "Time before the metrics are enabled");
+  recordMetric(MET_STAGE_ORIGIN, MET_NO_CLIENT, 1);
+  initMetrics();
+
+  // 5 us are counted from the bucket of 8.192 us on.
+  start = metricsNow();
+  recordMetric(MET_STAGE_ORIGIN, MET_NO_CLIENT, start - 5000);
+  // 2 ms
+  start = metricsNow();
+  recordMetric(MET_STAGE_ORIGIN, MET_NO_CLIENT, start - 2000000);
+  // Larger than the histogram, only counted in +Inf.
+  start = metricsNow();
+  recordMetric(MET_STAGE_ORIGIN, MET_NO_CLIENT, start - 100000000000ULL);
+  countRTRPdu(4);
+  countRTRPdu(200);
+
+  text = renderMetrics(&length);
+  assert_int(text != NULL, true, "Render the metrics");
+  assert_int(strlen(text), length, "Length of the metrics");
+  assert_int(_value(text, "srx_stage_latency_seconds_bucket{stage=\"origin\","
+                          "le=\"4.096e-06\"}"), 0, "Bucket below 5 us");
+  assert_int(_value(text, "srx_stage_latency_seconds_bucket{stage=\"origin\","
+                          "le=\"8.192e-06\"}"), 1, "Bucket of 5 us");
+  assert_int(_value(text, "srx_stage_latency_seconds_bucket{stage=\"origin\","
+                          "le=\"0.002097152\"}"), 2, "Bucket of 2 ms");
+  assert_int(_value(text, "srx_stage_latency_seconds_bucket{stage=\"origin\","
+                          "le=\"68.7194767\"}"), 2, "Last bucket");
+  assert_int(_value(text, "srx_stage_latency_seconds_bucket{stage=\"origin\","
+                          "le=\"+Inf\"}"), 3, "Bucket +Inf");
+  assert_int(_value(text, "srx_stage_latency_seconds_count{stage=\"origin\"}"),
+             3, "Count");
+  assert_int(_value(text, "srx_stage_latency_seconds_count{stage=\"aspa\"}"),
+             0, "Count of a stage without values");
+  assert_int(_value(text, "srx_rtr_pdus_received_total{type=\"ipv4_prefix\"}"),
+             1, "IPv4 prefix PDUs");
+  assert_int(_value(text, "srx_rtr_pdus_received_total{type=\"unknown\"}"),
+             1, "Unknown PDUs");
+  assert_int(strstr(text, "client=") == NULL, true, "No clients yet");
+  free(text);
+  releaseMetrics();
+
+  printf ("         passed.\n");
+}
+
+/**
+ * Replay the packets of one proxy client: each packet is received, queued,
+ * validated and the result is send back. Each client also replays the PDUs
+ * of a validation cache.
+ *
+ * @param arg The client ID
+ *
+ * @return NULL
+ */
+static void* _replay(void* arg)
+{
+  uint8_t  clientID = (uint8_t)(uintptr_t)arg;
+  uint64_t start;
+  int      idx;
+
+  for (idx = 0; idx < NO_PACKETS; idx++)
+  {
+    start = metricsNow();
+    countClientPacket(clientID, 100, (idx % 2) == 0);
+    recordMetric(MET_STAGE_RECEIVE, clientID, start);
+    recordMetric(MET_STAGE_QUEUE_WAIT, clientID, start);
+    start = metricsNow();
+    recordMetric(MET_STAGE_ORIGIN, MET_NO_CLIENT, start);
+    countClientResult(clientID);
+
+    start = metricsNow();
+    countRTRPdu(idx % 8 == 7 ? 7 : 4);
+    recordMetric(MET_STAGE_RTR_PDU, MET_NO_CLIENT, start);
+  }
+
+  return NULL;
+}
+
+/**
+ * Scrape the metrics while the replay runs.
+ */
+static void _test2()
+{
+  pthread_t  threads[NO_CLIENTS];
+  long long  last     = 0;
+  long long  value;
+  int        scrapes  = 0;
+  int        idx;
+  char*      response;
+  char*      body;
+  char       sample[128];
+
+  printf ("Test #2: Scrape while %u clients replay %u packets each\n",
+          NO_CLIENTS, NO_PACKETS);
+  snprintf(_socketPath, sizeof(_socketPath), "/tmp/test_metrics.%d",
+           getpid());
+  initMetrics();
+  assert_int(startMetricsListener(0, _socketPath), true, "Start listener");
+  assert_int(startMetricsListener(0, _socketPath), false, "Start it again");
+
+  for (idx = 0; idx < NO_CLIENTS; idx++)
+  {
+    pthread_create(&threads[idx], NULL, _replay, (void*)(uintptr_t)(idx + 1));
+  }
+
+  // The counts never decrease and the buckets are cumulative in each scrape.
+  do
+  {
+    response = _scrape("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    assert_int(strncmp(response, "HTTP/1.0 200 OK\r\n", 17), 0, "Status");
+    body = strstr(response, "\r\n\r\n");
+    assert_int(body != NULL, true, "End of the header");
+    value = _value(body + 4, "srx_stage_latency_seconds_count"
+                             "{stage=\"receive\"}");
+    assert_int(value >= last, true, "Count does not decrease");
+    assert_int(_value(body + 4, "srx_stage_latency_seconds_bucket"
+                                "{stage=\"receive\",le=\"+Inf\"}"), value,
+               "Bucket +Inf and count");
+    assert_int(   _value(body + 4, "srx_stage_latency_seconds_bucket"
+                                   "{stage=\"receive\",le=\"1.024e-06\"}")
+               <= value, true, "Buckets are cumulative");
+    last = value;
+    scrapes++;
+    free(response);
+  } while (last < NO_CLIENTS * NO_PACKETS);
+
+  for (idx = 0; idx < NO_CLIENTS; idx++)
+  {
+    pthread_join(threads[idx], NULL);
+  }
+
+  response = _scrape("GET / HTTP/1.0\r\n\r\n");
+  body = strstr(response, "\r\n\r\n") + 4;
+  for (idx = 1; idx <= NO_CLIENTS; idx++)
+  {
+    snprintf(sample, sizeof(sample),
+             "srx_client_packets_received_total{client=\"%u\"}", idx);
+    assert_int(_value(body, sample), NO_PACKETS, "Packets of the client");
+    snprintf(sample, sizeof(sample),
+             "srx_client_bytes_received_total{client=\"%u\"}", idx);
+    assert_int(_value(body, sample), NO_PACKETS * 100, "Bytes of the client");
+    snprintf(sample, sizeof(sample),
+             "srx_client_requests_total{client=\"%u\"}", idx);
+    assert_int(_value(body, sample), NO_PACKETS / 2, "Requests");
+    snprintf(sample, sizeof(sample),
+             "srx_client_results_sent_total{client=\"%u\"}", idx);
+    assert_int(_value(body, sample), NO_PACKETS, "Results of the client");
+    snprintf(sample, sizeof(sample), "srx_client_stage_latency_seconds_count"
+             "{client=\"%u\",stage=\"queue_wait\"}", idx);
+    assert_int(_value(body, sample), NO_PACKETS, "Queue wait of the client");
+  }
+  assert_int(_value(body, "srx_stage_latency_seconds_count{stage=\"origin\"}"),
+             NO_CLIENTS * NO_PACKETS, "Origin validations");
+  assert_int(_value(body, "srx_rtr_pdus_received_total{type=\"end_of_data\"}"),
+             NO_CLIENTS * NO_PACKETS / 8, "End of data PDUs");
+  assert_int(_value(body, "srx_stage_latency_seconds_count{stage=\"rtr_pdu\"}"),
+             NO_CLIENTS * NO_PACKETS, "RTR PDUs");
+  free(response);
+
+  response = _scrape("GET /other HTTP/1.0\r\n\r\n");
+  assert_int(strncmp(response, "HTTP/1.0 404", 12), 0, "Unknown path");
+  free(response);
+  response = _scrape("POST /metrics HTTP/1.0\r\n\r\n");
+  assert_int(strncmp(response, "HTTP/1.0 405", 12), 0, "Unknown method");
+  free(response);
+
+  releaseMetrics();
+  assert_int(access(_socketPath, F_OK), -1, "Socket removed");
+
+  printf ("         %u scrapes during the replay.\n", scrapes);
+  printf ("         passed.\n");
+}
+
+/**
+ * Test the latency from a router key registration to the first BGPsec 
+ * validation.
+ */
+static void _test3()
+{
+  uint64_t start;
+  char*    text;
+  size_t   length;
+
+  printf ("Test #3: First validation after a key registration\n");
+  initMetrics();
+  // Without a registration nothing is measured.
+  recordMetric(MET_STAGE_BGPSEC, MET_NO_CLIENT, metricsNow());
+  markKeyRegistration();
+  start = metricsNow();
+  recordMetric(MET_STAGE_KEY_REGISTER, MET_NO_CLIENT, start - 3000000);
+  recordMetric(MET_STAGE_ORIGIN, MET_NO_CLIENT, start);
+  usleep(2000);
+  recordMetric(MET_STAGE_BGPSEC, MET_NO_CLIENT, metricsNow());
+  recordMetric(MET_STAGE_BGPSEC, MET_NO_CLIENT, metricsNow());
+
+  text = renderMetrics(&length);
+  assert_int(text != NULL, true, "Render the metrics");
+  assert_int(_value(text, "srx_stage_latency_seconds_count{stage=\"bgpsec\"}"),
+             3, "BGPsec validations");
+  assert_int(_value(text, "srx_stage_latency_seconds_count{stage="
+                          "\"key_register\"}"), 1, "Key registrations");
+  assert_int(_value(text, "srx_stage_latency_seconds_count{stage="
+                          "\"key_first_validation\"}"), 1, 
+             "Only the first validation is measured");
+  assert_int(_value(text, "srx_stage_latency_seconds_bucket{stage="
+                          "\"key_first_validation\",le=\"0.001048576\"}"), 
+             0, "The first validation waited for 2 ms");
+  free(text);
+  releaseMetrics();
+
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  _test1();
+  _test2();
+  _test3();
+
+  return (EXIT_SUCCESS);
+}
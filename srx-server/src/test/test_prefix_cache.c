@@ -0,0 +1,290 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ *
+ * This files is used for testing the origin validation of the prefix cache.
+ * IPv4 and IPv6 prefixes with the same bits must not cover each other.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "server/aspath_cache.h"
+#include "server/prefix_cache.h"
+#include "server/rpki_queue.h"
+#include "server/ski_cache.h"
+#include "server/update_cache.h"
+#include "util/log.h"
+
+/** An AS that is not reserved for documentation (rfc5398). */
+#define TEST_AS       100
+/** Another AS that is not reserved for documentation. */
+#define TEST_OTHER_AS 200
+
+/** The configuration used by the update cache. */
+static Configuration _config;
+
+// The accessors of main.c. The updates are stored without AS path ID and the
+// ROA changes are not suppressed, the caches and the queue are not needed.
+SKI_CACHE* getSKICache()
+{
+  return NULL;
+}
+RPKI_QUEUE* getRPKIQueue()
+{
+  return NULL;
+}
+AspathCache* getAspathCache()
+{
+  return NULL;
+}
+// Part of rpki_router_client.c, only used by the command handler thread.
+void generalSignalProcess(void)
+{
+}
+
+/**
+ * Called by the update cache for each changed validation result. There are no
+ * clients to notify.
+ *
+ * @param result The changed result
+ */
+static void _resultChanged(SRxValidationResult* result)
+{
+}
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Fill the prefix with the given first two bytes followed by zeros.
+ *
+ * @param prefix The prefix to be filled.
+ * @param version 4 or 6
+ * @param byte0 The first byte of the address.
+ * @param byte1 The second byte of the address.
+ * @param length The prefix length.
+ *
+ * @return the prefix.
+ */
+static IPPrefix* _prefix(IPPrefix* prefix, uint8_t version, uint8_t byte0,
+                         uint8_t byte1, uint8_t length)
+{
+  memset(prefix, 0, sizeof(IPPrefix));
+  prefix->ip.version = version;
+  prefix->length     = length;
+  if (version == 4)
+  {
+    prefix->ip.addr.v4.u8[0] = byte0;
+    prefix->ip.addr.v4.u8[1] = byte1;
+  }
+  else
+  {
+    prefix->ip.addr.v6.u8[0] = byte0;
+    prefix->ip.addr.v6.u8[1] = byte1;
+  }
+
+  return prefix;
+}
+
+/**
+ * Store the update in the update cache and request its origin validation.
+ *
+ * @param updateCache The update cache.
+ * @param prefixCache The prefix cache.
+ * @param updateID The ID of the update.
+ * @param prefix The prefix of the update.
+ * @param originAS The origin AS of the update.
+ */
+static void _validate(UpdateCache* updateCache, PrefixCache* prefixCache,
+                      SRxUpdateID updateID, IPPrefix* prefix, uint32_t originAS)
+{
+  BGPSecData bgpData;
+  uint32_t   asPath = htonl(originAS);
+
+  memset(&bgpData, 0, sizeof(BGPSecData));
+  bgpData.afi        = htons(prefix->ip.version == 4 ? AFI_IP : AFI_IP6);
+  bgpData.numberHops = 1;
+  bgpData.asPath     = &asPath;
+  assert_int(storeUpdate(updateCache, 0, NULL, &updateID, prefix, originAS,
+                         NULL, &bgpData, 0), 1, "Store the update");
+  assert_int(requestUpdateValidation(prefixCache, &updateID, prefix,
+                                     originAS), true, "Validate the update");
+}
+
+/**
+ * Return the origin validation result of the update.
+ *
+ * @param updateCache The update cache.
+ * @param updateID The ID of the update.
+ *
+ * @return The ROA result.
+ */
+static int _roaResult(UpdateCache* updateCache, SRxUpdateID updateID)
+{
+  SRxResult        srxRes;
+  SRxDefaultResult defRes;
+  uint32_t         pathID;
+
+  assert_int(getUpdateResult(updateCache, &updateID, 0, NULL, &srxRes, &defRes,
+                             &pathID), true, "Update is stored");
+  return srxRes.roaResult;
+}
+
+/**
+ * An IPv4 update is not covered by an IPv6 ROA with the same bits,
+ * independent of the order ROAs and updates are received.
+ */
+static void _test1()
+{
+  UpdateCache updateCache;
+  PrefixCache prefixCache;
+  IPPrefix    roa, roaV4, update;
+
+  printf ("Test #1: An IPv6 ROA does not cover an IPv4 update\n");
+  memset(&_config, 0, sizeof(Configuration));
+  _config.defaultKeepWindow = 900;
+  assert_int(createUpdateCache(&updateCache, _resultChanged, 1, &_config),
+             true, "Create the update cache");
+  assert_int(initializePrefixCache(&prefixCache, &updateCache), true,
+             "Create the prefix cache");
+
+  // 0a00::/8-24 has the bits of 10.0.0.0/8
+  _prefix(&roa, 6, 10, 0, 8);
+  addROAwl(&prefixCache, TEST_AS, &roa, 24, 0, 1, PC_DONT_SUPPRESS);
+
+  _validate(&updateCache, &prefixCache, 1, _prefix(&update, 4, 10, 1, 16),
+            TEST_AS);
+  assert_int(_roaResult(&updateCache, 1), SRx_RESULT_NOTFOUND,
+             "IPv4 update below the IPv6 ROA");
+  _validate(&updateCache, &prefixCache, 2, _prefix(&update, 4, 10, 0, 8),
+            TEST_AS);
+  assert_int(_roaResult(&updateCache, 2), SRx_RESULT_NOTFOUND,
+             "IPv4 update with the bits of the IPv6 ROA");
+  _validate(&updateCache, &prefixCache, 3, _prefix(&update, 6, 10, 1, 16),
+            TEST_AS);
+  assert_int(_roaResult(&updateCache, 3), SRx_RESULT_VALID,
+             "IPv6 update covered by the IPv6 ROA");
+  _validate(&updateCache, &prefixCache, 4, _prefix(&update, 6, 10, 1, 16),
+            TEST_OTHER_AS);
+  assert_int(_roaResult(&updateCache, 4), SRx_RESULT_INVALID,
+             "IPv6 update of another AS");
+
+  // A ROA added after the updates does not change the other family.
+  _prefix(&roa, 6, 10, 0, 12);
+  addROAwl(&prefixCache, TEST_OTHER_AS, &roa, 16, 0, 1, PC_DONT_SUPPRESS);
+  assert_int(_roaResult(&updateCache, 1), SRx_RESULT_NOTFOUND,
+             "IPv4 update after a new IPv6 ROA");
+  assert_int(_roaResult(&updateCache, 4), SRx_RESULT_VALID,
+             "IPv6 update after a new IPv6 ROA");
+
+  // An IPv4 ROA does not change the IPv6 updates.
+  _prefix(&roaV4, 4, 10, 0, 8);
+  addROAwl(&prefixCache, TEST_AS, &roaV4, 16, 0, 1, PC_DONT_SUPPRESS);
+  assert_int(_roaResult(&updateCache, 1), SRx_RESULT_VALID,
+             "IPv4 update covered by the IPv4 ROA");
+  assert_int(_roaResult(&updateCache, 2), SRx_RESULT_VALID,
+             "IPv4 update of the IPv4 ROA prefix");
+  assert_int(_roaResult(&updateCache, 3), SRx_RESULT_VALID,
+             "IPv6 update after the IPv4 ROA");
+
+  // Removing the IPv6 ROAs does not change the IPv4 updates.
+  _prefix(&roa, 6, 10, 0, 8);
+  delROAwl(&prefixCache, TEST_AS, &roa, 24, 0, 1, PC_DONT_SUPPRESS);
+  _prefix(&roa, 6, 10, 0, 12);
+  delROAwl(&prefixCache, TEST_OTHER_AS, &roa, 16, 0, 1, PC_DONT_SUPPRESS);
+  assert_int(_roaResult(&updateCache, 1), SRx_RESULT_VALID,
+             "IPv4 update after the IPv6 ROAs are removed");
+  assert_int(_roaResult(&updateCache, 3), SRx_RESULT_NOTFOUND,
+             "IPv6 update after the IPv6 ROAs are removed");
+  assert_int(_roaResult(&updateCache, 4), SRx_RESULT_NOTFOUND,
+             "IPv6 update of another AS after the IPv6 ROAs are removed");
+
+  delROAwl(&prefixCache, TEST_AS, &roaV4, 16, 0, 1, PC_DONT_SUPPRESS);
+  assert_int(_roaResult(&updateCache, 1), SRx_RESULT_NOTFOUND,
+             "IPv4 update after the IPv4 ROA is removed");
+  releasePrefixCache(&prefixCache);
+  releaseUpdateCache(&updateCache);
+  printf ("         passed.\n");
+}
+
+/**
+ * An IPv6 update is not covered by an IPv4 ROA with the same bits.
+ */
+static void _test2()
+{
+  UpdateCache updateCache;
+  PrefixCache prefixCache;
+  IPPrefix    roa, update;
+
+  printf ("Test #2: An IPv4 ROA does not cover an IPv6 update\n");
+  memset(&_config, 0, sizeof(Configuration));
+  _config.defaultKeepWindow = 900;
+  assert_int(createUpdateCache(&updateCache, _resultChanged, 1, &_config),
+             true, "Create the update cache");
+  assert_int(initializePrefixCache(&prefixCache, &updateCache), true,
+             "Create the prefix cache");
+
+  // The updates are known before the ROA.
+  _validate(&updateCache, &prefixCache, 1, _prefix(&update, 6, 10, 0, 8),
+            TEST_AS);
+  _validate(&updateCache, &prefixCache, 2, _prefix(&update, 6, 10, 1, 16),
+            TEST_OTHER_AS);
+  _validate(&updateCache, &prefixCache, 3, _prefix(&update, 4, 10, 1, 16),
+            TEST_OTHER_AS);
+  _prefix(&roa, 4, 10, 0, 8);
+  addROAwl(&prefixCache, TEST_AS, &roa, 24, 0, 1, PC_DONT_SUPPRESS);
+  assert_int(_roaResult(&updateCache, 1), SRx_RESULT_NOTFOUND,
+             "IPv6 update with the bits of the IPv4 ROA");
+  assert_int(_roaResult(&updateCache, 2), SRx_RESULT_NOTFOUND,
+             "IPv6 update below the IPv4 ROA");
+  assert_int(_roaResult(&updateCache, 3), SRx_RESULT_INVALID,
+             "IPv4 update of another AS");
+  releasePrefixCache(&prefixCache);
+  releaseUpdateCache(&updateCache);
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  setLogLevel(LEVEL_ERROR);
+  _test1();
+  _test2();
+
+  return (EXIT_SUCCESS);
+}
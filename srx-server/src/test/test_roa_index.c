@@ -0,0 +1,295 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the ROA index against a linear search.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "server/roa_index.h"
+
+#define NO_ROAS     4000
+#define NO_LOOKUPS  5000
+
+/** A ROA of the test and whether it is in the index. */
+typedef struct {
+  IPPrefix prefix;
+  uint32_t asn;
+  uint8_t  maxLen;
+  bool     added;
+} TestROA;
+
+/** The ROAs reported by a lookup. */
+typedef struct {
+  int      count;
+  uint32_t lastLength;
+  bool     ordered;
+  bool     found[NO_ROAS];
+} TestMatch;
+
+/** State of the pseudo random generator, fixed to repeat the experiment. */
+static uint32_t _seed = 2463534242u;
+static TestROA  _roas[NO_ROAS];
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Return a pseudo random number between 0 and max - 1.
+ *
+ * @param max The upper bound
+ *
+ * @return the random number
+ */
+static uint32_t _random(uint32_t max)
+{
+  _seed ^= _seed << 13;
+  _seed ^= _seed >> 17;
+  _seed ^= _seed << 5;
+  return _seed % max;
+}
+
+/**
+ * Fill the prefix with random bits, the first 12 bits are taken from a small
+ * set to produce overlapping prefixes.
+ *
+ * @param prefix The prefix
+ * @param version 4 or 6
+ * @param length The prefix length
+ */
+static void _randomPrefix(IPPrefix* prefix, uint8_t version, uint8_t length)
+{
+  uint8_t* addr;
+  int size = version == 4 ? 4 : 16;
+  int idx;
+
+  memset(prefix, 0, sizeof(IPPrefix));
+  prefix->ip.version = version;
+  prefix->length     = length;
+  addr = version == 4 ? prefix->ip.addr.v4.u8 : prefix->ip.addr.v6.u8;
+  for (idx = 0; idx < size; idx++)
+  {
+    addr[idx] = _random(256);
+  }
+  addr[0] = 0x20 + _random(2);
+  addr[1] = (addr[1] & 0x0F) | (_random(2) << 4);
+  // Clear the bits beyond the length.
+  for (idx = 0; idx < size * 8; idx++)
+  {
+    if (idx >= length)
+    {
+      addr[idx / 8] &= ~(0x80 >> (idx % 8));
+    }
+  }
+}
+
+/**
+ * Return true if the ROA prefix covers the given prefix.
+ *
+ * @param roa The ROA prefix
+ * @param prefix The prefix
+ *
+ * @return true if it is covered
+ */
+static bool _covers(IPPrefix* roa, IPPrefix* prefix)
+{
+  uint8_t* roaAddr = roa->ip.version == 4 ? roa->ip.addr.v4.u8
+                                          : roa->ip.addr.v6.u8;
+  uint8_t* addr    = prefix->ip.version == 4 ? prefix->ip.addr.v4.u8
+                                             : prefix->ip.addr.v6.u8;
+  int bit;
+
+  if (roa->ip.version != prefix->ip.version || roa->length > prefix->length)
+  {
+    return false;
+  }
+  for (bit = 0; bit < roa->length; bit++)
+  {
+    if ((roaAddr[bit / 8] ^ addr[bit / 8]) & (0x80 >> (bit % 8)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Record the ROA reported by a lookup.
+ *
+ * @param entry The index entry
+ * @param user The TestMatch
+ */
+static void _match(ROAIndexEntry* entry, void* user)
+{
+  TestMatch* match = (TestMatch*)user;
+  TestROA*   roa   = (TestROA*)entry->data;
+
+  match->count++;
+  match->found[roa - _roas] = true;
+  if (entry->length < match->lastLength)
+  {
+    match->ordered = false;
+  }
+  match->lastLength = entry->length;
+  assert_int(entry->asn, roa->asn, "ASN of the entry");
+  assert_int(entry->maxLen, roa->maxLen, "Max length of the entry");
+}
+
+/**
+ * Compare random lookups of the index with a linear search of the ROAs.
+ *
+ * @param index The index
+ * @param version 4 or 6
+ */
+static void _compare(ROAIndex* index, uint8_t version)
+{
+  static TestMatch match;
+  IPPrefix prefix;
+  int idx, roa, expected;
+
+  for (idx = 0; idx < NO_LOOKUPS; idx++)
+  {
+    _randomPrefix(&prefix, version, version == 4 ? 8 + _random(25)
+                                                 : 16 + _random(113));
+    memset(&match, 0, sizeof(TestMatch));
+    match.ordered = true;
+    assert_int(lookupROAIndex(index, &prefix, _match, &match) == match.count,
+               true, "Number of reported entries");
+    expected = 0;
+    for (roa = 0; roa < NO_ROAS; roa++)
+    {
+      bool covers = _roas[roa].added && _covers(&_roas[roa].prefix, &prefix);
+      expected += covers;
+      assert_int(match.found[roa], covers, "ROA reported");
+    }
+    assert_int(match.count, expected, "Number of covering ROAs");
+    assert_int(match.ordered, true, "Least specific reported first");
+  }
+}
+
+/**
+ * Test lookups for IPv4 and IPv6.
+ */
+static void _test1()
+{
+  ROAIndex index;
+  TestROA  dup;
+  int idx;
+
+  printf ("Test #1: Covering ROA lookups\n");
+  initializeROAIndex(&index);
+  for (idx = 0; idx < NO_ROAS; idx++)
+  {
+    uint8_t version = idx % 2 == 0 ? 4 : 6;
+    uint8_t length  = version == 4 ? _random(33) : _random(129);
+    _randomPrefix(&_roas[idx].prefix, version, length);
+    _roas[idx].asn    = 1 + _random(1000);
+    _roas[idx].maxLen = length + _random(8);
+    _roas[idx].added  = true;
+    assert_int(addROAIndexEntry(&index, &_roas[idx].prefix, _roas[idx].asn,
+                                _roas[idx].maxLen, &_roas[idx]), true,
+               "Add entry");
+  }
+  // A second entry with the same prefix, the first one must stay.
+  dup = _roas[0];
+  assert_int(addROAIndexEntry(&index, &dup.prefix, 65000, dup.maxLen, &dup),
+             true, "Add same prefix");
+  assert_int(lookupROAIndex(&index, &dup.prefix, NULL, NULL) >= 2, true,
+             "Both entries found");
+  assert_int(delROAIndexEntry(&index, &dup.prefix, &dup), true,
+             "Delete same prefix");
+  assert_int(index.entries, NO_ROAS, "Number of entries");
+
+  _compare(&index, 4);
+  _compare(&index, 6);
+
+  releaseROAIndex(&index);
+  printf ("         passed.\n");
+}
+
+/**
+ * Test the deletion of entries and the removal of empty nodes.
+ */
+static void _test2()
+{
+  ROAIndex index;
+  IPPrefix prefix;
+  int idx;
+
+  printf ("Test #2: Delete ROAs\n");
+  initializeROAIndex(&index);
+  for (idx = 0; idx < NO_ROAS; idx++)
+  {
+    addROAIndexEntry(&index, &_roas[idx].prefix, _roas[idx].asn,
+                     _roas[idx].maxLen, &_roas[idx]);
+    _roas[idx].added = true;
+  }
+  for (idx = 0; idx < NO_ROAS; idx += 2)
+  {
+    assert_int(delROAIndexEntry(&index, &_roas[idx].prefix, &_roas[idx]),
+               true, "Delete entry");
+    assert_int(delROAIndexEntry(&index, &_roas[idx].prefix, &_roas[idx]),
+               false, "Delete deleted entry");
+    _roas[idx].added = false;
+  }
+  _compare(&index, 4);
+  _compare(&index, 6);
+
+  for (idx = 1; idx < NO_ROAS; idx += 2)
+  {
+    assert_int(delROAIndexEntry(&index, &_roas[idx].prefix, &_roas[idx]),
+               true, "Delete remaining entry");
+  }
+  assert_int(index.entries, 0, "No entries left");
+  assert_int(index.nodes, 0, "No nodes left");
+  assert_int(index.v4.childMap | index.v6.childMap, 0, "Roots are empty");
+
+  _randomPrefix(&prefix, 4, 24);
+  assert_int(lookupROAIndex(&index, &prefix, NULL, NULL), 0, "Empty index");
+  releaseROAIndex(&index);
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  _test1();
+  _test2();
+
+  return (EXIT_SUCCESS);
+}
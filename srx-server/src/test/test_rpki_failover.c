@@ -0,0 +1,801 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ *
+ * This files is used for testing the RPKI handler with two validation caches.
+ * Both caches are instances of rpkirtr_svr which are started by the test. The
+ * primary cache is killed, the ROAs must stay and the changes of the second
+ * cache must still be processed. The second test withdraws the ASPA object of
+ * a customer AS announced by both caches with different providers. The third
+ * test restarts the RPKI handler from a snapshot and measures the time until 
+ * the restored state is ready to be used.
+ *
+ * Syntax: test_rpki_failover [rpkirtr_svr [port]]
+ *
+ * Each test uses two ports starting with the given port for the two caches.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/wait.h>
+#include <srx/srxcryptoapi.h>
+#include "server/aspa_trie.h"
+#include "server/aspath_cache.h"
+#include "server/crypto_worker.h"
+#include "server/prefix_cache.h"
+#include "server/rpki_handler.h"
+#include "server/rpki_queue.h"
+#include "server/server_connection_handler.h"
+#include "server/ski_cache.h"
+#include "server/snapshot.h"
+#include "server/update_cache.h"
+#include "util/log.h"
+
+/** The default rpkirtr_svr program. */
+#define RTR_SERVER      "rpkirtr_svr"
+/** The default port of the primary cache. */
+#define RTR_PORT        50101
+/** Maximum time in seconds to wait for a result. */
+#define MAX_WAIT        20
+/** Time in seconds the ROAs must stay after the primary cache is gone. */
+#define KEEP_WAIT       3
+
+#define ASN_BOTH        65001
+#define ASN_PRIMARY     65002
+#define ASN_SECOND      65003
+#define ASN_NEW         65004
+
+#define ASPA_CUSTOMER   65010
+#define ASPA_PROV_PRIM  65100
+#define ASPA_PROV_SEC   65200
+/** The RPKI handler stores the ASPA objects without address family. */
+#define ASPA_AFI        0
+
+/** The keep window of updates without client reference. */
+#define KEEP_WINDOW     900
+/** The client ID of the router that resends the restored update. */
+#define CLIENT_ID       1
+
+/** A running validation cache. */
+typedef struct {
+  /** The process ID of rpkirtr_svr. */
+  pid_t pid;
+  /** The stdin of rpkirtr_svr. */
+  FILE* cmd;
+} TestCache;
+
+/** The RPKI queue used by the SKI cache. */
+static RPKI_QUEUE*  _rpkiQueue = NULL;
+/** The SKI cache notified about router keys. */
+static SKI_CACHE*   _skiCache  = NULL;
+/** The AS path cache. */
+static AspathCache  _aspathCache;
+/** The SRxCryptoAPI, router keys are accepted without being used. */
+static SRxCryptoAPI _srxCAPI;
+
+// The accessors of main.c
+SRxCryptoAPI* getSrxCAPI()
+{
+  return &_srxCAPI;
+}
+SKI_CACHE* getSKICache()
+{
+  return _skiCache;
+}
+RPKI_QUEUE* getRPKIQueue()
+{
+  return _rpkiQueue;
+}
+AspathCache* getAspathCache()
+{
+  return &_aspathCache;
+}
+CryptoWorkerPool* getCryptoWorkerPool()
+{
+  return NULL;
+}
+bool queueBGPsecRevalidation(SRxUpdateID* updateID)
+{
+  return false;
+}
+// The crypto workers are not used, no BGPsec or ASPA validation is performed.
+bool queuePriorityCryptoJob(CryptoWorkerPool* self, CryptoJobType type,
+                            SRxUpdateID* updateID)
+{
+  return false;
+}
+uint8_t validateASPA(AS_PATH_LIST* asPathList, uint8_t afi,
+                     ASPA_DBManager* aspaDBManager)
+{
+  return SRx_RESULT_UNDEFINED;
+}
+
+/**
+ * Accept the router key without using it.
+ *
+ * @param key The router key
+ * @param source The key source
+ * @param status The status
+ *
+ * @return API_SUCCESS
+ */
+static u_int8_t _registerKey(BGPSecKey* key, sca_key_source_t source,
+                             sca_status_t* status)
+{
+  return API_SUCCESS;
+}
+
+/**
+ * Called by the update cache for each changed validation result. There are no
+ * clients to notify.
+ *
+ * @param result The changed result
+ */
+static void _resultChanged(SRxValidationResult* result)
+{
+}
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Start rpkirtr_svr on the given port.
+ *
+ * @param cache The cache to be started.
+ * @param program The rpkirtr_svr program.
+ * @param port The port the cache listens on.
+ */
+static void _startCache(TestCache* cache, char* program, int port)
+{
+  char portStr[16];
+  int  fds[2];
+
+  snprintf(portStr, sizeof(portStr), "%d", port);
+  assert_int(pipe(fds), 0, "Create the command pipe");
+  cache->pid = fork();
+  assert_int(cache->pid >= 0, true, "Start the validation cache");
+  if (cache->pid == 0)
+  {
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(fds[0], STDIN_FILENO);
+    dup2(devNull, STDOUT_FILENO);
+    dup2(devNull, STDERR_FILENO);
+    close(fds[1]);
+    execlp(program, program, portStr, NULL);
+    _exit(EXIT_FAILURE);
+  }
+  close(fds[0]);
+  cache->cmd = fdopen(fds[1], "w");
+}
+
+/**
+ * Pass the command to rpkirtr_svr.
+ *
+ * @param cache The cache.
+ * @param command The command.
+ */
+static void _cacheCommand(TestCache* cache, char* command)
+{
+  fprintf(cache->cmd, "%s\n", command);
+  fflush(cache->cmd);
+}
+
+/**
+ * Kill the cache, the connection is lost without any notification.
+ *
+ * @param cache The cache.
+ */
+static void _killCache(TestCache* cache)
+{
+  if (cache->pid > 0)
+  {
+    kill(cache->pid, SIGKILL);
+    waitpid(cache->pid, NULL, 0);
+    fclose(cache->cmd);
+    cache->pid = 0;
+  }
+}
+
+/**
+ * Store an update of the origin AS for the prefix a.0.0.0/16 and request
+ * its origin validation.
+ *
+ * @param prefixCache The prefix cache.
+ * @param updateID The ID of the update.
+ * @param byte0 The first byte of the prefix.
+ * @param originAS The origin AS of the update.
+ */
+static void _validate(PrefixCache* prefixCache, SRxUpdateID updateID,
+                      uint8_t byte0, uint32_t originAS)
+{
+  IPPrefix   prefix;
+  BGPSecData bgpData;
+  uint32_t   asPath = htonl(originAS);
+
+  memset(&prefix, 0, sizeof(IPPrefix));
+  prefix.ip.version       = 4;
+  prefix.ip.addr.v4.u8[0] = byte0;
+  prefix.length           = 16;
+  memset(&bgpData, 0, sizeof(BGPSecData));
+  bgpData.afi        = htons(AFI_IP);
+  bgpData.numberHops = 1;
+  bgpData.asPath     = &asPath;
+  assert_int(storeUpdate(prefixCache->updateCache, 0, NULL, &updateID, &prefix,
+                         originAS, NULL, &bgpData, 0), 1, "Store the update");
+  assert_int(requestUpdateValidation(prefixCache, &updateID, &prefix,
+                                     originAS), true, "Validate the update");
+}
+
+/**
+ * Return the origin validation result of the update.
+ *
+ * @param updateCache The update cache.
+ * @param updateID The ID of the update.
+ *
+ * @return The ROA result.
+ */
+static int _roaResult(UpdateCache* updateCache, SRxUpdateID updateID)
+{
+  SRxResult        srxRes;
+  SRxDefaultResult defRes;
+  uint32_t         pathID;
+
+  assert_int(getUpdateResult(updateCache, &updateID, 0, NULL, &srxRes, &defRes,
+                             &pathID), true, "Update is stored");
+  return srxRes.roaResult;
+}
+
+/**
+ * Wait until the origin validation result of the update is the expected one,
+ * at most MAX_WAIT seconds.
+ *
+ * @param updateCache The update cache.
+ * @param updateID The ID of the update.
+ * @param expected The expected result.
+ *
+ * @return The ROA result.
+ */
+static int _waitForResult(UpdateCache* updateCache, SRxUpdateID updateID,
+                          int expected)
+{
+  int result = _roaResult(updateCache, updateID);
+  int loop;
+
+  for (loop = 0; (loop < MAX_WAIT * 10) && (result != expected); loop++)
+  {
+    usleep(100000);
+    result = _roaResult(updateCache, updateID);
+  }
+
+  return result;
+}
+
+/**
+ * Wait until the ASPA database returns the expected result for the hop from
+ * the customer to the provider, at most MAX_WAIT seconds.
+ *
+ * @param aspaDBManager The ASPA database.
+ * @param customerAsn The customer AS.
+ * @param providerAsn The provider AS.
+ * @param expected The expected result.
+ *
+ * @return The ASPA result.
+ */
+static int _waitForAspa(ASPA_DBManager* aspaDBManager, uint32_t customerAsn,
+                        uint32_t providerAsn, int expected)
+{
+  int result = ASPA_DB_lookup(aspaDBManager, customerAsn, providerAsn, ASPA_AFI);
+  int loop;
+
+  for (loop = 0; (loop < MAX_WAIT * 10) && (result != expected); loop++)
+  {
+    usleep(100000);
+    result = ASPA_DB_lookup(aspaDBManager, customerAsn, providerAsn, ASPA_AFI);
+  }
+
+  return result;
+}
+
+/**
+ * Wait until the data of the session is in sync with an End of Data of its
+ * validation cache, at most MAX_WAIT seconds.
+ *
+ * @param rpkiHandler The RPKI handler.
+ * @param valCacheID The ID of the validation cache.
+ *
+ * @return true if the session is in sync.
+ */
+static bool _waitForSession(RPKIHandler* rpkiHandler, uint32_t valCacheID)
+{
+  RPKICacheSession* session = &rpkiHandler->sessions[valCacheID - 1];
+  int               loop;
+
+  for (loop = 0; (loop < MAX_WAIT * 10) && !session->consistent; loop++)
+  {
+    usleep(100000);
+  }
+
+  return session->consistent;
+}
+
+/**
+ * Export the update of the origin AS as one line of JSON.
+ *
+ * @param updateCache The update cache.
+ * @param originAS The origin AS of the update.
+ * @param line (out) The exported line.
+ * @param size The size of the line buffer.
+ */
+static void _exportUpdate(UpdateCache* updateCache, uint32_t originAS,
+                          char* line, int size)
+{
+  UC_ExportFilter filter;
+  FILE*           file = tmpfile();
+  char            condition[32];
+  uint32_t        noExported = 0;
+
+  assert_int(file != NULL, true, "Create the export file");
+  snprintf(condition, sizeof(condition), "origin=%u", originAS);
+  initUpdateExportFilter(&filter);
+  assert_int(parseUpdateExportFilter(&filter, condition), true, 
+             "Filter the export");
+  assert_int(exportUpdateCache(updateCache, fileno(file), UC_EXPORT_JSONL, 
+                               &filter, &noExported), true, 
+             "Export the update");
+  assert_int(noExported, 1, "Number of exported updates");
+  rewind(file);
+  assert_int(fgets(line, size, file) != NULL, true, "Read the export");
+  fclose(file);
+}
+
+/**
+ * Return the GC time of the exported update.
+ *
+ * @param line The exported update.
+ *
+ * @return The GC time, 0 if the update is referenced.
+ */
+static int _gcTime(char* line)
+{
+  char* gc = strstr(line, "\"gc\":");
+
+  assert_int(gc != NULL, true, "GC time exported");
+  return atoi(gc + 5);
+}
+
+/**
+ * Initialize the configuration of the two validation caches.
+ *
+ * @param config The configuration.
+ * @param port The port of the primary cache.
+ */
+static void _configure(Configuration* config, int port)
+{
+  memset(config, 0, sizeof(Configuration));
+  config->defaultKeepWindow        = KEEP_WINDOW;
+  config->rpki_host                = "localhost";
+  config->rpki_port                = port;
+  config->rpki_router_protocol     = 2;
+  config->rpki_num_caches          = 1;
+  config->rpki_caches[0].host      = "localhost";
+  config->rpki_caches[0].port      = port + 1;
+}
+
+/**
+ * Kill the primary cache while the second cache keeps serving the ROAs.
+ *
+ * @param program The rpkirtr_svr program.
+ * @param port The port of the primary cache.
+ */
+static void _test1(char* program, int port)
+{
+  Configuration  config;
+  UpdateCache    updateCache;
+  PrefixCache    prefixCache;
+  ASPA_DBManager aspaDBManager;
+  RPKIHandler    rpkiHandler;
+  TestCache      primary;
+  TestCache      second;
+
+  printf ("Test #1: Kill the primary validation cache\n");
+  _configure(&config, port);
+  memset(&rpkiHandler, 0, sizeof(RPKIHandler));
+
+  _startCache(&primary, program, port);
+  _startCache(&second, program, port + 1);
+  _cacheCommand(&primary, "add 10.0.0.0/8 16 65001");
+  _cacheCommand(&primary, "add 20.0.0.0/8 16 65002");
+  _cacheCommand(&second,  "add 10.0.0.0/8 16 65001");
+  _cacheCommand(&second,  "add 30.0.0.0/8 16 65003");
+  // Give the caches the time to open their ports.
+  sleep(1);
+
+  assert_int(createUpdateCache(&updateCache, _resultChanged, 1, &config),
+             true, "Create the update cache");
+  assert_int(initializePrefixCache(&prefixCache, &updateCache), true,
+             "Create the prefix cache");
+  assert_int(initializeAspaDBManager(&aspaDBManager, &config), true,
+             "Create the ASPA database");
+  assert_int(createAspathCache(&_aspathCache, &aspaDBManager), true,
+             "Create the AS path cache");
+  _validate(&prefixCache, 1, 10, ASN_BOTH);
+  _validate(&prefixCache, 2, 20, ASN_PRIMARY);
+  _validate(&prefixCache, 3, 30, ASN_SECOND);
+  _validate(&prefixCache, 4, 40, ASN_NEW);
+  assert_int(createRPKIHandler(&rpkiHandler, &prefixCache, &_aspathCache,
+                               &aspaDBManager, &config, NULL), true,
+             "Create the RPKI handler");
+
+  assert_int(_waitForResult(&updateCache, 1, SRx_RESULT_VALID),
+             SRx_RESULT_VALID, "ROA of both caches");
+  assert_int(_waitForResult(&updateCache, 2, SRx_RESULT_VALID),
+             SRx_RESULT_VALID, "ROA of the primary cache");
+  assert_int(_waitForResult(&updateCache, 3, SRx_RESULT_VALID),
+             SRx_RESULT_VALID, "ROA of the second cache");
+  assert_int(_roaResult(&updateCache, 4), SRx_RESULT_NOTFOUND,
+             "Prefix without ROA");
+
+  // The connection to the primary cache is lost, its ROAs stay.
+  _killCache(&primary);
+  sleep(KEEP_WAIT);
+  assert_int(_roaResult(&updateCache, 1), SRx_RESULT_VALID,
+             "ROA of both caches without the primary cache");
+  assert_int(_roaResult(&updateCache, 2), SRx_RESULT_VALID,
+             "ROA of the primary cache without the primary cache");
+  assert_int(_roaResult(&updateCache, 3), SRx_RESULT_VALID,
+             "ROA of the second cache without the primary cache");
+
+  // The second cache takes over.
+  _cacheCommand(&second, "addNow 40.0.0.0/8 16 65004");
+  assert_int(_waitForResult(&updateCache, 4, SRx_RESULT_VALID),
+             SRx_RESULT_VALID, "New ROA of the second cache");
+  _cacheCommand(&second, "removeNow 2");
+  assert_int(_waitForResult(&updateCache, 3, SRx_RESULT_NOTFOUND),
+             SRx_RESULT_NOTFOUND, "ROA withdrawn by the second cache");
+  assert_int(_roaResult(&updateCache, 1), SRx_RESULT_VALID,
+             "ROA of both caches after the withdrawal");
+
+  _killCache(&second);
+  releaseRPKIHandler(&rpkiHandler);
+  printf ("         passed.\n");
+}
+
+/**
+ * Both caches announce an ASPA object of the same customer AS with different
+ * providers. The ASPA database holds the providers of both, a withdrawal only
+ * removes the providers of the withdrawing cache.
+ *
+ * @param program The rpkirtr_svr program.
+ * @param port The port of the primary cache.
+ */
+static void _test2(char* program, int port)
+{
+  Configuration  config;
+  UpdateCache    updateCache;
+  PrefixCache    prefixCache;
+  ASPA_DBManager aspaDBManager;
+  RPKIHandler    rpkiHandler;
+  TestCache      primary;
+  TestCache      second;
+  char           command[64];
+
+  printf ("Test #2: Withdraw the ASPA object of one validation cache\n");
+  _configure(&config, port);
+  memset(&rpkiHandler, 0, sizeof(RPKIHandler));
+
+  _startCache(&primary, program, port);
+  _startCache(&second, program, port + 1);
+  sprintf(command, "addASPA %u %u", ASPA_CUSTOMER, ASPA_PROV_PRIM);
+  _cacheCommand(&primary, command);
+  // Give the caches the time to open their ports.
+  sleep(1);
+
+  assert_int(createUpdateCache(&updateCache, _resultChanged, 1, &config),
+             true, "Create the update cache");
+  assert_int(initializePrefixCache(&prefixCache, &updateCache), true,
+             "Create the prefix cache");
+  assert_int(initializeAspaDBManager(&aspaDBManager, &config), true,
+             "Create the ASPA database");
+  assert_int(createAspathCache(&_aspathCache, &aspaDBManager), true,
+             "Create the AS path cache");
+  assert_int(createRPKIHandler(&rpkiHandler, &prefixCache, &_aspathCache,
+                               &aspaDBManager, &config, NULL), true,
+             "Create the RPKI handler");
+  assert_int(_waitForAspa(&aspaDBManager, ASPA_CUSTOMER, ASPA_PROV_PRIM, 
+                          ASPA_RESULT_VALID), ASPA_RESULT_VALID, 
+             "Provider of the primary cache");
+
+  // The second cache announces the object after the primary cache.
+  sprintf(command, "addASPANow %u %u", ASPA_CUSTOMER, ASPA_PROV_SEC);
+  _cacheCommand(&second, command);
+  assert_int(_waitForAspa(&aspaDBManager, ASPA_CUSTOMER, ASPA_PROV_SEC, 
+                          ASPA_RESULT_VALID), ASPA_RESULT_VALID, 
+             "Provider of the second cache");
+  assert_int(ASPA_DB_lookup(&aspaDBManager, ASPA_CUSTOMER, ASPA_PROV_PRIM, 
+                            ASPA_AFI), ASPA_RESULT_VALID, 
+             "Provider of the primary cache is kept");
+
+  // The object of the primary cache remains without the withdrawn provider.
+  _cacheCommand(&second, "removeNow 1");
+  assert_int(_waitForAspa(&aspaDBManager, ASPA_CUSTOMER, ASPA_PROV_SEC, 
+                          ASPA_RESULT_INVALID), ASPA_RESULT_INVALID, 
+             "Provider withdrawn by the second cache");
+  assert_int(ASPA_DB_lookup(&aspaDBManager, ASPA_CUSTOMER, ASPA_PROV_PRIM, 
+                            ASPA_AFI), ASPA_RESULT_VALID, 
+             "Provider of the primary cache after the withdrawal");
+
+  // No cache announces the object anymore.
+  _cacheCommand(&primary, "removeNow 1");
+  assert_int(_waitForAspa(&aspaDBManager, ASPA_CUSTOMER, ASPA_PROV_PRIM, 
+                          ASPA_RESULT_UNKNOWN), ASPA_RESULT_UNKNOWN, 
+             "Object withdrawn by both caches");
+
+  _killCache(&primary);
+  _killCache(&second);
+  releaseRPKIHandler(&rpkiHandler);
+  printf ("         passed.\n");
+}
+
+/**
+ * Create the caches of the server.
+ *
+ * @param config The configuration.
+ * @param updateCache The update cache.
+ * @param prefixCache The prefix cache.
+ * @param aspaDBManager The ASPA database.
+ */
+static void _createCaches(Configuration* config, UpdateCache* updateCache,
+                          PrefixCache* prefixCache, 
+                          ASPA_DBManager* aspaDBManager)
+{
+  assert_int(createUpdateCache(updateCache, _resultChanged, 1, config),
+             true, "Create the update cache");
+  assert_int(initializePrefixCache(prefixCache, updateCache), true,
+             "Create the prefix cache");
+  assert_int(initializeAspaDBManager(aspaDBManager, config), true,
+             "Create the ASPA database");
+  assert_int(createAspathCache(&_aspathCache, aspaDBManager), true,
+             "Create the AS path cache");
+}
+
+/**
+ * Write a snapshot of the RPKI data, the RTR sessions, and the update cache,
+ * restart the RPKI handler with new caches from it, and measure the time 
+ * until the restored state can be used. The session is resumed with the 
+ * restored serial and the restored update is kept until the router requests 
+ * it again.
+ *
+ * @param program The rpkirtr_svr program.
+ * @param port The port of the primary cache.
+ */
+static void _test3(char* program, int port)
+{
+  Configuration      config;
+  UpdateCache        updateCache;
+  PrefixCache        prefixCache;
+  ASPA_DBManager     aspaDBManager;
+  RPKIHandler        rpkiHandler;
+  TestCache          primary;
+  TestCache          second;
+  SnapshotWriter     writer;
+  SnapshotReader     reader;
+  ProxyClientMapping mapping;
+  SRxResult          srxRes;
+  SRxDefaultResult   defRes;
+  IPPrefix           prefix;
+  BGPSecData         bgpData;
+  uint32_t           asPath = htonl(ASN_BOTH);
+  SRxUpdateID        updateID = 1;
+  uint32_t           pathID;
+  uint32_t           sessionID, serial;
+  struct timespec    start, ready;
+  time_t             restored;
+  char               fileName[64];
+  char               command[64];
+  char               line[512];
+
+  printf ("Test #3: Restart from the snapshot\n");
+  snprintf(fileName, sizeof(fileName), "/tmp/test_rpki_failover.%d", 
+           getpid());
+  _configure(&config, port);
+  memset(&rpkiHandler, 0, sizeof(RPKIHandler));
+
+  _startCache(&primary, program, port);
+  _startCache(&second, program, port + 1);
+  _cacheCommand(&primary, "add 10.0.0.0/8 16 65001");
+  sprintf(command, "addASPA %u %u", ASPA_CUSTOMER, ASPA_PROV_PRIM);
+  _cacheCommand(&primary, command);
+  // Give the caches the time to open their ports.
+  sleep(1);
+
+  _createCaches(&config, &updateCache, &prefixCache, &aspaDBManager);
+  assert_int(createRPKIHandler(&rpkiHandler, &prefixCache, &_aspathCache,
+                               &aspaDBManager, &config, NULL), true,
+             "Create the RPKI handler");
+  // The router provides a transitive result.
+  memset(&defRes, 0, sizeof(SRxDefaultResult));
+  defRes.result.roaResult        = SRx_RESULT_UNDEFINED;
+  defRes.result.bgpsecResult     = SRx_RESULT_UNDEFINED;
+  defRes.result.aspaResult       = SRx_RESULT_UNDEFINED;
+  defRes.result.transitiveResult = SRx_RESULT_VALID;
+  defRes.resSourceTransitive     = SRxRS_ROUTER;
+  memset(&prefix, 0, sizeof(IPPrefix));
+  prefix.ip.version       = 4;
+  prefix.ip.addr.v4.u8[0] = 10;
+  prefix.length           = 16;
+  memset(&bgpData, 0, sizeof(BGPSecData));
+  bgpData.afi        = htons(AFI_IP);
+  bgpData.numberHops = 1;
+  bgpData.asPath     = &asPath;
+  assert_int(storeUpdate(&updateCache, 0, NULL, &updateID, &prefix, ASN_BOTH,
+                         &defRes, &bgpData, 0), 1, "Store the update");
+  assert_int(requestUpdateValidation(&prefixCache, &updateID, &prefix,
+                                     ASN_BOTH), true, "Validate the update");
+  assert_int(_waitForResult(&updateCache, updateID, SRx_RESULT_VALID),
+             SRx_RESULT_VALID, "ROA before the restart");
+  assert_int(_waitForAspa(&aspaDBManager, ASPA_CUSTOMER, ASPA_PROV_PRIM, 
+                          ASPA_RESULT_VALID), ASPA_RESULT_VALID, 
+             "ASPA object before the restart");
+  assert_int(_waitForSession(&rpkiHandler, 1), true, "Primary cache in sync");
+  assert_int(_waitForSession(&rpkiHandler, 2), true, "Second cache in sync");
+
+  // The results of the path validation as determined by the workers.
+  srxRes.roaResult        = SRx_RESULT_DONOTUSE;
+  srxRes.bgpsecResult     = SRx_RESULT_INVALID;
+  srxRes.aspaResult       = SRx_RESULT_VALID;
+  srxRes.transitiveResult = SRx_RESULT_DONOTUSE;
+  assert_int(modifyUpdateResult(&updateCache, &updateID, &srxRes, true), true,
+             "Store the path validation results");
+  sessionID = ntohs(rpkiHandler.sessions[0].rrclInstance.sessionID);
+  serial    = ntohl(rpkiHandler.sessions[0].rrclInstance.serial);
+
+  assert_int(openSnapshotWriter(&writer, fileName), true, "Open the writer");
+  assert_int(closeSnapshotWriter(&writer, 
+                                 writeRPKIHandlerSnapshot(&rpkiHandler, 
+                                                          &writer)), 
+             true, "Write the snapshot");
+  releaseRPKIHandler(&rpkiHandler);
+  releasePrefixCache(&prefixCache);
+  releaseUpdateCache(&updateCache);
+  releaseAspathCache(&_aspathCache);
+  memset(&rpkiHandler, 0, sizeof(RPKIHandler));
+
+  // Start the server again with empty caches.
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  restored = time(NULL);
+  _createCaches(&config, &updateCache, &prefixCache, &aspaDBManager);
+  assert_int(openSnapshotReader(&reader, fileName), true, "Open the reader");
+  assert_int(createRPKIHandler(&rpkiHandler, &prefixCache, &_aspathCache,
+                               &aspaDBManager, &config, &reader), true,
+             "Restart the RPKI handler");
+
+  // The state is usable before the caches answer the serial query.
+  assert_int(getUpdateResult(&updateCache, &updateID, 0, NULL, &srxRes, 
+                             &defRes, &pathID), true, "Restored update");
+  assert_int(srxRes.roaResult, SRx_RESULT_UNDEFINED, 
+             "Restored origin validation result");
+  assert_int(srxRes.bgpsecResult, SRx_RESULT_INVALID, 
+             "Restored BGPsec validation result");
+  assert_int(srxRes.aspaResult, SRx_RESULT_VALID, 
+             "Restored ASPA validation result");
+  assert_int(srxRes.transitiveResult, SRx_RESULT_UNDEFINED, 
+             "Restored transitive validation result");
+  assert_int(defRes.result.transitiveResult, SRx_RESULT_VALID, 
+             "Restored transitive result of the router");
+  assert_int(requestUpdateValidation(&prefixCache, &updateID, &prefix, 
+                                     ASN_BOTH), true, 
+             "Validate the restored update");
+  assert_int(_roaResult(&updateCache, updateID), SRx_RESULT_VALID,
+             "Restored ROA");
+  assert_int(ASPA_DB_lookup(&aspaDBManager, ASPA_CUSTOMER, ASPA_PROV_PRIM, 
+                            ASPA_AFI), ASPA_RESULT_VALID, 
+             "Restored ASPA object");
+  clock_gettime(CLOCK_MONOTONIC, &ready);
+
+  // The session is resumed with the restored serial.
+  assert_int(rpkiHandler.sessions[0].rrclParams.resumeSession, true,
+             "Resume the session of the primary cache");
+  assert_int(rpkiHandler.sessions[0].rrclParams.resumeSessionID, sessionID,
+             "Restored session ID");
+  assert_int(rpkiHandler.sessions[0].rrclParams.resumeSerial, serial,
+             "Restored serial");
+  _cacheCommand(&primary, "addNow 40.0.0.0/8 16 65004");
+  _validate(&prefixCache, updateID + 1, 40, ASN_NEW);
+  assert_int(_waitForResult(&updateCache, updateID + 1, SRx_RESULT_VALID),
+             SRx_RESULT_VALID, "ROA announced after the restart");
+  assert_int(ntohs(rpkiHandler.sessions[0].rrclInstance.sessionID), sessionID,
+             "Session ID after the serial query");
+  assert_int(_roaResult(&updateCache, updateID), SRx_RESULT_VALID,
+             "Restored ROA after the serial query");
+
+  // The restored update is kept for the keep window until the router 
+  // reconnects and requests it again.
+  _exportUpdate(&updateCache, ASN_BOTH, line, sizeof(line));
+  assert_int(strstr(line, "\"clients\":[]") != NULL, true, 
+             "Restored update without client");
+  assert_int((uint16_t)(_gcTime(line) - (uint16_t)(restored + KEEP_WINDOW))
+             <= 2, true, "Restored update kept for the keep window");
+  memset(&mapping, 0, sizeof(ProxyClientMapping));
+  assert_int(getUpdateResult(&updateCache, &updateID, CLIENT_ID, &mapping, 
+                             &srxRes, &defRes, &pathID), true, 
+             "Router resends the restored update");
+  assert_int(srxRes.bgpsecResult, SRx_RESULT_INVALID, 
+             "BGPsec result of the resent update");
+  _exportUpdate(&updateCache, ASN_BOTH, line, sizeof(line));
+  assert_int(strstr(line, "\"clients\":[1]") != NULL, true, 
+             "Resent update referenced by the router");
+  assert_int(_gcTime(line), 0, "Resent update not garbage collected");
+  assert_int(mapping.updateCount, 1, "Updates of the router");
+
+  _killCache(&primary);
+  _killCache(&second);
+  releaseRPKIHandler(&rpkiHandler);
+  closeSnapshotReader(&reader);
+  unlink(fileName);
+  printf ("         ready within %ld ms.\n",
+          (long)((ready.tv_sec - start.tv_sec) * 1000
+                 + (ready.tv_nsec - start.tv_nsec) / 1000000));
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  char* program = argc > 1 ? argv[1] : RTR_SERVER;
+  int   port    = argc > 2 ? atoi(argv[2]) : RTR_PORT;
+
+  setLogLevel(LEVEL_ERROR);
+  // A killed cache must not terminate the test.
+  signal(SIGPIPE, SIG_IGN);
+
+  memset(&_srxCAPI, 0, sizeof(SRxCryptoAPI));
+  _srxCAPI.registerPublicKey   = _registerKey;
+  _srxCAPI.unregisterPublicKey = _registerKey;
+  _rpkiQueue = rq_createQueue();
+  _skiCache  = ski_createCache(_rpkiQueue);
+
+  _test1(program, port);
+  _test2(program, port + 2);
+  _test3(program, port + 4);
+
+  return (EXIT_SUCCESS);
+}
@@ -0,0 +1,391 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ *
+ * This files is used for testing the send queues of the clients and the
+ * credit based flow control.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "server/srx_packet_sender.h"
+#include "shared/srx_packets.h"
+#include "util/server_socket.h"
+
+/** The window of the test. */
+#define TEST_WINDOW      4
+/** The number of packets a queue holds. */
+#define TEST_QUEUE_LIMIT 4
+/** The size of the packet that blocks the sender. */
+#define BLOCKER_SIZE     (1024 * 1024)
+
+/** The server socket, only the mode is used. */
+static ServerSocket _svrSock;
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Connect the client to a socket pair and create its send queue.
+ *
+ * @param client The client
+ * @param fds The socket pair, fds[1] is the proxy side.
+ */
+static void _connect(ClientThread* client, int fds[2])
+{
+  struct timeval timeout = { 5, 0 };
+
+  assert_int(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0, "Socket pair");
+  setsockopt(fds[1], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  memset(client, 0, sizeof(ClientThread));
+  client->active   = true;
+  client->clientFD = fds[0];
+  client->svrSock  = &_svrSock;
+  initMutex(&client->writeMutex);
+  assert_int(createClientSendQueue(&_svrSock, client), true, "Create queue");
+  assert_int(client->sendQueue != NULL, true, "Queue installed");
+}
+
+/**
+ * Release the send queue of the client and close the socket pair.
+ *
+ * @param client The client
+ * @param fds The socket pair
+ */
+static void _disconnect(ClientThread* client, int fds[2])
+{
+  releaseClientSendQueue(client);
+  assert_int(client->sendQueue == NULL, true, "Queue removed");
+  releaseMutex(&client->writeMutex);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+/**
+ * Read one packet from the proxy side of the socket pair.
+ *
+ * @param fd The proxy side
+ * @param buffer The buffer, must hold BLOCKER_SIZE bytes
+ *
+ * @return the type of the packet
+ */
+static uint8_t _readPacket(int fd, uint8_t* buffer)
+{
+  SRXPROXY_BasicHeader* hdr = (SRXPROXY_BasicHeader*)buffer;
+  uint32_t length = sizeof(SRXPROXY_BasicHeader);
+  uint32_t read   = 0;
+  ssize_t  num;
+
+  while (read < length)
+  {
+    num = recv(fd, buffer + read, length - read, 0);
+    assert_int(num > 0, true, "Packet received");
+    read += num;
+    if (read == sizeof(SRXPROXY_BasicHeader))
+    {
+      length = ntohl(hdr->length);
+    }
+  }
+
+  return hdr->type;
+}
+
+/**
+ * Queue a verify notification.
+ *
+ * @param client The client
+ * @param updateID The update ID
+ * @param resultType The result type
+ * @param roaResult The ROA result
+ * @param bgpsecResult The BGPsec result
+ *
+ * @return the result of queuePacketToClient
+ */
+static bool _queueNotification(ClientThread* client, uint32_t updateID,
+                               uint8_t resultType, uint8_t roaResult,
+                               uint8_t bgpsecResult)
+{
+  SRXPROXY_VERIFY_NOTIFICATION pdu;
+
+  memset(&pdu, 0, sizeof(SRXPROXY_VERIFY_NOTIFICATION));
+  pdu.type         = PDU_SRXPROXY_VERI_NOTIFICATION;
+  pdu.resultType   = resultType;
+  pdu.roaResult    = roaResult;
+  pdu.bgpsecResult = bgpsecResult;
+  pdu.updateID     = htonl(updateID);
+  pdu.length       = htonl(sizeof(SRXPROXY_VERIFY_NOTIFICATION));
+
+  return queuePacketToClient(&_svrSock, client, &pdu,
+                             sizeof(SRXPROXY_VERIFY_NOTIFICATION));
+}
+
+/**
+ * Queue a packet that does not fit into the socket buffer. The sender blocks
+ * until it is read. Returns once the sender took it from the queue.
+ *
+ * @param client The client
+ * @param buffer The buffer of BLOCKER_SIZE bytes
+ */
+static void _blockSender(ClientThread* client, uint8_t* buffer)
+{
+  SRXPROXY_BasicHeader* hdr = (SRXPROXY_BasicHeader*)buffer;
+  SendQueueStats stats;
+  int wait = 0;
+
+  memset(buffer, 0, BLOCKER_SIZE);
+  hdr->type   = PDU_SRXPROXY_SYNC_REQUEST;
+  hdr->length = htonl(BLOCKER_SIZE);
+  assert_int(queuePacketToClient(&_svrSock, client, buffer, BLOCKER_SIZE),
+             true, "Queue blocker");
+  do
+  {
+    usleep(1000);
+    getSendQueueStats(&stats);
+  } while ((stats.queued != 0) && (++wait < 5000));
+  assert_int(stats.queued, 0, "Blocker taken from the queue");
+}
+
+/**
+ * Waits for a window of outstanding requests to be free.
+ *
+ * @param client The client
+ *
+ * @return NULL
+ */
+static void* _acquire(void* client)
+{
+  return acquireClientCredit((ServerClient*)client) ? client : NULL;
+}
+
+/**
+ * Test the window and the credits returned in the notifications.
+ */
+static void _test1()
+{
+  ClientThread client;
+  SendQueueStats stats;
+  SRXPROXY_VERIFY_NOTIFICATION* notify;
+  uint8_t* buffer = malloc(BLOCKER_SIZE);
+  pthread_t thread;
+  void* result;
+  int fds[2];
+  int idx, credits = 0, notifications = 0;
+
+  printf ("Test #1: Window and returned credits\n");
+  _connect(&client, fds);
+  assert_int(grantClientWindow(&client, 100), TEST_WINDOW, "Window limited");
+  for (idx = 0; idx < TEST_WINDOW; idx++)
+  {
+    assert_int(acquireClientCredit(&client), true, "Credit within window");
+  }
+  getSendQueueStats(&stats);
+  assert_int(stats.outstanding, TEST_WINDOW, "Outstanding requests");
+  assert_int(stats.creditClients, 1, "Client uses credits");
+
+  // The window is full, the receiver waits until a credit is returned.
+  pthread_create(&thread, NULL, _acquire, &client);
+  usleep(100000);
+  getSendQueueStats(&stats);
+  assert_int(stats.creditWaits, 1, "Receiver waits for credits");
+
+  // One result and the credits of all requests.
+  _queueNotification(&client, 1, SRX_FLAG_ROA, SRx_RESULT_VALID, 0);
+  for (idx = 0; idx < TEST_WINDOW; idx++)
+  {
+    returnClientCredit(&client);
+  }
+  pthread_join(thread, &result);
+  assert_int(result == &client, true, "Receiver got a credit");
+  returnClientCredit(&client);
+
+  while ((credits < TEST_WINDOW + 1) || (notifications == 0))
+  {
+    assert_int(_readPacket(fds[1], buffer), PDU_SRXPROXY_VERI_NOTIFICATION,
+               "Notification received");
+    notify   = (SRXPROXY_VERIFY_NOTIFICATION*)buffer;
+    credits += ntohs(notify->credits);
+    if (notify->updateID != 0)
+    {
+      assert_int(ntohl(notify->updateID), 1, "Update ID");
+      notifications++;
+    }
+    else
+    {
+      assert_int(notify->resultType, 0, "Credit only notification");
+      assert_int(notify->credits != 0, true, "Credits returned");
+    }
+  }
+  assert_int(credits, TEST_WINDOW + 1, "All credits returned");
+  getSendQueueStats(&stats);
+  assert_int(stats.outstanding, 0, "No outstanding requests");
+
+  _disconnect(&client, fds);
+  free(buffer);
+  printf ("         passed.\n");
+}
+
+/**
+ * Test the merge of verify notifications into queued ones.
+ */
+static void _test2()
+{
+  ClientThread client;
+  SendQueueStats stats;
+  SRXPROXY_VERIFY_NOTIFICATION* notify;
+  uint8_t* buffer = malloc(BLOCKER_SIZE);
+  int fds[2];
+  int idx, waits;
+
+  printf ("Test #2: Merge results if the queue is full\n");
+  _connect(&client, fds);
+  assert_int(grantClientWindow(&client, 0), 0, "No flow control");
+  // Without flow control the window is not enforced.
+  getSendQueueStats(&stats);
+  waits = stats.creditWaits;
+  for (idx = 0; idx <= TEST_WINDOW; idx++)
+  {
+    assert_int(acquireClientCredit(&client), true, "Credit without window");
+  }
+  for (idx = 0; idx <= TEST_WINDOW; idx++)
+  {
+    returnClientCredit(&client);
+  }
+  getSendQueueStats(&stats);
+  assert_int(stats.outstanding, 0, "No outstanding requests");
+  assert_int(stats.creditWaits, waits, "Receiver did not wait");
+  _blockSender(&client, buffer);
+  for (idx = 1; idx <= TEST_QUEUE_LIMIT; idx++)
+  {
+    assert_int(_queueNotification(&client, idx, SRX_FLAG_ROA,
+                                  SRx_RESULT_INVALID, 0), true, "Queue result");
+  }
+  // The later result of update 2 is merged, the queue does not grow.
+  assert_int(_queueNotification(&client, 2, SRX_FLAG_BGPSEC, 0,
+                                SRx_RESULT_VALID), true, "Merge result");
+  getSendQueueStats(&stats);
+  assert_int(stats.coalesced, 1, "Merged results");
+  assert_int(stats.queued, TEST_QUEUE_LIMIT, "Queue size");
+  assert_int(stats.overflows, 0, "No overflow");
+
+  assert_int(_readPacket(fds[1], buffer), PDU_SRXPROXY_SYNC_REQUEST,
+             "Blocker received");
+  for (idx = 1; idx <= TEST_QUEUE_LIMIT; idx++)
+  {
+    assert_int(_readPacket(fds[1], buffer), PDU_SRXPROXY_VERI_NOTIFICATION,
+               "Notification received");
+    notify = (SRXPROXY_VERIFY_NOTIFICATION*)buffer;
+    assert_int(ntohl(notify->updateID), idx, "Order kept");
+    assert_int(notify->roaResult, SRx_RESULT_INVALID, "ROA result");
+    if (idx == 2)
+    {
+      assert_int(notify->resultType, SRX_FLAG_ROA | SRX_FLAG_BGPSEC,
+                 "Merged result type");
+      assert_int(notify->bgpsecResult, SRx_RESULT_VALID, "Merged result");
+    }
+    else
+    {
+      assert_int(notify->resultType, SRX_FLAG_ROA, "Result type");
+    }
+  }
+
+  _disconnect(&client, fds);
+  free(buffer);
+  printf ("         passed.\n");
+}
+
+/**
+ * Test the disconnect of a client that does not keep up.
+ */
+static void _test3()
+{
+  ClientThread client;
+  SendQueueStats stats;
+  uint8_t* buffer = malloc(BLOCKER_SIZE);
+  int fds[2];
+  int idx;
+  char byte;
+
+  printf ("Test #3: Disconnect a client that does not read\n");
+  _connect(&client, fds);
+  _blockSender(&client, buffer);
+  for (idx = 1; idx <= TEST_QUEUE_LIMIT; idx++)
+  {
+    assert_int(_queueNotification(&client, idx, SRX_FLAG_ROA,
+                                  SRx_RESULT_VALID, 0), true, "Queue result");
+  }
+  // A receipt is never merged.
+  assert_int(_queueNotification(&client, 1,
+                                SRX_FLAG_ROA | SRX_FLAG_REQUEST_RECEIPT,
+                                SRx_RESULT_VALID, 0), false, "Overflow");
+  getSendQueueStats(&stats);
+  assert_int(stats.overflows, 1, "Overflow counted");
+  assert_int(_queueNotification(&client, 5, SRX_FLAG_ROA, SRx_RESULT_VALID,
+                                0), false, "Client disconnected");
+  // The receiver does not wait for credits of a dropped client.
+  assert_int(acquireClientCredit(&client), false, "No credit after overflow");
+
+  // The connection is shut down, the proxy reads until the end.
+  while (recv(fds[1], &byte, 1, 0) > 0);
+
+  _disconnect(&client, fds);
+  free(buffer);
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  memset(&_svrSock, 0, sizeof(ServerSocket));
+  _svrSock.mode = MODE_SINGLE_CLIENT;
+
+  assert_int(createSendQueue(TEST_QUEUE_LIMIT, TEST_WINDOW), true,
+             "Create send queue");
+  assert_int(startSendQueue(), true, "Start send queue");
+
+  _test1();
+  _test2();
+  _test3();
+
+  releaseSendQueue();
+
+  return (EXIT_SUCCESS);
+}
@@ -0,0 +1,390 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the shared memory transport. A forked child
+ * process plays the server and echoes the messages it receives. The same
+ * exchange is measured over TCP and over the shared memory rings to compare
+ * the round trip latency and the throughput of both transports.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "util/shm_ring.h"
+#include "util/socket.h"
+
+#define NO_MESSAGES    20000
+#define MAX_MSG_SIZE   3000
+#define NO_PINGS       20000
+#define PING_SIZE      64
+#define STREAM_BYTES   (256 * 1024 * 1024)
+#define STREAM_SIZE    1024
+
+/** The header of each test message. A length of zero ends the exchange. */
+typedef struct {
+  uint32_t length;
+  uint32_t echo;
+} TestHeader;
+
+/** One side of the connection. If shm is NULL the socket carries the data. */
+typedef struct {
+  int         fd;
+  ShmChannel* shm;
+} Transport;
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Return the current time in seconds.
+ *
+ * @return the time of the monotonic clock
+ */
+static double _now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Send through the transport.
+ *
+ * @param tp The transport
+ * @param buffer The data
+ * @param num The number of bytes
+ *
+ * @return true if all data is send.
+ */
+static bool _send(Transport* tp, void* buffer, size_t num)
+{
+  return (tp->shm != NULL) ? shmSendNum(tp->shm, &tp->fd, buffer, num)
+                           : sendNum(&tp->fd, buffer, num);
+}
+
+/**
+ * Receive from the transport.
+ *
+ * @param tp The transport
+ * @param buffer The buffer
+ * @param num The number of bytes
+ *
+ * @return true if all data is received.
+ */
+static bool _recv(Transport* tp, void* buffer, size_t num)
+{
+  return (tp->shm != NULL) ? shmRecvNum(tp->shm, &tp->fd, buffer, num)
+                           : recvNum(&tp->fd, buffer, num);
+}
+
+/**
+ * Create a connected pair of TCP sockets over the loopback interface.
+ *
+ * @param clientFD (out) The client side
+ * @param serverFD (out) The server side
+ */
+static void _connectPair(int* clientFD, int* serverFD)
+{
+  struct sockaddr_in addr;
+  socklen_t addrLen = sizeof(struct sockaddr_in);
+  int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+  int one      = 1;
+
+  memset(&addr, 0, sizeof(struct sockaddr_in));
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  assert_int(bind(listenFD, (struct sockaddr*)&addr, addrLen), 0, "bind");
+  assert_int(listen(listenFD, 1), 0, "listen");
+  getsockname(listenFD, (struct sockaddr*)&addr, &addrLen);
+
+  *clientFD = socket(AF_INET, SOCK_STREAM, 0);
+  assert_int(connect(*clientFD, (struct sockaddr*)&addr, addrLen), 0,
+             "connect");
+  *serverFD = accept(listenFD, NULL, NULL);
+  close(listenFD);
+
+  // Give TCP its best latency.
+  setsockopt(*clientFD, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(int));
+  setsockopt(*serverFD, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(int));
+}
+
+/**
+ * The server process. Echo all messages that request it and confirm the end
+ * of the exchange.
+ *
+ * @param tp The transport
+ */
+static void _echoServer(Transport* tp)
+{
+  uint8_t*    buffer = malloc(sizeof(TestHeader) + MAX_MSG_SIZE);
+  TestHeader* hdr    = (TestHeader*)buffer;
+
+  while (_recv(tp, hdr, sizeof(TestHeader)))
+  {
+    if (hdr->length == 0)
+    {
+      _send(tp, hdr, sizeof(TestHeader));
+      break;
+    }
+    if (!_recv(tp, buffer + sizeof(TestHeader), hdr->length))
+    {
+      break;
+    }
+    if (hdr->echo)
+    {
+      _send(tp, buffer, sizeof(TestHeader) + hdr->length);
+    }
+  }
+  free(buffer);
+}
+
+/**
+ * Fork the echo server and connect to it.
+ *
+ * @param client (out) The client side of the connection
+ * @param shm The channel to use or NULL for TCP
+ * @param ringSize The ring size of the channel
+ *
+ * @return the pid of the server process
+ */
+static pid_t _startServer(Transport* client, ShmChannel* shm,
+                          uint32_t ringSize)
+{
+  char  name[SHM_NAME_LENGTH];
+  int   serverFD;
+  pid_t pid;
+
+  _connectPair(&client->fd, &serverFD);
+  client->shm = NULL;
+  if (shm != NULL)
+  {
+    snprintf(name, SHM_NAME_LENGTH, "/srx-test-%u", (uint32_t)getpid());
+    assert_int(createShmChannel(shm, name, ringSize), true, "Create channel");
+    client->shm = shm;
+  }
+
+  pid = fork();
+  if (pid == 0)
+  {
+    ShmChannel svrShm;
+    Transport  server = { serverFD, NULL };
+    close(client->fd);
+    if (shm != NULL)
+    {
+      if (!attachShmChannel(&svrShm, name))
+      {
+        _exit(EXIT_FAILURE);
+      }
+      server.shm = &svrShm;
+    }
+    _echoServer(&server);
+    if (server.shm != NULL)
+    {
+      releaseShmChannel(server.shm);
+    }
+    close(serverFD);
+    _exit(EXIT_SUCCESS);
+  }
+  close(serverFD);
+
+  return pid;
+}
+
+/**
+ * End the exchange, wait for the server process and release the client side.
+ *
+ * @param client The client side of the connection
+ * @param pid The server process
+ */
+static void _stopServer(Transport* client, pid_t pid)
+{
+  TestHeader hdr = { 0, 0 };
+  int status = EXIT_FAILURE;
+
+  assert_int(_send(client, &hdr, sizeof(TestHeader)), true, "Send end");
+  assert_int(_recv(client, &hdr, sizeof(TestHeader)), true, "Receive end");
+  waitpid(pid, &status, 0);
+  assert_int(WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS),
+             true, "Server process");
+  if (client->shm != NULL)
+  {
+    unlinkShmChannel(client->shm);
+    releaseShmChannel(client->shm);
+  }
+  close(client->fd);
+}
+
+/**
+ * Send messages of different sizes through a small ring and verify the echo.
+ * The ring wraps around and fills up many times.
+ */
+static void _test1()
+{
+  printf ("Test #1: Echo %i messages through a ring of %u bytes\n",
+          NO_MESSAGES, SHM_MIN_RING_SIZE);
+  ShmChannel shm;
+  Transport  client;
+  uint8_t*   msg    = malloc(sizeof(TestHeader) + MAX_MSG_SIZE);
+  uint8_t*   echo   = malloc(sizeof(TestHeader) + MAX_MSG_SIZE);
+  TestHeader* hdr   = (TestHeader*)msg;
+  pid_t      pid    = _startServer(&client, &shm, SHM_MIN_RING_SIZE);
+  int idx, pos;
+
+  for (idx = 0; idx < NO_MESSAGES; idx++)
+  {
+    hdr->length = 1 + ((idx * 7919) % MAX_MSG_SIZE);
+    hdr->echo   = 1;
+    for (pos = 0; pos < hdr->length; pos++)
+    {
+      msg[sizeof(TestHeader) + pos] = (uint8_t)(idx + pos);
+    }
+    assert_int(_send(&client, msg, sizeof(TestHeader) + hdr->length), true,
+               "Send message");
+    assert_int(_recv(&client, echo, sizeof(TestHeader) + hdr->length), true,
+               "Receive echo");
+    assert_int(memcmp(msg, echo, sizeof(TestHeader) + hdr->length), 0,
+               "Echo content");
+  }
+  _stopServer(&client, pid);
+
+  free(msg);
+  free(echo);
+  printf ("         %llu doorbells for %i messages\n",
+          (unsigned long long)shm.doorbells, NO_MESSAGES);
+  printf ("         passed.\n");
+}
+
+/**
+ * Measure the round trip time of small messages.
+ *
+ * @param useShm Use the shared memory transport instead of TCP.
+ *
+ * @return the round trip time in micro seconds.
+ */
+static double _benchLatency(bool useShm)
+{
+  ShmChannel shm;
+  Transport  client;
+  uint8_t    msg[sizeof(TestHeader) + PING_SIZE];
+  TestHeader* hdr = (TestHeader*)msg;
+  pid_t      pid  = _startServer(&client, useShm ? &shm : NULL,
+                                 SHM_DEF_RING_SIZE);
+  double     start;
+  int idx;
+
+  memset(msg, 0xAA, sizeof(msg));
+  hdr->length = PING_SIZE;
+  hdr->echo   = 1;
+  start = _now();
+  for (idx = 0; idx < NO_PINGS; idx++)
+  {
+    assert_int(_send(&client, msg, sizeof(msg)), true, "Send ping");
+    assert_int(_recv(&client, msg, sizeof(msg)), true, "Receive pong");
+  }
+  start = _now() - start;
+  _stopServer(&client, pid);
+
+  return (start * 1e6) / NO_PINGS;
+}
+
+/**
+ * Measure the throughput of a stream of messages that are not echoed.
+ *
+ * @param useShm Use the shared memory transport instead of TCP.
+ *
+ * @return the throughput in MB per second.
+ */
+static double _benchThroughput(bool useShm)
+{
+  ShmChannel shm;
+  Transport  client;
+  uint8_t    msg[sizeof(TestHeader) + STREAM_SIZE];
+  TestHeader* hdr = (TestHeader*)msg;
+  pid_t      pid  = _startServer(&client, useShm ? &shm : NULL,
+                                 SHM_DEF_RING_SIZE);
+  double     start;
+  uint64_t   sent;
+
+  memset(msg, 0x55, sizeof(msg));
+  hdr->length = STREAM_SIZE;
+  hdr->echo   = 0;
+  start = _now();
+  for (sent = 0; sent < STREAM_BYTES; sent += sizeof(msg))
+  {
+    assert_int(_send(&client, msg, sizeof(msg)), true, "Send message");
+  }
+  // The end message is confirmed once all messages are consumed.
+  _stopServer(&client, pid);
+  start = _now() - start;
+
+  return (sent / (1024.0 * 1024.0)) / start;
+}
+
+/**
+ * Compare the latency and throughput of TCP and the shared memory transport.
+ */
+static void _test2()
+{
+  printf ("Test #2: Compare TCP and shared memory transport\n");
+  double tcpRTT  = _benchLatency(false);
+  double shmRTT  = _benchLatency(true);
+  printf ("         Round trip (%u bytes): TCP %8.2f us  SHM %8.2f us\n",
+          PING_SIZE, tcpRTT, shmRTT);
+  double tcpRate = _benchThroughput(false);
+  double shmRate = _benchThroughput(true);
+  printf ("         Throughput (%u bytes): TCP %8.1f MB/s SHM %8.1f MB/s\n",
+          STREAM_SIZE, tcpRate, shmRate);
+  printf ("         passed.\n");
+}
+
+/*
+ * Test the shared memory transport
+ */
+int main(int argc, char** argv)
+{
+  _test1();
+  _test2();
+
+  return (EXIT_SUCCESS);
+}
@@ -0,0 +1,269 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the snapshot. The last test measures the
+ * time needed to restore the AS path cache. The restart of the RPKI handler 
+ * with the update cache and the RTR sessions is tested in test_rpki_failover.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "server/aspath_cache.h"
+#include "server/snapshot.h"
+
+#define NO_PATHS     100000
+#define MAX_PATH_LEN 20
+
+/** The snapshot file used by the tests. */
+static char _fileName[64];
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    unlink(_fileName);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Modify the byte at the given position of the snapshot file.
+ *
+ * @param pos The position within the file.
+ * @param value The new value.
+ */
+static void _patchFile(long pos, uint8_t value)
+{
+  FILE* file = fopen(_fileName, "r+b");
+
+  assert_int(file != NULL, true, "Open the snapshot");
+  fseek(file, pos, SEEK_SET);
+  fwrite(&value, 1, 1, file);
+  fclose(file);
+}
+
+/**
+ * Write a snapshot with two sections, the data of the first section is not
+ * 4 byte aligned.
+ */
+static void _writeSections()
+{
+  SnapshotWriter writer;
+  uint32_t       values[] = { 1, 2, 3 };
+
+  assert_int(openSnapshotWriter(&writer, _fileName), true, "Open the writer");
+  assert_int(beginSnapshotSection(&writer, SNAP_SEC_ROA), true, "Section 1");
+  assert_int(addSnapshotData(&writer, "abcde", 5), true, "Add unaligned data");
+  assert_int(addSnapshotData(&writer, values, sizeof(values)), true,
+             "Add aligned data");
+  assert_int(endSnapshotSection(&writer, 2), true, "End section 1");
+  assert_int(beginSnapshotSection(&writer, SNAP_SEC_KEY), true, "Section 2");
+  assert_int(endSnapshotSection(&writer, 0), true, "End section 2");
+  assert_int(closeSnapshotWriter(&writer, true), true, "Commit the snapshot");
+}
+
+/**
+ * Test writing and reading raw sections.
+ */
+static void _test1()
+{
+  SnapshotWriter  writer;
+  SnapshotReader  reader;
+  SnapshotCursor  cursor;
+  const uint32_t* values;
+
+  printf ("Test #1: Write and read sections\n");
+  _writeSections();
+  assert_int(access(_fileName, F_OK), 0, "Snapshot exists");
+
+  assert_int(openSnapshotReader(&reader, _fileName), true, "Open the reader");
+  assert_int(reader.header.noSections, 2, "Number of sections");
+  assert_int(findSnapshotSection(&reader, SNAP_SEC_ASPA, &cursor), false,
+             "Find missing section");
+  assert_int(findSnapshotSection(&reader, SNAP_SEC_ROA, &cursor), true,
+             "Find section 1");
+  assert_int(cursor.count, 2, "Records in section 1");
+  assert_int(memcmp(getSnapshotData(&cursor, 5), "abcde", 5), 0,
+             "Unaligned data");
+  values = getSnapshotData(&cursor, 3 * sizeof(uint32_t));
+  assert_int(values != NULL, true, "Aligned data");
+  assert_int(((uintptr_t)values) % 4, 0, "Alignment");
+  assert_int(values[2], 3, "Value of the aligned data");
+  assert_int(getSnapshotData(&cursor, 8) == NULL, true, "Read behind section");
+  assert_int(findSnapshotSection(&reader, SNAP_SEC_KEY, &cursor), true,
+             "Find section 2");
+  assert_int(cursor.count, 0, "Records in section 2");
+  closeSnapshotReader(&reader);
+
+  // A discarded snapshot does not replace the existing one.
+  assert_int(openSnapshotWriter(&writer, _fileName), true, "Open the writer");
+  assert_int(beginSnapshotSection(&writer, SNAP_SEC_ASPA), true, "Section");
+  assert_int(endSnapshotSection(&writer, 0), true, "End section");
+  assert_int(closeSnapshotWriter(&writer, false), false, "Discard");
+  assert_int(openSnapshotReader(&reader, _fileName), true, "Reopen");
+  assert_int(reader.header.noSections, 2, "Previous snapshot kept");
+  closeSnapshotReader(&reader);
+
+  printf ("         passed.\n");
+}
+
+/**
+ * Test that damaged snapshots are not used.
+ */
+static void _test2()
+{
+  SnapshotReader reader;
+  long           dataPos = sizeof(SnapshotHeader) + sizeof(SnapshotSection);
+
+  printf ("Test #2: Reject damaged snapshots\n");
+  _writeSections();
+  _patchFile(dataPos, 'x');
+  assert_int(openSnapshotReader(&reader, _fileName), false, "Corrupted data");
+  assert_int(reader.data == NULL, true, "Corrupted snapshot unmapped");
+
+  _writeSections();
+  _patchFile(offsetof(SnapshotHeader, version), SNAPSHOT_VERSION + 1);
+  assert_int(openSnapshotReader(&reader, _fileName), false, "Other version");
+
+  _writeSections();
+  assert_int(truncate(_fileName, dataPos), 0, "Truncate the snapshot");
+  assert_int(openSnapshotReader(&reader, _fileName), false, "Truncated");
+
+  unlink(_fileName);
+  assert_int(openSnapshotReader(&reader, _fileName), false, "Missing file");
+
+  printf ("         passed.\n");
+}
+
+/**
+ * Store the test path of the given ID and reference it.
+ *
+ * @param cache The AS path cache
+ * @param pathId The path ID, not zero
+ */
+static void _storePath(AspathCache* cache, uint32_t pathId)
+{
+  uint32_t path[MAX_PATH_LEN];
+  uint16_t length = 1 + (pathId % MAX_PATH_LEN);
+  int      idx;
+
+  for (idx = 0; idx < length; idx++)
+  {
+    path[idx] = pathId * 100 + idx;
+  }
+  AS_PATH_LIST* aspl = newAspathListEntry(length, path, pathId, AS_SEQUENCE,
+                                          ASPA_UPSTREAM, AFI_IP, false);
+  storeAspathList(cache, NULL, pathId, AS_SEQUENCE, aspl);
+  deleteAspathListEntry(aspl);
+  addAspathListReference(cache, pathId);
+}
+
+/**
+ * Test the snapshot of the AS path cache and measure the time needed to
+ * restore it.
+ */
+static void _test3()
+{
+  AspathCache     cache;
+  SnapshotWriter  writer;
+  SnapshotReader  reader;
+  AS_PATH_LIST*   aspl;
+  SRxResult       srxRes;
+  struct timespec start, end;
+  uint32_t        pathId;
+
+  printf ("Test #3: Restore %u AS paths\n", NO_PATHS);
+  assert_int(createAspathCache(&cache, NULL), true, "Create the cache");
+  for (pathId = 1; pathId <= NO_PATHS; pathId++)
+  {
+    _storePath(&cache, pathId);
+  }
+  modifyAspaValidationResultToAspathCache(&cache, 7, SRx_RESULT_INVALID, 99);
+  // Paths without updates are not written.
+  aspl = newAspathListEntry(1, &pathId, pathId, AS_SEQUENCE, ASPA_UPSTREAM,
+                            AFI_IP, false);
+  storeAspathList(&cache, NULL, pathId, AS_SEQUENCE, aspl);
+  deleteAspathListEntry(aspl);
+
+  assert_int(openSnapshotWriter(&writer, _fileName), true, "Open the writer");
+  assert_int(writeAspathCacheSnapshot(&cache, &writer), true, "Write paths");
+  assert_int(closeSnapshotWriter(&writer, true), true, "Commit the snapshot");
+  releaseAspathCache(&cache);
+
+  assert_int(createAspathCache(&cache, NULL), true, "Create the cache");
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  assert_int(openSnapshotReader(&reader, _fileName), true, "Open the reader");
+  assert_int(readAspathCacheSnapshot(&cache, &reader), NO_PATHS,
+             "Restored paths");
+  closeSnapshotReader(&reader);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  for (pathId = 1; pathId <= NO_PATHS; pathId += 997)
+  {
+    aspl = getAspathListFromAspathCache(&cache, pathId, &srxRes);
+    assert_int(aspl != NULL, true, "Find the restored path");
+    assert_int(aspl->asPathLength, 1 + (pathId % MAX_PATH_LEN),
+               "Length of the restored path");
+    assert_int(aspl->asPathList[aspl->asPathLength - 1],
+               pathId * 100 + aspl->asPathLength - 1,
+               "Origin of the restored path");
+    deleteAspathListEntry(aspl);
+  }
+  aspl = getAspathListFromAspathCache(&cache, 7, &srxRes);
+  assert_int(srxRes.aspaResult, SRx_RESULT_INVALID, "Restored ASPA result");
+  deleteAspathListEntry(aspl);
+  assert_int(getAspathListFromAspathCache(&cache, NO_PATHS + 1, &srxRes)
+             == NULL, true, "Path without update");
+  releaseAspathCache(&cache);
+
+  printf ("         restored within %ld ms.\n",
+          (long)((end.tv_sec - start.tv_sec) * 1000
+                 + (end.tv_nsec - start.tv_nsec) / 1000000));
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  snprintf(_fileName, sizeof(_fileName), "/tmp/test_snapshot.%d", getpid());
+
+  _test1();
+  _test2();
+  _test3();
+
+  unlink(_fileName);
+  return (EXIT_SUCCESS);
+}
@@ -0,0 +1,226 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the managed timers.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "util/timer.h"
+
+#define NO_TIMERS  5
+
+/** The number of calls per timer id. */
+static int       _fired[NO_TIMERS * 2];
+/** The time of the last call per timer id in milliseconds. */
+static uint64_t  _firedAt[NO_TIMERS * 2];
+/** The thread of the last call. */
+static pthread_t _firedBy;
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(long long val, long long expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %lld but received %lld\n", error, expected,
+            val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Return the current time in milliseconds.
+ *
+ * @return the time of the monotonic clock
+ */
+static uint64_t _now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Count the call of the timer.
+ *
+ * @param id The timer id
+ * @param now The current time
+ */
+static void _expired(int id, time_t now)
+{
+  __atomic_store_n(&_firedAt[id], _now(), __ATOMIC_RELAXED);
+  __atomic_fetch_add(&_fired[id], 1, __ATOMIC_RELAXED);
+  _firedBy = pthread_self();
+}
+
+/**
+ * Stop the timer from within its own callback.
+ *
+ * @param id The timer id
+ * @param now The current time
+ */
+static void _stopSelf(int id, time_t now)
+{
+  _expired(id, now);
+  stopTimer(id);
+}
+
+/**
+ * Test one shot timers in the order of their deadline.
+ */
+static void _test1()
+{
+  int      ids[NO_TIMERS];
+  uint64_t start;
+  int      idx;
+
+  printf ("Test #1: One shot timers\n");
+  memset(_fired, 0, sizeof(_fired));
+  for (idx = 0; idx < NO_TIMERS; idx++)
+  {
+    ids[idx] = setupTimer(_expired);
+    assert_int(ids[idx], idx, "Timer id");
+  }
+  start = _now();
+  // Started in reverse order of the deadline.
+  for (idx = NO_TIMERS - 1; idx >= 0; idx--)
+  {
+    startIntervalTimerMs(ids[idx], 50 + idx * 20, true);
+    assert_int(isActiveTimer(ids[idx]), true, "Timer active");
+  }
+  usleep(250000);
+  for (idx = 0; idx < NO_TIMERS; idx++)
+  {
+    assert_int(_fired[idx], 1, "One shot timer fired once");
+    assert_int(isActiveTimer(ids[idx]), false, "One shot timer inactive");
+    assert_int(_firedAt[idx] - start >= 50 + idx * 20, true,
+               "Timer not fired early");
+    assert_int(_firedAt[idx] - start < 50 + idx * 20 + 40, true,
+               "Timer fired within 40 ms");
+  }
+  assert_int(pthread_equal(_firedBy, pthread_self()), false,
+             "Callback called by the timer thread");
+  deleteAllTimers();
+
+  printf ("         passed.\n");
+}
+
+/**
+ * Test interval timers, stop and delete.
+ */
+static void _test2()
+{
+  int interval;
+  int stopped;
+  int deleted;
+  int self;
+  int reused;
+
+  printf ("Test #2: Interval timers, stop and delete\n");
+  memset(_fired, 0, sizeof(_fired));
+  interval = setupTimer(_expired);
+  stopped  = setupTimer(_expired);
+  deleted  = setupTimer(_expired);
+  self     = setupTimer(_stopSelf);
+  startIntervalTimerMs(interval, 20, false);
+  startIntervalTimerMs(stopped, 30, false);
+  startIntervalTimerMs(deleted, 30, false);
+  startIntervalTimerMs(self, 10, false);
+  stopTimer(stopped);
+  deleteTimer(deleted);
+  assert_int(isActiveTimer(stopped), false, "Stopped timer inactive");
+  assert_int(isActiveTimer(deleted), false, "Deleted timer inactive");
+  // The ids of the other timers do not change.
+  assert_int(isActiveTimer(self), true, "Timer after the deleted one");
+  usleep(210000);
+  assert_int(_fired[interval] >= 9 && _fired[interval] <= 11, true,
+             "Interval timer fired repeatedly");
+  assert_int(_fired[stopped], 0, "Stopped timer not fired");
+  assert_int(_fired[deleted], 0, "Deleted timer not fired");
+  assert_int(_fired[self], 1, "Timer stopped by its callback");
+
+  reused = setupTimer(_expired);
+  assert_int(reused, deleted, "Id of the deleted timer reused");
+  stopTimer(interval);
+  _fired[interval] = 0;
+  usleep(50000);
+  assert_int(_fired[interval], 0, "Interval timer stopped");
+  assert_int(isActiveTimer(interval), false, "Interval timer inactive");
+  deleteAllTimers();
+  assert_int(isActiveTimer(interval), false, "All timers deleted");
+
+  printf ("         passed.\n");
+}
+
+/**
+ * Test the restart of a timer and absolute timers.
+ */
+static void _test3()
+{
+  int      restart;
+  int      absolute;
+  uint64_t start;
+
+  printf ("Test #3: Restart and absolute timers\n");
+  memset(_fired, 0, sizeof(_fired));
+  restart  = setupTimer(_expired);
+  absolute = setupTimer(_expired);
+  start = _now();
+  startIntervalTimerMs(restart, 30, true);
+  usleep(20000);
+  // Moves the deadline out.
+  startIntervalTimerMs(restart, 60, true);
+  startAbsoluteTimer(absolute, time(NULL) - 1);
+  assert_int(isActiveTimer(absolute), false, "Time in the past ignored");
+  startAbsoluteTimer(absolute, time(NULL) + 1);
+  usleep(100000);
+  assert_int(_fired[restart], 1, "Restarted timer fired once");
+  assert_int(_firedAt[restart] - start >= 80, true, "Restarted deadline");
+  assert_int(_fired[absolute], 0, "Absolute timer not fired yet");
+  usleep(1000000);
+  assert_int(_fired[absolute], 1, "Absolute timer fired");
+  deleteAllTimers();
+
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  _test1();
+  _test2();
+  _test3();
+
+  return (EXIT_SUCCESS);
+}
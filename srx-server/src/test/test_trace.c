@@ -0,0 +1,299 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the update trace. The second test drains
+ * the rings while multiple threads trace updates.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "server/trace.h"
+
+#define NO_THREADS   4
+#define NO_UPDATES   200000
+#define SAMPLE_RATE  8
+
+/** The dump file used by the tests. */
+static char          _fileName[64];
+/** Tells the drain thread to stop. */
+static volatile bool _stopDrain = false;
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(long long val, long long expected, char* error)
+{
+  if (val != expected)
+  {
+    printf ("Error: %s; Expected %lld but received %lld\n", error, expected,
+            val);
+    unlink(_fileName);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Read all events of the dump file.
+ *
+ * @param noEvents (out) The number of events.
+ * @param dropped (out) The number of dropped events.
+ *
+ * @return the events which must be freed.
+ */
+static TraceEvent* _readDump(uint32_t* noEvents, uint64_t* dropped)
+{
+  TraceBlockHeader header;
+  TraceEvent*      events = malloc(sizeof(TraceEvent));
+  TraceEvent*      block;
+  FILE*            file = fopen(_fileName, "rb");
+  bool             valid;
+
+  *noEvents = 0;
+  *dropped  = 0;
+  assert_int(file != NULL, true, "Open the dump");
+  while ((valid = readTraceBlock(file, &header, &block)) && (block != NULL))
+  {
+    assert_int(header.sampleRate, SAMPLE_RATE, "Sample rate of the block");
+    events = realloc(events, sizeof(TraceEvent)
+                             * (*noEvents + header.noEvents + 1));
+    memcpy(events + *noEvents, block, sizeof(TraceEvent) * header.noEvents);
+    *noEvents += header.noEvents;
+    *dropped  += header.dropped;
+    free(block);
+  }
+  assert_int(valid, true, "Dump read completely");
+  fclose(file);
+
+  return events;
+}
+
+/**
+ * Test the sampling.
+ */
+static void _test1()
+{
+  uint32_t updateID;
+  uint32_t traced = 0;
+
+  printf ("Test #1: Sampling\n");
+  assert_int(traceNow(1), 0, "Time before the trace is enabled");
+  assert_int(traceTime(), 0, "Clock before the trace is enabled");
+  assert_int(initTrace(0), true, "Sample rate zero");
+  assert_int(isUpdateTraced(1), false, "Trace stays disabled");
+
+  assert_int(initTrace(SAMPLE_RATE), true, "Enable the trace");
+  for (updateID = 0; updateID < NO_UPDATES; updateID++)
+  {
+    if (isUpdateTraced(updateID))
+    {
+      traced++;
+      assert_int(traceNow(updateID) != 0, true, "Time of a traced update");
+    }
+    else
+    {
+      assert_int(traceNow(updateID), 0, "Time of an update not traced");
+    }
+  }
+  // Consecutive IDs (collisions) are sampled like any other ID.
+  assert_int((traced > (NO_UPDATES / SAMPLE_RATE) * 9 / 10)
+             && (traced < (NO_UPDATES / SAMPLE_RATE) * 11 / 10), true,
+             "Share of traced updates");
+  releaseTrace();
+  assert_int(isUpdateTraced(0), false, "Trace released");
+
+  printf ("         %u of %u updates traced.\n", traced, NO_UPDATES);
+  printf ("         passed.\n");
+}
+
+/**
+ * Pass the updates of this thread through all points.
+ *
+ * @param arg The number of the thread.
+ *
+ * @return NULL
+ */
+static void* _traceUpdates(void* arg)
+{
+  uint32_t    thread = (uint32_t)(uintptr_t)arg;
+  SRxUpdateID updateID;
+  uint64_t    received;
+  int         idx;
+  int         point;
+
+  for (idx = 0; idx < NO_UPDATES / NO_THREADS; idx++)
+  {
+    updateID = thread * NO_UPDATES + idx;
+    received = traceTime();
+    if (isUpdateTraced(updateID))
+    {
+      traceUpdateAt(updateID, TRC_POINT_RECEIVE, received);
+    }
+    for (point = TRC_POINT_QUEUED; point < TRC_NUM_POINTS; point++)
+    {
+      traceUpdate(updateID, point);
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Drain the rings until stopped.
+ *
+ * @param arg Not used.
+ *
+ * @return NULL
+ */
+static void* _drain(void* arg)
+{
+  uint32_t noEvents;
+
+  while (!_stopDrain)
+  {
+    assert_int(dumpTrace(_fileName, &noEvents), true, "Drain the rings");
+    usleep(1000);
+  }
+
+  return NULL;
+}
+
+/**
+ * Drain the rings while multiple threads trace updates. The threads are
+ * started twice, the second threads reuse the rings of the first ones.
+ */
+static void _test2()
+{
+  pthread_t   threads[NO_THREADS];
+  pthread_t   drainer;
+  TraceEvent* events;
+  uint32_t    noEvents;
+  uint64_t    dropped;
+  uint32_t    expected = 0;
+  uint32_t    idx;
+  int         run;
+
+  printf ("Test #2: Drain while %u threads trace %u updates\n", NO_THREADS,
+          NO_UPDATES);
+  unlink(_fileName);
+  assert_int(initTrace(SAMPLE_RATE), true, "Enable the trace");
+  pthread_create(&drainer, NULL, _drain, NULL);
+  for (run = 0; run < 2; run++)
+  {
+    for (idx = 0; idx < NO_THREADS; idx++)
+    {
+      pthread_create(&threads[idx], NULL, _traceUpdates,
+                     (void*)(uintptr_t)idx);
+    }
+    for (idx = 0; idx < NO_THREADS; idx++)
+    {
+      pthread_join(threads[idx], NULL);
+    }
+  }
+  _stopDrain = true;
+  pthread_join(drainer, NULL);
+  assert_int(dumpTrace(_fileName, &noEvents), true, "Drain the rest");
+
+  for (idx = 0; idx < NO_THREADS * NO_UPDATES; idx++)
+  {
+    if (((idx % NO_UPDATES) < NO_UPDATES / NO_THREADS) && isUpdateTraced(idx))
+    {
+      expected += 2 * TRC_NUM_POINTS;
+    }
+  }
+  releaseTrace();
+
+  events = _readDump(&noEvents, &dropped);
+  assert_int(noEvents + dropped, expected, "Events written and dropped");
+  for (idx = 0; idx < noEvents; idx++)
+  {
+    assert_int(events[idx].point < TRC_NUM_POINTS, true, "Point of an event");
+    assert_int(events[idx].thread < NO_THREADS, true, "Rings are reused");
+  }
+  free(events);
+
+  printf ("         %u events, %llu dropped.\n", noEvents,
+          (unsigned long long)dropped);
+  printf ("         passed.\n");
+}
+
+/**
+ * Fill a ring without draining it.
+ */
+static void _test3()
+{
+  TraceEvent* events;
+  uint32_t    noEvents;
+  uint64_t    dropped;
+  uint32_t    updateID = 0;
+  uint32_t    idx;
+
+  printf ("Test #3: Full ring\n");
+  unlink(_fileName);
+  assert_int(initTrace(SAMPLE_RATE), true, "Enable the trace");
+  for (idx = 0; idx < TRACE_RING_SIZE + 10; idx++)
+  {
+    while (!isUpdateTraced(updateID))
+    {
+      updateID++;
+    }
+    traceUpdate(updateID, TRC_POINT_RECEIVE);
+    updateID++;
+  }
+  assert_int(dumpTrace(_fileName, &noEvents), true, "Drain the ring");
+  assert_int(noEvents, TRACE_RING_SIZE, "Events of a full ring");
+  // The ring accepts events again.
+  traceUpdate(updateID - 1, TRC_POINT_SENT);
+  assert_int(dumpTrace(_fileName, &noEvents), true, "Drain the ring again");
+  assert_int(noEvents, 1, "Event after the drain");
+  releaseTrace();
+  assert_int(dumpTrace(_fileName, &noEvents), false, "Drain a released trace");
+
+  events = _readDump(&noEvents, &dropped);
+  assert_int(noEvents, TRACE_RING_SIZE + 1, "Events in the dump");
+  assert_int(dropped, 10, "Dropped events");
+  assert_int(events[TRACE_RING_SIZE].point, TRC_POINT_SENT, "Last event");
+  free(events);
+
+  printf ("         passed.\n");
+}
+
+int main(int argc, char** argv)
+{
+  snprintf(_fileName, sizeof(_fileName), "/tmp/test_trace.%d", getpid());
+
+  _test1();
+  _test2();
+  _test3();
+
+  unlink(_fileName);
+  return (EXIT_SUCCESS);
+}
@@ -276,7 +276,7 @@ void demo_handleASPA(uint32_t valCacheID, uint16_t sessionID, bool isAnn,
     memset(strBuffer, 0, 512);
 
     RPKIHandler* handler = (RPKIHandler*)rpkiHandler;
-    RPKIRouterClient* rpkiRtrClient = &(handler->rrclInstance);
+    RPKIRouterClient* rpkiRtrClient = &(handler->sessions[0].rrclInstance);
 
     for (uint32_t idx= 0; idx < providerCt; idx++)
     {
@@ -609,8 +609,8 @@ int main(int argc, const char* argv[])
 
   RPKIHandler rpkiHandler;
   memset(&rpkiHandler, 0, sizeof(RPKIHandler));
-  RPKIRouterClientParams* params = &(rpkiHandler.rrclParams);
-  RPKIRouterClient*       client = &(rpkiHandler.rrclInstance);
+  RPKIRouterClientParams* params = &(rpkiHandler.sessions[0].rrclParams);
+  RPKIRouterClient*       client = &(rpkiHandler.sessions[0].rrclInstance);
 
 //  memset (&client, 0, sizeof(RPKIRouterClient));
 //  memset (&params, 0, sizeof(RPKIRouterClientParams));
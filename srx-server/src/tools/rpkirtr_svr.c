@@ -254,8 +254,52 @@ typedef struct {
   uint16_t  providerCount;
   /** List of providers == NULL if provider count = 0*/
   uint8_t* providerAS;
+
+  /** The PDU of this entry in wire format. The version is set while sending.
+   * @since 0.6.3.0 */
+  uint8_t*  pdu;
+  /** The length of the PDU. */
+  uint32_t  pduLength;
+  /** The lowest protocol version the PDU can be send with. */
+  uint8_t   minVersion;
+  /** The key of the router key index (SKI followed by the AS number). */
+  uint8_t   indexKey[SKI_LENGTH + 4];
+  /** Hash handle of the ASPA or router key index. */
+  UT_hash_handle hh;
 } ValCacheEntry;
 
+/**
+ * The PDUs of all announcements in the cache, send after a reset query.
+ *
+ * @since 0.6.3.0
+ */
+typedef struct {
+  /** The PDUs in wire format. */
+  uint8_t*  data;
+  /** The number of bytes used. */
+  size_t    length;
+  /** The number of bytes allocated. */
+  size_t    size;
+  /** The cache generation the PDUs were collected for. */
+  uint32_t  generation;
+  /** Indicates if the PDUs were collected at all. */
+  bool      prepared;
+} ResetImage;
+
+/**
+ * Collects PDUs and sends them once the buffer is full. Without a socket the
+ * buffer grows instead.
+ *
+ * @since 0.6.3.0
+ */
+typedef struct {
+  uint8_t*  data;
+  size_t    length;
+  size_t    size;
+  /** The socket the PDUs are send to or NULL. */
+  int*      fdPtr;
+} PDUBuffer;
+
 /** Single client */
 typedef struct {
   /** Socket - but also the hash identifier */
@@ -326,6 +370,8 @@ const int   CACHE_EXPIRATION_INTERVAL = 3600; ///< Sec. to keep removed entries
 #define OFFSET_PUBKEY 170
 #define OFFSET_SKI 130
 #define COMMAND_BUF_SIZE 256
+/** The PDUs are collected up to this size before they are send. */
+#define SEND_BUF_SIZE    65536
 /*-----------------
  * Global variables
  */
@@ -340,6 +386,26 @@ struct {
   uint32_t  refreshInterval; // = PDU_EOD_REFRESH_DEF;
   uint32_t  retryInterval;   // = PDU_EOD_RETRY_DEF;
   uint32_t  expireInterval;  // = PDU_EOD_EXPIRE_DEF;
+
+  // Indexes - see _syncCacheIndex (since 0.6.3.0)
+  /** The entries in the order of the list which is ordered by serial. */
+  ValCacheEntry** serialIndex;
+  uint32_t        indexSize;
+  uint32_t        indexCapacity;
+  /** The last node in the serial index. */
+  SListNode*      indexLast;
+  /** false if entries were moved or deleted and the index must be rebuilt. */
+  bool            indexValid;
+  /** The ASPA objects by customer AS. */
+  ValCacheEntry*  aspaIndex;
+  /** The router keys by SKI and AS. */
+  ValCacheEntry*  keyIndex;
+  /** Increased with each modification of the cache. */
+  uint32_t        generation;
+  /** Protects the preparation of the reset images. */
+  Mutex           imageMutex;
+  /** The PDUs send after a reset query per protocol version. */
+  ResetImage      resetImage[RPKI_RTR_PROTOCOL_VERSION + 1];
 } cache;
 
 struct {
@@ -574,6 +640,435 @@ bool sendCacheResponse(int* fdPtr, uint8_t version)
   return sendNum(fdPtr, &pdu, sizeof(RPKICacheResetHeader));
 }
 
+/**
+ * Create the PDU of the cache entry in wire format. The PDU must be created
+ * again once the entry is withdrawn.
+ *
+ * @param cEntry The cache entry.
+ *
+ * @return false if not enough memory is available.
+ *
+ * @since 0.6.3.0
+ */
+bool _buildPDU(ValCacheEntry* cEntry)
+{
+  uint32_t length;
+  uint16_t providers = 0;
+
+  if (cEntry->isKey)
+  {
+    length = sizeof(RPKIRouterKeyHeader);
+    cEntry->minVersion = 1;
+  }
+  else if (cEntry->isASPA)
+  {
+    // Withdrawals do not contain providers.
+    if ((cEntry->flags & PREFIX_FLAG_ANNOUNCEMENT) != 0)
+    {
+      providers = ntohs(cEntry->providerCount);
+    }
+    length = sizeof(RPKIASPAHeader) + (providers * 4);
+    cEntry->minVersion = 2;
+  }
+  else
+  {
+    length = cEntry->isV6 ? sizeof(RPKIIPv6PrefixHeader) 
+                          : sizeof(RPKIIPv4PrefixHeader);
+    cEntry->minVersion = 0;
+  }
+
+  if (cEntry->pduLength != length)
+  {
+    uint8_t* pdu = realloc(cEntry->pdu, length);
+    if (pdu == NULL)
+    {
+      ERRORF("Error: Not enough memory for the PDU!\n");
+      return false;
+    }
+    cEntry->pdu       = pdu;
+    cEntry->pduLength = length;
+  }
+  memset(cEntry->pdu, 0, length);
+
+  if (cEntry->isKey)
+  {
+    RPKIRouterKeyHeader* rkhdr = (RPKIRouterKeyHeader*)cEntry->pdu;
+    rkhdr->type   = PDU_TYPE_ROUTER_KEY;
+    rkhdr->flags  = cEntry->flags;
+    rkhdr->length = htonl(length);
+    memcpy(&rkhdr->ski, cEntry->ski, SKI_LENGTH);
+    rkhdr->as     = cEntry->asNumber;
+    memcpy(&rkhdr->keyInfo, cEntry->pPubKeyData, KEY_BIN_SIZE);
+  }
+  else if (cEntry->isASPA)
+  {
+    RPKIASPAHeader* aspahdr = (RPKIASPAHeader*)cEntry->pdu;
+    aspahdr->type              = PDU_TYPE_ASPA;
+    aspahdr->length            = htonl(length);
+    aspahdr->flags             = cEntry->flags;
+    aspahdr->provider_as_count = htons(providers);
+    aspahdr->customer_asn      = cEntry->asNumber;
+    if (providers != 0)
+    {
+      memcpy(cEntry->pdu + sizeof(RPKIASPAHeader), cEntry->providerAS, 
+             providers * 4);
+    }
+  }
+  else if (!cEntry->isV6)
+  {
+    RPKIIPv4PrefixHeader* v4hdr = (RPKIIPv4PrefixHeader*)cEntry->pdu;
+    v4hdr->type      = PDU_TYPE_IP_V4_PREFIX;
+    v4hdr->length    = htonl(length);
+    v4hdr->flags     = cEntry->flags;
+    v4hdr->prefixLen = cEntry->prefixLength;
+    v4hdr->maxLen    = cEntry->prefixMaxLength;
+    v4hdr->addr      = cEntry->address.v4;
+    v4hdr->as        = cEntry->asNumber;
+  }
+  else
+  {
+    RPKIIPv6PrefixHeader* v6hdr = (RPKIIPv6PrefixHeader*)cEntry->pdu;
+    v6hdr->type      = PDU_TYPE_IP_V6_PREFIX;
+    v6hdr->length    = htonl(length);
+    v6hdr->flags     = cEntry->flags;
+    v6hdr->prefixLen = cEntry->prefixLength;
+    v6hdr->maxLen    = cEntry->prefixMaxLength;
+    v6hdr->addr      = cEntry->address.v6;
+    v6hdr->as        = cEntry->asNumber;
+  }
+
+  return true;
+}
+
+/**
+ * Remove the entry from the ASPA or router key index if it is indexed.
+ *
+ * @param cEntry The cache entry.
+ *
+ * @since 0.6.3.0
+ */
+void _unindexEntry(ValCacheEntry* cEntry)
+{
+  ValCacheEntry* found = NULL;
+
+  if (cEntry->isASPA)
+  {
+    HASH_FIND(hh, cache.aspaIndex, &cEntry->asNumber, sizeof(uint32_t), found);
+    if (found == cEntry)
+    {
+      HASH_DEL(cache.aspaIndex, cEntry);
+    }
+  }
+  else if (cEntry->isKey)
+  {
+    HASH_FIND(hh, cache.keyIndex, cEntry->indexKey, sizeof(cEntry->indexKey),
+              found);
+    if (found == cEntry)
+    {
+      HASH_DEL(cache.keyIndex, cEntry);
+    }
+  }
+}
+
+/**
+ * Release the memory attached to the cache entry and remove it from the
+ * indexes. The entry itself is not freed.
+ *
+ * @param cEntry The cache entry.
+ *
+ * @since 0.6.3.0
+ */
+void _releaseEntry(ValCacheEntry* cEntry)
+{
+  _unindexEntry(cEntry);
+  free(cEntry->ski);
+  free(cEntry->pPubKeyData);
+  free(cEntry->providerAS);
+  free(cEntry->pdu);
+  cEntry->ski         = NULL;
+  cEntry->pPubKeyData = NULL;
+  cEntry->providerAS  = NULL;
+  cEntry->pdu         = NULL;
+  cEntry->pduLength   = 0;
+}
+
+/**
+ * Bring the serial index up to date after entries were added to the end of
+ * the list. If entries were moved or deleted (indexValid == false) the index
+ * is rebuilt. This function MUST be called with the write lock held after
+ * each modification of the cache.
+ *
+ * @return false if not enough memory is available, the index is rebuilt
+ *         with the next call.
+ *
+ * @since 0.6.3.0
+ */
+bool _syncCacheIndex()
+{
+  SListNode* node;
+
+  cache.generation++;
+  if (!cache.indexValid)
+  {
+    cache.indexSize = 0;
+    cache.indexLast = NULL;
+  }
+  if (cache.indexCapacity < sizeOfSList(&cache.entries))
+  {
+    uint32_t capacity = MAX(sizeOfSList(&cache.entries), 
+                            cache.indexCapacity * 2);
+    ValCacheEntry** index = realloc(cache.serialIndex, 
+                                    capacity * sizeof(ValCacheEntry*));
+    if (index == NULL)
+    {
+      ERRORF("Error: Not enough memory for the serial index!\n");
+      cache.indexValid = false;
+      return false;
+    }
+    cache.serialIndex   = index;
+    cache.indexCapacity = capacity;
+  }
+
+  node = (cache.indexLast == NULL) ? getRootNodeOfSList(&cache.entries)
+                                   : getNextNodeOfSListNode(cache.indexLast);
+  for (; node != NULL; node = getNextNodeOfSListNode(node))
+  {
+    cache.serialIndex[cache.indexSize++] 
+                                      = (ValCacheEntry*)getDataOfSListNode(node);
+    cache.indexLast = node;
+  }
+  cache.indexValid = true;
+
+  return true;
+}
+
+/**
+ * Return the position of the first entry in the serial index with a serial
+ * number greater than the given one.
+ *
+ * @param serial The serial number
+ *
+ * @return the position or indexSize if no such entry exists.
+ *
+ * @since 0.6.3.0
+ */
+uint32_t _findSerial(uint32_t serial)
+{
+  uint32_t low  = 0;
+  uint32_t high = cache.indexSize;
+  uint32_t mid;
+
+  while (low < high)
+  {
+    mid = low + (high - low) / 2;
+    if (cache.serialIndex[mid]->serial > serial)
+    {
+      high = mid;
+    }
+    else
+    {
+      low = mid + 1;
+    }
+  }
+
+  return low;
+}
+
+/**
+ * Send the collected PDUs.
+ *
+ * @param buffer The PDU buffer.
+ *
+ * @return false if the PDUs could not be send.
+ *
+ * @since 0.6.3.0
+ */
+bool _flushPDUs(PDUBuffer* buffer)
+{
+  bool retVal = true;
+
+  if ((buffer->fdPtr != NULL) && (buffer->length > 0))
+  {
+    retVal = sendNum(buffer->fdPtr, buffer->data, buffer->length);
+    buffer->length = 0;
+  }
+
+  return retVal;
+}
+
+/**
+ * Add the PDU of the cache entry to the buffer.
+ *
+ * @param buffer The PDU buffer.
+ * @param cEntry The cache entry.
+ * @param version The protocol version of the session.
+ *
+ * @return false if the buffer could not be send or not enough memory is
+ *         available.
+ *
+ * @since 0.6.3.0
+ */
+bool _addPDU(PDUBuffer* buffer, ValCacheEntry* cEntry, uint8_t version)
+{
+  if (buffer->length + cEntry->pduLength > buffer->size)
+  {
+    if (buffer->fdPtr != NULL)
+    {
+      if (!_flushPDUs(buffer))
+      {
+        return false;
+      }
+    }
+    if (buffer->length + cEntry->pduLength > buffer->size)
+    {
+      size_t   size = MAX(buffer->size * 2, buffer->length + cEntry->pduLength);
+      uint8_t* data = realloc(buffer->data, size);
+      if (data == NULL)
+      {
+        return false;
+      }
+      buffer->data = data;
+      buffer->size = size;
+    }
+  }
+  memcpy(buffer->data + buffer->length, cEntry->pdu, cEntry->pduLength);
+  // The version is the first byte of each PDU.
+  buffer->data[buffer->length] = version;
+  buffer->length += cEntry->pduLength;
+
+  return true;
+}
+
+/**
+ * Determine if the cache entry is send to the client.
+ *
+ * @param cEntry The cache entry.
+ * @param clientSerial The serial the client requested.
+ * @param isReset true if the client requested all data.
+ * @param version The protocol version of the session.
+ *
+ * @return true if the entry is send.
+ *
+ * @since 0.6.3.0
+ */
+bool _sendEntry(ValCacheEntry* cEntry, uint32_t clientSerial, bool isReset,
+                uint8_t version)
+{
+  if (version < cEntry->minVersion)
+  {
+    // Router keys require version 1, ASPA objects version 2
+    return false;
+  }
+  if ((cEntry->flags & PREFIX_FLAG_ANNOUNCEMENT) == 0)
+  {
+    // After a reset only announcements are send. Withdrawals of entries that 
+    // were never announced to the client are skipped.
+    return !isReset && (cEntry->prevSerial <= clientSerial);
+  }
+
+  return true;
+}
+
+/**
+ * Send the PDUs of all announcements. The PDUs are collected once per cache 
+ * modification and protocol version and shared by all clients. This function
+ * MUST be called with the read lock held.
+ *
+ * @param fdPtr The socket.
+ * @param version The protocol version of the session.
+ *
+ * @return false if the PDUs could not be send.
+ *
+ * @since 0.6.3.0
+ */
+bool _sendResetImage(int* fdPtr, uint8_t version)
+{
+  ResetImage* image = &cache.resetImage[MIN(version, 
+                                            RPKI_RTR_PROTOCOL_VERSION)];
+  PDUBuffer   buffer;
+  uint32_t    idx;
+  bool        retVal = true;
+
+  // The generation does not change while the read lock is held.
+  lockMutex(&cache.imageMutex);
+  if (!image->prepared || (image->generation != cache.generation))
+  {
+    buffer.data   = image->data;
+    buffer.size   = image->size;
+    buffer.length = 0;
+    buffer.fdPtr  = NULL;
+    for (idx = 0; (idx < cache.indexSize) && retVal; idx++)
+    {
+      if (_sendEntry(cache.serialIndex[idx], 0, true, version))
+      {
+        retVal = _addPDU(&buffer, cache.serialIndex[idx], version);
+      }
+    }
+    image->data       = buffer.data;
+    image->size       = buffer.size;
+    image->length     = buffer.length;
+    image->generation = cache.generation;
+    image->prepared   = retVal;
+  }
+  unlockMutex(&cache.imageMutex);
+
+  if (!retVal)
+  {
+    ERRORF("Error: Not enough memory to prepare the cache data!\n");
+  }
+  else if (image->length > 0)
+  {
+    OUTPUTF(false, "Sending %zu bytes of cache data\n", image->length);
+    retVal = sendNum(fdPtr, image->data, image->length);
+  }
+
+  return retVal;
+}
+
+/**
+ * Send the PDUs of all changes since the given serial. This function MUST be
+ * called with the read lock held.
+ *
+ * @param fdPtr The socket.
+ * @param clientSerial The serial the client requested.
+ * @param version The protocol version of the session.
+ *
+ * @return false if the PDUs could not be send.
+ *
+ * @since 0.6.3.0
+ */
+bool _sendChanges(int* fdPtr, uint32_t clientSerial, uint8_t version)
+{
+  PDUBuffer buffer;
+  uint32_t  idx;
+  bool      retVal = true;
+
+  buffer.data   = malloc(SEND_BUF_SIZE);
+  buffer.size   = SEND_BUF_SIZE;
+  buffer.length = 0;
+  buffer.fdPtr  = fdPtr;
+  if (buffer.data == NULL)
+  {
+    ERRORF("Error: Not enough memory to send the cache data!\n");
+    return false;
+  }
+
+  for (idx = _findSerial(clientSerial); 
+       (idx < cache.indexSize) && retVal; idx++)
+  {
+    if (_sendEntry(cache.serialIndex[idx], clientSerial, false, version))
+    {
+      OUTPUTF(false, "Sending a PDU (serial = %u)\n", 
+              cache.serialIndex[idx]->serial);
+      retVal = _addPDU(&buffer, cache.serialIndex[idx], version);
+    }
+  }
+  retVal = retVal && _flushPDUs(&buffer);
+  free(buffer.data);
+
+  return retVal;
+}
+
 /**
  * This function was previously called sendPrefixes but in the meantime not only
  * ROA prefixes are sent RFC8610, also BGPsec keys RFC8210as well as 
@@ -620,208 +1115,12 @@ void sendCacheObjects(int* fdPtr, uint32_t clientSerial,
     else
     {
       OUTPUTF(true, "Cache size = %u\n", cache.entries.size);
-      if (cache.entries.size > 0) // there is always a root.
+      if (cache.indexSize > 0)
       {
-        ValCacheEntry* cEntry;
-
-        uint8_t               v4pdu[sizeof(RPKIIPv4PrefixHeader)];
-        uint8_t               v6pdu[sizeof(RPKIIPv6PrefixHeader)];
-        RPKIIPv4PrefixHeader* v4hdr = (RPKIIPv4PrefixHeader*)v4pdu;
-        RPKIIPv6PrefixHeader* v6hdr = (RPKIIPv6PrefixHeader*)v6pdu;
-        RPKIRouterKeyHeader   rkhdr;
-        // This is used to allow to grow the ASPA PDU memory as needed.
-        // The ASPA PDU size depends on the number of providerASes sent.
-        // + 4 Because each ASPAHeader contains at least one ProviderAS which
-        // in NOT part of the static Header structure because 1..N providers
-        // van exist.
-        uint32_t              aspaBufferSize    = sizeof(RPKIASPAHeader)+4;
-        uint32_t              aspaBufferMinSize = aspaBufferSize;
-        uint8_t*              aspaBuffer = malloc(aspaBufferSize);
-        RPKIASPAHeader*       aspahdr = (RPKIASPAHeader*)aspaBuffer;
-        memset(aspaBuffer, 0, aspaBufferSize);
-        
-        // Basic initialization of data that does NOT change
-        // IPv4 Prefix PDU
-        v4hdr->version  = version;
-        v4hdr->type     = PDU_TYPE_IP_V4_PREFIX;
-        v4hdr->reserved = 0;
-        v4hdr->length   = htonl(sizeof(RPKIIPv4PrefixHeader));
-
-        // IPv6 Prefix PDU
-        v6hdr->version  = version;
-        v6hdr->type     = PDU_TYPE_IP_V6_PREFIX;
-        v6hdr->reserved = 0;
-        v6hdr->length   = htonl(sizeof(RPKIIPv6PrefixHeader));
-
-        // Router Key PDU
-        rkhdr.version   = version;
-        rkhdr.type      = PDU_TYPE_ROUTER_KEY;
-        rkhdr.zero      = 0;
-      
-        // ASPA PDU
-        aspahdr->version = version;
-        aspahdr->type    = PDU_TYPE_ASPA;
-        aspahdr->zero_1  = 0;
-        aspahdr->zero_2  = 0;
-        
-        // helps to find the next serial number
-        SListNode*  currNode;
-        uint32_t    serial;
-
-        // Go through list until next available serial is found
-        FOREACH_SLIST(&cache.entries, currNode)
-        {
-          serial = ((ValCacheEntry*)getDataOfSListNode(currNode))->serial;
-          if (isReset || (serial > clientSerial))
-          {
-            break;
-          }
-        }
-
-        // Go over each node. currNode is not null if a serial was found.
-        for (; currNode; currNode = getNextNodeOfSListNode(currNode))
-        {
-          cEntry = (ValCacheEntry*)getDataOfSListNode(currNode);
-
-          // Skip entries that are already expired.
-          if (isReset)
-          {
-            if ((cEntry->flags & PREFIX_FLAG_ANNOUNCEMENT) == 0)
-            {
-              // This entry is NOT an announcement. Because we send a fresh set,
-              // only announcements will be send, no withdrawals.
-              continue;
-            }
-          }
-
-          // Skip entries that were never announced to the client
-          if (   (cEntry->serial != cEntry->prevSerial)
-              && (cEntry->prevSerial > clientSerial))
-          {
-            continue;
-          }
-
-          // Send 'Router Key'
-          if( cEntry->isKey == true && cEntry->prefixLength == 0 &&
-              cEntry->prefixMaxLength == 0 &&
-              cEntry->ski && cEntry->pPubKeyData)
-
-          {
-            // Change from version == 1 to faster != 0
-            if (version != 0)
-            {
-              rkhdr.flags     = cEntry->flags;
-              memcpy(&rkhdr.ski, cEntry->ski, SKI_LENGTH);
-              memcpy(&rkhdr.keyInfo, cEntry->pPubKeyData, KEY_BIN_SIZE);
-              rkhdr.as        = cEntry->asNumber;
-              rkhdr.length    = htonl(sizeof(RPKIRouterKeyHeader));
-
-              OUTPUTF(false, "Sending an 'Router Key' (serial = %u)\n",
-                  cEntry->serial);
-              if (!sendNum(fdPtr, &rkhdr, sizeof(RPKIRouterKeyHeader)))
-              {
-                ERRORF("Error: Failed to send a 'RouterKey'\n");
-                break;
-              }
-              continue;
-            }
-          }
-          else if (cEntry->isASPA)
-          {
-            if (version > 1)
-            {
-              // First determine if the header buffer is large enough.
-              aspaBufferMinSize = sizeof(RPKIASPAHeader) 
-                                  + (ntohs(cEntry->providerCount) * 4);
-              aspahdr->length            = htonl(aspaBufferMinSize);
-              aspahdr->flags             = cEntry->flags;
-              aspahdr->customer_asn      = cEntry->asNumber;
-              if ( (cEntry->flags & PREFIX_FLAG_ANNOUNCEMENT) != 0 )
-              {
-              aspahdr->provider_as_count = cEntry->providerCount;
-              aspahdr->provider_as_count = cEntry->providerCount;
-              aspahdr->customer_asn      = cEntry->asNumber;
-                aspahdr->provider_as_count = cEntry->providerCount;
-              aspahdr->customer_asn      = cEntry->asNumber;
-                if (aspaBufferSize < aspaBufferMinSize)
-                {
-                  uint8_t* newBuffer = realloc(aspaBuffer, aspaBufferMinSize);
-                  if (newBuffer != NULL)
-                  {
-                    aspaBuffer     = newBuffer;
-                    aspaBufferSize = aspaBufferMinSize;
-                    aspahdr        = (RPKIASPAHeader*)aspaBuffer;
-                    newBuffer      = NULL;
-                  }
-                  else
-                  {
-                    ERRORF("Error: Not enough memory for ASPA object!\n");
-                    break;
-                  }
-                }
-                // Now use a helper pointer to copy the list of provider ASs to 
-                // into the PDU
-                uint8_t* ptr = aspaBuffer + sizeof(RPKIASPAHeader);
-                memcpy(ptr, (uint8_t*)cEntry->providerAS, 
-                      ntohs(cEntry->providerCount) * 4);
-              }
-              else
-              {
-                // Withdrawal - No PRovider ASes
-                aspaBufferMinSize = sizeof(RPKIASPAHeader);
-                aspahdr->provider_as_count = 0;
-              }
-
-              // Here aspahdr is a pointer so we can hand is over directly.
-              if (!sendNum(fdPtr, aspahdr, aspaBufferMinSize))
-              {
-                ERRORF("Error: Failed to send an 'ASPA' object!\n");
-                break;
-               }
-            }
-          }
-          else
-          {
-            // Send 'Prefix'
-            if (!cEntry->isV6)
-            {
-              v4hdr->flags     = cEntry->flags;
-              v4hdr->prefixLen = cEntry->prefixLength;
-              v4hdr->maxLen    = cEntry->prefixMaxLength;
-              v4hdr->zero      = (uint8_t)0;
-              v4hdr->addr      = cEntry->address.v4;
-              v4hdr->as        = cEntry->asNumber;
-              OUTPUTF(false, "Sending an 'IPv4Prefix' (serial = %u)\n",
-                  cEntry->serial);
-              if (!sendNum(fdPtr, &v4pdu, sizeof(RPKIIPv4PrefixHeader)))
-              {
-                ERRORF("Error: Failed to send a 'Prefix'\n");
-                break;
-              }
-            }
-            else
-            {
-              v6hdr->flags     = cEntry->flags;
-              v6hdr->prefixLen = cEntry->prefixLength;
-              v6hdr->maxLen    = cEntry->prefixMaxLength;
-              v6hdr->zero      = (uint8_t)0;
-              v6hdr->addr      = cEntry->address.v6;
-              v6hdr->as        = cEntry->asNumber;
-              OUTPUTF(false, "Sending an 'IPv6Prefix' (serial = %u)\n",
-                  cEntry->serial);
-              if (!sendNum(fdPtr, &v6pdu, sizeof(RPKIIPv6PrefixHeader)))
-              {
-                ERRORF("Error: Failed to send a 'Prefix'\n");
-                break;
-              }
-            }
-          }
-        }
-        
-        if (aspaBuffer != NULL)
+        if (isReset ? !_sendResetImage(fdPtr, version)
+                    : !_sendChanges(fdPtr, clientSerial, version))
         {
-          free (aspaBuffer);
-          aspaBuffer = NULL;
+          ERRORF("Error: Failed to send the cache data\n");
         }
       }
 
@@ -883,6 +1182,7 @@ int sendCacheResetToAllClients()
 
     OUTPUTF(true, "Sending 'Cache Reset' to all clients\n");
 
+    acquireReadLock(&cache.lock);
     for (client = clients; client; client = client->hh.next)
     {
       if (!sendCacheReset(&client->fd, client->version))
@@ -1526,6 +1826,16 @@ bool readPrefixData(const char* arg, SList* dest, uint32_t serial, bool isFile)
       memcpy(&cEntry->address.v6.in_addr, &prefix.ip.addr, 16);
       cEntry->asNumber = htonl(oas);
     }
+    if (!_buildPDU(cEntry))
+    {
+      deleteFromSList(dest, cEntry);
+      free(cEntry);
+      if (isFile)
+      {
+        fclose(fh);
+      }
+      return false;
+    }
   }
 
   if (isFile)
@@ -1586,27 +1896,10 @@ int _countTokens(char* line)
 ValCacheEntry* findASPA(uint32_t customerAS)
 {
   ValCacheEntry* retVal = NULL;
-  ValCacheEntry* cEntry = NULL;
-  SListNode*     lnode  = NULL;
-  // it is faster to translate this into network representation once rather than
-  // translating each stored value into host representation.
+  // The index uses the network representation.
   uint32_t       cAS    = htonl(customerAS);
-  
-  if (sizeOfSList(&cache.entries) != 0)
-  {
-    FOREACH_SLIST(&cache.entries, lnode)
-    {
-      cEntry = (ValCacheEntry*)getDataOfSListNode(lnode);
-      if (cEntry->isASPA)
-      {
-        if (cAS == cEntry->asNumber)
-        {
-          retVal = cEntry;
-          break;
-        }
-      }
-    }
-  }
+
+  HASH_FIND(hh, cache.aspaIndex, &cAS, sizeof(uint32_t), retVal);
 
   return retVal;
 }
@@ -1812,11 +2105,11 @@ bool readASPAData(const char* arg, SList* dest, uint32_t serial, bool isFile)
                       " from cache to install replacement!", customerAS);
       previousSerial = cEntry->serial;
       deleteFromSList(&cache.entries, cEntry);
-      free(cEntry->providerAS);
-      cEntry->providerCount = 0;
-      cEntry->providerAS    = NULL;
+      _releaseEntry(cEntry);
       free(cEntry);
       cEntry = NULL;
+      // The list changed in the middle.
+      cache.indexValid = false;
     }
 
     // Append
@@ -1847,9 +2140,17 @@ bool readASPAData(const char* arg, SList* dest, uint32_t serial, bool isFile)
     cEntry->asNumber        = htonl(customerAS);
     cEntry->providerCount   = htons(providerCount);
     cEntry->providerAS      = providerBuff;
-    numAdded++;
     providerBuff = NULL;
     providerAS   = NULL;
+    if (!_buildPDU(cEntry))
+    {
+      deleteFromSList(dest, cEntry);
+      _releaseEntry(cEntry);
+      free(cEntry);
+      break;
+    }
+    HASH_ADD(hh, cache.aspaIndex, asNumber, sizeof(uint32_t), cEntry);
+    numAdded++;
   }
 
   if (isFile)
@@ -2150,6 +2451,7 @@ bool appendPrefixData(char* arg, bool fromFile)
 
   changeReadToWriteLock(&cache.lock);
   succ = readPrefixData(arg, &cache.entries, cache.maxSerial + 1, fromFile);
+  _syncCacheIndex();
   changeWriteToReadLock(&cache.lock);
 
   // Check how many entries were added
@@ -2300,12 +2602,32 @@ bool readRouterKeyData(const char* arg, SList* dest, uint32_t serial)
     buffSKI_bin[idx] = hex2bin_byte(buffSKI_asc+(idx*2));
   }
 
+  fclose(fpKey);
+
+  // The same key must not be announced twice.
+  uint8_t        indexKey[SKI_LENGTH + 4];
+  uint32_t       asNumber = htonl(strtoul(asnStr, NULL, 10));
+  ValCacheEntry* found    = NULL;
+  memcpy(indexKey, buffSKI_bin, SKI_LENGTH);
+  memcpy(indexKey + SKI_LENGTH, &asNumber, 4);
+  HASH_FIND(hh, cache.keyIndex, indexKey, sizeof(indexKey), found);
+  if (found != NULL)
+  {
+    if ((found->flags & PREFIX_FLAG_ANNOUNCEMENT) != 0)
+    {
+      ERRORF("Error: The router key of AS %s is already in the cache\n",
+             asnStr);
+      return false;
+    }
+    // Announced again after it was removed, the new entry is indexed.
+    HASH_DEL(cache.keyIndex, found);
+  }
+
   // new instance to append
   cEntry = (ValCacheEntry*)appendToSList(dest, sizeof(ValCacheEntry));
 
   if (cEntry == NULL)
   {
-    fclose(fpKey);
     return false;
   }
   // Make sure the entry object is properly initialized.
@@ -2315,14 +2637,22 @@ bool readRouterKeyData(const char* arg, SList* dest, uint32_t serial)
   cEntry->flags           = PREFIX_FLAG_ANNOUNCEMENT;
   cEntry->isKey           = true;
 
-  cEntry->asNumber    = htonl(strtoul(asnStr, NULL, 10));
+  cEntry->asNumber    = asNumber;
   cEntry->ski         = (char*) calloc(1, SKI_LENGTH);
   cEntry->pPubKeyData = (char*) calloc(1, KEY_BIN_SIZE);
 
   memcpy(cEntry->ski, buffSKI_bin, SKI_LENGTH);
   memcpy(cEntry->pPubKeyData, buffKey, KEY_BIN_SIZE);
+  memcpy(cEntry->indexKey, indexKey, sizeof(indexKey));
 
-  fclose(fpKey);
+  if (!_buildPDU(cEntry))
+  {
+    deleteFromSList(dest, cEntry);
+    _releaseEntry(cEntry);
+    free(cEntry);
+    return false;
+  }
+  HASH_ADD(hh, cache.keyIndex, indexKey, sizeof(cEntry->indexKey), cEntry);
 
   return true;
 }
@@ -2347,6 +2677,7 @@ bool appendRouterKeyData(char* line)
 
   // function for certificate reading
   succ = readRouterKeyData(line, &cache.entries, cache.maxSerial+1);
+  _syncCacheIndex();
 
   changeWriteToReadLock(&cache.lock);
 
@@ -2382,6 +2713,7 @@ bool appendASPAData(char* arg, bool fromFile)
   changeReadToWriteLock(&cache.lock);
   numAdded = readASPAData(arg, &cache.entries, cache.maxSerial + 1, fromFile);
   cache.maxSerial += numAdded;
+  _syncCacheIndex();
   changeWriteToReadLock(&cache.lock);
 
   unlockReadLock(&cache.lock);
@@ -2648,8 +2980,16 @@ int appendASPAFile(char* fileName)
  */
 int emptyCache()
 {
+  SListNode* lnode;
+
   acquireWriteLock(&cache.lock);
+  FOREACH_SLIST(&cache.entries, lnode)
+  {
+    _releaseEntry((ValCacheEntry*)getDataOfSListNode(lnode));
+  }
   emptySList(&cache.entries);
+  cache.indexValid = false;
+  _syncCacheIndex();
   unlockWriteLock(&cache.lock);
 
   OUTPUTF(true, "Emptied the cache\n");
@@ -2820,10 +3160,10 @@ bool processEntryRemoval(char* arg)
       {
         currEntry->providerCount = 0;
         free(currEntry->providerAS);
-        currEntry->providerCount = NULL;
+        currEntry->providerAS = NULL;
       }
-//@TODO
-// Maybe reduce the entry to zero providers if it is an ASPA object
+      // The withdrawal is send from now on.
+      _buildPDU(currEntry);
 
       // Move to end
       moveSListNode(&cache.entries, &cache.entries, currIndex, prevNode);
@@ -2833,6 +3173,11 @@ bool processEntryRemoval(char* arg)
       prevNode = currIndex;
     }
   }
+  if (removed > 0)
+  {
+    cache.indexValid = false;
+    _syncCacheIndex();
+  }
 
   unlockWriteLock(&cache.lock);
   OUTPUTF(true, "Removed %d entries\n", removed);
@@ -3343,36 +3688,19 @@ void deleteExpiredEntriesFromCache(time_t now)
       cache.minPSExpired = MIN(cache.minPSExpired, cEntry->prevSerial);
       cache.maxSExpired  = MAX(cache.maxSExpired, cEntry->serial);
 
-      // free ski and key allocations
-      if(cEntry->isKey)
-      {
-        if (cEntry->ski)
-        {
-          free(cEntry->ski);
-          cEntry->ski = NULL;
-        }
-        if (cEntry->pPubKeyData)
-        {
-          free(cEntry->pPubKeyData);
-          cEntry->pPubKeyData = NULL;
-        }
-      }
-      
-      if(cEntry->isASPA)
-      {
-        if(cEntry->providerAS)
-        {
-          free(cEntry->providerAS);
-          cEntry->providerAS = NULL;
-        }
-      }
-
+      _releaseEntry(cEntry);
       deleteFromSList(&cache.entries, cEntry);
+      free(cEntry);
       removed++;
     }
 
     currNode = nextNode;
   }
+  if (removed > 0)
+  {
+    cache.indexValid = false;
+    _syncCacheIndex();
+  }
   unlockWriteLock(&cache.lock);
 
   if (removed > 0)
@@ -3438,6 +3766,21 @@ bool setupCache()
     ERRORF("Error: Failed to create the cache R/W lock");
     return false;
   }
+  if (!initMutex(&cache.imageMutex))
+  {
+    ERRORF("Error: Failed to create the cache image mutex");
+    releaseRWLock(&cache.lock);
+    return false;
+  }
+  cache.serialIndex   = NULL;
+  cache.indexSize     = 0;
+  cache.indexCapacity = 0;
+  cache.indexLast     = NULL;
+  cache.indexValid    = true;
+  cache.aspaIndex     = NULL;
+  cache.keyIndex      = NULL;
+  cache.generation    = 0;
+  memset(cache.resetImage, 0, sizeof(cache.resetImage));
   cache.maxSerial     = 0;
   cache.minPSExpired  = UINT32_MAX;
   cache.maxSExpired   = 0;
@@ -3640,6 +3983,7 @@ int main(int argc, const char* argv[])
 {
   pthread_t rlthread;
   int       ret = 0;
+  int       idx;
   
   // Disable printout buffering.
   setbuf(stdout, NULL);
@@ -3737,8 +4081,15 @@ int main(int argc, const char* argv[])
   stopServerLoop(&svrSocket);
 
   // Cleanup
+  emptyCache();
   releaseRWLock(&cache.lock);
   releaseSList(&cache.entries);
+  releaseMutex(&cache.imageMutex);
+  free(cache.serialIndex);
+  for (idx = 0; idx <= RPKI_RTR_PROTOCOL_VERSION; idx++)
+  {
+    free(cache.resetImage[idx].data);
+  }
   memset(keyLocation, 0, LINE_BUF_SIZE);
 
   return ret;
@@ -0,0 +1,1209 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The load generator of srxsvr_client. Each connection is a proxy of its own
+ * with one sender and one receiver thread. Every request asks for a receipt,
+ * the local ID of the request is the key into a table of send times. The
+ * round trip ends with the notification carrying the local ID.
+ *
+ * In closed loop mode each connection keeps a window of requests outstanding.
+ * In open loop mode the requests are sent at a fixed rate regardless of the
+ * answers and the latency is measured from the scheduled send time, a stalled
+ * server therefore can not hide its queueing delay.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "client/srx_api.h"
+#include "shared/srx_packets.h"
+#include "tools/srx_load.h"
+#include "util/log.h"
+#include "util/prefix.h"
+#include "util/str.h"
+
+#define LOAD_DEF_SERVER        "localhost"
+#define LOAD_DEF_PORT          17900
+/** The proxy ID of the first connection (10.0.0.1), the others follow. */
+#define LOAD_DEF_PROXY_ID      0x0A000001
+#define LOAD_DEF_PROXY_AS      50
+#define LOAD_DEF_REQUESTS      10000
+#define LOAD_DEF_UPDATES       65536
+#define LOAD_MAX_UPDATES       (1 << 20)
+#define LOAD_DEF_WINDOW        1
+#define LOAD_DEF_DRAIN         5
+#define LOAD_HANDSHAKE_TIMEOUT 5
+/** The number of requests tracked per connection, a power of two. */
+#define LOAD_MAX_OUTSTANDING   65536
+#define LOAD_SLOT_MASK         (LOAD_MAX_OUTSTANDING - 1)
+#define LOAD_MAX_LINE          8192
+
+/** One update sent in a validation request. */
+typedef struct {
+  IPPrefix  prefix;
+  uint32_t  originAS;
+  /** The number of ASes in the path. */
+  uint16_t  numberHops;
+  /** The AS path in network format. */
+  uint32_t* asPath;
+  uint16_t  attrLength;
+  /** The BGPsec path attribute. */
+  uint8_t*  attr;
+} LoadUpdate;
+
+/** The configuration given on the command line. */
+typedef struct {
+  const char* host;
+  int         port;
+  uint32_t    connections;
+  const char* file;
+  /** The number of updates generated if no file is given. */
+  uint32_t    noUpdates;
+  /** The AS path length of the generated updates. */
+  uint32_t    pathLength;
+  /** The requests per connection, 0 = until the duration elapsed. */
+  uint32_t    requests;
+  /** The duration in seconds, 0 = until all requests are sent. */
+  uint32_t    duration;
+  /** The requests per second of all connections, 0 = closed loop. */
+  double      rate;
+  /** The requests outstanding per connection in closed loop mode. */
+  uint32_t    window;
+  /** The validation requested (SRX_FLAG_ROA | SRX_FLAG_BGPSEC | ...) */
+  uint8_t     method;
+  uint32_t    shmRingSize;
+  /** The requested flow control window, 0 = no flow control. */
+  uint32_t    flowWindow;
+  /** Seconds to wait for the outstanding notifications. */
+  uint32_t    drain;
+} LoadConfig;
+
+/** One proxy connection. */
+typedef struct {
+  SRxProxy*       proxy;
+  uint32_t        idx;
+  pthread_t       sender;
+  pthread_t       receiver;
+  bool            receiverDone;
+  /** The send time per slot of the local ID in nanoseconds, 0 = free. */
+  uint64_t*       sentAt;
+  uint32_t        nextLocalID;
+  /** The requests sent and not answered yet, guarded by lock. */
+  uint32_t        outstanding;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  /** The round trip latencies in nanoseconds, written by the receiver. */
+  uint64_t*       latencies;
+  uint64_t        count;
+  uint64_t        size;
+  uint64_t        sent;
+  /** Requests not sent because their slot was still in use. */
+  uint64_t        overruns;
+  /** Receipts without a matching request. */
+  uint64_t        unmatched;
+  uint64_t        firstSend;
+  uint64_t        lastReceive;
+  bool            lost;
+} LoadConnection;
+
+static LoadConfig    _config;
+static LoadUpdate*   _updates   = NULL;
+static uint32_t      _noUpdates = 0;
+static volatile bool _running   = true;
+static uint32_t      _sendersActive = 0;
+
+/**
+ * Print the syntax of the load generator.
+ *
+ * @param prgName The name of the program.
+ */
+static void _syntax(const char* prgName)
+{
+  printf ("Syntax: %s %s [options]\n\n", prgName, LOAD_ARG);
+  printf ("  Sends validation requests over several proxy connections and\n"
+          "  reports the throughput and the round trip latency until the\n"
+          "  receipt of each request.\n\n");
+  printf ("  -s <host>     The SRx server (default %s).\n", LOAD_DEF_SERVER);
+  printf ("  -p <port>     The SRx server port (default %u).\n",
+          LOAD_DEF_PORT);
+  printf ("  -c <number>   The number of proxy connections (default 1).\n");
+  printf ("  -f <file>     Replay the updates of the file. One update per "
+          "line:\n"
+          "                <origin AS> <prefix> [<AS path>|-] [<hex BGPsec "
+          "attribute>]\n"
+          "                The AS path is a comma separated list.\n");
+  printf ("  -u <number>   The number of generated updates if no file is "
+          "given\n"
+          "                (default %u).\n", LOAD_DEF_UPDATES);
+  printf ("  -l <number>   The AS path length of the generated updates "
+          "(default 0).\n");
+  printf ("  -n <number>   The requests per connection (default %u).\n",
+          LOAD_DEF_REQUESTS);
+  printf ("  -d <seconds>  Send for the given time instead of a number of "
+          "requests.\n");
+  printf ("  -r <rate>     Open loop: requests per second of all "
+          "connections.\n");
+  printf ("  -w <number>   Closed loop: requests outstanding per connection\n"
+          "                (default %u).\n", LOAD_DEF_WINDOW);
+  printf ("  -m <method>   1=origin, 2=path, 4=aspa or the sum (default 1).\n");
+  printf ("  -S <bytes>    Offer a shared memory channel of the given ring "
+          "size.\n");
+  printf ("  -F <number>   Request the flow control with the given window.\n");
+  printf ("  -W <seconds>  Wait for outstanding notifications (default %u).\n",
+          LOAD_DEF_DRAIN);
+  printf ("  -h            Print this help.\n");
+}
+
+/**
+ * Return the current time.
+ *
+ * @return the monotonic time in nanoseconds.
+ */
+static uint64_t _now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Sleep until the given time.
+ *
+ * @param time The monotonic time in nanoseconds.
+ */
+static void _sleepUntil(uint64_t time)
+{
+  struct timespec ts;
+
+  ts.tv_sec  = time / 1000000000ULL;
+  ts.tv_nsec = time % 1000000000ULL;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+  {
+    if (!_running)
+    {
+      break;
+    }
+  }
+}
+
+/**
+ * Stop sending (SIGINT).
+ *
+ * @param signal The signal number.
+ */
+static void _stopLoad(int signal)
+{
+  _running = false;
+}
+
+/**
+ * Read an unsigned number.
+ *
+ * @param str The string.
+ * @param value (out) The number.
+ *
+ * @return false if the string is not a number.
+ */
+static bool _parseU32(const char* str, uint32_t* value)
+{
+  char* end = NULL;
+  unsigned long num;
+
+  if ((str == NULL) || (*str == '\0'))
+  {
+    return false;
+  }
+  num = strtoul(str, &end, 0);
+  if ((*end != '\0') || (num > UINT32_MAX))
+  {
+    return false;
+  }
+  *value = (uint32_t)num;
+  return true;
+}
+
+/**
+ * Read the AS path of an update.
+ *
+ * @param str The comma separated list of AS numbers.
+ * @param update The update the path is stored in.
+ *
+ * @return false if the path is invalid.
+ */
+static bool _parsePath(char* str, LoadUpdate* update)
+{
+  char*    asStr;
+  char*    savePtr = NULL;
+  uint32_t asn;
+  uint16_t hops = 1;
+  char*    ptr;
+
+  for (ptr = str; *ptr != '\0'; ptr++)
+  {
+    hops += *ptr == ',' ? 1 : 0;
+  }
+  update->asPath = malloc(hops * sizeof(uint32_t));
+  if (update->asPath == NULL)
+  {
+    return false;
+  }
+  update->numberHops = 0;
+  for (asStr = strtok_r(str, ",", &savePtr); asStr != NULL;
+       asStr = strtok_r(NULL, ",", &savePtr))
+  {
+    if (!_parseU32(asStr, &asn))
+    {
+      return false;
+    }
+    update->asPath[update->numberHops++] = htonl(asn);
+  }
+
+  return update->numberHops != 0;
+}
+
+/**
+ * Read the BGPsec path attribute of an update.
+ *
+ * @param str The attribute in hex.
+ * @param update The update the attribute is stored in.
+ *
+ * @return false if the string is not hex or too long.
+ */
+static bool _parseAttribute(const char* str, LoadUpdate* update)
+{
+  size_t   length = strlen(str);
+  uint32_t idx;
+  unsigned int byte;
+
+  if (((length % 2) != 0) || (length / 2 > UINT16_MAX) || (length == 0))
+  {
+    return false;
+  }
+  update->attrLength = (uint16_t)(length / 2);
+  update->attr       = malloc(update->attrLength);
+  if (update->attr == NULL)
+  {
+    return false;
+  }
+  for (idx = 0; idx < update->attrLength; idx++)
+  {
+    if (sscanf(str + (idx * 2), "%2x", &byte) != 1)
+    {
+      return false;
+    }
+    update->attr[idx] = (uint8_t)byte;
+  }
+
+  return true;
+}
+
+/**
+ * Read the updates of the given file.
+ *
+ * @param fileName The name of the file.
+ *
+ * @return false if the file could not be read or contains an invalid line.
+ */
+static bool _readUpdates(const char* fileName)
+{
+  FILE*       file = fopen(fileName, "r");
+  char        line[LOAD_MAX_LINE];
+  char*       token[4];
+  char*       savePtr;
+  int         noTokens;
+  uint32_t    lineNo = 0;
+  uint32_t    size   = 0;
+  LoadUpdate* update;
+  LoadUpdate* newUpdates;
+  bool        retVal = true;
+
+  if (file == NULL)
+  {
+    printf ("Error: Could not open '%s'!\n", fileName);
+    return false;
+  }
+
+  while (retVal && (fgets(line, LOAD_MAX_LINE, file) != NULL))
+  {
+    lineNo++;
+    savePtr  = NULL;
+    noTokens = 0;
+    token[0] = strtok_r(line, " \t\r\n", &savePtr);
+    while ((token[noTokens] != NULL) && (noTokens < 3))
+    {
+      token[++noTokens] = strtok_r(NULL, " \t\r\n", &savePtr);
+    }
+    if ((noTokens == 0) || (*token[0] == '#'))
+    {
+      continue;
+    }
+    if (_noUpdates == size)
+    {
+      size = (size == 0) ? 1024 : size * 2;
+      newUpdates = realloc(_updates, size * sizeof(LoadUpdate));
+      if (newUpdates == NULL)
+      {
+        printf ("Error: Not enough memory for %u updates!\n", size);
+        retVal = false;
+        break;
+      }
+      _updates = newUpdates;
+    }
+    update = &_updates[_noUpdates];
+    memset(update, 0, sizeof(LoadUpdate));
+    retVal =    (noTokens >= 2)
+             && _parseU32(token[0], &update->originAS)
+             && strToIPPrefix(token[1], &update->prefix);
+    if (retVal && (noTokens >= 3) && (strcmp(token[2], "-") != 0))
+    {
+      retVal = _parsePath(token[2], update);
+    }
+    if (retVal && (noTokens == 4))
+    {
+      retVal = _parseAttribute(token[3], update);
+    }
+    // Counted to be released in either case.
+    _noUpdates++;
+    if (!retVal)
+    {
+      printf ("Error: Invalid update in line %u of '%s'!\n", lineNo, fileName);
+    }
+  }
+  fclose(file);
+
+  if (retVal && (_noUpdates == 0))
+  {
+    printf ("Error: '%s' does not contain any update!\n", fileName);
+    retVal = false;
+  }
+
+  return retVal;
+}
+
+/**
+ * Generate the updates. The prefixes are distinct /24 prefixes starting with
+ * 10.0.0.0/24, the path ends with the origin AS.
+ *
+ * @param noUpdates The number of updates.
+ * @param pathLength The length of the AS path.
+ *
+ * @return false if not enough memory is available.
+ */
+static bool _generateUpdates(uint32_t noUpdates, uint32_t pathLength)
+{
+  char        prefix[INET_ADDRSTRLEN + 4];
+  uint32_t    idx;
+  uint32_t    hop;
+  uint32_t    ip;
+  LoadUpdate* update;
+
+  _updates = calloc(noUpdates, sizeof(LoadUpdate));
+  if (_updates == NULL)
+  {
+    return false;
+  }
+  for (idx = 0; idx < noUpdates; idx++)
+  {
+    update = &_updates[idx];
+    ip = ((10 + (idx >> 16)) << 24) | ((idx & 0xFFFF) << 8);
+    snprintf(prefix, sizeof(prefix), "%u.%u.%u.0/24", ip >> 24,
+             (ip >> 16) & 0xFF, (ip >> 8) & 0xFF);
+    strToIPPrefix(prefix, &update->prefix);
+    update->originAS = 64512 + (idx % 1000);
+    _noUpdates++;
+    if (pathLength != 0)
+    {
+      update->asPath = malloc(pathLength * sizeof(uint32_t));
+      if (update->asPath == NULL)
+      {
+        return false;
+      }
+      update->numberHops = (uint16_t)pathLength;
+      for (hop = 0; hop < pathLength - 1; hop++)
+      {
+        update->asPath[hop] = htonl(65000 + ((idx + hop) % 500));
+      }
+      update->asPath[pathLength - 1] = htonl(update->originAS);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Release the updates.
+ */
+static void _releaseUpdates()
+{
+  uint32_t idx;
+
+  for (idx = 0; idx < _noUpdates; idx++)
+  {
+    free(_updates[idx].asPath);
+    free(_updates[idx].attr);
+  }
+  free(_updates);
+  _updates   = NULL;
+  _noUpdates = 0;
+}
+
+/**
+ * Record the round trip of the request the receipt is for. Called by the
+ * receiver thread of the connection.
+ *
+ * @see ValidationReady in srx_api.h
+ */
+static bool _handleResult(SRxUpdateID updateID, uint32_t localID,
+                          ValidationResultType valType, uint8_t roaResult,
+                          uint8_t bgpsecResult, uint8_t aspaResult,
+                          void* userPtr)
+{
+  LoadConnection* conn = (LoadConnection*)userPtr;
+  uint64_t        now  = _now();
+  uint64_t        sentAt;
+  uint64_t*       latencies;
+
+  // Results following the receipt, e.g. of the path validation.
+  if (localID == 0)
+  {
+    return true;
+  }
+
+  sentAt = __atomic_exchange_n(&conn->sentAt[localID & LOAD_SLOT_MASK], 0,
+                               __ATOMIC_ACQ_REL);
+  if (sentAt == 0)
+  {
+    conn->unmatched++;
+    return true;
+  }
+
+  if (conn->count == conn->size)
+  {
+    latencies = realloc(conn->latencies, (conn->size == 0 ? 4096
+                                                          : conn->size * 2)
+                                         * sizeof(uint64_t));
+    if (latencies != NULL)
+    {
+      conn->latencies = latencies;
+      conn->size      = conn->size == 0 ? 4096 : conn->size * 2;
+    }
+  }
+  if (conn->count < conn->size)
+  {
+    conn->latencies[conn->count++] = now > sentAt ? now - sentAt : 0;
+  }
+  conn->lastReceive = now;
+
+  pthread_mutex_lock(&conn->lock);
+  conn->outstanding--;
+  pthread_cond_signal(&conn->cond);
+  pthread_mutex_unlock(&conn->lock);
+
+  return true;
+}
+
+/**
+ * Signatures are not requested.
+ *
+ * @see SignaturesReady in srx_api.h
+ */
+static void _handleSignatures(SRxUpdateID updId, BGPSecCallbackData* data,
+                              void* userPtr)
+{
+}
+
+/**
+ * A synchronization request is ignored, the requests keep going.
+ *
+ * @see SyncNotification in srx_api.h
+ */
+static void _handleSync(void* userPtr)
+{
+}
+
+/**
+ * Report errors of the connection.
+ *
+ * @see SrxCommManagement in srx_api.h
+ */
+static void _handleComm(SRxProxyCommCode code, int subCode, void* userPtr)
+{
+  LoadConnection* conn = (LoadConnection*)userPtr;
+
+  if (code == COM_ERR_PROXY_CONNECTION_LOST)
+  {
+    conn->lost = true;
+  }
+  if (isErrorCode(code))
+  {
+    LOG(LEVEL_WARNING, "Connection %u: communication error %u (%i)",
+                       conn->idx, code, subCode);
+  }
+}
+
+/**
+ * Receive the notifications of the connection until it is closed.
+ *
+ * @param arg The connection.
+ *
+ * @return NULL
+ */
+static void* _receiver(void* arg)
+{
+  LoadConnection* conn = (LoadConnection*)arg;
+
+  while (isConnected(conn->proxy) && processPackets(conn->proxy))
+  {
+  }
+  if (_running)
+  {
+    conn->lost = true;
+  }
+  __atomic_store_n(&conn->receiverDone, true, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+/**
+ * Send the requests of the connection in closed or open loop mode.
+ *
+ * @param arg The connection.
+ *
+ * @return NULL
+ */
+static void* _sender(void* arg)
+{
+  LoadConnection*  conn     = (LoadConnection*)arg;
+  uint32_t         updIdx   = (uint32_t)(((uint64_t)conn->idx * _noUpdates)
+                                         / _config.connections);
+  uint64_t         interval = 0;
+  uint64_t         next;
+  uint64_t         sendAt;
+  uint64_t*        slot;
+  uint32_t         localID;
+  LoadUpdate*      update;
+  SRxDefaultResult defResult;
+  SRxASPathList    asPathList;
+  BGPSecData       bgpsec;
+  struct timespec  wait;
+
+  memset(&defResult, 0, sizeof(SRxDefaultResult));
+  defResult.result.roaResult    = SRx_RESULT_UNDEFINED;
+  defResult.result.bgpsecResult = SRx_RESULT_UNDEFINED;
+  defResult.result.aspaResult   = SRx_RESULT_UNDEFINED;
+  defResult.resSourceROA        = SRxRS_UNKNOWN;
+  defResult.resSourceBGPSEC     = SRxRS_UNKNOWN;
+  defResult.resSourceASPA       = SRxRS_UNKNOWN;
+  memset(&asPathList, 0, sizeof(SRxASPathList));
+  asPathList.asType         = AS_SEQUENCE;
+  asPathList.asRelationship = AS_REL_UNKNOWN;
+  memset(&bgpsec, 0, sizeof(BGPSecData));
+
+  if (_config.rate > 0)
+  {
+    interval = (uint64_t)(1000000000.0 * _config.connections / _config.rate);
+    interval = interval == 0 ? 1 : interval;
+  }
+  next = conn->firstSend = _now();
+
+  while (   _running
+         && ((_config.requests == 0) || (conn->sent < _config.requests)))
+  {
+    if (interval != 0)
+    {
+      // Open loop, keep the schedule regardless of the answers.
+      if (_now() < next)
+      {
+        _sleepUntil(next);
+        if (!_running)
+        {
+          break;
+        }
+      }
+      sendAt = next;
+      next  += interval;
+    }
+    else
+    {
+      // Closed loop, wait for a free place in the window.
+      pthread_mutex_lock(&conn->lock);
+      while (_running && (conn->outstanding >= _config.window))
+      {
+        clock_gettime(CLOCK_REALTIME, &wait);
+        wait.tv_nsec += 100000000;
+        if (wait.tv_nsec >= 1000000000)
+        {
+          wait.tv_sec++;
+          wait.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&conn->cond, &conn->lock, &wait);
+      }
+      pthread_mutex_unlock(&conn->lock);
+      if (!_running)
+      {
+        break;
+      }
+      sendAt = _now();
+    }
+
+    if (!isConnected(conn->proxy))
+    {
+      conn->lost = true;
+      break;
+    }
+
+    localID = conn->nextLocalID++;
+    if (localID == 0)
+    {
+      localID = conn->nextLocalID++;
+    }
+    slot = &conn->sentAt[localID & LOAD_SLOT_MASK];
+    if (__atomic_load_n(slot, __ATOMIC_ACQUIRE) != 0)
+    {
+      // The request of this slot is not answered yet.
+      conn->overruns++;
+      continue;
+    }
+    pthread_mutex_lock(&conn->lock);
+    conn->outstanding++;
+    pthread_mutex_unlock(&conn->lock);
+    __atomic_store_n(slot, sendAt, __ATOMIC_RELEASE);
+
+    update = &_updates[updIdx];
+    updIdx = (updIdx + 1) % _noUpdates;
+    bgpsec.numberHops       = update->numberHops;
+    bgpsec.asPath           = update->asPath;
+    bgpsec.attr_length      = update->attrLength;
+    bgpsec.bgpsec_path_attr = update->attr;
+    verifyUpdate(conn->proxy, localID,
+                 (_config.method & SRX_FLAG_ROA) != 0,
+                 (_config.method & SRX_FLAG_BGPSEC) != 0,
+                 (_config.method & SRX_FLAG_ASPA) != 0,
+                 &defResult, &update->prefix, update->originAS, &bgpsec,
+                 asPathList);
+    conn->sent++;
+  }
+  __atomic_fetch_sub(&_sendersActive, 1, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+/**
+ * Order the latencies.
+ *
+ * @param a The first latency.
+ * @param b The second latency.
+ *
+ * @return <0, 0, >0 like strcmp.
+ */
+static int _compareLatencies(const void* a, const void* b)
+{
+  uint64_t valA = *(const uint64_t*)a;
+  uint64_t valB = *(const uint64_t*)b;
+
+  return (valA > valB) - (valA < valB);
+}
+
+/**
+ * Return the given percentile (nearest rank) of the sorted latencies in
+ * microseconds.
+ *
+ * @param values The sorted latencies, not empty.
+ * @param count The number of latencies.
+ * @param percent The percentile.
+ *
+ * @return the latency in microseconds.
+ */
+static double _percentile(uint64_t* values, uint64_t count, double percent)
+{
+  uint64_t rank = (uint64_t)((percent / 100.0) * count + 0.999999);
+
+  if (rank == 0)
+  {
+    rank = 1;
+  }
+  if (rank > count)
+  {
+    rank = count;
+  }
+  return values[rank - 1] / 1000.0;
+}
+
+/**
+ * Print one line of the report. The latencies are sorted.
+ *
+ * @param name The name of the line.
+ * @param sent The requests sent.
+ * @param values The latencies.
+ * @param count The number of latencies.
+ * @param overruns The requests not sent.
+ * @param time The time between the first request and the last receipt in
+ *             nanoseconds.
+ */
+static void _printLine(const char* name, uint64_t sent, uint64_t* values,
+                       uint64_t count, uint64_t overruns, uint64_t time)
+{
+  double rate = time != 0 ? count / (time / 1000000000.0) : 0;
+
+  qsort(values, count, sizeof(uint64_t), _compareLatencies);
+  printf ("%-10s %10llu %10llu %8llu %8llu %10.1f", name,
+          (unsigned long long)sent, (unsigned long long)count,
+          (unsigned long long)(sent > count ? sent - count : 0),
+          (unsigned long long)overruns, rate);
+  if (count != 0)
+  {
+    printf (" %9.1f %9.1f %9.1f %9.1f\n", _percentile(values, count, 50),
+            _percentile(values, count, 99), _percentile(values, count, 99.9),
+            values[count - 1] / 1000.0);
+  }
+  else
+  {
+    printf (" %9s %9s %9s %9s\n", "-", "-", "-", "-");
+  }
+}
+
+/**
+ * Print the throughput and latencies per connection and of all connections.
+ *
+ * @param conns The connections.
+ */
+static void _printReport(LoadConnection* conns)
+{
+  uint64_t  total = 0;
+  uint64_t  sent  = 0;
+  uint64_t  overruns = 0;
+  uint64_t  first = UINT64_MAX;
+  uint64_t  last  = 0;
+  bool      lost  = false;
+  uint64_t* all;
+  uint32_t  idx;
+  char      name[16];
+  LoadConnection* conn;
+
+  if (_config.rate > 0)
+  {
+    printf ("\nOpen loop, %.1f requests/s", _config.rate);
+  }
+  else
+  {
+    printf ("\nClosed loop, %u outstanding requests per connection",
+            _config.window);
+  }
+  printf (", %u connection(s), %u update(s)\n\n", _config.connections,
+          _noUpdates);
+  printf ("%-10s %10s %10s %8s %8s %10s %9s %9s %9s %9s\n", "Connection",
+          "Sent", "Received", "Lost", "Overrun", "Req/s", "p50 us", "p99 us",
+          "p99.9 us", "max us");
+
+  for (idx = 0; idx < _config.connections; idx++)
+  {
+    total += conns[idx].count;
+  }
+  all   = malloc((total != 0 ? total : 1) * sizeof(uint64_t));
+  total = 0;
+  for (idx = 0; idx < _config.connections; idx++)
+  {
+    conn = &conns[idx];
+    if ((all != NULL) && (conn->count != 0))
+    {
+      memcpy(all + total, conn->latencies, conn->count * sizeof(uint64_t));
+    }
+    total    += conn->count;
+    sent     += conn->sent;
+    overruns += conn->overruns;
+    first     = conn->firstSend < first ? conn->firstSend : first;
+    last      = conn->lastReceive > last ? conn->lastReceive : last;
+    lost     |= conn->lost;
+    snprintf(name, sizeof(name), "%u%s", idx, conn->lost ? "*" : "");
+    _printLine(name, conn->sent, conn->latencies, conn->count, conn->overruns,
+               conn->lastReceive > conn->firstSend
+               ? conn->lastReceive - conn->firstSend : 0);
+    if (conn->unmatched != 0)
+    {
+      printf ("%-10s %llu receipt(s) without request\n", "",
+              (unsigned long long)conn->unmatched);
+    }
+  }
+  if (all != NULL)
+  {
+    _printLine("Total", sent, all, total, overruns,
+               last > first ? last - first : 0);
+    free(all);
+  }
+  if (lost)
+  {
+    printf ("\n* connection lost\n");
+  }
+}
+
+/**
+ * Read the command line.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments, argv[0] is LOAD_ARG.
+ * @param prgName The name of the program.
+ *
+ * @return false if the program should stop.
+ */
+static bool _parseArgs(int argc, char* argv[], const char* prgName)
+{
+  int      argIdx;
+  uint32_t value;
+  char     opt;
+  bool     retVal = true;
+  bool     countGiven = false;
+
+  memset(&_config, 0, sizeof(LoadConfig));
+  _config.host        = LOAD_DEF_SERVER;
+  _config.port        = LOAD_DEF_PORT;
+  _config.connections = 1;
+  _config.noUpdates   = LOAD_DEF_UPDATES;
+  _config.requests    = LOAD_DEF_REQUESTS;
+  _config.window      = LOAD_DEF_WINDOW;
+  _config.method      = SRX_FLAG_ROA;
+  _config.drain       = LOAD_DEF_DRAIN;
+
+  for (argIdx = 1; retVal && (argIdx < argc); argIdx++)
+  {
+    if ((argv[argIdx][0] != '-') || (strlen(argv[argIdx]) != 2))
+    {
+      printf ("Error: Unknown argument '%s'!\n", argv[argIdx]);
+      retVal = false;
+      break;
+    }
+    opt = argv[argIdx][1];
+    if (opt == 'h')
+    {
+      _syntax(prgName);
+      return false;
+    }
+    if (strchr("sfrpculndwmSFW", opt) == NULL)
+    {
+      printf ("Error: Unknown argument '%s'!\n", argv[argIdx]);
+      retVal = false;
+      break;
+    }
+    if (argIdx + 1 == argc)
+    {
+      printf ("Error: Argument '%s' requires a value!\n", argv[argIdx]);
+      retVal = false;
+      break;
+    }
+    argIdx++;
+    switch (opt)
+    {
+      case 's':
+        _config.host = argv[argIdx];
+        break;
+      case 'f':
+        _config.file = argv[argIdx];
+        break;
+      case 'r':
+        _config.rate = strtod(argv[argIdx], NULL);
+        retVal = _config.rate > 0;
+        break;
+      default:
+        retVal = _parseU32(argv[argIdx], &value);
+        switch (opt)
+        {
+          case 'p':
+            _config.port = (int)value;
+            retVal = retVal && (value != 0) && (value <= UINT16_MAX);
+            break;
+          case 'c':
+            _config.connections = value;
+            retVal = retVal && (value != 0);
+            break;
+          case 'u':
+            _config.noUpdates = value;
+            retVal = retVal && (value != 0) && (value <= LOAD_MAX_UPDATES);
+            break;
+          case 'l':
+            _config.pathLength = value;
+            retVal = retVal && (value <= UINT16_MAX);
+            break;
+          case 'n':
+            _config.requests = value;
+            countGiven = true;
+            break;
+          case 'd':
+            _config.duration = value;
+            break;
+          case 'w':
+            _config.window = value;
+            retVal = retVal && (value != 0) && (value <= LOAD_MAX_OUTSTANDING);
+            break;
+          case 'm':
+            _config.method = (uint8_t)value;
+            retVal = retVal && (value != 0)
+                     && ((value & ~(SRX_FLAG_ROA | SRX_FLAG_BGPSEC
+                                    | SRX_FLAG_ASPA)) == 0);
+            break;
+          case 'S':
+            _config.shmRingSize = value;
+            break;
+          case 'F':
+            _config.flowWindow = value;
+            break;
+          case 'W':
+            _config.drain = value;
+        }
+    }
+    if (!retVal)
+    {
+      printf ("Error: Invalid value '%s' for '%s'!\n", argv[argIdx],
+              argv[argIdx - 1]);
+    }
+  }
+
+  // The duration replaces the default number of requests.
+  if ((_config.duration != 0) && !countGiven)
+  {
+    _config.requests = 0;
+  }
+  if (retVal && (_config.requests == 0) && (_config.duration == 0))
+  {
+    printf ("Error: Either a number of requests or a duration is needed!\n");
+    retVal = false;
+  }
+  if (!retVal)
+  {
+    printf ("Use '%s %s -h' for help.\n", prgName, LOAD_ARG);
+  }
+
+  return retVal;
+}
+
+/**
+ * Run the load generator until all requests are sent and answered or the
+ * configured duration elapsed, then print the throughput and the round trip
+ * latencies of each connection.
+ *
+ * @param argc The number of arguments, argv[0] is LOAD_ARG.
+ * @param argv The arguments.
+ *
+ * @return the exit code of the program.
+ *
+ * @since 0.6.3.0
+ */
+int runLoadGenerator(int argc, char* argv[])
+{
+  LoadConnection* conns;
+  LoadConnection* conn;
+  uint32_t        idx;
+  uint32_t        connected = 0;
+  uint32_t        outstanding;
+  uint64_t        start;
+  uint64_t        deadline;
+  pthread_attr_t  attr;
+  int             retVal = EXIT_SUCCESS;
+
+  if (!_parseArgs(argc, argv, "srxsvr_client"))
+  {
+    return EXIT_FAILURE;
+  }
+  if (_config.file != NULL ? !_readUpdates(_config.file)
+                           : !_generateUpdates(_config.noUpdates,
+                                               _config.pathLength))
+  {
+    _releaseUpdates();
+    return EXIT_FAILURE;
+  }
+
+  conns = calloc(_config.connections, sizeof(LoadConnection));
+  if (conns == NULL)
+  {
+    printf ("Error: Not enough memory for %u connections!\n",
+            _config.connections);
+    _releaseUpdates();
+    return EXIT_FAILURE;
+  }
+  signal(SIGINT, _stopLoad);
+
+  for (idx = 0; idx < _config.connections; idx++, connected++)
+  {
+    conn = &conns[idx];
+    conn->idx         = idx;
+    conn->nextLocalID = 1;
+    pthread_mutex_init(&conn->lock, NULL);
+    pthread_cond_init(&conn->cond, NULL);
+    conn->sentAt = calloc(LOAD_MAX_OUTSTANDING, sizeof(uint64_t));
+    conn->proxy  = createSRxProxy(_handleResult, _handleSignatures,
+                                  _handleSync, _handleComm,
+                                  LOAD_DEF_PROXY_ID + idx, LOAD_DEF_PROXY_AS,
+                                  conn);
+    if ((conn->sentAt == NULL) || (conn->proxy == NULL))
+    {
+      printf ("Error: Could not create proxy %u!\n", idx);
+      break;
+    }
+    if (_config.shmRingSize != 0)
+    {
+      setSharedMemoryTransport(conn->proxy, _config.shmRingSize);
+    }
+    if (_config.flowWindow != 0)
+    {
+      setFlowControlWindow(conn->proxy, _config.flowWindow);
+    }
+    if (!connectToSRx(conn->proxy, _config.host, _config.port,
+                      LOAD_HANDSHAKE_TIMEOUT, false))
+    {
+      printf ("Error: Proxy %u could not connect to %s:%u!\n", idx,
+              _config.host, _config.port);
+      break;
+    }
+  }
+
+  if (connected == _config.connections)
+  {
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (idx = 0; idx < _config.connections; idx++)
+    {
+      if (pthread_create(&conns[idx].receiver, &attr, _receiver, &conns[idx])
+          != 0)
+      {
+        conns[idx].receiverDone = true;
+        conns[idx].lost         = true;
+      }
+    }
+    pthread_attr_destroy(&attr);
+
+    start = _now();
+    for (idx = 0; idx < _config.connections; idx++)
+    {
+      __atomic_fetch_add(&_sendersActive, 1, __ATOMIC_RELEASE);
+      if (pthread_create(&conns[idx].sender, NULL, _sender, &conns[idx]) != 0)
+      {
+        __atomic_fetch_sub(&_sendersActive, 1, __ATOMIC_RELEASE);
+        conns[idx].sender = 0;
+        conns[idx].lost   = true;
+      }
+    }
+
+    // Send until all requests are sent or the time is up.
+    deadline = start + (uint64_t)_config.duration * 1000000000ULL;
+    while (_running && (__atomic_load_n(&_sendersActive, __ATOMIC_ACQUIRE)
+                        != 0))
+    {
+      if ((_config.duration != 0) && (_now() >= deadline))
+      {
+        break;
+      }
+      usleep(10000);
+    }
+    _running = false;
+    for (idx = 0; idx < _config.connections; idx++)
+    {
+      if (conns[idx].sender != 0)
+      {
+        pthread_join(conns[idx].sender, NULL);
+      }
+    }
+
+    // Wait for the outstanding notifications.
+    deadline = _now() + (uint64_t)_config.drain * 1000000000ULL;
+    do
+    {
+      outstanding = 0;
+      for (idx = 0; idx < _config.connections; idx++)
+      {
+        pthread_mutex_lock(&conns[idx].lock);
+        outstanding += conns[idx].lost ? 0 : conns[idx].outstanding;
+        pthread_mutex_unlock(&conns[idx].lock);
+      }
+      if (outstanding != 0)
+      {
+        usleep(10000);
+      }
+    } while ((outstanding != 0) && (_now() < deadline));
+  }
+  else
+  {
+    // No receiver was started.
+    for (idx = 0; idx < connected; idx++)
+    {
+      conns[idx].receiverDone = true;
+    }
+    retVal = EXIT_FAILURE;
+  }
+  _running = false;
+
+  for (idx = 0; idx < connected; idx++)
+  {
+    disconnectFromSRx(conns[idx].proxy, SRX_DEFAULT_KEEP_WINDOW);
+  }
+  // The receivers end once the server closed the connection.
+  deadline = _now() + 1000000000ULL;
+  for (idx = 0; idx < connected; idx++)
+  {
+    while (   !__atomic_load_n(&conns[idx].receiverDone, __ATOMIC_ACQUIRE)
+           && (_now() < deadline))
+    {
+      usleep(10000);
+    }
+  }
+
+  if (retVal == EXIT_SUCCESS)
+  {
+    _printReport(conns);
+  }
+
+  for (idx = 0; idx < _config.connections; idx++)
+  {
+    conn = &conns[idx];
+    // A receiver still running keeps its proxy.
+    if (   (conn->proxy != NULL)
+        && (   (idx >= connected)
+            || __atomic_load_n(&conn->receiverDone, __ATOMIC_ACQUIRE)))
+    {
+      releaseSRxProxy(conn->proxy);
+      free(conn->sentAt);
+      free(conn->latencies);
+      pthread_mutex_destroy(&conn->lock);
+      pthread_cond_destroy(&conn->cond);
+    }
+  }
+  // Connections still in use by their receiver are not released.
+  if (connected == _config.connections)
+  {
+    for (idx = 0; idx < connected; idx++)
+    {
+      if (!__atomic_load_n(&conns[idx].receiverDone, __ATOMIC_ACQUIRE))
+      {
+        conns = NULL;
+        break;
+      }
+    }
+  }
+  free(conns);
+  _releaseUpdates();
+
+  return retVal;
+}
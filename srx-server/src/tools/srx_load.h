@@ -0,0 +1,49 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * The load generator of srxsvr_client. It opens several proxy connections to
+ * an SRx server, sends validation requests replayed from a file or generated
+ * synthetically and measures the time until the receipt of each request.
+ *
+ * @version 0.6.3.0
+ */
+#ifndef __SRX_LOAD_H__
+#define __SRX_LOAD_H__
+
+/** The first program argument that selects the load generator. */
+#define LOAD_ARG "-load"
+
+/**
+ * Run the load generator until all requests are sent and answered or the
+ * configured duration elapsed, then print the throughput and the round trip
+ * latencies of each connection.
+ *
+ * @param argc The number of arguments, argv[0] is LOAD_ARG.
+ * @param argv The arguments.
+ *
+ * @return the exit code of the program.
+ *
+ * @since 0.6.3.0
+ */
+int runLoadGenerator(int argc, char* argv[]);
+
+#endif // __SRX_LOAD_H__
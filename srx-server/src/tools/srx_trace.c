@@ -0,0 +1,322 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Reads the trace dumps written by srx-server and prints the latency
+ * percentiles of each stage. The events are grouped by update ID, a trace
+ * starts once the validation request is received and the time of each
+ * following event is measured from the previous event of the same trace.
+ * Events of an update before it was received (e.g. a revalidation after the
+ * RPKI data changed) are not part of a trace and only counted.
+ *
+ * @version 0.6.3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "server/trace.h"
+#include "util/log.h"
+
+/** The index of the total latency of a trace. */
+#define STAGE_TOTAL  TRC_NUM_POINTS
+
+/** The latencies of one stage in nanoseconds. */
+typedef struct {
+  uint64_t* values;
+  uint32_t  count;
+  uint32_t  size;
+} StageValues;
+
+/**
+ * Print the syntax of the program.
+ *
+ * @param prgName The name of the program.
+ */
+static void syntax(const char* prgName)
+{
+  printf ("Syntax: %s [-h] <dump file> [<dump file> ...]\n\n", prgName);
+  printf ("  Prints the latency percentiles per stage of the updates traced\n"
+          "  by srx-server (trace.sample_rate, console command dump-trace).\n");
+  printf ("  -h  Print this help.\n");
+}
+
+/**
+ * Order the events by update ID and time.
+ *
+ * @param a The first event.
+ * @param b The second event.
+ *
+ * @return <0, 0, >0 like strcmp.
+ */
+static int _compareEvents(const void* a, const void* b)
+{
+  const TraceEvent* evA = (const TraceEvent*)a;
+  const TraceEvent* evB = (const TraceEvent*)b;
+
+  if (evA->updateID != evB->updateID)
+  {
+    return evA->updateID < evB->updateID ? -1 : 1;
+  }
+  if (evA->time != evB->time)
+  {
+    return evA->time < evB->time ? -1 : 1;
+  }
+  return (int)evA->point - (int)evB->point;
+}
+
+/**
+ * Order latencies ascending.
+ *
+ * @param a The first latency.
+ * @param b The second latency.
+ *
+ * @return <0, 0, >0 like strcmp.
+ */
+static int _compareValues(const void* a, const void* b)
+{
+  uint64_t valA = *(const uint64_t*)a;
+  uint64_t valB = *(const uint64_t*)b;
+
+  return valA < valB ? -1 : (valA > valB ? 1 : 0);
+}
+
+/**
+ * Add a latency to the stage.
+ *
+ * @param stage The stage.
+ * @param value The latency in nanoseconds.
+ *
+ * @return false if not enough memory is available.
+ */
+static bool _addValue(StageValues* stage, uint64_t value)
+{
+  uint64_t* values;
+
+  if (stage->count == stage->size)
+  {
+    values = realloc(stage->values,
+                     sizeof(uint64_t) * (stage->size * 2 + 1024));
+    if (values == NULL)
+    {
+      return false;
+    }
+    stage->values = values;
+    stage->size   = stage->size * 2 + 1024;
+  }
+  stage->values[stage->count++] = value;
+
+  return true;
+}
+
+/**
+ * Return the given percentile (nearest rank) of the sorted latencies in
+ * microseconds.
+ *
+ * @param stage The stage with the sorted latencies, not empty.
+ * @param percent The percentile.
+ *
+ * @return the latency in microseconds.
+ */
+static double _percentile(StageValues* stage, double percent)
+{
+  uint32_t rank = (uint32_t)((percent / 100.0) * stage->count + 0.999999);
+
+  if (rank == 0)
+  {
+    rank = 1;
+  }
+  if (rank > stage->count)
+  {
+    rank = stage->count;
+  }
+  return stage->values[rank - 1] / 1000.0;
+}
+
+/**
+ * Read all blocks of the dump file and append the events.
+ *
+ * @param fileName The dump file.
+ * @param events (in/out) The events read so far.
+ * @param noEvents (in/out) The number of events.
+ * @param dropped (in/out) The number of dropped events.
+ * @param sampleRate (out) The sample rate of the last block.
+ *
+ * @return false if the file could not be read.
+ */
+static bool _readDump(const char* fileName, TraceEvent** events,
+                      uint32_t* noEvents, uint64_t* dropped,
+                      uint32_t* sampleRate)
+{
+  TraceBlockHeader header;
+  TraceEvent*      block;
+  TraceEvent*      all;
+  FILE*            file = fopen(fileName, "rb");
+  bool             retVal = true;
+
+  if (file == NULL)
+  {
+    printf ("Error: Could not open the trace dump '%s'!\n", fileName);
+    return false;
+  }
+  while (   (retVal = readTraceBlock(file, &header, &block))
+         && (block != NULL))
+  {
+    all = realloc(*events, sizeof(TraceEvent) * (*noEvents + header.noEvents
+                                                 + 1));
+    if (all == NULL)
+    {
+      printf ("Error: Not enough memory to read '%s'!\n", fileName);
+      free(block);
+      retVal = false;
+      break;
+    }
+    memcpy(all + *noEvents, block, sizeof(TraceEvent) * header.noEvents);
+    *events      = all;
+    *noEvents   += header.noEvents;
+    *dropped    += header.dropped;
+    *sampleRate  = header.sampleRate;
+    free(block);
+  }
+  if (!retVal)
+  {
+    printf ("Error: Could not read the trace dump '%s'!\n", fileName);
+  }
+  fclose(file);
+
+  return retVal;
+}
+
+/**
+ * Reads the trace dumps and prints the latency percentiles per stage.
+ */
+int main(int argc, const char* argv[])
+{
+  StageValues stages[STAGE_TOTAL + 1];
+  TraceEvent* events     = NULL;
+  TraceEvent* start      = NULL;
+  TraceEvent* prev       = NULL;
+  uint32_t    noEvents   = 0;
+  uint32_t    noTraces   = 0;
+  uint32_t    noOrphans  = 0;
+  uint64_t    dropped    = 0;
+  uint32_t    sampleRate = 0;
+  uint32_t    idx;
+  int         argIdx;
+  int         exitVal    = 0;
+
+  if (argc < 2)
+  {
+    syntax(argv[0]);
+    return 1;
+  }
+  for (argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if (strcmp(argv[argIdx], "-h") == 0)
+    {
+      syntax(argv[0]);
+      return 0;
+    }
+  }
+
+  setLogMethodToFile(stderr);
+  setLogLevel(LEVEL_ERROR);
+  for (argIdx = 1; argIdx < argc; argIdx++)
+  {
+    if (!_readDump(argv[argIdx], &events, &noEvents, &dropped, &sampleRate))
+    {
+      free(events);
+      return 2;
+    }
+  }
+
+  memset(stages, 0, sizeof(stages));
+  qsort(events, noEvents, sizeof(TraceEvent), _compareEvents);
+  for (idx = 0; (idx < noEvents) && (exitVal == 0); idx++)
+  {
+    TraceEvent* event = &events[idx];
+
+    // A new update or a new request of the same update ends the trace.
+    if (   (start != NULL)
+        && (   (event->updateID != start->updateID)
+            || (event->point == TRC_POINT_RECEIVE)))
+    {
+      if (!_addValue(&stages[STAGE_TOTAL], prev->time - start->time))
+      {
+        exitVal = 3;
+      }
+      start = NULL;
+    }
+    if (event->point == TRC_POINT_RECEIVE)
+    {
+      start = event;
+      noTraces++;
+    }
+    else if (start == NULL)
+    {
+      noOrphans++;
+    }
+    else if (   (event->point >= TRC_NUM_POINTS)
+             || !_addValue(&stages[event->point], event->time - prev->time))
+    {
+      exitVal = 3;
+    }
+    prev = event;
+  }
+  if ((start != NULL) && !_addValue(&stages[STAGE_TOTAL],
+                                    prev->time - start->time))
+  {
+    exitVal = 3;
+  }
+  if (exitVal != 0)
+  {
+    printf ("Error: Invalid trace event or not enough memory!\n");
+  }
+  else
+  {
+    printf ("Events: %u, traces: %u, events without request: %u, "
+            "dropped: %llu, sample rate: 1/%u\n\n", noEvents, noTraces,
+            noOrphans, (unsigned long long)dropped, sampleRate);
+    printf ("%-12s %9s %11s %11s %11s %11s %11s\n", "stage", "count",
+            "p50 [us]", "p90 [us]", "p99 [us]", "p99.9 [us]", "max [us]");
+    for (idx = TRC_POINT_QUEUED; idx <= STAGE_TOTAL; idx++)
+    {
+      StageValues* stage = &stages[idx];
+      if (stage->count == 0)
+      {
+        continue;
+      }
+      qsort(stage->values, stage->count, sizeof(uint64_t), _compareValues);
+      printf ("%-12s %9u %11.1f %11.1f %11.1f %11.1f %11.1f\n",
+              idx == STAGE_TOTAL ? "total" : traceStageName(idx),
+              stage->count, _percentile(stage, 50), _percentile(stage, 90),
+              _percentile(stage, 99), _percentile(stage, 99.9),
+              stage->values[stage->count - 1] / 1000.0);
+    }
+  }
+
+  for (idx = 0; idx <= STAGE_TOTAL; idx++)
+  {
+    free(stages[idx].values);
+  }
+  free(events);
+
+  return exitVal;
+}
@@ -117,6 +117,7 @@
 #include "util/prefix.h"
 #include "util/str.h"
 #include "util/socket.h"
+#include "tools/srx_load.h"
 #ifdef USE_GRPC
 #include "client/grpc_client_service.h"
 #endif
@@ -1965,6 +1966,12 @@ int main(int argc, char* argv[])
   // Set the target for the logging.
   setLogMethodToFile(stderr);  
   setLogLevel(logLevel);
+
+  // Non interactive load generator
+  if ((argc > 1) && (strcmp(argv[1], LOAD_ARG) == 0))
+  {
+    return runLoadGenerator(argc - 1, argv + 1);
+  }
   // initialize the statistics framework
   fstatInitializeStatistics(false);
   uint32_t proxyID = IPtoInt(DEFAULT_PROXY_ID);
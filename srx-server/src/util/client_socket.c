@@ -46,7 +46,10 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
 #include <errno.h>
 #include "util/client_socket.h"
 #include "util/log.h"
@@ -79,18 +82,17 @@ bool createClientSocket(ClientSocket* self, const char* host, int port,
                         bool failNoServer, ClientSocketType type,
                         bool allowToClose)
 {
-  struct hostent* svr;
   int conRetVal;
 
   self->oldFD = -1;
   self->type = UNDEFINED_CLIENT_SOCKET; // for now
   self->canBeClosed = true; // for now
+  self->shm = NULL;
+  self->shmActive = false;
 
   // Resolve the host name
-  svr = gethostbyname(host);
-  if (svr == NULL)
+  if (!setClientSocketServer(self, host, port))
   {
-    RAISE_ERROR("Unknown host '%s'", host);
     return false;
   }
 
@@ -103,10 +105,6 @@ bool createClientSocket(ClientSocket* self, const char* host, int port,
   }
 
   // Connect TCP
-  memset(&self->svrAddr, 0, sizeof (struct sockaddr_in));
-  self->svrAddr.sin_family = AF_INET;
-  self->svrAddr.sin_port = htons(port);
-  memcpy(&(self->svrAddr.sin_addr.s_addr), svr->h_addr, svr->h_length);
   self->reconnect = true;
 
   conRetVal = connect(self->clientFD, (const struct sockaddr*)&self->svrAddr,
@@ -136,6 +134,38 @@ bool createClientSocket(ClientSocket* self, const char* host, int port,
   return true;
 }
 
+/**
+ * Set the server the next connect of the client socket goes to. The current
+ * connection is not affected.
+ *
+ * @param self The client socket.
+ * @param host The host to attach to.
+ * @param port The port to attach to.
+ *
+ * @return false if the host name could not be resolved.
+ *
+ * @since 0.6.3.0
+ */
+bool setClientSocketServer(ClientSocket* self, const char* host, int port)
+{
+  struct hostent* svr;
+
+  // Resolve the host name
+  svr = gethostbyname(host);
+  if (svr == NULL)
+  {
+    RAISE_ERROR("Unknown host '%s'", host);
+    return false;
+  }
+
+  memset(&self->svrAddr, 0, sizeof (struct sockaddr_in));
+  self->svrAddr.sin_family = AF_INET;
+  self->svrAddr.sin_port = htons(port);
+  memcpy(&(self->svrAddr.sin_addr.s_addr), svr->h_addr, svr->h_length);
+
+  return true;
+}
+
 /**
  * Closes the client socket and turns off the reconnect feature. This method
  * closes the socket on transport layer if possible, otherwise it only sets
@@ -150,6 +180,7 @@ void closeClientSocket(ClientSocket* self)
     int fileDescriptor = self->clientFD > -1 ? self->clientFD : self->oldFD;
 
     stopReconnectingToServer(self);
+    releaseClientSocketShm(self);
     if (fileDescriptor > -1)
     {
       // At least keep old behavior and close it if it is an rpki client socket.
@@ -168,6 +199,55 @@ void closeClientSocket(ClientSocket* self)
   }
 }
 
+/**
+ * Unmaps and frees the shared memory channel of the client-socket. All
+ * further data is exchanged through the socket.
+ *
+ * @param self Client-socket instance
+ *
+ * @since 0.6.3.0
+ */
+void releaseClientSocketShm(ClientSocket* self)
+{
+  ShmChannel* shm = self->shm;
+
+  if (shm != NULL)
+  {
+    self->shmActive = false;
+    self->shm       = NULL;
+    releaseShmChannel(shm);
+    free(shm);
+  }
+}
+
+/**
+ * Close the connection of the client socket if the socket is allowed to be
+ * closed, release the shared memory channel and reset both file descriptors.
+ *
+ * @param self The client socket.
+ *
+ * @since 0.6.3.0
+ */
+static void _dropConnection(ClientSocket* self)
+{
+  // Delete the file descriptor (otherwise CLOSE_WAIT)
+  if (self->canBeClosed)
+  {
+    int fileDescriptor = self->clientFD > -1 ? self->clientFD : self->oldFD;
+    if (fileDescriptor > -1)
+    {
+      close(fileDescriptor);
+    }
+  }
+
+  // The channel belongs to the old connection
+  releaseClientSocketShm(self);
+
+  // Re-initialize the file descriptors.
+  self->clientFD = -1;
+  self->oldFD = -1;
+}
+
 /**
  * This method reestablishes the current client connection to the server.
  * During this phase the parameter "reconnect" is set to true until the 
@@ -191,19 +271,7 @@ bool reconnectToServer(ClientSocket* self, int delay, int max_attempts)
   int max_att = max_attempts;
   int connectRetVal = 0;
 
-  // Delete the file descriptor (otherwise CLOSE_WAIT)
-  if (self->canBeClosed)
-  {
-    int fileDescriptor = self->clientFD > -1 ? self->clientFD : self->oldFD;
-    if (fileDescriptor > -1)
-    {
-      close(fileDescriptor);
-    }
-  }
-
-  // Re-initialize the file descriptors.
-  self->clientFD = -1;
-  self->oldFD = -1;
+  _dropConnection(self);
 
   // Try to reconnect
   while (self->reconnect && max_attempts > 0)
@@ -257,6 +325,117 @@ bool reconnectToServer(ClientSocket* self, int delay, int max_attempts)
   return succ;
 }
 
+/**
+ * Close a socket created by startConnectToServer that could not be connected.
+ * It is closed regardless of the setting self->canBeClosed.
+ *
+ * @param self The client socket.
+ * @param error The error of the connect.
+ *
+ * @return CLIENT_CONNECT_FAILED
+ */
+static ClientConnectState _connectFailed(ClientSocket* self, int error)
+{
+  LOG(LEVEL_DEBUG, "Connect to %s:%u failed: %s",
+                   inet_ntoa(self->svrAddr.sin_addr),
+                   ntohs(self->svrAddr.sin_port), strerror(error));
+  close(self->clientFD);
+  self->clientFD = -1;
+  self->oldFD    = -1;
+
+  return CLIENT_CONNECT_FAILED;
+}
+
+/**
+ * Start a non blocking connect to the server set last. An existing connection
+ * is dropped the same way reconnectToServer does. If the connect is pending
+ * the caller waits until the socket (clientFD) becomes writable and calls
+ * finishConnectToServer.
+ *
+ * @param self The client socket.
+ *
+ * @return the state of the connect.
+ *
+ * @since 0.6.3.0
+ */
+ClientConnectState startConnectToServer(ClientSocket* self)
+{
+  int flags;
+
+  _dropConnection(self);
+  if (!self->reconnect)
+  {
+    return CLIENT_CONNECT_FAILED;
+  }
+
+  self->clientFD = socket(AF_INET, SOCK_STREAM, 0);
+  if (self->clientFD < 0)
+  {
+    RAISE_ERROR("Failed to create a new client socket");
+    self->clientFD = -1;
+    return CLIENT_CONNECT_FAILED;
+  }
+  self->oldFD = self->clientFD;
+
+  flags = fcntl(self->clientFD, F_GETFL, 0);
+  fcntl(self->clientFD, F_SETFL, flags | O_NONBLOCK);
+  if (connect(self->clientFD, (const struct sockaddr*)&self->svrAddr,
+              sizeof (self->svrAddr)) == 0)
+  {
+    fcntl(self->clientFD, F_SETFL, flags);
+    return CLIENT_CONNECT_DONE;
+  }
+
+  return (errno == EINPROGRESS) ? CLIENT_CONNECT_PENDING
+                                : _connectFailed(self, errno);
+}
+
+/**
+ * Complete a connect started with startConnectToServer. Once the connection
+ * is established the socket is blocking again.
+ *
+ * @param self The client socket.
+ *
+ * @return CLIENT_CONNECT_PENDING as long as the socket is not writable yet,
+ *         otherwise the result of the connect.
+ *
+ * @since 0.6.3.0
+ */
+ClientConnectState finishConnectToServer(ClientSocket* self)
+{
+  struct pollfd pfd;
+  socklen_t     len   = sizeof(int);
+  int           error = 0;
+  int           flags;
+
+  if (self->clientFD == -1)
+  {
+    return CLIENT_CONNECT_FAILED;
+  }
+
+  pfd.fd      = self->clientFD;
+  pfd.events  = POLLOUT;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, 0) <= 0)
+  {
+    return CLIENT_CONNECT_PENDING;
+  }
+
+  if (getsockopt(self->clientFD, SOL_SOCKET, SO_ERROR, &error, &len) != 0)
+  {
+    error = errno;
+  }
+  if (error != 0)
+  {
+    return _connectFailed(self, error);
+  }
+
+  flags = fcntl(self->clientFD, F_GETFL, 0);
+  fcntl(self->clientFD, F_SETFL, flags & ~O_NONBLOCK);
+
+  return CLIENT_CONNECT_DONE;
+}
+
 /**
  * Turn off the reconnection feature.
  *
@@ -308,6 +487,10 @@ bool sendData(ClientSocket* self, void* data, PacketLength length)
   {
     *nullPopinter = 8;
   }
+  if (self->shmActive)
+  {
+    return shmSendNum(self->shm, &self->clientFD, data, (size_t)length);
+  }
   return sendNum(&self->clientFD, data, (size_t)length);
 //  return (sendNum(&self->clientFD, &length, sizeof(PacketLength))
 //          && sendNum(&self->clientFD, data, (size_t)length));
@@ -40,6 +40,7 @@
 
 #include <netinet/in.h>
 #include "util/packet.h"
+#include "util/shm_ring.h"
 
 typedef enum {
   /** This is an undefined socket. == NULL*/
@@ -56,6 +57,19 @@ typedef enum {
 #endif // USE_GRPC
 } ClientSocketType;
 
+/**
+ * The state of a non blocking connect.
+ */
+typedef enum {
+  /** The connection is established. */
+  CLIENT_CONNECT_DONE,
+  /** The connect is in progress, the socket becomes writable once it is
+   * completed. */
+  CLIENT_CONNECT_PENDING,
+  /** The connection could not be established. */
+  CLIENT_CONNECT_FAILED
+} ClientConnectState;
+
 /**
  * A Client Socket.
  */
@@ -79,6 +93,11 @@ typedef struct {
   bool                canBeClosed; // if this is false, the socket must not be
                                    // closed!! This is to allow external
                                    // socket control.
+  /** The shared memory channel offered to the server or NULL. */
+  ShmChannel*         shm;
+  /** Indicates if the server accepted the shared memory channel. In this case
+   * all data is exchanged through it and the socket only carries doorbells. */
+  bool                shmActive;
 } ClientSocket;
 
 /**
@@ -107,6 +126,20 @@ bool createClientSocket(ClientSocket* self, const char* host, int port,
                         bool failNoServer, ClientSocketType type,
                         bool allowToClose);
 
+/**
+ * Set the server the next connect of the client-socket goes to. The current
+ * connection is not affected.
+ *
+ * @param self Client-socket instance
+ * @param host The host to attach to.
+ * @param port The port to attach to.
+ *
+ * @return false if the host name could not be resolved.
+ *
+ * @since 0.6.3.0
+ */
+bool setClientSocketServer(ClientSocket* self, const char* host, int port);
+
 /**
  * Closes a client-socket.
  *
@@ -116,6 +149,16 @@ bool createClientSocket(ClientSocket* self, const char* host, int port,
  */
 void closeClientSocket(ClientSocket* self);
 
+/**
+ * Unmaps and frees the shared memory channel of the client-socket. All
+ * further data is exchanged through the socket.
+ *
+ * @param self Client-socket instance
+ *
+ * @since 0.6.3.0
+ */
+void releaseClientSocketShm(ClientSocket* self);
+
 /**
  * Tries to establish a connection to the server again.
  *
@@ -130,6 +173,33 @@ void closeClientSocket(ClientSocket* self);
  */
 bool reconnectToServer(ClientSocket* self, int delay, int max_attempts);
 
+/**
+ * Start a non blocking connect to the server. An existing connection is
+ * dropped the same way reconnectToServer does. If the connect is pending the
+ * caller waits until the socket becomes writable and calls
+ * finishConnectToServer.
+ *
+ * @param self Client-socket instance
+ *
+ * @return the state of the connect.
+ *
+ * @since 0.6.3.0
+ */
+ClientConnectState startConnectToServer(ClientSocket* self);
+
+/**
+ * Complete a connect started with startConnectToServer. Once the connection
+ * is established the socket is blocking again.
+ *
+ * @param self Client-socket instance
+ *
+ * @return CLIENT_CONNECT_PENDING as long as the socket is not writable yet,
+ *         otherwise the result of the connect.
+ *
+ * @since 0.6.3.0
+ */
+ClientConnectState finishConnectToServer(ClientSocket* self);
+
 /**
  * Stops any further attempts to connect to the server.
  *
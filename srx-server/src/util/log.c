@@ -69,6 +69,9 @@ static LogLevel _activeLevel = LEVEL_DEBUG;
 static char _tsBuf[TIMESTAMP_MAX_LEN];
 static LogMessagePosted _callback = NULL;
 
+/** Nothing is written until a log method is set. */
+int g_logThreshold = 0;
+
 /*--------------------
  * "_write*" variables
  */
@@ -124,6 +127,15 @@ static void _writeToBuffer (LogLevel level, const char* fmt, va_list args)
   vsnprintf(_buffer + cw, _bufMax - cw, fmt, args);
 }
 
+/**
+ * Update the threshold tested by the LOG macros after the log method or the
+ * level changed.
+ */
+static void _updateThreshold()
+{
+  g_logThreshold = (_callback != NULL) ? (int)_activeLevel : 0;
+}
+
 /*
  * SetLogMethod* functions
  */
@@ -131,11 +143,13 @@ void setLogMethodToFile (FILE* stream)
 {
   _stream = stream;
   _callback = (_stream != NULL) ? _writeToFile : NULL;
+  _updateThreshold();
 }
 
 void setLogMethodToSyslog ()
 {
   _callback = _writeToSyslog;
+  _updateThreshold();
 }
 
 void setLogMethodToBuffer (char* buffer, size_t max)
@@ -144,11 +158,13 @@ void setLogMethodToBuffer (char* buffer, size_t max)
   _bufMax = max;
   _callback = ((buffer != NULL) && (max > 0)) ?
   _writeToBuffer : (LogMessagePosted) NULL;
+  _updateThreshold();
 }
 
 void setLogMethodToCallback (LogMessagePosted cb)
 {
   _callback = cb;
+  _updateThreshold();
 }
 
 /*
@@ -157,6 +173,7 @@ void setLogMethodToCallback (LogMessagePosted cb)
 void setLogLevel (LogLevel level)
 {
   _activeLevel = level;
+  _updateThreshold();
 }
 
 /**
@@ -203,3 +220,37 @@ const char* logTimeStamp ()
   return (const char*) _tsBuf;
 }
 
+/**
+ * Determine if a rate limited message can be written now. Otherwise the
+ * message is counted as suppressed.
+ *
+ * @note Primarily for internal use, see LOG_RATE_LIMITED
+ *
+ * @param limit The state of the log statement.
+ * @param interval The minimum number of seconds between two messages.
+ * @param suppressed (out) The messages suppressed since the last one written.
+ *
+ * @return true if the message can be written.
+ *
+ * @since 0.6.3.0
+ */
+bool logRateLimit(LogRateLimit* limit, uint32_t interval, uint32_t* suppressed)
+{
+  struct timespec now;
+  uint64_t        nextTime;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  nextTime = __atomic_load_n(&limit->nextTime, __ATOMIC_RELAXED);
+  // Only one of the threads that reach the end of the interval writes.
+  if (   ((uint64_t)now.tv_sec < nextTime)
+      || !__atomic_compare_exchange_n(&limit->nextTime, &nextTime,
+                                      now.tv_sec + interval, false,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+    __atomic_fetch_add(&limit->suppressed, 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  *suppressed = __atomic_exchange_n(&limit->suppressed, 0, __ATOMIC_RELAXED);
+
+  return true;
+}
@@ -19,6 +19,10 @@
  * to set the log method at the beginning of the application - otherwise 
  * eventual message will be discarded.
  *  
+ * The LOG macros test the level before the arguments are evaluated. Release
+ * builds define LOG_COMPILE_LEVEL (configure --disable-debug-log) which removes
+ * all LOG statements above that level from the binary.
+ *  
  * @version 0.5.0.0
  *
  * Changelog:
@@ -45,6 +49,8 @@
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 /** 
  * Log levels.
@@ -162,13 +168,89 @@ extern void writeLog(LogLevel level, const char* fmt, ...);
  */
 extern const char* logTimeStamp();
 
+/** The state of a rate limited log statement. */
+typedef struct {
+  /** The monotonic time in seconds the next message is written. */
+  uint64_t nextTime;
+  /** The messages suppressed since the last message written. */
+  uint32_t suppressed;
+} LogRateLimit;
+
+/**
+ * Determine if a rate limited message can be written now. Otherwise the
+ * message is counted as suppressed.
+ *
+ * @note Primarily for internal use, see LOG_RATE_LIMITED
+ *
+ * @param limit The state of the log statement.
+ * @param interval The minimum number of seconds between two messages.
+ * @param suppressed (out) The messages suppressed since the last one written.
+ *
+ * @return true if the message can be written.
+ *
+ * @since 0.6.3.0
+ */
+extern bool logRateLimit(LogRateLimit* limit, uint32_t interval,
+                         uint32_t* suppressed);
+
+/** The highest level that is currently written or 0 if no log method is set.
+ * Maintained by the setLog* functions, use LOG_ENABLED to test it. */
+extern int g_logThreshold;
+
 /*-------
  * Macros
  */
 
-/** See writeLog. */
+/** The highest level compiled in. Release builds set it to LEVEL_NOTICE which
+ * removes the DEBUG and INFO statements. */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LEVEL_COMM
+#endif
+
+/** True if messages of the given level are written. Use it to guard code that
+ * only prepares log output. */
+#define LOG_ENABLED(LEVEL) \
+  (((LEVEL) <= LOG_COMPILE_LEVEL) && ((LEVEL) <= g_logThreshold))
+
+/** See writeLog. The arguments are only evaluated if the level is written. */
 #define LOG(LEVEL, FMT, ...) \
-  writeLog(LEVEL, "[%s] " FMT, logTimeStamp(), ## __VA_ARGS__)
+  do \
+  { \
+    if (LOG_ENABLED(LEVEL)) \
+    { \
+      writeLog(LEVEL, "[%s] " FMT, logTimeStamp(), ## __VA_ARGS__); \
+    } \
+  } while (0)
+
+/**
+ * Like LOG but writes at most one message each INTERVAL seconds from this
+ * statement. Meant for messages that can occur for each packet. The number
+ * of suppressed messages is appended to the next message written.
+ *
+ * @param LEVEL The log level
+ * @param INTERVAL The minimum number of seconds between two messages
+ * @param FMT \c printf like format string
+ * @param ... arguments
+ */
+#define LOG_RATE_LIMITED(LEVEL, INTERVAL, FMT, ...) \
+  do \
+  { \
+    static LogRateLimit _logLimit = { 0, 0 }; \
+    uint32_t _logSuppressed; \
+    if (   LOG_ENABLED(LEVEL) \
+        && logRateLimit(&_logLimit, INTERVAL, &_logSuppressed)) \
+    { \
+      if (_logSuppressed == 0) \
+      { \
+        writeLog(LEVEL, "[%s] " FMT, logTimeStamp(), ## __VA_ARGS__); \
+      } \
+      else \
+      { \
+        writeLog(LEVEL, "[%s] " FMT " (%u similar messages suppressed)", \
+                 logTimeStamp(), ## __VA_ARGS__, _logSuppressed); \
+      } \
+    } \
+  } while (0)
 
 #define STRINGIFY_ARG(ARG) #ARG
 #define STRINGIFY_IND(ARG) STRINGIFY_ARG(ARG)
@@ -45,6 +45,57 @@
 
 #define HDR "([0x%08X] Packet): "
 
+/**
+ * Return the shared memory channel the packets are received through.
+ *
+ * @param pHandler     Instance of the packet handler.
+ * @param pHandlerType The type of handler, srx-proxy or srx-server.
+ *
+ * @return the channel or NULL if the packets are received through the socket.
+ *
+ * @since 0.6.3.0
+ */
+static ShmChannel* _getShmChannel(void* pHandler,
+                                  PacketHandlerType pHandlerType)
+{
+  ShmChannel* shm = NULL;
+
+  if (pHandlerType == PHT_SERVER)
+  {
+    shm = ((ClientThread*)pHandler)->shm;
+  }
+  else if (pHandlerType == PHT_PROXY)
+  {
+    ClientConnectionHandler* cHandler =
+                   (ClientConnectionHandler*)((SRxProxy*)pHandler)->connHandler;
+    if (cHandler->clSock.shmActive)
+    {
+      shm = cHandler->clSock.shm;
+    }
+  }
+
+  return shm;
+}
+
+/**
+ * Receive the given number of bytes either through the shared memory channel
+ * or the socket.
+ *
+ * @param fdPtr  The file descriptor of the socket
+ * @param shm    The shared memory channel or NULL
+ * @param buffer The buffer to be filled
+ * @param num    The number of bytes to receive
+ *
+ * @return true if all bytes are received.
+ *
+ * @since 0.6.3.0
+ */
+static bool _recvNum(int* fdPtr, ShmChannel* shm, void* buffer, size_t num)
+{
+  return (shm != NULL) ? shmRecvNum(shm, fdPtr, buffer, num)
+                       : recvNum(fdPtr, buffer, num);
+}
+
 /**
  * This function runs in a loop to receive packets. This function is used as 
  * receiver loop on both sides, SRx server as well as SRx client. IN case the 
@@ -95,6 +146,10 @@ bool receivePackets(int* fdPtr, SRxPacketHandler dispatcher, void* pHandler,
 
   // used to keep the receiver going.
   bool keepGoing = true;
+  // The shared memory channel if negotiated
+  ShmChannel* shm = NULL;
+  // The number of packets received
+  uint32_t received = 0;
 
   // Keeps the thread rolling - Process all packets
   while (keepGoing)
@@ -106,16 +161,44 @@ bool receivePackets(int* fdPtr, SRxPacketHandler dispatcher, void* pHandler,
     memset(buffer, 0, sizeof(SRXPROXY_BasicHeader));
     
     hdr = (SRXPROXY_BasicHeader*)buffer;
+    shm = _getShmChannel(pHandler, pHandlerType);
     if (pHandlerType == PHT_PROXY)
     {
       // When in proxy, don't continue looping, the client reads once and then 
       // leaves
       keepGoing = false;
+      if (shm != NULL)
+      {
+        // The socket only carries doorbells, one doorbell can stand for many 
+        // packets. Read all packets waiting in the ring and only block if 
+        // nothing was read and the socket is not controlled by the router.
+        keepGoing = true;
+        if (   (received > 0)
+            || ((SRxProxy*)pHandler)->externalSocketControl)
+        {
+          if (!shmDrainDoorbell(shm, fdPtr))
+          {
+            retVal    = false;
+            keepGoing = false;
+            continue;
+          }
+          if ((shmAvailable(shm) == 0) && shmArmDoorbell(shm))
+          {
+            keepGoing = false;
+            continue;
+          }
+        }
+      }
+      else if (received > 0)
+      {
+        // The channel was released while processing the last packet.
+        continue;
+      }
     }
 
     retVal = true;    
     // Get the data
-    if (!recvNum(fdPtr, buffer, basicLength))
+    if (!_recvNum(fdPtr, shm, buffer, basicLength))
     {
       LOG(LEVEL_DEBUG, HDR "Received a packet but got an error",
         pthread_self());
@@ -201,7 +284,7 @@ bool receivePackets(int* fdPtr, SRxPacketHandler dispatcher, void* pHandler,
     memset(buffHelper, 0, buffSize - basicLength);
 
     // Receive the remainder of the packet
-    if (!recvNum(fdPtr, buffHelper, (size_t)remainder))
+    if (!_recvNum(fdPtr, shm, buffHelper, (size_t)remainder))
     {
       int error = getLastRecvError();
       RAISE_ERROR("Could not receive the basic remaining %u bytes, error %d!",
@@ -221,6 +304,7 @@ bool receivePackets(int* fdPtr, SRxPacketHandler dispatcher, void* pHandler,
       // call the dispatcher that deals with the packet
       // TODO: Good point to have a receiver queue handing it over to.
       dispatcher((SRXPROXY_BasicHeader*)buffer, pHandler); // --> call dispatchPackets()
+      received++;
     }
   }
 
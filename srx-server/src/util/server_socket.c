@@ -126,6 +126,30 @@ static bool initWriteMutex(ClientThread* cthread)
   return true;
 }
 
+/**
+ * Unmap the shared memory channel of the client if it exists.
+ *
+ * @param ct The client thread.
+ *
+ * @since 0.6.3.0
+ */
+static void _releaseClientShm(ClientThread* ct)
+{
+  ShmChannel* shm = ct->shm;
+
+  if (shm != NULL)
+  {
+    lockMutex(&ct->writeMutex);
+    ct->shmTx = false;
+    ct->shm   = NULL;
+    unlockMutex(&ct->writeMutex);
+    LOG(LEVEL_DEBUG, HDR "Release shared memory channel, %llu doorbells send",
+                     pthread_self(), (unsigned long long)shm->doorbells);
+    releaseShmChannel(shm);
+    free(shm);
+  }
+}
+
 /**
  * Clean-up of a single ClientThread.
  *
@@ -151,6 +175,8 @@ static void clientThreadCleanup(ClientMode mode, ClientThread* ct)
         socketToStr(ct->clientFD, true, buf, MAX_SOCKET_STRING_LEN));
   }
 
+  _releaseClientShm(ct);
+
   // The instance can be reused
   releaseMutex(&ct->writeMutex);
   ct->active = false;
@@ -187,7 +213,17 @@ static bool single_sendResult(ServerClient* client, void* data, size_t size)
   {
     printf("Still active\n");
     lockMutex(&clt->writeMutex);
-    sendData(&clt->clientFD, data, (PacketLength)size);
+    if (clt->shmTx)
+    {
+      if (!shmSendNum(clt->shm, &clt->clientFD, data, size))
+      {
+        RAISE_ERROR("Data could not be send!");
+      }
+    }
+    else
+    {
+      sendData(&clt->clientFD, data, (PacketLength)size);
+    }
     unlockMutex(&clt->writeMutex);
 #ifdef USE_GRPC
       retVal = true;
@@ -769,6 +805,8 @@ void runServerLoop(ServerSocket* self, ClientMode clMode,
     else
     {
       bool accepted = true;
+      // The status callback might install the output queue.
+      cthread->sendQueue = NULL;
       
       // Let the user know about the new client
       if (self->statusCallback != NULL)
@@ -792,6 +830,8 @@ void runServerLoop(ServerSocket* self, ClientMode clMode,
         cthread->routerID = 0; // Indicates that it is currently not usable, 
                                // must be set during handshake
         cthread->clientFD = cliendFD;
+        cthread->shm      = NULL;
+        cthread->shmTx    = false;
         cthread->svrSock  = self;
         cthread->caddr	  = caddr;
 #ifdef USE_GRPC
@@ -842,6 +882,10 @@ static void _killClientThread(void* clt)
     //pthread_join(clientThread->thread, NULL);
     pthread_cancel(clientThread->thread);
 
+    // The receiver only touches the shared memory while data is available,
+    // after the goodbye it waits on the (now closed) socket.
+    _releaseClientShm(clientThread);
+
     // Release the write-mutex
     releaseMutex(&clientThread->writeMutex);
     
@@ -935,6 +979,63 @@ int closeClientConnection(ServerSocket* self, ServerClient* client)
   return true;
 }
 
+/**
+ * Map the shared memory channel offered by the client. From here on all
+ * packets of the client are received through the shared memory. This MUST be
+ * called from within the receiver thread of the client.
+ *
+ * @param client The client connection.
+ * @param name The name of the shared memory segment.
+ *
+ * @return true if the channel is attached.
+ *
+ * @since 0.6.3.0
+ */
+bool attachClientShm(ServerClient* client, const char* name)
+{
+  ClientThread* clt = (ClientThread*)client;
+  ShmChannel*   shm = NULL;
+
+  if (clt->shm == NULL)
+  {
+    shm = malloc(sizeof(ShmChannel));
+    if (shm == NULL)
+    {
+      RAISE_ERROR("Not enough memory for the shared memory channel");
+    }
+    else if (attachShmChannel(shm, name))
+    {
+      clt->shm = shm;
+    }
+    else
+    {
+      free(shm);
+    }
+  }
+
+  return clt->shm != NULL;
+}
+
+/**
+ * Send all further packets to the client through the attached shared memory
+ * channel.
+ *
+ * @param client The client connection.
+ *
+ * @since 0.6.3.0
+ */
+void enableClientShm(ServerClient* client)
+{
+  ClientThread* clt = (ClientThread*)client;
+
+  if (clt->shm != NULL)
+  {
+    lockMutex(&clt->writeMutex);
+    clt->shmTx = true;
+    unlockMutex(&clt->writeMutex);
+  }
+}
+
 
 
 
@@ -83,6 +83,7 @@
 
 #include "util/mutex.h"
 #include "util/packet.h"
+#include "util/shm_ring.h"
 #include "util/slist.h"
 
 /** Maximum number of clients waiting to be accepted for connection. */
@@ -263,6 +264,17 @@ typedef struct
   
   Mutex writeMutex;
 
+  /** The shared memory channel offered by the proxy or NULL. Once set, the
+   * packets of the proxy are received through it. */
+  ShmChannel* shm;
+  /** Indicates that packets to the proxy are send through the shared memory
+   * channel. This is set after the hello response is send. */
+  bool shmTx;
+
+  /** The output queue of this client maintained by the srx packet sender or
+   * NULL if the packets are send directly. */
+  void* sendQueue;
+
   /* the server socket itself. */
   ServerSocket* svrSock;
   /* The socket address. */
@@ -335,6 +347,30 @@ bool sendPacketToClient(ServerSocket* self, ServerClient* client,
  */
 int closeClientConnection(ServerSocket* self, ServerClient* client);
 
+/**
+ * Map the shared memory channel offered by the client. From here on all
+ * packets of the client are received through the shared memory. This MUST be
+ * called from within the receiver thread of the client.
+ *
+ * @param client The client connection.
+ * @param name The name of the shared memory segment.
+ *
+ * @return true if the channel is attached.
+ *
+ * @since 0.6.3.0
+ */
+bool attachClientShm(ServerClient* client, const char* name);
+
+/**
+ * Send all further packets to the client through the attached shared memory
+ * channel.
+ *
+ * @param client The client connection.
+ *
+ * @since 0.6.3.0
+ */
+void enableClientShm(ServerClient* client);
+
 // TODO: Check if it is still needed - Still used in server_socket.c/h 
 // Maybe it can be moved into server_socket.c
 // In ROCKY this throws a linker error. The solution is to declare it extern here and then
@@ -0,0 +1,624 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Shared memory transport between SRx proxy and srx-server running on the
+ * same host.
+ *
+ * @version 0.6.3.0
+ */
+// Required for POLLRDHUP
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include "util/log.h"
+#include "util/shm_ring.h"
+
+#define HDR "([0x%08X] Shared Memory {%s}): "
+
+/** Identifies a shared memory segment of this implementation ("SRXR"). */
+#define SHM_MAGIC      0x53525852
+/** The layout version of the shared memory segment. */
+#define SHM_VERSION    1
+/** Number of times an empty ring is checked before waiting on the socket. */
+#define SHM_SPIN_LOOPS  2000
+/** Number of times the processor is given up before waiting on the socket. */
+#define SHM_YIELD_LOOPS 1000
+/** Time in milliseconds to wait on the socket before checking the ring. */
+#define SHM_POLL_MS     1000
+
+/** Spinning only helps if the peer runs on another processor. */
+static int _shm_spinLoops = -1;
+
+/**
+ * The beginning of the shared memory segment. The data of the ring towards
+ * the server follows, then the data of the ring towards the client.
+ */
+typedef struct {
+  uint32_t    magic;
+  uint32_t    version;
+  uint32_t    ringSize;
+  uint8_t     pad[52];
+  /** The ring written by the proxy (creator) and read by the server. */
+  ShmRingCtrl toServer;
+  /** The ring written by the server and read by the proxy (creator). */
+  ShmRingCtrl toClient;
+} ShmSegmentHeader;
+
+/**
+ * Return the smallest power of two greater or equal to the given size within
+ * the allowed range.
+ *
+ * @param size The requested size
+ *
+ * @return the ring size to be used.
+ */
+static uint32_t _shm_ringSize(uint32_t size)
+{
+  uint32_t ringSize = SHM_MIN_RING_SIZE;
+
+  if (size > SHM_MAX_RING_SIZE)
+  {
+    size = SHM_MAX_RING_SIZE;
+  }
+  while (ringSize < size)
+  {
+    ringSize <<= 1;
+  }
+
+  return ringSize;
+}
+
+/**
+ * Determine once how long a consumer spins on an empty ring.
+ */
+static void _shm_initSpinLoops()
+{
+  if (_shm_spinLoops == -1)
+  {
+    _shm_spinLoops = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? SHM_SPIN_LOOPS : 0;
+  }
+}
+
+/**
+ * Set the rings of this side of the channel.
+ *
+ * @param self The channel
+ * @param isCreator true for the side that created the segment (proxy).
+ */
+static void _shm_assignRings(ShmChannel* self, bool isCreator)
+{
+  ShmSegmentHeader* hdr = (ShmSegmentHeader*)self->base;
+  uint8_t* toServerData = self->base + sizeof(ShmSegmentHeader);
+  uint8_t* toClientData = toServerData + self->ringSize;
+
+  if (isCreator)
+  {
+    self->txCtrl = &hdr->toServer;
+    self->txData = toServerData;
+    self->rxCtrl = &hdr->toClient;
+    self->rxData = toClientData;
+  }
+  else
+  {
+    self->txCtrl = &hdr->toClient;
+    self->txData = toClientData;
+    self->rxCtrl = &hdr->toServer;
+    self->rxData = toServerData;
+  }
+}
+
+/**
+ * Wait for the doorbell and read it. Blocking sockets wait within recv, non
+ * blocking sockets (controlled by the router) wait in poll.
+ *
+ * @param self The channel
+ * @param fd The socket used as doorbell
+ *
+ * @return false if the connection is lost.
+ */
+static bool _shm_waitDoorbell(ShmChannel* self, int* fd)
+{
+  uint8_t       bells[64];
+  struct pollfd pfd;
+  ssize_t       rbytes;
+
+  if (*fd == -1)
+  {
+    return false;
+  }
+
+  rbytes = recv(*fd, bells, sizeof(bells), 0);
+  if (rbytes > 0)
+  {
+    return true;
+  }
+  if (rbytes == 0)
+  {
+    LOG(LEVEL_INFO, HDR "Connection reset by peer.", pthread_self(),
+                    self->name);
+    *fd = -1;
+    return false;
+  }
+  if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+  {
+    if (errno == EINTR)
+    {
+      return true;
+    }
+    LOG(LEVEL_INFO, HDR "Socket error 0x%X (%u) while waiting for data!",
+                    pthread_self(), self->name, errno, errno);
+    *fd = -1;
+    return false;
+  }
+
+  pfd.fd      = *fd;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+  // The next round reads the doorbell or detects the loss of the peer.
+  poll(&pfd, 1, SHM_POLL_MS);
+
+  return true;
+}
+
+/**
+ * Wait for the consumer to free space in the ring. The first rounds only give
+ * up the processor, then the socket is watched for the loss of the peer.
+ *
+ * @param self The channel
+ * @param fd The socket used as doorbell
+ * @param waits The number of rounds waited so far
+ *
+ * @return false if the connection is lost.
+ */
+static bool _shm_waitSpace(ShmChannel* self, int* fd, uint32_t* waits)
+{
+  struct pollfd pfd;
+
+  if (__atomic_load_n(&self->rxCtrl->closed, __ATOMIC_ACQUIRE) != 0)
+  {
+    LOG(LEVEL_INFO, HDR "Channel closed by peer.", pthread_self(), self->name);
+    *fd = -1;
+    return false;
+  }
+
+  if ((*waits)++ < SHM_YIELD_LOOPS)
+  {
+    sched_yield();
+    return true;
+  }
+
+  pfd.fd      = *fd;
+  pfd.events  = POLLRDHUP;
+  pfd.revents = 0;
+
+  // The socket only reports the loss of the peer, the timeout is the pause.
+  if (poll(&pfd, 1, 1) > 0)
+  {
+    if (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR | POLLNVAL))
+    {
+      LOG(LEVEL_INFO, HDR "Connection lost while waiting for free space.",
+                      pthread_self(), self->name);
+      *fd = -1;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Create a new shared memory segment and map it. This is done by the SRx
+ * proxy which offers the channel to the server within the HELLO message.
+ *
+ * @param self The channel to be initialized.
+ * @param name The name of the segment (starts with '/').
+ * @param ringSize The size of each ring, rounded up to a power of two.
+ *
+ * @return true if the channel could be created.
+ *
+ * @since 0.6.3.0
+ */
+bool createShmChannel(ShmChannel* self, const char* name, uint32_t ringSize)
+{
+  memset(self, 0, sizeof(ShmChannel));
+  snprintf(self->name, SHM_NAME_LENGTH, "%s", name);
+  self->ringSize = _shm_ringSize(ringSize);
+  self->mapSize  = sizeof(ShmSegmentHeader) + (2 * (size_t)self->ringSize);
+
+  int shmFD = shm_open(self->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (shmFD == -1)
+  {
+    RAISE_SYS_ERROR("Could not create the shared memory segment %s!",
+                    self->name);
+    return false;
+  }
+  self->owner = true;
+
+  if (ftruncate(shmFD, self->mapSize) == -1)
+  {
+    RAISE_SYS_ERROR("Could not size the shared memory segment %s!",
+                    self->name);
+    close(shmFD);
+    shm_unlink(self->name);
+    return false;
+  }
+
+  self->base = mmap(NULL, self->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    shmFD, 0);
+  close(shmFD);
+  if (self->base == MAP_FAILED)
+  {
+    RAISE_SYS_ERROR("Could not map the shared memory segment %s!", self->name);
+    self->base = NULL;
+    shm_unlink(self->name);
+    return false;
+  }
+
+  ShmSegmentHeader* hdr = (ShmSegmentHeader*)self->base;
+  hdr->magic    = SHM_MAGIC;
+  hdr->version  = SHM_VERSION;
+  hdr->ringSize = self->ringSize;
+  // Both consumers start armed, the first data always rings the doorbell.
+  hdr->toServer.armed = 1;
+  hdr->toClient.armed = 1;
+
+  _shm_assignRings(self, true);
+  _shm_initSpinLoops();
+  initMutex(&self->txMutex);
+
+  return true;
+}
+
+/**
+ * Map an existing shared memory segment created by the peer. The name is
+ * removed from the system once mapped, the memory itself is released as soon
+ * as both sides unmapped it.
+ *
+ * @param self The channel to be initialized.
+ * @param name The name of the segment.
+ *
+ * @return true if the channel could be attached.
+ *
+ * @since 0.6.3.0
+ */
+bool attachShmChannel(ShmChannel* self, const char* name)
+{
+  struct stat st;
+  bool retVal = false;
+
+  memset(self, 0, sizeof(ShmChannel));
+  snprintf(self->name, SHM_NAME_LENGTH, "%s", name);
+
+  int shmFD = shm_open(self->name, O_RDWR, 0600);
+  if (shmFD == -1)
+  {
+    LOG(LEVEL_INFO, HDR "Could not open the shared memory segment (errno %u)",
+                    pthread_self(), self->name, errno);
+    return false;
+  }
+  // Nobody else needs the name anymore.
+  shm_unlink(self->name);
+
+  if (   (fstat(shmFD, &st) == 0)
+      && (st.st_size >= (off_t)sizeof(ShmSegmentHeader)))
+  {
+    self->mapSize = (size_t)st.st_size;
+    self->base    = mmap(NULL, self->mapSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, shmFD, 0);
+    if (self->base == MAP_FAILED)
+    {
+      self->base = NULL;
+    }
+  }
+  close(shmFD);
+
+  if (self->base != NULL)
+  {
+    ShmSegmentHeader* hdr = (ShmSegmentHeader*)self->base;
+    self->ringSize = hdr->ringSize;
+    if (   (hdr->magic == SHM_MAGIC) && (hdr->version == SHM_VERSION)
+        && (self->ringSize == _shm_ringSize(self->ringSize))
+        && (self->mapSize == sizeof(ShmSegmentHeader)
+                             + (2 * (size_t)self->ringSize)))
+    {
+      _shm_assignRings(self, false);
+      _shm_initSpinLoops();
+      initMutex(&self->txMutex);
+      retVal = true;
+    }
+    else
+    {
+      LOG(LEVEL_WARNING, HDR "Invalid shared memory segment!", pthread_self(),
+                         self->name);
+      munmap(self->base, self->mapSize);
+      self->base = NULL;
+    }
+  }
+
+  return retVal;
+}
+
+/**
+ * Remove the name of the segment from the system if this side created it.
+ *
+ * @param self The channel.
+ *
+ * @since 0.6.3.0
+ */
+void unlinkShmChannel(ShmChannel* self)
+{
+  if (self->owner)
+  {
+    // The peer might have removed it already.
+    shm_unlink(self->name);
+    self->owner = false;
+  }
+}
+
+/**
+ * Close the write direction, unmap the segment and free all resources.
+ *
+ * @param self The channel.
+ *
+ * @since 0.6.3.0
+ */
+void releaseShmChannel(ShmChannel* self)
+{
+  if (self->base != NULL)
+  {
+    __atomic_store_n(&self->txCtrl->closed, 1, __ATOMIC_SEQ_CST);
+    unlinkShmChannel(self);
+    munmap(self->base, self->mapSize);
+    self->base   = NULL;
+    self->rxCtrl = NULL;
+    self->txCtrl = NULL;
+    releaseMutex(&self->txMutex);
+  }
+}
+
+/**
+ * Writes \c num Bytes into the send ring. In case the ring is full the call
+ * waits until the peer consumed enough data. The doorbell is rang over the
+ * given socket if the peer waits for data.
+ * In case of an error \c fd is set to \c -1.
+ *
+ * @param self The channel.
+ * @param fd The socket used as doorbell.
+ * @param buffer Data to write.
+ * @param num Size of buffer.
+ *
+ * @return true = successful, false = failed
+ *
+ * @since 0.6.3.0
+ */
+bool shmSendNum(ShmChannel* self, int* fd, void* buffer, size_t num)
+{
+  uint8_t* data   = (uint8_t*)buffer;
+  uint32_t mask   = self->ringSize - 1;
+  bool     retVal = true;
+  uint8_t  bell   = 0;
+  uint32_t waits  = 0;
+
+  lockMutex(&self->txMutex);
+  while (num > 0)
+  {
+    if (*fd == -1)
+    {
+      retVal = false;
+      break;
+    }
+
+    uint32_t tail  = self->txCtrl->tail;
+    uint32_t head  = __atomic_load_n(&self->txCtrl->head, __ATOMIC_ACQUIRE);
+    uint32_t space = self->ringSize - (tail - head);
+
+    if (space == 0)
+    {
+      if (!_shm_waitSpace(self, fd, &waits))
+      {
+        retVal = false;
+        break;
+      }
+      continue;
+    }
+
+    waits = 0;
+    // Copy as much as possible, split in two if the ring wraps around.
+    uint32_t chunk = (num < space) ? (uint32_t)num : space;
+    uint32_t pos   = tail & mask;
+    uint32_t first = (chunk < self->ringSize - pos) ? chunk
+                                                    : self->ringSize - pos;
+    memcpy(self->txData + pos, data, first);
+    memcpy(self->txData, data + first, chunk - first);
+    __atomic_store_n(&self->txCtrl->tail, tail + chunk, __ATOMIC_SEQ_CST);
+    data += chunk;
+    num  -= chunk;
+
+    // Ring the doorbell only if the consumer waits for it.
+    if (__atomic_exchange_n(&self->txCtrl->armed, 0, __ATOMIC_SEQ_CST) != 0)
+    {
+      self->doorbells++;
+      if (send(*fd, &bell, 1, MSG_NOSIGNAL) != 1)
+      {
+        LOG(LEVEL_INFO, HDR "Could not ring the doorbell (errno %u)",
+                        pthread_self(), self->name, errno);
+        *fd = -1;
+        retVal = false;
+        break;
+      }
+    }
+  }
+  unlockMutex(&self->txMutex);
+
+  return retVal;
+}
+
+/**
+ * Reads \c num Bytes from the receive ring. In case not enough data is
+ * available the call waits on the given socket for the doorbell.
+ * In case the connection is lost \c fd is set to \c -1.
+ *
+ * @note Blocking call
+ *
+ * @param self The channel.
+ * @param fd The socket used as doorbell.
+ * @param buffer (out) Destination for the read data.
+ * @param num Number of Bytes to read.
+ *
+ * @return true = successful, false = failed
+ *
+ * @since 0.6.3.0
+ */
+bool shmRecvNum(ShmChannel* self, int* fd, void* buffer, size_t num)
+{
+  uint8_t* data  = (uint8_t*)buffer;
+  uint32_t mask  = self->ringSize - 1;
+  int      spins = 0;
+
+  while (num > 0)
+  {
+    uint32_t head  = self->rxCtrl->head;
+    uint32_t avail = __atomic_load_n(&self->rxCtrl->tail, __ATOMIC_ACQUIRE)
+                     - head;
+
+    if (avail == 0)
+    {
+      if (spins++ < _shm_spinLoops)
+      {
+        continue;
+      }
+      spins = 0;
+      if (shmArmDoorbell(self))
+      {
+        if (__atomic_load_n(&self->rxCtrl->closed, __ATOMIC_ACQUIRE) != 0)
+        {
+          LOG(LEVEL_INFO, HDR "Channel closed by peer.", pthread_self(),
+                          self->name);
+          *fd = -1;
+          return false;
+        }
+        if (!_shm_waitDoorbell(self, fd))
+        {
+          return false;
+        }
+      }
+      continue;
+    }
+
+    uint32_t chunk = (num < avail) ? (uint32_t)num : avail;
+    uint32_t pos   = head & mask;
+    uint32_t first = (chunk < self->ringSize - pos) ? chunk
+                                                    : self->ringSize - pos;
+    memcpy(data, self->rxData + pos, first);
+    memcpy(data + first, self->rxData, chunk - first);
+    __atomic_store_n(&self->rxCtrl->head, head + chunk, __ATOMIC_RELEASE);
+    data += chunk;
+    num  -= chunk;
+  }
+
+  return true;
+}
+
+/**
+ * Return the number of bytes waiting in the receive ring.
+ *
+ * @param self The channel.
+ *
+ * @return the number of bytes that can be read without waiting.
+ *
+ * @since 0.6.3.0
+ */
+uint32_t shmAvailable(ShmChannel* self)
+{
+  return __atomic_load_n(&self->rxCtrl->tail, __ATOMIC_ACQUIRE)
+         - self->rxCtrl->head;
+}
+
+/**
+ * Read all pending doorbells from the socket without blocking.
+ *
+ * @param self The channel.
+ * @param fd The socket used as doorbell.
+ *
+ * @return false if the connection is lost.
+ *
+ * @since 0.6.3.0
+ */
+bool shmDrainDoorbell(ShmChannel* self, int* fd)
+{
+  uint8_t bells[64];
+  ssize_t rbytes;
+
+  if (*fd == -1)
+  {
+    return false;
+  }
+
+  do
+  {
+    rbytes = recv(*fd, bells, sizeof(bells), MSG_DONTWAIT);
+  } while (rbytes == sizeof(bells));
+
+  if (rbytes == 0)
+  {
+    LOG(LEVEL_INFO, HDR "Connection reset by peer.", pthread_self(),
+                    self->name);
+    *fd = -1;
+    return false;
+  }
+  if ((rbytes == -1) && (errno != EAGAIN) && (errno != EWOULDBLOCK)
+      && (errno != EINTR))
+  {
+    LOG(LEVEL_INFO, HDR "Socket error 0x%X (%u) while reading the doorbell!",
+                    pthread_self(), self->name, errno, errno);
+    *fd = -1;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Arm the receive ring before waiting on the socket. In case data arrived in
+ * the meantime the caller must not wait.
+ *
+ * @param self The channel.
+ *
+ * @return true if the ring is empty and the caller can wait on the socket.
+ *
+ * @since 0.6.3.0
+ */
+bool shmArmDoorbell(ShmChannel* self)
+{
+  __atomic_store_n(&self->rxCtrl->armed, 1, __ATOMIC_SEQ_CST);
+  // The producer might have written before it saw the ring armed.
+  return shmAvailable(self) == 0;
+}
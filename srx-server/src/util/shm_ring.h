@@ -0,0 +1,213 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Shared memory transport between SRx proxy and srx-server running on the
+ * same host. A channel consists of two single-producer/single-consumer byte
+ * rings, one per direction, in a POSIX shared memory segment. The rings carry
+ * the same byte stream as the TCP connection would.
+ *
+ * The TCP connection stays open and is used as doorbell and to detect the
+ * loss of the peer. A consumer that runs out of data arms its ring and waits
+ * on the socket, the producer sends a single byte over the socket only if the
+ * ring is armed. This way the socket remains the file descriptor the router
+ * polls and under load no system call is needed per message.
+ *
+ * @version 0.6.3.0
+ */
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "util/mutex.h"
+
+/** Maximum length of the shared memory segment name including '\0'. */
+#define SHM_NAME_LENGTH      32
+/** The default size of each ring in bytes. */
+#define SHM_DEF_RING_SIZE    (1024 * 1024)
+/** The minimum size of each ring in bytes. */
+#define SHM_MIN_RING_SIZE    4096
+/** The maximum size of each ring in bytes. */
+#define SHM_MAX_RING_SIZE    (64 * 1024 * 1024)
+
+/**
+ * The control block of a single ring within the shared memory. Producer and
+ * consumer positions are kept in separate cache lines.
+ */
+typedef struct {
+  /** Read position, only written by the consumer. */
+  volatile uint32_t head;
+  uint8_t           pad1[60];
+  /** Write position, only written by the producer. */
+  volatile uint32_t tail;
+  uint8_t           pad2[60];
+  /** Set by the consumer before it waits for the doorbell. */
+  volatile uint32_t armed;
+  /** Set by the producer when it closes the channel. */
+  volatile uint32_t closed;
+  uint8_t           pad3[56];
+} ShmRingCtrl;
+
+/**
+ * A shared memory channel as seen by one side of the connection.
+ */
+typedef struct {
+  /** The name of the shared memory segment. */
+  char         name[SHM_NAME_LENGTH];
+  /** The mapped segment. */
+  uint8_t*     base;
+  /** The size of the mapped segment. */
+  size_t       mapSize;
+  /** The size of each ring in bytes (power of two). */
+  uint32_t     ringSize;
+  /** The ring this side reads from. */
+  ShmRingCtrl* rxCtrl;
+  uint8_t*     rxData;
+  /** The ring this side writes into. */
+  ShmRingCtrl* txCtrl;
+  uint8_t*     txData;
+  /** Indicates if this side created the segment. */
+  bool         owner;
+  /** Serializes writers of this side. */
+  Mutex        txMutex;
+  /** Number of doorbells send. */
+  uint64_t     doorbells;
+} ShmChannel;
+
+/**
+ * Create a new shared memory segment and map it. This is done by the SRx
+ * proxy which offers the channel to the server within the HELLO message.
+ *
+ * @param self The channel to be initialized.
+ * @param name The name of the segment (starts with '/').
+ * @param ringSize The size of each ring, rounded up to a power of two.
+ *
+ * @return true if the channel could be created.
+ *
+ * @since 0.6.3.0
+ */
+bool createShmChannel(ShmChannel* self, const char* name, uint32_t ringSize);
+
+/**
+ * Map an existing shared memory segment created by the peer. The name is
+ * removed from the system once mapped, the memory itself is released as soon
+ * as both sides unmapped it.
+ *
+ * @param self The channel to be initialized.
+ * @param name The name of the segment.
+ *
+ * @return true if the channel could be attached.
+ *
+ * @since 0.6.3.0
+ */
+bool attachShmChannel(ShmChannel* self, const char* name);
+
+/**
+ * Remove the name of the segment from the system if this side created it.
+ *
+ * @param self The channel.
+ *
+ * @since 0.6.3.0
+ */
+void unlinkShmChannel(ShmChannel* self);
+
+/**
+ * Close the write direction, unmap the segment and free all resources.
+ *
+ * @param self The channel.
+ *
+ * @since 0.6.3.0
+ */
+void releaseShmChannel(ShmChannel* self);
+
+/**
+ * Writes \c num Bytes into the send ring. In case the ring is full the call
+ * waits until the peer consumed enough data. The doorbell is rang over the
+ * given socket if the peer waits for data.
+ * In case of an error \c fd is set to \c -1.
+ *
+ * @param self The channel.
+ * @param fd The socket used as doorbell.
+ * @param buffer Data to write.
+ * @param num Size of buffer.
+ *
+ * @return true = successful, false = failed
+ *
+ * @since 0.6.3.0
+ */
+bool shmSendNum(ShmChannel* self, int* fd, void* buffer, size_t num);
+
+/**
+ * Reads \c num Bytes from the receive ring. In case not enough data is
+ * available the call waits on the given socket for the doorbell.
+ * In case the connection is lost \c fd is set to \c -1.
+ *
+ * @note Blocking call
+ *
+ * @param self The channel.
+ * @param fd The socket used as doorbell.
+ * @param buffer (out) Destination for the read data.
+ * @param num Number of Bytes to read.
+ *
+ * @return true = successful, false = failed
+ *
+ * @since 0.6.3.0
+ */
+bool shmRecvNum(ShmChannel* self, int* fd, void* buffer, size_t num);
+
+/**
+ * Return the number of bytes waiting in the receive ring.
+ *
+ * @param self The channel.
+ *
+ * @return the number of bytes that can be read without waiting.
+ *
+ * @since 0.6.3.0
+ */
+uint32_t shmAvailable(ShmChannel* self);
+
+/**
+ * Read all pending doorbells from the socket without blocking.
+ *
+ * @param self The channel.
+ * @param fd The socket used as doorbell.
+ *
+ * @return false if the connection is lost.
+ *
+ * @since 0.6.3.0
+ */
+bool shmDrainDoorbell(ShmChannel* self, int* fd);
+
+/**
+ * Arm the receive ring before waiting on the socket. In case data arrived in
+ * the meantime the caller must not wait.
+ *
+ * @param self The channel.
+ *
+ * @return true if the ring is empty and the caller can wait on the socket.
+ *
+ * @since 0.6.3.0
+ */
+bool shmArmDoorbell(ShmChannel* self);
+
+#endif // !__SHM_RING_H__
@@ -4,22 +4,28 @@
  * their official duties. Pursuant to title 17 Section 105 of the United
  * States Code this software is not subject to copyright protection and
  * is in the public domain.
- * 
+ *
  * NIST assumes no responsibility whatsoever for its use by other parties,
  * and makes no guarantees, expressed or implied, about its quality,
  * reliability, or any other characteristic.
- * 
+ *
  * We would appreciate acknowledgment if the software is used.
- * 
+ *
  * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
  * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
  * FROM THE USE OF THIS SOFTWARE.
- * 
- * 
+ *
+ *
  * This software might use libraries that are under GNU public license or
- * other licenses. Please refer to the licenses of all libraries required 
+ * other licenses. Please refer to the licenses of all libraries required
  * by this software.
  *
+ * The timers are kept in a min-heap ordered by their deadline on the
+ * monotonic clock. A timerfd is armed with the earliest deadline, the timer
+ * thread waits on it and calls the callbacks of the expired timers. The
+ * callbacks run on the timer thread, not in signal context, and may start
+ * and stop timers themselves.
+ *
  * @version 0.3.0.10
  *
  * Changelog:
@@ -29,249 +35,438 @@
  *            * Fixed speller in documentation header
  *            * Added missing void to function setTimer
  * 0.1.0    - 2009/12/32 -pgleichm
- *            * Code created. 
+ *            * Code created.
  */
 #include <stdio.h>
-#include <signal.h>
-#include <sys/time.h>
-#include "util/slist.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "util/log.h"
 #include "util/timer.h"
-// @TODO: Check if still used of if already replaced by stock functions.
+
+#define HDR "([0x%08X] Timer): "
+
+/** The number of timer slots added at once. */
+#define TIMER_ALLOC_STEP 16
+
 /**
  * A single timer
  */
 typedef struct {
-  int           id;
+  /** The slot is assigned to a timer. */
+  bool          used;
+  /** The timer is in the heap. */
   bool          active;
-  time_t        future; 
-  int           interval;
+  /** The time to fire in milliseconds of the monotonic clock. */
+  uint64_t      deadline;
+  /** Fire again after interval milliseconds, 0 = only once. */
+  uint64_t      interval;
+  /** The position within the heap. */
+  int           heapPos;
   TimerExpired  callback;
 } Timer;
 
-/** Prevents that the timer-list gets reset */
-static bool   _initialized = false;
-/** List of all timers */
-static SList  _timerList;
-/** Id of the active timer */
-static int    _activeId; 
+/** Protects the timers and the heap. */
+static pthread_mutex_t _timerMutex = PTHREAD_MUTEX_INITIALIZER;
+/** All timers, the index is the timer id. */
+static Timer*    _timers     = NULL;
+/** The number of timer slots. */
+static int       _noTimers   = 0;
+/** The ids of the active timers, the earliest deadline first. */
+static int*      _heap       = NULL;
+/** The number of active timers. */
+static int       _heapSize   = 0;
+/** The timerfd armed with the earliest deadline. */
+static int       _timerFD    = -1;
+/** The thread calling the callbacks. */
+static pthread_t _timerThread;
+/** Prevents that the timers get reset */
+static bool      _initialized = false;
+/** Tells the timer thread to stop. */
+static bool      _stop        = false;
 
+/**
+ * Return the current time of the monotonic clock.
+ *
+ * @return the time in milliseconds.
+ */
+static uint64_t _now()
+{
+  struct timespec ts;
 
-static void setTimer(int sec) 
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Arm the timerfd with the earliest deadline or disarm it. A waiting timer
+ * thread picks up the new time right away. The caller MUST hold the mutex.
+ */
+static void _armTimerFD()
 {
-  struct itimerval  tv;
+  struct itimerspec its;
+  uint64_t          deadline;
+
+  memset(&its, 0, sizeof(struct itimerspec));
+  if (_stop)
+  {
+    // Wake up the thread.
+    its.it_value.tv_nsec = 1;
+    timerfd_settime(_timerFD, 0, &its, NULL);
+  }
+  else if (_heapSize > 0)
+  {
+    // A zero value disarms the timer, fire at least 1 ms after the start of
+    // the clock.
+    deadline = _timers[_heap[0]].deadline;
+    deadline = deadline > 0 ? deadline : 1;
+    its.it_value.tv_sec  = deadline / 1000;
+    its.it_value.tv_nsec = (deadline % 1000) * 1000000;
+    timerfd_settime(_timerFD, TFD_TIMER_ABSTIME, &its, NULL);
+  }
+  else
+  {
+    timerfd_settime(_timerFD, 0, &its, NULL);
+  }
+}
 
-  timerclear(&tv.it_interval);
-  tv.it_value.tv_usec = 0;
-  tv.it_value.tv_sec  = sec;
+/**
+ * Swap two heap entries.
+ *
+ * @param pos1 The first position.
+ * @param pos2 The second position.
+ */
+static void _swap(int pos1, int pos2)
+{
+  int id = _heap[pos1];
 
-  setitimer(ITIMER_REAL, &tv, NULL);
+  _heap[pos1] = _heap[pos2];
+  _heap[pos2] = id;
+  _timers[_heap[pos1]].heapPos = pos1;
+  _timers[_heap[pos2]].heapPos = pos2;
 }
 
 /**
- * Sets the alarm to the earliest timer.
+ * Restore the heap order for the entry at the given position.
+ *
+ * @param pos The position of the entry that changed.
  */
-static void selectTimer() 
+static void _reorder(int pos)
 {
-  time_t            min = 0;
-  SListNode*        cnode;
-  Timer*            tcurr, *tsel = NULL;
+  int child;
 
-  // Search for the earliest time - a sorted list would be an alternative
-  FOREACH_SLIST(&_timerList, cnode) 
+  // Move up
+  while ((pos > 0) && (_timers[_heap[pos]].deadline
+                       < _timers[_heap[(pos - 1) / 2]].deadline))
   {
-    tcurr = (Timer*)cnode->data;
-
-    // Not an active timer - skip
-    if (!tcurr->active) 
+    _swap(pos, (pos - 1) / 2);
+    pos = (pos - 1) / 2;
+  }
+  // Move down
+  while ((child = pos * 2 + 1) < _heapSize)
+  {
+    if (   (child + 1 < _heapSize)
+        && (_timers[_heap[child + 1]].deadline
+            < _timers[_heap[child]].deadline))
     {
-      continue;
+      child++;
     }
-
-    // Earlier than the previous timer(s)
-    if ((tcurr->future < min) || (min == 0)) 
+    if (_timers[_heap[child]].deadline >= _timers[_heap[pos]].deadline)
     {
-      tsel = tcurr;
-      min = tcurr->future;
+      break;
     }
+    _swap(pos, child);
+    pos = child;
   }
+}
 
-  // A timer has been selected
-  if (tsel != NULL) 
-  {
-    _activeId = tsel->id;
-    setTimer(tsel->future - time(NULL));
+/**
+ * Remove the timer from the heap. The caller MUST hold the mutex.
+ *
+ * @param t The active timer.
+ */
+static void _removeFromHeap(Timer* t)
+{
+  int pos = t->heapPos;
 
-  // No active timer
-  } 
-  else 
+  _heapSize--;
+  if (pos != _heapSize)
   {
-    _activeId = -1;
+    _swap(pos, _heapSize);
+    _reorder(pos);
   }
+  t->active = false;
 }
 
-/** 
- * \c alarm function.
+/**
+ * Return the timer with the given id. The caller MUST hold the mutex.
  *
- * @param _sig (unused) Signal
+ * @param id Timer identifier
+ *
+ * @return the timer or NULL.
  */
-static void alarmSignal(int sig) 
+static Timer* _getTimer(int id)
 {
-  if (_activeId > -1) 
-  {
-    Timer* t = getFromSList(&_timerList, _activeId);
+  return ((id >= 0) && (id < _noTimers) && _timers[id].used)
+         ? &_timers[id] : NULL;
+}
+
+/**
+ * The timer thread. Waits for the earliest deadline and calls the callbacks
+ * of the expired timers without holding the mutex.
+ *
+ * @param arg Not used.
+ *
+ * @return NULL
+ */
+static void* _timerLoop(void* arg)
+{
+  uint64_t     expirations;
+  TimerExpired callback;
+  Timer*       t;
+  int          id;
 
-    // Other signal was fired - restart the timer 
-    if (sig != SIGALRM) 
+  LOG(LEVEL_DEBUG, HDR "Timer thread started!", pthread_self());
+  while (true)
+  {
+    if (   (read(_timerFD, &expirations, sizeof(uint64_t)) < 0)
+        && (errno != EINTR) && (errno != EAGAIN))
     {
-      setTimer(t->future - time(NULL));
-    } 
-    else 
+      RAISE_SYS_ERROR("Could not read the timerfd");
+      break;
+    }
+
+    pthread_mutex_lock(&_timerMutex);
+    while (!_stop && (_heapSize > 0)
+           && (_timers[_heap[0]].deadline <= _now()))
     {
-      // One shot timer - disable it
-      if (t->interval == -1) 
+      id = _heap[0];
+      t  = &_timers[id];
+      callback = t->callback;
+      if (t->interval == 0)
       {
-        t->active = false;
-      } 
-      else 
+        _removeFromHeap(t);
+      }
+      else
       {
-        t->future += t->interval;
+        // Skip the intervals that were missed.
+        do
+        {
+          t->deadline += t->interval;
+        } while (t->deadline <= _now());
+        _reorder(0);
       }
 
-      // Select a new timer
-      selectTimer();
-
-      // Call the handler
-      t->callback(t->id, time(NULL));
+      pthread_mutex_unlock(&_timerMutex);
+      callback(id, time(NULL));
+      pthread_mutex_lock(&_timerMutex);
     }
+    if (_stop)
+    {
+      pthread_mutex_unlock(&_timerMutex);
+      break;
+    }
+    _armTimerFD();
+    pthread_mutex_unlock(&_timerMutex);
   }
-}
-
-/** 
- * Clears the \c alarm.
- */
-static void clearAlarm() 
-{
-  struct itimerval tv;
+  LOG(LEVEL_DEBUG, HDR "Timer thread stopped!", pthread_self());
 
-  timerclear(&tv.it_value);
-  setitimer(ITIMER_REAL, &tv, NULL);
+  return NULL;
 }
 
-int setupTimer(TimerExpired callback) 
+int setupTimer(TimerExpired callback)
 {
-  Timer*  t; 
- 
+  Timer* timers;
+  int*   heap;
+  int    id = -1;
+
+  pthread_mutex_lock(&_timerMutex);
   // No timer yet
-  if (!_initialized) 
+  if (!_initialized)
   {
-    initSList(&_timerList);
+    _timerFD = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (_timerFD == -1)
+    {
+      RAISE_SYS_ERROR("Could not create the timerfd");
+      pthread_mutex_unlock(&_timerMutex);
+      return -1;
+    }
+    _stop = false;
+    if (pthread_create(&_timerThread, NULL, _timerLoop, NULL) != 0)
+    {
+      RAISE_SYS_ERROR("Could not start the timer thread");
+      close(_timerFD);
+      _timerFD = -1;
+      pthread_mutex_unlock(&_timerMutex);
+      return -1;
+    }
     _initialized = true;
-    _activeId    = -1;
-    signal(SIGALRM, alarmSignal);
   }
 
-  // Append the new timer structure
-  t = appendToSList(&_timerList, sizeof(Timer));
-  if (t == NULL) 
+  // Reuse the slot of a deleted timer
+  for (id = 0; (id < _noTimers) && _timers[id].used; id++) {}
+  if (id == _noTimers)
   {
-    return -1;
+    timers = realloc(_timers, sizeof(Timer) * (_noTimers + TIMER_ALLOC_STEP));
+    heap   = timers != NULL
+             ? realloc(_heap, sizeof(int) * (_noTimers + TIMER_ALLOC_STEP))
+             : NULL;
+    if (timers != NULL)
+    {
+      _timers = timers;
+      memset(_timers + _noTimers, 0, sizeof(Timer) * TIMER_ALLOC_STEP);
+    }
+    if (heap == NULL)
+    {
+      pthread_mutex_unlock(&_timerMutex);
+      return -1;
+    }
+    _heap      = heap;
+    _noTimers += TIMER_ALLOC_STEP;
   }
 
-  t->id       = sizeOfSList(&_timerList) - 1;
-  t->active   = false;
-  t->callback = callback;
+  memset(&_timers[id], 0, sizeof(Timer));
+  _timers[id].used     = true;
+  _timers[id].callback = callback;
+  pthread_mutex_unlock(&_timerMutex);
 
-  return t->id;
+  return id;
 }
 
-void deleteTimer(int id) 
+void deleteTimer(int id)
 {
-  Timer* t = getFromSList(&_timerList, id);
-  if (t != NULL) 
+  Timer* t;
+
+  pthread_mutex_lock(&_timerMutex);
+  t = _getTimer(id);
+  if (t != NULL)
   {
-    stopTimer(id);
-    deleteFromSList(&_timerList, t);
+    if (t->active)
+    {
+      _removeFromHeap(t);
+      _armTimerFD();
+    }
+    t->used = false;
   }
+  pthread_mutex_unlock(&_timerMutex);
 }
 
-void deleteAllTimers() 
+void deleteAllTimers()
 {
-  clearAlarm();
-  releaseSList(&_timerList);
+  pthread_mutex_lock(&_timerMutex);
+  if (!_initialized)
+  {
+    pthread_mutex_unlock(&_timerMutex);
+    return;
+  }
+  _stop = true;
+  _armTimerFD();
+  pthread_mutex_unlock(&_timerMutex);
+
+  // A callback can not wait for its own thread.
+  if (pthread_equal(pthread_self(), _timerThread))
+  {
+    pthread_detach(_timerThread);
+  }
+  else
+  {
+    pthread_join(_timerThread, NULL);
+  }
+
+  pthread_mutex_lock(&_timerMutex);
+  close(_timerFD);
+  _timerFD  = -1;
+  free(_timers);
+  free(_heap);
+  _timers   = NULL;
+  _heap     = NULL;
+  _noTimers = 0;
+  _heapSize = 0;
   _initialized = false;
+  pthread_mutex_unlock(&_timerMutex);
 }
 
-bool isActiveTimer(int id) 
+bool isActiveTimer(int id)
 {
-  Timer* t = getFromSList(&_timerList, id);
-  return (t == NULL) ? false : t->active;
+  Timer* t;
+  bool   active;
+
+  pthread_mutex_lock(&_timerMutex);
+  t      = _getTimer(id);
+  active = (t == NULL) ? false : t->active;
+  pthread_mutex_unlock(&_timerMutex);
+
+  return active;
 }
 
 /**
  * Starts the timer, to fire in the a specific time.
  *
  * @param id Timer identifier
- * @param future When to fire (UNIX timestamp)
- * @param interval Fire again afer \c internval seconds, \c -1 = only once
+ * @param future When to fire (milliseconds of the monotonic clock)
+ * @param interval Fire again afer \c interval milliseconds, \c 0 = only once
  */
-static void startTimer(int id, time_t future, int interval) 
+static void startTimer(int id, uint64_t future, uint64_t interval)
 {
   Timer* t;
 
-  // Active timer - then deactivate it first
-  if (_activeId == id) 
+  pthread_mutex_lock(&_timerMutex);
+  t = _getTimer(id);
+  if (t != NULL)
   {
-    clearAlarm();
-  }
-
-  // Store the parameters
-  t = getFromSList(&_timerList, id);
-  if (t != NULL) 
-  {
-    t->future   = future;
+    t->deadline = future;
     t->interval = interval;
-    t->active   = true;
-
-    selectTimer();  
+    if (!t->active)
+    {
+      t->active  = true;
+      t->heapPos = _heapSize;
+      _heap[_heapSize++] = id;
+    }
+    _reorder(t->heapPos);
+    _armTimerFD();
   }
+  pthread_mutex_unlock(&_timerMutex);
 }
 
-void startIntervalTimer(int id, int sec, bool oneShot) 
+void startIntervalTimer(int id, int sec, bool oneShot)
 {
-  startTimer(id, time(NULL) + sec, oneShot ? -1 : sec);
+  startIntervalTimerMs(id, (uint32_t)sec * 1000, oneShot);
 }
 
-void startAbsoluteTimer(int id, time_t future) 
+void startIntervalTimerMs(int id, uint32_t msec, bool oneShot)
 {
-  if (future > time(NULL)) 
+  // An interval timer of 0 would never leave the loop.
+  if (!oneShot && (msec == 0))
   {
-    startTimer(id, future, -1);
+    msec = 1;
   }
+  startTimer(id, _now() + msec, oneShot ? 0 : msec);
 }
 
-void stopTimer(int id) 
+void startAbsoluteTimer(int id, time_t future)
 {
-  Timer* t;
+  time_t now = time(NULL);
 
-  // The given timer is the active timer
-  if (_activeId == id) 
+  if (future > now)
   {
-    // Deactivate first
-    clearAlarm();
+    startTimer(id, _now() + (uint64_t)(future - now) * 1000, 0);
+  }
+}
 
-    // Set to inactive and select a new timer
-    t = getFromSList(&_timerList, id);
-    t->active = false;
-    selectTimer();
+void stopTimer(int id)
+{
+  Timer* t;
 
-  // Not the active timer
-  } 
-  else 
+  pthread_mutex_lock(&_timerMutex);
+  t = _getTimer(id);
+  if ((t != NULL) && t->active)
   {
-    t = getFromSList(&_timerList, id);
-    if (t != NULL) 
-    {
-      t->active = false;
-    }
+    _removeFromHeap(t);
+    _armTimerFD();
   }
-}
\ No newline at end of file
+  pthread_mutex_unlock(&_timerMutex);
+}
@@ -20,7 +20,7 @@
  * by this software.
  *
  *
- * Managed timers.
+ * Managed timers. The callbacks are called by a separate timer thread.
  * 
  * @version 0.3.0.10
  *
@@ -38,11 +38,14 @@
 
 #include <time.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * Definition of the function that should be called upon the firing of a
- * alarm.
+ * alarm. The function is called by the timer thread and may start, stop
+ * and delete timers.
  *
+ * @param id The timer identifier
  * @param now Current time (UNIX timestamp)
  * @see createTimer
  */
@@ -68,7 +71,8 @@ extern void deleteTimer(int id);
 /**
  * Deletes all timers.
  *
- * @note Stops all timers
+ * @note Stops all timers and the timer thread. Waits for a running callback
+ *       unless called by the callback itself.
  */
 extern void deleteAllTimers();
 
@@ -92,6 +96,19 @@ extern bool isActiveTimer(int id);
  */
 extern void startIntervalTimer(int id, int sec, bool oneShot);
 
+/** 
+ * Starts the timer with a timeout value of \c msec milliseconds.
+ * The \c oneShot parameter specifies whether the timer should fire once
+ * (= \c true), or multiple times.
+ *
+ * @param id Identifier
+ * @param msec Milliseconds
+ * @param oneShot Fire once
+ *
+ * @since 0.6.3.0
+ */
+extern void startIntervalTimerMs(int id, uint32_t msec, bool oneShot);
+
 /** 
  * Starts the timer so that will be fired at a specific time in the future.
  *